@@ -14,6 +14,7 @@
 #include "core_http.h"
 #include "core_sha256.h"
 #include "ota_md5.h"
+#include "ota_delta.h"
 #include "ota_private.h"
 #include "core_log.h"
 #include "core_global.h"
@@ -22,10 +23,21 @@ static int32_t _ota_subscribe(core_mqtt_handle_t *mqtt_handle, void *ota_handle)
 static int32_t _ota_free_task_desc(aiot_sysdep_portfile_t *sysdep, void *data);
 static int32_t _ota_report_base(void *handle, char *topic_prefix, char *product_key, char *device_name,  char *params);
 static void    _ota_mqtt_process(void *handle, const aiot_mqtt_recv_t *const packet, void *userdata);
-static int32_t _ota_parse_json(aiot_sysdep_portfile_t *sysdep, void *in, uint32_t in_len, char *key_word, char **out);
 static int32_t _ota_parse_url(const char *url, char *host, char *path);
 static int32_t _download_update_digest(download_handle_t *download_handle, uint8_t *buffer, uint32_t buffer_len);
 static int32_t _download_verify_digest(download_handle_t *download_handle);
+static uint32_t _download_digest_export(download_handle_t *download_handle, uint8_t *output, uint32_t output_len);
+static int32_t _download_digest_import(download_handle_t *download_handle, const uint8_t *input, uint32_t input_len);
+static void    _download_checkpoint_notify(download_handle_t *download_handle);
+static int32_t _download_delta_update(download_handle_t *download_handle, uint8_t *buffer, uint32_t buffer_len);
+static int32_t _download_deliver(download_handle_t *download_handle, int32_t percent, uint8_t *buffer, uint32_t len);
+static int32_t _download_writer_prepare(download_handle_t *download_handle);
+static uint32_t _download_writer_space(download_handle_t *download_handle);
+static int32_t _download_writer_result(download_handle_t *download_handle);
+static int32_t _download_writer_drain(download_handle_t *download_handle);
+static void    _download_writer_free(download_handle_t *download_handle);
+static int32_t _download_checkpoint_restore(download_handle_t *download_handle,
+        const aiot_download_checkpoint_t *checkpoint);
 static void    _http_recv_handler(void *handle, const aiot_http_recv_t *recv_data, void *user_data);
 static void   *_download_deep_copy_task_desc(aiot_sysdep_portfile_t *sysdep, void *data);
 static void    _download_deep_copy_base(aiot_sysdep_portfile_t *sysdep, char *in, char **out);
@@ -129,6 +141,9 @@ void *aiot_download_init(void)
     download_handle->sysdep = sysdep;
     download_handle->data_mutex = sysdep->core_sysdep_mutex_init();
     download_handle->recv_mutex = sysdep->core_sysdep_mutex_init();
+    download_handle->writer_mutex = sysdep->core_sysdep_mutex_init();
+    download_handle->writer_buffer_len = AIOT_DOWNLOAD_DEFAULT_WRITER_BUFFER_LEN;
+    download_handle->writer_buffer_num = AIOT_DOWNLOAD_DEFAULT_WRITER_BUFFER_NUM;
 
     http_handle = core_http_init();
     core_http_setopt(http_handle, CORE_HTTPOPT_RECV_HANDLER, _http_recv_handler);
@@ -163,12 +178,18 @@ int32_t aiot_download_deinit(void **handle)
             sysdep->core_sysdep_free(download_handle->digest_ctx);
         }
     }
+    if (NULL != download_handle->delta_ctx) {
+        ota_delta_free(download_handle->delta_ctx);
+        sysdep->core_sysdep_free(download_handle->delta_ctx);
+    }
+    _download_writer_free(download_handle);
     if (NULL != download_handle->task_desc) {
         sysdep->core_sysdep_free(download_handle->task_desc);
     }
 
     sysdep->core_sysdep_mutex_deinit(&(download_handle->data_mutex));
     sysdep->core_sysdep_mutex_deinit(&(download_handle->recv_mutex));
+    sysdep->core_sysdep_mutex_deinit(&(download_handle->writer_mutex));
     sysdep->core_sysdep_free(download_handle);
     *handle = NULL;
     return res;
@@ -211,6 +232,7 @@ int32_t aiot_download_setopt(void *handle, aiot_download_option_t option, void *
         case AIOT_DLOPT_TASK_DESC: {
             void *new_task_desc = _download_deep_copy_task_desc(sysdep, data);
             if (NULL == new_task_desc) {
+                sysdep->core_sysdep_mutex_unlock(download_handle->data_mutex);
                 return STATE_DOWNLOAD_SETOPT_COPIED_DATA_IS_NULL;
             }
 
@@ -245,6 +267,42 @@ int32_t aiot_download_setopt(void *handle, aiot_download_option_t option, void *
             core_http_setopt(download_handle->http_handle, CORE_HTTPOPT_BODY_BUFFER_MAX_LEN, data);
         }
         break;
+        case AIOT_DLOPT_SEGMENT_SIZE: {
+            download_handle->segment_size = *(uint32_t *)data;
+        }
+        break;
+        case AIOT_DLOPT_CHECKPOINT_HANDLER: {
+            download_handle->checkpoint_handler = (aiot_download_checkpoint_handler_t)data;
+        }
+        break;
+        case AIOT_DLOPT_CHECKPOINT: {
+            res = _download_checkpoint_restore(download_handle, (const aiot_download_checkpoint_t *)data);
+        }
+        break;
+        case AIOT_DLOPT_DELTA_READ_HANDLER: {
+            download_handle->delta_read_handler = (aiot_download_delta_read_handler_t)data;
+        }
+        break;
+        case AIOT_DLOPT_WRITER_HANDLER: {
+            download_handle->writer_handler = (aiot_download_writer_handler_t)data;
+        }
+        break;
+        case AIOT_DLOPT_WRITER_BUFFER_LEN: {
+            if (NULL != download_handle->writer_slots || 0 == *(uint32_t *)data) {
+                res = STATE_USER_INPUT_OUT_RANGE;
+                break;
+            }
+            download_handle->writer_buffer_len = *(uint32_t *)data;
+        }
+        break;
+        case AIOT_DLOPT_WRITER_BUFFER_NUM: {
+            if (NULL != download_handle->writer_slots || *(uint32_t *)data < 2) {
+                res = STATE_USER_INPUT_OUT_RANGE;
+                break;
+            }
+            download_handle->writer_buffer_num = *(uint32_t *)data;
+        }
+        break;
         default: {
             res = STATE_USER_INPUT_OUT_RANGE;
         }
@@ -375,6 +433,11 @@ int32_t aiot_download_recv(void *handle)
     http_handle = download_handle->http_handle;
     sysdep = download_handle->sysdep;
 
+    res = _download_writer_result(download_handle);
+    if (STATE_SUCCESS != res) {
+        return res;
+    }
+
     sysdep->core_sysdep_mutex_lock(download_handle->recv_mutex);
     switch (download_handle->download_status) {
         case DOWNLOAD_STATUS_START: {
@@ -383,9 +446,41 @@ int32_t aiot_download_recv(void *handle)
         }
         break;
         case DOWNLOAD_STATUS_FETCH: {
+            /* 写flash任务落后时不读取网络, 数据留在协议栈/模组的缓冲区中, 由TCP窗口形成反压 */
+            if (NULL != download_handle->writer_handler &&
+                    download_handle->size_fetched < download_handle->task_desc->size_total) {
+                uint32_t need = ((core_http_handle_t *)http_handle)->body_buffer_max_len;
+                res = _download_writer_prepare(download_handle);
+                if (res != STATE_SUCCESS) {
+                    break;
+                }
+                if (need > download_handle->writer_buffer_len * download_handle->writer_buffer_num) {
+                    need = download_handle->writer_buffer_len * download_handle->writer_buffer_num;
+                }
+                if (_download_writer_space(download_handle) < need) {
+                    res = STATE_DOWNLOAD_WRITER_BUSY;
+                    break;
+                }
+            }
             res = core_http_recv(http_handle);
             if (download_handle->size_fetched == download_handle->task_desc->size_total) {
                 res = STATE_DOWNLOAD_FINISHED;
+                /* 数据全部写入flash之后才算下载完成 */
+                if (NULL != download_handle->writer_handler && NULL != download_handle->writer_slots) {
+                    int32_t drain_res = _download_writer_drain(download_handle);
+                    if (drain_res != STATE_SUCCESS) {
+                        res = drain_res;
+                    }
+                }
+                break;
+            }
+            /* 当前分段已收完, 保存断点后在同一连接上请求下一个分段 */
+            if (res > 0 && 0 != download_handle->segment_size &&
+                    download_handle->size_fetched == download_handle->segment_end + 1) {
+                _download_checkpoint_notify(download_handle);
+                download_handle->segment_done = 1;
+                download_handle->download_status = DOWNLOAD_STATUS_START;
+                core_log(download_handle->sysdep, STATE_DOWNLOAD_SEGMENT_FINISHED, "segment finished\r\n");
                 break;
             }
             /* TODO: range_end碰到后,应该有个不同于STATE_DOWNLOAD_FINISHED的状态码*/
@@ -396,6 +491,8 @@ int32_t aiot_download_recv(void *handle)
                 core_log1(download_handle->sysdep, STATE_DOWNLOAD_RECV_ERROR, "recv got %s\r\n",
                           &res_string);
                 download_handle->download_status = DOWNLOAD_STATUS_START;
+                download_handle->segment_done = 0;
+                _download_checkpoint_notify(download_handle);
                 core_log(download_handle->sysdep, STATE_OTA_RENEWAL, "renewal\r\n");
             }
         }
@@ -486,16 +583,21 @@ void _ota_mqtt_process(void *handle, const aiot_mqtt_recv_t *const packet, void
     aiot_sysdep_portfile_t *sysdep = NULL;
     char *product_key = NULL;
     char *device_name = NULL;
-    char *version = NULL;
-    char *size_string = NULL;
-    uint32_t size;
-    char *url = NULL;
-    char *digest_method_string = NULL;
-    char *expect_digest = NULL;
+    uint32_t size = 0;
     uint8_t ota_type;
-    char *data = NULL;
     char *key = NULL;
-    uint32_t data_len = 0;
+    char *payload = NULL;
+    char *strings = NULL;
+    uint32_t idx = 0, strings_len = 0;
+    int32_t tokens_count = 0;
+    core_json_token_t stack_tokens[OTA_JSON_TOKENS_NUM];
+    core_json_token_t *tokens = stack_tokens;
+    /* 依次为size, signMethod, version, url, sign, isDiff, 其中version, url和sign需要以'\0'结尾, 拷贝到同一块内存中 */
+    char *paths_fota[] = {"data.size", "data.signMethod", "data.version", "data.url", "data.sign", "data.isDiff"};
+    char *paths_cota[] = {"data.configSize", "data.signMethod", NULL, "data.url", "data.sign", NULL};
+    char **paths = NULL;
+    char *values[6] = {NULL};
+    uint32_t values_len[6] = {0};
     aiot_download_task_desc_t task_desc = {0};
 
     if (AIOT_MQTTRECV_PUB != packet->type) {
@@ -515,63 +617,76 @@ void _ota_mqtt_process(void *handle, const aiot_mqtt_recv_t *const packet, void
     task_desc.product_key = product_key;
     task_desc.device_name = device_name;
     task_desc.mqtt_handle = ota_handle->mqtt_handle;
-    key = "data";
-    res = core_json_value((const char *)(packet->data.pub.payload), packet->data.pub.payload_len,
-                          key, strlen(key), &data, &data_len);
-    if (res != STATE_SUCCESS) {
-        goto exit;
-    }
 
-    if (AIOT_OTARECV_FOTA == ota_type) {
-        key = "size";
-        res = _ota_parse_json(sysdep, data, data_len, key, &size_string);
-        if (res != STATE_SUCCESS) {
+    /* 整条消息只扫描一遍, 之后按路径查找, 取到的值直接指向payload */
+    payload = (char *)packet->data.pub.payload;
+    tokens_count = core_json_parse(payload, packet->data.pub.payload_len, tokens, OTA_JSON_TOKENS_NUM);
+    if (tokens_count == STATE_USER_INPUT_OUT_RANGE) {
+        /* 栈上的token不够时按payload长度分配, 每个token至少占两个字符, 不会再溢出 */
+        uint32_t tokens_num = packet->data.pub.payload_len / 2 + 1;
+        tokens = sysdep->core_sysdep_malloc(tokens_num * sizeof(core_json_token_t), OTA_MODULE_NAME);
+        if (NULL == tokens) {
+            key = "json tokens malloc failed\r\n";
+            res = STATE_SYS_DEPEND_MALLOC_FAILED;
             goto exit;
         }
-        key = "version";
-        res = _ota_parse_json(sysdep, data, data_len, key, &version);
-        if (res != STATE_SUCCESS) {
-            goto exit;
+        tokens_count = core_json_parse(payload, packet->data.pub.payload_len, tokens, tokens_num);
+    }
+
+    paths = (AIOT_OTARECV_FOTA == ota_type) ? paths_fota : paths_cota;
+    for (idx = 0; idx < sizeof(values) / sizeof(char *); idx++) {
+        if (paths[idx] == NULL) {
+            continue;
         }
-        task_desc.version = version;
-    } else {
-        key = "configSize";
-        res = _ota_parse_json(sysdep, data, data_len, key, &size_string);
-        if (res != STATE_SUCCESS) {
+        /* isDiff为可选字段, 仅差分升级任务携带 */
+        if ((tokens_count < 0 ||
+                core_json_find(payload, tokens, tokens_count, paths[idx], &values[idx], &values_len[idx]) != STATE_SUCCESS) &&
+                idx < 5) {
+            key = paths[idx];
+            res = STATE_OTA_PARSE_JSON_ERROR;
             goto exit;
         }
+        if (idx >= 2 && idx < 5) {
+            strings_len += values_len[idx] + 1;
+        }
     }
-    core_str2uint(size_string, strlen(size_string), &size);
-    task_desc.size_total = size;
-    key = "url";
-    res = _ota_parse_json(sysdep, data, data_len, key, &url);
-    if (res != STATE_SUCCESS) {
-        goto exit;
-    }
-    task_desc.url = url;
 
-    key = "signMethod";
-    res = _ota_parse_json(sysdep, data, data_len, key,
-                          &digest_method_string);
-    if (res != STATE_SUCCESS) {
-        goto exit;
-    }
+    core_str2uint(values[0], (uint8_t)values_len[0], &size);
+    task_desc.size_total = size;
 
-    if (strcmp(digest_method_string, "SHA256") == 0 || strcmp(digest_method_string, "Sha256") == 0) {
+    if ((values_len[1] == strlen("SHA256") && memcmp(values[1], "SHA256", values_len[1]) == 0) ||
+            (values_len[1] == strlen("Sha256") && memcmp(values[1], "Sha256", values_len[1]) == 0)) {
         task_desc.digest_method = AIOT_OTA_DIGEST_SHA256;
-    } else if (strcmp(digest_method_string, "Md5") == 0) {
+    } else if (values_len[1] == strlen("Md5") && memcmp(values[1], "Md5", values_len[1]) == 0) {
         task_desc.digest_method = AIOT_OTA_DIGEST_MD5;
     } else {
+        key = paths[1];
         res = STATE_OTA_UNKNOWN_DIGEST_METHOD;
         goto exit;
     }
 
-    key = "sign";
-    res = _ota_parse_json(sysdep, data, data_len, key, &expect_digest);
-    if (res != STATE_SUCCESS) {
+    strings = sysdep->core_sysdep_malloc(strings_len, OTA_MODULE_NAME);
+    if (NULL == strings) {
+        key = "task desc malloc failed\r\n";
+        res = STATE_SYS_DEPEND_MALLOC_FAILED;
         goto exit;
     }
-    task_desc.expect_digest = expect_digest;
+    for (idx = 2, strings_len = 0; idx < 5; idx++) {
+        if (values[idx] == NULL) {
+            continue;
+        }
+        memcpy(&strings[strings_len], values[idx], values_len[idx]);
+        strings[strings_len + values_len[idx]] = '\0';
+        values[idx] = &strings[strings_len];
+        strings_len += values_len[idx] + 1;
+    }
+    task_desc.version = values[2];
+    task_desc.url = values[3];
+    task_desc.expect_digest = values[4];
+
+    if (values_len[5] == 1 && values[5][0] == '1') {
+        task_desc.is_diff = 1;
+    }
 
     aiot_ota_recv_t msg = {
         .type = ota_type,
@@ -583,15 +698,18 @@ void _ota_mqtt_process(void *handle, const aiot_mqtt_recv_t *const packet, void
     }
 
 exit:
-    if (NULL != size_string) {
-        sysdep->core_sysdep_free(size_string);
-    }
-    if (NULL != digest_method_string) {
-        sysdep->core_sysdep_free(digest_method_string);
-    }
     if (res != STATE_SUCCESS) {
         core_log(sysdep, res, key);
     }
+    if (NULL != strings) {
+        sysdep->core_sysdep_free(strings);
+    }
+    if (NULL != tokens && tokens != stack_tokens) {
+        sysdep->core_sysdep_free(tokens);
+    }
+    task_desc.version = NULL;
+    task_desc.url = NULL;
+    task_desc.expect_digest = NULL;
     _ota_free_task_desc(sysdep, (void *)(&task_desc));
 }
 
@@ -653,17 +771,25 @@ int32_t aiot_download_send_request(void *handle)
     {
         uint32_t range_start = download_handle->range_start;
         uint32_t range_end = download_handle->range_end;
+        uint32_t segment_size = download_handle->segment_size;
+        uint32_t size_total = download_handle->task_desc->size_total;
         uint8_t range_start_string_len = 0;
         uint8_t range_end_string_len = 0;
         char range_start_string[OTA_MAX_DIGIT_NUM_OF_UINT32] = {0};
         char range_end_string[OTA_MAX_DIGIT_NUM_OF_UINT32] = {0};
         core_int2str(range_start, range_start_string, &range_start_string_len);
 
-        if (0 != range_end) {
-            if (download_handle->size_fetched >= range_end) {
-                return STATE_DOWNLOAD_GOT_RANGE_END;
-            }
-            core_int2str(range_end, range_end_string, &range_end_string_len);
+        if (0 != range_end && download_handle->size_fetched >= range_end) {
+            return STATE_DOWNLOAD_GOT_RANGE_END;
+        }
+
+        /* 分段下载时, 本次请求的结束位置取分段末尾与用户设置的range_end中较小的一个 */
+        download_handle->segment_end = (0 != range_end) ? range_end : ((size_total > 0) ? (size_total - 1) : 0);
+        if (0 != segment_size && size_total > 0 && range_start + segment_size - 1 < download_handle->segment_end) {
+            download_handle->segment_end = range_start + segment_size - 1;
+        }
+        if (0 != range_end || (0 != segment_size && size_total > 0)) {
+            core_int2str(download_handle->segment_end, range_end_string, &range_end_string_len);
         }
 
         {
@@ -686,10 +812,18 @@ int32_t aiot_download_send_request(void *handle)
         .content = NULL,
         .content_len = 0
     };
-    res = core_http_connect(download_handle->http_handle);
-    if (res != STATE_SUCCESS) {
-        return res;
+    /* 上一个分段正常收完且连接仍然可用时, 直接复用该连接 */
+    if (0 == download_handle->segment_done ||
+            NULL == ((core_http_handle_t *)download_handle->http_handle)->network_handle) {
+        res = core_http_connect(download_handle->http_handle);
+        if (res != STATE_SUCCESS) {
+            sysdep->core_sysdep_free(header_string);
+            return res;
+        }
     }
+    download_handle->segment_done = 0;
+    download_handle->status_code = 0;
+    download_handle->skip_len = 0;
     res = core_http_send(download_handle->http_handle, &request);
     sysdep->core_sysdep_free(header_string);
     /* core_http_send 返回的是发送的body的长度; 错误返回负数 */
@@ -736,12 +870,462 @@ static int32_t _download_verify_digest(download_handle_t *download_handle)
     return STATE_OTA_DIGEST_MISMATCH;
 }
 
+static uint32_t _download_digest_pack(uint8_t *output, const uint32_t *words, uint32_t count)
+{
+    uint32_t idx = 0;
+
+    for (idx = 0; idx < count; idx++) {
+        output[idx * 4] = (uint8_t)(words[idx]);
+        output[idx * 4 + 1] = (uint8_t)(words[idx] >> 8);
+        output[idx * 4 + 2] = (uint8_t)(words[idx] >> 16);
+        output[idx * 4 + 3] = (uint8_t)(words[idx] >> 24);
+    }
+    return count * 4;
+}
+
+static uint32_t _download_digest_unpack(const uint8_t *input, uint32_t *words, uint32_t count)
+{
+    uint32_t idx = 0;
+
+    for (idx = 0; idx < count; idx++) {
+        words[idx] = (uint32_t)input[idx * 4] | ((uint32_t)input[idx * 4 + 1] << 8) |
+                     ((uint32_t)input[idx * 4 + 2] << 16) | ((uint32_t)input[idx * 4 + 3] << 24);
+    }
+    return count * 4;
+}
+
+/* 将digest上下文按固定的小端格式序列化, 保证断点记录与结构体布局和字节序无关 */
+static uint32_t _download_digest_export(download_handle_t *download_handle, uint8_t *output, uint32_t output_len)
+{
+    uint32_t offset = 0;
+
+    if (NULL == download_handle->digest_ctx) {
+        return 0;
+    }
+
+    if (AIOT_OTA_DIGEST_SHA256 == download_handle->task_desc->digest_method) {
+        core_sha256_context_t *ctx = (core_sha256_context_t *)download_handle->digest_ctx;
+        if (output_len < 2 * 4 + 8 * 4 + sizeof(ctx->buffer) + 1) {
+            return 0;
+        }
+        offset += _download_digest_pack(&output[offset], ctx->total, 2);
+        offset += _download_digest_pack(&output[offset], ctx->state, 8);
+        memcpy(&output[offset], ctx->buffer, sizeof(ctx->buffer));
+        offset += sizeof(ctx->buffer);
+        output[offset++] = ctx->is224;
+    } else if (AIOT_OTA_DIGEST_MD5 == download_handle->task_desc->digest_method) {
+        utils_md5_context_t *ctx = (utils_md5_context_t *)download_handle->digest_ctx;
+        if (output_len < 2 * 4 + 4 * 4 + sizeof(ctx->buffer)) {
+            return 0;
+        }
+        offset += _download_digest_pack(&output[offset], ctx->total, 2);
+        offset += _download_digest_pack(&output[offset], ctx->state, 4);
+        memcpy(&output[offset], ctx->buffer, sizeof(ctx->buffer));
+        offset += sizeof(ctx->buffer);
+    }
+    return offset;
+}
+
+static int32_t _download_digest_import(download_handle_t *download_handle, const uint8_t *input, uint32_t input_len)
+{
+    uint32_t offset = 0;
+
+    if (NULL == download_handle->digest_ctx) {
+        return STATE_DOWNLOAD_CHECKPOINT_MISMATCH;
+    }
+
+    if (AIOT_OTA_DIGEST_SHA256 == download_handle->task_desc->digest_method) {
+        core_sha256_context_t *ctx = (core_sha256_context_t *)download_handle->digest_ctx;
+        if (input_len != 2 * 4 + 8 * 4 + sizeof(ctx->buffer) + 1) {
+            return STATE_DOWNLOAD_CHECKPOINT_MISMATCH;
+        }
+        offset += _download_digest_unpack(&input[offset], ctx->total, 2);
+        offset += _download_digest_unpack(&input[offset], ctx->state, 8);
+        memcpy(ctx->buffer, &input[offset], sizeof(ctx->buffer));
+        offset += sizeof(ctx->buffer);
+        ctx->is224 = input[offset];
+    } else if (AIOT_OTA_DIGEST_MD5 == download_handle->task_desc->digest_method) {
+        utils_md5_context_t *ctx = (utils_md5_context_t *)download_handle->digest_ctx;
+        if (input_len != 2 * 4 + 4 * 4 + sizeof(ctx->buffer)) {
+            return STATE_DOWNLOAD_CHECKPOINT_MISMATCH;
+        }
+        offset += _download_digest_unpack(&input[offset], ctx->total, 2);
+        offset += _download_digest_unpack(&input[offset], ctx->state, 4);
+        memcpy(ctx->buffer, &input[offset], sizeof(ctx->buffer));
+    } else {
+        return STATE_DOWNLOAD_CHECKPOINT_MISMATCH;
+    }
+    return STATE_SUCCESS;
+}
+
+static void _download_checkpoint_notify(download_handle_t *download_handle)
+{
+    aiot_download_checkpoint_t checkpoint;
+    uint32_t digest_len = 0;
+
+    if (NULL == download_handle->checkpoint_handler || NULL == download_handle->task_desc) {
+        return;
+    }
+    /* 断点只能记录已经写入flash的数据 */
+    if (NULL != download_handle->writer_slots && _download_writer_drain(download_handle) != STATE_SUCCESS) {
+        return;
+    }
+
+    memset(&checkpoint, 0, sizeof(aiot_download_checkpoint_t));
+    checkpoint.size_fetched = download_handle->size_fetched;
+    checkpoint.digest_method = download_handle->task_desc->digest_method;
+    if (NULL != download_handle->task_desc->expect_digest) {
+        digest_len = strlen(download_handle->task_desc->expect_digest);
+        digest_len = (digest_len < sizeof(checkpoint.expect_digest)) ? digest_len : (sizeof(checkpoint.expect_digest) - 1);
+        memcpy(checkpoint.expect_digest, download_handle->task_desc->expect_digest, digest_len);
+    }
+    checkpoint.digest_ctx_len = _download_digest_export(download_handle, checkpoint.digest_ctx,
+                                sizeof(checkpoint.digest_ctx));
+
+    download_handle->checkpoint_handler(download_handle, &checkpoint, download_handle->userdata);
+}
+
+static int32_t _download_checkpoint_restore(download_handle_t *download_handle,
+        const aiot_download_checkpoint_t *checkpoint)
+{
+    int32_t res = STATE_SUCCESS;
+    aiot_download_task_desc_t *task_desc = download_handle->task_desc;
+
+    if (NULL == task_desc) {
+        return STATE_DOWNLOAD_REQUEST_TASK_DESC_IS_NULL;
+    }
+    /* 差分还原的中间状态不在断点记录中 */
+    if (0 != task_desc->is_diff) {
+        return STATE_DOWNLOAD_CHECKPOINT_MISMATCH;
+    }
+    if (checkpoint->digest_method != task_desc->digest_method || NULL == task_desc->expect_digest ||
+            strncmp(checkpoint->expect_digest, task_desc->expect_digest, sizeof(checkpoint->expect_digest)) != 0 ||
+            checkpoint->size_fetched > task_desc->size_total ||
+            checkpoint->digest_ctx_len > sizeof(checkpoint->digest_ctx)) {
+        return STATE_DOWNLOAD_CHECKPOINT_MISMATCH;
+    }
+
+    res = _download_digest_import(download_handle, checkpoint->digest_ctx, checkpoint->digest_ctx_len);
+    if (res != STATE_SUCCESS) {
+        return res;
+    }
+    download_handle->size_fetched = checkpoint->size_fetched;
+    download_handle->writer_offset = checkpoint->size_fetched;
+    download_handle->percent = (task_desc->size_total > 0) ?
+                               (int32_t)(((uint64_t)checkpoint->size_fetched * 100) / task_desc->size_total) : 0;
+    download_handle->download_status = DOWNLOAD_STATUS_START;
+
+    return STATE_SUCCESS;
+}
+
+static int32_t _download_writer_prepare(download_handle_t *download_handle)
+{
+    uint32_t idx = 0;
+    aiot_sysdep_portfile_t *sysdep = download_handle->sysdep;
+    download_writer_slot_t *slots = NULL;
+
+    if (NULL != download_handle->writer_slots) {
+        return STATE_SUCCESS;
+    }
+
+    slots = sysdep->core_sysdep_malloc(sizeof(download_writer_slot_t) * download_handle->writer_buffer_num,
+                                       DOWNLOAD_MODULE_NAME);
+    if (NULL == slots) {
+        return STATE_SYS_DEPEND_MALLOC_FAILED;
+    }
+    memset(slots, 0, sizeof(download_writer_slot_t) * download_handle->writer_buffer_num);
+    for (idx = 0; idx < download_handle->writer_buffer_num; idx++) {
+        slots[idx].buffer = sysdep->core_sysdep_malloc(download_handle->writer_buffer_len, DOWNLOAD_MODULE_NAME);
+        if (NULL == slots[idx].buffer) {
+            while (idx > 0) {
+                sysdep->core_sysdep_free(slots[--idx].buffer);
+            }
+            sysdep->core_sysdep_free(slots);
+            return STATE_SYS_DEPEND_MALLOC_FAILED;
+        }
+    }
+
+    sysdep->core_sysdep_mutex_lock(download_handle->writer_mutex);
+    download_handle->writer_fill_idx = 0;
+    download_handle->writer_write_idx = 0;
+    download_handle->writer_slots = slots;
+    sysdep->core_sysdep_mutex_unlock(download_handle->writer_mutex);
+
+    return STATE_SUCCESS;
+}
+
+static void _download_writer_free(download_handle_t *download_handle)
+{
+    uint32_t idx = 0;
+    download_writer_slot_t *slots = (download_writer_slot_t *)download_handle->writer_slots;
+
+    if (NULL == slots) {
+        return;
+    }
+    for (idx = 0; idx < download_handle->writer_buffer_num; idx++) {
+        download_handle->sysdep->core_sysdep_free(slots[idx].buffer);
+    }
+    download_handle->sysdep->core_sysdep_free(slots);
+    download_handle->writer_slots = NULL;
+}
+
+static uint32_t _download_writer_space(download_handle_t *download_handle)
+{
+    uint32_t idx = 0, space = 0;
+    download_writer_slot_t *slots = (download_writer_slot_t *)download_handle->writer_slots;
+
+    download_handle->sysdep->core_sysdep_mutex_lock(download_handle->writer_mutex);
+    for (idx = 0; idx < download_handle->writer_buffer_num; idx++) {
+        if (DOWNLOAD_WRITER_SLOT_FREE == slots[idx].state) {
+            space += download_handle->writer_buffer_len;
+        } else if (DOWNLOAD_WRITER_SLOT_FILLING == slots[idx].state) {
+            space += download_handle->writer_buffer_len - slots[idx].len;
+        }
+    }
+    download_handle->sysdep->core_sysdep_mutex_unlock(download_handle->writer_mutex);
+
+    return space;
+}
+
+/* 写flash的任务失败时会修改writer_res, 在锁内读取 */
+static int32_t _download_writer_result(download_handle_t *download_handle)
+{
+    int32_t res = STATE_SUCCESS;
+
+    download_handle->sysdep->core_sysdep_mutex_lock(download_handle->writer_mutex);
+    res = download_handle->writer_res;
+    download_handle->sysdep->core_sysdep_mutex_unlock(download_handle->writer_mutex);
+
+    return res;
+}
+
+/* 把数据拷贝到流水线缓冲区中, 缓冲区都在等待写flash时阻塞等待 */
+static int32_t _download_writer_push(download_handle_t *download_handle, uint8_t *buffer, uint32_t len)
+{
+    int32_t res = STATE_SUCCESS;
+    uint32_t copy_len = 0;
+    uint64_t wait_start = 0;
+    uint8_t filling = 0;
+    aiot_sysdep_portfile_t *sysdep = download_handle->sysdep;
+    download_writer_slot_t *slot = NULL;
+
+    res = _download_writer_prepare(download_handle);
+    if (res != STATE_SUCCESS) {
+        return res;
+    }
+
+    while (len > 0) {
+        /* 写flash的任务会修改slot的状态和writer_res, 都在锁内读取 */
+        sysdep->core_sysdep_mutex_lock(download_handle->writer_mutex);
+        res = download_handle->writer_res;
+        slot = &((download_writer_slot_t *)download_handle->writer_slots)[download_handle->writer_fill_idx];
+        if (DOWNLOAD_WRITER_SLOT_FREE == slot->state) {
+            slot->state = DOWNLOAD_WRITER_SLOT_FILLING;
+            slot->offset = download_handle->writer_offset;
+            slot->len = 0;
+        }
+        filling = (DOWNLOAD_WRITER_SLOT_FILLING == slot->state) ? 1 : 0;
+        sysdep->core_sysdep_mutex_unlock(download_handle->writer_mutex);
+
+        if (STATE_SUCCESS != res) {
+            return res;
+        }
+        if (0 == filling) {
+            if (0 == wait_start) {
+                wait_start = sysdep->core_sysdep_time();
+            } else if (sysdep->core_sysdep_time() - wait_start >= AIOT_DOWNLOAD_DEFAULT_WRITER_TIMEOUT_MS) {
+                return STATE_DOWNLOAD_WRITER_TIMEOUT;
+            }
+            sysdep->core_sysdep_sleep(DOWNLOAD_WRITER_WAIT_INTERVAL_MS);
+            continue;
+        }
+        wait_start = 0;
+
+        copy_len = download_handle->writer_buffer_len - slot->len;
+        copy_len = (copy_len < len) ? copy_len : len;
+        memcpy(&slot->buffer[slot->len], buffer, copy_len);
+        slot->len += copy_len;
+        download_handle->writer_offset += copy_len;
+        buffer += copy_len;
+        len -= copy_len;
+
+        if (slot->len == download_handle->writer_buffer_len) {
+            sysdep->core_sysdep_mutex_lock(download_handle->writer_mutex);
+            slot->state = DOWNLOAD_WRITER_SLOT_FULL;
+            download_handle->writer_fill_idx = (download_handle->writer_fill_idx + 1) % download_handle->writer_buffer_num;
+            sysdep->core_sysdep_mutex_unlock(download_handle->writer_mutex);
+        }
+    }
+
+    return STATE_SUCCESS;
+}
+
+/* 提交未填满的缓冲区, 并等待所有缓冲区都写入flash */
+static int32_t _download_writer_drain(download_handle_t *download_handle)
+{
+    int32_t res = STATE_SUCCESS;
+    uint32_t idx = 0, pending = 0;
+    uint64_t wait_start = 0;
+    aiot_sysdep_portfile_t *sysdep = download_handle->sysdep;
+    download_writer_slot_t *slots = (download_writer_slot_t *)download_handle->writer_slots;
+
+    sysdep->core_sysdep_mutex_lock(download_handle->writer_mutex);
+    if (DOWNLOAD_WRITER_SLOT_FILLING == slots[download_handle->writer_fill_idx].state) {
+        slots[download_handle->writer_fill_idx].state = DOWNLOAD_WRITER_SLOT_FULL;
+        download_handle->writer_fill_idx = (download_handle->writer_fill_idx + 1) % download_handle->writer_buffer_num;
+    }
+    sysdep->core_sysdep_mutex_unlock(download_handle->writer_mutex);
+
+    wait_start = sysdep->core_sysdep_time();
+    while (1) {
+        pending = 0;
+        sysdep->core_sysdep_mutex_lock(download_handle->writer_mutex);
+        if (STATE_SUCCESS != download_handle->writer_res) {
+            res = download_handle->writer_res;
+            sysdep->core_sysdep_mutex_unlock(download_handle->writer_mutex);
+            return res;
+        }
+        for (idx = 0; idx < download_handle->writer_buffer_num; idx++) {
+            if (DOWNLOAD_WRITER_SLOT_FREE != slots[idx].state) {
+                pending++;
+            }
+        }
+        sysdep->core_sysdep_mutex_unlock(download_handle->writer_mutex);
+        if (0 == pending) {
+            return STATE_SUCCESS;
+        }
+        if (sysdep->core_sysdep_time() - wait_start >= AIOT_DOWNLOAD_DEFAULT_WRITER_TIMEOUT_MS) {
+            return STATE_DOWNLOAD_WRITER_TIMEOUT;
+        }
+        sysdep->core_sysdep_sleep(DOWNLOAD_WRITER_WAIT_INTERVAL_MS);
+    }
+}
+
+/* 设置了写flash的回调时返回流水线的状态, 失败后由 aiot_download_recv 返回该错误码中止下载 */
+static int32_t _download_deliver(download_handle_t *download_handle, int32_t percent, uint8_t *buffer, uint32_t len)
+{
+    int32_t res = STATE_SUCCESS;
+    aiot_download_recv_t recv_data = {
+        .type = AIOT_DLRECV_HTTPBODY,
+        .data = {
+            .buffer = buffer,
+            .len = len
+        }
+    };
+
+    /* 设置了写flash的回调时数据只交给流水线, 不再在接收路径上调用recv_handler */
+    if (NULL != download_handle->writer_handler) {
+        res = _download_writer_result(download_handle);
+        if (len > 0 && STATE_SUCCESS == res) {
+            res = _download_writer_push(download_handle, buffer, len);
+            if (res != STATE_SUCCESS) {
+                download_handle->sysdep->core_sysdep_mutex_lock(download_handle->writer_mutex);
+                download_handle->writer_res = res;
+                download_handle->sysdep->core_sysdep_mutex_unlock(download_handle->writer_mutex);
+                core_log(download_handle->sysdep, res, "writer stalled\r\n");
+            }
+        }
+    } else if (NULL != download_handle->recv_handler) {
+        download_handle->recv_handler(download_handle, percent, &recv_data, download_handle->userdata);
+    }
+
+    return res;
+}
+
+int32_t aiot_download_write_process(void *handle)
+{
+    int32_t res = STATE_SUCCESS;
+    download_handle_t *download_handle = (download_handle_t *)handle;
+    aiot_sysdep_portfile_t *sysdep = NULL;
+    download_writer_slot_t *slot = NULL;
+
+    if (NULL == download_handle) {
+        return STATE_DOWNLOAD_RECV_HANDLE_IS_NULL;
+    }
+    sysdep = download_handle->sysdep;
+
+    sysdep->core_sysdep_mutex_lock(download_handle->writer_mutex);
+    if (NULL != download_handle->writer_slots) {
+        slot = &((download_writer_slot_t *)download_handle->writer_slots)[download_handle->writer_write_idx];
+        if (DOWNLOAD_WRITER_SLOT_FULL == slot->state) {
+            slot->state = DOWNLOAD_WRITER_SLOT_WRITING;
+        } else {
+            slot = NULL;
+        }
+    }
+    sysdep->core_sysdep_mutex_unlock(download_handle->writer_mutex);
+
+    if (NULL == slot) {
+        return STATE_DOWNLOAD_WRITER_IDLE;
+    }
+
+    res = download_handle->writer_handler(download_handle, slot->offset, slot->buffer, slot->len,
+                                          download_handle->userdata);
+
+    sysdep->core_sysdep_mutex_lock(download_handle->writer_mutex);
+    slot->state = DOWNLOAD_WRITER_SLOT_FREE;
+    slot->len = 0;
+    download_handle->writer_write_idx = (download_handle->writer_write_idx + 1) % download_handle->writer_buffer_num;
+    if (res < STATE_SUCCESS) {
+        download_handle->writer_res = STATE_DOWNLOAD_WRITER_FAILED;
+    }
+    sysdep->core_sysdep_mutex_unlock(download_handle->writer_mutex);
+
+    if (res < STATE_SUCCESS) {
+        core_log(sysdep, STATE_DOWNLOAD_WRITER_FAILED, "flash write failed\r\n");
+        aiot_download_report_progress(download_handle, AIOT_OTAERR_BURN_FAILED);
+        return STATE_DOWNLOAD_WRITER_FAILED;
+    }
+
+    return STATE_SUCCESS;
+}
+
+static int32_t _download_delta_read(uint32_t offset, uint8_t *buffer, uint32_t len, void *userdata)
+{
+    download_handle_t *download_handle = (download_handle_t *)userdata;
+
+    return download_handle->delta_read_handler(download_handle, offset, buffer, len, download_handle->userdata);
+}
+
+static int32_t _download_delta_write(uint8_t *buffer, uint32_t len, void *userdata)
+{
+    download_handle_t *download_handle = (download_handle_t *)userdata;
+
+    return _download_deliver(download_handle, download_handle->percent, buffer, len);
+}
+
+static int32_t _download_delta_update(download_handle_t *download_handle, uint8_t *buffer, uint32_t buffer_len)
+{
+    aiot_sysdep_portfile_t *sysdep = download_handle->sysdep;
+
+    if (NULL == download_handle->delta_read_handler) {
+        return STATE_DOWNLOAD_DELTA_READ_FAILED;
+    }
+    if (NULL == download_handle->delta_ctx) {
+        download_handle->delta_ctx = sysdep->core_sysdep_malloc(sizeof(ota_delta_ctx_t), DOWNLOAD_MODULE_NAME);
+        if (NULL == download_handle->delta_ctx) {
+            return STATE_SYS_DEPEND_MALLOC_FAILED;
+        }
+        ota_delta_init(download_handle->delta_ctx, _download_delta_read, _download_delta_write, download_handle);
+    }
+
+    return ota_delta_update(download_handle->delta_ctx, buffer, buffer_len);
+}
+
 void _http_recv_handler(void *handle, const aiot_http_recv_t *packet, void *userdata)
 {
     download_handle_t *download_handle = (download_handle_t *)userdata;
     switch (packet->type) {
         case AIOT_HTTPRECV_STATUS_CODE : {
             /* 获取HTTP响应的状态码 */
+            download_handle->status_code = packet->data.status_code.code;
+            /* 服务端不支持Range请求时会从头返回整个文件, 此时整个应答算作一个分段, 并丢弃已经下载过的部分 */
+            if (200 == download_handle->status_code) {
+                download_handle->segment_end = download_handle->task_desc->size_total - 1;
+                if (0 != download_handle->range_start) {
+                    download_handle->skip_len = download_handle->range_start;
+                }
+            }
         }
         break;
         case AIOT_HTTPRECV_HEADER: {
@@ -760,12 +1344,46 @@ void _http_recv_handler(void *handle, const aiot_http_recv_t *packet, void *user
                 }
             };
 
-            download_handle->size_fetched += packet->data.body.len;
+            if (200 != download_handle->status_code && 206 != download_handle->status_code) {
+                break;
+            }
+            if (download_handle->skip_len >= recv_data.data.len) {
+                download_handle->skip_len -= recv_data.data.len;
+                break;
+            }
+            recv_data.data.buffer += download_handle->skip_len;
+            recv_data.data.len -= download_handle->skip_len;
+            download_handle->skip_len = 0;
+
+            download_handle->size_fetched += recv_data.data.len;
             percent = (100 * download_handle->size_fetched) / download_handle->task_desc->size_total;
-            _download_update_digest(download_handle, packet->data.body.buffer, packet->data.body.len);
+            _download_update_digest(download_handle, recv_data.data.buffer, recv_data.data.len);
 
-            if (download_handle->size_fetched == download_handle->task_desc->size_total) {
+            /* 差分升级时回调给用户的是还原后的新固件, 进度在还原结束并校验完之前不会到100 */
+            if (0 != download_handle->task_desc->is_diff) {
+                if (download_handle->percent < 0) {
+                    /* 还原已经失败, 后续数据直接丢弃 */
+                    break;
+                }
+                download_handle->percent = (percent < 100) ? percent : 99;
+                int32_t ret = _download_delta_update(download_handle, recv_data.data.buffer, recv_data.data.len);
+                if (ret != STATE_SUCCESS && STATE_SUCCESS != _download_writer_result(download_handle)) {
+                    /* 写flash失败, 与整包升级一样由 aiot_download_recv 返回流水线的错误码 */
+                    percent = AIOT_OTAERR_BURN_FAILED;
+                    core_log(download_handle->sysdep, ret, "delta write failed\r\n");
+                } else if (ret != STATE_SUCCESS) {
+                    percent = AIOT_OTAERR_CHECKSUM_MISMATCH;
+                    core_log(download_handle->sysdep, ret, "delta apply failed\r\n");
+                    aiot_download_report_progress(download_handle, AIOT_OTAERR_CHECKSUM_MISMATCH);
+                }
+                recv_data.data.len = 0;
+            }
+
+            if (download_handle->size_fetched == download_handle->task_desc->size_total && percent >= 0) {
                 int32_t ret = _download_verify_digest(download_handle);
+                if (ret == STATE_SUCCESS && 0 != download_handle->task_desc->is_diff) {
+                    ret = ota_delta_finish(download_handle->delta_ctx);
+                }
                 if (ret != STATE_SUCCESS) {
                     percent = AIOT_OTAERR_CHECKSUM_MISMATCH;
                     core_log(download_handle->sysdep, ret, "digest mismatch\r\n");
@@ -775,8 +1393,9 @@ void _http_recv_handler(void *handle, const aiot_http_recv_t *packet, void *user
                 }
             }
             download_handle->percent = percent;
-            if (NULL != download_handle->recv_handler) {
-                download_handle->recv_handler(download_handle, percent, &recv_data, download_handle->userdata);
+            /* 差分升级时新固件数据已在还原过程中回调, 这里只通知一个长度为0的分片以给出最终进度 */
+            if (0 == download_handle->task_desc->is_diff || percent == 100 || percent < 0) {
+                _download_deliver(download_handle, percent, recv_data.data.buffer, recv_data.data.len);
             }
         }
         break;
@@ -817,6 +1436,7 @@ static void *_download_deep_copy_task_desc(aiot_sysdep_portfile_t *sysdep, void
 
     dst_task_desc->size_total = src_task_desc->size_total;
     dst_task_desc->digest_method = src_task_desc->digest_method;
+    dst_task_desc->is_diff = src_task_desc->is_diff;
     dst_task_desc->mqtt_handle = src_task_desc->mqtt_handle;
     _download_deep_copy_base(sysdep, src_task_desc->product_key, &(dst_task_desc->product_key));
     _download_deep_copy_base(sysdep, src_task_desc->device_name, &(dst_task_desc->device_name));
@@ -913,29 +1533,3 @@ static int32_t _ota_subscribe(core_mqtt_handle_t *mqtt_handle, void *ota_handle)
     return res;
 }
 
-static int32_t _ota_parse_json(aiot_sysdep_portfile_t *sysdep, void *input, uint32_t input_len, char *key_word,
-                               char **out)
-{
-    int32_t res = STATE_SUCCESS;
-    char *value = NULL, *buffer = NULL;
-    uint32_t value_len = 0, buffer_len = 0;
-
-    res = core_json_value((const char *)input, input_len, key_word, strlen(key_word), &value, &value_len);
-    if (res != STATE_SUCCESS) {
-        goto error_exit;
-    }
-
-    buffer_len = value_len + 1;
-    buffer = sysdep->core_sysdep_malloc(buffer_len, OTA_MODULE_NAME);
-    if (NULL == buffer) {
-        goto error_exit;
-    }
-    memset(buffer, 0, buffer_len);
-    memcpy(buffer, value, value_len);
-    *out = buffer;
-    return res;
-
-error_exit:
-    return STATE_OTA_PARSE_JSON_ERROR;
-}
-
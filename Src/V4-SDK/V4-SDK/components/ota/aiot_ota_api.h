@@ -80,6 +80,12 @@ typedef struct {
      */
     char       *version;
     void       *mqtt_handle;
+
+    /**
+     * @brief 为1时表示url指向的是相对当前运行固件的差分包, size_total和expect_digest描述的是差分包本身
+     *
+     */
+    uint8_t     is_diff;
 } aiot_download_task_desc_t;
 
 /**
@@ -129,6 +135,57 @@ typedef struct {
 typedef void (* aiot_download_recv_handler_t)(void *handle, int32_t percent, const aiot_download_recv_t *packet,
         void *userdata);
 
+/**
+ * @brief 差分升级时读取当前运行固件的回调函数
+ *
+ * @details
+ *
+ * 从当前运行固件的offset处读取len字节到buffer中, 返回实际读取的字节数, 出错时返回负数
+ *
+ */
+typedef int32_t (* aiot_download_delta_read_handler_t)(void *handle, uint32_t offset, uint8_t *buffer, uint32_t len,
+        void *userdata);
+
+/**
+ * @brief 将固件数据写入flash的回调函数, 在用户调用 @ref aiot_download_write_process 的任务中执行
+ *
+ * @details
+ *
+ * offset为数据在固件中的偏移, 返回 @ref STATE_SUCCESS 表示写入成功, 返回负数表示写入失败
+ *
+ */
+typedef int32_t (* aiot_download_writer_handler_t)(void *handle, uint32_t offset, uint8_t *buffer, uint32_t len,
+        void *userdata);
+
+/**
+ * @brief 断点记录中序列化digest上下文的最大长度
+ *
+ */
+#define AIOT_DOWNLOAD_DIGEST_CTX_MAX_LEN              (128)
+
+/**
+ * @brief 下载断点记录, 包含已下载的字节数和序列化后的digest计算上下文
+ *
+ * @details
+ *
+ * 用户将其原样保存到掉电不丢失的存储中, 设备重启后通过 @ref AIOT_DLOPT_CHECKPOINT 恢复, 即可从断点处继续下载和计算digest
+ *
+ */
+typedef struct {
+    uint32_t    size_fetched;
+    uint8_t     digest_method;
+    char        expect_digest[65];
+    uint32_t    digest_ctx_len;
+    uint8_t     digest_ctx[AIOT_DOWNLOAD_DIGEST_CTX_MAX_LEN];
+} aiot_download_checkpoint_t;
+
+/**
+ * @brief 下载进度达到一个断点时触发的回调函数, 用户应在其中保存断点记录
+ *
+ */
+typedef void (* aiot_download_checkpoint_handler_t)(void *handle, const aiot_download_checkpoint_t *checkpoint,
+        void *userdata);
+
 /**
  * @brief 与云端约定的OTA过程中的错误码, 用户上报给云端时使用
  *
@@ -278,6 +335,88 @@ typedef enum {
      *
      **/
     AIOT_DLOPT_BODY_BUFFER_MAX_LEN,
+
+    /**
+     * @brief 设置分段下载时每个HTTP范围请求的长度
+     *
+     * @details
+     *
+     * 设置为非0值后, 固件按该长度分段请求, 每收完一段即触发一次 @ref AIOT_DLOPT_CHECKPOINT_HANDLER 回调.
+     * 网络中断时最多损失一段的数据, 默认值为0, 即一次请求剩余的全部内容
+     *
+     * 数据类型: (uint32_t *)
+     **/
+    AIOT_DLOPT_SEGMENT_SIZE,
+
+    /**
+     * @brief 设置保存下载断点的回调函数
+     *
+     * @details
+     *
+     * 每收完一个分段, 或者下载过程中网络出错时, SDK通过该回调给出当前的断点记录 @ref aiot_download_checkpoint_t
+     *
+     * 数据类型: (aiot_download_checkpoint_handler_t)
+     **/
+    AIOT_DLOPT_CHECKPOINT_HANDLER,
+
+    /**
+     * @brief 从之前保存的断点记录恢复下载进度
+     *
+     * @details
+     *
+     * 必须在 @ref AIOT_DLOPT_TASK_DESC 之后设置, 断点记录中的digest方法和期望的digest必须与当前任务一致
+     *
+     * 数据类型: (aiot_download_checkpoint_t *)
+     **/
+    AIOT_DLOPT_CHECKPOINT,
+
+    /**
+     * @brief 设置差分升级时读取当前运行固件的回调函数
+     *
+     * @details
+     *
+     * 任务描述中is_diff为1时必须设置. SDK边下载差分包边还原出新固件, 通过 @ref AIOT_DLOPT_RECV_HANDLER
+     * 回调给用户的是还原后的新固件数据, 下载完成后会校验新固件的SHA256. 差分下载不支持通过 @ref AIOT_DLOPT_CHECKPOINT 恢复
+     *
+     * 数据类型: (aiot_download_delta_read_handler_t)
+     **/
+    AIOT_DLOPT_DELTA_READ_HANDLER,
+
+    /**
+     * @brief 设置写flash的回调函数, 启用下载与写flash的流水线
+     *
+     * @details
+     *
+     * 设置后, 下载到的固件数据被拷贝到若干个固定长度的缓冲区中, 由用户在另一个任务中循环调用
+     * @ref aiot_download_write_process 执行该回调写入flash, 擦写flash的耗时不再阻塞网络接收.
+     * 所有缓冲区都未写完时, @ref aiot_download_recv 不读取网络并返回 @ref STATE_DOWNLOAD_WRITER_BUSY.
+     * 设置后固件数据只交给该回调, 不再传给 @ref AIOT_DLOPT_RECV_HANDLER
+     *
+     * 数据类型: (aiot_download_writer_handler_t)
+     **/
+    AIOT_DLOPT_WRITER_HANDLER,
+
+    /**
+     * @brief 写flash流水线中每个缓冲区的长度, 建议设置为flash扇区长度
+     *
+     * @details
+     *
+     * 默认值为 @ref AIOT_DOWNLOAD_DEFAULT_WRITER_BUFFER_LEN, 必须在开始下载前设置
+     *
+     * 数据类型: (uint32_t *)
+     **/
+    AIOT_DLOPT_WRITER_BUFFER_LEN,
+
+    /**
+     * @brief 写flash流水线中缓冲区的个数, 不小于2
+     *
+     * @details
+     *
+     * 默认值为 @ref AIOT_DOWNLOAD_DEFAULT_WRITER_BUFFER_NUM, 必须在开始下载前设置
+     *
+     * 数据类型: (uint32_t *)
+     **/
+    AIOT_DLOPT_WRITER_BUFFER_NUM,
     AIOT_DLOPT_MAX
 } aiot_download_option_t;
 
@@ -384,11 +523,27 @@ int32_t aiot_download_deinit(void **handle);
  *
  * @return int32_t
  * @retval STATE_DOWNLOAD_RECV_HANDLE_IS_NULL 收包时候的handle为空
- * @retval STATE_DOWNLOAD_FINISHED 整个固件包下载完成
+ * @retval STATE_DOWNLOAD_FINISHED 整个固件包下载完成, 启用写flash流水线时表示数据也已全部写入flash
+ * @retval STATE_DOWNLOAD_WRITER_BUSY 写flash流水线的缓冲区已满, 本次未读取网络
+ * @retval STATE_DOWNLOAD_WRITER_FAILED 写flash回调返回失败
  *
  */
 int32_t aiot_download_recv(void *handle); /* 返回条件: 网络出错 | 校验出错 | 读到EOF | buf填满 */
 
+/**
+ * @brief 将一个已填满的缓冲区写入flash, 用户需要在与 @ref aiot_download_recv 不同的任务中循环调用
+ *
+ * @param[in] handle download句柄
+ *
+ * @return int32_t
+ * @retval STATE_SUCCESS 写入了一个缓冲区
+ * @retval STATE_DOWNLOAD_WRITER_IDLE 当前没有待写入的数据
+ * @retval STATE_DOWNLOAD_WRITER_FAILED 写flash回调返回失败
+ * @retval STATE_DOWNLOAD_RECV_HANDLE_IS_NULL handle为空
+ *
+ */
+int32_t aiot_download_write_process(void *handle);
+
 /**
  * @brief 设置download句柄参数
  *
@@ -461,6 +616,12 @@ typedef struct {                                        /* 处理本地下载的
     aiot_sysdep_portfile_t             *sysdep;
     uint32_t                           range_start;
     uint32_t                           range_end;
+    uint32_t                           segment_size;
+    aiot_download_checkpoint_handler_t checkpoint_handler;
+    aiot_download_delta_read_handler_t delta_read_handler;
+    aiot_download_writer_handler_t     writer_handler;
+    uint32_t                           writer_buffer_len;
+    uint32_t                           writer_buffer_num;
 
     /*---- 以上都是用户在API可配 ----*/
     /*---- 以下都是downloader内部使用, 用户无感知 ----*/
@@ -468,8 +629,19 @@ typedef struct {                                        /* 处理本地下载的
     uint8_t         download_status;
     void            *http_handle;
     uint32_t        size_fetched;
+    uint32_t        segment_end;
+    uint8_t         segment_done;
+    uint32_t        status_code;
+    uint32_t        skip_len;
     int32_t         percent;
     void            *digest_ctx;
+    void            *delta_ctx;
+    void            *writer_slots;
+    uint32_t        writer_fill_idx;
+    uint32_t        writer_write_idx;
+    uint32_t        writer_offset;
+    int32_t         writer_res;
+    void            *writer_mutex;
     void            *data_mutex;
     void            *recv_mutex;
 } download_handle_t;
@@ -487,6 +659,24 @@ typedef struct {                                        /* 处理本地下载的
  */
 #define AIOT_DOWNLOAD_DEFAULT_TIMEOUT_MS              (5 * 1000)
 
+/**
+ * @brief 写flash流水线中默认的缓冲区长度
+ *
+ */
+#define AIOT_DOWNLOAD_DEFAULT_WRITER_BUFFER_LEN       (4 * 1024)
+
+/**
+ * @brief 写flash流水线中默认的缓冲区个数
+ *
+ */
+#define AIOT_DOWNLOAD_DEFAULT_WRITER_BUFFER_NUM       (2)
+
+/**
+ * @brief 下载任务等待写flash任务腾出缓冲区的最长时间
+ *
+ */
+#define AIOT_DOWNLOAD_DEFAULT_WRITER_TIMEOUT_MS       (10 * 1000)
+
 
 /**
  * @brief OTA模块的状态码基准值
@@ -696,6 +886,64 @@ typedef struct {                                        /* 处理本地下载的
  */
 #define STATE_DOWNLOAD_FINISHED                         (STATE_OTA_BASE - 0x001F)
 
+/**
+ * @brief 断点记录与当前下载任务不匹配, 无法从该断点恢复
+ *
+ * @details
+ *
+ * digest方法或者期望的digest与当前任务不一致, 或者断点记录中的数据已损坏
+ *
+ */
+#define STATE_DOWNLOAD_CHECKPOINT_MISMATCH              (STATE_OTA_BASE - 0x0020)
+
+/**
+ * @brief 一个分段下载完成, 已保存断点, 打印出有关日志
+ *
+ */
+#define STATE_DOWNLOAD_SEGMENT_FINISHED                 (STATE_OTA_BASE - 0x0021)
+
+/**
+ * @brief 差分包格式错误, 或者与当前运行的固件不匹配
+ *
+ */
+#define STATE_DOWNLOAD_DELTA_PATCH_INVALID              (STATE_OTA_BASE - 0x0022)
+
+/**
+ * @brief 差分升级时通过 @ref AIOT_DLOPT_DELTA_READ_HANDLER 读取当前运行固件失败
+ *
+ */
+#define STATE_DOWNLOAD_DELTA_READ_FAILED                (STATE_OTA_BASE - 0x0023)
+
+/**
+ * @brief 差分还原出的新固件的SHA256与差分包中记录的不一致
+ *
+ */
+#define STATE_DOWNLOAD_DELTA_DIGEST_MISMATCH            (STATE_OTA_BASE - 0x0024)
+
+/**
+ * @brief 写flash流水线的缓冲区已满, 本次没有读取网络数据, 用户稍后再调用 @ref aiot_download_recv 即可
+ *
+ */
+#define STATE_DOWNLOAD_WRITER_BUSY                      (STATE_OTA_BASE - 0x0025)
+
+/**
+ * @brief 当前没有待写入flash的数据, 写flash任务可以休眠一段时间后再调用 @ref aiot_download_write_process
+ *
+ */
+#define STATE_DOWNLOAD_WRITER_IDLE                      (STATE_OTA_BASE - 0x0026)
+
+/**
+ * @brief 写flash回调返回失败, 下载终止
+ *
+ */
+#define STATE_DOWNLOAD_WRITER_FAILED                    (STATE_OTA_BASE - 0x0027)
+
+/**
+ * @brief 等待写flash任务腾出缓冲区超时, 请确认已在另一个任务中循环调用 @ref aiot_download_write_process
+ *
+ */
+#define STATE_DOWNLOAD_WRITER_TIMEOUT                   (STATE_OTA_BASE - 0x0028)
+
 #if defined(__cplusplus)
 }
 #endif
@@ -15,12 +15,16 @@ extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
 
 int32_t demo_state_logcb(int32_t code, char *message)
 {
-    if (STATE_HTTP_LOG_RECV_CONTENT != code) {
-        printf("%s", message);
-    }
+    printf("%s", message);
     return 0;
 }
 
+/* 下载的固件内容不打印, 在格式化之前就丢弃 */
+int32_t demo_state_logfilter(int32_t code)
+{
+    return (STATE_HTTP_LOG_RECV_CONTENT != code) ? 1 : 0;
+}
+
 void demo_mqtt_event_handler(void *handle, const aiot_mqtt_event_t *const event, void *userdata)
 {
     switch (event->type) {
@@ -164,6 +168,7 @@ int main(int argc, char *argv[])
 
     aiot_sysdep_set_portfile(&g_aiot_sysdep_portfile);
     aiot_state_set_logcb(demo_state_logcb);
+    aiot_state_set_logfilter(demo_state_logfilter);
 
     mqtt_handle = aiot_mqtt_init();
     if (mqtt_handle == NULL) {
@@ -16,12 +16,16 @@ void *g_dl_handle = NULL;
 extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
 int32_t demo_state_logcb(int32_t code, char *message)
 {
-    if (STATE_HTTP_LOG_RECV_CONTENT != code) {
-        printf("%s", message);
-    }
+    printf("%s", message);
     return 0;
 }
 
+/* 下载的固件内容不打印, 在格式化之前就丢弃 */
+int32_t demo_state_logfilter(int32_t code)
+{
+    return (STATE_HTTP_LOG_RECV_CONTENT != code) ? 1 : 0;
+}
+
 void demo_mqtt_event_handler(void *handle, const aiot_mqtt_event_t *const event, void *userdata)
 {
     switch (event->type) {
@@ -92,6 +96,10 @@ void user_download_recv_handler(void *handle, int32_t percent, const aiot_downlo
      *       将错误信息上报给云平台.可以在把错误信息记录到一个全局变量,下次再进入这个函数时读取一下,
      *       用以决定是否继续烧写等策略
      *
+     *       擦除flash耗时较长时, 在这里烧写会阻塞网络接收. 此时建议通过 AIOT_DLOPT_WRITER_HANDLER 设置写flash回调,
+     *       并在另一个任务中循环调用 aiot_download_write_process, 由SDK在两个任务之间通过缓冲区传递固件数据.
+     *       设置后固件数据只交给写flash回调, 不再进入本函数
+     *
      */
 
     if (percent == 100) {
@@ -188,6 +196,7 @@ int main(int argc, char *argv[])
 
     aiot_sysdep_set_portfile(&g_aiot_sysdep_portfile);
     aiot_state_set_logcb(demo_state_logcb);
+    aiot_state_set_logfilter(demo_state_logfilter);
 
     mqtt_handle = aiot_mqtt_init();
     if (mqtt_handle == NULL) {
@@ -45,13 +45,17 @@ static pthread_t g_download_thread;     /* 用于HTTP的固件下载线程 */
 /* 日志回调函数, SDK的日志会从这里输出 */
 int32_t demo_state_logcb(int32_t code, char *message)
 {
-    /* 下载固件的时候会有大量的HTTP收包日志, 通过code筛选出来关闭 */
-    if (STATE_HTTP_LOG_RECV_CONTENT != code) {
-        printf("%s", message);
-    }
+    printf("%s", message);
     return 0;
 }
 
+/* 日志过滤函数, 在SDK格式化日志之前调用, 返回0的日志直接丢弃 */
+int32_t demo_state_logfilter(int32_t code)
+{
+    /* 下载固件的时候会有大量的HTTP收包日志, 通过code筛选出来关闭 */
+    return (STATE_HTTP_LOG_RECV_CONTENT != code) ? 1 : 0;
+}
+
 /* 下载收包回调, 用户调用 aiot_download_recv() 后, SDK收到数据会进入这个函数, 把下载到的数据交给用户 */
 /* TODO: 一般来说, 设备升级时, 会在这个回调中, 把下载到的数据写到Flash上 */
 void demo_download_recv_handler(void *handle, int32_t percent, const aiot_download_recv_t *packet, void *userdata)
@@ -327,6 +331,7 @@ int main(int argc, char *argv[])
 
     /* 配置SDK的日志输出 */
     aiot_state_set_logcb(demo_state_logcb);
+    aiot_state_set_logfilter(demo_state_logfilter);
 
     /* 创建SDK的安全凭据, 用于建立TLS连接 */
     memset(&cred, 0, sizeof(aiot_sysdep_network_cred_t));
@@ -0,0 +1,195 @@
+/**
+ * @file ota_delta.c
+ * @brief 差分升级的流式还原实现, 边下载差分包边还原出新固件, 内存占用与固件大小无关
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (C) 2015-2018 Alibaba Group Holding Limited
+ *
+ */
+
+#include "ota_delta.h"
+#include "aiot_state_api.h"
+#include "aiot_ota_api.h"
+
+static uint32_t _ota_delta_get_uint32(const uint8_t *input)
+{
+    return (uint32_t)input[0] | ((uint32_t)input[1] << 8) | ((uint32_t)input[2] << 16) | ((uint32_t)input[3] << 24);
+}
+
+static int32_t _ota_delta_output(ota_delta_ctx_t *ctx, uint8_t *buffer, uint32_t len)
+{
+    int32_t res = 0;
+
+    core_sha256_update(&ctx->sha256_ctx, buffer, len);
+    ctx->written += len;
+    res = ctx->write_new(buffer, len, ctx->userdata);
+
+    return (res < 0) ? res : STATE_SUCCESS;
+}
+
+static int32_t _ota_delta_copy(ota_delta_ctx_t *ctx, uint32_t old_offset, uint32_t len)
+{
+    int32_t res = 0;
+    uint32_t chunk_len = 0;
+
+    if (old_offset > ctx->old_size || len > ctx->old_size - old_offset || len > ctx->new_size - ctx->written) {
+        return STATE_DOWNLOAD_DELTA_PATCH_INVALID;
+    }
+
+    while (len > 0) {
+        chunk_len = (len < OTA_DELTA_COPY_BUFFER_LEN) ? len : OTA_DELTA_COPY_BUFFER_LEN;
+        res = ctx->read_old(old_offset, ctx->copy_buffer, chunk_len, ctx->userdata);
+        if (res != (int32_t)chunk_len) {
+            return STATE_DOWNLOAD_DELTA_READ_FAILED;
+        }
+        res = _ota_delta_output(ctx, ctx->copy_buffer, chunk_len);
+        if (res != STATE_SUCCESS) {
+            return res;
+        }
+        old_offset += chunk_len;
+        len -= chunk_len;
+    }
+
+    return STATE_SUCCESS;
+}
+
+static int32_t _ota_delta_parse_header(ota_delta_ctx_t *ctx)
+{
+    if (memcmp(ctx->field, OTA_DELTA_MAGIC, strlen(OTA_DELTA_MAGIC)) != 0 || ctx->field[4] != OTA_DELTA_VERSION) {
+        return STATE_DOWNLOAD_DELTA_PATCH_INVALID;
+    }
+    ctx->old_size = _ota_delta_get_uint32(&ctx->field[8]);
+    ctx->new_size = _ota_delta_get_uint32(&ctx->field[12]);
+    memcpy(ctx->new_digest, &ctx->field[16], sizeof(ctx->new_digest));
+
+    return STATE_SUCCESS;
+}
+
+/* 解析一个完整的op字段, 返回STATE_SUCCESS表示已处理 */
+static int32_t _ota_delta_parse_op(ota_delta_ctx_t *ctx)
+{
+    int32_t res = STATE_SUCCESS;
+
+    if (ctx->field[0] == OTA_DELTA_OP_COPY) {
+        res = _ota_delta_copy(ctx, _ota_delta_get_uint32(&ctx->field[1]), _ota_delta_get_uint32(&ctx->field[5]));
+        if (res != STATE_SUCCESS) {
+            return res;
+        }
+    } else if (ctx->field[0] == OTA_DELTA_OP_INSERT) {
+        ctx->insert_len = _ota_delta_get_uint32(&ctx->field[1]);
+        if (ctx->insert_len > ctx->new_size - ctx->written) {
+            return STATE_DOWNLOAD_DELTA_PATCH_INVALID;
+        }
+        if (ctx->insert_len > 0) {
+            ctx->state = OTA_DELTA_STATE_INSERT;
+        }
+    } else {
+        return STATE_DOWNLOAD_DELTA_PATCH_INVALID;
+    }
+
+    if (ctx->written == ctx->new_size && ctx->state != OTA_DELTA_STATE_INSERT) {
+        ctx->state = OTA_DELTA_STATE_FINISHED;
+    }
+    return STATE_SUCCESS;
+}
+
+static uint32_t _ota_delta_field_expect_len(ota_delta_ctx_t *ctx)
+{
+    if (ctx->state == OTA_DELTA_STATE_HEADER) {
+        return OTA_DELTA_HEADER_LEN;
+    }
+    if (ctx->field_len == 0) {
+        return 1;
+    }
+    return (ctx->field[0] == OTA_DELTA_OP_COPY) ? 9 : 5;
+}
+
+void ota_delta_init(ota_delta_ctx_t *ctx, ota_delta_read_t read_old, ota_delta_write_t write_new, void *userdata)
+{
+    memset(ctx, 0, sizeof(ota_delta_ctx_t));
+    ctx->state = OTA_DELTA_STATE_HEADER;
+    ctx->read_old = read_old;
+    ctx->write_new = write_new;
+    ctx->userdata = userdata;
+    core_sha256_init(&ctx->sha256_ctx);
+    core_sha256_starts(&ctx->sha256_ctx);
+}
+
+int32_t ota_delta_update(ota_delta_ctx_t *ctx, uint8_t *patch, uint32_t patch_len)
+{
+    int32_t res = STATE_SUCCESS;
+    uint32_t idx = 0, copy_len = 0, expect_len = 0;
+
+    while (idx < patch_len) {
+        switch (ctx->state) {
+            case OTA_DELTA_STATE_HEADER:
+            case OTA_DELTA_STATE_OP: {
+                /* 字段可能跨越两次输入, 先攒够再解析 */
+                expect_len = _ota_delta_field_expect_len(ctx);
+                while (ctx->field_len < expect_len && idx < patch_len) {
+                    ctx->field[ctx->field_len++] = patch[idx++];
+                    expect_len = _ota_delta_field_expect_len(ctx);
+                }
+                if (ctx->field_len < expect_len) {
+                    break;
+                }
+
+                if (ctx->state == OTA_DELTA_STATE_HEADER) {
+                    res = _ota_delta_parse_header(ctx);
+                    ctx->state = (ctx->new_size == 0) ? OTA_DELTA_STATE_FINISHED : OTA_DELTA_STATE_OP;
+                } else {
+                    res = _ota_delta_parse_op(ctx);
+                }
+                ctx->field_len = 0;
+                if (res != STATE_SUCCESS) {
+                    ctx->state = OTA_DELTA_STATE_ERROR;
+                    return res;
+                }
+            }
+            break;
+            case OTA_DELTA_STATE_INSERT: {
+                /* 插入的数据直接从输入buffer输出, 不做拷贝 */
+                copy_len = patch_len - idx;
+                copy_len = (copy_len < ctx->insert_len) ? copy_len : ctx->insert_len;
+                res = _ota_delta_output(ctx, &patch[idx], copy_len);
+                if (res != STATE_SUCCESS) {
+                    ctx->state = OTA_DELTA_STATE_ERROR;
+                    return res;
+                }
+                idx += copy_len;
+                ctx->insert_len -= copy_len;
+                if (ctx->insert_len == 0) {
+                    ctx->state = (ctx->written == ctx->new_size) ? OTA_DELTA_STATE_FINISHED : OTA_DELTA_STATE_OP;
+                }
+            }
+            break;
+            default: {
+                ctx->state = OTA_DELTA_STATE_ERROR;
+                return STATE_DOWNLOAD_DELTA_PATCH_INVALID;
+            }
+        }
+    }
+
+    return STATE_SUCCESS;
+}
+
+int32_t ota_delta_finish(ota_delta_ctx_t *ctx)
+{
+    uint8_t output[32] = {0};
+
+    if (ctx->state != OTA_DELTA_STATE_FINISHED || ctx->written != ctx->new_size) {
+        return STATE_DOWNLOAD_DELTA_PATCH_INVALID;
+    }
+    core_sha256_finish(&ctx->sha256_ctx, output);
+    if (memcmp(output, ctx->new_digest, sizeof(output)) != 0) {
+        return STATE_DOWNLOAD_DELTA_DIGEST_MISMATCH;
+    }
+
+    return STATE_SUCCESS;
+}
+
+void ota_delta_free(ota_delta_ctx_t *ctx)
+{
+    core_sha256_free(&ctx->sha256_ctx);
+}
+
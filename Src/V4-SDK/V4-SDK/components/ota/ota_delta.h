@@ -0,0 +1,89 @@
+#ifndef _OTA_DELTA_H_
+#define _OTA_DELTA_H_
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <string.h>
+#include "core_sha256.h"
+
+/*
+ * 差分包格式, 所有整数均为小端序:
+ *
+ * | magic "ADIF"(4) | version(1) | reserved(3) | old_size(4) | new_size(4) | new_sha256(32) |
+ * | op(1) | ... | op(1) | ...
+ *
+ * op = OTA_DELTA_OP_COPY:   | old_offset(4) | len(4) |, 从旧固件的old_offset处拷贝len字节
+ * op = OTA_DELTA_OP_INSERT: | len(4) | data(len) |, 直接输出差分包中的len字节
+ *
+ * 输出的字节数达到new_size时差分包结束
+ */
+#define OTA_DELTA_MAGIC                 "ADIF"
+#define OTA_DELTA_VERSION               (1)
+#define OTA_DELTA_HEADER_LEN            (48)
+#define OTA_DELTA_OP_COPY               (0x01)
+#define OTA_DELTA_OP_INSERT             (0x02)
+#define OTA_DELTA_COPY_BUFFER_LEN       (256)
+
+typedef enum {
+    OTA_DELTA_STATE_HEADER,
+    OTA_DELTA_STATE_OP,
+    OTA_DELTA_STATE_INSERT,
+    OTA_DELTA_STATE_FINISHED,
+    OTA_DELTA_STATE_ERROR,
+} ota_delta_state_t;
+
+/* 读取旧固件的回调, 返回读到的字节数, 出错返回负数 */
+typedef int32_t (*ota_delta_read_t)(uint32_t offset, uint8_t *buffer, uint32_t len, void *userdata);
+/* 输出新固件的回调, 返回负数表示写入失败, 还原随即中止 */
+typedef int32_t (*ota_delta_write_t)(uint8_t *buffer, uint32_t len, void *userdata);
+
+typedef struct {
+    uint8_t                 state;
+    uint8_t                 field[OTA_DELTA_HEADER_LEN];
+    uint32_t                field_len;
+    uint32_t                old_size;
+    uint32_t                new_size;
+    uint8_t                 new_digest[32];
+    uint32_t                insert_len;
+    uint32_t                written;
+    core_sha256_context_t   sha256_ctx;
+    ota_delta_read_t        read_old;
+    ota_delta_write_t       write_new;
+    void                    *userdata;
+    uint8_t                 copy_buffer[OTA_DELTA_COPY_BUFFER_LEN];
+} ota_delta_ctx_t;
+
+/**
+ * @brief 初始化差分还原上下文
+ */
+void ota_delta_init(ota_delta_ctx_t *ctx, ota_delta_read_t read_old, ota_delta_write_t write_new, void *userdata);
+
+/**
+ * @brief 输入一段差分包数据, 长度任意, 还原出的新固件数据通过write_new回调输出
+ *
+ * @return STATE_SUCCESS, 或者 STATE_DOWNLOAD_DELTA_PATCH_INVALID / STATE_DOWNLOAD_DELTA_READ_FAILED,
+ *         write_new返回负数时原样返回该值
+ */
+int32_t ota_delta_update(ota_delta_ctx_t *ctx, uint8_t *patch, uint32_t patch_len);
+
+/**
+ * @brief 差分包输入完毕后调用, 校验还原出的新固件的长度和SHA256
+ *
+ * @return STATE_SUCCESS, 或者 STATE_DOWNLOAD_DELTA_PATCH_INVALID / STATE_DOWNLOAD_DELTA_DIGEST_MISMATCH
+ */
+int32_t ota_delta_finish(ota_delta_ctx_t *ctx);
+
+/**
+ * @brief 释放差分还原上下文
+ */
+void ota_delta_free(ota_delta_ctx_t *ctx);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
+
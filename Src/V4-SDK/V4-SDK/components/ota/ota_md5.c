@@ -62,6 +62,87 @@ int32_t utils_md5_starts(utils_md5_context_t *ctx)
     return (0);
 }
 
+#if defined(OTA_MD5_IMPL_COMPACT)
+static const uint32_t md5_t[64] = {
+    0xD76AA478, 0xE8C7B756, 0x242070DB, 0xC1BDCEEE,
+    0xF57C0FAF, 0x4787C62A, 0xA8304613, 0xFD469501,
+    0x698098D8, 0x8B44F7AF, 0xFFFF5BB1, 0x895CD7BE,
+    0x6B901122, 0xFD987193, 0xA679438E, 0x49B40821,
+    0xF61E2562, 0xC040B340, 0x265E5A51, 0xE9B6C7AA,
+    0xD62F105D, 0x02441453, 0xD8A1E681, 0xE7D3FBC8,
+    0x21E1CDE6, 0xC33707D6, 0xF4D50D87, 0x455A14ED,
+    0xA9E3E905, 0xFCEFA3F8, 0x676F02D9, 0x8D2A4C8A,
+    0xFFFA3942, 0x8771F681, 0x6D9D6122, 0xFDE5380C,
+    0xA4BEEA44, 0x4BDECFA9, 0xF6BB4B60, 0xBEBFBC70,
+    0x289B7EC6, 0xEAA127FA, 0xD4EF3085, 0x04881D05,
+    0xD9D4D039, 0xE6DB99E5, 0x1FA27CF8, 0xC4AC5665,
+    0xF4292244, 0x432AFF97, 0xAB9423A7, 0xFC93A039,
+    0x655B59C3, 0x8F0CCC92, 0xFFEFF47D, 0x85845DD1,
+    0x6FA87E4F, 0xFE2CE6E0, 0xA3014314, 0x4E0811A1,
+    0xF7537E82, 0xBD3AF235, 0x2AD7D2BB, 0xEB86D391,
+};
+
+static const uint8_t md5_s[16] = {
+    7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21
+};
+
+#define S(x,n) ((x << n) | ((x & 0xFFFFFFFF) >> (32 - n)))
+
+int32_t utils_internal_md5_process(utils_md5_context_t *ctx,
+                                   const unsigned char data[64])
+{
+    uint32_t X[16], A, B, C, D, f, k, temp;
+    uint32_t i;
+
+    for (i = 0; i < 16; i++) {
+        GET_UINT32_LE(X[i], data, 4 * i);
+    }
+
+    A = ctx->state[0];
+    B = ctx->state[1];
+    C = ctx->state[2];
+    D = ctx->state[3];
+
+    for (i = 0; i < 64; i++) {
+        switch (i >> 4) {
+            case 0: {
+                f = D ^ (B & (C ^ D));
+                k = i;
+            }
+            break;
+            case 1: {
+                f = C ^ (D & (B ^ C));
+                k = (5 * i + 1) & 0x0F;
+            }
+            break;
+            case 2: {
+                f = B ^ C ^ D;
+                k = (3 * i + 5) & 0x0F;
+            }
+            break;
+            default: {
+                f = C ^ (B | ~D);
+                k = (7 * i) & 0x0F;
+            }
+            break;
+        }
+
+        f += A + X[k] + md5_t[i];
+        temp = D;
+        D = C;
+        C = B;
+        B += S(f, md5_s[((i >> 4) << 2) | (i & 0x03)]);
+        A = temp;
+    }
+
+    ctx->state[0] += A;
+    ctx->state[1] += B;
+    ctx->state[2] += C;
+    ctx->state[3] += D;
+
+    return (0);
+}
+#else
 int32_t utils_internal_md5_process(utils_md5_context_t *ctx,
                                    const unsigned char data[64])
 {
@@ -187,6 +268,7 @@ int32_t utils_internal_md5_process(utils_md5_context_t *ctx,
 
     return (0);
 }
+#endif /* OTA_MD5_IMPL_COMPACT */
 
 /*
  * MD5 process buffer
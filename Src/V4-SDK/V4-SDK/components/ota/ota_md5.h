@@ -12,6 +12,10 @@ extern "C" {
 #include <stdint.h>
 #include <stddef.h>
 
+/*
+ * 默认使用完全展开的实现; 定义OTA_MD5_IMPL_COMPACT(例如在EXT_CFLAGS中)则改用循环实现, 代码更小, 速度较慢
+ */
+
 /**
  * \brief          MD5 context structure
  *
@@ -21,6 +21,7 @@ extern "C" {
 
 #define OTA_HTTPCLIENT_MAX_URL_LEN           (256)
 #define OTA_MAX_DIGIT_NUM_OF_UINT32          (20)
+#define OTA_JSON_TOKENS_NUM                  (48)
 
 typedef enum {
     DOWNLOAD_STATUS_START,
@@ -28,6 +29,23 @@ typedef enum {
     DOWNLOAD_STATUS_RENEWAL,
 } download_status_t;
 
+#define DOWNLOAD_WRITER_WAIT_INTERVAL_MS     (5)
+
+typedef enum {
+    DOWNLOAD_WRITER_SLOT_FREE,
+    DOWNLOAD_WRITER_SLOT_FILLING,
+    DOWNLOAD_WRITER_SLOT_FULL,
+    DOWNLOAD_WRITER_SLOT_WRITING,
+} download_writer_slot_state_t;
+
+/* 下载任务填充, 写flash任务消费的固定长度缓冲区 */
+typedef struct {
+    uint8_t     *buffer;
+    uint32_t    offset;
+    uint32_t    len;
+    uint8_t     state;
+} download_writer_slot_t;
+
 #if defined(__cplusplus)
 }
 #endif
@@ -1,5 +1,7 @@
+#include <stdlib.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <sys/time.h>
 #include "cu_test.h"
 #include "aiot_state_api.h"
 #include "aiot_sysdep_api.h"
@@ -9,6 +11,12 @@
 #include "aiot_ota_api.h"
 #include "aiot_http_api.h"
 #include "core_http.h"
+#include "core_sha256.h"
+#include "core_string.h"
+#include "ota_delta.h"
+#include "ota_md5.h"
+#include "digest_vectors.h"
+#include "ota_delta_gen.h"
 #define RUN_DOWNLOAD_DEMO
 
 int32_t core_sysdep_network_recv(void *handle, uint8_t *buffer, uint32_t len, uint32_t timeout_ms,
@@ -1898,6 +1906,821 @@ CASEs(COMPONENT_FOTA, case_09_aiot_download_report_progress_null_desc_fail)
     ASSERT_EQ(res, STATE_DOWNLOAD_REPORT_TASK_DESC_IS_NULL);
 }
 
+#define CASE_38_IMAGE_LEN           (100 * 1024 + 37)
+#define CASE_38_SEGMENT_LEN         (8 * 1024)
+
+typedef struct {
+    uint8_t image[CASE_38_IMAGE_LEN];
+    const uint8_t *content;
+    uint32_t content_len;
+    char request[512];
+    uint32_t request_len;
+    char response_header[256];
+    uint32_t response_header_len;
+    uint32_t response_header_pos;
+    uint32_t body_start;
+    uint32_t body_end;
+    uint32_t body_pos;
+    int32_t fail_after;
+    uint32_t connect_count;
+    uint32_t request_count;
+    uint8_t written[CASE_38_IMAGE_LEN];
+    uint32_t written_len;
+    aiot_download_checkpoint_t checkpoint;
+    uint32_t checkpoint_count;
+    uint32_t checkpoint_error_count;
+    uint32_t recv_delay_us;
+    uint8_t ignore_range;
+} case_38_server_t;
+
+static case_38_server_t case_38_server;
+static uint8_t case_38_socket;
+
+static void *case_38_network_init(void)
+{
+    case_38_server.connect_count++;
+    case_38_server.request_len = 0;
+    case_38_server.response_header_len = 0;
+    case_38_server.body_pos = case_38_server.body_end;
+    return &case_38_socket;
+}
+
+static int32_t case_38_network_setopt(void *handle, core_sysdep_network_option_t option, void *data)
+{
+    return STATE_SUCCESS;
+}
+
+static int32_t case_38_network_establish(void *handle)
+{
+    return STATE_SUCCESS;
+}
+
+static void case_38_prepare_response(void)
+{
+    uint32_t start = 0, end = case_38_server.content_len - 1;
+    char *range = strstr(case_38_server.request, "Range: bytes=");
+
+    if (range != NULL && case_38_server.ignore_range == 0) {
+        range += strlen("Range: bytes=");
+        start = strtoul(range, &range, 10);
+        if (*range == '-' && *(range + 1) >= '0' && *(range + 1) <= '9') {
+            end = strtoul(range + 1, NULL, 10);
+        }
+    }
+    if (end > case_38_server.content_len - 1) {
+        end = case_38_server.content_len - 1;
+    }
+
+    case_38_server.body_start = start;
+    case_38_server.body_pos = start;
+    case_38_server.body_end = end + 1;
+    case_38_server.response_header_pos = 0;
+    case_38_server.response_header_len = snprintf(case_38_server.response_header,
+                                         sizeof(case_38_server.response_header),
+                                         "HTTP/1.1 %s\r\nContent-Length: %u\r\n\r\n",
+                                         case_38_server.ignore_range ? "200 OK" : "206 Partial Content", end - start + 1);
+    case_38_server.request_count++;
+}
+
+static int32_t case_38_network_send(void *handle, uint8_t *buffer, uint32_t len, uint32_t timeout_ms,
+                                    core_sysdep_addr_t *addr)
+{
+    if (case_38_server.request_len + len >= sizeof(case_38_server.request)) {
+        return -1;
+    }
+    memcpy(&case_38_server.request[case_38_server.request_len], buffer, len);
+    case_38_server.request_len += len;
+    case_38_server.request[case_38_server.request_len] = '\0';
+    if (strstr(case_38_server.request, "\r\n\r\n") != NULL) {
+        case_38_prepare_response();
+        case_38_server.request_len = 0;
+    }
+    return len;
+}
+
+static int32_t case_38_network_recv(void *handle, uint8_t *buffer, uint32_t len, uint32_t timeout_ms,
+                                    core_sysdep_addr_t *addr)
+{
+    uint32_t copy_len = 0;
+
+    if (case_38_server.response_header_pos < case_38_server.response_header_len) {
+        copy_len = case_38_server.response_header_len - case_38_server.response_header_pos;
+        copy_len = (copy_len < len) ? copy_len : len;
+        memcpy(buffer, &case_38_server.response_header[case_38_server.response_header_pos], copy_len);
+        case_38_server.response_header_pos += copy_len;
+        return copy_len;
+    }
+
+    /* 在随机位置模拟断网 */
+    if (case_38_server.fail_after >= 0 && case_38_server.fail_after <= (int32_t)len) {
+        case_38_server.fail_after = -1;
+        return -1;
+    }
+
+    copy_len = case_38_server.body_end - case_38_server.body_pos;
+    copy_len = (copy_len < len) ? copy_len : len;
+    if (copy_len == 0) {
+        return 0;
+    }
+    if (case_38_server.fail_after >= 0) {
+        case_38_server.fail_after -= copy_len;
+    }
+    if (case_38_server.recv_delay_us > 0) {
+        usleep(case_38_server.recv_delay_us);
+    }
+    memcpy(buffer, &case_38_server.content[case_38_server.body_pos], copy_len);
+    case_38_server.body_pos += copy_len;
+    return copy_len;
+}
+
+static int32_t case_38_network_deinit(void **handle)
+{
+    *handle = NULL;
+    return STATE_SUCCESS;
+}
+
+static void case_38_download_recv_handler(void *handle, int32_t percent, const aiot_download_recv_t *packet,
+        void *userdata)
+{
+    memcpy(&case_38_server.written[case_38_server.written_len], packet->data.buffer, packet->data.len);
+    case_38_server.written_len += packet->data.len;
+}
+
+static void case_38_checkpoint_handler(void *handle, const aiot_download_checkpoint_t *checkpoint, void *userdata)
+{
+    /* 模拟写入flash: 固件数据与断点记录一起落盘 */
+    if (checkpoint->size_fetched != case_38_server.written_len) {
+        case_38_server.checkpoint_error_count++;
+    }
+    memcpy(&case_38_server.checkpoint, checkpoint, sizeof(aiot_download_checkpoint_t));
+    case_38_server.checkpoint_count++;
+}
+
+CASE(COMPONENT_FOTA, case_38_aiot_download_resume_from_checkpoint_after_reboot)
+{
+    extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
+    aiot_sysdep_portfile_t portfile_backup = g_aiot_sysdep_portfile;
+    aiot_download_task_desc_t task_desc = {0};
+    uint8_t digest[32] = {0};
+    char digest_string[65] = {0};
+    uint32_t segment_size = CASE_38_SEGMENT_LEN;
+    uint32_t idx = 0, reboot_count = 0, loop_count = 0;
+    int32_t res = STATE_SUCCESS;
+
+    aiot_sysdep_set_portfile(&g_aiot_sysdep_portfile);
+    g_aiot_sysdep_portfile.core_sysdep_network_init = case_38_network_init;
+    g_aiot_sysdep_portfile.core_sysdep_network_setopt = case_38_network_setopt;
+    g_aiot_sysdep_portfile.core_sysdep_network_establish = case_38_network_establish;
+    g_aiot_sysdep_portfile.core_sysdep_network_send = case_38_network_send;
+    g_aiot_sysdep_portfile.core_sysdep_network_recv = case_38_network_recv;
+    g_aiot_sysdep_portfile.core_sysdep_network_deinit = case_38_network_deinit;
+
+    memset(&case_38_server, 0, sizeof(case_38_server_t));
+    srand(38);
+    for (idx = 0; idx < CASE_38_IMAGE_LEN; idx++) {
+        case_38_server.image[idx] = (uint8_t)rand();
+    }
+    case_38_server.content = case_38_server.image;
+    case_38_server.content_len = CASE_38_IMAGE_LEN;
+    core_sha256(case_38_server.image, CASE_38_IMAGE_LEN, digest);
+    core_hex2str(digest, sizeof(digest), digest_string, 1);
+
+    task_desc.product_key = "pk";
+    task_desc.device_name = "dn";
+    task_desc.url = "https://ota.example.com/firmware.bin";
+    task_desc.size_total = CASE_38_IMAGE_LEN;
+    task_desc.digest_method = AIOT_OTA_DIGEST_SHA256;
+    task_desc.expect_digest = digest_string;
+    task_desc.version = "1.0.1";
+
+    /* 每次循环模拟一次设备上电, 从上次保存的断点继续下载, 直到下载完成 */
+    while (res != STATE_DOWNLOAD_FINISHED && reboot_count < 64) {
+        void *download_handle = aiot_download_init();
+        ASSERT_NOT_NULL(download_handle);
+        aiot_download_setopt(download_handle, AIOT_DLOPT_TASK_DESC, &task_desc);
+        aiot_download_setopt(download_handle, AIOT_DLOPT_SEGMENT_SIZE, &segment_size);
+        aiot_download_setopt(download_handle, AIOT_DLOPT_RECV_HANDLER, case_38_download_recv_handler);
+        aiot_download_setopt(download_handle, AIOT_DLOPT_CHECKPOINT_HANDLER, case_38_checkpoint_handler);
+        if (case_38_server.checkpoint_count > 0) {
+            res = aiot_download_setopt(download_handle, AIOT_DLOPT_CHECKPOINT, &case_38_server.checkpoint);
+            ASSERT_EQ(res, STATE_SUCCESS);
+        }
+        /* 重启后丢弃最后一个断点之后已写入的数据 */
+        case_38_server.written_len = case_38_server.checkpoint.size_fetched;
+        case_38_server.fail_after = rand() % (3 * CASE_38_SEGMENT_LEN);
+
+        for (loop_count = 0; loop_count < 1024; loop_count++) {
+            res = aiot_download_recv(download_handle);
+            if (res == STATE_DOWNLOAD_FINISHED || res == STATE_OTA_DIGEST_MISMATCH) {
+                break;
+            }
+            /* 断网后模拟设备重启 */
+            if (case_38_server.fail_after < 0) {
+                break;
+            }
+        }
+        aiot_download_deinit(&download_handle);
+        reboot_count++;
+    }
+
+    g_aiot_sysdep_portfile = portfile_backup;
+
+    printf("case 38: %d reboots, %d connects, %d requests, %d checkpoints\r\n", reboot_count,
+           case_38_server.connect_count, case_38_server.request_count, case_38_server.checkpoint_count);
+    ASSERT_EQ(res, STATE_DOWNLOAD_FINISHED);
+    ASSERT_EQ(case_38_server.checkpoint_error_count, 0);
+    ASSERT_GT(reboot_count, 1);
+    ASSERT_EQ(case_38_server.written_len, CASE_38_IMAGE_LEN);
+    ASSERT_EQ(memcmp(case_38_server.written, case_38_server.image, CASE_38_IMAGE_LEN), 0);
+    /* 同一连接上复用了多个分段请求 */
+    ASSERT_GT(case_38_server.request_count, case_38_server.connect_count);
+}
+
+CASE(COMPONENT_FOTA, case_39_aiot_download_checkpoint_mismatch)
+{
+    extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
+    aiot_download_task_desc_t task_desc = {0};
+    aiot_download_checkpoint_t checkpoint = {0};
+    void *download_handle = NULL;
+    int32_t res = STATE_SUCCESS;
+
+    aiot_sysdep_set_portfile(&g_aiot_sysdep_portfile);
+    download_handle = aiot_download_init();
+
+    res = aiot_download_setopt(download_handle, AIOT_DLOPT_CHECKPOINT, &checkpoint);
+    ASSERT_EQ(res, STATE_DOWNLOAD_REQUEST_TASK_DESC_IS_NULL);
+
+    task_desc.product_key = "pk";
+    task_desc.device_name = "dn";
+    task_desc.url = "https://ota.example.com/firmware.bin";
+    task_desc.size_total = 1024;
+    task_desc.digest_method = AIOT_OTA_DIGEST_MD5;
+    task_desc.expect_digest = "0123456789abcdef0123456789abcdef";
+    task_desc.version = "1.0.1";
+    aiot_download_setopt(download_handle, AIOT_DLOPT_TASK_DESC, &task_desc);
+
+    checkpoint.digest_method = AIOT_OTA_DIGEST_SHA256;
+    memcpy(checkpoint.expect_digest, task_desc.expect_digest, strlen(task_desc.expect_digest));
+    res = aiot_download_setopt(download_handle, AIOT_DLOPT_CHECKPOINT, &checkpoint);
+    ASSERT_EQ(res, STATE_DOWNLOAD_CHECKPOINT_MISMATCH);
+
+    checkpoint.digest_method = AIOT_OTA_DIGEST_MD5;
+    checkpoint.size_fetched = 2048;
+    res = aiot_download_setopt(download_handle, AIOT_DLOPT_CHECKPOINT, &checkpoint);
+    ASSERT_EQ(res, STATE_DOWNLOAD_CHECKPOINT_MISMATCH);
+
+    checkpoint.size_fetched = 0;
+    checkpoint.digest_ctx_len = 7;
+    res = aiot_download_setopt(download_handle, AIOT_DLOPT_CHECKPOINT, &checkpoint);
+    ASSERT_EQ(res, STATE_DOWNLOAD_CHECKPOINT_MISMATCH);
+
+    aiot_download_deinit(&download_handle);
+}
+
+#define CASE_40_OLD_LEN             (128 * 1024)
+#define CASE_40_NEW_MAX_LEN         (CASE_40_OLD_LEN + 8 * 1024)
+#define CASE_40_CHUNK_LEN           (1460)
+
+static uint8_t case_40_old_image[CASE_40_OLD_LEN];
+static uint8_t case_40_new_image[CASE_40_NEW_MAX_LEN];
+static uint8_t case_40_output[CASE_40_NEW_MAX_LEN];
+static uint32_t case_40_output_len;
+static int32_t case_40_last_percent;
+
+static uint32_t case_40_release(uint32_t scenario)
+{
+    uint32_t idx = 0, len = 0;
+
+    if (scenario == 0) {
+        /* 修复版本: 原地修改几处代码 */
+        memcpy(case_40_new_image, case_40_old_image, CASE_40_OLD_LEN);
+        for (idx = 0; idx < 3; idx++) {
+            memset(&case_40_new_image[10000 + idx * 40000], 0xA5 + idx, 64);
+        }
+        return CASE_40_OLD_LEN;
+    } else if (scenario == 1) {
+        /* 功能版本: 中间插入2KB新代码, 并删除另一处512字节 */
+        memcpy(case_40_new_image, case_40_old_image, 50000);
+        len = 50000;
+        for (idx = 0; idx < 2048; idx++) {
+            case_40_new_image[len++] = (uint8_t)rand();
+        }
+        memcpy(&case_40_new_image[len], &case_40_old_image[50000], 40000);
+        len += 40000;
+        memcpy(&case_40_new_image[len], &case_40_old_image[90512], CASE_40_OLD_LEN - 90512);
+        len += CASE_40_OLD_LEN - 90512;
+        return len;
+    } else {
+        /* 重新链接: 32KB范围内每256字节有一个地址变化, 末尾追加1KB */
+        memcpy(case_40_new_image, case_40_old_image, CASE_40_OLD_LEN);
+        for (idx = 4096; idx < 4096 + 32 * 1024; idx += 256) {
+            case_40_new_image[idx] += 0x10;
+            case_40_new_image[idx + 1] += 0x01;
+        }
+        for (idx = 0; idx < 1024; idx++) {
+            case_40_new_image[CASE_40_OLD_LEN + idx] = (uint8_t)rand();
+        }
+        return CASE_40_OLD_LEN + 1024;
+    }
+}
+
+static int32_t case_40_read_old(uint32_t offset, uint8_t *buffer, uint32_t len, void *userdata)
+{
+    memcpy(buffer, &case_40_old_image[offset], len);
+    return len;
+}
+
+static int32_t case_40_write_new(uint8_t *buffer, uint32_t len, void *userdata)
+{
+    memcpy(&case_40_output[case_40_output_len], buffer, len);
+    case_40_output_len += len;
+    return STATE_SUCCESS;
+}
+
+/* 模拟写flash失败: 输出超过一半之后返回错误 */
+static int32_t case_40_write_new_fail(uint8_t *buffer, uint32_t len, void *userdata)
+{
+    if (case_40_output_len + len > *(uint32_t *)userdata / 2) {
+        return -1;
+    }
+    return case_40_write_new(buffer, len, userdata);
+}
+
+CASE(COMPONENT_FOTA, case_40_ota_delta_benchmark)
+{
+    char *scenario_name[] = {"bugfix", "feature", "relink"};
+    uint32_t scenario = 0, idx = 0, new_len = 0, patch_len = 0, offset = 0, chunk_len = 0;
+    uint8_t *patch = NULL;
+    ota_delta_ctx_t ctx;
+    struct timeval start, end;
+    int32_t res = 0;
+
+    srand(40);
+    for (idx = 0; idx < CASE_40_OLD_LEN; idx++) {
+        case_40_old_image[idx] = (uint8_t)rand();
+    }
+
+    printf("\r\n| %-8s | %10s | %10s | %7s | %10s |\r\n", "release", "image", "patch", "ratio", "apply(us)");
+    for (scenario = 0; scenario < 3; scenario++) {
+        new_len = case_40_release(scenario);
+        res = ota_delta_gen(case_40_old_image, CASE_40_OLD_LEN, case_40_new_image, new_len, &patch, &patch_len);
+        ASSERT_EQ(res, 0);
+
+        case_40_output_len = 0;
+        gettimeofday(&start, NULL);
+        ota_delta_init(&ctx, case_40_read_old, case_40_write_new, NULL);
+        for (offset = 0; offset < patch_len; offset += chunk_len) {
+            chunk_len = (patch_len - offset < CASE_40_CHUNK_LEN) ? (patch_len - offset) : CASE_40_CHUNK_LEN;
+            res = ota_delta_update(&ctx, &patch[offset], chunk_len);
+            ASSERT_EQ(res, STATE_SUCCESS);
+        }
+        res = ota_delta_finish(&ctx);
+        ota_delta_free(&ctx);
+        gettimeofday(&end, NULL);
+
+        printf("| %-8s | %10d | %10d | %6.2f%% | %10ld |\r\n", scenario_name[scenario], new_len, patch_len,
+               100.0 * patch_len / new_len,
+               (long)((end.tv_sec - start.tv_sec) * 1000000 + (end.tv_usec - start.tv_usec)));
+        ASSERT_EQ(res, STATE_SUCCESS);
+        ASSERT_EQ(case_40_output_len, new_len);
+        ASSERT_EQ(memcmp(case_40_output, case_40_new_image, new_len), 0);
+        ASSERT_LT(patch_len, new_len / 10);
+
+        /* 写入新固件失败时还原中止, 返回回调的错误码 */
+        case_40_output_len = 0;
+        ota_delta_init(&ctx, case_40_read_old, case_40_write_new_fail, &new_len);
+        res = ota_delta_update(&ctx, patch, patch_len);
+        ota_delta_free(&ctx);
+        ASSERT_EQ(res, -1);
+        ASSERT_LT(case_40_output_len, new_len);
+
+        /* 差分包被篡改时还原必须失败 */
+        patch[OTA_DELTA_HEADER_LEN + 5] ^= 0xFF;
+        case_40_output_len = 0;
+        ota_delta_init(&ctx, case_40_read_old, case_40_write_new, NULL);
+        res = ota_delta_update(&ctx, patch, patch_len);
+        if (res == STATE_SUCCESS) {
+            res = ota_delta_finish(&ctx);
+        }
+        ota_delta_free(&ctx);
+        ASSERT_NE(res, STATE_SUCCESS);
+        free(patch);
+    }
+}
+
+static int32_t case_41_delta_read_handler(void *handle, uint32_t offset, uint8_t *buffer, uint32_t len,
+        void *userdata)
+{
+    return case_40_read_old(offset, buffer, len, userdata);
+}
+
+static void case_41_download_recv_handler(void *handle, int32_t percent, const aiot_download_recv_t *packet,
+        void *userdata)
+{
+    case_40_write_new(packet->data.buffer, packet->data.len, userdata);
+    case_40_last_percent = percent;
+}
+
+CASE(COMPONENT_FOTA, case_41_aiot_download_delta_with_disconnect)
+{
+    extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
+    aiot_sysdep_portfile_t portfile_backup = g_aiot_sysdep_portfile;
+    aiot_download_task_desc_t task_desc = {0};
+    aiot_download_checkpoint_t checkpoint = {0};
+    uint8_t *patch = NULL, digest[32] = {0};
+    char digest_string[65] = {0};
+    uint32_t idx = 0, new_len = 0, patch_len = 0, segment_size = 1024, round = 0, loop_count = 0;
+    void *download_handle = NULL;
+    int32_t res = STATE_SUCCESS;
+
+    srand(41);
+    for (idx = 0; idx < CASE_40_OLD_LEN; idx++) {
+        case_40_old_image[idx] = (uint8_t)rand();
+    }
+    new_len = case_40_release(1);
+    ASSERT_EQ(ota_delta_gen(case_40_old_image, CASE_40_OLD_LEN, case_40_new_image, new_len, &patch, &patch_len), 0);
+    core_sha256(patch, patch_len, digest);
+    core_hex2str(digest, sizeof(digest), digest_string, 1);
+
+    aiot_sysdep_set_portfile(&g_aiot_sysdep_portfile);
+    g_aiot_sysdep_portfile.core_sysdep_network_init = case_38_network_init;
+    g_aiot_sysdep_portfile.core_sysdep_network_setopt = case_38_network_setopt;
+    g_aiot_sysdep_portfile.core_sysdep_network_establish = case_38_network_establish;
+    g_aiot_sysdep_portfile.core_sysdep_network_send = case_38_network_send;
+    g_aiot_sysdep_portfile.core_sysdep_network_recv = case_38_network_recv;
+    g_aiot_sysdep_portfile.core_sysdep_network_deinit = case_38_network_deinit;
+
+    task_desc.product_key = "pk";
+    task_desc.device_name = "dn";
+    task_desc.url = "https://ota.example.com/firmware.diff";
+    task_desc.size_total = patch_len;
+    task_desc.digest_method = AIOT_OTA_DIGEST_SHA256;
+    task_desc.expect_digest = digest_string;
+    task_desc.version = "1.1.0";
+    task_desc.is_diff = 1;
+
+    /* 第一轮基于正确的旧固件还原, 第二轮旧固件被破坏, 最终进度应为校验失败 */
+    for (round = 0; round < 2; round++) {
+        memset(&case_38_server, 0, sizeof(case_38_server_t));
+        case_38_server.content = patch;
+        case_38_server.content_len = patch_len;
+        case_38_server.fail_after = patch_len / 2;
+        case_40_output_len = 0;
+        case_40_last_percent = 0;
+        if (round == 1) {
+            case_40_old_image[60000] ^= 0xFF;
+        }
+
+        download_handle = aiot_download_init();
+        aiot_download_setopt(download_handle, AIOT_DLOPT_TASK_DESC, &task_desc);
+        aiot_download_setopt(download_handle, AIOT_DLOPT_SEGMENT_SIZE, &segment_size);
+        aiot_download_setopt(download_handle, AIOT_DLOPT_RECV_HANDLER, case_41_download_recv_handler);
+        aiot_download_setopt(download_handle, AIOT_DLOPT_DELTA_READ_HANDLER, case_41_delta_read_handler);
+        res = aiot_download_setopt(download_handle, AIOT_DLOPT_CHECKPOINT, &checkpoint);
+        ASSERT_EQ(res, STATE_DOWNLOAD_CHECKPOINT_MISMATCH);
+
+        for (loop_count = 0; loop_count < 1024; loop_count++) {
+            res = aiot_download_recv(download_handle);
+            if (res == STATE_DOWNLOAD_FINISHED) {
+                break;
+            }
+        }
+        aiot_download_deinit(&download_handle);
+
+        printf("case 41: patch %d bytes for %d bytes image, %d connects, %d requests\r\n", patch_len, new_len,
+               case_38_server.connect_count, case_38_server.request_count);
+        ASSERT_EQ(res, STATE_DOWNLOAD_FINISHED);
+        ASSERT_GT(case_38_server.connect_count, 1);
+        if (round == 0) {
+            ASSERT_EQ(case_40_last_percent, 100);
+            ASSERT_EQ(case_40_output_len, new_len);
+            ASSERT_EQ(memcmp(case_40_output, case_40_new_image, new_len), 0);
+        } else {
+            ASSERT_EQ(case_40_last_percent, AIOT_OTAERR_CHECKSUM_MISMATCH);
+        }
+    }
+
+    g_aiot_sysdep_portfile = portfile_backup;
+    free(patch);
+}
+
+/* 主机上的flash模拟器: 首次写入某个扇区时先擦除, 按页编程, 擦写耗时可配置 */
+#define CASE_42_IMAGE_LEN           (64 * 1024)
+#define CASE_42_SECTOR_LEN          (4 * 1024)
+#define CASE_42_PAGE_LEN            (256)
+
+typedef struct {
+    uint8_t flash[CASE_42_IMAGE_LEN];
+    uint8_t erased[CASE_42_IMAGE_LEN / CASE_42_SECTOR_LEN];
+    uint32_t erase_us;
+    uint32_t program_us;
+    uint32_t written_len;
+    uint32_t recv_len;
+    uint8_t writer_running;
+} case_42_flash_t;
+
+static case_42_flash_t case_42_flash;
+
+static int32_t case_42_flash_write(uint32_t offset, uint8_t *buffer, uint32_t len)
+{
+    uint32_t sector = 0, pages = 0;
+
+    if (offset + len > CASE_42_IMAGE_LEN) {
+        return -1;
+    }
+    for (sector = offset / CASE_42_SECTOR_LEN; sector <= (offset + len - 1) / CASE_42_SECTOR_LEN; sector++) {
+        if (case_42_flash.erased[sector] == 0) {
+            usleep(case_42_flash.erase_us);
+            case_42_flash.erased[sector] = 1;
+        }
+    }
+    pages = (len + CASE_42_PAGE_LEN - 1) / CASE_42_PAGE_LEN;
+    usleep(case_42_flash.program_us * pages);
+    memcpy(&case_42_flash.flash[offset], buffer, len);
+    case_42_flash.written_len += len;
+    return STATE_SUCCESS;
+}
+
+static void case_42_inline_recv_handler(void *handle, int32_t percent, const aiot_download_recv_t *packet,
+                                        void *userdata)
+{
+    /* 与fota_basic_demo一样, 直接在收包回调中写flash */
+    case_42_flash_write(case_42_flash.written_len, packet->data.buffer, packet->data.len);
+}
+
+static void case_42_count_recv_handler(void *handle, int32_t percent, const aiot_download_recv_t *packet,
+                                       void *userdata)
+{
+    case_42_flash.recv_len += packet->data.len;
+}
+
+static int32_t case_42_writer_handler(void *handle, uint32_t offset, uint8_t *buffer, uint32_t len, void *userdata)
+{
+    return case_42_flash_write(offset, buffer, len);
+}
+
+static void *case_42_writer_thread(void *handle)
+{
+    while (case_42_flash.writer_running) {
+        if (aiot_download_write_process(handle) == STATE_DOWNLOAD_WRITER_IDLE) {
+            usleep(200);
+        }
+    }
+    return NULL;
+}
+
+CASE(COMPONENT_FOTA, case_42_aiot_download_writer_pipeline_benchmark)
+{
+    extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
+    aiot_sysdep_portfile_t portfile_backup = g_aiot_sysdep_portfile;
+    aiot_download_task_desc_t task_desc = {0};
+    uint8_t digest[32] = {0};
+    char digest_string[65] = {0};
+    char *mode_name[] = {"inline", "2 buffers", "4 buffers"};
+    uint32_t mode = 0, idx = 0, buffer_num = 0, busy_count = 0, loop_count = 0;
+    uint32_t elapsed_us[3] = {0};
+    struct timeval start, end;
+    pthread_t writer_thread;
+    int32_t res = STATE_SUCCESS;
+
+    aiot_sysdep_set_portfile(&g_aiot_sysdep_portfile);
+    g_aiot_sysdep_portfile.core_sysdep_network_init = case_38_network_init;
+    g_aiot_sysdep_portfile.core_sysdep_network_setopt = case_38_network_setopt;
+    g_aiot_sysdep_portfile.core_sysdep_network_establish = case_38_network_establish;
+    g_aiot_sysdep_portfile.core_sysdep_network_send = case_38_network_send;
+    g_aiot_sysdep_portfile.core_sysdep_network_recv = case_38_network_recv;
+    g_aiot_sysdep_portfile.core_sysdep_network_deinit = case_38_network_deinit;
+
+    srand(42);
+    for (idx = 0; idx < CASE_42_IMAGE_LEN; idx++) {
+        case_38_server.image[idx] = (uint8_t)rand();
+    }
+    core_sha256(case_38_server.image, CASE_42_IMAGE_LEN, digest);
+    core_hex2str(digest, sizeof(digest), digest_string, 1);
+
+    task_desc.product_key = "pk";
+    task_desc.device_name = "dn";
+    task_desc.url = "https://ota.example.com/firmware.bin";
+    task_desc.size_total = CASE_42_IMAGE_LEN;
+    task_desc.digest_method = AIOT_OTA_DIGEST_SHA256;
+    task_desc.expect_digest = digest_string;
+    task_desc.version = "1.0.2";
+
+    printf("\r\n| %-10s | %10s | %10s |\r\n", "mode", "time(ms)", "KB/s");
+    for (mode = 0; mode < 3; mode++) {
+        void *download_handle = aiot_download_init();
+
+        case_38_server.content = case_38_server.image;
+        case_38_server.content_len = CASE_42_IMAGE_LEN;
+        case_38_server.fail_after = -1;
+        case_38_server.recv_delay_us = 4000;
+        memset(&case_42_flash, 0, sizeof(case_42_flash_t));
+        case_42_flash.erase_us = 8000;
+        case_42_flash.program_us = 300;
+
+        aiot_download_setopt(download_handle, AIOT_DLOPT_TASK_DESC, &task_desc);
+        if (mode == 0) {
+            aiot_download_setopt(download_handle, AIOT_DLOPT_RECV_HANDLER, case_42_inline_recv_handler);
+        } else {
+            buffer_num = (mode == 1) ? 2 : 4;
+            /* 设置了写flash的回调时数据不再交给recv_handler */
+            aiot_download_setopt(download_handle, AIOT_DLOPT_RECV_HANDLER, case_42_count_recv_handler);
+            aiot_download_setopt(download_handle, AIOT_DLOPT_WRITER_HANDLER, case_42_writer_handler);
+            aiot_download_setopt(download_handle, AIOT_DLOPT_WRITER_BUFFER_NUM, &buffer_num);
+            case_42_flash.writer_running = 1;
+            pthread_create(&writer_thread, NULL, case_42_writer_thread, download_handle);
+        }
+
+        gettimeofday(&start, NULL);
+        for (loop_count = 0; loop_count < 100000; loop_count++) {
+            res = aiot_download_recv(download_handle);
+            if (res == STATE_DOWNLOAD_FINISHED || res == STATE_DOWNLOAD_WRITER_FAILED) {
+                break;
+            }
+            if (res == STATE_DOWNLOAD_WRITER_BUSY) {
+                busy_count++;
+                usleep(200);
+            }
+        }
+        gettimeofday(&end, NULL);
+
+        if (mode != 0) {
+            case_42_flash.writer_running = 0;
+            pthread_join(writer_thread, NULL);
+        }
+        aiot_download_deinit(&download_handle);
+
+        elapsed_us[mode] = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_usec - start.tv_usec);
+        printf("| %-10s | %10d | %10d |\r\n", mode_name[mode], elapsed_us[mode] / 1000,
+               (int)((uint64_t)CASE_42_IMAGE_LEN * 1000000 / 1024 / elapsed_us[mode]));
+        ASSERT_EQ(res, STATE_DOWNLOAD_FINISHED);
+        ASSERT_EQ(case_42_flash.written_len, CASE_42_IMAGE_LEN);
+        ASSERT_EQ(memcmp(case_42_flash.flash, case_38_server.image, CASE_42_IMAGE_LEN), 0);
+        ASSERT_EQ(case_42_flash.recv_len, 0);
+    }
+    printf("writer busy returned %d times\r\n", busy_count);
+
+    g_aiot_sysdep_portfile = portfile_backup;
+    ASSERT_LT(elapsed_us[1], elapsed_us[0]);
+    ASSERT_GT(busy_count, 0);
+}
+
+CASE(COMPONENT_FOTA, case_43_ota_md5_vectors)
+{
+    uint32_t i = 0, j = 0;
+    utils_md5_context_t ctx;
+    uint8_t output[16];
+    char output_str[33];
+
+    for (i = 0; i < DIGEST_MD5_VECTORS_NUM; i++) {
+        const digest_vector_t *vector = &digest_md5_vectors[i];
+
+        utils_md5_init(&ctx);
+        utils_md5_starts(&ctx);
+        for (j = 0; j < vector->repeat; j++) {
+            utils_md5_update(&ctx, (const unsigned char *)vector->input, strlen(vector->input));
+        }
+        utils_md5_finish(&ctx, output);
+        utils_md5_free(&ctx);
+
+        memset(output_str, 0, sizeof(output_str));
+        core_hex2str(output, sizeof(output), output_str, 1);
+        ASSERT_STR_EQ(output_str, vector->digest);
+    }
+}
+
+/* 服务端不支持Range时对第一个分段请求也返回200和整个文件, 应在这一个应答中收完, 不能在分段边界处重新请求 */
+CASE(COMPONENT_FOTA, case_44_aiot_download_segment_without_range_support)
+{
+    extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
+    aiot_sysdep_portfile_t portfile_backup = g_aiot_sysdep_portfile;
+    aiot_download_task_desc_t task_desc = {0};
+    uint8_t digest[32] = {0};
+    char digest_string[65] = {0};
+    uint32_t segment_size = CASE_38_SEGMENT_LEN;
+    uint32_t idx = 0, loop_count = 0;
+    void *download_handle = NULL;
+    int32_t res = STATE_SUCCESS;
+
+    aiot_sysdep_set_portfile(&g_aiot_sysdep_portfile);
+    g_aiot_sysdep_portfile.core_sysdep_network_init = case_38_network_init;
+    g_aiot_sysdep_portfile.core_sysdep_network_setopt = case_38_network_setopt;
+    g_aiot_sysdep_portfile.core_sysdep_network_establish = case_38_network_establish;
+    g_aiot_sysdep_portfile.core_sysdep_network_send = case_38_network_send;
+    g_aiot_sysdep_portfile.core_sysdep_network_recv = case_38_network_recv;
+    g_aiot_sysdep_portfile.core_sysdep_network_deinit = case_38_network_deinit;
+
+    memset(&case_38_server, 0, sizeof(case_38_server_t));
+    srand(44);
+    for (idx = 0; idx < CASE_38_IMAGE_LEN; idx++) {
+        case_38_server.image[idx] = (uint8_t)rand();
+    }
+    case_38_server.content = case_38_server.image;
+    case_38_server.content_len = CASE_38_IMAGE_LEN;
+    case_38_server.fail_after = -1;
+    case_38_server.ignore_range = 1;
+    core_sha256(case_38_server.image, CASE_38_IMAGE_LEN, digest);
+    core_hex2str(digest, sizeof(digest), digest_string, 1);
+
+    task_desc.product_key = "pk";
+    task_desc.device_name = "dn";
+    task_desc.url = "https://ota.example.com/firmware.bin";
+    task_desc.size_total = CASE_38_IMAGE_LEN;
+    task_desc.digest_method = AIOT_OTA_DIGEST_SHA256;
+    task_desc.expect_digest = digest_string;
+    task_desc.version = "1.0.1";
+
+    download_handle = aiot_download_init();
+    ASSERT_NOT_NULL(download_handle);
+    aiot_download_setopt(download_handle, AIOT_DLOPT_TASK_DESC, &task_desc);
+    aiot_download_setopt(download_handle, AIOT_DLOPT_SEGMENT_SIZE, &segment_size);
+    aiot_download_setopt(download_handle, AIOT_DLOPT_RECV_HANDLER, case_38_download_recv_handler);
+    for (loop_count = 0; loop_count < 1024; loop_count++) {
+        res = aiot_download_recv(download_handle);
+        if (res == STATE_DOWNLOAD_FINISHED || res == STATE_OTA_DIGEST_MISMATCH) {
+            break;
+        }
+    }
+    aiot_download_deinit(&download_handle);
+
+    g_aiot_sysdep_portfile = portfile_backup;
+
+    ASSERT_EQ(res, STATE_DOWNLOAD_FINISHED);
+    ASSERT_EQ(case_38_server.request_count, 1);
+    ASSERT_EQ(case_38_server.written_len, CASE_38_IMAGE_LEN);
+    ASSERT_EQ(memcmp(case_38_server.written, case_38_server.image, CASE_38_IMAGE_LEN), 0);
+}
+
+/* 升级消息的data中带有较多扩展字段时, token数超过栈上的数组, 仍应正常解析 */
+typedef struct {
+    uint32_t triggered;
+    uint32_t size_total;
+    char version[16];
+    char url[64];
+} case_45_result_t;
+
+static case_45_result_t case_45_result;
+
+static void case_45_user_ota_recv_handler(void *ota_handle, aiot_ota_recv_t *ota_msg, void *userdata)
+{
+    if (ota_msg->type != AIOT_OTARECV_FOTA) {
+        return;
+    }
+    case_45_result.triggered++;
+    case_45_result.size_total = ota_msg->task_desc->size_total;
+    snprintf(case_45_result.version, sizeof(case_45_result.version), "%s", ota_msg->task_desc->version);
+    snprintf(case_45_result.url, sizeof(case_45_result.url), "%s", ota_msg->task_desc->url);
+}
+
+CASE(COMPONENT_FOTA, case_45_aiot_ota_parse_payload_with_many_tokens)
+{
+    extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
+    char topic[] = "/ota/device/upgrade/pk/dn";
+    char payload[2048] = {0};
+    uint32_t payload_len = 0, idx = 0;
+    aiot_mqtt_recv_t packet;
+    core_mqtt_sub_node_t *sub_node = NULL;
+    core_mqtt_sub_handler_node_t *handler_node = NULL;
+    void *mqtt_handle = NULL;
+    void *ota_handle = NULL;
+
+    aiot_sysdep_set_portfile(&g_aiot_sysdep_portfile);
+    mqtt_handle = aiot_mqtt_init();
+    ASSERT_NOT_NULL(mqtt_handle);
+    ota_handle = aiot_ota_init();
+    ASSERT_NOT_NULL(ota_handle);
+    aiot_ota_setopt(ota_handle, AIOT_OTAOPT_RECV_HANDLER, case_45_user_ota_recv_handler);
+    /* OTA注册到MQTT的第一个topic即为固件升级的topic, 取出其回调直接投递消息 */
+    aiot_ota_setopt(ota_handle, AIOT_OTAOPT_MQTT_HANDLE, mqtt_handle);
+    sub_node = core_list_first_entry(&((core_mqtt_handle_t *)mqtt_handle)->sub_list, core_mqtt_sub_node_t, linked_node);
+    handler_node = core_list_first_entry(&sub_node->handle_list, core_mqtt_sub_handler_node_t, linked_node);
+
+    payload_len = snprintf(payload, sizeof(payload),
+                           "{\"code\":\"1000\",\"data\":{\"size\":1024,\"signMethod\":\"SHA256\",\"version\":\"1.0.1\","
+                           "\"url\":\"https://ota.example.com/f.bin\",\"sign\":\"%064d\",\"extData\":{", 0);
+    for (idx = 0; idx < 40; idx++) {
+        payload_len += snprintf(&payload[payload_len], sizeof(payload) - payload_len, "%s\"key%d\":\"value%d\"",
+                                (idx == 0) ? "" : ",", (int)idx, (int)idx);
+    }
+    payload_len += snprintf(&payload[payload_len], sizeof(payload) - payload_len, "}},\"id\":1,\"message\":\"success\"}");
+
+    memset(&case_45_result, 0, sizeof(case_45_result_t));
+    memset(&packet, 0, sizeof(aiot_mqtt_recv_t));
+    packet.type = AIOT_MQTTRECV_PUB;
+    packet.data.pub.topic = topic;
+    packet.data.pub.topic_len = (uint16_t)strlen(topic);
+    packet.data.pub.payload = (uint8_t *)payload;
+    packet.data.pub.payload_len = payload_len;
+    handler_node->handler(mqtt_handle, &packet, handler_node->userdata);
+    aiot_ota_deinit(&ota_handle);
+    aiot_mqtt_deinit(&mqtt_handle);
+
+    ASSERT_EQ(case_45_result.triggered, 1);
+    ASSERT_EQ(case_45_result.size_total, 1024);
+    ASSERT_STR_EQ(case_45_result.version, "1.0.1");
+    ASSERT_STR_EQ(case_45_result.url, "https://ota.example.com/f.bin");
+}
+
 SUITE(COMPONENT_FOTA) = {
     ADD_CASE(COMPONENT_FOTA, case_01_aiot_ota_init_without_portfile),
     ADD_CASE(COMPONENT_FOTA, case_02_aiot_ota_init_with_portfile),
@@ -1936,6 +2759,14 @@ SUITE(COMPONENT_FOTA) = {
     ADD_CASE(COMPONENT_FOTA, case_35_aiot_download_with_aritifical_data_send_failed),
     ADD_CASE(COMPONENT_FOTA, case_36_aiot_report_version_ext_null_ota_handle_input),
     ADD_CASE(COMPONENT_FOTA, case_37_aiot_report_version_ext_null_mqtt_handle),
+    ADD_CASE(COMPONENT_FOTA, case_38_aiot_download_resume_from_checkpoint_after_reboot),
+    ADD_CASE(COMPONENT_FOTA, case_39_aiot_download_checkpoint_mismatch),
+    ADD_CASE(COMPONENT_FOTA, case_40_ota_delta_benchmark),
+    ADD_CASE(COMPONENT_FOTA, case_41_aiot_download_delta_with_disconnect),
+    ADD_CASE(COMPONENT_FOTA, case_42_aiot_download_writer_pipeline_benchmark),
+    ADD_CASE(COMPONENT_FOTA, case_43_ota_md5_vectors),
+    ADD_CASE(COMPONENT_FOTA, case_44_aiot_download_segment_without_range_support),
+    ADD_CASE(COMPONENT_FOTA, case_45_aiot_ota_parse_payload_with_many_tokens),
     ADD_CASE_NULL
 };
 
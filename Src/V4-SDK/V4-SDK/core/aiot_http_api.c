@@ -156,8 +156,9 @@ static int32_t _core_http_send_header(core_http_handle_t *http_handle, char *met
     char *combine_header = NULL;
     char *combine_header_src[] = { method, path, host, header, content_lenstr};
     uint32_t combine_header_len = 0;
+    CORE_STR_ARENA(arena, CORE_HTTP_HEADER_ARENA_LEN);
 
-    res = core_sprintf(http_handle->sysdep, &combine_header, "%s %s HTTP/1.1\r\nHost: %s\r\n%sContent-Length: %s\r\n\r\n",
+    res = core_arena_sprintf(http_handle->sysdep, &arena, &combine_header, "%s %s HTTP/1.1\r\nHost: %s\r\n%sContent-Length: %s\r\n\r\n",
                        combine_header_src, sizeof(combine_header_src) / sizeof(char *), CORE_HTTP_MODULE_NAME);
     if (res < STATE_SUCCESS) {
         return res;
@@ -170,7 +171,7 @@ static int32_t _core_http_send_header(core_http_handle_t *http_handle, char *met
     res = _core_http_send(http_handle, (uint8_t *)combine_header, combine_header_len, http_handle->send_timeout_ms);
     http_handle->sysdep->core_sysdep_mutex_unlock(http_handle->send_mutex);
 
-    http_handle->sysdep->core_sysdep_free(combine_header);
+    core_arena_free(http_handle->sysdep, &arena, combine_header);
 
     return res;
 }
@@ -669,6 +670,185 @@ int32_t core_http_deinit(void **p_handle)
     return STATE_SUCCESS;
 }
 
+static core_http_token_global_t g_core_http_token = {NULL, 0, {NULL, NULL}};
+
+static void _core_http_token_global_init(aiot_sysdep_portfile_t *sysdep)
+{
+    if (g_core_http_token.used_count > 0) {
+        g_core_http_token.used_count++;
+        return;
+    }
+
+    g_core_http_token.mutex = sysdep->core_sysdep_mutex_init();
+    CORE_INIT_LIST_HEAD(&g_core_http_token.token_list);
+    g_core_http_token.used_count++;
+}
+
+static void _core_http_token_global_deinit(aiot_sysdep_portfile_t *sysdep)
+{
+    if (g_core_http_token.used_count > 0) {
+        g_core_http_token.used_count--;
+    }
+
+    if (g_core_http_token.used_count != 0) {
+        return;
+    }
+    sysdep->core_sysdep_mutex_deinit(&g_core_http_token.mutex);
+
+    memset(&g_core_http_token, 0, sizeof(core_http_token_global_t));
+}
+
+/* must be called with g_core_http_token.mutex held */
+static uint32_t _core_http_token_remain_ms(core_http_token_t *token, uint64_t timenow_ms)
+{
+    if (token->token == NULL || timenow_ms < token->issue_time_ms ||
+            timenow_ms - token->issue_time_ms >= token->ttl_ms) {
+        return 0;
+    }
+
+    return (uint32_t)(token->ttl_ms - (timenow_ms - token->issue_time_ms));
+}
+
+/* must be called with g_core_http_token.mutex held */
+static void _core_http_token_detach_nolock(core_http_handle_t *http_handle)
+{
+    core_http_token_t *token = http_handle->token;
+
+    if (token == NULL) {
+        return;
+    }
+    http_handle->token = NULL;
+
+    if (--token->ref_count > 0) {
+        return;
+    }
+    core_list_del(&token->linked_node);
+    if (token->token != NULL) {
+        http_handle->sysdep->core_sysdep_free(token->token);
+    }
+    http_handle->sysdep->core_sysdep_free(token->product_key);
+    http_handle->sysdep->core_sysdep_free(token->device_name);
+    http_handle->sysdep->core_sysdep_free(token);
+}
+
+static void _core_http_token_detach(core_http_handle_t *http_handle)
+{
+    http_handle->sysdep->core_sysdep_mutex_lock(g_core_http_token.mutex);
+    _core_http_token_detach_nolock(http_handle);
+    http_handle->sysdep->core_sysdep_mutex_unlock(g_core_http_token.mutex);
+}
+
+/**
+ * attach http_handle to the token shared by all handles of the same device, and return the remaining
+ * lifetime of that token through remain_ms
+ */
+static int32_t _core_http_token_attach(core_http_handle_t *http_handle, uint32_t *remain_ms)
+{
+    int32_t res = STATE_SUCCESS;
+    core_http_token_t *token = NULL, *node = NULL;
+
+    http_handle->sysdep->core_sysdep_mutex_lock(g_core_http_token.mutex);
+    if (http_handle->token != NULL &&
+            (strcmp(http_handle->token->product_key, http_handle->product_key) != 0 ||
+             strcmp(http_handle->token->device_name, http_handle->device_name) != 0)) {
+        _core_http_token_detach_nolock(http_handle);
+    }
+
+    if (http_handle->token == NULL) {
+        core_list_for_each_entry(node, &g_core_http_token.token_list, linked_node) {
+            if (strcmp(node->product_key, http_handle->product_key) == 0 &&
+                    strcmp(node->device_name, http_handle->device_name) == 0) {
+                token = node;
+                break;
+            }
+        }
+
+        if (token == NULL) {
+            token = http_handle->sysdep->core_sysdep_malloc(sizeof(core_http_token_t), CORE_HTTP_MODULE_NAME);
+            if (token == NULL) {
+                http_handle->sysdep->core_sysdep_mutex_unlock(g_core_http_token.mutex);
+                return STATE_SYS_DEPEND_MALLOC_FAILED;
+            }
+            memset(token, 0, sizeof(core_http_token_t));
+            CORE_INIT_LIST_HEAD(&token->linked_node);
+
+            res = core_strdup(http_handle->sysdep, &token->product_key, http_handle->product_key, CORE_HTTP_MODULE_NAME);
+            if (res >= STATE_SUCCESS) {
+                res = core_strdup(http_handle->sysdep, &token->device_name, http_handle->device_name, CORE_HTTP_MODULE_NAME);
+            }
+            if (res < STATE_SUCCESS) {
+                if (token->product_key != NULL) {
+                    http_handle->sysdep->core_sysdep_free(token->product_key);
+                }
+                http_handle->sysdep->core_sysdep_free(token);
+                http_handle->sysdep->core_sysdep_mutex_unlock(g_core_http_token.mutex);
+                return res;
+            }
+            core_list_add_tail(&token->linked_node, &g_core_http_token.token_list);
+        }
+        token->ref_count++;
+        http_handle->token = token;
+    }
+    *remain_ms = _core_http_token_remain_ms(http_handle->token, http_handle->sysdep->core_sysdep_time());
+    http_handle->sysdep->core_sysdep_mutex_unlock(g_core_http_token.mutex);
+
+    return STATE_SUCCESS;
+}
+
+static int32_t _core_http_token_update(core_http_handle_t *http_handle, char *value, uint32_t value_len)
+{
+    char *token = NULL;
+
+    token = http_handle->sysdep->core_sysdep_malloc(value_len + 1, CORE_HTTP_MODULE_NAME);
+    if (token == NULL) {
+        return STATE_SYS_DEPEND_MALLOC_FAILED;
+    }
+    memset(token, 0, value_len + 1);
+    memcpy(token, value, value_len);
+
+    http_handle->sysdep->core_sysdep_mutex_lock(g_core_http_token.mutex);
+    if (http_handle->token->token != NULL) {
+        http_handle->sysdep->core_sysdep_free(http_handle->token->token);
+    }
+    http_handle->token->token = token;
+    http_handle->token->issue_time_ms = http_handle->sysdep->core_sysdep_time();
+    http_handle->token->ttl_ms = http_handle->token_ttl_ms;
+    http_handle->sysdep->core_sysdep_mutex_unlock(g_core_http_token.mutex);
+
+    return STATE_SUCCESS;
+}
+
+static void _core_http_token_invalidate(core_http_handle_t *http_handle)
+{
+    http_handle->sysdep->core_sysdep_mutex_lock(g_core_http_token.mutex);
+    if (http_handle->token != NULL) {
+        http_handle->token->ttl_ms = 0;
+    }
+    http_handle->sysdep->core_sysdep_mutex_unlock(g_core_http_token.mutex);
+}
+
+static int32_t _core_http_token_header(core_http_handle_t *http_handle, char **header)
+{
+    int32_t res = STATE_SUCCESS;
+    char *header_src[] = { NULL, NULL };
+
+    if (http_handle->long_connection == 0) {
+        header_src[1] = "Connection: close\r\n";
+    }
+
+    http_handle->sysdep->core_sysdep_mutex_lock(g_core_http_token.mutex);
+    if (http_handle->token == NULL || http_handle->token->token == NULL) {
+        http_handle->sysdep->core_sysdep_mutex_unlock(g_core_http_token.mutex);
+        return STATE_HTTP_NEED_AUTH;
+    }
+    header_src[0] = http_handle->token->token;
+    res = core_sprintf(http_handle->sysdep, header, "Content-Type: application/octet-stream\r\nPassword: %s\r\n%s",
+                       header_src, sizeof(header_src) / sizeof(char *), CORE_HTTP_MODULE_NAME);
+    http_handle->sysdep->core_sysdep_mutex_unlock(g_core_http_token.mutex);
+
+    return res;
+}
+
 static int32_t _core_http_send_auth(core_http_handle_t *http_handle)
 {
     int32_t res = STATE_SUCCESS;
@@ -705,11 +885,10 @@ static int32_t _core_http_send_auth(core_http_handle_t *http_handle)
     return res;
 }
 
-static int32_t _core_http_recv_auth(core_http_handle_t *http_handle, core_http_response_t *response)
+static int32_t _core_http_recv_auth(core_http_handle_t *http_handle, core_http_response_t *response, char **token,
+                                    uint32_t *token_len)
 {
     int32_t res = STATE_SUCCESS;
-    char *token = NULL;
-    uint32_t token_len = 0;
     uint64_t timenow_ms = http_handle->sysdep->core_sysdep_time();
 
     while (1) {
@@ -745,26 +924,12 @@ static int32_t _core_http_recv_auth(core_http_handle_t *http_handle, core_http_r
 
     core_log2(http_handle->sysdep, STATE_HTTP_LOG_AUTH, "%.*s\r\n", &response->content_len, response->content);
 
-    res = core_json_value((const char *)response->content, response->content_len, "token", strlen("token"), &token,
-                          &token_len);
+    res = core_json_value((const char *)response->content, response->content_len, "token", strlen("token"), token,
+                          token_len);
     if (res < STATE_SUCCESS) {
         return STATE_HTTP_AUTH_TOKEN_FAILED;
     }
 
-    http_handle->sysdep->core_sysdep_mutex_lock(http_handle->data_mutex);
-    if (http_handle->token != NULL) {
-        http_handle->sysdep->core_sysdep_free(http_handle->token);
-        http_handle->token = NULL;
-    }
-    http_handle->token = http_handle->sysdep->core_sysdep_malloc(token_len + 1, CORE_HTTP_MODULE_NAME);
-    if (http_handle->token == NULL) {
-        http_handle->sysdep->core_sysdep_mutex_unlock(http_handle->data_mutex);
-        return STATE_SYS_DEPEND_MALLOC_FAILED;
-    }
-    memset(http_handle->token, 0, token_len + 1);
-    memcpy(http_handle->token, token, token_len);
-    http_handle->sysdep->core_sysdep_mutex_unlock(http_handle->data_mutex);
-
     return STATE_SUCCESS;
 }
 
@@ -772,7 +937,6 @@ static void _core_http_report_version(core_http_handle_t *http_handle)
 {
     int32_t res = STATE_SUCCESS;
     char *path = NULL, *header = NULL;
-    char *header_src[] = {NULL, NULL};
     char *path_src[] = { http_handle->product_key, http_handle->device_name };
     uint64_t timenow_ms = http_handle->sysdep->core_sysdep_time();
     core_http_request_t request;
@@ -787,12 +951,7 @@ static void _core_http_report_version(core_http_handle_t *http_handle)
         return;
     }
 
-    header_src[0] = http_handle->token;
-    if (http_handle->long_connection == 0) {
-        header_src[1] = "Connection: close\r\n";
-    }
-    res = core_sprintf(http_handle->sysdep, &header, "Content-Type: application/octet-stream\r\nPassword: %s\r\n%s",
-                       header_src, sizeof(header_src) / sizeof(char *), CORE_HTTP_MODULE_NAME);
+    res = _core_http_token_header(http_handle, &header);
     if (res < STATE_SUCCESS) {
         http_handle->sysdep->core_sysdep_free(path);
         return;
@@ -938,6 +1097,7 @@ static void _core_aiot_http_token_expired_event(core_http_handle_t *http_handle,
 
     if (code == AIOT_HTTP_RSPCODE_TOKEN_EXPIRED ||
             code == AIOT_HTTP_RSPCODE_TOKEN_CHECK_ERROR) {
+        _core_http_token_invalidate(http_handle);
         if (http_handle->event_handler != NULL) {
             aiot_http_event_t event;
             event.type = AIOT_HTTPEVT_TOKEN_INVALID;
@@ -947,6 +1107,139 @@ static void _core_aiot_http_token_expired_event(core_http_handle_t *http_handle,
     }
 }
 
+/**
+ * fetch a new token through a temporary connection, so that the data connection of http_handle is neither
+ * interrupted nor locked while the token is renewed
+ */
+static int32_t _core_http_token_renew(core_http_handle_t *http_handle)
+{
+    int32_t res = STATE_SUCCESS;
+    char *token = NULL;
+    uint32_t token_len = 0;
+    core_http_handle_t *auth_handle = NULL;
+    core_http_response_t response;
+
+    auth_handle = core_http_init();
+    if (auth_handle == NULL) {
+        return STATE_SYS_DEPEND_MALLOC_FAILED;
+    }
+
+    http_handle->sysdep->core_sysdep_mutex_lock(http_handle->data_mutex);
+    if ((res = core_http_setopt(auth_handle, CORE_HTTPOPT_HOST, http_handle->host)) >= STATE_SUCCESS &&
+            (res = core_http_setopt(auth_handle, CORE_HTTPOPT_PORT, &http_handle->port)) >= STATE_SUCCESS &&
+            (res = core_http_setopt(auth_handle, CORE_HTTPOPT_CONNECT_TIMEOUT_MS,
+                                    &http_handle->connect_timeout_ms)) >= STATE_SUCCESS &&
+            (res = core_http_setopt(auth_handle, CORE_HTTPOPT_SEND_TIMEOUT_MS,
+                                    &http_handle->send_timeout_ms)) >= STATE_SUCCESS &&
+            (res = core_http_setopt(auth_handle, CORE_HTTPOPT_RECV_TIMEOUT_MS,
+                                    &http_handle->recv_timeout_ms)) >= STATE_SUCCESS &&
+            (res = core_http_setopt(auth_handle, CORE_HTTPOPT_HEADER_LINE_MAX_LEN,
+                                    &http_handle->header_line_max_len)) >= STATE_SUCCESS &&
+            http_handle->cred != NULL) {
+        res = core_http_setopt(auth_handle, CORE_HTTPOPT_NETWORK_CRED, http_handle->cred);
+    }
+    auth_handle->product_key = http_handle->product_key;
+    auth_handle->device_name = http_handle->device_name;
+    auth_handle->device_secret = http_handle->device_secret;
+    auth_handle->auth_timeout_ms = http_handle->auth_timeout_ms;
+    auth_handle->long_connection = 0;
+    http_handle->sysdep->core_sysdep_mutex_unlock(http_handle->data_mutex);
+
+    memset(&response, 0, sizeof(core_http_response_t));
+    core_http_setopt(auth_handle, CORE_HTTPOPT_RECV_HANDLER, (void *)_core_http_auth_recv_handler);
+    core_http_setopt(auth_handle, CORE_HTTPOPT_USERDATA, (void *)&response);
+
+    if (res >= STATE_SUCCESS) {
+        res = core_http_connect(auth_handle);
+    }
+    if (res >= STATE_SUCCESS) {
+        res = _core_http_send_auth(auth_handle);
+    }
+    if (res >= STATE_SUCCESS) {
+        res = _core_http_recv_auth(auth_handle, &response, &token, &token_len);
+    }
+
+    if (res >= STATE_SUCCESS) {
+        res = _core_http_token_update(http_handle, token, token_len);
+    }
+    if (response.content != NULL) {
+        http_handle->sysdep->core_sysdep_free(response.content);
+    }
+
+    auth_handle->product_key = NULL;
+    auth_handle->device_name = NULL;
+    auth_handle->device_secret = NULL;
+    core_http_deinit((void **)&auth_handle);
+
+    if (res >= STATE_SUCCESS) {
+        core_log(http_handle->sysdep, STATE_HTTP_LOG_TOKEN_RENEW, "HTTP token renewed\r\n");
+    }
+
+    return res;
+}
+
+/**
+ * make sure http_handle holds a usable token
+ *
+ * renew_early == 0: only renew when the token has expired, otherwise return immediately
+ * renew_early == 1: renew when the token has entered the renewal window before its expiry
+ */
+static int32_t _core_http_token_ensure(core_http_handle_t *http_handle, uint8_t renew_early)
+{
+    int32_t res = STATE_SUCCESS;
+    uint32_t remain_ms = 0;
+    uint64_t timenow_ms = 0;
+
+    http_handle->sysdep->core_sysdep_mutex_lock(g_core_http_token.mutex);
+    if (http_handle->token == NULL || http_handle->token->token == NULL) {
+        http_handle->sysdep->core_sysdep_mutex_unlock(g_core_http_token.mutex);
+        return STATE_HTTP_NEED_AUTH;
+    }
+    remain_ms = _core_http_token_remain_ms(http_handle->token, http_handle->sysdep->core_sysdep_time());
+    if (remain_ms > http_handle->token_renew_margin_ms ||
+            (remain_ms > 0 && (renew_early == 0 || http_handle->token->renewing == 1))) {
+        http_handle->sysdep->core_sysdep_mutex_unlock(g_core_http_token.mutex);
+        return STATE_SUCCESS;
+    }
+
+    if (http_handle->token->renewing == 0) {
+        http_handle->token->renewing = 1;
+        http_handle->sysdep->core_sysdep_mutex_unlock(g_core_http_token.mutex);
+
+        res = _core_http_token_renew(http_handle);
+
+        http_handle->sysdep->core_sysdep_mutex_lock(g_core_http_token.mutex);
+        http_handle->token->renewing = 0;
+        http_handle->sysdep->core_sysdep_mutex_unlock(g_core_http_token.mutex);
+
+        return res;
+    }
+    http_handle->sysdep->core_sysdep_mutex_unlock(g_core_http_token.mutex);
+
+    /* token has expired and another handle of the same device is renewing it, wait for the result */
+    timenow_ms = http_handle->sysdep->core_sysdep_time();
+    while (1) {
+        if (timenow_ms >= http_handle->sysdep->core_sysdep_time()) {
+            timenow_ms = http_handle->sysdep->core_sysdep_time();
+        }
+        if (http_handle->sysdep->core_sysdep_time() - timenow_ms >= http_handle->auth_timeout_ms) {
+            break;
+        }
+
+        http_handle->sysdep->core_sysdep_mutex_lock(g_core_http_token.mutex);
+        remain_ms = _core_http_token_remain_ms(http_handle->token, http_handle->sysdep->core_sysdep_time());
+        if (http_handle->token->renewing == 0 || remain_ms > 0) {
+            http_handle->sysdep->core_sysdep_mutex_unlock(g_core_http_token.mutex);
+            break;
+        }
+        http_handle->sysdep->core_sysdep_mutex_unlock(g_core_http_token.mutex);
+
+        http_handle->sysdep->core_sysdep_sleep(CORE_HTTP_TOKEN_WAIT_INTERVAL_MS);
+    }
+
+    return (remain_ms > 0) ? (STATE_SUCCESS) : (STATE_HTTP_TOKEN_EXPIRED);
+}
+
 void *aiot_http_init(void)
 {
     core_http_handle_t *http_handle = NULL;
@@ -957,8 +1250,12 @@ void *aiot_http_init(void)
     }
 
     http_handle->auth_timeout_ms = CORE_HTTP_DEFAULT_AUTH_TIMEOUT_MS;
+    http_handle->token_ttl_ms = CORE_HTTP_DEFAULT_TOKEN_TTL_MS;
+    http_handle->token_renew_margin_ms = CORE_HTTP_DEFAULT_TOKEN_RENEW_MARGIN_MS;
     http_handle->long_connection = 1;
 
+    _core_http_token_global_init(http_handle->sysdep);
+
     http_handle->exec_enabled = 1;
 
     return http_handle;
@@ -1028,6 +1325,14 @@ int32_t aiot_http_setopt(void *handle, aiot_http_option_t option, void *data)
         http_handle->long_connection = *(uint8_t *)data;
     }
     break;
+    case AIOT_HTTPOPT_TOKEN_TTL_MS: {
+        http_handle->token_ttl_ms = *(uint32_t *)data;
+    }
+    break;
+    case AIOT_HTTPOPT_TOKEN_RENEW_MARGIN_MS: {
+        http_handle->token_renew_margin_ms = *(uint32_t *)data;
+    }
+    break;
     default: {
         res = STATE_USER_INPUT_UNKNOWN_OPTION;
     }
@@ -1043,6 +1348,8 @@ int32_t aiot_http_setopt(void *handle, aiot_http_option_t option, void *data)
 int32_t aiot_http_auth(void *handle)
 {
     int32_t res = STATE_SUCCESS;
+    char *token = NULL;
+    uint32_t token_len = 0, remain_ms = 0;
     core_http_response_t response;
     core_http_handle_t *http_handle = (core_http_handle_t *)handle;
 
@@ -1068,6 +1375,13 @@ int32_t aiot_http_auth(void *handle)
 
     _core_aiot_http_exec_inc(http_handle);
 
+    /* another handle of the same device already holds a token which is far from expiry, share it */
+    res = _core_http_token_attach(http_handle, &remain_ms);
+    if (res < STATE_SUCCESS || remain_ms > http_handle->token_renew_margin_ms) {
+        _core_aiot_http_exec_dec(http_handle);
+        return res;
+    }
+
     memset(&response, 0, sizeof(core_http_response_t));
 
     core_http_setopt(http_handle, CORE_HTTPOPT_RECV_HANDLER, (void *)_core_http_auth_recv_handler);
@@ -1088,10 +1402,17 @@ int32_t aiot_http_auth(void *handle)
     }
 
     /* recv auth response */
-    res = _core_http_recv_auth(http_handle, &response);
+    res = _core_http_recv_auth(http_handle, &response, &token, &token_len);
+    if (res >= STATE_SUCCESS) {
+        res = _core_http_token_update(http_handle, token, token_len);
+    }
     if (response.content != NULL) {
         http_handle->sysdep->core_sysdep_free(response.content);
     }
+    if (res < STATE_SUCCESS) {
+        _core_aiot_http_exec_dec(http_handle);
+        return res;
+    }
     _core_http_report_version(http_handle);
 
     _core_aiot_http_exec_dec(http_handle);
@@ -1103,7 +1424,6 @@ int32_t aiot_http_send(void *handle, char *topic, uint8_t *payload, uint32_t pay
 {
     int32_t res = STATE_SUCCESS;
     char *path = NULL, *header = NULL;
-    char *header_src[] = { NULL, NULL };
     core_http_request_t request;
     core_http_handle_t *http_handle = (core_http_handle_t *)handle;
 
@@ -1113,15 +1433,18 @@ int32_t aiot_http_send(void *handle, char *topic, uint8_t *payload, uint32_t pay
     if (payload_len == 0) {
         return STATE_USER_INPUT_OUT_RANGE;
     }
-    if (http_handle->token == NULL) {
-        return STATE_HTTP_NEED_AUTH;
-    }
     if (http_handle->exec_enabled == 0) {
         return STATE_USER_INPUT_EXEC_DISABLED;
     }
 
     _core_aiot_http_exec_inc(http_handle);
 
+    /* only block on renewal when the token has actually expired, early renewal is left to aiot_http_process */
+    if ((res = _core_http_token_ensure(http_handle, 0)) < STATE_SUCCESS) {
+        _core_aiot_http_exec_dec(http_handle);
+        return res;
+    }
+
     if (http_handle->network_handle == NULL ||
             (http_handle->network_handle != NULL && http_handle->long_connection == 0)) {
         if ((res = core_http_connect(http_handle)) < STATE_SUCCESS) {
@@ -1138,12 +1461,7 @@ int32_t aiot_http_send(void *handle, char *topic, uint8_t *payload, uint32_t pay
     }
 
     /* header */
-    header_src[0] = http_handle->token;
-    if (http_handle->long_connection == 0) {
-        header_src[1] = "Connection: close\r\n";
-    }
-    res = core_sprintf(http_handle->sysdep, &header, "Content-Type: application/octet-stream\r\nPassword: %s\r\n%s",
-                       header_src, sizeof(header_src) / sizeof(char *), CORE_HTTP_MODULE_NAME);
+    res = _core_http_token_header(http_handle, &header);
     if (res < STATE_SUCCESS) {
         http_handle->sysdep->core_sysdep_free(path);
         _core_aiot_http_exec_dec(http_handle);
@@ -1238,6 +1556,27 @@ int32_t aiot_http_recv(void *handle)
     return res;
 }
 
+int32_t aiot_http_process(void *handle)
+{
+    int32_t res = STATE_SUCCESS;
+    core_http_handle_t *http_handle = (core_http_handle_t *)handle;
+
+    if (http_handle == NULL) {
+        return STATE_USER_INPUT_NULL_POINTER;
+    }
+    if (http_handle->exec_enabled == 0) {
+        return STATE_USER_INPUT_EXEC_DISABLED;
+    }
+
+    _core_aiot_http_exec_inc(http_handle);
+
+    res = _core_http_token_ensure(http_handle, 1);
+
+    _core_aiot_http_exec_dec(http_handle);
+
+    return res;
+}
+
 int32_t aiot_http_deinit(void **p_handle)
 {
     uint32_t deinit_timeout_ms = 0;
@@ -1275,9 +1614,8 @@ int32_t aiot_http_deinit(void **p_handle)
     if (http_handle->device_secret != NULL) {
         http_handle->sysdep->core_sysdep_free(http_handle->device_secret);
     }
-    if (http_handle->token != NULL) {
-        http_handle->sysdep->core_sysdep_free(http_handle->token);
-    }
+    _core_http_token_detach(http_handle);
+    _core_http_token_global_deinit(http_handle->sysdep);
 
     core_http_deinit(p_handle);
 
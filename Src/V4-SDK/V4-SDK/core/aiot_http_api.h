@@ -237,6 +237,28 @@ typedef enum {
      * 数据类型: (uint8_t *) 默认值: (5 * 1000) ms
      */
     AIOT_HTTPOPT_LONG_CONNECTION,
+    /**
+     * @brief token的有效期, SDK从获取token时开始计时
+     *
+     * @details
+     *
+     * 同一设备(product key + device name相同)的多个HTTP实例共享同一个token
+     *
+     * 数据类型: (uint32_t *) 默认值: (48 * 60 * 60 * 1000) ms
+     */
+    AIOT_HTTPOPT_TOKEN_TTL_MS,
+    /**
+     * @brief token过期前提前续期的时间窗口
+     *
+     * @details
+     *
+     * 1. 当token剩余有效期小于该值时, @ref aiot_http_process 会使用独立的网络连接获取新token, 不影响正在进行的数据上报
+     *
+     * 2. @ref aiot_http_send 只有在token已经过期时才会阻塞等待重新认证
+     *
+     * 数据类型: (uint32_t *) 默认值: (10 * 60 * 1000) ms
+     */
+    AIOT_HTTPOPT_TOKEN_RENEW_MARGIN_MS,
 
     AIOT_HTTPOPT_MAX
 } aiot_http_option_t;
@@ -404,6 +426,7 @@ int32_t aiot_http_auth(void *handle);
  * @retval STATE_HTTP_HANDLE_IS_NULL, HTTP句柄为NULL
  * @retval STATE_USER_INPUT_OUT_RANGE, 用户输入参数无效
  * @retval STATE_HTTP_NOT_AUTH, 设备未认证
+ * @retval STATE_HTTP_TOKEN_EXPIRED, token已过期且等待其他实例重新认证超时
  */
 int32_t aiot_http_send(void *handle, char *topic, uint8_t *payload, uint32_t payload_len);
 
@@ -438,6 +461,23 @@ int32_t aiot_http_send(void *handle, char *topic, uint8_t *payload, uint32_t pay
  */
 int32_t aiot_http_recv(void *handle);
 
+/**
+ * @brief 维护token的生命周期, 当token进入 @ref AIOT_HTTPOPT_TOKEN_RENEW_MARGIN_MS 指定的续期窗口时重新认证
+ *
+ * @details
+ *
+ * 用户应在独立的线程中周期性调用此函数, 调用间隔应小于 @ref AIOT_HTTPOPT_TOKEN_RENEW_MARGIN_MS
+ *
+ * @param[in] handle HTTP句柄
+ *
+ * @return int32_t
+ *
+ * @retval STATE_SUCCESS, token有效或续期成功
+ * @retval STATE_HTTP_NEED_AUTH, 设备未认证, 请先调用 @ref aiot_http_auth
+ * @retval <STATE_SUCCESS, 续期失败, 若token尚未过期则仍可继续使用
+ */
+int32_t aiot_http_process(void *handle);
+
 /**
  * @brief 销毁参数p_handle所指定的HTTP实例
  *
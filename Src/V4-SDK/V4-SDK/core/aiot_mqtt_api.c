@@ -1725,7 +1725,8 @@ int32_t aiot_mqtt_pub(void *handle, aiot_mqtt_buff_t *topic, aiot_mqtt_buff_t *p
         char *at_mqttpub = NULL;
         char *src[] = {"at+mqttpub=0,0,\"", (char *)topic->buffer, "\",\"", (char *)payload->buffer, "\"\r\n"};
         uint8_t topic_len = sizeof(src) / sizeof(char *);
-        int res = core_sprintf(mqtt_handle->sysdep, &at_mqttpub, "%s%s%s%s%s", src, topic_len, CORE_MQTT_MODULE_NAME);
+        CORE_STR_ARENA(arena, SEND_LEN);
+        int res = core_arena_sprintf(mqtt_handle->sysdep, &arena, &at_mqttpub, "%s%s%s%s%s", src, topic_len, CORE_MQTT_MODULE_NAME);
         if (res < 0) {
             return -1;
         }
@@ -1750,9 +1751,7 @@ int32_t aiot_mqtt_pub(void *handle, aiot_mqtt_buff_t *topic, aiot_mqtt_buff_t *p
             }
         }
 
-        if (NULL != at_mqttpub) {
-            mqtt_handle->sysdep->core_sysdep_free(at_mqttpub);
-        }
+        core_arena_free(mqtt_handle->sysdep, &arena, at_mqttpub);
     }
     return ret;
 }
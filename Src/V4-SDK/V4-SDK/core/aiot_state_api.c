@@ -8,9 +8,11 @@
  */
 
 #include "core_stdinc.h"
+#include "core_log.h"
 #include "aiot_state_api.h"
 
 aiot_state_logcb_t g_logcb_handler = NULL;
+aiot_state_logfilter_t g_logfilter_handler = NULL;
 
 int32_t aiot_state_set_logcb(aiot_state_logcb_t handler)
 {
@@ -18,3 +20,19 @@ int32_t aiot_state_set_logcb(aiot_state_logcb_t handler)
     return 0;
 }
 
+int32_t aiot_state_set_logfilter(aiot_state_logfilter_t filter)
+{
+    g_logfilter_handler = filter;
+    return 0;
+}
+
+int32_t aiot_state_set_binlog(uint8_t *buffer, uint32_t len)
+{
+    return core_log_binlog_init(buffer, len);
+}
+
+int32_t aiot_state_binlog_read(uint8_t *buffer, uint32_t len, uint32_t *dropped)
+{
+    return core_log_binlog_read(buffer, len, dropped);
+}
+
@@ -30,6 +30,59 @@ typedef int32_t (* aiot_state_logcb_t)(int32_t code, char *message);
  */
 int32_t aiot_state_set_logcb(aiot_state_logcb_t handler);
 
+/**
+ * @brief SDK的日志过滤回调函数原型
+ *
+ * @details
+ *
+ * 在格式化日志或写入二进制日志之前调用, 返回0表示丢弃该状态码的日志, 被丢弃的日志不产生任何格式化开销
+ */
+typedef int32_t (* aiot_state_logfilter_t)(int32_t code);
+
+/**
+ * @brief 设置SDK的日志过滤回调函数, 传入NULL表示不过滤
+ *
+ * @param filter 日志过滤回调函数
+ *
+ * @return int32_t 保留
+ */
+int32_t aiot_state_set_logfilter(aiot_state_logfilter_t filter);
+
+/**
+ * @brief 开启二进制日志模式
+ *
+ * @details
+ *
+ * 开启后日志不再在设备上格式化, 也不再调用 @ref aiot_state_set_logcb 设置的回调函数, 而是把状态码, 时间戳, 格式字符串的位置
+ *
+ * 和参数的原始值写入buffer组成的无锁环形缓冲区. 用户通过 @ref aiot_state_binlog_read 取出后原样输出,
+ *
+ * 在主机上用host-tools/log_decode结合固件的ELF文件还原为文本. 缓冲区满时新的日志被丢弃并计数
+ *
+ * @param buffer 环形缓冲区, 传入NULL表示关闭二进制日志模式
+ * @param len 缓冲区长度, 必须是2的幂且不小于256字节
+ *
+ * @return int32_t
+ *
+ * @retval STATE_SUCCESS 设置成功
+ * @retval STATE_USER_INPUT_OUT_RANGE 缓冲区长度不符合要求
+ */
+int32_t aiot_state_set_binlog(uint8_t *buffer, uint32_t len);
+
+/**
+ * @brief 从二进制日志缓冲区中取出完整的日志记录
+ *
+ * @param buffer 输出缓冲区
+ * @param len 输出缓冲区长度
+ * @param dropped 输出, 缓冲区满时丢弃的日志条数, 读取后清零, 可为NULL
+ *
+ * @return int32_t
+ *
+ * @retval >=0 取出的字节数
+ * @retval STATE_USER_INPUT_NULL_POINTER 未开启二进制日志模式或参数为NULL
+ */
+int32_t aiot_state_binlog_read(uint8_t *buffer, uint32_t len, uint32_t *dropped);
+
 /**
  * @brief SDK状态码基准值
  *
@@ -282,6 +335,8 @@ int32_t aiot_state_set_logcb(aiot_state_logcb_t handler);
 #define STATE_HTTP_LOG_RECV_CONTENT                                  (STATE_HTTP_BASE - 0x000E)
 #define STATE_HTTP_LOG_DISCONNECT                                    (STATE_HTTP_BASE - 0x000F)
 #define STATE_HTTP_LOG_AUTH                                          (STATE_HTTP_BASE - 0x0010)
+#define STATE_HTTP_LOG_TOKEN_RENEW                                   (STATE_HTTP_BASE - 0x0011)
+#define STATE_HTTP_TOKEN_EXPIRED                                     (STATE_HTTP_BASE - 0x0012)
 
 #define STATE_PORT_BASE                                              (-0x0F00)
 #define STATE_PORT_INPUT_NULL_POINTER                                (STATE_PORT_BASE - 0x0001)
@@ -317,6 +372,8 @@ int32_t aiot_state_set_logcb(aiot_state_logcb_t handler);
 #define STATE_PORT_TLS_SEND_CONNECTION_CLOSED                        (STATE_PORT_BASE - 0x001F)
 #define STATE_PORT_TLS_CONFIG_PSK_FAILED                             (STATE_PORT_BASE - 0x0020)
 #define STATE_PORT_TLS_INVALID_HANDSHAKE                             (STATE_PORT_BASE - 0x0021)
+#define STATE_PORT_NETWORK_ESTABLISH_IN_PROGRESS                     (STATE_PORT_BASE - 0x0022)
+#define STATE_PORT_TLS_ARENA_EXHAUSTED                               (STATE_PORT_BASE - 0x0023)
 
 #if defined(__cplusplus)
 }
@@ -20,6 +20,7 @@ typedef enum {
     AIOT_SYSDEP_NETWORK_CRED_NONE,
     AIOT_SYSDEP_NETWORK_CRED_SVRCERT_RSA,
     AIOT_SYSDEP_NETWORK_CRED_SVRCERT_PSK,
+    AIOT_SYSDEP_NETWORK_CRED_SVRCERT_ECC,   /* 使用ECDSA P-256证书校验服务端, 密钥交换为ECDHE, 需以MBEDTLS_SSL_ECC_PROFILE编译mbedtls */
     AIOT_SYSDEP_NETWORK_CRED_MAX
 } aiot_sysdep_network_cred_option_t;
 
@@ -27,6 +28,8 @@ typedef struct {
     aiot_sysdep_network_cred_option_t option;  /* 安全策略 */
     uint32_t      max_tls_fragment;
     uint8_t       sni_enabled;
+    /* 以下证书和私钥可以是PEM字符串, 也可以是直接存放在flash中的DER数据(以0x30开头), 后者省去base64解码.
+     * 端口层按内容缓存解析结果, 重连或多个连接使用同一份CA证书时不再重复解析 */
     const char   *x509_server_cert;     /* 必须位于静态存储区, SDK内部不做拷贝 */
     uint32_t      x509_server_cert_len;
     const char   *x509_client_cert;     /* 必须位于静态存储区, SDK内部不做拷贝 */
@@ -47,6 +50,28 @@ typedef struct {
     char *psk;
 } core_sysdep_psk_t;
 
+#define CORE_SYSDEP_HANDSHAKE_FLIGHT_MAX        (8)
+
+/* 握手中同一方向上连续收发的一组消息(flight), 时刻均相对于开始建立连接 */
+typedef struct {
+    uint8_t  outbound;          /* 1: 设备发出, 0: 服务端发来 */
+    uint32_t bytes;             /* 该flight的字节数, 含TLS记录头 */
+    uint32_t begin_us;          /* 收发第一个字节的时刻 */
+    uint32_t end_us;            /* 收发最后一个字节的时刻 */
+    uint32_t cpu_us;            /* 生成(发出的)或解析校验(收到的)该flight的计算耗时, 不含等待网络 */
+} core_sysdep_handshake_flight_t;
+
+typedef struct {
+    uint32_t connect_us;        /* TCP连接的耗时, 含域名解析 */
+    uint32_t handshake_us;      /* TCP连接建立后到TLS握手结束的耗时 */
+    uint32_t steps;             /* 握手状态机前进的步数 */
+    uint32_t yields;            /* 因等待网络而中断的次数, 非阻塞模式下即返回调用者的次数 */
+    uint32_t max_step_us;       /* 两次等待网络之间连续运行的最长耗时, 非阻塞模式下即单次调用establish的最长耗时 */
+    uint32_t flight_num;        /* 超出 CORE_SYSDEP_HANDSHAKE_FLIGHT_MAX 的部分计入最后一个 */
+    uint8_t resumed;            /* 1: 服务端接受了缓存的会话, 为简化握手 */
+    core_sysdep_handshake_flight_t flight[CORE_SYSDEP_HANDSHAKE_FLIGHT_MAX];
+} core_sysdep_handshake_stats_t;
+
 typedef enum {
     CORE_SYSDEP_NETWORK_SOCKET_TYPE,             /* 需要建立的socket类型  数据类型: (core_sysdep_socket_type_t *) */
     CORE_SYSDEP_NETWORK_HOST,                    /* 用于建立网络连接的域名地址或ip地址, 内存与上层模块共用  数据类型: (char *) */
@@ -54,6 +79,8 @@ typedef enum {
     CORE_SYSDEP_NETWORK_CONNECT_TIMEOUT_MS,      /* 建立网络连接的超时时间  数据类型: (uint32_t *) */
     CORE_SYSDEP_NETWORK_CRED,                    /* 用于设置网络层安全参数  数据类型: (aiot_sysdep_network_cred_t *) */
     CORE_SYSDEP_NETWORK_PSK,                     /* 用于配合PSK模式下的psk-id和psk  数据类型: (core_sysdep_psk_t *) */
+    CORE_SYSDEP_NETWORK_NONBLOCK,                /* 非阻塞建立TLS连接, 每次调用establish只推进到需要等待网络为止  数据类型: (uint8_t *) */
+    CORE_SYSDEP_NETWORK_HANDSHAKE_STATS,         /* 建立连接时按flight统计握手的耗时和字节数, 内存由调用者持有  数据类型: (core_sysdep_handshake_stats_t *) */
     CORE_SYSDEP_NETWORK_MAX
 } core_sysdep_network_option_t;
 
@@ -93,6 +120,12 @@ typedef struct {
     int32_t (*core_sysdep_network_setopt)(void *handle, core_sysdep_network_option_t option, void *data);
     /**
      * @brief 建立1个网络会话, 作为MQTT/HTTP等协议的底层承载
+     *
+     * @details
+     *
+     * 设置了 CORE_SYSDEP_NETWORK_NONBLOCK 时, 连接尚未建立完成则返回 STATE_PORT_NETWORK_ESTABLISH_IN_PROGRESS,
+     * 调用者在自己的处理循环中再次调用, 直到返回 STATE_SUCCESS 或其它错误码. 超过连接超时时间没有任何进展时返回
+     * STATE_PORT_NETWORK_CONNECT_TIMEOUT
      */
     int32_t (*core_sysdep_network_establish)(void *handle);
     /**
@@ -111,6 +144,11 @@ typedef struct {
     int32_t (*core_sysdep_network_deinit)(void **handle);
     /**
      * @brief 随机数生成方法
+     *
+     * @details
+     *
+     * 需要密码学强度, 并且会在握手和收发路径上被频繁调用, 不应在调用时等待熵源. 参考实现见portfiles/aiot_port,
+     * 由后台采集的熵为CTR-DRBG播种, 与TLS共用
      */
     void (*core_sysdep_rand)(uint8_t *output, uint32_t output_len);
     /**
@@ -131,9 +169,35 @@ typedef struct {
     void (*core_sysdep_mutex_deinit)(void **mutex);
 } aiot_sysdep_portfile_t;
 
+/**
+ * @brief 内存池的统计信息, 由 @ref aiot_sysdep_get_mempool_stats 获取
+ */
+typedef struct {
+    char       *name;             /* 模块名, 与core_sysdep_malloc的name参数相同 */
+    uint32_t    block_size;       /* 块大小 */
+    uint32_t    block_num;        /* 块数量 */
+    uint32_t    used;             /* 当前使用中的块数量 */
+    uint32_t    high_water;       /* 同时使用的块数量的最大值 */
+    uint32_t    fallback_count;   /* 应由该级分配(申请长度超过该模块最大一级时计入最大一级), 但没有空闲块而改用系统堆的次数 */
+} aiot_sysdep_mempool_stats_t;
+
 void aiot_sysdep_set_portfile(aiot_sysdep_portfile_t *portfile);
 aiot_sysdep_portfile_t *aiot_sysdep_get_portfile(void);
 
+/**
+ * @brief 获取第index个内存池的统计信息, 用于根据长时间运行后的high_water调整内存池配置
+ *
+ * @details
+ *
+ * 仅在系统适配层的core_sysdep_malloc使用了core_mempool时有效
+ *
+ * @return int32_t
+ * @retval STATE_SUCCESS 获取成功
+ * @retval STATE_USER_INPUT_OUT_RANGE index超过了内存池的数量
+ * @retval STATE_USER_INPUT_NULL_POINTER stats为NULL
+ */
+int32_t aiot_sysdep_get_mempool_stats(uint32_t index, aiot_sysdep_mempool_stats_t *stats);
+
 #if defined(__cplusplus)
 }
 #endif
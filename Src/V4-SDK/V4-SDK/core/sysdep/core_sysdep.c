@@ -1,4 +1,5 @@
 #include "core_sysdep.h"
+#include "core_mempool.h"
 
 static aiot_sysdep_portfile_t *g_sysdep_portfile = NULL;
 
@@ -30,3 +31,8 @@ aiot_sysdep_portfile_t * aiot_sysdep_get_portfile(void)
     return g_sysdep_portfile;
 }
 
+int32_t aiot_sysdep_get_mempool_stats(uint32_t index, aiot_sysdep_mempool_stats_t *stats)
+{
+    return core_mempool_get_stats(index, stats);
+}
+
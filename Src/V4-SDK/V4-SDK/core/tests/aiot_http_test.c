@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <unistd.h>
+#include <sys/time.h>
 #include "cu_test.h"
 #include "core_http.h"
 #include "aiot_http_api.h"
@@ -147,6 +148,89 @@ void core_aiot_http_recv_handler(void *handle, const aiot_http_recv_t *packet, v
     }
 }
 
+typedef struct {
+    char response[256];
+    uint32_t response_len;
+    uint32_t offset;
+} test_token_network_t;
+
+static uint32_t g_test_token_auth_count = 0;
+static uint32_t g_test_token_auth_in_send = 0;
+static uint8_t g_test_token_in_send = 0;
+
+static void *test_token_network_init(void)
+{
+    test_token_network_t *network = malloc(sizeof(test_token_network_t));
+    if (network != NULL) {
+        memset(network, 0, sizeof(test_token_network_t));
+    }
+    return network;
+}
+
+static int32_t test_token_network_setopt(void *handle, core_sysdep_network_option_t option, void *data)
+{
+    return 0;
+}
+
+static int32_t test_token_network_establish(void *handle)
+{
+    return 0;
+}
+
+static int32_t test_token_network_send(void *handle, uint8_t *buffer, uint32_t len, uint32_t timeout_ms,
+                                       core_sysdep_addr_t *addr)
+{
+    test_token_network_t *network = (test_token_network_t *)handle;
+    char body[64] = {0};
+
+    if (len > strlen("POST /auth") && memcmp(buffer, "POST /auth", strlen("POST /auth")) == 0) {
+        g_test_token_auth_count++;
+        if (g_test_token_in_send) {
+            g_test_token_auth_in_send++;
+        }
+        snprintf(body, sizeof(body), "{\"code\":0,\"info\":{\"token\":\"token_%d\"},\"message\":\"success\"}",
+                 g_test_token_auth_count);
+        network->response_len = snprintf(network->response, sizeof(network->response),
+                                         "HTTP/1.1 200\r\nContent-Length: %d\r\n\r\n%s", (int)strlen(body), body);
+        network->offset = 0;
+    }
+    return len;
+}
+
+static int32_t test_token_network_recv(void *handle, uint8_t *buffer, uint32_t len, uint32_t timeout_ms,
+                                       core_sysdep_addr_t *addr)
+{
+    test_token_network_t *network = (test_token_network_t *)handle;
+    uint32_t remain = network->response_len - network->offset;
+
+    len = (len < remain) ? (len) : (remain);
+    memcpy(buffer, network->response + network->offset, len);
+    network->offset += len;
+
+    return len;
+}
+
+static int32_t test_token_network_deinit(void **handle)
+{
+    free(*handle);
+    *handle = NULL;
+    return 0;
+}
+
+static uint64_t test_token_time_us(void)
+{
+    struct timeval time;
+
+    gettimeofday(&time, NULL);
+    return (uint64_t)time.tv_sec * 1000000 + time.tv_usec;
+}
+
+static int test_token_latency_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
 DATA(AIOT_HTTP)
 {
     void *http_handle;
@@ -837,9 +921,9 @@ CASEs(AIOT_HTTP, case_26_aiot_http_send_token_error)
     res = aiot_http_auth(data->http_handle);
     ASSERT_EQ(res, STATE_SUCCESS);
 
-    if (((core_http_handle_t *)(data->http_handle))->token != NULL) {
-        ((core_http_handle_t *)(data->http_handle))->sysdep->core_sysdep_free(((core_http_handle_t *)(data->http_handle))->token);
-        ((core_http_handle_t *)(data->http_handle))->token = "1234";
+    if (((core_http_handle_t *)(data->http_handle))->token->token != NULL) {
+        ((core_http_handle_t *)(data->http_handle))->sysdep->core_sysdep_free(((core_http_handle_t *)(data->http_handle))->token->token);
+        ((core_http_handle_t *)(data->http_handle))->token->token = "1234";
     }
 
     res = aiot_http_send(data->http_handle, "/a18wPzZJzNG/aiot_http_test_case_26/user/update", (uint8_t *)"hello world",
@@ -855,7 +939,7 @@ CASEs(AIOT_HTTP, case_26_aiot_http_send_token_error)
     }
     memset(&response, 0, sizeof(core_http_response_t));
 
-    ((core_http_handle_t *)(data->http_handle))->token = NULL;
+    ((core_http_handle_t *)(data->http_handle))->token->token = NULL;
 }
 
 CASEs(AIOT_HTTP, case_27_aiot_http_setopt_AIOT_HTTPOPT_AUTH_TIMEOUT_MS)
@@ -976,6 +1060,110 @@ CASEs(AIOT_HTTP, case_29_aiot_http_auth_header_invalid)
     memset(&response, 0, sizeof(core_http_response_t));
 }
 
+CASEs(AIOT_HTTP, case_30_aiot_http_send_latency_across_token_rollover)
+{
+    extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
+    aiot_sysdep_portfile_t portfile_backup = g_aiot_sysdep_portfile;
+    int32_t res = STATE_SUCCESS;
+    uint32_t idx = 0, recv_timeout_ms = 20, ttl_ms = 300, margin_ms = 150;
+    uint64_t latency_us[200], start_us = 0;
+    uint32_t count = sizeof(latency_us) / sizeof(uint64_t);
+
+    g_aiot_sysdep_portfile.core_sysdep_network_init = test_token_network_init;
+    g_aiot_sysdep_portfile.core_sysdep_network_setopt = test_token_network_setopt;
+    g_aiot_sysdep_portfile.core_sysdep_network_establish = test_token_network_establish;
+    g_aiot_sysdep_portfile.core_sysdep_network_send = test_token_network_send;
+    g_aiot_sysdep_portfile.core_sysdep_network_recv = test_token_network_recv;
+    g_aiot_sysdep_portfile.core_sysdep_network_deinit = test_token_network_deinit;
+    g_test_token_auth_count = 0;
+    g_test_token_auth_in_send = 0;
+
+    aiot_http_setopt(data->http_handle, AIOT_HTTPOPT_HOST, "iot-as-http.cn-shanghai.aliyuncs.com");
+    aiot_http_setopt(data->http_handle, AIOT_HTTPOPT_PRODUCT_KEY, "a18wPzZJzNG");
+    aiot_http_setopt(data->http_handle, AIOT_HTTPOPT_DEVICE_NAME, "aiot_http_test_case_30");
+    aiot_http_setopt(data->http_handle, AIOT_HTTPOPT_DEVICE_SECRET, "xz18qnFy3fUzMY5hmrNgJMHHFjT7lc9z");
+    aiot_http_setopt(data->http_handle, AIOT_HTTPOPT_RECV_TIMEOUT_MS, &recv_timeout_ms);
+    aiot_http_setopt(data->http_handle, AIOT_HTTPOPT_TOKEN_TTL_MS, &ttl_ms);
+    aiot_http_setopt(data->http_handle, AIOT_HTTPOPT_TOKEN_RENEW_MARGIN_MS, &margin_ms);
+
+    res = aiot_http_auth(data->http_handle);
+    ASSERT_EQ(res, STATE_SUCCESS);
+    ASSERT_EQ(g_test_token_auth_count, 1);
+
+    /* renewal is driven by aiot_http_process, aiot_http_send never waits for it */
+    for (idx = 0; idx < count; idx++) {
+        res = aiot_http_process(data->http_handle);
+        ASSERT_EQ(res, STATE_SUCCESS);
+
+        g_test_token_in_send = 1;
+        start_us = test_token_time_us();
+        res = aiot_http_send(data->http_handle, "/a18wPzZJzNG/aiot_http_test_case_30/user/update",
+                             (uint8_t *)"hello world", strlen("hello world"));
+        latency_us[idx] = test_token_time_us() - start_us;
+        g_test_token_in_send = 0;
+        ASSERT_GE(res, STATE_SUCCESS);
+
+        usleep(5 * 1000);
+    }
+    ASSERT_GT(g_test_token_auth_count, 2);
+    ASSERT_EQ(g_test_token_auth_in_send, 0);
+
+    qsort(latency_us, count, sizeof(uint64_t), test_token_latency_cmp);
+    printf("aiot_http_send latency across %d token rollovers: p50 %dus, p99 %dus, max %dus\n",
+           g_test_token_auth_count - 1, (int)latency_us[count / 2], (int)latency_us[count * 99 / 100],
+           (int)latency_us[count - 1]);
+
+    /* without aiot_http_process, an expired token is renewed synchronously inside aiot_http_send */
+    usleep((ttl_ms + 10) * 1000);
+    g_test_token_in_send = 1;
+    res = aiot_http_send(data->http_handle, "/a18wPzZJzNG/aiot_http_test_case_30/user/update",
+                         (uint8_t *)"hello world", strlen("hello world"));
+    g_test_token_in_send = 0;
+    ASSERT_GE(res, STATE_SUCCESS);
+    ASSERT_EQ(g_test_token_auth_in_send, 1);
+
+    aiot_http_deinit(&data->http_handle);
+    g_aiot_sysdep_portfile = portfile_backup;
+}
+
+CASEs(AIOT_HTTP, case_31_aiot_http_token_shared_by_device)
+{
+    extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
+    aiot_sysdep_portfile_t portfile_backup = g_aiot_sysdep_portfile;
+    int32_t res = STATE_SUCCESS;
+    uint32_t recv_timeout_ms = 20;
+    void *handles[2] = {data->http_handle, NULL};
+    uint32_t idx = 0;
+
+    g_aiot_sysdep_portfile.core_sysdep_network_init = test_token_network_init;
+    g_aiot_sysdep_portfile.core_sysdep_network_setopt = test_token_network_setopt;
+    g_aiot_sysdep_portfile.core_sysdep_network_establish = test_token_network_establish;
+    g_aiot_sysdep_portfile.core_sysdep_network_send = test_token_network_send;
+    g_aiot_sysdep_portfile.core_sysdep_network_recv = test_token_network_recv;
+    g_aiot_sysdep_portfile.core_sysdep_network_deinit = test_token_network_deinit;
+    g_test_token_auth_count = 0;
+
+    handles[1] = aiot_http_init();
+    ASSERT_NOT_NULL(handles[1]);
+
+    for (idx = 0; idx < 2; idx++) {
+        aiot_http_setopt(handles[idx], AIOT_HTTPOPT_HOST, "iot-as-http.cn-shanghai.aliyuncs.com");
+        aiot_http_setopt(handles[idx], AIOT_HTTPOPT_PRODUCT_KEY, "a18wPzZJzNG");
+        aiot_http_setopt(handles[idx], AIOT_HTTPOPT_DEVICE_NAME, "aiot_http_test_case_31");
+        aiot_http_setopt(handles[idx], AIOT_HTTPOPT_DEVICE_SECRET, "xz18qnFy3fUzMY5hmrNgJMHHFjT7lc9z");
+        aiot_http_setopt(handles[idx], AIOT_HTTPOPT_RECV_TIMEOUT_MS, &recv_timeout_ms);
+
+        res = aiot_http_auth(handles[idx]);
+        ASSERT_EQ(res, STATE_SUCCESS);
+    }
+    ASSERT_EQ(g_test_token_auth_count, 1);
+    ASSERT_EQ(((core_http_handle_t *)handles[0])->token, ((core_http_handle_t *)handles[1])->token);
+
+    aiot_http_deinit(&handles[1]);
+    aiot_http_deinit(&data->http_handle);
+    g_aiot_sysdep_portfile = portfile_backup;
+}
+
 SUITE(AIOT_HTTP) = {
     ADD_CASE(AIOT_HTTP, case_01_aiot_http_init_without_portfile),
     ADD_CASE(AIOT_HTTP, case_02_aiot_http_init_with_portfile),
@@ -1006,6 +1194,8 @@ SUITE(AIOT_HTTP) = {
     ADD_CASE(AIOT_HTTP, case_27_aiot_http_setopt_AIOT_HTTPOPT_AUTH_TIMEOUT_MS),
     ADD_CASE(AIOT_HTTP, case_28_aiot_http_setopt_AIOT_HTTPOPT_LONG_CONNECTION),
     ADD_CASE(AIOT_HTTP, case_29_aiot_http_auth_header_invalid),
+    ADD_CASE(AIOT_HTTP, case_30_aiot_http_send_latency_across_token_rollover),
+    ADD_CASE(AIOT_HTTP, case_31_aiot_http_token_shared_by_device),
     ADD_CASE_NULL
 };
 
@@ -1,6 +1,13 @@
 #include "cu_test.h"
 #include "core_sha256.h"
 #include "core_string.h"
+#include "core_log.h"
+#include "core_mempool.h"
+#include "core_tls_arena.h"
+#include "digest_vectors.h"
+
+#define LOG_DECODE_NO_MAIN
+#include "log_decode.c"
 
 CASE(CORE_UTILS, utils_sha256)
 {
@@ -20,6 +27,30 @@ CASE(CORE_UTILS, utils_sha256)
 }
 
 
+CASE(CORE_UTILS, utils_sha256_vectors)
+{
+    uint32_t                i = 0, j = 0;
+    core_sha256_context_t   ctx;
+    uint8_t                 output[32];
+    char                    output_str[65];
+
+    for (i = 0; i < DIGEST_SHA256_VECTORS_NUM; i++) {
+        const digest_vector_t *vector = &digest_sha256_vectors[i];
+
+        core_sha256_init(&ctx);
+        core_sha256_starts(&ctx);
+        for (j = 0; j < vector->repeat; j++) {
+            core_sha256_update(&ctx, (const uint8_t *)vector->input, strlen(vector->input));
+        }
+        core_sha256_finish(&ctx, output);
+        core_sha256_free(&ctx);
+
+        memset(output_str, 0, sizeof(output_str));
+        core_hex2str(output, sizeof(output), output_str, 1);
+        ASSERT_STR_EQ(output_str, vector->digest);
+    }
+}
+
 CASE(CORE_UTILS, core_str2uint_normal)
 {
     typedef struct  {
@@ -251,6 +282,169 @@ CASE(CORE_UTILS, core_sprintf)
     aiot_sysdep_set_portfile(NULL);
 }
 
+CASE(CORE_UTILS, core_snprintf)
+{
+    char buffer[16] = {0};
+    char fmt[300] = {0};
+    char *src[] = {"str1", NULL, "str3"};
+    int32_t res = 0;
+
+    /* 只计算长度, NULL和多出的%s按空字符串处理 */
+    ASSERT_EQ(core_sprintf_len("%s-%s-%s-%s", src, 3), 11);
+
+    res = core_snprintf(buffer, sizeof(buffer), "%s-%s-%s", src, 3);
+    ASSERT_EQ(res, 10);
+    ASSERT_STR_EQ(buffer, "str1--str3");
+
+    /* 放不下时截断并返回错误 */
+    res = core_snprintf(buffer, 8, "%s-%s-%s", src, 3);
+    ASSERT_EQ(res, STATE_USER_INPUT_OUT_RANGE);
+    ASSERT_STR_EQ(buffer, "str1--s");
+    res = core_snprintf(buffer, 10, "%s-%s-%s", src, 3);
+    ASSERT_EQ(res, STATE_USER_INPUT_OUT_RANGE);
+    res = core_snprintf(buffer, 11, "%s-%s-%s", src, 3);
+    ASSERT_EQ(res, 10);
+
+    /* 超过255字节的fmt */
+    memset(fmt, 'a', sizeof(fmt) - 3);
+    memcpy(&fmt[sizeof(fmt) - 3], "%s", 3);
+    ASSERT_EQ(core_sprintf_len(fmt, src, 1), sizeof(fmt) - 3 + 4);
+}
+
+CASE(CORE_UTILS, core_arena_sprintf)
+{
+    extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
+    aiot_sysdep_set_portfile(&g_aiot_sysdep_portfile);
+
+    aiot_sysdep_portfile_t *sysdep = aiot_sysdep_get_portfile();
+    char *first = NULL, *second = NULL, *third = NULL;
+    char *src[] = {"0123456789", "abcdefghij"};
+    CORE_STR_ARENA(arena, 48);
+
+    ASSERT_EQ(core_arena_sprintf(sysdep, &arena, &first, "%s%s", src, 2, "ut"), STATE_SUCCESS);
+    ASSERT_STR_EQ(first, "0123456789abcdefghij");
+    ASSERT_EQ(arena.used, 21);
+    ASSERT_EQ(core_arena_sprintf(sysdep, &arena, &second, "<%s>", src, 1, "ut"), STATE_SUCCESS);
+    ASSERT_STR_EQ(second, "<0123456789>");
+    ASSERT_TRUE(second == arena_buffer + 21);
+
+    /* arena放不下时改用堆, 已分配的结果不受影响 */
+    ASSERT_EQ(core_arena_sprintf(sysdep, &arena, &third, "%s%s", src, 2, "ut"), STATE_SUCCESS);
+    ASSERT_STR_EQ(third, "0123456789abcdefghij");
+    ASSERT_FALSE(third >= arena_buffer && third < arena_buffer + sizeof(arena_buffer));
+    ASSERT_STR_EQ(first, "0123456789abcdefghij");
+
+    /* 不提供sysdep时只使用arena */
+    ASSERT_EQ(core_arena_sprintf(NULL, &arena, &third, "%s%s", src, 2, "ut"), STATE_USER_INPUT_OUT_RANGE);
+
+    core_arena_free(sysdep, &arena, first);
+    core_arena_free(sysdep, &arena, second);
+    core_arena_free(sysdep, &arena, third);
+    aiot_sysdep_set_portfile(NULL);
+}
+
+#define CASE_BINLOG_MAX_MESSAGES    (16)
+
+static char case_binlog_messages[CASE_BINLOG_MAX_MESSAGES][CORE_LOG_MAXLEN + 3];
+static uint32_t case_binlog_messages_num;
+
+static uint64_t case_binlog_time(void)
+{
+    return 1234567;
+}
+
+static int32_t case_binlog_logcb(int32_t code, char *message)
+{
+    if (case_binlog_messages_num < CASE_BINLOG_MAX_MESSAGES) {
+        strcpy(case_binlog_messages[case_binlog_messages_num++], message);
+    }
+    return 0;
+}
+
+static void case_binlog_decode_output(int32_t code, char *message, void *userdata)
+{
+    uint32_t *idx = (uint32_t *)userdata;
+
+    if (*idx < case_binlog_messages_num && strcmp(case_binlog_messages[*idx], message) == 0) {
+        (*idx)++;
+    } else {
+        *idx = CASE_BINLOG_MAX_MESSAGES + 1;
+    }
+}
+
+static int32_t case_binlog_logfilter(int32_t code)
+{
+    return (code == STATE_HTTP_LOG_RECV_CONTENT) ? 0 : 1;
+}
+
+static void case_binlog_emit(void)
+{
+    aiot_sysdep_portfile_t sysdep = {.core_sysdep_time = case_binlog_time};
+    uint32_t port = 1883, len = 5;
+    uint8_t raw[20] = {0x00, 0x01, 0x41, 0x42, 0x7F, 0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70, 0x80, 0x90, 0xA0, 0xB0, 0xC0, 0xD0, 0xE0, 0xF0};
+
+    core_log(&sysdep, STATE_MQTT_LOG_CONNECT, "connect\r\n");
+    core_log2(&sysdep, STATE_MQTT_LOG_CONNECT, "host %s:%d\r\n", "iot-as-mqtt.example.com", &port);
+    core_log2(&sysdep, STATE_HTTP_LOG_RECV_CONTENT, "%.*s\r\n", &len, "payload_ignored");
+    core_log3(&sysdep, STATE_MQTT_LOG_TOPIC, "topic %.*s [%d]\r\n", &len, "/a/b/c/d", &port);
+    core_log2(&sysdep, STATE_MQTT_LOG_TOPIC, "null %s then %s\r\n", NULL, "ignored");
+    core_log1(NULL, STATE_MQTT_LOG_TOPIC, "no prefix %d\r\n", &port);
+    core_log_hexdump(STATE_MQTT_LOG_HEXDUMP, '>', raw, sizeof(raw));
+}
+
+CASE(CORE_UTILS, core_log_binlog)
+{
+    static uint8_t binlog_buffer[1024];
+    uint8_t output[1024];
+    uint32_t dropped = 0, idx = 0, pos = 0;
+    int32_t res = 0, output_len = 0;
+    log_decode_elf_t elf;
+
+    /* 文本模式下的输出作为基准, 被过滤的日志不会调用回调函数 */
+    aiot_state_set_logcb(case_binlog_logcb);
+    aiot_state_set_logfilter(case_binlog_logfilter);
+    case_binlog_messages_num = 0;
+    case_binlog_emit();
+    ASSERT_EQ(case_binlog_messages_num, 9);
+    ASSERT_STR_EQ(case_binlog_messages[1], "[1234.567][LK-0313] host iot-as-mqtt.example.com:1883\r\n");
+    ASSERT_STR_EQ(case_binlog_messages[3], "[1234.567][LK-0309] null %s then %s\r\n");
+
+    ASSERT_EQ(aiot_state_set_binlog(binlog_buffer, 1000), STATE_USER_INPUT_OUT_RANGE);
+    ASSERT_EQ(aiot_state_set_binlog(binlog_buffer, sizeof(binlog_buffer)), STATE_SUCCESS);
+    case_binlog_emit();
+    output_len = aiot_state_binlog_read(output, sizeof(output), &dropped);
+    ASSERT_GT(output_len, 0);
+    ASSERT_EQ(dropped, 0);
+    ASSERT_EQ(aiot_state_binlog_read(output + output_len, sizeof(output) - output_len, NULL), 0);
+
+    /* 用当前可执行文件还原, 结果应与文本模式逐条相同 */
+    ASSERT_EQ(log_decode_elf_load("/proc/self/exe", &elf), 0);
+    while (pos < (uint32_t)output_len) {
+        res = log_decode_record(&elf, &output[pos], output_len - pos, case_binlog_decode_output, &idx);
+        ASSERT_GT(res, 0);
+        pos += res;
+    }
+    log_decode_elf_unload(&elf);
+    ASSERT_EQ(idx, case_binlog_messages_num);
+
+    /* 缓冲区满时丢弃新的日志并计数, 读取后可以继续写入, 记录不会跨越缓冲区末尾 */
+    for (idx = 0; idx < 10; idx++) {
+        case_binlog_emit();
+    }
+    ASSERT_GT(aiot_state_binlog_read(output, 256, &dropped), 0);
+    ASSERT_GT(dropped, 0);
+    for (idx = 0; idx < 10; idx++) {
+        output_len = aiot_state_binlog_read(output, sizeof(output), &dropped);
+        case_binlog_emit();
+    }
+    ASSERT_GT(output_len, 0);
+    ASSERT_EQ(dropped, 0);
+
+    aiot_state_set_binlog(NULL, 0);
+    aiot_state_set_logfilter(NULL);
+    aiot_state_set_logcb(NULL);
+}
+
 int32_t core_json_value(const char *input, uint32_t input_len, const char *key, uint32_t key_len, char **value, uint32_t *value_len);
 
 
@@ -278,8 +472,282 @@ CASE(CORE_UTILS, core_json_value)
     }
 }
 
+CASE(CORE_UTILS, core_json_parse)
+{
+    char *json = "{\"code\":\"1000\",\"data\":{\"size\":432945,\"extData\":{\"url\":\"x\",\"list\":[1,{\"id\":\"a\\\"b\"},[]]},"
+                 "\"url\":\"https://example.com/fw.bin\",\"isDiff\":1},\"id\":1616917612284,\"message\":\"success\"}";
+    char *kv[][2] = {
+        {"code", "1000"},
+        {"data.size", "432945"},
+        {"data.url", "https://example.com/fw.bin"},
+        {"data.extData.url", "x"},
+        {"data.extData.list[0]", "1"},
+        {"data.extData.list[1].id", "a\\\"b"},
+        {"data.extData.list[2]", "[]"},
+        {"data.isDiff", "1"},
+        {"id", "1616917612284"},
+        {"message", "success"},
+    };
+    char *missing[] = {"size", "data.extData.list[3]", "data.size.x", "data[0]", "message.x", "data.extData.lis"};
+    core_json_token_t tokens[32];
+    int32_t tokens_count = 0;
+    char *value = NULL;
+    uint32_t value_len = 0, i = 0;
+
+    tokens_count = core_json_parse(json, strlen(json), tokens, sizeof(tokens) / sizeof(core_json_token_t));
+    ASSERT_EQ(tokens_count, 26);
+    ASSERT_EQ(tokens[0].end, tokens_count);
+
+    for (i = 0; i < sizeof(kv) / sizeof(kv[0]); i++) {
+        ASSERT_EQ(core_json_find(json, tokens, tokens_count, kv[i][0], &value, &value_len), STATE_SUCCESS);
+        ASSERT_EQ(value_len, strlen(kv[i][1]));
+        ASSERT_TRUE(memcmp(value, kv[i][1], value_len) == 0);
+    }
+    for (i = 0; i < sizeof(missing) / sizeof(char *); i++) {
+        ASSERT_EQ(core_json_find(json, tokens, tokens_count, missing[i], &value, &value_len), STATE_USER_INPUT_JSON_PARSE_FAILED);
+    }
+
+    /* 根token为整个对象 */
+    ASSERT_EQ(core_json_find(json, tokens, tokens_count, "", &value, &value_len), STATE_SUCCESS);
+    ASSERT_EQ(value_len, strlen(json));
+
+    ASSERT_EQ(core_json_parse(json, strlen(json), tokens, 25), STATE_USER_INPUT_OUT_RANGE);
+    ASSERT_EQ(core_json_parse(json, strlen(json) - 1, tokens, 32), STATE_USER_INPUT_JSON_PARSE_FAILED);
+    ASSERT_EQ(core_json_parse("{\"a\":[1}", strlen("{\"a\":[1}"), tokens, 32), STATE_USER_INPUT_JSON_PARSE_FAILED);
+    ASSERT_EQ(core_json_parse("{\"a\":\"1}", strlen("{\"a\":\"1}"), tokens, 32), STATE_USER_INPUT_JSON_PARSE_FAILED);
+}
+
+CASE(CORE_UTILS, core_mempool)
+{
+    aiot_sysdep_mempool_stats_t stats[2];
+    void *small[4] = {NULL}, *large[4] = {NULL}, *ptr = NULL;
+    uint32_t i = 0, heap_value = 0;
+
+    /* 默认配置中AT模块为16字节和48字节各4块, 依次为第6和第7个内存池 */
+    ASSERT_EQ(core_mempool_get_stats(6, &stats[0]), STATE_SUCCESS);
+    ASSERT_EQ(core_mempool_get_stats(7, &stats[1]), STATE_SUCCESS);
+    ASSERT_STR_EQ(stats[0].name, "AT");
+    ASSERT_EQ(stats[0].block_size, 16);
+    ASSERT_EQ(stats[1].block_size, 48);
+    ASSERT_EQ(stats[0].used, 0);
+
+    for (i = 0; i < 4; i++) {
+        small[i] = core_mempool_malloc(10, "AT");
+        ASSERT_TRUE(small[i] != NULL);
+    }
+    /* 16字节用完后使用48字节 */
+    for (i = 0; i < 4; i++) {
+        large[i] = core_mempool_malloc(12, "AT");
+        ASSERT_TRUE(large[i] != NULL);
+    }
+    ASSERT_TRUE(core_mempool_malloc(12, "AT") == NULL);
+    ASSERT_TRUE(core_mempool_malloc(49, "AT") == NULL);
+    ASSERT_TRUE(core_mempool_malloc(12, "UNKNOWN") == NULL);
+    ASSERT_TRUE(core_mempool_malloc(12, NULL) == NULL);
+
+    core_mempool_get_stats(6, &stats[0]);
+    core_mempool_get_stats(7, &stats[1]);
+    ASSERT_EQ(stats[0].used, 4);
+    ASSERT_EQ(stats[0].fallback_count, 1);
+    ASSERT_EQ(stats[1].used, 4);
+    ASSERT_EQ(stats[1].high_water, 4);
+    ASSERT_EQ(stats[1].fallback_count, 1);
+
+    ASSERT_EQ(core_mempool_free(&heap_value), 0);
+    for (i = 0; i < 4; i++) {
+        memset(small[i], 0xA5, 16);
+        ASSERT_EQ(core_mempool_free(small[i]), 1);
+        ASSERT_EQ(core_mempool_free(large[i]), 1);
+    }
+
+    /* 释放后重新使用最小一级 */
+    ptr = core_mempool_malloc(16, "AT");
+    ASSERT_TRUE(ptr == small[3]);
+    core_mempool_free(ptr);
+
+    core_mempool_get_stats(7, &stats[1]);
+    ASSERT_EQ(stats[1].used, 0);
+    ASSERT_EQ(stats[1].high_water, 4);
+    ASSERT_EQ(core_mempool_get_stats(100, &stats[0]), STATE_USER_INPUT_OUT_RANGE);
+    ASSERT_EQ(aiot_sysdep_get_mempool_stats(0, NULL), STATE_USER_INPUT_NULL_POINTER);
+}
+
+CASE(CORE_UTILS, core_tls_arena)
+{
+    static uint64_t buffer[4096 / sizeof(uint64_t)];
+    core_tls_arena_t arena;
+    core_tls_arena_stats_t stats;
+    uint8_t *a = NULL, *b = NULL, *c = NULL, *ptr[32] = {NULL};
+    uint32_t len[32] = {0}, i = 0, j = 0, seed = 1, used = 0;
+
+    ASSERT_EQ(core_tls_arena_init(NULL, buffer, sizeof(buffer)), STATE_USER_INPUT_NULL_POINTER);
+    ASSERT_EQ(core_tls_arena_init(&arena, buffer, 16), STATE_USER_INPUT_OUT_RANGE);
+
+    /* 起始地址不对齐时向后对齐, 交给调用者的地址都是8字节对齐 */
+    ASSERT_EQ(core_tls_arena_init(&arena, (uint8_t *)buffer + 3, sizeof(buffer) - 3), STATE_SUCCESS);
+    core_tls_arena_get_stats(&arena, &stats);
+    ASSERT_EQ(stats.size % 8, 0);
+    ASSERT_EQ(stats.largest_free, stats.size);
+
+    memset(buffer, 0xA5, sizeof(buffer) - 8);
+    ASSERT_EQ(core_tls_arena_init(&arena, buffer, sizeof(buffer)), STATE_SUCCESS);
+    a = core_tls_arena_calloc(&arena, 1, 100);
+    b = core_tls_arena_calloc(&arena, 20, 10);
+    c = core_tls_arena_calloc(&arena, 3, 100);
+    ASSERT_TRUE(a != NULL && b != NULL && c != NULL);
+    ASSERT_EQ((uintptr_t)b % 8, 0);
+    for (i = 0; i < 200; i++) {
+        ASSERT_EQ(b[i], 0);
+    }
+    core_tls_arena_get_stats(&arena, &stats);
+    ASSERT_EQ(stats.blocks, 3);
+    ASSERT_EQ(stats.used, 112 + 208 + 312);
+
+    /* 释放的空洞放得下时优先使用它, 而不是切分末尾的大块 */
+    ASSERT_EQ(core_tls_arena_free(&arena, b), 1);
+    ASSERT_EQ(core_tls_arena_free(&arena, b), 0);
+    ASSERT_EQ(core_tls_arena_free(&arena, &stats), 0);
+    ASSERT_TRUE(core_tls_arena_calloc(&arena, 1, 150) == b);
+    core_tls_arena_free(&arena, b);
+
+    /* 与前后的空闲块合并后恢复为一整块 */
+    core_tls_arena_free(&arena, a);
+    core_tls_arena_free(&arena, c);
+    core_tls_arena_get_stats(&arena, &stats);
+    ASSERT_EQ(stats.used, 0);
+    ASSERT_EQ(stats.blocks, 0);
+    ASSERT_EQ(stats.largest_free, stats.size);
+    ASSERT_EQ(stats.peak, 112 + 208 + 312);
+
+    /* 整块用完后申请失败, 记录失败的次数和长度 */
+    a = core_tls_arena_calloc(&arena, 1, stats.size - 8);
+    ASSERT_TRUE(a != NULL);
+    ASSERT_TRUE(core_tls_arena_calloc(&arena, 1, 1) == NULL);
+    core_tls_arena_free(&arena, a);
+    ASSERT_TRUE(core_tls_arena_calloc(&arena, 1, stats.size) == NULL);
+    ASSERT_TRUE(core_tls_arena_calloc(&arena, 0x10000, 0x10000) == NULL);
+    core_tls_arena_get_stats(&arena, &stats);
+    ASSERT_EQ(stats.alloc_failed, 3);
+    ASSERT_EQ(stats.failed_len, 0xFFFFFFFF);
+
+    /* 各阶段的峰值含之前阶段留下的内存, 回到解析证书阶段时清空 */
+    core_tls_arena_set_phase(&arena, CORE_TLS_ARENA_PHASE_CERT_PARSE);
+    a = core_tls_arena_calloc(&arena, 1, 1000);
+    core_tls_arena_set_phase(&arena, CORE_TLS_ARENA_PHASE_KEY_EXCHANGE);
+    b = core_tls_arena_calloc(&arena, 1, 500);
+    c = core_tls_arena_calloc(&arena, 1, 2000);
+    core_tls_arena_free(&arena, b);
+    core_tls_arena_set_phase(&arena, CORE_TLS_ARENA_PHASE_STEADY);
+    core_tls_arena_get_stats(&arena, &stats);
+    ASSERT_EQ(stats.phase[CORE_TLS_ARENA_PHASE_CERT_PARSE].peak, 1008);
+    ASSERT_EQ(stats.phase[CORE_TLS_ARENA_PHASE_CERT_PARSE].allocs, 1);
+    ASSERT_EQ(stats.phase[CORE_TLS_ARENA_PHASE_KEY_EXCHANGE].peak, 1008 + 512 + 2008);
+    ASSERT_EQ(stats.phase[CORE_TLS_ARENA_PHASE_KEY_EXCHANGE].allocs, 2);
+    ASSERT_EQ(stats.phase[CORE_TLS_ARENA_PHASE_STEADY].peak, 1008 + 2008);
+    ASSERT_TRUE(core_tls_arena_calloc(&arena, 1, 4000) == NULL);
+    core_tls_arena_get_stats(&arena, &stats);
+    ASSERT_EQ(stats.phase[CORE_TLS_ARENA_PHASE_STEADY].failed, 1);
+    core_tls_arena_free(&arena, a);
+    core_tls_arena_free(&arena, c);
+    core_tls_arena_set_phase(&arena, CORE_TLS_ARENA_PHASE_CERT_PARSE);
+    core_tls_arena_get_stats(&arena, &stats);
+    ASSERT_EQ(stats.phase[CORE_TLS_ARENA_PHASE_KEY_EXCHANGE].peak, 0);
+
+    /* 随机交错申请和释放, 各块的内容互不覆盖, 全部释放后合并为一整块 */
+    for (i = 0; i < 20000; i++) {
+        seed = seed * 1103515245 + 12345;
+        j = (seed >> 8) % 32;
+        if (ptr[j] != NULL) {
+            for (; len[j] > 0; len[j]--) {
+                ASSERT_EQ(ptr[j][len[j] - 1], (uint8_t)j);
+            }
+            ASSERT_EQ(core_tls_arena_free(&arena, ptr[j]), 1);
+            ptr[j] = NULL;
+            continue;
+        }
+        len[j] = ((seed >> 16) % 8 == 0) ? (seed >> 4) % 1024 + 1 : (seed >> 4) % 64 + 1;
+        ptr[j] = core_tls_arena_calloc(&arena, 1, len[j]);
+        if (ptr[j] == NULL) {
+            len[j] = 0;
+            continue;
+        }
+        memset(ptr[j], (uint8_t)j, len[j]);
+    }
+    for (j = 0, used = 0; j < 32; j++) {
+        used += (ptr[j] != NULL) ? 1 : 0;
+    }
+    core_tls_arena_get_stats(&arena, &stats);
+    ASSERT_EQ(stats.blocks, used);
+    for (j = 0; j < 32; j++) {
+        core_tls_arena_free(&arena, ptr[j]);
+    }
+    core_tls_arena_get_stats(&arena, &stats);
+    ASSERT_EQ(stats.used, 0);
+    ASSERT_EQ(stats.largest_free, stats.size);
+    ASSERT_EQ(core_tls_arena_get_stats(&arena, NULL), STATE_USER_INPUT_NULL_POINTER);
+}
+
+/* linux对接层中的内存统计没有对外的头文件 */
+extern void core_memstat_init(void);
+extern void core_memstat_set_option(uint32_t options);
+extern void core_memstat_deinit(void);
+extern void core_memstat_print_sites(uint32_t top);
+extern int32_t core_memstat_dump_timeline(const char *path);
+extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
+
+CASE(CORE_UTILS, core_memstat)
+{
+    aiot_sysdep_portfile_t *sysdep = &g_aiot_sysdep_portfile;
+    char module_a[] = "memstat-a", *path = "/tmp/core_memstat_test.csv", line[256];
+    void *ptr[3000] = {NULL};
+    long long unsigned int first_in_use = 0, last_in_use = 0;
+    uint32_t i = 0, lines = 0, first_size = 0;
+    FILE *fp = NULL;
+
+    core_memstat_init();
+    core_memstat_set_option(0x03);
+
+    /* 同名但指针不同的模块名要归并到同一个模块 */
+    for (i = 0; i < 3000; i++) {
+        ptr[i] = sysdep->core_sysdep_malloc(i % 97 + 1, (i % 2) ? "memstat-a" : module_a);
+        ASSERT_TRUE(ptr[i] != NULL);
+    }
+    /* 先释放偶数项, 再倒序释放奇数项, 覆盖哈希表删除时的回填 */
+    for (i = 0; i < 3000; i += 2) {
+        sysdep->core_sysdep_free(ptr[i]);
+    }
+    for (i = 2999; i < 3000; i -= 2) {
+        sysdep->core_sysdep_free(ptr[i]);
+    }
+    core_memstat_print_sites(3);
+
+    ASSERT_EQ(core_memstat_dump_timeline(NULL), STATE_PORT_INPUT_NULL_POINTER);
+    ASSERT_EQ(core_memstat_dump_timeline(path), STATE_SUCCESS);
+    fp = fopen(path, "r");
+    ASSERT_TRUE(fp != NULL);
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (lines == 1) {
+            ASSERT_TRUE(strstr(line, ",memstat-a,") != NULL);
+            ASSERT_EQ(sscanf(strchr(strchr(line, 'x'), ',') + 1, "%u,%llu", &first_size, &first_in_use), 2);
+        }
+        if (lines > 0) {
+            ASSERT_EQ(sscanf(strchr(strchr(line, 'x'), ',') + 1, "%*d,%llu", &last_in_use), 1);
+        }
+        lines++;
+    }
+    fclose(fp);
+    remove(path);
+
+    ASSERT_EQ(lines, 1 + 6000);
+    ASSERT_EQ(first_size, 1);
+    ASSERT_EQ(last_in_use, first_in_use - first_size);
+
+    core_memstat_deinit();
+}
+
 SUITE(CORE_UTILS) = {
     ADD_CASE(CORE_UTILS, utils_sha256),
+    ADD_CASE(CORE_UTILS, utils_sha256_vectors),
     ADD_CASE(CORE_UTILS, core_str2uint_normal),
     ADD_CASE(CORE_UTILS, core_str2uint_unormal),
     ADD_CASE(CORE_UTILS, core_uint2str_normal),
@@ -289,7 +757,14 @@ SUITE(CORE_UTILS) = {
     ADD_CASE(CORE_UTILS, core_str2hex),
     ADD_CASE(CORE_UTILS, core_strdup),
     ADD_CASE(CORE_UTILS, core_sprintf),
+    ADD_CASE(CORE_UTILS, core_snprintf),
+    ADD_CASE(CORE_UTILS, core_arena_sprintf),
+    ADD_CASE(CORE_UTILS, core_log_binlog),
     ADD_CASE(CORE_UTILS, core_json_value),
+    ADD_CASE(CORE_UTILS, core_json_parse),
+    ADD_CASE(CORE_UTILS, core_mempool),
+    ADD_CASE(CORE_UTILS, core_tls_arena),
+    ADD_CASE(CORE_UTILS, core_memstat),
     ADD_CASE_NULL
 };
 
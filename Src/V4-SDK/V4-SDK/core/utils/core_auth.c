@@ -7,13 +7,14 @@ int32_t core_auth_tls_psk(aiot_sysdep_portfile_t *sysdep, char **psk_id, char ps
     char *psk_id_src[] = { auth_type, sign_method, product_key, device_name, CORE_AUTH_TIMESTAMP};
     char *psk_plain_text = NULL, *psk_plain_text_src[] = { product_key, device_name, CORE_AUTH_TIMESTAMP};
     uint8_t psk_hex[32] = {0};
+    CORE_STR_ARENA(arena, CORE_AUTH_PLAIN_TEXT_LEN);
 
     res = core_sprintf(sysdep, &tmp_psk_id, "%s|%s|%s&%s|%s", psk_id_src, sizeof(psk_id_src)/sizeof(char *), module_name);
     if (res < STATE_SUCCESS) {
         return res;
     }
 
-    res = core_sprintf(sysdep, &psk_plain_text, "id%s&%stimestamp%s", psk_plain_text_src, sizeof(psk_plain_text_src)/sizeof(char *), module_name);
+    res = core_arena_sprintf(sysdep, &arena, &psk_plain_text, "id%s&%stimestamp%s", psk_plain_text_src, sizeof(psk_plain_text_src)/sizeof(char *), module_name);
     if (res < STATE_SUCCESS) {
         sysdep->core_sysdep_free(tmp_psk_id);
         return res;
@@ -23,7 +24,7 @@ int32_t core_auth_tls_psk(aiot_sysdep_portfile_t *sysdep, char **psk_id, char ps
     core_hex2str(psk_hex, 32, psk, 0);
 
     *psk_id = tmp_psk_id;
-    sysdep->core_sysdep_free(psk_plain_text);
+    core_arena_free(sysdep, &arena, psk_plain_text);
 
     return res;
 }
@@ -41,15 +42,16 @@ int32_t core_auth_mqtt_password(aiot_sysdep_portfile_t *sysdep, char **dest, cha
     char *src[] = { product_key, device_name, device_name, product_key, CORE_AUTH_TIMESTAMP };
     char *plain_text = NULL;
     uint8_t sign[32] = {0};
+    CORE_STR_ARENA(arena, CORE_AUTH_PLAIN_TEXT_LEN);
 
-    res = core_sprintf(sysdep, &plain_text, "clientId%s.%sdeviceName%sproductKey%stimestamp%s", src, sizeof(src)/sizeof(char *), module_name);
+    res = core_arena_sprintf(sysdep, &arena, &plain_text, "clientId%s.%sdeviceName%sproductKey%stimestamp%s", src, sizeof(src)/sizeof(char *), module_name);
     if (res < STATE_SUCCESS) {
         return res;
     }
 
     *dest = sysdep->core_sysdep_malloc(65, module_name);
     if (*dest == NULL) {
-        sysdep->core_sysdep_free(plain_text);
+        core_arena_free(sysdep, &arena, plain_text);
         return STATE_SYS_DEPEND_MALLOC_FAILED;
     }
     memset(*dest, 0, 65);
@@ -58,7 +60,7 @@ int32_t core_auth_mqtt_password(aiot_sysdep_portfile_t *sysdep, char **dest, cha
     core_hex2str(sign, 32, *dest, 0);
 
 		/* TODO */
-    sysdep->core_sysdep_free(plain_text);
+    core_arena_free(sysdep, &arena, plain_text);
 
     return 0;
 }
@@ -77,8 +79,9 @@ int32_t core_auth_http_body(aiot_sysdep_portfile_t *sysdep, char **dest, char *p
     char *plain_text = NULL;
     uint8_t sign_hex[32] = {0};
     char sign_str[65] = {0};
+    CORE_STR_ARENA(arena, CORE_AUTH_PLAIN_TEXT_LEN);
 
-    res = core_sprintf(sysdep, &plain_text, "clientId%s.%sdeviceName%sproductKey%s", sign_ele, 4, module_name);
+    res = core_arena_sprintf(sysdep, &arena, &plain_text, "clientId%s.%sdeviceName%sproductKey%s", sign_ele, 4, module_name);
     if (res < STATE_SUCCESS) {
         return res;
     }
@@ -86,7 +89,7 @@ int32_t core_auth_http_body(aiot_sysdep_portfile_t *sysdep, char **dest, char *p
     core_hmac_sha256((const uint8_t *)plain_text, (uint32_t)strlen(plain_text), (const uint8_t *)device_secret, (uint32_t)strlen(device_secret), sign_hex);
     core_hex2str(sign_hex, 32, sign_str, 0);
 
-    sysdep->core_sysdep_free(plain_text);
+    core_arena_free(sysdep, &arena, plain_text);
     sign_ele[4] = sign_str;
     res = core_sprintf(sysdep,
                        dest,
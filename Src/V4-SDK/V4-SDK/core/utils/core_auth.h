@@ -14,6 +14,9 @@ extern "C" {
 #define CORE_AUTH_SDK_VERSION "sdk-c-4.0.0"
 #define CORE_AUTH_TIMESTAMP   "2524608000000"
 
+/* 签名原文在栈上格式化, 超出此长度时改用堆 */
+#define CORE_AUTH_PLAIN_TEXT_LEN    (256)
+
 int32_t core_auth_tls_psk(aiot_sysdep_portfile_t *sysdep, char **psk_id, char psk[65], char *product_key, char *device_name, char *device_secret, char *module_name);
 int32_t core_auth_mqtt_username(aiot_sysdep_portfile_t *sysdep, char **dest, char *product_key, char *device_name, char *module_name);
 int32_t core_auth_mqtt_password(aiot_sysdep_portfile_t *sysdep, char **dest, char *product_key, char *device_name, char *device_secret, char *module_name);
@@ -12,6 +12,7 @@ extern "C" {
 #include "core_string.h"
 #include "core_log.h"
 #include "core_auth.h"
+#include "core_list.h"
 #include "aiot_http_api.h"
 
 typedef enum {
@@ -32,6 +33,23 @@ typedef struct {
     uint32_t content_total_len;
 } core_http_response_t;
 
+typedef struct {
+    char *product_key;
+    char *device_name;
+    char *token;
+    uint64_t issue_time_ms;
+    uint32_t ttl_ms;
+    uint8_t renewing;
+    uint32_t ref_count;
+    struct core_list_head linked_node;
+} core_http_token_t;
+
+typedef struct {
+    void *mutex;
+    uint32_t used_count;
+    struct core_list_head token_list;
+} core_http_token_global_t;
+
 typedef struct {
     aiot_sysdep_portfile_t *sysdep;
     void *network_handle;
@@ -48,7 +66,9 @@ typedef struct {
     uint32_t header_line_max_len;
     uint32_t body_buffer_max_len;
     aiot_sysdep_network_cred_t *cred;
-    char *token;
+    core_http_token_t *token;
+    uint32_t token_ttl_ms;
+    uint32_t token_renew_margin_ms;
     uint8_t long_connection;
     uint8_t exec_enabled;
     uint32_t exec_count;
@@ -75,6 +95,10 @@ typedef struct {
 #define CORE_HTTP_DEFAULT_HEADER_LINE_MAX_LEN      (128)
 #define CORE_HTTP_DEFAULT_BODY_MAX_LEN             (128)
 #define CORE_HTTP_DEFAULT_DEINIT_TIMEOUT_MS        (2 * 1000)
+#define CORE_HTTP_DEFAULT_TOKEN_TTL_MS             (48 * 60 * 60 * 1000)
+#define CORE_HTTP_DEFAULT_TOKEN_RENEW_MARGIN_MS    (10 * 60 * 1000)
+#define CORE_HTTP_TOKEN_WAIT_INTERVAL_MS           (50)
+#define CORE_HTTP_HEADER_ARENA_LEN                 (384)      /* 请求头在栈上拼接, 超出时改用堆 */
 
 typedef enum {
     CORE_HTTPOPT_HOST,                  /* 数据类型: (char *), 服务器域名, 默认值: iot-as-http.cn-shanghai.aliyuncs.com        */
@@ -1,6 +1,79 @@
 #include "core_log.h"
 
 extern aiot_state_logcb_t g_logcb_handler;
+extern aiot_state_logfilter_t g_logfilter_handler;
+
+/* 二进制日志中的格式字符串以相对此字符串的偏移记录, 主机解码时在ELF文件中按符号名找到它 */
+const char g_core_log_anchor[] = CORE_LOG_BINLOG_ANCHOR;
+
+/* 格式字符串中参数类型的缓存, 每个参数2位, 最多4个, bit8~10为参数个数 */
+#define CORE_LOG_SIG_CACHE_SIZE     (32)
+#define CORE_LOG_SIG_UINT32         (1)
+#define CORE_LOG_SIG_STRING         (2)
+#define CORE_LOG_SIG_PRECISION      (3)
+
+typedef struct {
+    const char *volatile fmt;
+    volatile uint16_t sig;
+} core_log_sig_cache_t;
+
+typedef struct {
+    uint8_t *buffer;
+    uint32_t mask;
+    volatile uint32_t write_idx;
+    volatile uint32_t read_idx;
+    volatile uint32_t dropped;
+    core_log_sig_cache_t sig_cache[CORE_LOG_SIG_CACHE_SIZE];
+} core_log_binlog_t;
+
+static core_log_binlog_t g_core_log_binlog;
+
+/*
+ * 多个任务可以同时写入: 用CAS预留空间, 写完内容后再写记录头, 读取方看到非0的记录头才认为记录完整
+ */
+#if defined(__CC_ARM)
+static uint32_t _core_log_cas(volatile uint32_t *ptr, uint32_t expected, uint32_t desired)
+{
+    do {
+        if (__ldrex(ptr) != expected) {
+            __clrex();
+            return 0;
+        }
+    } while (__strex(desired, ptr) != 0);
+    __dmb(0xF);
+    return 1;
+}
+#define CORE_LOG_CAS(ptr, expected, desired)    _core_log_cas((ptr), (expected), (desired))
+#define CORE_LOG_ATOMIC_INC(ptr)                do { uint32_t old_value; do { old_value = *(ptr); } while (!_core_log_cas((ptr), old_value, old_value + 1)); } while (0)
+#define CORE_LOG_LOAD_ACQUIRE(ptr)              (*(volatile uint32_t *)(ptr))
+#define CORE_LOG_STORE_RELEASE(ptr, value)      do { __dmb(0xF); *(volatile uint32_t *)(ptr) = (value); } while (0)
+#elif defined(__GNUC__)
+static uint32_t _core_log_cas(volatile uint32_t *ptr, uint32_t expected, uint32_t desired)
+{
+    return __atomic_compare_exchange_n(ptr, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED) ? 1 : 0;
+}
+#define CORE_LOG_CAS(ptr, expected, desired)    _core_log_cas((ptr), (expected), (desired))
+#define CORE_LOG_ATOMIC_INC(ptr)                __atomic_fetch_add((ptr), 1, __ATOMIC_RELAXED)
+#define CORE_LOG_LOAD_ACQUIRE(ptr)              __atomic_load_n((volatile uint32_t *)(ptr), __ATOMIC_ACQUIRE)
+#define CORE_LOG_STORE_RELEASE(ptr, value)      __atomic_store_n((volatile uint32_t *)(ptr), (value), __ATOMIC_RELEASE)
+#else
+/* 没有原子操作时只支持单个任务写入 */
+#define CORE_LOG_CAS(ptr, expected, desired)    ((*(ptr) == (expected)) ? ((*(ptr) = (desired)), 1) : 0)
+#define CORE_LOG_ATOMIC_INC(ptr)                ((*(ptr))++)
+#define CORE_LOG_LOAD_ACQUIRE(ptr)              (*(volatile uint32_t *)(ptr))
+#define CORE_LOG_STORE_RELEASE(ptr, value)      (*(volatile uint32_t *)(ptr) = (value))
+#endif
+
+static uint8_t _core_log_enabled(int32_t code)
+{
+    if (g_logcb_handler == NULL && g_core_log_binlog.buffer == NULL) {
+        return 0;
+    }
+    if (g_logfilter_handler != NULL && g_logfilter_handler(code) == 0) {
+        return 0;
+    }
+    return 1;
+}
 
 static void _core_log_append_code(int32_t code, char *buffer)
 {
@@ -27,7 +100,7 @@ static void _core_log_append_prefix(aiot_sysdep_portfile_t *sysdep, int32_t code
 
     core_uint642str(sysdep->core_sysdep_time(), timestamp_str, &timestamp_len);
     if (timestamp_len > 3) {
-        memcpy(&timestamp_str[timestamp_len - 2], &timestamp_str[timestamp_len - 3], 3);
+        memmove(&timestamp_str[timestamp_len - 2], &timestamp_str[timestamp_len - 3], 3);
         timestamp_str[timestamp_len - 3] = '.';
     }
 
@@ -46,7 +119,7 @@ static void _core_log(aiot_sysdep_portfile_t *sysdep, int32_t code, char *buffer
     _core_log_append_prefix(sysdep, code, buffer);
     buffer_idx += strlen(buffer);
 
-    for (idx = 0;idx < strlen(fmt);) {
+    for (idx = 0;fmt[idx] != '\0';) {
         if (buffer_idx >= CORE_LOG_MAXLEN) {
             break;
         }
@@ -90,12 +163,221 @@ static void _core_log(aiot_sysdep_portfile_t *sysdep, int32_t code, char *buffer
     }
 }
 
+static uint16_t _core_log_fmt_sig(const char *fmt)
+{
+    uint16_t sig = 0, count = 0;
+
+    for (; *fmt != '\0' && count < 4; fmt++) {
+        if (fmt[0] != '%') {
+            continue;
+        }
+        if (fmt[1] == 's') {
+            sig |= CORE_LOG_SIG_STRING << (count++ * 2);
+        } else if (fmt[1] == 'd') {
+            sig |= CORE_LOG_SIG_UINT32 << (count++ * 2);
+        } else if (memcmp(fmt, "%.*s", 4) == 0) {
+            sig |= CORE_LOG_SIG_PRECISION << (count++ * 2);
+        }
+    }
+
+    return sig | (count << 8);
+}
+
+static uint16_t _core_log_fmt_sig_cached(const char *fmt)
+{
+    core_log_sig_cache_t *entry = &g_core_log_binlog.sig_cache[((uintptr_t)fmt >> 2) % CORE_LOG_SIG_CACHE_SIZE];
+    uint16_t sig = 0;
+
+    /* 先后两次读到同一个fmt, 说明中间读到的sig没有被其它任务改写一半 */
+    if (entry->fmt == fmt) {
+        sig = entry->sig;
+        if (entry->fmt == fmt) {
+            return sig;
+        }
+    }
+
+    sig = _core_log_fmt_sig(fmt);
+    entry->fmt = NULL;
+    entry->sig = sig;
+    entry->fmt = fmt;
+
+    return sig;
+}
+
+static uint32_t _core_log_strlen(const char *str, uint32_t maxlen)
+{
+    uint32_t len = 0;
+
+    while (len < maxlen && str[len] != '\0') {
+        len++;
+    }
+    return len;
+}
+
+/* 预留len字节(4的倍数), 末尾放不下时先用填充记录占满, 缓冲区满时返回NULL */
+static uint8_t *_core_log_binlog_reserve(uint32_t len)
+{
+    uint32_t write_idx = 0, pos = 0, pad = 0, size = g_core_log_binlog.mask + 1;
+
+    do {
+        write_idx = g_core_log_binlog.write_idx;
+        pos = write_idx & g_core_log_binlog.mask;
+        pad = (size - pos < len) ? (size - pos) : 0;
+        if (write_idx + pad + len - CORE_LOG_LOAD_ACQUIRE(&g_core_log_binlog.read_idx) > size) {
+            CORE_LOG_ATOMIC_INC(&g_core_log_binlog.dropped);
+            return NULL;
+        }
+    } while (CORE_LOG_CAS(&g_core_log_binlog.write_idx, write_idx, write_idx + pad + len) == 0);
+
+    if (pad > 0) {
+        CORE_LOG_STORE_RELEASE(&g_core_log_binlog.buffer[pos],
+                               CORE_LOG_BINLOG_FLAG_MAGIC | CORE_LOG_BINLOG_FLAG_PADDING | (pad << 16));
+    }
+
+    return &g_core_log_binlog.buffer[(write_idx + pad) & g_core_log_binlog.mask];
+}
+
+static void _core_log_binlog_commit(uint8_t *record, aiot_sysdep_portfile_t *sysdep, int32_t code, uint32_t flags,
+                                    uint32_t len, uint32_t word2)
+{
+    uint32_t timestamp = 0;
+
+    if (sysdep != NULL) {
+        timestamp = (uint32_t)sysdep->core_sysdep_time();
+        flags |= CORE_LOG_BINLOG_FLAG_TIMESTAMP;
+    }
+    memcpy(&record[4], &timestamp, sizeof(uint32_t));
+    memcpy(&record[8], &word2, sizeof(uint32_t));
+    CORE_LOG_STORE_RELEASE(record, CORE_LOG_BINLOG_FLAG_MAGIC | flags | (len << 16) | (uint16_t)(-code));
+}
+
+static void _core_log_binlog(aiot_sysdep_portfile_t *sysdep, int32_t code, char *fmt, void *datas[], uint8_t count)
+{
+    uint16_t sig = _core_log_fmt_sig_cached(fmt);
+    uint32_t idx = 0, len = CORE_LOG_BINLOG_HEADER_LEN, arg_idx = 0, arg_len[4] = {0};
+    uint8_t kind[4] = {0}, arg_num = 0, *record = NULL, *pos = NULL;
+    char *value[4] = {NULL};
+
+    /* 与_core_log的取参规则一致: %.*s依次取长度和字符串两个参数, 遇到NULL之后的格式字符串原样输出 */
+    for (idx = 0; idx < (uint32_t)(sig >> 8) && arg_idx < count; idx++) {
+        kind[arg_num] = (sig >> (idx * 2)) & 0x03;
+        if (datas[arg_idx] == NULL) {
+            kind[arg_num++] = CORE_LOG_BINLOG_ARG_NULL;
+            len += 1;
+            break;
+        }
+        if (kind[arg_num] == CORE_LOG_SIG_UINT32) {
+            memcpy(&arg_len[arg_num], datas[arg_idx], sizeof(uint32_t));
+            kind[arg_num] = CORE_LOG_BINLOG_ARG_UINT32;
+            len += 5;
+        } else if (kind[arg_num] == CORE_LOG_SIG_STRING) {
+            value[arg_num] = datas[arg_idx];
+            arg_len[arg_num] = _core_log_strlen(value[arg_num], CORE_LOG_BINLOG_STR_MAXLEN);
+            kind[arg_num] = CORE_LOG_BINLOG_ARG_STRING;
+            len += 2 + arg_len[arg_num];
+        } else {
+            if (arg_idx + 1 >= count) {
+                kind[arg_num++] = CORE_LOG_BINLOG_ARG_NULL;
+                len += 1;
+                break;
+            }
+            value[arg_num] = (datas[arg_idx + 1] == NULL) ? "" : datas[arg_idx + 1];
+            arg_len[arg_num] = (datas[arg_idx + 1] == NULL) ? 0 : *(uint32_t *)datas[arg_idx];
+            arg_len[arg_num] = (arg_len[arg_num] > CORE_LOG_BINLOG_STR_MAXLEN) ? CORE_LOG_BINLOG_STR_MAXLEN : arg_len[arg_num];
+            kind[arg_num] = CORE_LOG_BINLOG_ARG_STRING;
+            len += 2 + arg_len[arg_num];
+            arg_idx++;
+        }
+        arg_idx++;
+        arg_num++;
+    }
+    len = (len + 3) & ~0x03;
+
+    record = _core_log_binlog_reserve(len);
+    if (record == NULL) {
+        return;
+    }
+
+    pos = &record[CORE_LOG_BINLOG_HEADER_LEN];
+    for (idx = 0; idx < arg_num; idx++) {
+        *pos++ = kind[idx];
+        if (kind[idx] == CORE_LOG_BINLOG_ARG_UINT32) {
+            memcpy(pos, &arg_len[idx], sizeof(uint32_t));
+            pos += sizeof(uint32_t);
+        } else if (kind[idx] == CORE_LOG_BINLOG_ARG_STRING) {
+            *pos++ = (uint8_t)arg_len[idx];
+            memcpy(pos, value[idx], arg_len[idx]);
+            pos += arg_len[idx];
+        }
+    }
+    memset(pos, 0, &record[len] - pos);
+
+    _core_log_binlog_commit(record, sysdep, code, 0, len, (uint32_t)((intptr_t)fmt - (intptr_t)g_core_log_anchor));
+}
+
+int32_t core_log_binlog_init(uint8_t *buffer, uint32_t len)
+{
+    if (buffer == NULL) {
+        g_core_log_binlog.buffer = NULL;
+        return STATE_SUCCESS;
+    }
+    if (len < 256 || (len & (len - 1)) != 0 || ((uintptr_t)buffer & 0x03) != 0) {
+        return STATE_USER_INPUT_OUT_RANGE;
+    }
+
+    memset(buffer, 0, len);
+    memset(&g_core_log_binlog, 0, sizeof(core_log_binlog_t));
+    g_core_log_binlog.mask = len - 1;
+    g_core_log_binlog.buffer = buffer;
+
+    return STATE_SUCCESS;
+}
+
+int32_t core_log_binlog_read(uint8_t *buffer, uint32_t len, uint32_t *dropped)
+{
+    uint32_t copied = 0, header = 0, record_len = 0, pos = 0;
+
+    if (g_core_log_binlog.buffer == NULL || buffer == NULL) {
+        return STATE_USER_INPUT_NULL_POINTER;
+    }
+
+    while (g_core_log_binlog.read_idx != g_core_log_binlog.write_idx) {
+        pos = g_core_log_binlog.read_idx & g_core_log_binlog.mask;
+        header = CORE_LOG_LOAD_ACQUIRE(&g_core_log_binlog.buffer[pos]);
+        if (header == 0) {
+            break;
+        }
+        record_len = (header >> 16) & 0x0FFF;
+        if ((header & CORE_LOG_BINLOG_FLAG_PADDING) == 0) {
+            if (copied + record_len > len) {
+                break;
+            }
+            memcpy(&buffer[copied], &g_core_log_binlog.buffer[pos], record_len);
+            copied += record_len;
+        }
+        memset(&g_core_log_binlog.buffer[pos], 0, record_len);
+        CORE_LOG_STORE_RELEASE(&g_core_log_binlog.read_idx, g_core_log_binlog.read_idx + record_len);
+    }
+
+    if (dropped != NULL) {
+        *dropped = g_core_log_binlog.dropped;
+        g_core_log_binlog.dropped = 0;
+    }
+
+    return (int32_t)copied;
+}
+
 void core_log(aiot_sysdep_portfile_t *sysdep, int32_t code, char *data)
 {
     char buffer[CORE_LOG_MAXLEN + 3] = {0};
     uint32_t len = 0;
+    void *datas[] = {data};
 
-    if (g_logcb_handler == NULL) {
+    if (_core_log_enabled(code) == 0) {
+        return;
+    }
+    if (g_core_log_binlog.buffer != NULL) {
+        _core_log_binlog(sysdep, code, "%s", datas, 1);
         return;
     }
 
@@ -113,7 +395,11 @@ void core_log1(aiot_sysdep_portfile_t *sysdep, int32_t code, char *fmt, void *da
     char buffer[CORE_LOG_MAXLEN + 3] = {0};
     void *datas[] = {data};
 
-    if (g_logcb_handler == NULL) {
+    if (_core_log_enabled(code) == 0) {
+        return;
+    }
+    if (g_core_log_binlog.buffer != NULL) {
+        _core_log_binlog(sysdep, code, fmt, datas, sizeof(datas) / sizeof(void *));
         return;
     }
 
@@ -129,7 +415,11 @@ void core_log2(aiot_sysdep_portfile_t *sysdep, int32_t code, char *fmt, void *da
     char buffer[CORE_LOG_MAXLEN + 3] = {0};
     void *datas[] = {data1, data2};
 
-    if (g_logcb_handler == NULL) {
+    if (_core_log_enabled(code) == 0) {
+        return;
+    }
+    if (g_core_log_binlog.buffer != NULL) {
+        _core_log_binlog(sysdep, code, fmt, datas, sizeof(datas) / sizeof(void *));
         return;
     }
 
@@ -145,7 +435,11 @@ void core_log3(aiot_sysdep_portfile_t *sysdep, int32_t code, char *fmt, void *da
     char buffer[CORE_LOG_MAXLEN + 3] = {0};
     void *datas[] = {data1, data2, data3};
 
-    if (g_logcb_handler == NULL) {
+    if (_core_log_enabled(code) == 0) {
+        return;
+    }
+    if (g_core_log_binlog.buffer != NULL) {
+        _core_log_binlog(sysdep, code, fmt, datas, sizeof(datas) / sizeof(void *));
         return;
     }
 
@@ -161,7 +455,11 @@ void core_log4(aiot_sysdep_portfile_t *sysdep, int32_t code, char *fmt, void *da
     char buffer[CORE_LOG_MAXLEN + 3] = {0};
     void *datas[] = {data1, data2, data3, data4};
 
-    if (g_logcb_handler == NULL) {
+    if (_core_log_enabled(code) == 0) {
+        return;
+    }
+    if (g_core_log_binlog.buffer != NULL) {
+        _core_log_binlog(sysdep, code, fmt, datas, sizeof(datas) / sizeof(void *));
         return;
     }
 
@@ -178,7 +476,20 @@ void core_log_hexdump(int32_t code, char prefix, uint8_t *buffer, uint32_t len)
     /* [LK-XXXX] + 1 + 1 + 16*3 + 1 + 1 + 1 + 16 + 2*/
     char hexdump[25 + 72] = {0};
 
-    if (g_logcb_handler == NULL) {
+    if (_core_log_enabled(code) == 0) {
+        return;
+    }
+    if (g_core_log_binlog.buffer != NULL) {
+        uint32_t copy_len = (len > CORE_LOG_BINLOG_HEXDUMP_MAXLEN) ? CORE_LOG_BINLOG_HEXDUMP_MAXLEN : len;
+        uint32_t record_len = (CORE_LOG_BINLOG_HEADER_LEN + 4 + copy_len + 3) & ~0x03;
+        uint8_t *record = _core_log_binlog_reserve(record_len);
+
+        if (record != NULL) {
+            memcpy(&record[CORE_LOG_BINLOG_HEADER_LEN], &len, sizeof(uint32_t));
+            memcpy(&record[CORE_LOG_BINLOG_HEADER_LEN + 4], buffer, copy_len);
+            memset(&record[CORE_LOG_BINLOG_HEADER_LEN + 4 + copy_len], 0, record_len - CORE_LOG_BINLOG_HEADER_LEN - 4 - copy_len);
+            _core_log_binlog_commit(record, NULL, code, CORE_LOG_BINLOG_FLAG_HEXDUMP, record_len, (uint8_t)prefix);
+        }
         return;
     }
 
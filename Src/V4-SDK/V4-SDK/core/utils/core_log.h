@@ -13,12 +13,39 @@ extern "C" {
 #define CORE_LOG_MODULE_NAME "LOG"
 #define CORE_LOG_MAXLEN (160)
 
+/*
+ * 二进制日志记录格式, 所有字段小端, 每条记录4字节对齐且不跨越缓冲区末尾, 由host-tools/log_decode.c解码
+ *
+ * word0: 记录头, bit0~15为(uint16_t)(-code), bit16~27为记录长度(字节), bit28~31为标志
+ * word1: 时间戳的低32位(ms), 仅在CORE_LOG_BINLOG_FLAG_TIMESTAMP置位时有效
+ * word2: 格式字符串相对g_core_log_anchor的偏移(int32_t)
+ * 之后依次为参数: 1字节类型, CORE_LOG_BINLOG_ARG_UINT32后跟4字节数值, CORE_LOG_BINLOG_ARG_STRING后跟1字节长度和字符串内容,
+ *       CORE_LOG_BINLOG_ARG_NULL表示文本模式下该参数为NULL, 之后的格式字符串原样输出
+ *
+ * hexdump记录的word2为前缀字符, 之后为4字节的原始长度和最多CORE_LOG_BINLOG_HEXDUMP_MAXLEN字节的内容
+ */
+#define CORE_LOG_BINLOG_FLAG_MAGIC          (0x80000000)
+#define CORE_LOG_BINLOG_FLAG_TIMESTAMP      (0x40000000)
+#define CORE_LOG_BINLOG_FLAG_PADDING        (0x20000000)
+#define CORE_LOG_BINLOG_FLAG_HEXDUMP        (0x10000000)
+#define CORE_LOG_BINLOG_HEADER_LEN          (12)
+#define CORE_LOG_BINLOG_ARG_UINT32          (0x01)
+#define CORE_LOG_BINLOG_ARG_STRING          (0x02)
+#define CORE_LOG_BINLOG_ARG_NULL            (0xFF)
+#define CORE_LOG_BINLOG_STR_MAXLEN          (32)
+#define CORE_LOG_BINLOG_HEXDUMP_MAXLEN      (64)
+#define CORE_LOG_BINLOG_ANCHOR              "LK-BINLOG-ANCHOR"
+
+extern const char g_core_log_anchor[];
+
 void core_log(aiot_sysdep_portfile_t *sysdep, int32_t code, char *data);
 void core_log1(aiot_sysdep_portfile_t *sysdep, int32_t code, char *fmt, void *data);
 void core_log2(aiot_sysdep_portfile_t *sysdep, int32_t code, char *fmt, void *data1, void *data2);
 void core_log3(aiot_sysdep_portfile_t *sysdep, int32_t code, char *fmt, void *data1, void *data2, void *data3);
 void core_log4(aiot_sysdep_portfile_t *sysdep, int32_t code, char *fmt, void *data1, void *data2, void *data3, void *data4);
 void core_log_hexdump(int32_t code, char prefix, uint8_t *buffer, uint32_t len);
+int32_t core_log_binlog_init(uint8_t *buffer, uint32_t len);
+int32_t core_log_binlog_read(uint8_t *buffer, uint32_t len, uint32_t *dropped);
 
 #if defined(__cplusplus)
 }
@@ -0,0 +1,130 @@
+#include "core_mempool.h"
+
+typedef struct {
+    uint8_t *start;
+    void *free_list;
+    aiot_sysdep_mempool_stats_t stats;
+} core_mempool_t;
+
+static const core_mempool_config_t g_core_mempool_config[] = { CORE_MEMPOOL_CONFIG };
+
+#define CORE_MEMPOOL_NUM    (sizeof(g_core_mempool_config) / sizeof(core_mempool_config_t))
+
+static core_mempool_t g_core_mempool[CORE_MEMPOOL_NUM];
+static uint64_t g_core_mempool_arena[CORE_MEMPOOL_ARENA_LEN / sizeof(uint64_t)];
+static uint8_t g_core_mempool_inited = 0;
+
+/* 空闲块的前4(8)字节保存下一个空闲块的地址 */
+static void _core_mempool_init(void)
+{
+    uint32_t idx = 0, block = 0, offset = 0, block_num = 0, block_size = 0;
+    core_mempool_t *pool = NULL;
+
+    for (idx = 0; idx < CORE_MEMPOOL_NUM; idx++) {
+        pool = &g_core_mempool[idx];
+        block_size = g_core_mempool_config[idx].block_size;
+        block_num = g_core_mempool_config[idx].block_num;
+        while (block_num > 0 && offset + block_size * block_num > sizeof(g_core_mempool_arena)) {
+            block_num--;
+        }
+
+        memset(pool, 0, sizeof(core_mempool_t));
+        pool->start = (uint8_t *)g_core_mempool_arena + offset;
+        pool->stats.name = g_core_mempool_config[idx].name;
+        pool->stats.block_size = block_size;
+        pool->stats.block_num = block_num;
+        for (block = block_num; block > 0; block--) {
+            void **node = (void **)(pool->start + (block - 1) * block_size);
+            *node = pool->free_list;
+            pool->free_list = node;
+        }
+        offset += block_size * block_num;
+    }
+
+    g_core_mempool_inited = 1;
+}
+
+void *core_mempool_malloc(uint32_t size, char *name)
+{
+    uint32_t idx = 0, fit = CORE_MEMPOOL_NUM, last = CORE_MEMPOOL_NUM;
+    core_mempool_t *pool = NULL;
+    void **node = NULL;
+
+    if (name == NULL) {
+        return NULL;
+    }
+    if (g_core_mempool_inited == 0) {
+        _core_mempool_init();
+    }
+
+    for (idx = 0; idx < CORE_MEMPOOL_NUM; idx++) {
+        if (strcmp(g_core_mempool_config[idx].name, name) != 0) {
+            continue;
+        }
+        last = idx;
+        if (fit == CORE_MEMPOOL_NUM && g_core_mempool[idx].stats.block_size >= size) {
+            fit = idx;
+        }
+        if (fit != CORE_MEMPOOL_NUM && g_core_mempool[idx].free_list != NULL) {
+            pool = &g_core_mempool[idx];
+            break;
+        }
+    }
+
+    if (pool == NULL) {
+        if (last != CORE_MEMPOOL_NUM) {
+            g_core_mempool[(fit != CORE_MEMPOOL_NUM) ? fit : last].stats.fallback_count++;
+        }
+        return NULL;
+    }
+
+    node = (void **)pool->free_list;
+    pool->free_list = *node;
+    pool->stats.used++;
+    if (pool->stats.used > pool->stats.high_water) {
+        pool->stats.high_water = pool->stats.used;
+    }
+
+    return node;
+}
+
+uint8_t core_mempool_free(void *ptr)
+{
+    uint32_t idx = 0;
+    core_mempool_t *pool = NULL;
+
+    if (g_core_mempool_inited == 0 || (uint8_t *)ptr < (uint8_t *)g_core_mempool_arena ||
+            (uint8_t *)ptr >= (uint8_t *)g_core_mempool_arena + sizeof(g_core_mempool_arena)) {
+        return 0;
+    }
+
+    for (idx = 0; idx < CORE_MEMPOOL_NUM; idx++) {
+        pool = &g_core_mempool[idx];
+        if ((uint8_t *)ptr >= pool->start && (uint8_t *)ptr < pool->start + pool->stats.block_size * pool->stats.block_num) {
+            *(void **)ptr = pool->free_list;
+            pool->free_list = ptr;
+            pool->stats.used--;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int32_t core_mempool_get_stats(uint32_t index, aiot_sysdep_mempool_stats_t *stats)
+{
+    if (stats == NULL) {
+        return STATE_USER_INPUT_NULL_POINTER;
+    }
+    if (index >= CORE_MEMPOOL_NUM) {
+        return STATE_USER_INPUT_OUT_RANGE;
+    }
+    if (g_core_mempool_inited == 0) {
+        _core_mempool_init();
+    }
+
+    memcpy(stats, &g_core_mempool[index].stats, sizeof(aiot_sysdep_mempool_stats_t));
+
+    return STATE_SUCCESS;
+}
+
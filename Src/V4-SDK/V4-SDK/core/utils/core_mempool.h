@@ -0,0 +1,48 @@
+#ifndef _CORE_MEMPOOL_H_
+#define _CORE_MEMPOOL_H_
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "core_stdinc.h"
+#include "aiot_state_api.h"
+#include "aiot_sysdep_api.h"
+
+/*
+ * 按模块名划分的定长内存池, 供系统适配层的core_sysdep_malloc在调用系统堆之前使用
+ *
+ * 每一项为{模块名, 块大小, 块数量}, 同一模块的各项按块大小从小到大排列. 申请时从该模块中能放下的最小一级开始,
+ * 依次尝试更大的一级, 都没有空闲块时返回NULL, 由调用者改用系统堆. 块大小需为8的倍数.
+ *
+ * 本模块不加锁, 多任务环境下由调用者保证互斥
+ */
+#ifndef CORE_MEMPOOL_CONFIG
+#define CORE_MEMPOOL_CONFIG \
+    { "MQTT", 16, 8 }, { "MQTT", 32, 8 }, { "MQTT", 64, 4 }, { "MQTT", 128, 2 }, \
+    { "HTTP", 16, 4 }, { "HTTP", 64, 4 }, \
+    { "AT",   16, 4 }, { "AT",   48, 4 }, \
+    { "OTA",  32, 4 }, { "OTA",  64, 2 },
+#endif
+
+/* 所有内存池共用的静态内存长度, 放不下的内存池块数量会被截断 */
+#ifndef CORE_MEMPOOL_ARENA_LEN
+#define CORE_MEMPOOL_ARENA_LEN  (2048)
+#endif
+
+typedef struct {
+    char *name;
+    uint16_t block_size;
+    uint16_t block_num;
+} core_mempool_config_t;
+
+void *core_mempool_malloc(uint32_t size, char *name);
+uint8_t core_mempool_free(void *ptr);
+int32_t core_mempool_get_stats(uint32_t index, aiot_sysdep_mempool_stats_t *stats);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
+
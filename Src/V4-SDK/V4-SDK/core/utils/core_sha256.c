@@ -1,6 +1,10 @@
 #include "core_sha256.h"
 
+#if defined(CORE_SHA256_IMPL_MBEDTLS)
+#include "mbedtls/sha256.h"
+#elif !defined(CORE_SHA256_IMPL_UNROLLED)
 #define MINI_SHA256_SMALLER
+#endif
 #define SHA256_KEY_IOPAD_SIZE   (64)
 #define SHA256_DIGEST_SIZE      (32)
 
@@ -71,6 +75,7 @@ void core_sha256_starts(core_sha256_context_t *ctx)
     ctx->is224 = is224;
 }
 
+#if !defined(CORE_SHA256_IMPL_MBEDTLS)
 static const uint32_t K[] = {
     0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
     0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
@@ -115,6 +120,19 @@ static const uint32_t K[] = {
         d += temp1; h = temp1 + temp2;              \
     }
 
+#endif /* !CORE_SHA256_IMPL_MBEDTLS */
+
+#if defined(CORE_SHA256_IMPL_MBEDTLS)
+void core_sha256_process(core_sha256_context_t *ctx, const unsigned char data[64])
+{
+    mbedtls_sha256_context mbedtls_ctx;
+
+    /* 已经链接了mbedtls时直接复用其压缩函数, 两者的state布局一致, 不必再链接一份SHA256实现 */
+    memcpy(mbedtls_ctx.state, ctx->state, sizeof(ctx->state));
+    mbedtls_sha256_process(&mbedtls_ctx, data);
+    memcpy(ctx->state, mbedtls_ctx.state, sizeof(ctx->state));
+}
+#else
 void core_sha256_process(core_sha256_context_t *ctx, const unsigned char data[64])
 {
     uint32_t temp1, temp2, W[64];
@@ -177,6 +195,8 @@ void core_sha256_process(core_sha256_context_t *ctx, const unsigned char data[64
         ctx->state[i] += A[i];
     }
 }
+#endif /* CORE_SHA256_IMPL_MBEDTLS */
+
 void core_sha256_update(core_sha256_context_t *ctx, const unsigned char *input, uint32_t ilen)
 {
     size_t fill;
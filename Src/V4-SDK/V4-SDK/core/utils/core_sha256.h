@@ -12,6 +12,18 @@ extern "C" {
 #define CORE_SHA256_SHORT_BLOCK_LENGTH       (CORE_SHA256_BLOCK_LENGTH - 8)
 #define CORE_SHA256_DIGEST_STRING_LENGTH     (CORE_SHA256_DIGEST_LENGTH * 2 + 1)
 
+/*
+ * 压缩函数的实现在编译时选择, 通过build.settings中的EXT_CFLAGS定义:
+ *
+ * 默认                         循环实现, 代码最小
+ * CORE_SHA256_IMPL_UNROLLED    展开8轮的实现, 代码约为循环实现的两倍
+ * CORE_SHA256_IMPL_MBEDTLS     复用mbedtls的mbedtls_sha256_process, 适用于已经链接了mbedtls的固件
+ *
+ * 三者的上下文结构相同, 已经保存的断点(aiot_download_checkpoint_t)在不同实现之间通用
+ * 各实现在主机上的速度和代码大小可以用 make digest-bench 比较. 在x86主机上展开实现与循环实现的速度差别
+ * 不超过测量的波动, 因此默认使用代码最小的循环实现; 展开实现在目标平台上是否更快需要在目标上实测
+ */
+
 /**
  * \brief          SHA-256 context structure
  */
@@ -150,48 +150,111 @@ int32_t core_strdup(aiot_sysdep_portfile_t *sysdep, char **dest, char *src, char
     return STATE_SUCCESS;
 }
 
+/*
+ * 按fmt一次遍历格式化, 只支持%s, 第n个%s取src[n], 多出的%s或NULL按空字符串处理.
+ * buffer为NULL时只计算长度. 返回完整结果的长度(不含结尾的'\0'), 超出buffer_len - 1的部分不写入
+ */
+static uint32_t _core_sprintf(char *buffer, uint32_t buffer_len, char *fmt, char *src[], uint8_t count)
+{
+    uint32_t pos = 0, value_len = 0, copy_len = 0, limit = 0;
+    uint8_t percent_idx = 0;
+    char *value = NULL;
+
+    limit = (buffer == NULL || buffer_len == 0) ? 0 : (buffer_len - 1);
+    for (; *fmt != '\0'; fmt++) {
+        if (fmt[0] == '%' && fmt[1] == 's') {
+            value = (percent_idx < count && src[percent_idx] != NULL) ? src[percent_idx] : "";
+            value_len = (uint32_t)strlen(value);
+            if (pos < limit) {
+                copy_len = (value_len < limit - pos) ? value_len : (limit - pos);
+                memcpy(&buffer[pos], value, copy_len);
+            }
+            pos += value_len;
+            percent_idx++;
+            fmt++;
+        } else {
+            if (pos < limit) {
+                buffer[pos] = *fmt;
+            }
+            pos++;
+        }
+    }
+    if (buffer != NULL && buffer_len > 0) {
+        buffer[(pos < limit) ? pos : limit] = '\0';
+    }
+
+    return pos;
+}
+
+uint32_t core_sprintf_len(char *fmt, char *src[], uint8_t count)
+{
+    return _core_sprintf(NULL, 0, fmt, src, count);
+}
+
+int32_t core_snprintf(char *buffer, uint32_t buffer_len, char *fmt, char *src[], uint8_t count)
+{
+    uint32_t len = 0;
+
+    if (buffer == NULL || fmt == NULL) {
+        return STATE_USER_INPUT_NULL_POINTER;
+    }
+
+    len = _core_sprintf(buffer, buffer_len, fmt, src, count);
+    if (len >= buffer_len) {
+        return STATE_USER_INPUT_OUT_RANGE;
+    }
+
+    return (int32_t)len;
+}
+
 int32_t core_sprintf(aiot_sysdep_portfile_t *sysdep, char **dest, char *fmt, char *src[], uint8_t count, char *module_name)
 {
-    char *buffer = NULL, *value = NULL;
-    uint8_t idx = 0, percent_idx = 0;
+    char *buffer = NULL;
     uint32_t buffer_len = 0;
 
-    buffer_len += strlen(fmt) - 2 * count;
-    for (percent_idx = 0;percent_idx < count;percent_idx++) {
-        value = (*(src + percent_idx) == NULL)?(""):(*(src + percent_idx));
-        buffer_len += strlen(value);
-    }
-
-		uint32_t remain_heap_len = xPortGetMinimumEverFreeHeapSize();
-		if(remain_heap_len != 0) {
-		  osDelay(1);
-		}
-		remain_heap_len = xPortGetFreeHeapSize();
-		if(remain_heap_len != 0) {
-		  osDelay(1);
-		}
-				
-		
-    buffer = sysdep->core_sysdep_malloc(buffer_len + 1, module_name);
+    buffer_len = core_sprintf_len(fmt, src, count) + 1;
+    buffer = sysdep->core_sysdep_malloc(buffer_len, module_name);
     if (buffer == NULL) {
         return STATE_SYS_DEPEND_MALLOC_FAILED;
     }
-    memset(buffer, 0, buffer_len + 1);
+    _core_sprintf(buffer, buffer_len, fmt, src, count);
 
-    for (idx = 0, percent_idx = 0;idx < strlen(fmt);) {
-        if (fmt[idx] == '%' && fmt[idx+1] == 's') {
-            value = (*(src + percent_idx) == NULL)?(""):(*(src + percent_idx));
-            memcpy(buffer + strlen(buffer), value, strlen(value));
-            percent_idx++;
-            idx+=2;
-        }else{
-            buffer[strlen(buffer)] = fmt[idx++];
-        }
-    }
     *dest = buffer;
     return STATE_SUCCESS;
 }
 
+int32_t core_arena_sprintf(aiot_sysdep_portfile_t *sysdep, core_str_arena_t *arena, char **dest, char *fmt, char *src[],
+                           uint8_t count, char *module_name)
+{
+    uint32_t len = 0;
+
+    if (arena == NULL || arena->used >= arena->len) {
+        return (sysdep == NULL) ? STATE_USER_INPUT_OUT_RANGE : core_sprintf(sysdep, dest, fmt, src, count, module_name);
+    }
+
+    /* 直接写入arena的剩余空间, 放不下时再决定是否改用堆 */
+    len = _core_sprintf(&arena->buffer[arena->used], arena->len - arena->used, fmt, src, count);
+    if (len >= arena->len - arena->used) {
+        arena->buffer[arena->used] = '\0';
+        return (sysdep == NULL) ? STATE_USER_INPUT_OUT_RANGE : core_sprintf(sysdep, dest, fmt, src, count, module_name);
+    }
+
+    *dest = &arena->buffer[arena->used];
+    arena->used += len + 1;
+    return STATE_SUCCESS;
+}
+
+void core_arena_free(aiot_sysdep_portfile_t *sysdep, core_str_arena_t *arena, char *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+    if (arena != NULL && ptr >= arena->buffer && ptr < arena->buffer + arena->len) {
+        return;
+    }
+    sysdep->core_sysdep_free(ptr);
+}
+
 int32_t core_json_value(const char *input, uint32_t input_len, const char *key, uint32_t key_len, char **value, uint32_t *value_len)
 {
     uint32_t idx = 0;
@@ -246,3 +309,146 @@ int32_t core_json_value(const char *input, uint32_t input_len, const char *key,
     return STATE_USER_INPUT_JSON_PARSE_FAILED;
 }
 
+static int32_t _core_json_token(core_json_token_t *tokens, uint32_t tokens_num, uint32_t *count, uint8_t type,
+                                uint32_t start, uint32_t len)
+{
+    if (*count >= tokens_num || *count >= 0xFFFF) {
+        return STATE_USER_INPUT_OUT_RANGE;
+    }
+    tokens[*count].start = start;
+    tokens[*count].len = len;
+    tokens[*count].type = type;
+    tokens[*count].end = (uint16_t)(*count + 1);
+    (*count)++;
+    return STATE_SUCCESS;
+}
+
+/**
+ * 只扫描一遍输入, 不检查逗号和冒号的位置. 尚未闭合的对象和数组用len暂存其父token的下标, 闭合时再写入真正的长度
+ */
+int32_t core_json_parse(const char *input, uint32_t input_len, core_json_token_t *tokens, uint32_t tokens_num)
+{
+    int32_t res = STATE_SUCCESS;
+    uint32_t idx = 0, start = 0, count = 0, parent = 0xFFFFFFFF;
+
+    for (idx = 0; idx < input_len && res == STATE_SUCCESS; idx++) {
+        switch (input[idx]) {
+            case '{':
+            case '[': {
+                res = _core_json_token(tokens, tokens_num, &count, (input[idx] == '{') ? CORE_JSON_OBJECT : CORE_JSON_ARRAY,
+                                       idx, parent);
+                parent = count - 1;
+            }
+            break;
+            case '}':
+            case ']': {
+                if (parent == 0xFFFFFFFF ||
+                        tokens[parent].type != ((input[idx] == '}') ? CORE_JSON_OBJECT : CORE_JSON_ARRAY)) {
+                    return STATE_USER_INPUT_JSON_PARSE_FAILED;
+                }
+                start = parent;
+                parent = tokens[start].len;
+                tokens[start].len = idx - tokens[start].start + 1;
+                tokens[start].end = (uint16_t)count;
+            }
+            break;
+            case '"': {
+                for (start = ++idx; idx < input_len && input[idx] != '"'; idx++) {
+                    if (input[idx] == '\\') {
+                        idx++;
+                    }
+                }
+                if (idx >= input_len) {
+                    return STATE_USER_INPUT_JSON_PARSE_FAILED;
+                }
+                res = _core_json_token(tokens, tokens_num, &count, CORE_JSON_STRING, start, idx - start);
+            }
+            break;
+            case ' ':
+            case '\t':
+            case '\r':
+            case '\n':
+            case ':':
+            case ',': {
+            }
+            break;
+            default: {
+                for (start = idx; idx + 1 < input_len; idx++) {
+                    char next = input[idx + 1];
+                    if (next == ',' || next == '}' || next == ']' || next == ':' || next == ' ' || next == '\t' ||
+                            next == '\r' || next == '\n') {
+                        break;
+                    }
+                }
+                res = _core_json_token(tokens, tokens_num, &count, CORE_JSON_PRIMITIVE, start, idx - start + 1);
+            }
+            break;
+        }
+    }
+
+    if (res != STATE_SUCCESS) {
+        return res;
+    }
+    if (parent != 0xFFFFFFFF || count == 0) {
+        return STATE_USER_INPUT_JSON_PARSE_FAILED;
+    }
+
+    return (int32_t)count;
+}
+
+/**
+ * path由"."分隔的键和"[n]"形式的数组下标组成, 例如"data.url"或"params.list[1].id", 空字符串表示根token.
+ *
+ * 同一层的兄弟之间通过end跳转, 查找一次最多访问tokens_count个token
+ */
+int32_t core_json_find(const char *input, core_json_token_t *tokens, uint32_t tokens_count, const char *path, char **value,
+                       uint32_t *value_len)
+{
+    uint32_t idx = 0, child = 0, key_len = 0, array_idx = 0;
+
+    if (input == NULL || tokens == NULL || tokens_count == 0 || path == NULL || value == NULL || value_len == NULL) {
+        return STATE_USER_INPUT_NULL_POINTER;
+    }
+
+    while (*path != '\0') {
+        if (*path == '[') {
+            for (array_idx = 0, path++; *path >= '0' && *path <= '9'; path++) {
+                array_idx = array_idx * 10 + (*path - '0');
+            }
+            if (*path++ != ']' || tokens[idx].type != CORE_JSON_ARRAY) {
+                return STATE_USER_INPUT_JSON_PARSE_FAILED;
+            }
+            for (child = idx + 1; child < tokens[idx].end && array_idx > 0; array_idx--) {
+                child = tokens[child].end;
+            }
+        } else {
+            if (*path == '.') {
+                path++;
+            }
+            for (key_len = 0; path[key_len] != '\0' && path[key_len] != '.' && path[key_len] != '['; key_len++);
+            if (tokens[idx].type != CORE_JSON_OBJECT) {
+                return STATE_USER_INPUT_JSON_PARSE_FAILED;
+            }
+            for (child = idx + 1; child + 1 < tokens[idx].end; child = tokens[child + 1].end) {
+                if (tokens[child].type == CORE_JSON_STRING && tokens[child].len == key_len &&
+                        memcmp(&input[tokens[child].start], path, key_len) == 0) {
+                    break;
+                }
+            }
+            if (child + 1 >= tokens[idx].end) {
+                return STATE_USER_INPUT_JSON_PARSE_FAILED;
+            }
+            child++;
+            path += key_len;
+        }
+        if (child >= tokens[idx].end || child >= tokens_count) {
+            return STATE_USER_INPUT_JSON_PARSE_FAILED;
+        }
+        idx = child;
+    }
+
+    *value = (char *)&input[tokens[idx].start];
+    *value_len = tokens[idx].len;
+
+    return STATE_SUCCESS;
+}
@@ -9,6 +9,44 @@ extern "C" {
 #include "aiot_state_api.h"
 #include "aiot_sysdep_api.h"
 
+/**
+ * @brief 作用域内的字符串arena, 通常定义在栈上, 离开作用域时整体释放
+ *
+ * @details
+ *
+ * core_arena_sprintf依次从buffer中分配, 放不下时改用堆, 用core_arena_free释放结果即可, 不必区分来源
+ */
+typedef struct {
+    char *buffer;
+    uint32_t len;
+    uint32_t used;
+} core_str_arena_t;
+
+#define CORE_STR_ARENA(name, size) \
+    char name##_buffer[size]; \
+    core_str_arena_t name = { name##_buffer, size, 0 }
+
+#define CORE_JSON_OBJECT        (0)
+#define CORE_JSON_ARRAY         (1)
+#define CORE_JSON_STRING        (2)
+#define CORE_JSON_PRIMITIVE     (3)
+
+/**
+ * @brief core_json_parse输出的token, 按在输入中出现的先后顺序排列
+ *
+ * @details
+ *
+ * 对象的子token依次为键和值, end是该token及其所有子孙之后的第一个token的下标, 查找时据此跳过不关心的子树.
+ *
+ * 字符串的start和len不含引号且不做转义还原, 对象和数组包含括号
+ */
+typedef struct {
+    uint32_t start;
+    uint32_t len;
+    uint16_t end;
+    uint8_t type;
+} core_json_token_t;
+
 int32_t core_str2uint(char *input, uint8_t input_len, uint32_t *output);
 int32_t core_uint2str(uint32_t input, char *output, uint8_t *output_len);
 int32_t core_uint642str(uint64_t input, char *output, uint8_t *output_len);
@@ -17,7 +55,15 @@ int32_t core_hex2str(uint8_t *input, uint32_t input_len, char *output, uint8_t l
 int32_t core_str2hex(char *input, uint32_t input_len, uint8_t *output);
 int32_t core_strdup(aiot_sysdep_portfile_t *sysdep, char **dest, char *src, char *module_name);
 int32_t core_sprintf(aiot_sysdep_portfile_t *sysdep, char **dest, char *fmt, char *src[], uint8_t count, char *module_name);
+uint32_t core_sprintf_len(char *fmt, char *src[], uint8_t count);
+int32_t core_snprintf(char *buffer, uint32_t buffer_len, char *fmt, char *src[], uint8_t count);
+int32_t core_arena_sprintf(aiot_sysdep_portfile_t *sysdep, core_str_arena_t *arena, char **dest, char *fmt, char *src[],
+                           uint8_t count, char *module_name);
+void core_arena_free(aiot_sysdep_portfile_t *sysdep, core_str_arena_t *arena, char *ptr);
 int32_t core_json_value(const char *input, uint32_t input_len, const char *key, uint32_t key_len, char **value, uint32_t *value_len);
+int32_t core_json_parse(const char *input, uint32_t input_len, core_json_token_t *tokens, uint32_t tokens_num);
+int32_t core_json_find(const char *input, core_json_token_t *tokens, uint32_t tokens_count, const char *path, char **value,
+                       uint32_t *value_len);
 
 #if defined(__cplusplus)
 }
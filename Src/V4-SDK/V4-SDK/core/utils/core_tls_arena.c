@@ -0,0 +1,319 @@
+#include "core_tls_arena.h"
+
+/*
+ * 块头部为物理上前一块的长度和本块的长度, 长度都含头部且为8的倍数, 本块长度的低两位用作标志.
+ * 空闲块在头部之后保存所在链表的前后节点, 使用中的块从这里开始交给调用者
+ */
+struct core_tls_arena_block {
+    uint32_t prev_size;
+    uint32_t size;
+    core_tls_arena_block_t *next_free;
+    core_tls_arena_block_t *prev_free;
+};
+
+#define CORE_TLS_ARENA_ALIGN            (8)
+#define CORE_TLS_ARENA_HEADER_LEN       (2 * sizeof(uint32_t))
+#define CORE_TLS_ARENA_MIN_BLOCK        ((sizeof(core_tls_arena_block_t) + CORE_TLS_ARENA_ALIGN - 1) & ~(CORE_TLS_ARENA_ALIGN - 1))
+#define CORE_TLS_ARENA_SMALL_BLOCK      (1 << (CORE_TLS_ARENA_SL_LOG2 + 3))
+
+#define CORE_TLS_ARENA_BLOCK_FREE       (0x01)
+#define CORE_TLS_ARENA_PREV_FREE        (0x02)
+#define CORE_TLS_ARENA_SIZE(block)      ((block)->size & ~(uint32_t)(CORE_TLS_ARENA_ALIGN - 1))
+#define CORE_TLS_ARENA_NEXT(block)      ((core_tls_arena_block_t *)((uint8_t *)(block) + CORE_TLS_ARENA_SIZE(block)))
+#define CORE_TLS_ARENA_PREV(block)      ((core_tls_arena_block_t *)((uint8_t *)(block) - (block)->prev_size))
+
+/* 最高的置位比特的序号, x不为0 */
+static uint32_t _core_tls_arena_fls(uint32_t x)
+{
+    uint32_t bit = 0;
+
+    if (x & 0xFFFF0000) {
+        x >>= 16;
+        bit += 16;
+    }
+    if (x & 0xFF00) {
+        x >>= 8;
+        bit += 8;
+    }
+    if (x & 0xF0) {
+        x >>= 4;
+        bit += 4;
+    }
+    if (x & 0x0C) {
+        x >>= 2;
+        bit += 2;
+    }
+    if (x & 0x02) {
+        bit += 1;
+    }
+
+    return bit;
+}
+
+/* 最低的置位比特的序号, x不为0 */
+static uint32_t _core_tls_arena_ffs(uint32_t x)
+{
+    return _core_tls_arena_fls(x & (~x + 1));
+}
+
+/* 小于CORE_TLS_ARENA_SMALL_BLOCK的块按8字节一级放在第0个一级索引中, 其余按最高比特分一级, 再按之后的比特等分二级 */
+static void _core_tls_arena_mapping(uint32_t size, uint32_t *fl, uint32_t *sl)
+{
+    uint32_t bit = 0;
+
+    if (size < CORE_TLS_ARENA_SMALL_BLOCK) {
+        *fl = 0;
+        *sl = size / CORE_TLS_ARENA_ALIGN;
+        return;
+    }
+
+    bit = _core_tls_arena_fls(size);
+    *sl = (size >> (bit - CORE_TLS_ARENA_SL_LOG2)) ^ (1 << CORE_TLS_ARENA_SL_LOG2);
+    *fl = bit - (CORE_TLS_ARENA_SL_LOG2 + 2);
+}
+
+static void _core_tls_arena_insert(core_tls_arena_t *arena, core_tls_arena_block_t *block)
+{
+    uint32_t fl = 0, sl = 0;
+
+    _core_tls_arena_mapping(CORE_TLS_ARENA_SIZE(block), &fl, &sl);
+    block->prev_free = NULL;
+    block->next_free = arena->free_list[fl][sl];
+    if (block->next_free != NULL) {
+        block->next_free->prev_free = block;
+    }
+    arena->free_list[fl][sl] = block;
+    arena->fl_bitmap |= (1U << fl);
+    arena->sl_bitmap[fl] |= (1U << sl);
+}
+
+static void _core_tls_arena_remove(core_tls_arena_t *arena, core_tls_arena_block_t *block)
+{
+    uint32_t fl = 0, sl = 0;
+
+    _core_tls_arena_mapping(CORE_TLS_ARENA_SIZE(block), &fl, &sl);
+    if (block->next_free != NULL) {
+        block->next_free->prev_free = block->prev_free;
+    }
+    if (block->prev_free != NULL) {
+        block->prev_free->next_free = block->next_free;
+    } else {
+        arena->free_list[fl][sl] = block->next_free;
+        if (block->next_free == NULL) {
+            arena->sl_bitmap[fl] &= ~(1U << sl);
+            if (arena->sl_bitmap[fl] == 0) {
+                arena->fl_bitmap &= ~(1U << fl);
+            }
+        }
+    }
+}
+
+/*
+ * 查找的长度先向上取到所在二级的上界, 找到的链表中任意一块都放得下. 这样找不到时再在本级链表中逐个查找放得下的块,
+ * 否则最大的空闲块只比申请长度略大时, 比如内存区按记录缓冲区刚好留足时, 会申请失败
+ */
+static core_tls_arena_block_t *_core_tls_arena_find(core_tls_arena_t *arena, uint32_t size)
+{
+    uint32_t fl = 0, sl = 0, map = 0, rounded = size;
+    core_tls_arena_block_t *block = NULL;
+
+    if (size >= CORE_TLS_ARENA_SMALL_BLOCK) {
+        rounded += (1U << (_core_tls_arena_fls(size) - CORE_TLS_ARENA_SL_LOG2)) - 1;
+    }
+    _core_tls_arena_mapping(rounded, &fl, &sl);
+    if (fl < CORE_TLS_ARENA_FL_NUM) {
+        map = arena->sl_bitmap[fl] & (~0U << sl);
+        if (map == 0) {
+            map = arena->fl_bitmap & (~0U << (fl + 1));
+            if (map != 0) {
+                fl = _core_tls_arena_ffs(map);
+                map = arena->sl_bitmap[fl];
+            }
+        }
+        if (map != 0) {
+            return arena->free_list[fl][_core_tls_arena_ffs(map)];
+        }
+    }
+
+    _core_tls_arena_mapping(size, &fl, &sl);
+    if (fl >= CORE_TLS_ARENA_FL_NUM) {
+        return NULL;
+    }
+    for (block = arena->free_list[fl][sl]; block != NULL; block = block->next_free) {
+        if (CORE_TLS_ARENA_SIZE(block) >= size) {
+            return block;
+        }
+    }
+
+    return NULL;
+}
+
+int32_t core_tls_arena_init(core_tls_arena_t *arena, void *buffer, uint32_t len)
+{
+    core_tls_arena_block_t *block = NULL, *sentinel = NULL;
+    uint8_t *start = NULL;
+
+    if (arena == NULL || buffer == NULL) {
+        return STATE_USER_INPUT_NULL_POINTER;
+    }
+
+    start = (uint8_t *)(((uintptr_t)buffer + CORE_TLS_ARENA_ALIGN - 1) & ~(uintptr_t)(CORE_TLS_ARENA_ALIGN - 1));
+    if (len < (uint32_t)(start - (uint8_t *)buffer) + CORE_TLS_ARENA_MIN_BLOCK + CORE_TLS_ARENA_HEADER_LEN) {
+        return STATE_USER_INPUT_OUT_RANGE;
+    }
+    len = (len - (uint32_t)(start - (uint8_t *)buffer)) & ~(uint32_t)(CORE_TLS_ARENA_ALIGN - 1);
+    if (len - CORE_TLS_ARENA_HEADER_LEN >= (1UL << CORE_TLS_ARENA_MAX_LOG2)) {
+        return STATE_USER_INPUT_OUT_RANGE;
+    }
+
+    memset(arena, 0, sizeof(core_tls_arena_t));
+    arena->start = start;
+    arena->end = start + len;
+    arena->stats.size = len - CORE_TLS_ARENA_HEADER_LEN;
+
+    /* 末尾是一个长度为0的使用中的块, 合并时不会越过内存区 */
+    block = (core_tls_arena_block_t *)start;
+    block->prev_size = 0;
+    block->size = arena->stats.size | CORE_TLS_ARENA_BLOCK_FREE;
+    sentinel = CORE_TLS_ARENA_NEXT(block);
+    sentinel->prev_size = arena->stats.size;
+    sentinel->size = CORE_TLS_ARENA_PREV_FREE;
+    _core_tls_arena_insert(arena, block);
+    arena->stats.largest_free = arena->stats.size;
+
+    return STATE_SUCCESS;
+}
+
+void *core_tls_arena_calloc(core_tls_arena_t *arena, uint32_t n, uint32_t size)
+{
+    core_tls_arena_block_t *block = NULL, *rest = NULL;
+    core_tls_arena_phase_stats_t *phase = NULL;
+    uint32_t len = 0, block_len = 0;
+
+    if (arena == NULL || arena->start == NULL || n == 0 || size == 0) {
+        return NULL;
+    }
+
+    phase = &arena->stats.phase[arena->phase];
+    phase->allocs++;
+    len = (n > 0xFFFFFFFF / size) ? 0xFFFFFFFF : n * size;
+    if (len <= arena->stats.size) {
+        block_len = (len + CORE_TLS_ARENA_HEADER_LEN + CORE_TLS_ARENA_ALIGN - 1) & ~(uint32_t)(CORE_TLS_ARENA_ALIGN - 1);
+        if (block_len < CORE_TLS_ARENA_MIN_BLOCK) {
+            block_len = CORE_TLS_ARENA_MIN_BLOCK;
+        }
+        block = _core_tls_arena_find(arena, block_len);
+    }
+    if (block == NULL) {
+        phase->failed++;
+        arena->stats.alloc_failed++;
+        arena->stats.failed_len = len;
+        return NULL;
+    }
+    _core_tls_arena_remove(arena, block);
+
+    /* 余下的部分够一个最小块时切出来放回空闲链表, 否则整块交给调用者 */
+    if (CORE_TLS_ARENA_SIZE(block) - block_len >= CORE_TLS_ARENA_MIN_BLOCK) {
+        rest = (core_tls_arena_block_t *)((uint8_t *)block + block_len);
+        rest->prev_size = block_len;
+        rest->size = (CORE_TLS_ARENA_SIZE(block) - block_len) | CORE_TLS_ARENA_BLOCK_FREE;
+        CORE_TLS_ARENA_NEXT(rest)->prev_size = CORE_TLS_ARENA_SIZE(rest);
+        block->size = block_len | (block->size & CORE_TLS_ARENA_PREV_FREE);
+        _core_tls_arena_insert(arena, rest);
+    } else {
+        block->size &= ~(uint32_t)CORE_TLS_ARENA_BLOCK_FREE;
+        CORE_TLS_ARENA_NEXT(block)->size &= ~(uint32_t)CORE_TLS_ARENA_PREV_FREE;
+    }
+
+    arena->stats.used += CORE_TLS_ARENA_SIZE(block);
+    arena->stats.blocks++;
+    if (arena->stats.used > arena->stats.peak) {
+        arena->stats.peak = arena->stats.used;
+    }
+    if (arena->stats.used > phase->peak) {
+        phase->peak = arena->stats.used;
+    }
+
+    memset((uint8_t *)block + CORE_TLS_ARENA_HEADER_LEN, 0, len);
+
+    return (uint8_t *)block + CORE_TLS_ARENA_HEADER_LEN;
+}
+
+/* ptr不属于内存区或已经释放时返回0 */
+uint8_t core_tls_arena_free(core_tls_arena_t *arena, void *ptr)
+{
+    core_tls_arena_block_t *block = NULL, *next = NULL;
+
+    if (arena == NULL || arena->start == NULL || (uint8_t *)ptr < arena->start + CORE_TLS_ARENA_HEADER_LEN ||
+        (uint8_t *)ptr >= arena->end || ((uintptr_t)ptr & (CORE_TLS_ARENA_ALIGN - 1)) != 0) {
+        return 0;
+    }
+
+    block = (core_tls_arena_block_t *)((uint8_t *)ptr - CORE_TLS_ARENA_HEADER_LEN);
+    if ((block->size & CORE_TLS_ARENA_BLOCK_FREE) || CORE_TLS_ARENA_SIZE(block) == 0) {
+        return 0;
+    }
+    arena->stats.used -= CORE_TLS_ARENA_SIZE(block);
+    arena->stats.blocks--;
+
+    next = CORE_TLS_ARENA_NEXT(block);
+    if (next->size & CORE_TLS_ARENA_BLOCK_FREE) {
+        _core_tls_arena_remove(arena, next);
+        block->size += CORE_TLS_ARENA_SIZE(next);
+    }
+    if (block->size & CORE_TLS_ARENA_PREV_FREE) {
+        next = block;
+        block = CORE_TLS_ARENA_PREV(block);
+        _core_tls_arena_remove(arena, block);
+        block->size += CORE_TLS_ARENA_SIZE(next);
+    }
+
+    block->size |= CORE_TLS_ARENA_BLOCK_FREE;
+    next = CORE_TLS_ARENA_NEXT(block);
+    next->prev_size = CORE_TLS_ARENA_SIZE(block);
+    next->size |= CORE_TLS_ARENA_PREV_FREE;
+    _core_tls_arena_insert(arena, block);
+
+    return 1;
+}
+
+void core_tls_arena_set_phase(core_tls_arena_t *arena, core_tls_arena_phase_t phase)
+{
+    if (arena == NULL || phase >= CORE_TLS_ARENA_PHASE_MAX) {
+        return;
+    }
+
+    if (phase == CORE_TLS_ARENA_PHASE_CERT_PARSE) {
+        memset(arena->stats.phase, 0, sizeof(arena->stats.phase));
+    }
+    arena->phase = phase;
+    if (arena->stats.used > arena->stats.phase[phase].peak) {
+        arena->stats.phase[phase].peak = arena->stats.used;
+    }
+}
+
+int32_t core_tls_arena_get_stats(core_tls_arena_t *arena, core_tls_arena_stats_t *stats)
+{
+    core_tls_arena_block_t *block = NULL;
+    uint32_t fl = 0;
+
+    if (arena == NULL || stats == NULL) {
+        return STATE_USER_INPUT_NULL_POINTER;
+    }
+
+    /* 最大的空闲块在最高的非空一级链表中, 同一链表中的块长度不同, 需要逐个比较 */
+    arena->stats.largest_free = 0;
+    if (arena->fl_bitmap != 0) {
+        fl = _core_tls_arena_fls(arena->fl_bitmap);
+        block = arena->free_list[fl][_core_tls_arena_fls(arena->sl_bitmap[fl])];
+        for (; block != NULL; block = block->next_free) {
+            if (CORE_TLS_ARENA_SIZE(block) > arena->stats.largest_free) {
+                arena->stats.largest_free = CORE_TLS_ARENA_SIZE(block);
+            }
+        }
+    }
+
+    memcpy(stats, &arena->stats, sizeof(core_tls_arena_stats_t));
+
+    return STATE_SUCCESS;
+}
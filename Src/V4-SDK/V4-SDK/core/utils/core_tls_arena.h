@@ -0,0 +1,80 @@
+#ifndef _CORE_TLS_ARENA_H_
+#define _CORE_TLS_ARENA_H_
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "core_stdinc.h"
+#include "aiot_state_api.h"
+
+/*
+ * TLS专用的静态内存区, 由对接层交给mbedtls_platform_set_calloc_free, 不再占用系统堆
+ *
+ * 一次握手中mbedtls会申请数百块大小不一的小内存(大数、ASN.1解析结果等), 与记录缓冲区交错申请和释放, 直接使用
+ * FreeRTOS的小堆时会把堆切碎. 本模块按TLSF的方式管理调用者提供的一块静态内存: 空闲块按长度分到两级索引的链表中,
+ * 用位图查找, 申请和释放通常是常数时间, 释放时与物理上相邻的空闲块合并. 每块有8字节的头部, 按8字节对齐
+ *
+ * 使用量按阶段分别统计, 阶段由对接层在建立连接的各个步骤切换, 切换到CORE_TLS_ARENA_PHASE_CERT_PARSE时清空上一次
+ * 连接的阶段统计
+ *
+ * 本模块不加锁, 多任务环境下由调用者保证互斥
+ */
+
+/* 内存区长度的上限为2的CORE_TLS_ARENA_MAX_LOG2次方, 决定一级索引的数量 */
+#ifndef CORE_TLS_ARENA_MAX_LOG2
+#define CORE_TLS_ARENA_MAX_LOG2     (17)
+#endif
+
+#define CORE_TLS_ARENA_SL_LOG2      (2)
+#define CORE_TLS_ARENA_FL_NUM       (CORE_TLS_ARENA_MAX_LOG2 - CORE_TLS_ARENA_SL_LOG2 - 2)
+#define CORE_TLS_ARENA_SL_NUM       (1 << CORE_TLS_ARENA_SL_LOG2)
+
+typedef enum {
+    CORE_TLS_ARENA_PHASE_CERT_PARSE,    /* 解析证书、私钥和PSK */
+    CORE_TLS_ARENA_PHASE_KEY_EXCHANGE,  /* 从申请记录缓冲区到握手结束 */
+    CORE_TLS_ARENA_PHASE_STEADY,        /* 握手结束后收发应用数据直到断开 */
+    CORE_TLS_ARENA_PHASE_MAX
+} core_tls_arena_phase_t;
+
+typedef struct {
+    uint32_t peak;          /* 该阶段内存区使用量的峰值, 含之前阶段留下的常驻内存 */
+    uint32_t allocs;        /* 该阶段的申请次数 */
+    uint32_t failed;        /* 该阶段申请失败的次数 */
+} core_tls_arena_phase_stats_t;
+
+typedef struct {
+    uint32_t size;          /* 可分配的总长度 */
+    uint32_t used;          /* 使用中的长度, 含块头部 */
+    uint32_t blocks;        /* 使用中的块数量 */
+    uint32_t peak;          /* 初始化以来used的最大值 */
+    uint32_t largest_free;  /* 当前最大空闲块的长度, 含块头部, 与size - used的差距反映碎片化程度 */
+    uint32_t alloc_failed;  /* 初始化以来申请失败的次数 */
+    uint32_t failed_len;    /* 最近一次申请失败时的申请长度 */
+    core_tls_arena_phase_stats_t phase[CORE_TLS_ARENA_PHASE_MAX];
+} core_tls_arena_stats_t;
+
+typedef struct core_tls_arena_block core_tls_arena_block_t;
+
+typedef struct {
+    uint8_t *start;
+    uint8_t *end;
+    core_tls_arena_phase_t phase;
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmap[CORE_TLS_ARENA_FL_NUM];
+    core_tls_arena_block_t *free_list[CORE_TLS_ARENA_FL_NUM][CORE_TLS_ARENA_SL_NUM];
+    core_tls_arena_stats_t stats;
+} core_tls_arena_t;
+
+int32_t core_tls_arena_init(core_tls_arena_t *arena, void *buffer, uint32_t len);
+void *core_tls_arena_calloc(core_tls_arena_t *arena, uint32_t n, uint32_t size);
+uint8_t core_tls_arena_free(core_tls_arena_t *arena, void *ptr);
+void core_tls_arena_set_phase(core_tls_arena_t *arena, core_tls_arena_phase_t phase);
+int32_t core_tls_arena_get_stats(core_tls_arena_t *arena, core_tls_arena_stats_t *stats);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
+
@@ -57,10 +57,13 @@
  * Maximum window size used for modular exponentiation. Default: 6
  * Minimum value: 1. Maximum value: 6.
  *
- * Result is an array of ( 2 << MBEDTLS_MPI_WINDOW_SIZE ) MPIs used
- * for the sliding window calculation. (So 64 by default)
+ * Result is an array of ( 1 << MBEDTLS_MPI_WINDOW_SIZE ) MPIs on the stack
+ * of mbedtls_mpi_exp_mod(), of which the upper half is allocated for the
+ * sliding window calculation. (So 64 by default, 32 of them allocated)
  *
- * Reduction in size, reduces speed.
+ * Reduction in size, reduces speed. Only exponents longer than 671 bits use
+ * a window of 6 and only exponents longer than 239 bits use a window of 5,
+ * so public key operations (e = 65537) are not affected at all.
  */
 #define MBEDTLS_MPI_WINDOW_SIZE                           6        /**< Maximum windows size used. */
 #endif /* !MBEDTLS_MPI_WINDOW_SIZE */
@@ -160,6 +160,11 @@
 
 #if defined(__amd64__) || defined (__x86_64__)
 
+/*
+ * The carry stays in rcx and r8 holds zero for the adc, so *d is read once
+ * and written once per limb. MULADDC_HUIT handles eight limbs with fixed
+ * offsets and a single pointer update.
+ */
 #define MULADDC_INIT                        \
     asm(                                    \
         "xorq   %%r8, %%r8          \n\t"
@@ -167,19 +172,87 @@
 #define MULADDC_CORE                        \
         "movq   (%%rsi), %%rax      \n\t"   \
         "mulq   %%rbx               \n\t"   \
-        "addq   $8,      %%rsi      \n\t"   \
         "addq   %%rcx,   %%rax      \n\t"   \
-        "movq   %%r8,    %%rcx      \n\t"   \
-        "adcq   $0,      %%rdx      \n\t"   \
-        "nop                        \n\t"   \
-        "addq   %%rax,   (%%rdi)    \n\t"   \
-        "adcq   %%rdx,   %%rcx      \n\t"   \
+        "adcq   %%r8,    %%rdx      \n\t"   \
+        "addq   (%%rdi), %%rax      \n\t"   \
+        "adcq   %%r8,    %%rdx      \n\t"   \
+        "movq   %%rax,   (%%rdi)    \n\t"   \
+        "movq   %%rdx,   %%rcx      \n\t"   \
+        "addq   $8,      %%rsi      \n\t"   \
         "addq   $8,      %%rdi      \n\t"
 
+#define MULADDC_HUIT                        \
+        "movq   (%%rsi), %%rax      \n\t"   \
+        "mulq   %%rbx               \n\t"   \
+        "addq   %%rcx,   %%rax      \n\t"   \
+        "adcq   %%r8,    %%rdx      \n\t"   \
+        "addq   (%%rdi), %%rax      \n\t"   \
+        "adcq   %%r8,    %%rdx      \n\t"   \
+        "movq   %%rax,   (%%rdi)    \n\t"   \
+        "movq   %%rdx,   %%rcx      \n\t"   \
+        "movq   8(%%rsi), %%rax     \n\t"   \
+        "mulq   %%rbx               \n\t"   \
+        "addq   %%rcx,   %%rax      \n\t"   \
+        "adcq   %%r8,    %%rdx      \n\t"   \
+        "addq   8(%%rdi), %%rax     \n\t"   \
+        "adcq   %%r8,    %%rdx      \n\t"   \
+        "movq   %%rax,   8(%%rdi)   \n\t"   \
+        "movq   %%rdx,   %%rcx      \n\t"   \
+        "movq   16(%%rsi), %%rax    \n\t"   \
+        "mulq   %%rbx               \n\t"   \
+        "addq   %%rcx,   %%rax      \n\t"   \
+        "adcq   %%r8,    %%rdx      \n\t"   \
+        "addq   16(%%rdi), %%rax    \n\t"   \
+        "adcq   %%r8,    %%rdx      \n\t"   \
+        "movq   %%rax,   16(%%rdi)  \n\t"   \
+        "movq   %%rdx,   %%rcx      \n\t"   \
+        "movq   24(%%rsi), %%rax    \n\t"   \
+        "mulq   %%rbx               \n\t"   \
+        "addq   %%rcx,   %%rax      \n\t"   \
+        "adcq   %%r8,    %%rdx      \n\t"   \
+        "addq   24(%%rdi), %%rax    \n\t"   \
+        "adcq   %%r8,    %%rdx      \n\t"   \
+        "movq   %%rax,   24(%%rdi)  \n\t"   \
+        "movq   %%rdx,   %%rcx      \n\t"   \
+        "movq   32(%%rsi), %%rax    \n\t"   \
+        "mulq   %%rbx               \n\t"   \
+        "addq   %%rcx,   %%rax      \n\t"   \
+        "adcq   %%r8,    %%rdx      \n\t"   \
+        "addq   32(%%rdi), %%rax    \n\t"   \
+        "adcq   %%r8,    %%rdx      \n\t"   \
+        "movq   %%rax,   32(%%rdi)  \n\t"   \
+        "movq   %%rdx,   %%rcx      \n\t"   \
+        "movq   40(%%rsi), %%rax    \n\t"   \
+        "mulq   %%rbx               \n\t"   \
+        "addq   %%rcx,   %%rax      \n\t"   \
+        "adcq   %%r8,    %%rdx      \n\t"   \
+        "addq   40(%%rdi), %%rax    \n\t"   \
+        "adcq   %%r8,    %%rdx      \n\t"   \
+        "movq   %%rax,   40(%%rdi)  \n\t"   \
+        "movq   %%rdx,   %%rcx      \n\t"   \
+        "movq   48(%%rsi), %%rax    \n\t"   \
+        "mulq   %%rbx               \n\t"   \
+        "addq   %%rcx,   %%rax      \n\t"   \
+        "adcq   %%r8,    %%rdx      \n\t"   \
+        "addq   48(%%rdi), %%rax    \n\t"   \
+        "adcq   %%r8,    %%rdx      \n\t"   \
+        "movq   %%rax,   48(%%rdi)  \n\t"   \
+        "movq   %%rdx,   %%rcx      \n\t"   \
+        "movq   56(%%rsi), %%rax    \n\t"   \
+        "mulq   %%rbx               \n\t"   \
+        "addq   %%rcx,   %%rax      \n\t"   \
+        "adcq   %%r8,    %%rdx      \n\t"   \
+        "addq   56(%%rdi), %%rax    \n\t"   \
+        "adcq   %%r8,    %%rdx      \n\t"   \
+        "movq   %%rax,   56(%%rdi)  \n\t"   \
+        "movq   %%rdx,   %%rcx      \n\t"   \
+        "addq   $64,     %%rsi      \n\t"   \
+        "addq   $64,     %%rdi      \n\t"
+
 #define MULADDC_STOP                        \
         : "+c" (c), "+D" (d), "+S" (s)      \
         : "b" (b)                           \
-        : "rax", "rdx", "r8"                \
+        : "rax", "rdx", "r8", "cc", "memory" \
     );
 
 #endif /* AMD64 */
@@ -565,16 +638,18 @@
  * x !=0, which we can detect using __OPTIMIZE__ (which is also defined by
  * clang and armcc5 under the same conditions).
  *
- * So, only use the optimized assembly below for optimized build, which avoids
- * the build error and is pretty reasonable anyway.
+ * So, only use the Thumb-1 assembly below for optimized build, which avoids
+ * the build error and is pretty reasonable anyway. The Thumb-2 and ARM
+ * variants do not need r7 and are used at any optimization level.
  */
 #if defined(__GNUC__) && !defined(__OPTIMIZE__)
 #define MULADDC_CANNOT_USE_R7
 #endif
 
-#if defined(__arm__) && !defined(MULADDC_CANNOT_USE_R7)
+#if defined(__arm__)
 
 #if defined(__thumb__) && !defined(__thumb2__)
+#if !defined(MULADDC_CANNOT_USE_R7)
 
 #define MULADDC_INIT                                    \
     asm(                                                \
@@ -629,32 +704,54 @@
            "r6", "r7", "r8", "r9", "cc"         \
          );
 
+#endif /* !MULADDC_CANNOT_USE_R7 */
+
+#elif defined(__ARM_ARCH) && __ARM_ARCH >= 6 && defined(__ARM_FEATURE_DSP)
+
+/*
+ * ARMv6 and later with the DSP extension (Cortex-M4/M7, Cortex-A): UMAAL adds
+ * both the carry and *d to the 64-bit product in one instruction, so the
+ * carry never goes through the flags.
+ */
+#define MULADDC_INIT                                    \
+    asm(
+
+#define MULADDC_CORE                                    \
+            "ldr    r0, [%2], #4                \n\t"   \
+            "ldr    r1, [%1]                    \n\t"   \
+            "umaal  r1, %0, %3, r0              \n\t"   \
+            "str    r1, [%1], #4                \n\t"
+
+#define MULADDC_STOP                                    \
+         : "+r" (c),  "+r" (d), "+r" (s)        \
+         : "r" (b)                              \
+         : "r0", "r1", "memory"                 \
+         );
+
 #else
 
+/*
+ * Thumb-2 without the DSP extension (Cortex-M3, ARMv7-M) and plain ARM mode:
+ * UMAAL is not available, use UMLAL for b * *s + c and add *d by hand. The
+ * operands stay in registers chosen by the compiler and r7 is not touched,
+ * so this variant is also usable at -O0.
+ */
 #define MULADDC_INIT                                    \
-    asm(                                                \
-            "ldr    r0, %3                      \n\t"   \
-            "ldr    r1, %4                      \n\t"   \
-            "ldr    r2, %5                      \n\t"   \
-            "ldr    r3, %6                      \n\t"
+    asm(
 
 #define MULADDC_CORE                                    \
-            "ldr    r4, [r0], #4                \n\t"   \
-            "mov    r5, #0                      \n\t"   \
-            "ldr    r6, [r1]                    \n\t"   \
-            "umlal  r2, r5, r3, r4              \n\t"   \
-            "adds   r7, r6, r2                  \n\t"   \
-            "adc    r2, r5, #0                  \n\t"   \
-            "str    r7, [r1], #4                \n\t"
+            "ldr    r0, [%2], #4                \n\t"   \
+            "mov    r1, #0                      \n\t"   \
+            "ldr    r2, [%1]                    \n\t"   \
+            "umlal  %0, r1, %3, r0              \n\t"   \
+            "adds   r2, r2, %0                  \n\t"   \
+            "adc    %0, r1, #0                  \n\t"   \
+            "str    r2, [%1], #4                \n\t"
 
 #define MULADDC_STOP                                    \
-            "str    r2, %0                      \n\t"   \
-            "str    r1, %1                      \n\t"   \
-            "str    r0, %2                      \n\t"   \
-         : "=m" (c),  "=m" (d), "=m" (s)        \
-         : "m" (s), "m" (d), "m" (c), "m" (b)   \
-         : "r0", "r1", "r2", "r3", "r4", "r5",  \
-           "r6", "r7", "cc"                     \
+         : "+r" (c),  "+r" (d), "+r" (s)        \
+         : "r" (b)                              \
+         : "r0", "r1", "r2", "memory", "cc"     \
          );
 
 #endif /* Thumb */
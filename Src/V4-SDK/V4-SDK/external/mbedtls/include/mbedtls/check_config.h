@@ -69,6 +69,15 @@
 #error "MBEDTLS_AESNI_C defined, but not all prerequisites"
 #endif
 
+#if defined(MBEDTLS_AES_FEWER_TABLES) && defined(MBEDTLS_AES_SBOX_ONLY)
+#error "MBEDTLS_AES_FEWER_TABLES and MBEDTLS_AES_SBOX_ONLY cannot be defined simultaneously"
+#endif
+
+#if defined(MBEDTLS_SSL_ETM_CHUNK_LEN) &&                                 \
+    ( MBEDTLS_SSL_ETM_CHUNK_LEN <= 0 || MBEDTLS_SSL_ETM_CHUNK_LEN % 16 != 0 )
+#error "MBEDTLS_SSL_ETM_CHUNK_LEN must be a positive multiple of 16"
+#endif
+
 #if defined(MBEDTLS_CTR_DRBG_C) && !defined(MBEDTLS_AES_C)
 #error "MBEDTLS_CTR_DRBG_C defined, but not all prerequisites"
 #endif
@@ -51,6 +51,13 @@
  *      library/padlock.c
  *      include/mbedtls/bn_mul.h
  *
+ * In bn_mul.h this selects the multiply-accumulate kernel used by all bignum
+ * arithmetic (RSA, DHM, ECP): UMLAL on Cortex-M3 and other ARMv7-M cores
+ * without the DSP extension, UMAAL on Cortex-M4/M7 and ARMv6+ A-profile
+ * cores, and an 8-limb unrolled kernel on x86-64 hosts. Can also be enabled
+ * with -DMBEDTLS_HAVE_ASM on the compiler command line, host-tools/rsa_bench.sh
+ * compares both builds.
+ *
  * Comment to disable the use of assembly code.
  */
 //#define MBEDTLS_HAVE_ASM
@@ -418,10 +425,39 @@
  *
  * Store the AES tables in ROM.
  *
+ * Without it the tables are generated into RAM on the first key setup
+ * (8.5 KB with the full T-tables). In ROM they cost no RAM and no startup
+ * time, but every table lookup pays the flash wait states, e.g. two on an
+ * STM32F1 running at 72 MHz.
+ *
  * Uncomment this macro to store the AES tables in ROM.
  */
 //#define MBEDTLS_AES_ROM_TABLES
 
+/**
+ * \def MBEDTLS_AES_FEWER_TABLES
+ *
+ * Keep one T-table per direction instead of four and derive the other three
+ * by byte rotation, cutting the tables from 8.5 KB to 2.5 KB. On ARM the
+ * rotation folds into the XOR, so this is close to free on Cortex-M.
+ *
+ * Uncomment this macro to use less memory for the AES tables.
+ */
+//#define MBEDTLS_AES_FEWER_TABLES
+
+/**
+ * \def MBEDTLS_AES_SBOX_ONLY
+ *
+ * Drop the T-tables altogether and compute MixColumns arithmetically, so
+ * that only the two 256-byte S-boxes remain. Encryption is about 1.5 times
+ * and decryption about 2.5 times slower than with the T-tables.
+ *
+ * Cannot be combined with MBEDTLS_AES_FEWER_TABLES.
+ *
+ * Uncomment this macro for the smallest AES tables.
+ */
+//#define MBEDTLS_AES_SBOX_ONLY
+
 /**
  * \def MBEDTLS_CAMELLIA_SMALL_MEMORY
  *
@@ -1077,6 +1113,9 @@
  * on the padding or underlying cipher.
  *
  * This only affects CBC ciphersuites, and is useless if none is defined.
+ * The device's PSK suite is CBC, and a record failing the MAC is dropped
+ * before it is decrypted. Outgoing records are encrypted and MAC'd in a
+ * single pass, see MBEDTLS_SSL_ETM_CHUNK_LEN.
  *
  * Requires: MBEDTLS_SSL_PROTO_TLS1    or
  *           MBEDTLS_SSL_PROTO_TLS1_1  or
@@ -1084,7 +1123,7 @@
  *
  * Comment this macro to disable support for Encrypt-then-MAC
  */
-//#define MBEDTLS_SSL_ENCRYPT_THEN_MAC
+#define MBEDTLS_SSL_ENCRYPT_THEN_MAC
 
 /** \def MBEDTLS_SSL_EXTENDED_MASTER_SECRET
  *
@@ -2585,6 +2624,7 @@
  */
 
 /* MPI / BIGNUM options */
+/* Window size only matters for private key operations, see host-tools/rsa_bench.sh for the speed/heap trade-off */
 //#define MBEDTLS_MPI_WINDOW_SIZE            6 /**< Maximum windows size used. */
 //#define MBEDTLS_MPI_MAX_SIZE            1024 /**< Maximum number of bytes for usable MPIs. */
 
@@ -2649,7 +2689,30 @@
 //#define MBEDTLS_SSL_CACHE_DEFAULT_MAX_ENTRIES      50 /**< Maximum entries in cache */
 
 /* SSL options */
+/*
+ * Record buffer profiles, select one with -DMBEDTLS_SSL_BUFFER_PROFILE=<n>:
+ *
+ *   0  16384 in / 16384 out (default, works with any server)
+ *   1   4096 in /  4096 out (server must honour max_fragment_length)
+ *   2   4096 in /  1024 out (server must honour max_fragment_length)
+ *
+ * The incoming buffer must still hold the largest handshake message, i.e. the
+ * server certificate chain, since handshake messages spanning several records
+ * are not reassembled in TLS mode.
+ */
+#if !defined(MBEDTLS_SSL_BUFFER_PROFILE) || (MBEDTLS_SSL_BUFFER_PROFILE == 0)
 #define MBEDTLS_SSL_MAX_CONTENT_LEN               16384 /**< Maxium fragment length in bytes, determines the size of each of the two internal I/O buffers */
+#elif MBEDTLS_SSL_BUFFER_PROFILE == 1
+#define MBEDTLS_SSL_MAX_CONTENT_LEN                4096
+#elif MBEDTLS_SSL_BUFFER_PROFILE == 2
+#define MBEDTLS_SSL_MAX_CONTENT_LEN                4096
+#define MBEDTLS_SSL_OUT_CONTENT_LEN                1024
+#else
+#error "Unknown MBEDTLS_SSL_BUFFER_PROFILE"
+#endif
+//#define MBEDTLS_SSL_IN_CONTENT_LEN              16384 /**< Maximum length of incoming plaintext fragments, defaults to MBEDTLS_SSL_MAX_CONTENT_LEN */
+//#define MBEDTLS_SSL_OUT_CONTENT_LEN             16384 /**< Maximum length of outgoing plaintext fragments, defaults to MBEDTLS_SSL_MAX_CONTENT_LEN */
+//#define MBEDTLS_SSL_ETM_CHUNK_LEN                 256 /**< Bytes encrypted and MAC'd per step of an Encrypt-then-MAC record, a multiple of 16 */
 //#define MBEDTLS_SSL_DEFAULT_TICKET_LIFETIME     86400 /**< Lifetime of session tickets (if enabled) */
 #define MBEDTLS_PSK_MAX_LEN                 64 /**< Max size of TLS pre-shared keys, in bytes (default 256 bits) */
 //#define MBEDTLS_SSL_COOKIE_TIMEOUT        60 /**< Default expiration delay of DTLS cookies, in seconds if HAVE_TIME, or in number of cookies issued */
@@ -2694,6 +2757,28 @@
 
 /* \} name SECTION: Customisation configuration options */
 
+/*
+ * ECC handshake profile, enable with -DMBEDTLS_SSL_ECC_PROFILE:
+ *
+ * Adds TLS-ECDHE-ECDSA-WITH-AES-128-GCM-SHA256 on secp256r1 next to the RSA
+ * suites. An ECDSA P-256 signature check and a P-256 key exchange cost the
+ * device far less than the 2048-bit exponentiations of an RSA handshake,
+ * and the server certificate chain is smaller. Only secp256r1 is built,
+ * with its fixed-base comb table kept in flash (MBEDTLS_ECP_FIXED_POINT_OPTIM)
+ * and the fast reduction modulo p.
+ */
+#if defined(MBEDTLS_SSL_ECC_PROFILE)
+#define MBEDTLS_ECP_DP_SECP256R1_ENABLED
+#define MBEDTLS_ECP_NIST_OPTIM
+#define MBEDTLS_KEY_EXCHANGE_ECDHE_ECDSA_ENABLED
+#define MBEDTLS_ASN1_WRITE_C
+#define MBEDTLS_ECDH_C
+#define MBEDTLS_ECDSA_C
+#define MBEDTLS_ECP_C
+#define MBEDTLS_GCM_C
+#define MBEDTLS_ECP_MAX_BITS             256
+#endif /* MBEDTLS_SSL_ECC_PROFILE */
+
 /* Target and application specific configurations */
 //#define YOTTA_CFG_MBEDTLS_TARGET_CONFIG_FILE "mbedtls/target_config.h"
 
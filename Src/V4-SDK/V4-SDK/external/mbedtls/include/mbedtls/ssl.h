@@ -222,6 +222,30 @@
 #define MBEDTLS_SSL_MAX_CONTENT_LEN         16384   /**< Size of the input / output buffer */
 #endif
 
+/*
+ * The input and output buffers can be sized separately. Each defaults to
+ * MBEDTLS_SSL_MAX_CONTENT_LEN. The size of the input buffer is also the
+ * largest max_fragment_length a client may negotiate.
+ */
+#if !defined(MBEDTLS_SSL_IN_CONTENT_LEN)
+#define MBEDTLS_SSL_IN_CONTENT_LEN          MBEDTLS_SSL_MAX_CONTENT_LEN
+#endif
+
+#if !defined(MBEDTLS_SSL_OUT_CONTENT_LEN)
+#define MBEDTLS_SSL_OUT_CONTENT_LEN         MBEDTLS_SSL_MAX_CONTENT_LEN
+#endif
+
+/*
+ * With Encrypt-then-MAC, outgoing CBC records are encrypted and MAC'd in
+ * chunks of this many bytes in a single pass. Must be a multiple of the
+ * cipher block size; a multiple of 64 also feeds the MAC whole hash blocks.
+ * A value of at least MBEDTLS_SSL_OUT_CONTENT_LEN encrypts the whole record
+ * before the MAC reads it back, as without the chunking.
+ */
+#if !defined(MBEDTLS_SSL_ETM_CHUNK_LEN)
+#define MBEDTLS_SSL_ETM_CHUNK_LEN           256
+#endif
+
 /* \} name SECTION: Module settings */
 
 /*
@@ -2058,7 +2082,7 @@ void mbedtls_ssl_conf_cert_req_ca_list( mbedtls_ssl_config *conf,
 #if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
 /**
  * \brief          Set the maximum fragment length to emit and/or negotiate
- *                 (Default: MBEDTLS_SSL_MAX_CONTENT_LEN, usually 2^14 bytes)
+ *                 (Default: MBEDTLS_SSL_IN_CONTENT_LEN, usually 2^14 bytes)
  *                 (Server: set maximum fragment length to emit,
  *                 usually negotiated by the client during handshake
  *                 (Client: set maximum fragment length to emit *and*
@@ -138,13 +138,21 @@
 #define MBEDTLS_SSL_PADDING_ADD              0
 #endif
 
-#define MBEDTLS_SSL_BUFFER_LEN  ( MBEDTLS_SSL_MAX_CONTENT_LEN               \
-                        + MBEDTLS_SSL_COMPRESSION_ADD               \
+#if MBEDTLS_SSL_IN_CONTENT_LEN > MBEDTLS_SSL_MAX_CONTENT_LEN || \
+    MBEDTLS_SSL_OUT_CONTENT_LEN > MBEDTLS_SSL_MAX_CONTENT_LEN
+#error "MBEDTLS_SSL_IN/OUT_CONTENT_LEN must not exceed MBEDTLS_SSL_MAX_CONTENT_LEN"
+#endif
+
+#define MBEDTLS_SSL_PAYLOAD_OVERHEAD ( MBEDTLS_SSL_COMPRESSION_ADD           \
                         + 29 /* counter + header + IV */    \
                         + MBEDTLS_SSL_MAC_ADD                       \
                         + MBEDTLS_SSL_PADDING_ADD                   \
                         )
 
+#define MBEDTLS_SSL_BUFFER_LEN      ( MBEDTLS_SSL_MAX_CONTENT_LEN + MBEDTLS_SSL_PAYLOAD_OVERHEAD )
+#define MBEDTLS_SSL_IN_BUFFER_LEN   ( MBEDTLS_SSL_IN_CONTENT_LEN + MBEDTLS_SSL_PAYLOAD_OVERHEAD )
+#define MBEDTLS_SSL_OUT_BUFFER_LEN  ( MBEDTLS_SSL_OUT_CONTENT_LEN + MBEDTLS_SSL_PAYLOAD_OVERHEAD )
+
 /*
  * TLS extension flags (for extensions with outgoing ServerHello content
  * that need it (e.g. for RENEGOTIATION_INFO the server already knows because
@@ -197,10 +197,12 @@ static const unsigned char FSb[256] =
     V(C3,41,41,82), V(B0,99,99,29), V(77,2D,2D,5A), V(11,0F,0F,1E), \
     V(CB,B0,B0,7B), V(FC,54,54,A8), V(D6,BB,BB,6D), V(3A,16,16,2C)
 
+#if !defined(MBEDTLS_AES_SBOX_ONLY)
 #define V(a,b,c,d) 0x##a##b##c##d
 static const uint32_t FT0[256] = { FT };
 #undef V
 
+#if !defined(MBEDTLS_AES_FEWER_TABLES)
 #define V(a,b,c,d) 0x##b##c##d##a
 static const uint32_t FT1[256] = { FT };
 #undef V
@@ -212,6 +214,8 @@ static const uint32_t FT2[256] = { FT };
 #define V(a,b,c,d) 0x##d##a##b##c
 static const uint32_t FT3[256] = { FT };
 #undef V
+#endif /* !MBEDTLS_AES_FEWER_TABLES */
+#endif /* !MBEDTLS_AES_SBOX_ONLY */
 
 #undef FT
 
@@ -324,10 +328,12 @@ static const unsigned char RSb[256] =
     V(71,01,A8,39), V(DE,B3,0C,08), V(9C,E4,B4,D8), V(90,C1,56,64), \
     V(61,84,CB,7B), V(70,B6,32,D5), V(74,5C,6C,48), V(42,57,B8,D0)
 
+#if !defined(MBEDTLS_AES_SBOX_ONLY)
 #define V(a,b,c,d) 0x##a##b##c##d
 static const uint32_t RT0[256] = { RT };
 #undef V
 
+#if !defined(MBEDTLS_AES_FEWER_TABLES)
 #define V(a,b,c,d) 0x##b##c##d##a
 static const uint32_t RT1[256] = { RT };
 #undef V
@@ -339,6 +345,8 @@ static const uint32_t RT2[256] = { RT };
 #define V(a,b,c,d) 0x##d##a##b##c
 static const uint32_t RT3[256] = { RT };
 #undef V
+#endif /* !MBEDTLS_AES_FEWER_TABLES */
+#endif /* !MBEDTLS_AES_SBOX_ONLY */
 
 #undef RT
 
@@ -358,19 +366,27 @@ static const uint32_t RCON[10] =
  * Forward S-box & tables
  */
 static unsigned char FSb[256];
+#if !defined(MBEDTLS_AES_SBOX_ONLY)
 static uint32_t FT0[256];
+#if !defined(MBEDTLS_AES_FEWER_TABLES)
 static uint32_t FT1[256];
 static uint32_t FT2[256];
 static uint32_t FT3[256];
+#endif /* !MBEDTLS_AES_FEWER_TABLES */
+#endif /* !MBEDTLS_AES_SBOX_ONLY */
 
 /*
  * Reverse S-box & tables
  */
 static unsigned char RSb[256];
+#if !defined(MBEDTLS_AES_SBOX_ONLY)
 static uint32_t RT0[256];
+#if !defined(MBEDTLS_AES_FEWER_TABLES)
 static uint32_t RT1[256];
 static uint32_t RT2[256];
 static uint32_t RT3[256];
+#endif /* !MBEDTLS_AES_FEWER_TABLES */
+#endif /* !MBEDTLS_AES_SBOX_ONLY */
 
 /*
  * Round constants
@@ -388,7 +404,10 @@ static int aes_init_done = 0;
 
 static void aes_gen_tables( void )
 {
-    int i, x, y, z;
+    int i, x, y;
+#if !defined(MBEDTLS_AES_SBOX_ONLY)
+    int z;
+#endif
     int pow[256];
     int log[256];
 
@@ -431,6 +450,7 @@ static void aes_gen_tables( void )
         RSb[x] = (unsigned char) i;
     }
 
+#if !defined(MBEDTLS_AES_SBOX_ONLY)
     /*
      * generate the forward and reverse tables
      */
@@ -445,9 +465,11 @@ static void aes_gen_tables( void )
                  ( (uint32_t) x << 16 ) ^
                  ( (uint32_t) z << 24 );
 
+#if !defined(MBEDTLS_AES_FEWER_TABLES)
         FT1[i] = ROTL8( FT0[i] );
         FT2[i] = ROTL8( FT1[i] );
         FT3[i] = ROTL8( FT2[i] );
+#endif /* !MBEDTLS_AES_FEWER_TABLES */
 
         x = RSb[i];
 
@@ -456,14 +478,87 @@ static void aes_gen_tables( void )
                  ( (uint32_t) MUL( 0x0D, x ) << 16 ) ^
                  ( (uint32_t) MUL( 0x0B, x ) << 24 );
 
+#if !defined(MBEDTLS_AES_FEWER_TABLES)
         RT1[i] = ROTL8( RT0[i] );
         RT2[i] = ROTL8( RT1[i] );
         RT3[i] = ROTL8( RT2[i] );
+#endif /* !MBEDTLS_AES_FEWER_TABLES */
     }
+#endif /* !MBEDTLS_AES_SBOX_ONLY */
 }
 
 #endif /* MBEDTLS_AES_ROM_TABLES */
 
+#if defined(MBEDTLS_AES_SBOX_ONLY)
+/*
+ * Without T-tables a round is SubBytes through the 256-byte S-box followed
+ * by MixColumns computed on the packed column, four bytes at a time.
+ * Byte i of a column sits in bits 8i..8i+7, so AES_ROTR8 moves byte i+1
+ * into position i.
+ */
+#define AES_ROTR8(x)  ( ( (x) >>  8 ) | ( (x) << 24 ) )
+#define AES_ROTR16(x) ( ( (x) >> 16 ) | ( (x) << 16 ) )
+#define AES_XTIME4(x) ( ( ( (x) & 0x7F7F7F7F ) << 1 ) ^          \
+                        ( ( ( (x) >> 7 ) & 0x01010101 ) * 0x1B ) )
+
+#define AES_SB_COLUMN(S,Y0,Y1,Y2,Y3)                    \
+    ( ( (uint32_t) S[ ( Y0       ) & 0xFF ]       ) ^   \
+      ( (uint32_t) S[ ( Y1 >>  8 ) & 0xFF ] <<  8 ) ^   \
+      ( (uint32_t) S[ ( Y2 >> 16 ) & 0xFF ] << 16 ) ^   \
+      ( (uint32_t) S[ ( Y3 >> 24 ) & 0xFF ] << 24 ) )
+
+/* b[i] = 2 a[i] ^ 3 a[i+1] ^ a[i+2] ^ a[i+3] */
+static inline uint32_t aes_mix_column( uint32_t a )
+{
+    uint32_t r = AES_ROTR8( a );
+    uint32_t t = a ^ r;
+
+    return( AES_XTIME4( t ) ^ r ^ AES_ROTR16( t ) );
+}
+
+/*
+ * InvMixColumns factors into MixColumns applied after adding
+ * 4 ( a[i] ^ a[i+2] ) to every byte.
+ */
+static inline uint32_t aes_inv_mix_column( uint32_t a )
+{
+    uint32_t t = a ^ AES_ROTR16( a );
+
+    t = AES_XTIME4( t );
+    t = AES_XTIME4( t );
+
+    return( aes_mix_column( a ^ t ) );
+}
+#elif defined(MBEDTLS_AES_FEWER_TABLES)
+/*
+ * Only FT0/RT0 are kept, the other three tables are byte rotations of them.
+ * On ARM the rotation is folded into the XOR by the barrel shifter.
+ */
+#define AES_ROTL8(x)  ( ( (x) <<  8 ) | ( (x) >> 24 ) )
+#define AES_ROTL16(x) ( ( (x) << 16 ) | ( (x) >> 16 ) )
+#define AES_ROTL24(x) ( ( (x) << 24 ) | ( (x) >>  8 ) )
+
+#define AES_FT0(idx) FT0[idx]
+#define AES_FT1(idx) AES_ROTL8(  FT0[idx] )
+#define AES_FT2(idx) AES_ROTL16( FT0[idx] )
+#define AES_FT3(idx) AES_ROTL24( FT0[idx] )
+
+#define AES_RT0(idx) RT0[idx]
+#define AES_RT1(idx) AES_ROTL8(  RT0[idx] )
+#define AES_RT2(idx) AES_ROTL16( RT0[idx] )
+#define AES_RT3(idx) AES_ROTL24( RT0[idx] )
+#else
+#define AES_FT0(idx) FT0[idx]
+#define AES_FT1(idx) FT1[idx]
+#define AES_FT2(idx) FT2[idx]
+#define AES_FT3(idx) FT3[idx]
+
+#define AES_RT0(idx) RT0[idx]
+#define AES_RT1(idx) RT1[idx]
+#define AES_RT2(idx) RT2[idx]
+#define AES_RT3(idx) RT3[idx]
+#endif /* MBEDTLS_AES_SBOX_ONLY */
+
 void mbedtls_aes_init( mbedtls_aes_context *ctx )
 {
     memset( ctx, 0, sizeof( mbedtls_aes_context ) );
@@ -641,10 +736,14 @@ int mbedtls_aes_setkey_dec( mbedtls_aes_context *ctx, const unsigned char *key,
     {
         for( j = 0; j < 4; j++, SK++ )
         {
-            *RK++ = RT0[ FSb[ ( *SK       ) & 0xFF ] ] ^
-                    RT1[ FSb[ ( *SK >>  8 ) & 0xFF ] ] ^
-                    RT2[ FSb[ ( *SK >> 16 ) & 0xFF ] ] ^
-                    RT3[ FSb[ ( *SK >> 24 ) & 0xFF ] ];
+#if defined(MBEDTLS_AES_SBOX_ONLY)
+            *RK++ = aes_inv_mix_column( *SK );
+#else
+            *RK++ = AES_RT0( FSb[ ( *SK       ) & 0xFF ] ) ^
+                    AES_RT1( FSb[ ( *SK >>  8 ) & 0xFF ] ) ^
+                    AES_RT2( FSb[ ( *SK >> 16 ) & 0xFF ] ) ^
+                    AES_RT3( FSb[ ( *SK >> 24 ) & 0xFF ] );
+#endif
         }
     }
 
@@ -660,51 +759,69 @@ exit:
 }
 #endif /* !MBEDTLS_AES_SETKEY_DEC_ALT */
 
-#define AES_FROUND(X0,X1,X2,X3,Y0,Y1,Y2,Y3)     \
-{                                               \
-    X0 = *RK++ ^ FT0[ ( Y0       ) & 0xFF ] ^   \
-                 FT1[ ( Y1 >>  8 ) & 0xFF ] ^   \
-                 FT2[ ( Y2 >> 16 ) & 0xFF ] ^   \
-                 FT3[ ( Y3 >> 24 ) & 0xFF ];    \
-                                                \
-    X1 = *RK++ ^ FT0[ ( Y1       ) & 0xFF ] ^   \
-                 FT1[ ( Y2 >>  8 ) & 0xFF ] ^   \
-                 FT2[ ( Y3 >> 16 ) & 0xFF ] ^   \
-                 FT3[ ( Y0 >> 24 ) & 0xFF ];    \
-                                                \
-    X2 = *RK++ ^ FT0[ ( Y2       ) & 0xFF ] ^   \
-                 FT1[ ( Y3 >>  8 ) & 0xFF ] ^   \
-                 FT2[ ( Y0 >> 16 ) & 0xFF ] ^   \
-                 FT3[ ( Y1 >> 24 ) & 0xFF ];    \
-                                                \
-    X3 = *RK++ ^ FT0[ ( Y3       ) & 0xFF ] ^   \
-                 FT1[ ( Y0 >>  8 ) & 0xFF ] ^   \
-                 FT2[ ( Y1 >> 16 ) & 0xFF ] ^   \
-                 FT3[ ( Y2 >> 24 ) & 0xFF ];    \
+#if defined(MBEDTLS_AES_SBOX_ONLY)
+#define AES_FROUND(X0,X1,X2,X3,Y0,Y1,Y2,Y3)                                 \
+{                                                                           \
+    X0 = *RK++ ^ aes_mix_column( AES_SB_COLUMN( FSb, Y0, Y1, Y2, Y3 ) );    \
+    X1 = *RK++ ^ aes_mix_column( AES_SB_COLUMN( FSb, Y1, Y2, Y3, Y0 ) );    \
+    X2 = *RK++ ^ aes_mix_column( AES_SB_COLUMN( FSb, Y2, Y3, Y0, Y1 ) );    \
+    X3 = *RK++ ^ aes_mix_column( AES_SB_COLUMN( FSb, Y3, Y0, Y1, Y2 ) );    \
+}
+
+#define AES_RROUND(X0,X1,X2,X3,Y0,Y1,Y2,Y3)                                 \
+{                                                                           \
+    X0 = *RK++ ^ aes_inv_mix_column( AES_SB_COLUMN( RSb, Y0, Y3, Y2, Y1 ) );\
+    X1 = *RK++ ^ aes_inv_mix_column( AES_SB_COLUMN( RSb, Y1, Y0, Y3, Y2 ) );\
+    X2 = *RK++ ^ aes_inv_mix_column( AES_SB_COLUMN( RSb, Y2, Y1, Y0, Y3 ) );\
+    X3 = *RK++ ^ aes_inv_mix_column( AES_SB_COLUMN( RSb, Y3, Y2, Y1, Y0 ) );\
+}
+#else
+#define AES_FROUND(X0,X1,X2,X3,Y0,Y1,Y2,Y3)         \
+{                                                   \
+    X0 = *RK++ ^ AES_FT0( ( Y0       ) & 0xFF ) ^   \
+                 AES_FT1( ( Y1 >>  8 ) & 0xFF ) ^   \
+                 AES_FT2( ( Y2 >> 16 ) & 0xFF ) ^   \
+                 AES_FT3( ( Y3 >> 24 ) & 0xFF );    \
+                                                    \
+    X1 = *RK++ ^ AES_FT0( ( Y1       ) & 0xFF ) ^   \
+                 AES_FT1( ( Y2 >>  8 ) & 0xFF ) ^   \
+                 AES_FT2( ( Y3 >> 16 ) & 0xFF ) ^   \
+                 AES_FT3( ( Y0 >> 24 ) & 0xFF );    \
+                                                    \
+    X2 = *RK++ ^ AES_FT0( ( Y2       ) & 0xFF ) ^   \
+                 AES_FT1( ( Y3 >>  8 ) & 0xFF ) ^   \
+                 AES_FT2( ( Y0 >> 16 ) & 0xFF ) ^   \
+                 AES_FT3( ( Y1 >> 24 ) & 0xFF );    \
+                                                    \
+    X3 = *RK++ ^ AES_FT0( ( Y3       ) & 0xFF ) ^   \
+                 AES_FT1( ( Y0 >>  8 ) & 0xFF ) ^   \
+                 AES_FT2( ( Y1 >> 16 ) & 0xFF ) ^   \
+                 AES_FT3( ( Y2 >> 24 ) & 0xFF );    \
 }
 
-#define AES_RROUND(X0,X1,X2,X3,Y0,Y1,Y2,Y3)     \
-{                                               \
-    X0 = *RK++ ^ RT0[ ( Y0       ) & 0xFF ] ^   \
-                 RT1[ ( Y3 >>  8 ) & 0xFF ] ^   \
-                 RT2[ ( Y2 >> 16 ) & 0xFF ] ^   \
-                 RT3[ ( Y1 >> 24 ) & 0xFF ];    \
-                                                \
-    X1 = *RK++ ^ RT0[ ( Y1       ) & 0xFF ] ^   \
-                 RT1[ ( Y0 >>  8 ) & 0xFF ] ^   \
-                 RT2[ ( Y3 >> 16 ) & 0xFF ] ^   \
-                 RT3[ ( Y2 >> 24 ) & 0xFF ];    \
-                                                \
-    X2 = *RK++ ^ RT0[ ( Y2       ) & 0xFF ] ^   \
-                 RT1[ ( Y1 >>  8 ) & 0xFF ] ^   \
-                 RT2[ ( Y0 >> 16 ) & 0xFF ] ^   \
-                 RT3[ ( Y3 >> 24 ) & 0xFF ];    \
-                                                \
-    X3 = *RK++ ^ RT0[ ( Y3       ) & 0xFF ] ^   \
-                 RT1[ ( Y2 >>  8 ) & 0xFF ] ^   \
-                 RT2[ ( Y1 >> 16 ) & 0xFF ] ^   \
-                 RT3[ ( Y0 >> 24 ) & 0xFF ];    \
+#define AES_RROUND(X0,X1,X2,X3,Y0,Y1,Y2,Y3)         \
+{                                                   \
+    X0 = *RK++ ^ AES_RT0( ( Y0       ) & 0xFF ) ^   \
+                 AES_RT1( ( Y3 >>  8 ) & 0xFF ) ^   \
+                 AES_RT2( ( Y2 >> 16 ) & 0xFF ) ^   \
+                 AES_RT3( ( Y1 >> 24 ) & 0xFF );    \
+                                                    \
+    X1 = *RK++ ^ AES_RT0( ( Y1       ) & 0xFF ) ^   \
+                 AES_RT1( ( Y0 >>  8 ) & 0xFF ) ^   \
+                 AES_RT2( ( Y3 >> 16 ) & 0xFF ) ^   \
+                 AES_RT3( ( Y2 >> 24 ) & 0xFF );    \
+                                                    \
+    X2 = *RK++ ^ AES_RT0( ( Y2       ) & 0xFF ) ^   \
+                 AES_RT1( ( Y1 >>  8 ) & 0xFF ) ^   \
+                 AES_RT2( ( Y0 >> 16 ) & 0xFF ) ^   \
+                 AES_RT3( ( Y3 >> 24 ) & 0xFF );    \
+                                                    \
+    X3 = *RK++ ^ AES_RT0( ( Y3       ) & 0xFF ) ^   \
+                 AES_RT1( ( Y2 >>  8 ) & 0xFF ) ^   \
+                 AES_RT2( ( Y1 >> 16 ) & 0xFF ) ^   \
+                 AES_RT3( ( Y0 >> 24 ) & 0xFF );    \
 }
+#endif /* MBEDTLS_AES_SBOX_ONLY */
 
 /*
  * AES-ECB block encryption
@@ -0,0 +1,192 @@
+/**
+ * @file at_modem_emu.c
+ * @brief 在主机上模拟经uart连接的TCP模组, 见at_modem_emu.h
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "aiot_state_api.h"
+#include "aiot_at_api.h"
+#include "at_modem_emu.h"
+
+#define AT_MODEM_EMU_SOCKET_ID      "0"
+
+static at_modem_emu_t *g_at_modem_emu = NULL;
+
+/* len字节经uart传输的时间 */
+static void _at_modem_emu_uart(at_modem_emu_t *emu, uint32_t len)
+{
+    usleep((uint64_t)len * 10 * 1000000 / emu->baudrate);
+}
+
+static void _at_modem_emu_response(char *socket_id, aiot_at_recv_option_t option, uint8_t result)
+{
+    aiot_at_input(socket_id, option, &result);
+}
+
+static void _at_modem_emu_record(at_modem_emu_t *emu, const uint8_t *buf, uint32_t len)
+{
+    uint32_t pos = 0, take = 0;
+
+    while (pos < len) {
+        if (emu->rec_hdr_len < sizeof(emu->rec_hdr)) {
+            if (emu->rec_hdr_len == 0) {
+                emu->rec_cmd = emu->send_cmds;
+            }
+            take = sizeof(emu->rec_hdr) - emu->rec_hdr_len;
+            take = (len - pos < take) ? len - pos : take;
+            memcpy(&emu->rec_hdr[emu->rec_hdr_len], &buf[pos], take);
+            emu->rec_hdr_len += take;
+            if (emu->rec_hdr_len == sizeof(emu->rec_hdr)) {
+                emu->rec_left = ((uint32_t)emu->rec_hdr[3] << 8) | emu->rec_hdr[4];
+            }
+        } else {
+            take = (len - pos < emu->rec_left) ? len - pos : emu->rec_left;
+            emu->rec_left -= take;
+        }
+        pos += take;
+
+        if (emu->rec_hdr_len == sizeof(emu->rec_hdr) && emu->rec_left == 0) {
+            emu->records++;
+            if (emu->rec_cmd != emu->send_cmds) {
+                emu->records_split++;
+            }
+            emu->rec_hdr_len = 0;
+        }
+    }
+}
+
+/* 模组把收到的数据经uart推送给MCU, AT层放不下时等它腾出空间 */
+static void *_at_modem_emu_rx_thread(void *arg)
+{
+    at_modem_emu_t *emu = (at_modem_emu_t *)arg;
+    uint8_t buffer[AT_MODEM_EMU_URC_MAX_LEN];
+    aiot_at_buf_t at_buf;
+    ssize_t len = 0;
+    int32_t res = 0;
+    uint32_t pos = 0;
+
+    while ((len = recv(emu->fd, buffer, sizeof(buffer), 0)) > 0) {
+        _at_modem_emu_uart(emu, len + AT_MODEM_EMU_CMD_OVERHEAD);
+        for (pos = 0; pos < len;) {
+            at_buf.buf = &buffer[pos];
+            at_buf.len = len - pos;
+            res = aiot_at_input(AT_MODEM_EMU_SOCKET_ID, AIOT_ATRECVOPT_BUF, &at_buf);
+            if (res > 0) {
+                pos += res;
+            } else if (res == STATE_AT_RINGBUF_OVERRUN && emu->closing == 0) {
+                usleep(1000);
+            } else {
+                return NULL;
+            }
+        }
+        emu->recv_bytes += len;
+    }
+
+    return NULL;
+}
+
+static int32_t _at_modem_emu_connect_handler(void *handle, aiot_at_connect_t *conn)
+{
+    at_modem_emu_t *emu = g_at_modem_emu;
+    struct addrinfo hints, *addr = NULL;
+    char port[6];
+    int one = 1;
+    uint8_t result = 0;
+
+    aiot_at_setopt(handle, AIOT_ATOPT_SOCKET_ID, AT_MODEM_EMU_SOCKET_ID);
+    _at_modem_emu_uart(emu, strlen(conn->domain) + AT_MODEM_EMU_CMD_OVERHEAD);
+    usleep(emu->cmd_ms * 1000);
+    _at_modem_emu_response(NULL, AIOT_ATRECVOPT_SEND_RESP, 1);
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(port, sizeof(port), "%u", conn->port);
+    emu->fd = -1;
+    emu->closing = 0;
+    emu->rec_hdr_len = emu->rec_left = 0;
+    if (getaddrinfo(conn->domain, port, &hints, &addr) == 0) {
+        emu->fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+        if (emu->fd >= 0 && connect(emu->fd, addr->ai_addr, addr->ai_addrlen) == 0) {
+            setsockopt(emu->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            result = (pthread_create(&emu->rx_thread, NULL, _at_modem_emu_rx_thread, emu) == 0) ? 1 : 0;
+        }
+        freeaddrinfo(addr);
+    }
+    if (result == 0 && emu->fd >= 0) {
+        close(emu->fd);
+        emu->fd = -1;
+    }
+    _at_modem_emu_response(AT_MODEM_EMU_SOCKET_ID, AIOT_ATRECVOPT_CONNECT_RESP, result);
+
+    return STATE_SUCCESS;
+}
+
+static int32_t _at_modem_emu_send_handler(char *socket_id, aiot_at_buf_t *buf)
+{
+    at_modem_emu_t *emu = g_at_modem_emu;
+    ssize_t res = 0;
+
+    _at_modem_emu_uart(emu, buf->len + AT_MODEM_EMU_CMD_OVERHEAD);
+    usleep(emu->cmd_ms * 1000);
+
+    emu->send_cmds++;
+    emu->send_bytes += buf->len;
+    _at_modem_emu_record(emu, buf->buf, buf->len);
+    if (emu->fd >= 0) {
+        res = send(emu->fd, buf->buf, buf->len, MSG_NOSIGNAL);
+    }
+    _at_modem_emu_response(NULL, AIOT_ATRECVOPT_SEND_RESP, (res == buf->len) ? 1 : 0);
+
+    return buf->len;
+}
+
+static int32_t _at_modem_emu_disconnect_handler(char *socket_id)
+{
+    at_modem_emu_t *emu = g_at_modem_emu;
+
+    _at_modem_emu_uart(emu, AT_MODEM_EMU_CMD_OVERHEAD);
+    usleep(emu->cmd_ms * 1000);
+    if (emu->fd >= 0) {
+        emu->closing = 1;
+        shutdown(emu->fd, SHUT_RDWR);
+        pthread_join(emu->rx_thread, NULL);
+        close(emu->fd);
+        emu->fd = -1;
+    }
+    _at_modem_emu_response(AT_MODEM_EMU_SOCKET_ID, AIOT_ATRECVOPT_DISCONNECT_RESP, 1);
+
+    return STATE_SUCCESS;
+}
+
+int32_t at_modem_emu_start(at_modem_emu_t *emu)
+{
+    aiot_at_send_handler_t handler;
+
+    memset(&handler, 0, sizeof(handler));
+    handler.connect_handler = _at_modem_emu_connect_handler;
+    handler.send_handler = _at_modem_emu_send_handler;
+    handler.disconnect_handler = _at_modem_emu_disconnect_handler;
+
+    emu->fd = -1;
+    g_at_modem_emu = emu;
+    at_modem_emu_reset(emu);
+
+    return aiot_at_set_send_handler(&handler);
+}
+
+void at_modem_emu_reset(at_modem_emu_t *emu)
+{
+    emu->send_cmds = 0;
+    emu->send_bytes = 0;
+    emu->records = 0;
+    emu->records_split = 0;
+    emu->recv_bytes = 0;
+}
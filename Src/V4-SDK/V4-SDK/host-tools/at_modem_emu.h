@@ -0,0 +1,53 @@
+/**
+ * @file at_modem_emu.h
+ * @brief 在主机上模拟经uart连接的TCP模组, 作为AT层的发送回调, 用主机的TCP socket代替模组的连接
+ *
+ * 只模拟一条连接(socket id为"0"), 时延按以下模型计算
+ *     - uart按8N1计, 每字节10比特, 每条指令和每次上报另有AT_MODEM_EMU_CMD_OVERHEAD字节的指令头和应答
+ *     - 每条指令(建连、发送、断开)另需模组处理cmd_ms毫秒, 发送指令的应答在数据写入TCP连接之后才返回
+ *     - 接收方向以推送模式上报, 每次最多AT_MODEM_EMU_URC_MAX_LEN字节, AT层的缓冲区满时等待, 相当于uart硬件流控
+ */
+
+#ifndef _AT_MODEM_EMU_H_
+#define _AT_MODEM_EMU_H_
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <pthread.h>
+
+#define AT_MODEM_EMU_CMD_OVERHEAD   (24)
+#define AT_MODEM_EMU_URC_MAX_LEN    (1024)
+
+typedef struct {
+    uint32_t baudrate;
+    uint32_t cmd_ms;
+    /* 发送方向的统计, 按TLS记录头解析发出的字节流, 一条记录的数据分布在多条发送指令中时计入records_split */
+    uint32_t send_cmds;
+    uint64_t send_bytes;
+    uint32_t records;
+    uint32_t records_split;
+    uint64_t recv_bytes;
+    /* 以下为内部状态 */
+    int fd;
+    volatile uint8_t closing;
+    pthread_t rx_thread;
+    uint8_t rec_hdr[5];
+    uint32_t rec_hdr_len;
+    uint32_t rec_left;
+    uint32_t rec_cmd;
+} at_modem_emu_t;
+
+/* 注册为AT层的发送回调, 之后由对接层发起的连接都经由此模组 */
+int32_t at_modem_emu_start(at_modem_emu_t *emu);
+
+/* 清零统计 */
+void at_modem_emu_reset(at_modem_emu_t *emu);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* #ifndef _AT_MODEM_EMU_H_ */
@@ -0,0 +1,194 @@
+/**
+ * @file at_tls_bench.c
+ * @brief 在主机上经模拟的TCP模组运行freertos_tcp_modem对接层的TLS, 测量握手时延、上行吞吐量和AT发送指令数,
+ *        由at_tls_bench.sh启动本地测试服务器后运行
+ *
+ * 编译:
+ *     gcc -O2 -DCORE_SYSDEP_MBEDTLS_ENABLED -Ihost-tools/freertos_shim -Icore -Icore/sysdep -Icore/utils -Ihost-tools \
+ *         -Iportfiles/freertos_tcp_modem -Iexternal/mbedtls/include -o at_tls_bench \
+ *         host-tools/at_tls_bench.c host-tools/at_modem_emu.c host-tools/tls_bench_relay.c \
+ *         host-tools/freertos_shim/freertos_shim.c portfiles/freertos_tcp_modem/\*.c \
+ *         core/aiot_state_api.c core/sysdep/core_sysdep.c core/utils/\*.c external/mbedtls/library/\*.c -lpthread
+ *
+ *     加上 -DAT_TLS_BATCH_LEN=0 编译出的是记录不做合并和切分的版本, 用于对比
+ *
+ * 用法:
+ *     ./at_tls_bench <rsa|psk> <server_port> <server_cert.pem|psk> [rtt_ms] [baudrate] [cmd_ms]
+ *
+ * 连接经过本地中继转发到测试服务器, 中继在每次换向时延迟rtt_ms/2; 模组的uart波特率和每条指令的处理时间见at_modem_emu.h
+ *     handshake  建立TLS连接的耗时, 以及握手期间的发送指令数和记录数
+ *     upload     以不同的单次长度上行AT_TLS_BENCH_UPLOAD_LEN字节, 输出吞吐量、发送指令数和记录数
+ * split为数据分布在多条发送指令中的记录数, 默认版本中应为0, 否则返回1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "aiot_state_api.h"
+#include "aiot_sysdep_api.h"
+#include "tls_bench_relay.h"
+#include "at_modem_emu.h"
+
+#define AT_TLS_BENCH_UPLOAD_LEN     (16 * 1024)
+#define AT_TLS_BENCH_TIMEOUT_MS     (10000)
+
+#if defined(AT_TLS_BATCH_LEN) && (AT_TLS_BATCH_LEN == 0)
+#define AT_TLS_BENCH_VARIANT        "per-record"
+#else
+#define AT_TLS_BENCH_VARIANT        "batched"
+#endif
+
+extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
+
+static const uint32_t g_at_tls_bench_write_len[] = {256, 1200, 4096};
+
+/* 对接层要求板级代码提供的熵源 */
+int32_t core_sysdep_entropy_poll(uint8_t *output, uint32_t output_len)
+{
+    return (syscall(SYS_getrandom, output, output_len, 0) == output_len) ? 0 : -1;
+}
+
+static double _at_tls_bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *_at_tls_bench_connect(tls_bench_relay_t *relay, aiot_sysdep_network_cred_t *cred, core_sysdep_psk_t *psk)
+{
+    aiot_sysdep_portfile_t *sysdep = &g_aiot_sysdep_portfile;
+    core_sysdep_socket_type_t socket_type = CORE_SYSDEP_SOCKET_TCP_CLIENT;
+    uint32_t timeout_ms = AT_TLS_BENCH_TIMEOUT_MS;
+    void *network = NULL;
+
+    network = sysdep->core_sysdep_network_init();
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_SOCKET_TYPE, &socket_type);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_HOST, "127.0.0.1");
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_PORT, &relay->relay_port);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_CONNECT_TIMEOUT_MS, &timeout_ms);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_CRED, cred);
+    if (psk != NULL) {
+        sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_PSK, psk);
+    }
+
+    return network;
+}
+
+static int32_t _at_tls_bench_upload(void *network, at_modem_emu_t *emu, uint32_t write_len)
+{
+    aiot_sysdep_portfile_t *sysdep = &g_aiot_sysdep_portfile;
+    static uint8_t payload[AT_TLS_BENCH_UPLOAD_LEN];
+    uint32_t pos = 0, len = 0;
+    double start = 0, wall = 0;
+    int32_t res = 0;
+
+    memset(payload, 'a', sizeof(payload));
+    at_modem_emu_reset(emu);
+    start = _at_tls_bench_now();
+    while (pos < sizeof(payload)) {
+        len = (sizeof(payload) - pos < write_len) ? sizeof(payload) - pos : write_len;
+        res = sysdep->core_sysdep_network_send(network, &payload[pos], len, AT_TLS_BENCH_TIMEOUT_MS, NULL);
+        if (res <= 0) {
+            printf("upload failed, res: -0x%04X\n", -res);
+            return (res < 0) ? res : -1;
+        }
+        pos += res;
+    }
+    wall = _at_tls_bench_now() - start;
+
+    printf("    | %-10s | upload %4u B   | %9.1f KB/s | %8u | %7u | %5u |\n", AT_TLS_BENCH_VARIANT, write_len,
+           sizeof(payload) / wall / 1024, emu->send_cmds, emu->records, emu->records_split);
+
+    return emu->records_split;
+}
+
+int main(int argc, char *argv[])
+{
+    aiot_sysdep_network_cred_t cred;
+    core_sysdep_psk_t psk;
+    tls_bench_relay_t relay;
+    at_modem_emu_t emu;
+    static char cert[8192];
+    size_t cert_len = 0;
+    uint32_t idx = 0, split = 0;
+    void *network = NULL;
+    double start = 0, wall = 0;
+    int32_t res = 0;
+    FILE *fp = NULL;
+
+    if (argc < 4) {
+        printf("usage: %s <rsa|psk> <server_port> <server_cert.pem|psk> [rtt_ms] [baudrate] [cmd_ms]\n", argv[0]);
+        return 1;
+    }
+
+    memset(&cred, 0, sizeof(cred));
+    cred.max_tls_fragment = 16384;
+    if (strcmp(argv[1], "psk") == 0) {
+        cred.option = AIOT_SYSDEP_NETWORK_CRED_SVRCERT_PSK;
+        psk.psk_id = "at_tls_bench";
+        psk.psk = argv[3];
+    } else {
+        fp = fopen(argv[3], "r");
+        if (fp == NULL) {
+            perror(argv[3]);
+            return 1;
+        }
+        cert_len = fread(cert, 1, sizeof(cert) - 1, fp);
+        fclose(fp);
+        cred.option = AIOT_SYSDEP_NETWORK_CRED_SVRCERT_RSA;
+        cred.x509_server_cert = cert;
+        cred.x509_server_cert_len = cert_len;
+    }
+
+    aiot_sysdep_set_portfile(&g_aiot_sysdep_portfile);
+
+    memset(&relay, 0, sizeof(relay));
+    relay.server_port = (uint16_t)atoi(argv[2]);
+    relay.rtt_ms = (argc > 4) ? (uint32_t)atoi(argv[4]) : 0;
+    relay.per_packet = 1;
+    if (tls_bench_relay_start(&relay) < 0) {
+        return 1;
+    }
+
+    memset(&emu, 0, sizeof(emu));
+    emu.baudrate = (argc > 5) ? (uint32_t)atoi(argv[5]) : 115200;
+    emu.cmd_ms = (argc > 6) ? (uint32_t)atoi(argv[6]) : 20;
+    if (emu.baudrate == 0 || at_modem_emu_start(&emu) < 0) {
+        return 1;
+    }
+
+    network = _at_tls_bench_connect(&relay, &cred, (cred.option == AIOT_SYSDEP_NETWORK_CRED_SVRCERT_PSK) ? &psk : NULL);
+    start = _at_tls_bench_now();
+    res = g_aiot_sysdep_portfile.core_sysdep_network_establish(network);
+    wall = _at_tls_bench_now() - start;
+    if (res < STATE_SUCCESS) {
+        printf("%s handshake failed, res: -0x%04X\n", argv[1], -res);
+        return 1;
+    }
+    printf("    | %-10s | handshake       | %9.1f ms   | %8u | %7u | %5u |\n", AT_TLS_BENCH_VARIANT, 1000 * wall,
+           emu.send_cmds, emu.records, emu.records_split);
+    split += emu.records_split;
+
+    for (idx = 0; idx < sizeof(g_at_tls_bench_write_len) / sizeof(g_at_tls_bench_write_len[0]); idx++) {
+        res = _at_tls_bench_upload(network, &emu, g_at_tls_bench_write_len[idx]);
+        if (res < 0) {
+            return 1;
+        }
+        split += res;
+    }
+    g_aiot_sysdep_portfile.core_sysdep_network_deinit(&network);
+
+    if (strcmp(AT_TLS_BENCH_VARIANT, "batched") == 0 && split > 0) {
+        printf("%u records split across AT sends\n", split);
+        return 1;
+    }
+
+    return 0;
+}
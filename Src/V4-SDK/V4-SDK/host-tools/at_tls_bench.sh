@@ -0,0 +1,68 @@
+#!/bin/bash
+#
+# 用openssl s_server在本地起TLS1.2测试服务器, 经模拟的TCP模组运行freertos_tcp_modem对接层的TLS,
+# 比较记录合并切分前后的握手时延、上行吞吐量和AT发送指令数, 用法:
+#
+#     bash host-tools/at_tls_bench.sh <output_dir> [rtt_ms] [baudrate] [cmd_ms]
+#
+# batched为默认版本, per-record为 -DAT_TLS_BATCH_LEN=0 编译的版本, 每条记录单独交给AT层按默认长度分块发送.
+# 树中的mbedtls只带客户端, 所以测试服务器使用openssl; 对接层把PSK字符串本身作为密钥, 所以传给openssl的是它的十六进制
+
+if [ "${1}" = "" ];then
+    exit 1
+fi
+
+OBJDIR=${1}/at_tls_bench
+RTT_MS=${2:-100}
+BAUDRATE=${3:-115200}
+CMD_MS=${4:-20}
+RSA_PORT=${AT_TLS_BENCH_PORT:-18449}
+PSK_PORT=$((RSA_PORT + 1))
+PSK=00112233445566778899aabbccddeeff
+INC="-Ihost-tools/freertos_shim -Icore -Icore/sysdep -Icore/utils -Ihost-tools -Iportfiles/freertos_tcp_modem \
+    -Iexternal/mbedtls/include"
+SRC="host-tools/at_tls_bench.c host-tools/at_modem_emu.c host-tools/tls_bench_relay.c \
+    host-tools/freertos_shim/freertos_shim.c portfiles/freertos_tcp_modem/*.c \
+    core/aiot_state_api.c core/sysdep/core_sysdep.c core/utils/*.c external/mbedtls/library/*.c"
+
+# 对接层的TLS内存区长度没有默认值, 主机上使用不会耗尽的长度
+ARENA_FLAGS="-DAT_TLS_ARENA_LEN=(MBEDTLS_SSL_IN_CONTENT_LEN+MBEDTLS_SSL_OUT_CONTENT_LEN+24*1024)"
+
+mkdir -p ${OBJDIR}
+
+openssl req -x509 -newkey rsa:2048 -nodes -keyout ${OBJDIR}/key.pem -out ${OBJDIR}/cert.pem -days 1 \
+    -subj "/CN=localhost" > /dev/null 2>&1 || exit 1
+gcc -O2 -DCORE_SYSDEP_MBEDTLS_ENABLED ${ARENA_FLAGS} ${INC} -o ${OBJDIR}/at_tls_bench_batched ${SRC} -lpthread || exit 1
+gcc -O2 -DCORE_SYSDEP_MBEDTLS_ENABLED ${ARENA_FLAGS} -DAT_TLS_BATCH_LEN=0 ${INC} -o ${OBJDIR}/at_tls_bench_per_record ${SRC} \
+    -lpthread || exit 1
+
+sleep 3600 | openssl s_server -accept 127.0.0.1:${RSA_PORT} -tls1_2 -cipher 'AES128-SHA256:AES256-SHA256:AES128-SHA:AES256-SHA' \
+    -cert ${OBJDIR}/cert.pem -key ${OBJDIR}/key.pem -quiet > /dev/null 2>&1 &
+RSA_SERVER=$!
+sleep 3600 | openssl s_server -accept 127.0.0.1:${PSK_PORT} -tls1_2 -nocert -cipher 'PSK-AES128-CBC-SHA' \
+    -psk $(printf ${PSK} | xxd -p -c 100) -psk_identity at_tls_bench -quiet > /dev/null 2>&1 &
+PSK_SERVER=$!
+sleep 1
+
+RES=0
+echo ""
+echo "    rtt: ${RTT_MS} ms, uart: ${BAUDRATE} bps, modem: ${CMD_MS} ms per command"
+for MODE in rsa psk; do
+    echo ""
+    echo "    | variant    | ${MODE}             |   time / rate  | AT sends | records | split |"
+    for VARIANT in per_record batched; do
+        if [ "${MODE}" = "rsa" ]; then
+            ARGS="rsa ${RSA_PORT} ${OBJDIR}/cert.pem"
+        else
+            ARGS="psk ${PSK_PORT} ${PSK}"
+        fi
+        ${OBJDIR}/at_tls_bench_${VARIANT} ${ARGS} ${RTT_MS} ${BAUDRATE} ${CMD_MS} | grep '^    |\|failed\|split across'
+        [ ${PIPESTATUS[0]} -eq 0 ] || RES=1
+        # 中继转发close_notify时也会延迟rtt_ms/2
+        sleep 0.$((RTT_MS / 100 + 2))
+    done
+done
+echo ""
+
+kill ${RSA_SERVER} ${PSK_SERVER} $(jobs -p) > /dev/null 2>&1
+exit ${RES}
@@ -0,0 +1,161 @@
+/**
+ * @file digest_bench.c
+ * @brief 在主机上校验并测量当前编译选择的SHA256/MD5实现, 由digest_bench.sh对每一种实现分别编译运行
+ *
+ * 编译:
+ *     gcc -O2 -Icore -Icore/sysdep -Icore/utils -Icomponents/ota -Ihost-tools -o digest_bench \
+ *         host-tools/digest_bench.c core/utils/core_sha256.c components/ota/ota_md5.c
+ *
+ * 用法:
+ *     ./digest_bench [sha256|md5]
+ *
+ * 先用digest_vectors.h中的测试向量校验, 失败返回1; 然后输出吞吐量(MB/s)和每字节的时钟周期数.
+ * 主机上的结果波动较大, 重复测量DIGEST_BENCH_ROUNDS次取最快的一次.
+ * 周期数在x86上是TSC的计数, 即主机标称频率下的周期, 其它平台上根据DIGEST_BENCH_CPU_MHZ估算.
+ * 两者都只反映主机上的相对快慢, 不能当作目标平台上的周期数
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "core_sha256.h"
+#include "ota_md5.h"
+#include "digest_vectors.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define DIGEST_BENCH_BUFFER_LEN     (4096)
+#define DIGEST_BENCH_TOTAL_LEN      (16 * 1024 * 1024)
+#define DIGEST_BENCH_ROUNDS         (7)
+
+#ifndef DIGEST_BENCH_CPU_MHZ
+#define DIGEST_BENCH_CPU_MHZ        (0)
+#endif
+
+typedef void (*digest_bench_func_t)(const uint8_t *input, uint32_t ilen, uint32_t repeat, uint8_t *output);
+
+static void _digest_bench_sha256(const uint8_t *input, uint32_t ilen, uint32_t repeat, uint8_t *output)
+{
+    core_sha256_context_t ctx;
+
+    core_sha256_init(&ctx);
+    core_sha256_starts(&ctx);
+    while (repeat--) {
+        core_sha256_update(&ctx, input, ilen);
+    }
+    core_sha256_finish(&ctx, output);
+    core_sha256_free(&ctx);
+}
+
+static void _digest_bench_md5(const uint8_t *input, uint32_t ilen, uint32_t repeat, uint8_t *output)
+{
+    utils_md5_context_t ctx;
+
+    utils_md5_init(&ctx);
+    utils_md5_starts(&ctx);
+    while (repeat--) {
+        utils_md5_update(&ctx, input, ilen);
+    }
+    utils_md5_finish(&ctx, output);
+    utils_md5_free(&ctx);
+}
+
+static uint64_t _digest_bench_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static double _digest_bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int32_t _digest_bench_verify(const char *name, digest_bench_func_t func, const digest_vector_t *vectors,
+                                    uint32_t vectors_num, uint32_t digest_len)
+{
+    uint32_t idx = 0, pos = 0;
+    uint8_t output[32] = {0};
+    char output_str[65] = {0};
+
+    for (idx = 0; idx < vectors_num; idx++) {
+        func((const uint8_t *)vectors[idx].input, strlen(vectors[idx].input), vectors[idx].repeat, output);
+        for (pos = 0; pos < digest_len; pos++) {
+            sprintf(&output_str[pos * 2], "%02x", output[pos]);
+        }
+        if (strcmp(output_str, vectors[idx].digest) != 0) {
+            printf("%s vector %u mismatch: %s, expect %s\n", name, idx, output_str, vectors[idx].digest);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void _digest_bench_measure(const char *name, digest_bench_func_t func)
+{
+    uint8_t buffer[DIGEST_BENCH_BUFFER_LEN], output[32];
+    uint32_t idx = 0, round = 0, repeat = DIGEST_BENCH_TOTAL_LEN / DIGEST_BENCH_BUFFER_LEN;
+    uint64_t cycles = 0, round_cycles = 0;
+    double elapsed = 0, round_elapsed = 0, cycles_per_byte = 0;
+
+    for (idx = 0; idx < sizeof(buffer); idx++) {
+        buffer[idx] = (uint8_t)(idx * 31 + 7);
+    }
+
+    /* 预热一次, 排除缓存和频率调节的影响 */
+    func(buffer, sizeof(buffer), repeat / 16, output);
+
+    for (round = 0; round < DIGEST_BENCH_ROUNDS; round++) {
+        round_elapsed = _digest_bench_now();
+        round_cycles = _digest_bench_cycles();
+        func(buffer, sizeof(buffer), repeat, output);
+        round_cycles = _digest_bench_cycles() - round_cycles;
+        round_elapsed = _digest_bench_now() - round_elapsed;
+        if (round == 0 || round_elapsed < elapsed) {
+            elapsed = round_elapsed;
+            cycles = round_cycles;
+        }
+    }
+
+    if (cycles > 0) {
+        cycles_per_byte = (double)cycles / DIGEST_BENCH_TOTAL_LEN;
+    } else {
+        cycles_per_byte = DIGEST_BENCH_CPU_MHZ * 1e6 * elapsed / DIGEST_BENCH_TOTAL_LEN;
+    }
+
+    printf("%-8s %8.1f MB/s %8.2f host-cycles/byte\n", name, DIGEST_BENCH_TOTAL_LEN / elapsed / 1e6, cycles_per_byte);
+}
+
+int main(int argc, char *argv[])
+{
+    int32_t res = 0;
+    const char *algo = (argc > 1) ? argv[1] : NULL;
+
+    if (algo == NULL || strcmp(algo, "sha256") == 0) {
+        res |= _digest_bench_verify("sha256", _digest_bench_sha256, digest_sha256_vectors, DIGEST_SHA256_VECTORS_NUM,
+                                    CORE_SHA256_DIGEST_LENGTH);
+        if (res == 0) {
+            _digest_bench_measure("sha256", _digest_bench_sha256);
+        }
+    }
+    if (algo == NULL || strcmp(algo, "md5") == 0) {
+        res |= _digest_bench_verify("md5", _digest_bench_md5, digest_md5_vectors, DIGEST_MD5_VECTORS_NUM, 16);
+        if (res == 0) {
+            _digest_bench_measure("md5", _digest_bench_md5);
+        }
+    }
+
+    return (res == 0) ? 0 : 1;
+}
@@ -0,0 +1,49 @@
+#!/bin/bash
+#
+# 分别编译每一种SHA256/MD5实现, 输出代码大小以及在主机上测得的速度, 用法:
+#
+#     bash host-tools/digest_bench.sh <output_dir>
+#
+# 代码大小使用AIOT_CC以-Os编译得到, 交叉编译时即为目标平台上的大小; 速度总是在主机上测量
+
+if [ "${1}" = "" ];then
+    exit 1
+fi
+
+OBJDIR=${1}/digest_bench
+HOST_CC=gcc
+TARGET_CC=${AIOT_CC:-gcc}
+TARGET_SIZE=${TARGET_CC%gcc}size
+INC="-Icore -Icore/sysdep -Icore/utils -Icomponents/ota -Ihost-tools -Iexternal/mbedtls/include"
+
+mkdir -p ${OBJDIR}
+
+text_size() {
+    ${TARGET_SIZE} ${1} | sed '1d' | awk '{ print $1 }'
+}
+
+bench() {
+    local algo=${1} name=${2} src=${3} flags=${4} extra=${5}
+    local obj=${OBJDIR}/${algo}_${name}.o
+    local size shared=""
+
+    ${TARGET_CC} -Os -c ${INC} ${flags} -o ${obj} ${src} || return 1
+    size=$(text_size ${obj})
+    if [ "${extra}" != "" ]; then
+        ${TARGET_CC} -Os -c ${INC} -o ${OBJDIR}/${algo}_${name}_extra.o ${extra} || return 1
+        shared="(+$(text_size ${OBJDIR}/${algo}_${name}_extra.o) shared with TLS)"
+    fi
+
+    ${HOST_CC} -O2 ${INC} ${flags} -o ${OBJDIR}/${algo}_${name} \
+        host-tools/digest_bench.c core/utils/core_sha256.c components/ota/ota_md5.c ${extra} || return 1
+    printf "    | %-6s | %-9s | %6s bytes %-30s | " ${algo} ${name} ${size} "${shared}"
+    ${OBJDIR}/${algo}_${name} ${algo} | awk '{ printf("%s %s  %s %s\n", $2, $3, $4, $5) }'
+}
+
+echo ""
+bench sha256 compact core/utils/core_sha256.c ""
+bench sha256 unrolled core/utils/core_sha256.c "-DCORE_SHA256_IMPL_UNROLLED"
+bench sha256 mbedtls core/utils/core_sha256.c "-DCORE_SHA256_IMPL_MBEDTLS" external/mbedtls/library/sha256.c
+bench md5 unrolled components/ota/ota_md5.c ""
+bench md5 compact components/ota/ota_md5.c "-DOTA_MD5_IMPL_COMPACT"
+echo ""
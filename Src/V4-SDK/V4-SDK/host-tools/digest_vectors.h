@@ -0,0 +1,46 @@
+/**
+ * @file digest_vectors.h
+ * @brief SHA256(FIPS 180-2)和MD5(RFC 1321)的标准测试向量, 由单元测试和digest_bench共用,
+ *        保证每一种编译时选择的实现都用同一组数据校验
+ */
+
+#ifndef _DIGEST_VECTORS_H_
+#define _DIGEST_VECTORS_H_
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+typedef struct {
+    const char *input;      /* 输入, 重复repeat次 */
+    uint32_t    repeat;
+    const char *digest;     /* 小写十六进制字符串 */
+} digest_vector_t;
+
+static const digest_vector_t digest_sha256_vectors[] = {
+    {"", 1, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+    {"abc", 1, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+    {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1, "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+    {"aaaaaaaaaa", 100000, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"},
+};
+
+static const digest_vector_t digest_md5_vectors[] = {
+    {"", 1, "d41d8cd98f00b204e9800998ecf8427e"},
+    {"a", 1, "0cc175b9c0f1b6a831c399e269772661"},
+    {"abc", 1, "900150983cd24fb0d6963f7d28e17f72"},
+    {"message digest", 1, "f96b697d7cb7938d525a2f31aaf161d0"},
+    {"abcdefghijklmnopqrstuvwxyz", 1, "c3fcd3d76192e4007dfb496cca67e13b"},
+    {"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", 1, "d174ab98d277d9f5a5611c2c9f419d9f"},
+    {"1234567890", 8, "57edf4a22be3c955ac49da2e2107b67a"},
+};
+
+#define DIGEST_SHA256_VECTORS_NUM   (sizeof(digest_sha256_vectors) / sizeof(digest_vector_t))
+#define DIGEST_MD5_VECTORS_NUM      (sizeof(digest_md5_vectors) / sizeof(digest_vector_t))
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
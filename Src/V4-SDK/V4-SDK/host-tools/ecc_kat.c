@@ -0,0 +1,299 @@
+/**
+ * @file ecc_kat.c
+ * @brief 在主机上用已知答案校验MBEDTLS_SSL_ECC_PROFILE打开的secp256r1点乘、ECDSA、ECDH和AES-GCM实现
+ *
+ * 编译和运行:
+ *     make ecc-kat, 或 bash host-tools/ecc_kat.sh <output_dir>
+ *
+ * ecc_kat.c、ecp.c和gcm.c需要以MBEDTLS_SELF_TEST编译, 其它mbedtls源文件不能带该宏, 见ecc_kat.sh
+ *
+ * 依次运行mbedtls_ecp_self_test、mbedtls_gcm_self_test和ecc_vectors.h中的已知答案, 任何一项失败返回1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "mbedtls/ecp.h"
+#include "mbedtls/ecdh.h"
+#include "mbedtls/ecdsa.h"
+#include "mbedtls/gcm.h"
+#include "mbedtls/sha256.h"
+#include "ecc_vectors.h"
+
+#if !defined(MBEDTLS_SSL_ECC_PROFILE) || !defined(MBEDTLS_SELF_TEST)
+#error "ecc_kat must be built with -DMBEDTLS_SSL_ECC_PROFILE -DMBEDTLS_SELF_TEST"
+#endif
+
+#define ECC_KAT_MAX_LEN     (128)
+
+typedef struct {
+    const unsigned char *fixed;     /* 第一次调用时输出的固定数据, 用作ECDSA的临时密钥k */
+    size_t fixed_len;
+    uint32_t state;
+} ecc_kat_rng_t;
+
+/* 只用于点乘的随机化和签名的盲化, 不需要密码学强度 */
+static int _ecc_kat_rng(void *p_rng, unsigned char *output, size_t len)
+{
+    ecc_kat_rng_t *rng = (ecc_kat_rng_t *)p_rng;
+
+    if (rng->fixed != NULL && rng->fixed_len == len) {
+        memcpy(output, rng->fixed, len);
+        rng->fixed = NULL;
+        return 0;
+    }
+    while (len--) {
+        rng->state ^= rng->state << 13;
+        rng->state ^= rng->state >> 17;
+        rng->state ^= rng->state << 5;
+        *output++ = (unsigned char)rng->state;
+    }
+
+    return 0;
+}
+
+static size_t _ecc_kat_unhex(const char *input, unsigned char *output)
+{
+    size_t idx = 0, len = strlen(input) / 2;
+    unsigned int byte = 0;
+
+    for (idx = 0; idx < len && idx < ECC_KAT_MAX_LEN; idx++) {
+        sscanf(&input[idx * 2], "%2x", &byte);
+        output[idx] = (unsigned char)byte;
+    }
+
+    return idx;
+}
+
+static int32_t _ecc_kat_load_point(mbedtls_ecp_point *point, const ecc_mul_vector_t *vector)
+{
+    if (mbedtls_mpi_read_string(&point->X, 16, vector->x) != 0 || mbedtls_mpi_read_string(&point->Y, 16, vector->y) != 0 ||
+        mbedtls_mpi_lset(&point->Z, 1) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int32_t _ecc_kat_check_mul(mbedtls_ecp_group *grp, ecc_kat_rng_t *rng)
+{
+    mbedtls_ecp_point R, expect;
+    mbedtls_mpi k;
+    uint32_t idx = 0;
+    int32_t res = 0;
+
+    mbedtls_ecp_point_init(&R);
+    mbedtls_ecp_point_init(&expect);
+    mbedtls_mpi_init(&k);
+
+    for (idx = 0; res == 0 && idx < ECC_MUL_VECTORS_NUM; idx++) {
+        const ecc_mul_vector_t *vector = &ecc_mul_vectors[idx];
+
+        /* 不带随机数时走确定的路径, 带随机数时走随机化射影坐标的路径, 两者都要得到同一个点 */
+        if (mbedtls_mpi_read_string(&k, 16, vector->k) != 0 || _ecc_kat_load_point(&expect, vector) < 0 ||
+            mbedtls_ecp_check_pubkey(grp, &expect) != 0 ||
+            mbedtls_ecp_mul(grp, &R, &k, &grp->G, NULL, NULL) != 0 || mbedtls_ecp_point_cmp(&R, &expect) != 0 ||
+            mbedtls_ecp_mul(grp, &R, &k, &grp->G, _ecc_kat_rng, rng) != 0 || mbedtls_ecp_point_cmp(&R, &expect) != 0) {
+            printf("mul vector %u failed\n", idx);
+            res = -1;
+        }
+    }
+
+    /* 不在曲线上的点必须被拒绝 */
+    if (res == 0) {
+        if (_ecc_kat_load_point(&expect, &ecc_mul_vectors[4]) < 0 || mbedtls_mpi_add_int(&expect.Y, &expect.Y, 1) != 0 ||
+            mbedtls_ecp_check_pubkey(grp, &expect) == 0) {
+            printf("invalid point accepted\n");
+            res = -1;
+        }
+    }
+
+    mbedtls_ecp_point_free(&R);
+    mbedtls_ecp_point_free(&expect);
+    mbedtls_mpi_free(&k);
+
+    return res;
+}
+
+static int32_t _ecc_kat_check_ecdsa(ecc_kat_rng_t *rng)
+{
+    mbedtls_ecdsa_context ctx;
+    unsigned char hash[32], k[ECC_KAT_MAX_LEN], expect[ECC_KAT_MAX_LEN], sig[MBEDTLS_ECDSA_MAX_LEN];
+    size_t k_len = 0, expect_len = 0, sig_len = 0;
+    int32_t res = 0;
+
+    mbedtls_sha256((const unsigned char *)ecc_vectors_message, strlen(ecc_vectors_message), hash, 0);
+
+    /* RFC 6979: 固定k后签名结果确定, 同时校验DER编码 */
+    mbedtls_ecdsa_init(&ctx);
+    k_len = _ecc_kat_unhex(ecc_vectors_rfc6979_k, k);
+    expect_len = _ecc_kat_unhex(ecc_vectors_rfc6979_der, expect);
+    rng->fixed = k;
+    rng->fixed_len = k_len;
+    if (mbedtls_ecp_group_load(&ctx.grp, MBEDTLS_ECP_DP_SECP256R1) != 0 ||
+        mbedtls_mpi_read_string(&ctx.d, 16, ecc_mul_vectors[3].k) != 0 || _ecc_kat_load_point(&ctx.Q, &ecc_mul_vectors[3]) < 0 ||
+        mbedtls_ecdsa_write_signature(&ctx, MBEDTLS_MD_SHA256, hash, sizeof(hash), sig, &sig_len, _ecc_kat_rng, rng) != 0 ||
+        sig_len != expect_len || memcmp(sig, expect, sig_len) != 0) {
+        printf("rfc6979 sign mismatch\n");
+        res = -1;
+    }
+    rng->fixed = NULL;
+    if (res == 0 && mbedtls_ecdsa_read_signature(&ctx, hash, sizeof(hash), expect, expect_len) != 0) {
+        printf("rfc6979 verify failed\n");
+        res = -1;
+    }
+    mbedtls_ecdsa_free(&ctx);
+    if (res < 0) {
+        return res;
+    }
+
+    /* openssl的签名, 以及篡改后的签名和消息 */
+    mbedtls_ecdsa_init(&ctx);
+    expect_len = _ecc_kat_unhex(ecc_vectors_openssl_der, expect);
+    if (mbedtls_ecp_group_load(&ctx.grp, MBEDTLS_ECP_DP_SECP256R1) != 0 ||
+        _ecc_kat_load_point(&ctx.Q, &ecc_mul_vectors[4]) < 0 ||
+        mbedtls_ecdsa_read_signature(&ctx, hash, sizeof(hash), expect, expect_len) != 0) {
+        printf("openssl signature rejected\n");
+        res = -1;
+    }
+    if (res == 0) {
+        expect[expect_len - 1] ^= 0x01;
+        if (mbedtls_ecdsa_read_signature(&ctx, hash, sizeof(hash), expect, expect_len) == 0) {
+            printf("corrupted signature accepted\n");
+            res = -1;
+        }
+        expect[expect_len - 1] ^= 0x01;
+        hash[0] ^= 0x01;
+        if (mbedtls_ecdsa_read_signature(&ctx, hash, sizeof(hash), expect, expect_len) == 0) {
+            printf("signature accepted for another message\n");
+            res = -1;
+        }
+        hash[0] ^= 0x01;
+    }
+
+    /* 随机k签名后能用同一公钥验证 */
+    if (res == 0) {
+        if (mbedtls_mpi_read_string(&ctx.d, 16, ecc_mul_vectors[4].k) != 0 ||
+            mbedtls_ecdsa_write_signature(&ctx, MBEDTLS_MD_SHA256, hash, sizeof(hash), sig, &sig_len, _ecc_kat_rng,
+                                          rng) != 0 ||
+            mbedtls_ecdsa_read_signature(&ctx, hash, sizeof(hash), sig, sig_len) != 0) {
+            printf("sign/verify round trip failed\n");
+            res = -1;
+        }
+    }
+    mbedtls_ecdsa_free(&ctx);
+
+    return res;
+}
+
+static int32_t _ecc_kat_check_ecdh(mbedtls_ecp_group *grp, ecc_kat_rng_t *rng)
+{
+    mbedtls_ecp_point Q;
+    mbedtls_mpi d, z, expect;
+    int32_t res = 0;
+
+    mbedtls_ecp_point_init(&Q);
+    mbedtls_mpi_init(&d);
+    mbedtls_mpi_init(&z);
+    mbedtls_mpi_init(&expect);
+
+    if (mbedtls_mpi_read_string(&d, 16, ecc_mul_vectors[4].k) != 0 || _ecc_kat_load_point(&Q, &ecc_mul_vectors[5]) < 0 ||
+        mbedtls_mpi_read_string(&expect, 16, ecc_vectors_ecdh_z) != 0 ||
+        mbedtls_ecdh_compute_shared(grp, &z, &Q, &d, _ecc_kat_rng, rng) != 0 || mbedtls_mpi_cmp_mpi(&z, &expect) != 0) {
+        printf("ecdh shared secret mismatch\n");
+        res = -1;
+    }
+
+    /* 反过来协商得到同一个密钥 */
+    if (res == 0) {
+        if (mbedtls_mpi_read_string(&d, 16, ecc_mul_vectors[5].k) != 0 || _ecc_kat_load_point(&Q, &ecc_mul_vectors[4]) < 0 ||
+            mbedtls_ecdh_compute_shared(grp, &z, &Q, &d, NULL, NULL) != 0 || mbedtls_mpi_cmp_mpi(&z, &expect) != 0) {
+            printf("ecdh reverse mismatch\n");
+            res = -1;
+        }
+    }
+
+    mbedtls_ecp_point_free(&Q);
+    mbedtls_mpi_free(&d);
+    mbedtls_mpi_free(&z);
+    mbedtls_mpi_free(&expect);
+
+    return res;
+}
+
+static int32_t _ecc_kat_check_gcm(void)
+{
+    mbedtls_gcm_context ctx;
+    unsigned char key[ECC_KAT_MAX_LEN], iv[ECC_KAT_MAX_LEN], aad[ECC_KAT_MAX_LEN], pt[ECC_KAT_MAX_LEN];
+    unsigned char ct[ECC_KAT_MAX_LEN], tag[16], output[ECC_KAT_MAX_LEN], output_tag[16];
+    size_t key_len = 0, iv_len = 0, aad_len = 0, pt_len = 0;
+    uint32_t idx = 0;
+    int32_t res = 0;
+
+    for (idx = 0; res == 0 && idx < ECC_GCM_VECTORS_NUM; idx++) {
+        const ecc_gcm_vector_t *vector = &ecc_gcm_vectors[idx];
+
+        key_len = _ecc_kat_unhex(vector->key, key);
+        iv_len = _ecc_kat_unhex(vector->iv, iv);
+        aad_len = _ecc_kat_unhex(vector->aad, aad);
+        pt_len = _ecc_kat_unhex(vector->pt, pt);
+        _ecc_kat_unhex(vector->ct, ct);
+        _ecc_kat_unhex(vector->tag, tag);
+
+        mbedtls_gcm_init(&ctx);
+        if (mbedtls_gcm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, key, key_len * 8) != 0 ||
+            mbedtls_gcm_crypt_and_tag(&ctx, MBEDTLS_GCM_ENCRYPT, pt_len, iv, iv_len, aad, aad_len, pt, output,
+                                      sizeof(output_tag), output_tag) != 0 ||
+            memcmp(output, ct, pt_len) != 0 || memcmp(output_tag, tag, sizeof(tag)) != 0) {
+            printf("gcm vector %u encrypt mismatch\n", idx);
+            res = -1;
+        }
+        if (res == 0 && (mbedtls_gcm_auth_decrypt(&ctx, pt_len, iv, iv_len, aad, aad_len, tag, sizeof(tag), ct,
+                         output) != 0 || memcmp(output, pt, pt_len) != 0)) {
+            printf("gcm vector %u decrypt mismatch\n", idx);
+            res = -1;
+        }
+        if (res == 0) {
+            tag[0] ^= 0x01;
+            if (mbedtls_gcm_auth_decrypt(&ctx, pt_len, iv, iv_len, aad, aad_len, tag, sizeof(tag), ct,
+                                         output) != MBEDTLS_ERR_GCM_AUTH_FAILED) {
+                printf("gcm vector %u corrupted tag accepted\n", idx);
+                res = -1;
+            }
+        }
+        mbedtls_gcm_free(&ctx);
+    }
+
+    return res;
+}
+
+int main(int argc, char *argv[])
+{
+    mbedtls_ecp_group grp;
+    ecc_kat_rng_t rng = {NULL, 0, 0x2545F491};
+    int32_t res = 0;
+
+    if (mbedtls_ecp_self_test(1) != 0) {
+        res = -1;
+    }
+    if (mbedtls_gcm_self_test(1) != 0) {
+        res = -1;
+    }
+
+    mbedtls_ecp_group_init(&grp);
+    if (mbedtls_ecp_group_load(&grp, MBEDTLS_ECP_DP_SECP256R1) != 0) {
+        printf("secp256r1 not available\n");
+        return 1;
+    }
+    res |= _ecc_kat_check_mul(&grp, &rng);
+    res |= _ecc_kat_check_ecdsa(&rng);
+    res |= _ecc_kat_check_ecdh(&grp, &rng);
+    res |= _ecc_kat_check_gcm();
+    mbedtls_ecp_group_free(&grp);
+
+    printf("  secp256r1/ECDSA/ECDH/GCM known answers: %s\n", (res == 0) ? "passed" : "failed");
+
+    return (res == 0) ? 0 : 1;
+}
@@ -0,0 +1,25 @@
+#!/bin/bash
+#
+# 以MBEDTLS_SSL_ECC_PROFILE编译ecc_kat, 运行secp256r1点乘、ECDSA、ECDH和AES-GCM的已知答案校验, 失败时返回非0, 用法:
+#
+#     bash host-tools/ecc_kat.sh <output_dir>
+#
+# 只有ecp.c和gcm.c以MBEDTLS_SELF_TEST编译, 其它模块的自检依赖没有随SDK提供的mbedtls/certs.h
+
+if [ "${1}" = "" ];then
+    exit 1
+fi
+
+OBJDIR=${1}/ecc_kat
+CFLAGS="-O2 -DMBEDTLS_SSL_ECC_PROFILE -Ihost-tools -Iexternal/mbedtls/include"
+SRCS=$(ls external/mbedtls/library/*.c | grep -v -e '/ecp\.c$' -e '/gcm\.c$')
+
+mkdir -p ${OBJDIR}
+
+for SRC in host-tools/ecc_kat.c external/mbedtls/library/ecp.c external/mbedtls/library/gcm.c; do
+    gcc ${CFLAGS} -DMBEDTLS_SELF_TEST -c -o ${OBJDIR}/$(basename ${SRC} .c).o ${SRC} || exit 1
+done
+gcc ${CFLAGS} -o ${OBJDIR}/ecc_kat ${OBJDIR}/ecc_kat.o ${OBJDIR}/ecp.o ${OBJDIR}/gcm.o ${SRCS} || exit 1
+
+echo ""
+${OBJDIR}/ecc_kat
@@ -0,0 +1,116 @@
+/**
+ * @file ecc_vectors.h
+ * @brief secp256r1点乘、ECDSA签名/验签、ECDH和AES-GCM的已知答案, 由ecc_kat校验MBEDTLS_SSL_ECC_PROFILE打开的实现
+ *
+ * 点乘的期望值由Python的整数运算得到, 并与openssl ec -text输出的公钥核对.
+ * ECDSA第一组取自RFC 6979 A.2.5(P-256, SHA-256, "sample"), 第二组的签名由openssl dgst -sha256 -sign生成.
+ * ECDH的共享密钥由openssl pkeyutl -derive得到. GCM第一组为GCM规范中的Test Case 3, 第二组由libcrypto的EVP接口生成
+ */
+
+#ifndef _ECC_VECTORS_H_
+#define _ECC_VECTORS_H_
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+typedef struct {
+    const char *k;          /* 十六进制字符串, 下同 */
+    const char *x;          /* (x, y) = k * G */
+    const char *y;
+} ecc_mul_vector_t;
+
+static const ecc_mul_vector_t ecc_mul_vectors[] = {
+    {
+        "0000000000000000000000000000000000000000000000000000000000000001",
+        "6B17D1F2E12C4247F8BCE6E563A440F277037D812DEB33A0F4A13945D898C296",
+        "4FE342E2FE1A7F9B8EE7EB4A7C0F9E162BCE33576B315ECECBB6406837BF51F5"
+    },
+    {
+        "0000000000000000000000000000000000000000000000000000000000000002",
+        "7CF27B188D034F7E8A52380304B51AC3C08969E277F21B35A60B48FC47669978",
+        "07775510DB8ED040293D9AC69F7430DBBA7DADE63CE982299E04B79D227873D1"
+    },
+    {
+        /* n - 1, 结果为-G */
+        "FFFFFFFF00000000FFFFFFFFFFFFFFFFBCE6FAADA7179E84F3B9CAC2FC632550",
+        "6B17D1F2E12C4247F8BCE6E563A440F277037D812DEB33A0F4A13945D898C296",
+        "B01CBD1C01E58065711814B583F061E9D431CCA994CEA1313449BF97C840AE0A"
+    },
+    {
+        /* RFC 6979 A.2.5的私钥 */
+        "C9AFA9D845BA75166B5C215767B1D6934E50C3DB36E89B127B8A622B120F6721",
+        "60FED4BA255A9D31C961EB74C6356D68C049B8923B61FA6CE669622E60F29FB6",
+        "7903FE1008B8BC99A41AE9E95628BC64F2F1B20C2D7E9F5177A3C294D4462299"
+    },
+    {
+        "6F0644E4957B53ECA97A00247F43D94C533429074DDF2EBE053BD7E384ED4BED",
+        "D31704D8C68A0305B12249CD6D5454A1B77B7D916228D01DAFE316A88D954EE8",
+        "3B8E2B2F775E8B61EA741CCD01394B4D9AEBD117DD1AA14A9E15F40B80753F85"
+    },
+    {
+        "C11DA5981E0BAF6C0C903FF2C4605185C0BA48815317A5EF8DF5C6B7F4CFD46A",
+        "A6F5889C472DA5E2845241F74B2614C4A769F47C04BDCE441D441F79B52FF08A",
+        "2698588422A153BEBAA1BE63D40D64C18E73FD7E48BFFE73EEABC75397DFACF4"
+    },
+};
+
+#define ECC_MUL_VECTORS_NUM     (sizeof(ecc_mul_vectors) / sizeof(ecc_mul_vector_t))
+
+/* 两组签名的消息都是"sample", 对其SHA-256签名 */
+static const char *ecc_vectors_message = "sample";
+
+/* RFC 6979 A.2.5: 私钥为ecc_mul_vectors[3], 临时密钥k固定时签名结果确定 */
+static const char *ecc_vectors_rfc6979_k = "A6E3C57DD01ABE90086538398355DD4C3B17AA873382B0F24D6129493D8AAD60";
+static const char *ecc_vectors_rfc6979_der =
+    "3046022100EFD48B2AACB6A8FD1140DD9CD45E81D69D2C877B56AAF991C34D0EA84EAF3716022100F7CB1C942D657C41D436C7A1"
+    "B6E29F65F3E900DBB9AFF4064DC4AB2F843ACDA8";
+
+/* openssl生成的签名, 公钥为ecc_mul_vectors[4] */
+static const char *ecc_vectors_openssl_der =
+    "3045022100FC273412EBABE36851CFCD09C370C71589C3A99ED3D7E51AC30A0B4DEEA9D1C60220019908DA7E9E9915E47CB8FE6A"
+    "51FF6E7ED4A002D5B2007C8E3C0EDD61B2A735";
+
+/* ECDH: ecc_mul_vectors[4]的私钥与ecc_mul_vectors[5]的公钥协商得到的共享密钥 */
+static const char *ecc_vectors_ecdh_z = "2878BB68DCED955B9DA27D86CD5AA714A8C6C91A2E99055AFA7F37F2737EEB72";
+
+typedef struct {
+    const char *key;
+    const char *iv;
+    const char *aad;
+    const char *pt;
+    const char *ct;
+    const char *tag;
+} ecc_gcm_vector_t;
+
+static const ecc_gcm_vector_t ecc_gcm_vectors[] = {
+    {
+        "FEFFE9928665731C6D6A8F9467308308",
+        "CAFEBABEFACEDBADDECAF888",
+        "",
+        "D9313225F88406E5A55909C5AFF5269A86A7A9531534F7DA2E4C303D8A318A721C3C0C95956809532FCF0E2449A6B525"
+        "B16AEDF5AA0DE657BA637B391AAFD255",
+        "42831EC2217774244B7221B784D0D49CE3AA212F2C02A4E035C17E2329ACA12E21D514B25466931C7D8F6A5AAC84AA05"
+        "1BA30B396A0AAC973D58E091473F5985",
+        "4D5C2AF327CD64A62CF35ABD2BA6FAB4"
+    },
+    {
+        /* AES-256, AAD和明文都不是整块 */
+        "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F",
+        "F0F1F2F3F4F5F6F7F8F9FAFB",
+        "4D5154542F6F74612F6465766963652F31",
+        "7B22636F6465223A2231303030222C2264617461223A7B2273697A65223A313032347D7D00",
+        "1224206F185FF04EBDC6C7AABE684E9474802DA31A3D34BA253F49C57B09E3372E246BF940",
+        "F931BC01B7EFBEE852222DF8FED367C2"
+    },
+};
+
+#define ECC_GCM_VECTORS_NUM     (sizeof(ecc_gcm_vectors) / sizeof(ecc_gcm_vector_t))
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,35 @@
+/**
+ * @file FreeRTOS.h
+ * @brief 在主机上运行FreeRTOS对接层时使用的最小替身, 只提供对接层用到的内核接口, 以pthread实现
+ *
+ * 仅用于host-tools中的基准测试, 不是FreeRTOS的移植, 任务调度的语义只保证互斥和超时等待
+ */
+
+#ifndef _FREERTOS_SHIM_H_
+#define _FREERTOS_SHIM_H_
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+
+#define configTICK_RATE_HZ          (1000)
+#define portTICK_PERIOD_MS          (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY               ((TickType_t)0xFFFFFFFFUL)
+#define pdTRUE                      (1)
+#define pdFALSE                     (0)
+
+void *pvPortMalloc(size_t size);
+
+void vPortFree(void *ptr);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* #ifndef _FREERTOS_SHIM_H_ */
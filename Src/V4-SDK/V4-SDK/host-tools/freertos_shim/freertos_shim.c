@@ -0,0 +1,145 @@
+/**
+ * @file freertos_shim.c
+ * @brief FreeRTOS内核接口的主机替身, 见FreeRTOS.h
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+struct freertos_shim_sem {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint8_t count;
+};
+
+static pthread_mutex_t g_freertos_shim_scheduler = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+static uint64_t _freertos_shim_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void *pvPortMalloc(size_t size)
+{
+    return malloc(size);
+}
+
+void vPortFree(void *ptr)
+{
+    free(ptr);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    static uint64_t start_ms = 0;
+
+    if (start_ms == 0) {
+        start_ms = _freertos_shim_now_ms();
+    }
+    return (TickType_t)((_freertos_shim_now_ms() - start_ms) / portTICK_PERIOD_MS);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec ts;
+
+    ts.tv_sec = (uint64_t)ticks * portTICK_PERIOD_MS / 1000;
+    ts.tv_nsec = (uint64_t)ticks * portTICK_PERIOD_MS % 1000 * 1000000;
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR);
+}
+
+void vTaskSuspendAll(void)
+{
+    pthread_mutex_lock(&g_freertos_shim_scheduler);
+}
+
+BaseType_t xTaskResumeAll(void)
+{
+    pthread_mutex_unlock(&g_freertos_shim_scheduler);
+    return pdFALSE;
+}
+
+static SemaphoreHandle_t _freertos_shim_sem_create(uint8_t count)
+{
+    SemaphoreHandle_t sem = malloc(sizeof(struct freertos_shim_sem));
+    pthread_condattr_t attr;
+
+    if (sem == NULL) {
+        return NULL;
+    }
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&sem->mutex, NULL);
+    pthread_cond_init(&sem->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    sem->count = count;
+
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return _freertos_shim_sem_create(0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return _freertos_shim_sem_create(1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    struct timespec deadline;
+    uint64_t ns = 0;
+    int res = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    ns = (uint64_t)deadline.tv_nsec + (uint64_t)ticks * portTICK_PERIOD_MS * 1000000;
+    deadline.tv_sec += ns / 1000000000;
+    deadline.tv_nsec = ns % 1000000000;
+
+    pthread_mutex_lock(&sem->mutex);
+    while (sem->count == 0 && res != ETIMEDOUT) {
+        if (ticks == portMAX_DELAY) {
+            pthread_cond_wait(&sem->cond, &sem->mutex);
+        } else {
+            res = pthread_cond_timedwait(&sem->cond, &sem->mutex, &deadline);
+        }
+    }
+    if (sem->count == 0) {
+        pthread_mutex_unlock(&sem->mutex);
+        return pdFALSE;
+    }
+    sem->count = 0;
+    pthread_mutex_unlock(&sem->mutex);
+
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    pthread_mutex_lock(&sem->mutex);
+    sem->count = 1;
+    pthread_cond_signal(&sem->cond);
+    pthread_mutex_unlock(&sem->mutex);
+
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    pthread_cond_destroy(&sem->cond);
+    pthread_mutex_destroy(&sem->mutex);
+    free(sem);
+}
@@ -0,0 +1,32 @@
+/**
+ * @file semphr.h
+ * @brief FreeRTOS信号量接口的主机替身, 见FreeRTOS.h
+ */
+
+#ifndef _FREERTOS_SHIM_SEMPHR_H_
+#define _FREERTOS_SHIM_SEMPHR_H_
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "FreeRTOS.h"
+
+typedef struct freertos_shim_sem *SemaphoreHandle_t;
+
+/* 二值信号量创建后为空, 互斥量创建后可以立即获取 */
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+
+void vSemaphoreDelete(SemaphoreHandle_t sem);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* #ifndef _FREERTOS_SHIM_SEMPHR_H_ */
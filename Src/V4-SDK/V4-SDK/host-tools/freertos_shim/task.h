@@ -0,0 +1,28 @@
+/**
+ * @file task.h
+ * @brief FreeRTOS任务接口的主机替身, 见FreeRTOS.h
+ */
+
+#ifndef _FREERTOS_SHIM_TASK_H_
+#define _FREERTOS_SHIM_TASK_H_
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "FreeRTOS.h"
+
+TickType_t xTaskGetTickCount(void);
+
+void vTaskDelay(TickType_t ticks);
+
+/* 挂起调度器只用于互斥, 以一把全局的递归锁实现 */
+void vTaskSuspendAll(void);
+
+BaseType_t xTaskResumeAll(void);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* #ifndef _FREERTOS_SHIM_TASK_H_ */
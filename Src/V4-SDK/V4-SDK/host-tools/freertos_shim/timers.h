@@ -0,0 +1,11 @@
+/**
+ * @file timers.h
+ * @brief 对接层包含了此头文件但没有用到其中的接口, 见FreeRTOS.h
+ */
+
+#ifndef _FREERTOS_SHIM_TIMERS_H_
+#define _FREERTOS_SHIM_TIMERS_H_
+
+#include "FreeRTOS.h"
+
+#endif /* #ifndef _FREERTOS_SHIM_TIMERS_H_ */
@@ -0,0 +1,180 @@
+/**
+ * @file json_bench.c
+ * @brief 在主机上比较OTA/COTA升级消息的两种解析方式的速度和堆调用次数
+ *
+ * 编译:
+ *     gcc -O2 -Icore -Icore/sysdep -Icore/utils -o json_bench \
+ *         host-tools/json_bench.c core/utils/core_string.c
+ *
+ * 用法:
+ *     ./json_bench
+ *
+ * legacy为改写前_ota_mqtt_process的做法: 每个键都用core_json_value从头扫描一遍, 并把值拷贝到单独malloc的内存中;
+ * tokens为core_json_parse扫描一遍后用core_json_find按路径查找, 只为需要'\0'结尾的值分配一次内存
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "core_string.h"
+
+#define JSON_BENCH_ITERATIONS   (200000)
+#define JSON_BENCH_TOKENS_NUM   (48)
+#define JSON_BENCH_KEYS_NUM     (5)
+
+static uint32_t g_json_bench_heap_calls;
+
+typedef struct {
+    const char *name;
+    const char *payload;
+    const char *paths[JSON_BENCH_KEYS_NUM];
+} json_bench_case_t;
+
+#define JSON_BENCH_PATH_PREFIX  "data."
+
+static double _json_bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *_json_bench_malloc(uint32_t size)
+{
+    g_json_bench_heap_calls++;
+    return malloc(size);
+}
+
+static void _json_bench_free(void *ptr)
+{
+    g_json_bench_heap_calls++;
+    free(ptr);
+}
+
+/* 改写前的做法, 先取出data再逐个取值, 结果依次用'|'连接写入output */
+static int32_t _json_bench_legacy(json_bench_case_t *bench_case, char *output)
+{
+    char *data = NULL, *value = NULL, *copies[JSON_BENCH_KEYS_NUM] = {NULL};
+    uint32_t data_len = 0, value_len = 0, idx = 0;
+    int32_t res = 0;
+
+    if (core_json_value(bench_case->payload, strlen(bench_case->payload), "data", strlen("data"), &data,
+                        &data_len) != STATE_SUCCESS) {
+        return -1;
+    }
+    for (idx = 0; idx < JSON_BENCH_KEYS_NUM; idx++) {
+        const char *key = bench_case->paths[idx] + strlen(JSON_BENCH_PATH_PREFIX);
+        if (core_json_value(data, data_len, key, strlen(key), &value, &value_len) != STATE_SUCCESS) {
+            res = -1;
+            break;
+        }
+        copies[idx] = _json_bench_malloc(value_len + 1);
+        memset(copies[idx], 0, value_len + 1);
+        memcpy(copies[idx], value, value_len);
+    }
+    for (idx = 0, output[0] = '\0'; idx < JSON_BENCH_KEYS_NUM; idx++) {
+        if (copies[idx] != NULL) {
+            strcat(strcat(output, copies[idx]), "|");
+            _json_bench_free(copies[idx]);
+        }
+    }
+
+    return res;
+}
+
+static int32_t _json_bench_tokens(json_bench_case_t *bench_case, char *output)
+{
+    core_json_token_t tokens[JSON_BENCH_TOKENS_NUM];
+    char *values[JSON_BENCH_KEYS_NUM] = {NULL}, *strings = NULL;
+    uint32_t values_len[JSON_BENCH_KEYS_NUM] = {0}, strings_len = 0, idx = 0;
+    int32_t tokens_count = 0;
+
+    tokens_count = core_json_parse(bench_case->payload, strlen(bench_case->payload), tokens, JSON_BENCH_TOKENS_NUM);
+    if (tokens_count < 0) {
+        return -1;
+    }
+    for (idx = 0; idx < JSON_BENCH_KEYS_NUM; idx++) {
+        if (core_json_find(bench_case->payload, tokens, tokens_count, bench_case->paths[idx], &values[idx],
+                           &values_len[idx]) != STATE_SUCCESS) {
+            return -1;
+        }
+        strings_len += values_len[idx] + 1;
+    }
+
+    strings = _json_bench_malloc(strings_len);
+    for (idx = 0, output[0] = '\0'; idx < JSON_BENCH_KEYS_NUM; idx++) {
+        strncat(output, values[idx], values_len[idx]);
+        strcat(output, "|");
+    }
+    _json_bench_free(strings);
+
+    return 0;
+}
+
+static int32_t _json_bench_run(json_bench_case_t *bench_case, const char *mode,
+                               int32_t (*func)(json_bench_case_t *, char *), const char *expect)
+{
+    char output[1024];
+    uint32_t idx = 0;
+    double elapsed = 0;
+
+    g_json_bench_heap_calls = 0;
+    elapsed = _json_bench_now();
+    for (idx = 0; idx < JSON_BENCH_ITERATIONS; idx++) {
+        if (func(bench_case, output) < 0 || (expect != NULL && strcmp(output, expect) != 0)) {
+            printf("%s/%s: output mismatch\n", bench_case->name, mode);
+            return -1;
+        }
+    }
+    elapsed = _json_bench_now() - elapsed;
+
+    printf("    | %-12s | %-6s | %5u bytes | %9.1f ns/op | %4.1f heap calls/op |\n", bench_case->name, mode,
+           (uint32_t)strlen(bench_case->payload), elapsed * 1e9 / JSON_BENCH_ITERATIONS,
+           (double)g_json_bench_heap_calls / JSON_BENCH_ITERATIONS);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    json_bench_case_t cases[] = {
+        {
+            "fota",
+            "{\"code\":\"1000\",\"data\":{\"size\":432945,\"sign\":\"93230c3bde425a9d7984a594ac55ea1e\","
+            "\"version\":\"app-1.0.1-20210323.1022\",\"isDiff\":0,\"url\":\"https://iotx-ota.oss-cn-shanghai.aliyuncs.com/"
+            "ota/a1XXXXXXXXX/ckdrt0thm0000hbkaxk4wsu5h.bin?Expires=1617005612&OSSAccessKeyId=XXXXXXXXXXXXXXXXXXXXXXXX"
+            "&Signature=XXXXXXXXXXXXXXXXXXXXXXXXXXXX%3D\",\"signMethod\":\"Md5\",\"md5\":\"93230c3bde425a9d7984a594ac55ea1e\","
+            "\"module\":\"default\",\"extData\":{\"key1\":\"value1\",\"key2\":\"value2\",\"_package_udf\":\"{\\\"k\\\":1}\"}},"
+            "\"id\":1616917612284,\"message\":\"success\"}",
+            {"data.size", "data.version", "data.url", "data.signMethod", "data.sign"}
+        },
+        {
+            "cota",
+            "{\"id\":\"123\",\"code\":200,\"data\":{\"configId\":\"123dagdah\",\"configSize\":1923,"
+            "\"sign\":\"123c1dcfa1b3e5e2c97c7ee5e0da8a8e3edcd9c6a1c0e2b0b4e8f5d0c7a3b1e9\",\"signMethod\":\"Sha256\","
+            "\"url\":\"https://iotx-config.oss-cn-shanghai.aliyuncs.com/nopoll_0.4.4.tar.gz?Expires=1502955804"
+            "&OSSAccessKeyId=XXXXXXXXXXXXXXXXXXXX&Signature=XXXXXXXXXXXXXXXXXXXXXXXXXXX%3D\",\"getType\":\"file\"}}",
+            {"data.configSize", "data.configId", "data.url", "data.signMethod", "data.sign"}
+        },
+    };
+    char expect[1024];
+    uint32_t idx = 0;
+
+    printf("\n");
+    for (idx = 0; idx < sizeof(cases) / sizeof(cases[0]); idx++) {
+        if (_json_bench_tokens(&cases[idx], expect) < 0) {
+            printf("%s: failed to parse\n", cases[idx].name);
+            return 1;
+        }
+        if (_json_bench_run(&cases[idx], "legacy", _json_bench_legacy, expect) < 0 ||
+                _json_bench_run(&cases[idx], "tokens", _json_bench_tokens, expect) < 0) {
+            return 1;
+        }
+    }
+    printf("\n");
+
+    return 0;
+}
@@ -0,0 +1,361 @@
+/**
+ * @file log_decode.c
+ * @brief 在主机上把设备输出的二进制日志还原为文本, 记录格式见core/utils/core_log.h
+ *
+ * 编译:
+ *     gcc -Icore -Icore/sysdep -Icore/utils -o log_decode host-tools/log_decode.c
+ *
+ * 用法:
+ *     ./log_decode <firmware.elf> <binlog.bin>
+ *
+ * binlog.bin为 aiot_state_binlog_read 取出的数据按顺序拼接而成. 格式字符串按照记录中相对g_core_log_anchor的偏移,
+ * 从固件ELF文件的已分配节中读取, 因此必须使用与设备上运行的固件完全一致的ELF文件. 输出与文本模式下传给日志回调函数的
+ * 内容相同, 只是字符串参数最多保留CORE_LOG_BINLOG_STR_MAXLEN字节, hexdump最多保留CORE_LOG_BINLOG_HEXDUMP_MAXLEN字节
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "core_log.h"
+
+#define LOG_DECODE_SYMBOL       "g_core_log_anchor"
+
+typedef struct {
+    uint64_t addr;
+    uint64_t size;
+    uint64_t offset;
+} log_decode_section_t;
+
+typedef struct {
+    uint8_t *image;
+    uint32_t image_len;
+    log_decode_section_t *sections;
+    uint32_t sections_num;
+    uint64_t anchor_addr;
+} log_decode_elf_t;
+
+typedef void (*log_decode_output_t)(int32_t code, char *message, void *userdata);
+
+static uint64_t _log_decode_read(const uint8_t *ptr, uint32_t len)
+{
+    uint64_t value = 0;
+
+    while (len-- > 0) {
+        value = (value << 8) | ptr[len];
+    }
+    return value;
+}
+
+/* 只支持小端ELF32/ELF64, 字段偏移来自ELF规范 */
+static int32_t _log_decode_elf_parse(log_decode_elf_t *elf)
+{
+    const uint8_t *image = elf->image;
+    uint8_t is64 = 0;
+    uint64_t shoff = 0, symoff = 0, symsize = 0, strtab_off = 0, entsize = 0, idx = 0, sym = 0;
+    uint32_t shentsize = 0, shnum = 0, link = 0, name = 0;
+
+    if (elf->image_len < 52 || memcmp(image, "\x7f" "ELF", 4) != 0 || image[5] != 1) {
+        return -1;
+    }
+    is64 = (image[4] == 2) ? 1 : 0;
+    shoff = is64 ? _log_decode_read(&image[0x28], 8) : _log_decode_read(&image[0x20], 4);
+    shentsize = (uint32_t)_log_decode_read(&image[is64 ? 0x3A : 0x2E], 2);
+    shnum = (uint32_t)_log_decode_read(&image[is64 ? 0x3C : 0x30], 2);
+    if (shoff + (uint64_t)shentsize * shnum > elf->image_len) {
+        return -1;
+    }
+
+    elf->sections = calloc(shnum, sizeof(log_decode_section_t));
+    if (elf->sections == NULL) {
+        return -1;
+    }
+
+    for (idx = 0; idx < shnum; idx++) {
+        const uint8_t *sh = &image[shoff + idx * shentsize];
+        uint32_t type = (uint32_t)_log_decode_read(&sh[4], 4);
+        uint64_t flags = is64 ? _log_decode_read(&sh[8], 8) : _log_decode_read(&sh[8], 4);
+        log_decode_section_t *section = &elf->sections[elf->sections_num];
+
+        section->addr = is64 ? _log_decode_read(&sh[0x10], 8) : _log_decode_read(&sh[0x0C], 4);
+        section->offset = is64 ? _log_decode_read(&sh[0x18], 8) : _log_decode_read(&sh[0x10], 4);
+        section->size = is64 ? _log_decode_read(&sh[0x20], 8) : _log_decode_read(&sh[0x14], 4);
+
+        /* SHF_ALLOC且不是SHT_NOBITS的节才有格式字符串 */
+        if ((flags & 0x02) != 0 && type != 8 && section->offset + section->size <= elf->image_len) {
+            elf->sections_num++;
+        }
+
+        /* SHT_SYMTAB, 找不到时使用SHT_DYNSYM */
+        if (type == 2 || (type == 11 && symoff == 0)) {
+            link = (uint32_t)_log_decode_read(&sh[is64 ? 0x28 : 0x18], 4);
+            symoff = section->offset;
+            symsize = section->size;
+            entsize = is64 ? _log_decode_read(&sh[0x38], 8) : _log_decode_read(&sh[0x24], 4);
+            strtab_off = is64 ? _log_decode_read(&image[shoff + link * shentsize + 0x18], 8) :
+                         _log_decode_read(&image[shoff + link * shentsize + 0x10], 4);
+        }
+    }
+
+    for (sym = 0; entsize > 0 && sym + entsize <= symsize; sym += entsize) {
+        const uint8_t *entry = &image[symoff + sym];
+        name = (uint32_t)_log_decode_read(entry, 4);
+        if (strtab_off + name + sizeof(LOG_DECODE_SYMBOL) <= elf->image_len &&
+                strcmp((const char *)&image[strtab_off + name], LOG_DECODE_SYMBOL) == 0) {
+            elf->anchor_addr = is64 ? _log_decode_read(&entry[8], 8) : _log_decode_read(&entry[4], 4);
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+static const char *_log_decode_string(log_decode_elf_t *elf, uint64_t addr)
+{
+    uint32_t idx = 0;
+
+    for (idx = 0; idx < elf->sections_num; idx++) {
+        log_decode_section_t *section = &elf->sections[idx];
+        if (addr >= section->addr && addr < section->addr + section->size &&
+                memchr(&elf->image[section->offset + (addr - section->addr)], '\0', section->addr + section->size - addr) != NULL) {
+            return (const char *)&elf->image[section->offset + (addr - section->addr)];
+        }
+    }
+
+    return NULL;
+}
+
+static uint8_t *_log_decode_read_file(const char *path, uint32_t *len)
+{
+    FILE *fp = NULL;
+    long size = 0;
+    uint8_t *buffer = NULL;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    buffer = malloc(size > 0 ? size : 1);
+    if (buffer != NULL && fread(buffer, 1, size, fp) != (size_t)size) {
+        free(buffer);
+        buffer = NULL;
+    }
+    fclose(fp);
+    *len = (uint32_t)size;
+    return buffer;
+}
+
+/**
+ * @brief 加载固件ELF文件并找到g_core_log_anchor, 成功返回0
+ */
+int32_t log_decode_elf_load(const char *path, log_decode_elf_t *elf)
+{
+    memset(elf, 0, sizeof(log_decode_elf_t));
+    elf->image = _log_decode_read_file(path, &elf->image_len);
+    if (elf->image == NULL) {
+        return -1;
+    }
+    if (_log_decode_elf_parse(elf) < 0 || _log_decode_string(elf, elf->anchor_addr) == NULL ||
+            strcmp(_log_decode_string(elf, elf->anchor_addr), CORE_LOG_BINLOG_ANCHOR) != 0) {
+        free(elf->sections);
+        free(elf->image);
+        memset(elf, 0, sizeof(log_decode_elf_t));
+        return -1;
+    }
+    return 0;
+}
+
+void log_decode_elf_unload(log_decode_elf_t *elf)
+{
+    free(elf->sections);
+    free(elf->image);
+    memset(elf, 0, sizeof(log_decode_elf_t));
+}
+
+/* 与core_log.c中_core_log_append_prefix的输出一致 */
+static uint32_t _log_decode_prefix(uint32_t header, uint32_t timestamp, char *buffer)
+{
+    char timestamp_str[22] = {0};
+    uint32_t len = 0, timestamp_len = 0;
+
+    if (header & CORE_LOG_BINLOG_FLAG_TIMESTAMP) {
+        timestamp_len = sprintf(timestamp_str, "%u", timestamp);
+        if (timestamp_len > 3) {
+            memmove(&timestamp_str[timestamp_len - 2], &timestamp_str[timestamp_len - 3], 3);
+            timestamp_str[timestamp_len - 3] = '.';
+        }
+        len += sprintf(&buffer[len], "[%s]", timestamp_str);
+    }
+    if ((header & CORE_LOG_BINLOG_FLAG_TIMESTAMP) || (header & CORE_LOG_BINLOG_FLAG_HEXDUMP)) {
+        len += sprintf(&buffer[len], "[LK-%04X] ", header & 0xFFFF);
+    }
+    return len;
+}
+
+static void _log_decode_append(char *buffer, uint32_t *buffer_idx, const char *value, uint32_t len)
+{
+    if (*buffer_idx + len > CORE_LOG_MAXLEN) {
+        len = CORE_LOG_MAXLEN - *buffer_idx;
+    }
+    memcpy(&buffer[*buffer_idx], value, len);
+    *buffer_idx += len;
+}
+
+static void _log_decode_hexdump(uint32_t header, const uint8_t *record, uint32_t record_len, log_decode_output_t output,
+                                void *userdata)
+{
+    int32_t code = -(int32_t)(header & 0xFFFF);
+    char hexdump[25 + 72] = {0};
+    uint32_t idx = 0, line_idx = 0, ch_idx = 0, code_len = 0, len = 0;
+    const uint8_t *data = &record[CORE_LOG_BINLOG_HEADER_LEN + 4];
+    char prefix = (char)record[8];
+
+    len = (uint32_t)_log_decode_read(&record[CORE_LOG_BINLOG_HEADER_LEN], 4);
+    len = (len > record_len - CORE_LOG_BINLOG_HEADER_LEN - 4) ? (record_len - CORE_LOG_BINLOG_HEADER_LEN - 4) : len;
+
+    output(code, "\r\n", userdata);
+    code_len = _log_decode_prefix(header, 0, hexdump);
+    for (idx = 0; idx < len;) {
+        memset(hexdump + code_len, ' ', 71);
+        ch_idx = 2;
+        hexdump[code_len + 0] = prefix;
+        hexdump[code_len + 51] = '|';
+        for (line_idx = idx; ((line_idx - idx) < 16) && (line_idx < len); line_idx++) {
+            if ((line_idx - idx) == 8) {
+                ch_idx++;
+            }
+            hexdump[code_len + ch_idx] = "0123456789ABCDEF"[data[line_idx] >> 4];
+            hexdump[code_len + ch_idx + 1] = "0123456789ABCDEF"[data[line_idx] & 0x0F];
+            hexdump[code_len + ch_idx + 2] = ' ';
+            hexdump[code_len + 53 + (line_idx - idx)] = (data[line_idx] >= 0x20 && data[line_idx] <= 0x7E) ? data[line_idx] : '.';
+            ch_idx += 3;
+        }
+        hexdump[code_len + 69] = '\r';
+        hexdump[code_len + 70] = '\n';
+        idx = line_idx;
+        output(code, hexdump, userdata);
+    }
+    output(code, "\r\n", userdata);
+}
+
+/**
+ * @brief 解码一条记录, 还原出的文本通过output输出, 返回记录长度, 数据不完整或无法识别时返回-1
+ */
+int32_t log_decode_record(log_decode_elf_t *elf, const uint8_t *record, uint32_t len, log_decode_output_t output,
+                          void *userdata)
+{
+    char buffer[CORE_LOG_MAXLEN + 3] = {0};
+    uint32_t header = 0, record_len = 0, buffer_idx = 0, pos = CORE_LOG_BINLOG_HEADER_LEN, value = 0;
+    const char *fmt = NULL;
+    uint8_t arg_end = 0;
+
+    if (len < CORE_LOG_BINLOG_HEADER_LEN) {
+        return -1;
+    }
+    header = (uint32_t)_log_decode_read(record, 4);
+    record_len = (header >> 16) & 0x0FFF;
+    if ((header & CORE_LOG_BINLOG_FLAG_MAGIC) == 0 || record_len < CORE_LOG_BINLOG_HEADER_LEN || record_len > len) {
+        return -1;
+    }
+    if (header & CORE_LOG_BINLOG_FLAG_PADDING) {
+        return (int32_t)record_len;
+    }
+    if (header & CORE_LOG_BINLOG_FLAG_HEXDUMP) {
+        _log_decode_hexdump(header, record, record_len, output, userdata);
+        return (int32_t)record_len;
+    }
+
+    fmt = _log_decode_string(elf, elf->anchor_addr + (int64_t)(int32_t)_log_decode_read(&record[8], 4));
+    if (fmt == NULL) {
+        return -1;
+    }
+
+    buffer[CORE_LOG_MAXLEN] = '\r';
+    buffer[CORE_LOG_MAXLEN + 1] = '\n';
+    buffer_idx = _log_decode_prefix(header, (uint32_t)_log_decode_read(&record[4], 4), buffer);
+
+    while (*fmt != '\0' && buffer_idx < CORE_LOG_MAXLEN) {
+        uint32_t placeholder = 0;
+
+        if (fmt[0] == '%' && (fmt[1] == 's' || fmt[1] == 'd')) {
+            placeholder = 2;
+        } else if (memcmp(fmt, "%.*s", 4) == 0) {
+            placeholder = 4;
+        }
+        /* 参数用完(之后为0填充)或遇到CORE_LOG_BINLOG_ARG_NULL后, 与文本模式一样原样输出剩余的格式字符串 */
+        if (placeholder > 0 && (pos >= record_len || record[pos] == 0 || record[pos] == CORE_LOG_BINLOG_ARG_NULL)) {
+            arg_end = 1;
+        }
+        if (placeholder > 0 && arg_end == 0) {
+            if (record[pos] == CORE_LOG_BINLOG_ARG_UINT32 && pos + 5 <= record_len) {
+                char uint32_str[11] = {0};
+                value = (uint32_t)_log_decode_read(&record[pos + 1], 4);
+                _log_decode_append(buffer, &buffer_idx, uint32_str, sprintf(uint32_str, "%u", value));
+                pos += 5;
+            } else if (record[pos] == CORE_LOG_BINLOG_ARG_STRING && pos + 2 + record[pos + 1] <= record_len) {
+                _log_decode_append(buffer, &buffer_idx, (const char *)&record[pos + 2], record[pos + 1]);
+                pos += 2 + record[pos + 1];
+            } else {
+                return -1;
+            }
+            fmt += placeholder;
+            continue;
+        }
+        buffer[buffer_idx++] = *fmt++;
+    }
+
+    output(-(int32_t)(header & 0xFFFF), buffer, userdata);
+    return (int32_t)record_len;
+}
+
+#ifndef LOG_DECODE_NO_MAIN
+static void _log_decode_print(int32_t code, char *message, void *userdata)
+{
+    uint32_t len = (uint32_t)strlen(message);
+
+    printf("%s", message);
+    if (len == 0 || message[len - 1] != '\n') {
+        printf("\n");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    log_decode_elf_t elf;
+    uint8_t *binlog = NULL;
+    uint32_t binlog_len = 0, pos = 0;
+    int32_t res = 0;
+
+    if (argc != 3) {
+        printf("usage: %s <firmware.elf> <binlog.bin>\n", argv[0]);
+        return 1;
+    }
+
+    if (log_decode_elf_load(argv[1], &elf) < 0) {
+        printf("failed to find %s in %s\n", LOG_DECODE_SYMBOL, argv[1]);
+        return 1;
+    }
+    binlog = _log_decode_read_file(argv[2], &binlog_len);
+    if (binlog == NULL) {
+        printf("failed to read %s\n", argv[2]);
+        return 1;
+    }
+
+    while (pos < binlog_len) {
+        res = log_decode_record(&elf, &binlog[pos], binlog_len - pos, _log_decode_print, NULL);
+        if (res < 0) {
+            printf("invalid record at offset %u\n", pos);
+            break;
+        }
+        pos += res;
+    }
+
+    free(binlog);
+    log_decode_elf_unload(&elf);
+    return (res < 0) ? 1 : 0;
+}
+#endif
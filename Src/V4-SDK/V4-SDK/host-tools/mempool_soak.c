@@ -0,0 +1,327 @@
+/**
+ * @file mempool_soak.c
+ * @brief 在主机上模拟SDK长时间运行时的内存申请, 比较只用系统堆和先用core_mempool两种方式的碎片化程度和峰值用量
+ *
+ * 编译:
+ *     gcc -O2 -Icore -Icore/sysdep -Icore/utils -o mempool_soak \
+ *         host-tools/mempool_soak.c core/utils/core_mempool.c
+ *
+ * 用法:
+ *     ./mempool_soak [ticks] [reconnect_len]
+ *
+ * 系统堆按照FreeRTOS heap_4的方式模拟: 按地址排序的空闲链表, 首次适配, 释放时合并相邻空闲块, 每块8字节头部且8字节对齐,
+ * 大小为板子上的configTOTAL_HEAP_SIZE. 负载模拟topic拷贝, 回调节点, core_sprintf结果, HTTP头部等小块申请,
+ * 并周期性地模拟一次重连, 申请一块较大的收发缓冲区, 记录因碎片化导致重连失败的次数
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "core_mempool.h"
+
+#define MEMPOOL_SOAK_HEAP_LEN           (5120)
+#define MEMPOOL_SOAK_HEAP_HEADER_LEN    (8)
+#define MEMPOOL_SOAK_HEAP_MIN_BLOCK     (16)
+#define MEMPOOL_SOAK_MAX_LIVE           (256)
+#define MEMPOOL_SOAK_RECONNECT_TICKS    (200)
+#define MEMPOOL_SOAK_RECONNECT_LEN      (2048)
+#define MEMPOOL_SOAK_DEFAULT_TICKS      (1000000)
+
+/* heap_4的空闲块链表节点, 位于每块的头部 */
+typedef struct {
+    uint32_t next;
+    uint32_t size;
+} mempool_soak_block_t;
+
+typedef struct {
+    uint8_t buffer[MEMPOOL_SOAK_HEAP_LEN];
+    uint32_t free_head;
+    uint32_t used;
+    uint32_t peak;
+} mempool_soak_heap_t;
+
+typedef struct {
+    char *name;
+    uint16_t min_size;
+    uint16_t max_size;
+    uint32_t min_life;
+    uint32_t max_life;
+    uint32_t weight;
+} mempool_soak_profile_t;
+
+typedef struct {
+    void *ptr;
+    uint32_t expire;
+} mempool_soak_live_t;
+
+typedef struct {
+    const char *strategy;
+    uint32_t allocs;
+    uint32_t small_failed;
+    uint32_t reconnects;
+    uint32_t reconnect_failed;
+    uint32_t heap_peak;
+    double frag_worst;
+    double frag_sum;
+    uint32_t frag_samples;
+} mempool_soak_result_t;
+
+#define MEMPOOL_SOAK_NIL    (0xFFFFFFFF)
+
+static mempool_soak_heap_t g_mempool_soak_heap;
+static uint32_t g_mempool_soak_seed = 0x12345678;
+static uint8_t g_mempool_soak_use_pool = 0;
+static uint32_t g_mempool_soak_reconnect_len = MEMPOOL_SOAK_RECONNECT_LEN;
+
+static const mempool_soak_profile_t g_mempool_soak_profiles[] = {
+    {"MQTT", 20, 60, 1, 5, 30},             /* topic拷贝 */
+    {"MQTT", 16, 24, 500, 5000, 1},         /* 订阅的回调节点 */
+    {"MQTT", 40, 120, 1, 3, 20},            /* core_sprintf结果 */
+    {"HTTP", 16, 64, 1, 10, 10},            /* header键值对 */
+    {"AT", 16, 48, 1, 4, 20},               /* AT命令拼接 */
+    {"OTA", 32, 64, 5, 50, 3},              /* OTA任务描述 */
+};
+
+/* 连接建立后一直存在的大块内存: MQTT句柄和AT接收缓冲区 */
+static const struct {
+    char *name;
+    uint32_t size;
+} g_mempool_soak_resident[] = {
+    {"MQTT", 640},
+    {"AT", 1024},
+    {"AT", 256},
+};
+
+static uint32_t _mempool_soak_rand(void)
+{
+    g_mempool_soak_seed ^= g_mempool_soak_seed << 13;
+    g_mempool_soak_seed ^= g_mempool_soak_seed >> 17;
+    g_mempool_soak_seed ^= g_mempool_soak_seed << 5;
+    return g_mempool_soak_seed;
+}
+
+static uint32_t _mempool_soak_range(uint32_t min, uint32_t max)
+{
+    return min + _mempool_soak_rand() % (max - min + 1);
+}
+
+static mempool_soak_block_t *_mempool_soak_block(uint32_t offset)
+{
+    return (mempool_soak_block_t *)&g_mempool_soak_heap.buffer[offset];
+}
+
+static void _mempool_soak_heap_init(void)
+{
+    memset(&g_mempool_soak_heap, 0, sizeof(g_mempool_soak_heap));
+    g_mempool_soak_heap.free_head = 0;
+    _mempool_soak_block(0)->next = MEMPOOL_SOAK_NIL;
+    _mempool_soak_block(0)->size = MEMPOOL_SOAK_HEAP_LEN;
+}
+
+static void *_mempool_soak_heap_malloc(uint32_t size)
+{
+    uint32_t *link = &g_mempool_soak_heap.free_head, offset = 0;
+    mempool_soak_block_t *block = NULL;
+
+    size = (size + MEMPOOL_SOAK_HEAP_HEADER_LEN + 7) & ~7;
+    while (*link != MEMPOOL_SOAK_NIL) {
+        offset = *link;
+        block = _mempool_soak_block(offset);
+        if (block->size >= size) {
+            if (block->size - size >= MEMPOOL_SOAK_HEAP_MIN_BLOCK) {
+                mempool_soak_block_t *rest = _mempool_soak_block(offset + size);
+                rest->size = block->size - size;
+                rest->next = block->next;
+                block->size = size;
+                *link = offset + size;
+            } else {
+                *link = block->next;
+            }
+            g_mempool_soak_heap.used += block->size;
+            if (g_mempool_soak_heap.used > g_mempool_soak_heap.peak) {
+                g_mempool_soak_heap.peak = g_mempool_soak_heap.used;
+            }
+            return &g_mempool_soak_heap.buffer[offset + MEMPOOL_SOAK_HEAP_HEADER_LEN];
+        }
+        link = &block->next;
+    }
+
+    return NULL;
+}
+
+static void _mempool_soak_heap_free(void *ptr)
+{
+    uint32_t offset = (uint32_t)((uint8_t *)ptr - g_mempool_soak_heap.buffer) - MEMPOOL_SOAK_HEAP_HEADER_LEN;
+    uint32_t *link = &g_mempool_soak_heap.free_head, prev = MEMPOOL_SOAK_NIL;
+    mempool_soak_block_t *block = _mempool_soak_block(offset);
+
+    g_mempool_soak_heap.used -= block->size;
+    while (*link != MEMPOOL_SOAK_NIL && *link < offset) {
+        prev = *link;
+        link = &_mempool_soak_block(*link)->next;
+    }
+
+    /* 按地址插入, 并与后一块和前一块合并 */
+    block->next = *link;
+    *link = offset;
+    if (block->next != MEMPOOL_SOAK_NIL && offset + block->size == block->next) {
+        block->size += _mempool_soak_block(block->next)->size;
+        block->next = _mempool_soak_block(block->next)->next;
+    }
+    if (prev != MEMPOOL_SOAK_NIL && prev + _mempool_soak_block(prev)->size == offset) {
+        _mempool_soak_block(prev)->size += block->size;
+        _mempool_soak_block(prev)->next = block->next;
+    }
+}
+
+/* 1 - 最大空闲块/空闲总量, 0表示没有碎片 */
+static double _mempool_soak_heap_frag(void)
+{
+    uint32_t offset = g_mempool_soak_heap.free_head, total = 0, largest = 0;
+
+    while (offset != MEMPOOL_SOAK_NIL) {
+        total += _mempool_soak_block(offset)->size;
+        if (_mempool_soak_block(offset)->size > largest) {
+            largest = _mempool_soak_block(offset)->size;
+        }
+        offset = _mempool_soak_block(offset)->next;
+    }
+
+    return (total == 0) ? 0 : 1.0 - (double)largest / total;
+}
+
+/* 与freertos_tcp_modem_port.c中的core_sysdep_malloc/core_sysdep_free相同 */
+static void *_mempool_soak_malloc(uint32_t size, char *name)
+{
+    void *ptr = NULL;
+
+    if (g_mempool_soak_use_pool) {
+        ptr = core_mempool_malloc(size, name);
+    }
+    if (ptr == NULL) {
+        ptr = _mempool_soak_heap_malloc(size);
+    }
+    return ptr;
+}
+
+static void _mempool_soak_free(void *ptr)
+{
+    if (g_mempool_soak_use_pool == 0 || core_mempool_free(ptr) == 0) {
+        _mempool_soak_heap_free(ptr);
+    }
+}
+
+static const mempool_soak_profile_t *_mempool_soak_pick(void)
+{
+    uint32_t idx = 0, total = 0, pick = 0;
+
+    for (idx = 0; idx < sizeof(g_mempool_soak_profiles) / sizeof(mempool_soak_profile_t); idx++) {
+        total += g_mempool_soak_profiles[idx].weight;
+    }
+    pick = _mempool_soak_rand() % total;
+    for (idx = 0; pick >= g_mempool_soak_profiles[idx].weight; idx++) {
+        pick -= g_mempool_soak_profiles[idx].weight;
+    }
+    return &g_mempool_soak_profiles[idx];
+}
+
+static void _mempool_soak_run(const char *strategy, uint8_t use_pool, uint32_t ticks, mempool_soak_result_t *result)
+{
+    mempool_soak_live_t live[MEMPOOL_SOAK_MAX_LIVE];
+    void *resident[sizeof(g_mempool_soak_resident) / sizeof(g_mempool_soak_resident[0])];
+    uint32_t tick = 0, idx = 0, count = 0, live_num = 0;
+    double frag = 0;
+
+    memset(live, 0, sizeof(live));
+    memset(result, 0, sizeof(mempool_soak_result_t));
+    result->strategy = strategy;
+    g_mempool_soak_seed = 0x12345678;
+    g_mempool_soak_use_pool = use_pool;
+    _mempool_soak_heap_init();
+    for (idx = 0; idx < sizeof(g_mempool_soak_resident) / sizeof(g_mempool_soak_resident[0]); idx++) {
+        resident[idx] = _mempool_soak_malloc(g_mempool_soak_resident[idx].size, g_mempool_soak_resident[idx].name);
+    }
+
+    for (tick = 1; tick <= ticks; tick++) {
+        for (idx = 0; idx < live_num;) {
+            if (live[idx].expire <= tick) {
+                _mempool_soak_free(live[idx].ptr);
+                live[idx] = live[--live_num];
+            } else {
+                idx++;
+            }
+        }
+
+        for (count = _mempool_soak_range(0, 1); count > 0 && live_num < MEMPOOL_SOAK_MAX_LIVE; count--) {
+            const mempool_soak_profile_t *profile = _mempool_soak_pick();
+            void *ptr = _mempool_soak_malloc(_mempool_soak_range(profile->min_size, profile->max_size), profile->name);
+            result->allocs++;
+            if (ptr == NULL) {
+                result->small_failed++;
+                continue;
+            }
+            live[live_num].ptr = ptr;
+            live[live_num].expire = tick + _mempool_soak_range(profile->min_life, profile->max_life);
+            live_num++;
+        }
+
+        if (tick % MEMPOOL_SOAK_RECONNECT_TICKS == 0) {
+            void *ptr = _mempool_soak_malloc(g_mempool_soak_reconnect_len, "MQTT");
+            result->reconnects++;
+            if (ptr == NULL) {
+                result->reconnect_failed++;
+            } else {
+                _mempool_soak_free(ptr);
+            }
+            frag = _mempool_soak_heap_frag();
+            result->frag_sum += frag;
+            result->frag_samples++;
+            if (frag > result->frag_worst) {
+                result->frag_worst = frag;
+            }
+        }
+    }
+
+    for (idx = 0; idx < live_num; idx++) {
+        _mempool_soak_free(live[idx].ptr);
+    }
+    for (idx = 0; idx < sizeof(g_mempool_soak_resident) / sizeof(g_mempool_soak_resident[0]); idx++) {
+        _mempool_soak_free(resident[idx]);
+    }
+    result->heap_peak = g_mempool_soak_heap.peak;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t ticks = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : MEMPOOL_SOAK_DEFAULT_TICKS;
+    mempool_soak_result_t results[2];
+    aiot_sysdep_mempool_stats_t stats;
+    uint32_t idx = 0;
+
+    if (argc > 2) {
+        g_mempool_soak_reconnect_len = (uint32_t)strtoul(argv[2], NULL, 10);
+    }
+    _mempool_soak_run("heap", 0, ticks, &results[0]);
+    _mempool_soak_run("pool+heap", 1, ticks, &results[1]);
+
+    printf("\n    %u ticks, %u bytes heap, reconnect buffer %u bytes every %u ticks\n\n", ticks, MEMPOOL_SOAK_HEAP_LEN,
+           g_mempool_soak_reconnect_len, MEMPOOL_SOAK_RECONNECT_TICKS);
+    for (idx = 0; idx < 2; idx++) {
+        printf("    | %-9s | heap peak %5u bytes | frag avg %5.1f%% worst %5.1f%% | reconnect failed %6u/%u | small failed %u/%u |\n",
+               results[idx].strategy, results[idx].heap_peak,
+               100.0 * results[idx].frag_sum / (results[idx].frag_samples ? results[idx].frag_samples : 1),
+               100.0 * results[idx].frag_worst, results[idx].reconnect_failed, results[idx].reconnects,
+               results[idx].small_failed, results[idx].allocs);
+    }
+
+    printf("\n    | pool | block size | blocks | high water | fallback |\n");
+    for (idx = 0; core_mempool_get_stats(idx, &stats) == STATE_SUCCESS; idx++) {
+        printf("    | %-4s | %10u | %6u | %10u | %8u |\n", stats.name, stats.block_size, stats.block_num,
+               stats.high_water, stats.fallback_count);
+    }
+    printf("\n");
+
+    return 0;
+}
@@ -0,0 +1,189 @@
+/**
+ * @file ota_delta_gen.c
+ * @brief 在主机上生成OTA差分包, 差分包格式见components/ota/ota_delta.h
+ *
+ * 命令行工具见ota_delta_gen_main.c, 单元测试通过ota_delta_gen.h直接调用 ota_delta_gen
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "core_sha256.h"
+#include "ota_delta.h"
+#include "ota_delta_gen.h"
+
+#define OTA_DELTA_GEN_BLOCK_LEN         (16)
+#define OTA_DELTA_GEN_HASH_BITS         (18)
+#define OTA_DELTA_GEN_MIN_MATCH         (12)
+
+typedef struct {
+    uint8_t *buffer;
+    uint32_t len;
+    uint32_t size;
+} ota_delta_gen_buffer_t;
+
+static int32_t _ota_delta_gen_append(ota_delta_gen_buffer_t *out, const uint8_t *data, uint32_t len)
+{
+    if (out->len + len > out->size) {
+        uint32_t size = (out->size == 0) ? 4096 : out->size;
+        uint8_t *buffer = NULL;
+        while (size < out->len + len) {
+            size *= 2;
+        }
+        buffer = realloc(out->buffer, size);
+        if (buffer == NULL) {
+            return -1;
+        }
+        out->buffer = buffer;
+        out->size = size;
+    }
+    memcpy(&out->buffer[out->len], data, len);
+    out->len += len;
+    return 0;
+}
+
+static int32_t _ota_delta_gen_append_uint32(ota_delta_gen_buffer_t *out, uint32_t value)
+{
+    uint8_t bytes[4] = {(uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+    return _ota_delta_gen_append(out, bytes, sizeof(bytes));
+}
+
+static uint32_t _ota_delta_gen_hash(const uint8_t *data)
+{
+    uint32_t idx = 0, hash = 2166136261u;
+
+    for (idx = 0; idx < OTA_DELTA_GEN_BLOCK_LEN; idx++) {
+        hash = (hash ^ data[idx]) * 16777619u;
+    }
+    return hash >> (32 - OTA_DELTA_GEN_HASH_BITS);
+}
+
+static uint32_t _ota_delta_gen_match_len(const uint8_t *old_image, uint32_t old_len, uint32_t old_offset,
+        const uint8_t *new_image, uint32_t new_len, uint32_t new_offset)
+{
+    uint32_t len = 0;
+
+    while (old_offset + len < old_len && new_offset + len < new_len &&
+            old_image[old_offset + len] == new_image[new_offset + len]) {
+        len++;
+    }
+    return len;
+}
+
+static int32_t _ota_delta_gen_insert(ota_delta_gen_buffer_t *out, const uint8_t *data, uint32_t len)
+{
+    uint8_t op = OTA_DELTA_OP_INSERT;
+
+    if (len == 0) {
+        return 0;
+    }
+    if (_ota_delta_gen_append(out, &op, 1) < 0 || _ota_delta_gen_append_uint32(out, len) < 0) {
+        return -1;
+    }
+    return _ota_delta_gen_append(out, data, len);
+}
+
+static int32_t _ota_delta_gen_copy(ota_delta_gen_buffer_t *out, uint32_t old_offset, uint32_t len)
+{
+    uint8_t op = OTA_DELTA_OP_COPY;
+
+    if (_ota_delta_gen_append(out, &op, 1) < 0 || _ota_delta_gen_append_uint32(out, old_offset) < 0) {
+        return -1;
+    }
+    return _ota_delta_gen_append_uint32(out, len);
+}
+
+/*
+ * 对旧固件中每个位置的16字节建立哈希索引, 在新固件中依次查找最长匹配. 同时尝试沿上一次拷贝的位置继续匹配,
+ * 这样原地修改了少量字节(例如重新链接后变化的地址)只需要一个很短的插入
+ */
+int32_t ota_delta_gen(const uint8_t *old_image, uint32_t old_len, const uint8_t *new_image, uint32_t new_len,
+                      uint8_t **patch, uint32_t *patch_len)
+{
+    int32_t res = 0;
+    int32_t *table = NULL;
+    uint32_t idx = 0, new_idx = 0, insert_start = 0;
+    uint32_t last_old_end = 0, last_new_end = 0;
+    uint8_t header[OTA_DELTA_HEADER_LEN] = {0};
+    ota_delta_gen_buffer_t out = {0};
+
+    table = malloc(sizeof(int32_t) << OTA_DELTA_GEN_HASH_BITS);
+    if (table == NULL) {
+        return -1;
+    }
+    memset(table, 0xFF, sizeof(int32_t) << OTA_DELTA_GEN_HASH_BITS);
+    for (idx = 0; idx + OTA_DELTA_GEN_BLOCK_LEN <= old_len; idx++) {
+        uint32_t hash = _ota_delta_gen_hash(&old_image[idx]);
+        if (table[hash] < 0) {
+            table[hash] = (int32_t)idx;
+        }
+    }
+
+    memcpy(header, OTA_DELTA_MAGIC, strlen(OTA_DELTA_MAGIC));
+    header[4] = OTA_DELTA_VERSION;
+    header[8] = (uint8_t)old_len;
+    header[9] = (uint8_t)(old_len >> 8);
+    header[10] = (uint8_t)(old_len >> 16);
+    header[11] = (uint8_t)(old_len >> 24);
+    header[12] = (uint8_t)new_len;
+    header[13] = (uint8_t)(new_len >> 8);
+    header[14] = (uint8_t)(new_len >> 16);
+    header[15] = (uint8_t)(new_len >> 24);
+    core_sha256(new_image, new_len, &header[16]);
+    res = _ota_delta_gen_append(&out, header, sizeof(header));
+
+    while (res == 0 && new_idx < new_len) {
+        uint32_t best_len = 0, best_offset = 0, len = 0, candidate = 0;
+
+        /* 沿着上一次拷贝的位置继续 */
+        candidate = last_old_end + (new_idx - last_new_end);
+        if (candidate < old_len) {
+            best_len = _ota_delta_gen_match_len(old_image, old_len, candidate, new_image, new_len, new_idx);
+            best_offset = candidate;
+        }
+        if (new_idx + OTA_DELTA_GEN_BLOCK_LEN <= new_len) {
+            int32_t offset = table[_ota_delta_gen_hash(&new_image[new_idx])];
+            if (offset >= 0 && (uint32_t)offset != candidate) {
+                len = _ota_delta_gen_match_len(old_image, old_len, offset, new_image, new_len, new_idx);
+                if (len > best_len) {
+                    best_len = len;
+                    best_offset = offset;
+                }
+            }
+        }
+
+        if (best_len < OTA_DELTA_GEN_MIN_MATCH) {
+            new_idx++;
+            continue;
+        }
+
+        /* 向前扩展匹配, 缩短待插入的数据 */
+        while (new_idx > insert_start && best_offset > 0 && old_image[best_offset - 1] == new_image[new_idx - 1]) {
+            best_offset--;
+            new_idx--;
+            best_len++;
+        }
+
+        res = _ota_delta_gen_insert(&out, &new_image[insert_start], new_idx - insert_start);
+        if (res == 0) {
+            res = _ota_delta_gen_copy(&out, best_offset, best_len);
+        }
+        new_idx += best_len;
+        insert_start = new_idx;
+        last_old_end = best_offset + best_len;
+        last_new_end = new_idx;
+    }
+    if (res == 0) {
+        res = _ota_delta_gen_insert(&out, &new_image[insert_start], new_len - insert_start);
+    }
+
+    free(table);
+    if (res < 0) {
+        free(out.buffer);
+        return res;
+    }
+    *patch = out.buffer;
+    *patch_len = out.len;
+    return 0;
+}
@@ -0,0 +1,36 @@
+/**
+ * @file ota_delta_gen.h
+ * @brief 主机端OTA差分包生成接口, 供ota_delta_gen命令行工具和OTA单元测试使用
+ */
+
+#ifndef _OTA_DELTA_GEN_H_
+#define _OTA_DELTA_GEN_H_
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @brief 生成从old_image到new_image的差分包
+ *
+ * @param[in] old_image 旧固件
+ * @param[in] old_len 旧固件长度
+ * @param[in] new_image 新固件
+ * @param[in] new_len 新固件长度
+ * @param[out] patch 差分包, 由调用者free
+ * @param[out] patch_len 差分包长度
+ *
+ * @return int32_t
+ * @retval 0 成功
+ * @retval <0 内存不足
+ */
+int32_t ota_delta_gen(const uint8_t *old_image, uint32_t old_len, const uint8_t *new_image, uint32_t new_len,
+                      uint8_t **patch, uint32_t *patch_len);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
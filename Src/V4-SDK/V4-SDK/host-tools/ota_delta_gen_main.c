@@ -0,0 +1,81 @@
+/**
+ * @file ota_delta_gen_main.c
+ * @brief ota_delta_gen命令行工具
+ *
+ * 编译:
+ *     make ota-delta-gen
+ *
+ * 用法:
+ *     ./output/ota_delta_gen <old.bin> <new.bin> <patch.bin>
+ *
+ * 将生成的patch.bin作为差分包上传到云端, 设备端通过 AIOT_DLOPT_DELTA_READ_HANDLER 读取当前运行的固件,
+ * 边下载边还原出new.bin
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "ota_delta_gen.h"
+
+static uint8_t *_ota_delta_gen_read_file(const char *path, uint32_t *len)
+{
+    FILE *fp = NULL;
+    long size = 0;
+    uint8_t *buffer = NULL;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    buffer = malloc(size > 0 ? size : 1);
+    if (buffer != NULL && fread(buffer, 1, size, fp) != (size_t)size) {
+        free(buffer);
+        buffer = NULL;
+    }
+    fclose(fp);
+    *len = (uint32_t)size;
+    return buffer;
+}
+
+int main(int argc, char *argv[])
+{
+    uint8_t *old_image = NULL, *new_image = NULL, *patch = NULL;
+    uint32_t old_len = 0, new_len = 0, patch_len = 0;
+    FILE *fp = NULL;
+
+    if (argc != 4) {
+        printf("usage: %s <old.bin> <new.bin> <patch.bin>\n", argv[0]);
+        return 1;
+    }
+
+    old_image = _ota_delta_gen_read_file(argv[1], &old_len);
+    new_image = _ota_delta_gen_read_file(argv[2], &new_len);
+    if (old_image == NULL || new_image == NULL) {
+        printf("failed to read input files\n");
+        return 1;
+    }
+
+    if (ota_delta_gen(old_image, old_len, new_image, new_len, &patch, &patch_len) < 0) {
+        printf("failed to generate patch\n");
+        return 1;
+    }
+
+    fp = fopen(argv[3], "wb");
+    if (fp == NULL || fwrite(patch, 1, patch_len, fp) != patch_len) {
+        printf("failed to write %s\n", argv[3]);
+        return 1;
+    }
+    fclose(fp);
+
+    printf("old: %u bytes, new: %u bytes, patch: %u bytes (%.1f%% of new)\n", old_len, new_len, patch_len,
+           new_len ? (100.0 * patch_len / new_len) : 0.0);
+
+    free(old_image);
+    free(new_image);
+    free(patch);
+    return 0;
+}
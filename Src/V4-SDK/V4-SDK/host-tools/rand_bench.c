@@ -0,0 +1,147 @@
+/**
+ * @file rand_bench.c
+ * @brief 在主机上比较对接层随机数的几种来源在各请求长度下的单次耗时和吞吐量
+ *
+ * 编译:
+ *     gcc -O2 -Icore -Icore/sysdep -Icore/utils -Iexternal/mbedtls/include -o rand_bench \
+ *         host-tools/rand_bench.c portfiles/aiot_port/aiot_port.c external/mbedtls/library/\*.c -lpthread
+ *
+ * 用法:
+ *     ./rand_bench [count]
+ *
+ *     rand     之前的core_sysdep_rand, 每次调用用时间重新srand后取rand()
+ *     entropy  每次请求都直接向熵源(getrandom)取数, 即不经过DRBG的做法
+ *     drbg     现在的core_sysdep_rand, 熵池 + CTR-DRBG, TLS的随机数也由它提供
+ *
+ * 每格为单次调用的最短耗时(微秒)和对应的吞吐量; 最后输出drbg第一次调用(同步播种)的耗时, 之后单次调用的最长耗时,
+ * 以及期间重新播种和推迟重新播种的次数
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/syscall.h>
+
+#include "aiot_state_api.h"
+#include "aiot_sysdep_api.h"
+
+#define RAND_BENCH_DEFAULT_COUNT    (2000)
+
+extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
+extern void core_sysdep_rand_get_stats(uint32_t *reseeds, uint32_t *reseed_deferred);
+
+typedef void (*rand_bench_func_t)(uint8_t *output, uint32_t output_len);
+
+static const uint32_t g_rand_bench_sizes[] = {4, 16, 32, 48, 256, 1024};
+
+static double _rand_bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* 修改之前的core_sysdep_rand */
+static void _rand_bench_rand(uint8_t *output, uint32_t output_len)
+{
+    uint32_t idx = 0, bytes = 0, rand_num = 0;
+    struct timeval time;
+
+    memset(&time, 0, sizeof(struct timeval));
+    gettimeofday(&time, NULL);
+
+    srand((unsigned int)(time.tv_sec * 1000 + time.tv_usec / 1000) + rand());
+
+    for (idx = 0; idx < output_len;) {
+        if (output_len - idx < 4) {
+            bytes = output_len - idx;
+        } else {
+            bytes = 4;
+        }
+        rand_num = rand();
+        while (bytes-- > 0) {
+            output[idx++] = (uint8_t)(rand_num >> bytes * 8);
+        }
+    }
+}
+
+static void _rand_bench_entropy(uint8_t *output, uint32_t output_len)
+{
+    uint32_t pos = 0;
+    long res = 0;
+
+    while (pos < output_len) {
+        res = syscall(SYS_getrandom, output + pos, output_len - pos, 0);
+        if (res <= 0) {
+            break;
+        }
+        pos += (uint32_t)res;
+    }
+}
+
+static void _rand_bench_drbg(uint8_t *output, uint32_t output_len)
+{
+    g_aiot_sysdep_portfile.core_sysdep_rand(output, output_len);
+}
+
+static double _rand_bench_run(const char *name, rand_bench_func_t func, uint32_t count)
+{
+    static uint8_t output[1024];
+    uint32_t idx = 0, size_idx = 0;
+    double start = 0, elapsed = 0, best = 0, worst = 0;
+
+    printf("    | %-8s |", name);
+    for (size_idx = 0; size_idx < sizeof(g_rand_bench_sizes) / sizeof(g_rand_bench_sizes[0]); size_idx++) {
+        for (idx = 0; idx < count; idx++) {
+            start = _rand_bench_now();
+            func(output, g_rand_bench_sizes[size_idx]);
+            elapsed = _rand_bench_now() - start;
+            if (idx == 0 || elapsed < best) {
+                best = elapsed;
+            }
+            worst = (elapsed > worst) ? elapsed : worst;
+        }
+        printf(" %6.2f us %7.1f MB/s |", 1e6 * best, g_rand_bench_sizes[size_idx] / best / 1e6);
+    }
+    printf("\n");
+
+    return worst;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t count = RAND_BENCH_DEFAULT_COUNT, idx = 0, reseeds = 0, deferred = 0;
+    double start = 0, seed_us = 0, worst = 0;
+    uint8_t output[32];
+
+    if (argc > 1) {
+        count = (uint32_t)atoi(argv[1]);
+    }
+    if (count == 0) {
+        count = 1;
+    }
+
+    start = _rand_bench_now();
+    _rand_bench_drbg(output, sizeof(output));
+    seed_us = 1e6 * (_rand_bench_now() - start);
+
+    printf("\n    |  source  |");
+    for (idx = 0; idx < sizeof(g_rand_bench_sizes) / sizeof(g_rand_bench_sizes[0]); idx++) {
+        printf("       %4u B            |", g_rand_bench_sizes[idx]);
+    }
+    printf("\n");
+    _rand_bench_run("rand", _rand_bench_rand, count);
+    _rand_bench_run("entropy", _rand_bench_entropy, count);
+    worst = _rand_bench_run("drbg", _rand_bench_drbg, count);
+
+    core_sysdep_rand_get_stats(&reseeds, &deferred);
+    printf("\n    drbg seed: %.1f us, slowest call after seeding: %.1f us, reseeds: %u, deferred: %u\n\n",
+           seed_us, 1e6 * worst, reseeds, deferred);
+
+    return 0;
+}
@@ -0,0 +1,262 @@
+/**
+ * @file rsa_bench.c
+ * @brief 在主机上校验并测量当前编译选择的MULADDC内核和模幂窗口大小下的RSA-2048验签/签名, 由rsa_bench.sh对每一种组合分别编译运行
+ *
+ * 编译:
+ *     gcc -O2 [-DMBEDTLS_HAVE_ASM] [-DMBEDTLS_MPI_WINDOW_SIZE=n] -Ihost-tools -Iexternal/mbedtls/include -o rsa_bench \
+ *         host-tools/rsa_bench.c external/mbedtls/library/\*.c
+ *
+ * 用法:
+ *     ./rsa_bench <label> [count]
+ *
+ * 先用rsa_vectors.h中的已知答案校验大数乘法、模幂以及签名/验签, 失败返回1; 然后输出单次验签和签名的最短耗时,
+ * 以及签名过程中mbedtls堆的峰值(通过mbedtls_platform_set_calloc_free统计)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "mbedtls/bignum.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/rsa.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/platform.h"
+#include "rsa_vectors.h"
+
+#define RSA_BENCH_DEFAULT_COUNT     (50)
+#define RSA_BENCH_VERIFY_REPEAT     (20)
+
+typedef struct {
+    size_t size;
+    size_t align;
+} rsa_bench_block_t;
+
+static size_t g_rsa_bench_heap_used = 0;
+static size_t g_rsa_bench_heap_peak = 0;
+
+static void *_rsa_bench_calloc(size_t nmemb, size_t size)
+{
+    rsa_bench_block_t *block = NULL;
+
+    if (nmemb != 0 && size > ((size_t) -1 - sizeof(rsa_bench_block_t)) / nmemb) {
+        return NULL;
+    }
+    block = calloc(1, sizeof(rsa_bench_block_t) + nmemb * size);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->size = nmemb * size;
+    g_rsa_bench_heap_used += block->size;
+    if (g_rsa_bench_heap_used > g_rsa_bench_heap_peak) {
+        g_rsa_bench_heap_peak = g_rsa_bench_heap_used;
+    }
+
+    return block + 1;
+}
+
+static void _rsa_bench_free(void *ptr)
+{
+    rsa_bench_block_t *block = NULL;
+
+    if (ptr == NULL) {
+        return;
+    }
+    block = (rsa_bench_block_t *)ptr - 1;
+    g_rsa_bench_heap_used -= block->size;
+    free(block);
+}
+
+/* 只用于私钥运算的盲化, 不需要密码学强度 */
+static int _rsa_bench_rng(void *p_rng, unsigned char *output, size_t len)
+{
+    uint32_t *state = (uint32_t *)p_rng;
+
+    while (len--) {
+        *state ^= *state << 13;
+        *state ^= *state >> 17;
+        *state ^= *state << 5;
+        *output++ = (unsigned char)*state;
+    }
+
+    return 0;
+}
+
+static double _rsa_bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* 主机上的其它负载和降频只会让单次耗时变长, 取最小值比平均值稳定 */
+static double _rsa_bench_min(const double *samples, uint32_t count)
+{
+    double min = samples[0];
+    uint32_t idx = 0;
+
+    for (idx = 1; idx < count; idx++) {
+        min = (samples[idx] < min) ? samples[idx] : min;
+    }
+
+    return min;
+}
+
+static int32_t _rsa_bench_check_mpi(void)
+{
+    mbedtls_mpi a, b, n, x, expect;
+    uint32_t idx = 0;
+    int32_t res = 0;
+
+    mbedtls_mpi_init(&a);
+    mbedtls_mpi_init(&b);
+    mbedtls_mpi_init(&n);
+    mbedtls_mpi_init(&x);
+    mbedtls_mpi_init(&expect);
+
+    for (idx = 0; res == 0 && idx < sizeof(rsa_mul_vectors) / sizeof(rsa_mul_vectors[0]); idx++) {
+        const rsa_mul_vector_t *vector = &rsa_mul_vectors[idx];
+
+        if (mbedtls_mpi_read_string(&a, 16, vector->a) != 0 || mbedtls_mpi_read_string(&b, 16, vector->b) != 0 ||
+            mbedtls_mpi_read_string(&expect, 16, vector->x) != 0 || mbedtls_mpi_mul_mpi(&x, &a, &b) != 0 ||
+            mbedtls_mpi_cmp_mpi(&x, &expect) != 0) {
+            printf("mul vector %u failed\n", idx);
+            res = -1;
+        }
+    }
+
+    for (idx = 0; res == 0 && idx < sizeof(rsa_exp_mod_vectors) / sizeof(rsa_exp_mod_vectors[0]); idx++) {
+        const rsa_exp_mod_vector_t *vector = &rsa_exp_mod_vectors[idx];
+
+        if (mbedtls_mpi_read_string(&a, 16, vector->a) != 0 || mbedtls_mpi_read_string(&b, 16, vector->e) != 0 ||
+            mbedtls_mpi_read_string(&n, 16, vector->n) != 0 || mbedtls_mpi_read_string(&expect, 16, vector->x) != 0 ||
+            mbedtls_mpi_exp_mod(&x, &a, &b, &n, NULL) != 0 || mbedtls_mpi_cmp_mpi(&x, &expect) != 0) {
+            printf("exp_mod vector %u failed\n", idx);
+            res = -1;
+        }
+    }
+
+    mbedtls_mpi_free(&a);
+    mbedtls_mpi_free(&b);
+    mbedtls_mpi_free(&n);
+    mbedtls_mpi_free(&x);
+    mbedtls_mpi_free(&expect);
+
+    return res;
+}
+
+static int32_t _rsa_bench_check_signature(mbedtls_rsa_context *rsa, const unsigned char *hash, uint32_t *rng_state)
+{
+    unsigned char sig[MBEDTLS_MPI_MAX_SIZE], expect[MBEDTLS_MPI_MAX_SIZE];
+    mbedtls_mpi sig_mpi;
+    int32_t res = 0;
+
+    mbedtls_mpi_init(&sig_mpi);
+    if (mbedtls_mpi_read_string(&sig_mpi, 16, rsa_vectors_signature) != 0 ||
+        mbedtls_mpi_write_binary(&sig_mpi, expect, rsa->len) != 0) {
+        res = -1;
+    }
+    mbedtls_mpi_free(&sig_mpi);
+    if (res < 0) {
+        printf("signature vector invalid\n");
+        return res;
+    }
+
+    if (mbedtls_rsa_pkcs1_sign(rsa, _rsa_bench_rng, rng_state, MBEDTLS_RSA_PRIVATE, MBEDTLS_MD_SHA256, 32, hash,
+                               sig) != 0 || memcmp(sig, expect, rsa->len) != 0) {
+        printf("sign mismatch\n");
+        return -1;
+    }
+    if (mbedtls_rsa_pkcs1_verify(rsa, NULL, NULL, MBEDTLS_RSA_PUBLIC, MBEDTLS_MD_SHA256, 32, hash, expect) != 0) {
+        printf("verify failed\n");
+        return -1;
+    }
+    expect[rsa->len / 2] ^= 0x01;
+    if (mbedtls_rsa_pkcs1_verify(rsa, NULL, NULL, MBEDTLS_RSA_PUBLIC, MBEDTLS_MD_SHA256, 32, hash, expect) == 0) {
+        printf("corrupted signature accepted\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    mbedtls_pk_context pk;
+    mbedtls_rsa_context *rsa = NULL;
+    unsigned char hash[32], sig[MBEDTLS_MPI_MAX_SIZE];
+    uint32_t count = RSA_BENCH_DEFAULT_COUNT, idx = 0, repeat = 0, rng_state = 0x2545F491;
+    double start = 0, *verify_ms = NULL, *sign_ms = NULL;
+    size_t sign_peak = 0;
+    int32_t res = 0;
+
+    if (argc < 2) {
+        printf("usage: %s <label> [count]\n", argv[0]);
+        return 1;
+    }
+    if (argc > 2) {
+        count = (uint32_t)atoi(argv[2]);
+    }
+    if (count == 0) {
+        count = 1;
+    }
+
+    mbedtls_platform_set_calloc_free(_rsa_bench_calloc, _rsa_bench_free);
+
+    mbedtls_pk_init(&pk);
+    if (mbedtls_pk_parse_key(&pk, (const unsigned char *)rsa_vectors_key_pem, sizeof(rsa_vectors_key_pem), NULL,
+                             0) != 0 || mbedtls_pk_get_type(&pk) != MBEDTLS_PK_RSA) {
+        printf("key parse failed\n");
+        return 1;
+    }
+    rsa = mbedtls_pk_rsa(pk);
+    mbedtls_sha256((const unsigned char *)rsa_vectors_message, strlen(rsa_vectors_message), hash, 0);
+
+    if (_rsa_bench_check_mpi() < 0 || _rsa_bench_check_signature(rsa, hash, &rng_state) < 0) {
+        mbedtls_pk_free(&pk);
+        return 1;
+    }
+
+    verify_ms = calloc(count, sizeof(double));
+    sign_ms = calloc(count, sizeof(double));
+    if (verify_ms == NULL || sign_ms == NULL) {
+        return 1;
+    }
+
+    for (idx = 0; idx < count; idx++) {
+        size_t base = g_rsa_bench_heap_used;
+
+        g_rsa_bench_heap_peak = base;
+        start = _rsa_bench_now();
+        res |= mbedtls_rsa_pkcs1_sign(rsa, _rsa_bench_rng, &rng_state, MBEDTLS_RSA_PRIVATE, MBEDTLS_MD_SHA256, 32,
+                                      hash, sig);
+        sign_ms[idx] = 1000.0 * (_rsa_bench_now() - start);
+        if (g_rsa_bench_heap_peak - base > sign_peak) {
+            sign_peak = g_rsa_bench_heap_peak - base;
+        }
+
+        /* 验签只有17位的公钥指数, 单次太快, 重复多次取平均 */
+        start = _rsa_bench_now();
+        for (repeat = 0; repeat < RSA_BENCH_VERIFY_REPEAT; repeat++) {
+            res |= mbedtls_rsa_pkcs1_verify(rsa, NULL, NULL, MBEDTLS_RSA_PUBLIC, MBEDTLS_MD_SHA256, 32, hash, sig);
+        }
+        verify_ms[idx] = 1000.0 * (_rsa_bench_now() - start) / RSA_BENCH_VERIFY_REPEAT;
+    }
+
+    mbedtls_pk_free(&pk);
+    if (res != 0) {
+        printf("sign/verify failed\n");
+        return 1;
+    }
+
+    printf("    | %-12s | %8.3f ms | %8.3f ms | %6u bytes |\n", argv[1], _rsa_bench_min(verify_ms, count),
+           _rsa_bench_min(sign_ms, count), (unsigned int)sign_peak);
+
+    free(verify_ms);
+    free(sign_ms);
+
+    return 0;
+}
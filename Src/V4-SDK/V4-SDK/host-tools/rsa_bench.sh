@@ -0,0 +1,53 @@
+#!/bin/bash
+#
+# 分别以通用C和MBEDTLS_HAVE_ASM的MULADDC内核, 以及不同的MBEDTLS_MPI_WINDOW_SIZE编译rsa_bench,
+# 校验已知答案后输出bignum.o的代码大小、RSA-2048验签/签名耗时和签名时的堆峰值, 用法:
+#
+#     bash host-tools/rsa_bench.sh <output_dir> [count]
+#
+# 代码大小使用AIOT_CC以-Os编译得到, 交叉编译时即为目标平台上的大小; 速度和堆峰值总是在主机上测量
+
+if [ "${1}" = "" ];then
+    exit 1
+fi
+
+OBJDIR=${1}/rsa_bench
+COUNT=${2:-50}
+HOST_CC=gcc
+TARGET_CC=${AIOT_CC:-gcc}
+TARGET_SIZE=${TARGET_CC%gcc}size
+INC="-Ihost-tools -Iexternal/mbedtls/include"
+
+mkdir -p ${OBJDIR}
+
+text_size() {
+    ${TARGET_SIZE} ${1} | sed '1d' | awk '{ print $1 }'
+}
+
+bench() {
+    local name=${1} flags=${2}
+    local obj=${OBJDIR}/bignum_${name}.o
+    local size="" line=""
+
+    ${TARGET_CC} -Os -c ${INC} ${flags} -o ${obj} external/mbedtls/library/bignum.c || return 1
+    size=$(text_size ${obj})
+
+    ${HOST_CC} -O2 ${INC} ${flags} -o ${OBJDIR}/rsa_bench_${name} \
+        host-tools/rsa_bench.c external/mbedtls/library/*.c || return 1
+    line=$(${OBJDIR}/rsa_bench_${name} ${name} ${COUNT}) || { echo "${line}"; return 1; }
+    echo "${line} ${size} bytes |"
+}
+
+RES=0
+echo ""
+echo "    |    kernel    |   verify    |    sign     | sign heap    | bignum.o    |"
+bench generic "" || RES=1
+bench asm "-DMBEDTLS_HAVE_ASM" || RES=1
+echo ""
+echo "    |    window    |   verify    |    sign     | sign heap    | bignum.o    |"
+for WINDOW in 1 2 3 4 5 6; do
+    bench window_${WINDOW} "-DMBEDTLS_HAVE_ASM -DMBEDTLS_MPI_WINDOW_SIZE=${WINDOW}" || RES=1
+done
+echo ""
+
+exit ${RES}
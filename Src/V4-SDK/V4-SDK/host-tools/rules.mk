@@ -1,6 +1,6 @@
 Q := @
 
-.PHONY: prepare all clean test sanity
+.PHONY: prepare all clean test sanity digest-bench sprintf-bench json-bench log-decode mempool-soak tls-resume-bench tls-profile-bench tls-ecc-bench rsa-bench ecc-kat ota-delta-gen tls-cred-bench tls-record-bench rand-bench tls-handshake-bench at-tls-bench tls-arena-bench
 
 all: prepare $(OUT_DIR)/$(LIB_SDK_TARGET)
 
@@ -38,6 +38,69 @@ $(OUT_DIR)/%.o: %.c
 stat:
 	$(Q)bash host-tools/rom_stat.sh . $(OUT_DIR)
 
+digest-bench: prepare
+	$(Q)AIOT_CC=$(AIOT_CC) bash host-tools/digest_bench.sh $(OUT_DIR)
+
+sprintf-bench: prepare
+	$(Q)gcc -O2 -Icore -Icore/sysdep -Icore/utils -o $(OUT_DIR)/sprintf_bench \
+	    host-tools/sprintf_bench.c core/utils/core_string.c
+	$(Q)$(OUT_DIR)/sprintf_bench
+
+json-bench: prepare
+	$(Q)gcc -O2 -Icore -Icore/sysdep -Icore/utils -o $(OUT_DIR)/json_bench \
+	    host-tools/json_bench.c core/utils/core_string.c
+	$(Q)$(OUT_DIR)/json_bench
+
+log-decode: prepare
+	$(Q)gcc -O2 -Icore -Icore/sysdep -Icore/utils -o $(OUT_DIR)/log_decode host-tools/log_decode.c
+
+mempool-soak: prepare
+	$(Q)gcc -O2 -Icore -Icore/sysdep -Icore/utils -o $(OUT_DIR)/mempool_soak \
+	    host-tools/mempool_soak.c core/utils/core_mempool.c
+	$(Q)$(OUT_DIR)/mempool_soak
+
+tls-resume-bench: prepare
+	$(Q)bash host-tools/tls_resume_bench.sh $(OUT_DIR) $(RTT_MS)
+
+tls-profile-bench: prepare
+	$(Q)bash host-tools/tls_profile_bench.sh $(OUT_DIR)
+
+tls-ecc-bench: prepare
+	$(Q)bash host-tools/tls_ecc_bench.sh $(OUT_DIR)
+
+rsa-bench: prepare
+	$(Q)AIOT_CC=$(AIOT_CC) bash host-tools/rsa_bench.sh $(OUT_DIR)
+
+ecc-kat: prepare
+	$(Q)bash host-tools/ecc_kat.sh $(OUT_DIR)
+
+ota-delta-gen: prepare
+	$(Q)mkdir -p $(OUT_DIR)/host-tools
+	$(Q)gcc -O2 -Icore -Icore/sysdep -Icore/utils -Icomponents/ota -Ihost-tools -o $(OUT_DIR)/host-tools/ota_delta_gen.o \
+	    -c host-tools/ota_delta_gen.c
+	$(Q)gcc -O2 -Icore -Icore/sysdep -Icore/utils -Icomponents/ota -Ihost-tools -o $(OUT_DIR)/ota_delta_gen \
+	    host-tools/ota_delta_gen_main.c $(OUT_DIR)/host-tools/ota_delta_gen.o core/utils/core_sha256.c
+
+tls-cred-bench: prepare
+	$(Q)bash host-tools/tls_cred_bench.sh $(OUT_DIR)
+
+tls-record-bench: prepare
+	$(Q)AIOT_CC=$(AIOT_CC) bash host-tools/tls_record_bench.sh $(OUT_DIR)
+
+rand-bench: prepare
+	$(Q)gcc -O2 -Icore -Icore/sysdep -Icore/utils -Iexternal/mbedtls/include -o $(OUT_DIR)/rand_bench \
+	    host-tools/rand_bench.c portfiles/aiot_port/aiot_port.c external/mbedtls/library/*.c -lpthread
+	$(Q)$(OUT_DIR)/rand_bench
+
+tls-handshake-bench: prepare
+	$(Q)bash host-tools/tls_handshake_bench.sh $(OUT_DIR) $(RTT_MS)
+
+at-tls-bench: prepare
+	$(Q)bash host-tools/at_tls_bench.sh $(OUT_DIR) $(RTT_MS)
+
+tls-arena-bench: prepare
+	$(Q)bash host-tools/tls_arena_bench.sh $(OUT_DIR) $(ARENA_LEN)
+
 sanity:
 	@echo -e "\nBelow file(s) contain 'return -1' !\n"|grep --color ".*"
 	@grep -l 'return *-[0-9]' $(LIB_SRC_FILES) $(EXT_SRC_FILES) | grep -v 'external/mbedtls' | awk '{ print "    . "$$0 }'
@@ -9,6 +9,8 @@ int main(int argc, char *argv[])
     ADD_SUITE(COMPONENT_COTA);
     ADD_SUITE(COMPONENT_FOTA);
     ADD_SUITE(PORTFILES_AT);
+    ADD_SUITE(PORTFILES_RAND);
+    ADD_SUITE(PORTFILES_ESTABLISH);
 
     cut_main(argc, argv);
 
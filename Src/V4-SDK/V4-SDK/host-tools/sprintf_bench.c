@@ -0,0 +1,197 @@
+/**
+ * @file sprintf_bench.c
+ * @brief 在主机上比较core_sprintf的几种用法的格式化速度和堆调用次数
+ *
+ * 编译:
+ *     gcc -O2 -Icore -Icore/sysdep -Icore/utils -o sprintf_bench \
+ *         host-tools/sprintf_bench.c core/utils/core_string.c
+ *
+ * 用法:
+ *     ./sprintf_bench
+ *
+ * legacy为改写前的实现: 每输出一个字符都要对fmt和结果做一次strlen, 并在每次调用时查询两次FreeRTOS的堆余量,
+ * 余量不为0时各osDelay(1)一次. 主机上不会真的休眠, 只统计设备上会发生的调度器休眠次数
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "core_string.h"
+
+#define SPRINTF_BENCH_ITERATIONS    (200000)
+#define SPRINTF_BENCH_PAYLOAD_LEN   (200)
+
+static uint32_t g_sprintf_bench_heap_calls;
+static uint32_t g_sprintf_bench_sleeps;
+
+static void *_sprintf_bench_malloc(uint32_t size, char *name)
+{
+    g_sprintf_bench_heap_calls++;
+    return malloc(size);
+}
+
+static void _sprintf_bench_free(void *ptr)
+{
+    g_sprintf_bench_heap_calls++;
+    free(ptr);
+}
+
+static aiot_sysdep_portfile_t g_sprintf_bench_sysdep = {
+    .core_sysdep_malloc = _sprintf_bench_malloc,
+    .core_sysdep_free = _sprintf_bench_free,
+};
+
+/* 改写前的core_sprintf, 只把xPortGetFreeHeapSize和osDelay换成计数 */
+static int32_t _sprintf_bench_legacy(aiot_sysdep_portfile_t *sysdep, char **dest, char *fmt, char *src[], uint8_t count,
+                                     char *module_name)
+{
+    char *buffer = NULL, *value = NULL;
+    uint32_t idx = 0, buffer_len = 0;
+    uint8_t percent_idx = 0;
+
+    buffer_len += strlen(fmt) - 2 * count;
+    for (percent_idx = 0; percent_idx < count; percent_idx++) {
+        value = (*(src + percent_idx) == NULL) ? ("") : (*(src + percent_idx));
+        buffer_len += strlen(value);
+    }
+
+    g_sprintf_bench_sleeps += 2;
+
+    buffer = sysdep->core_sysdep_malloc(buffer_len + 1, module_name);
+    if (buffer == NULL) {
+        return STATE_SYS_DEPEND_MALLOC_FAILED;
+    }
+    memset(buffer, 0, buffer_len + 1);
+
+    for (idx = 0, percent_idx = 0; idx < strlen(fmt);) {
+        if (fmt[idx] == '%' && fmt[idx + 1] == 's') {
+            value = (*(src + percent_idx) == NULL) ? ("") : (*(src + percent_idx));
+            memcpy(buffer + strlen(buffer), value, strlen(value));
+            percent_idx++;
+            idx += 2;
+        } else {
+            buffer[strlen(buffer)] = fmt[idx++];
+        }
+    }
+    *dest = buffer;
+    return STATE_SUCCESS;
+}
+
+typedef struct {
+    const char *name;
+    char *fmt;
+    char **src;
+    uint8_t count;
+} sprintf_bench_case_t;
+
+typedef enum {
+    SPRINTF_BENCH_LEGACY,
+    SPRINTF_BENCH_HEAP,
+    SPRINTF_BENCH_ARENA,
+    SPRINTF_BENCH_BUFFER,
+} sprintf_bench_mode_t;
+
+static const char *g_sprintf_bench_mode_name[] = {"legacy", "heap", "arena", "buffer"};
+
+static double _sprintf_bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int32_t _sprintf_bench_run(sprintf_bench_case_t *bench_case, sprintf_bench_mode_t mode, const char *expect)
+{
+    uint32_t idx = 0, out_len = (uint32_t)strlen(expect);
+    char buffer[1024], *dest = NULL;
+    double elapsed = 0;
+    int32_t res = 0;
+
+    g_sprintf_bench_heap_calls = 0;
+    g_sprintf_bench_sleeps = 0;
+    elapsed = _sprintf_bench_now();
+    for (idx = 0; idx < SPRINTF_BENCH_ITERATIONS; idx++) {
+        switch (mode) {
+            case SPRINTF_BENCH_LEGACY: {
+                res = _sprintf_bench_legacy(&g_sprintf_bench_sysdep, &dest, bench_case->fmt, bench_case->src,
+                                            bench_case->count, "bench");
+            }
+            break;
+            case SPRINTF_BENCH_HEAP: {
+                res = core_sprintf(&g_sprintf_bench_sysdep, &dest, bench_case->fmt, bench_case->src, bench_case->count,
+                                   "bench");
+            }
+            break;
+            case SPRINTF_BENCH_ARENA: {
+                CORE_STR_ARENA(arena, 512);
+                res = core_arena_sprintf(&g_sprintf_bench_sysdep, &arena, &dest, bench_case->fmt, bench_case->src,
+                                         bench_case->count, "bench");
+                if (res == STATE_SUCCESS && strcmp(dest, expect) != 0) {
+                    res = -1;
+                }
+                core_arena_free(&g_sprintf_bench_sysdep, &arena, dest);
+                dest = NULL;
+            }
+            break;
+            case SPRINTF_BENCH_BUFFER: {
+                res = core_snprintf(buffer, sizeof(buffer), bench_case->fmt, bench_case->src, bench_case->count);
+                res = (res == (int32_t)out_len) ? STATE_SUCCESS : -1;
+                dest = buffer;
+            }
+            break;
+        }
+        if (res != STATE_SUCCESS || (dest != NULL && strcmp(dest, expect) != 0)) {
+            printf("%s/%s: output mismatch\n", bench_case->name, g_sprintf_bench_mode_name[mode]);
+            return -1;
+        }
+        if (mode == SPRINTF_BENCH_LEGACY || mode == SPRINTF_BENCH_HEAP) {
+            g_sprintf_bench_sysdep.core_sysdep_free(dest);
+        }
+        dest = NULL;
+    }
+    elapsed = _sprintf_bench_now() - elapsed;
+
+    printf("    | %-12s | %-6s | %9.1f ns/op | %8.1f MB/s | %4.1f heap calls/op | %4.1f sleeps/op |\n",
+           bench_case->name, g_sprintf_bench_mode_name[mode], elapsed * 1e9 / SPRINTF_BENCH_ITERATIONS,
+           (double)out_len * SPRINTF_BENCH_ITERATIONS / elapsed / 1e6,
+           (double)g_sprintf_bench_heap_calls / SPRINTF_BENCH_ITERATIONS,
+           (double)g_sprintf_bench_sleeps / SPRINTF_BENCH_ITERATIONS);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    char payload[SPRINTF_BENCH_PAYLOAD_LEN + 1];
+    char *auth_src[] = {"a1Bcd2EfGhI", "device_name_0001", "device_name_0001", "a1Bcd2EfGhI", "2524608000000"};
+    char *http_src[] = {"POST", "/topic/a1Bcd2EfGhI/device_name_0001/user/update", "iot-as-http.cn-shanghai.aliyuncs.com",
+                        "Content-Type: application/octet-stream\r\nPassword: 0123456789abcdef0123456789abcdef\r\n", "256"
+                       };
+    char *pub_src[] = {"at+mqttpub=0,0,\"", "/a1Bcd2EfGhI/device_name_0001/user/update", "\",\"", payload, "\"\r\n"};
+    sprintf_bench_case_t cases[] = {
+        {"auth", "clientId%s.%sdeviceName%sproductKey%stimestamp%s", auth_src, 5},
+        {"http header", "%s %s HTTP/1.1\r\nHost: %s\r\n%sContent-Length: %s\r\n\r\n", http_src, 5},
+        {"at pub", "%s%s%s%s%s", pub_src, 5},
+    };
+    uint32_t idx = 0, mode = 0;
+    char expect[1024];
+
+    memset(payload, 'x', SPRINTF_BENCH_PAYLOAD_LEN);
+    payload[SPRINTF_BENCH_PAYLOAD_LEN] = '\0';
+
+    printf("\n");
+    for (idx = 0; idx < sizeof(cases) / sizeof(cases[0]); idx++) {
+        core_snprintf(expect, sizeof(expect), cases[idx].fmt, cases[idx].src, cases[idx].count);
+        for (mode = SPRINTF_BENCH_LEGACY; mode <= SPRINTF_BENCH_BUFFER; mode++) {
+            if (_sprintf_bench_run(&cases[idx], (sprintf_bench_mode_t)mode, expect) < 0) {
+                return 1;
+            }
+        }
+    }
+    printf("\n");
+
+    return 0;
+}
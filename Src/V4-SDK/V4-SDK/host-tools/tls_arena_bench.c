@@ -0,0 +1,223 @@
+/**
+ * @file tls_arena_bench.c
+ * @brief 在主机上经模拟的TCP模组运行freertos_tcp_modem对接层的完整TLS握手, 按阶段输出TLS内存区的用量,
+ *        由tls_arena_bench.sh启动本地测试服务器后运行
+ *
+ * 编译:
+ *     gcc -O2 -DCORE_SYSDEP_MBEDTLS_ENABLED -DAT_TLS_ARENA_LEN=<字节数> -Ihost-tools/freertos_shim -Icore -Icore/sysdep \
+ *         -Icore/utils -Ihost-tools -Iportfiles/freertos_tcp_modem -Iexternal/mbedtls/include -o tls_arena_bench \
+ *         host-tools/tls_arena_bench.c host-tools/at_modem_emu.c host-tools/freertos_shim/freertos_shim.c \
+ *         portfiles/freertos_tcp_modem/\*.c core/aiot_state_api.c core/sysdep/core_sysdep.c core/utils/\*.c \
+ *         external/mbedtls/library/\*.c -lpthread
+ *
+ *     AT_TLS_ARENA_LEN没有默认值, 用不同的长度编译可以验证某个内存区长度是否够用
+ *
+ * 用法:
+ *     ./tls_arena_bench <rsa|mutual|psk> <server_port> <server_cert.pem|psk> [client_cert.pem client_key.pem]
+ *
+ * 每种方式连续建立TLS_ARENA_BENCH_ROUNDS次连接, 每次握手后上行TLS_ARENA_BENCH_UPLOAD_LEN字节再断开, 输出
+ *     cert parse    解析证书、私钥和PSK期间内存区用量的峰值和申请次数
+ *     key exchange  从申请记录缓冲区到握手结束期间的峰值和申请次数
+ *     steady        握手结束后收发数据期间的峰值, 即连接常驻的用量
+ *     largest free  握手结束时最大的空闲块, 与内存区剩余长度的差距反映碎片化程度
+ * 断开后内存区没有全部归还时返回1; 内存区不够用时输出失败前是否已经向模组发出数据, 返回2
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "aiot_state_api.h"
+#include "aiot_sysdep_api.h"
+#include "core_tls_arena.h"
+#include "at_modem_emu.h"
+
+#define TLS_ARENA_BENCH_ROUNDS          (3)
+#define TLS_ARENA_BENCH_UPLOAD_LEN      (4 * 1024)
+#define TLS_ARENA_BENCH_WRITE_LEN       (1200)
+#define TLS_ARENA_BENCH_TIMEOUT_MS      (10000)
+
+extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
+extern void core_sysdep_tls_arena_get_stats(core_tls_arena_stats_t *stats);
+
+/* 对接层要求板级代码提供的熵源 */
+int32_t core_sysdep_entropy_poll(uint8_t *output, uint32_t output_len)
+{
+    return (syscall(SYS_getrandom, output, output_len, 0) == output_len) ? 0 : -1;
+}
+
+static double _tls_arena_bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char *_tls_arena_bench_read(const char *path, uint32_t *len)
+{
+    static char buffer[3][8192];
+    static uint32_t used = 0;
+    char *data = NULL;
+    FILE *fp = NULL;
+
+    fp = fopen(path, "r");
+    if (fp == NULL || used >= sizeof(buffer) / sizeof(buffer[0])) {
+        perror(path);
+        return NULL;
+    }
+    data = buffer[used++];
+    *len = fread(data, 1, sizeof(buffer[0]) - 1, fp);
+    data[*len] = '\0';
+    fclose(fp);
+
+    return data;
+}
+
+static int32_t _tls_arena_bench_upload(void *network)
+{
+    static uint8_t payload[TLS_ARENA_BENCH_UPLOAD_LEN];
+    uint32_t pos = 0, len = 0;
+    int32_t res = 0;
+
+    memset(payload, 'a', sizeof(payload));
+    while (pos < sizeof(payload)) {
+        len = (sizeof(payload) - pos < TLS_ARENA_BENCH_WRITE_LEN) ? sizeof(payload) - pos : TLS_ARENA_BENCH_WRITE_LEN;
+        res = g_aiot_sysdep_portfile.core_sysdep_network_send(network, &payload[pos], len, TLS_ARENA_BENCH_TIMEOUT_MS,
+                NULL);
+        if (res <= 0) {
+            printf("upload failed, res: -0x%04X\n", -res);
+            return (res < 0) ? res : -1;
+        }
+        pos += res;
+    }
+
+    return STATE_SUCCESS;
+}
+
+/* 建立一次连接, 返回0表示成功, 1表示断开后有内存没有归还, 2表示内存区不够, 其它失败返回-1 */
+static int32_t _tls_arena_bench_round(const char *mode, uint32_t round, aiot_sysdep_network_cred_t *cred,
+                                      core_sysdep_psk_t *psk, uint16_t port, at_modem_emu_t *emu)
+{
+    aiot_sysdep_portfile_t *sysdep = &g_aiot_sysdep_portfile;
+    core_sysdep_socket_type_t socket_type = CORE_SYSDEP_SOCKET_TCP_CLIENT;
+    core_tls_arena_stats_t established, stats;
+    uint32_t timeout_ms = TLS_ARENA_BENCH_TIMEOUT_MS;
+    void *network = NULL;
+    double start = 0, wall = 0;
+    int32_t res = 0;
+
+    network = sysdep->core_sysdep_network_init();
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_SOCKET_TYPE, &socket_type);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_HOST, "127.0.0.1");
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_PORT, &port);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_CONNECT_TIMEOUT_MS, &timeout_ms);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_CRED, cred);
+    if (psk != NULL) {
+        sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_PSK, psk);
+    }
+
+    at_modem_emu_reset(emu);
+    start = _tls_arena_bench_now();
+    res = sysdep->core_sysdep_network_establish(network);
+    wall = _tls_arena_bench_now() - start;
+    core_sysdep_tls_arena_get_stats(&established);
+    if (res == STATE_PORT_TLS_ARENA_EXHAUSTED) {
+        printf("    | %-6s | arena exhausted after %.1f ms, %s, %u bytes requested, peak %u of %u bytes\n", mode,
+               1000 * wall, (emu->send_cmds == 0) ? "nothing sent to the modem" : "during the handshake",
+               established.failed_len, established.peak, established.size);
+        sysdep->core_sysdep_network_deinit(&network);
+        return 2;
+    }
+    if (res < STATE_SUCCESS) {
+        printf("%s handshake failed, res: -0x%04X\n", mode, -res);
+        sysdep->core_sysdep_network_deinit(&network);
+        return -1;
+    }
+
+    res = _tls_arena_bench_upload(network);
+    sysdep->core_sysdep_network_deinit(&network);
+    if (res < STATE_SUCCESS) {
+        return -1;
+    }
+    core_sysdep_tls_arena_get_stats(&stats);
+
+    printf("    | %-6s | %5u | %7u B %5u | %7u B %5u | %7u B | %7u B | %7u B / %5u |\n", mode, round,
+           stats.phase[CORE_TLS_ARENA_PHASE_CERT_PARSE].peak, stats.phase[CORE_TLS_ARENA_PHASE_CERT_PARSE].allocs,
+           stats.phase[CORE_TLS_ARENA_PHASE_KEY_EXCHANGE].peak, stats.phase[CORE_TLS_ARENA_PHASE_KEY_EXCHANGE].allocs,
+           stats.phase[CORE_TLS_ARENA_PHASE_STEADY].peak, established.size - established.used,
+           established.largest_free, established.blocks);
+
+    if (stats.used != 0 || stats.blocks != 0) {
+        printf("%u bytes in %u blocks not returned after disconnect\n", stats.used, stats.blocks);
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    aiot_sysdep_network_cred_t cred;
+    core_sysdep_psk_t psk;
+    core_tls_arena_stats_t stats;
+    at_modem_emu_t emu;
+    uint32_t round = 0, len = 0;
+    int32_t res = 0;
+
+    if (argc < 4 || (strcmp(argv[1], "mutual") == 0 && argc < 6)) {
+        printf("usage: %s <rsa|mutual|psk> <server_port> <server_cert.pem|psk> [client_cert.pem client_key.pem]\n",
+               argv[0]);
+        return 1;
+    }
+
+    memset(&cred, 0, sizeof(cred));
+    cred.max_tls_fragment = 16384;
+    if (strcmp(argv[1], "psk") == 0) {
+        cred.option = AIOT_SYSDEP_NETWORK_CRED_SVRCERT_PSK;
+        psk.psk_id = "tls_arena_bench";
+        psk.psk = argv[3];
+    } else {
+        cred.option = AIOT_SYSDEP_NETWORK_CRED_SVRCERT_RSA;
+        cred.x509_server_cert = _tls_arena_bench_read(argv[3], &len);
+        cred.x509_server_cert_len = len;
+        if (strcmp(argv[1], "mutual") == 0) {
+            cred.x509_client_cert = _tls_arena_bench_read(argv[4], &len);
+            cred.x509_client_cert_len = len;
+            cred.x509_client_privkey = _tls_arena_bench_read(argv[5], &len);
+            cred.x509_client_privkey_len = len;
+        }
+        if (cred.x509_server_cert == NULL || (strcmp(argv[1], "mutual") == 0 &&
+                                              (cred.x509_client_cert == NULL || cred.x509_client_privkey == NULL))) {
+            return 1;
+        }
+    }
+
+    aiot_sysdep_set_portfile(&g_aiot_sysdep_portfile);
+
+    /* 只关心内存, 模组按很高的波特率且不计指令处理时间 */
+    memset(&emu, 0, sizeof(emu));
+    emu.baudrate = 100000000;
+    emu.cmd_ms = 0;
+    if (at_modem_emu_start(&emu) < 0) {
+        return 1;
+    }
+
+    for (round = 1; round <= TLS_ARENA_BENCH_ROUNDS; round++) {
+        res = _tls_arena_bench_round(argv[1], round, &cred, (cred.option == AIOT_SYSDEP_NETWORK_CRED_SVRCERT_PSK) ?
+                                     &psk : NULL, (uint16_t)atoi(argv[2]), &emu);
+        if (res != 0) {
+            return (res < 0) ? 1 : res;
+        }
+    }
+
+    core_sysdep_tls_arena_get_stats(&stats);
+    printf("    | %-6s | arena %u B, peak %u B, headroom %u B, failed allocations %u\n", argv[1], stats.size,
+           stats.peak, stats.size - stats.peak, stats.alloc_failed);
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+#!/bin/bash
+#
+# 用openssl s_server在本地起TLS1.2测试服务器, 经模拟的TCP模组运行freertos_tcp_modem对接层的完整握手,
+# 按阶段输出TLS内存区的峰值, 并验证内存区不够时建立连接尽早以STATE_PORT_TLS_ARENA_EXHAUSTED失败, 用法:
+#
+#     bash host-tools/tls_arena_bench.sh <output_dir> [arena_len]
+#
+# arena_len为编译时的AT_TLS_ARENA_LEN, 不指定时使用主机上不会耗尽的长度(记录缓冲区加24KB). rsa为RSA 2048自签名证书的服务器, mutual另外要求
+# 客户端证书, psk为PSK-AES128-CBC-SHA的服务器; 对接层把PSK字符串本身作为密钥, 所以传给openssl的是它的十六进制
+
+if [ "${1}" = "" ];then
+    exit 1
+fi
+
+OBJDIR=${1}/tls_arena_bench
+RSA_PORT=${TLS_ARENA_BENCH_PORT:-18451}
+MUTUAL_PORT=$((RSA_PORT + 1))
+PSK_PORT=$((RSA_PORT + 2))
+PSK=00112233445566778899aabbccddeeff
+INC="-Ihost-tools/freertos_shim -Icore -Icore/sysdep -Icore/utils -Ihost-tools -Iportfiles/freertos_tcp_modem \
+    -Iexternal/mbedtls/include"
+SRC="host-tools/tls_arena_bench.c host-tools/at_modem_emu.c host-tools/freertos_shim/freertos_shim.c \
+    portfiles/freertos_tcp_modem/*.c core/aiot_state_api.c core/sysdep/core_sysdep.c core/utils/*.c \
+    external/mbedtls/library/*.c"
+ARENA_FLAGS="-DAT_TLS_ARENA_LEN=(MBEDTLS_SSL_IN_CONTENT_LEN+MBEDTLS_SSL_OUT_CONTENT_LEN+24*1024)"
+if [ "${2}" != "" ];then
+    ARENA_FLAGS="-DAT_TLS_ARENA_LEN=${2}"
+fi
+
+mkdir -p ${OBJDIR}
+
+openssl req -x509 -newkey rsa:2048 -nodes -keyout ${OBJDIR}/key.pem -out ${OBJDIR}/cert.pem -days 1 \
+    -subj "/CN=localhost" > /dev/null 2>&1 || exit 1
+openssl req -x509 -newkey rsa:2048 -nodes -keyout ${OBJDIR}/client_key.pem -out ${OBJDIR}/client_cert.pem -days 1 \
+    -subj "/CN=tls_arena_bench" > /dev/null 2>&1 || exit 1
+gcc -O2 -DCORE_SYSDEP_MBEDTLS_ENABLED ${ARENA_FLAGS} ${INC} -o ${OBJDIR}/tls_arena_bench ${SRC} -lpthread || exit 1
+# 只放得下记录缓冲区, 用于验证内存区不够时的失败方式
+gcc -O2 -DCORE_SYSDEP_MBEDTLS_ENABLED -DAT_TLS_ARENA_LEN="(MBEDTLS_SSL_IN_CONTENT_LEN + MBEDTLS_SSL_OUT_CONTENT_LEN)" \
+    ${INC} -o ${OBJDIR}/tls_arena_bench_small ${SRC} -lpthread || exit 1
+
+CIPHERS='AES128-SHA256:AES256-SHA256:AES128-SHA:AES256-SHA'
+sleep 3600 | openssl s_server -accept 127.0.0.1:${RSA_PORT} -tls1_2 -cipher ${CIPHERS} \
+    -cert ${OBJDIR}/cert.pem -key ${OBJDIR}/key.pem -quiet > /dev/null 2>&1 &
+RSA_SERVER=$!
+sleep 3600 | openssl s_server -accept 127.0.0.1:${MUTUAL_PORT} -tls1_2 -cipher ${CIPHERS} \
+    -cert ${OBJDIR}/cert.pem -key ${OBJDIR}/key.pem -Verify 1 -CAfile ${OBJDIR}/client_cert.pem -quiet > /dev/null 2>&1 &
+MUTUAL_SERVER=$!
+sleep 3600 | openssl s_server -accept 127.0.0.1:${PSK_PORT} -tls1_2 -nocert -cipher 'PSK-AES128-CBC-SHA' \
+    -psk $(printf ${PSK} | xxd -p -c 100) -psk_identity tls_arena_bench -quiet > /dev/null 2>&1 &
+PSK_SERVER=$!
+sleep 1
+
+RES=0
+echo ""
+echo "    | mode   | round |  cert parse   allocs | key exchange allocs |  steady   | free      | largest free / blocks |"
+for MODE in rsa mutual psk; do
+    if [ "${MODE}" = "rsa" ]; then
+        ARGS="rsa ${RSA_PORT} ${OBJDIR}/cert.pem"
+    elif [ "${MODE}" = "mutual" ]; then
+        ARGS="mutual ${MUTUAL_PORT} ${OBJDIR}/cert.pem ${OBJDIR}/client_cert.pem ${OBJDIR}/client_key.pem"
+    else
+        ARGS="psk ${PSK_PORT} ${PSK}"
+    fi
+    ${OBJDIR}/tls_arena_bench ${ARGS} | grep '^    |\|failed\|not returned'
+    [ ${PIPESTATUS[0]} -eq 0 ] || RES=1
+done
+
+echo ""
+echo "    arena holding only the record buffers:"
+for MODE in rsa psk; do
+    if [ "${MODE}" = "rsa" ]; then
+        ARGS="rsa ${RSA_PORT} ${OBJDIR}/cert.pem"
+    else
+        ARGS="psk ${PSK_PORT} ${PSK}"
+    fi
+    ${OBJDIR}/tls_arena_bench_small ${ARGS} | grep '^    |\|failed\|not returned'
+    [ ${PIPESTATUS[0]} -eq 2 ] || RES=1
+done
+echo ""
+
+kill ${RSA_SERVER} ${MUTUAL_SERVER} ${PSK_SERVER} $(jobs -p) > /dev/null 2>&1
+exit ${RES}
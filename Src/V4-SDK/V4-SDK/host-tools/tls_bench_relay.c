@@ -0,0 +1,197 @@
+/**
+ * @file tls_bench_relay.c
+ * @brief TLS主机基准测试共用的本地TCP中继
+ *
+ * 在每次换向时延迟rtt_ms/2, 相当于把同一方向上连续发出的一组握手消息(一个flight)当作一次单程时延.
+ * 这样会掩盖发送端在一个flight内部的停顿, 发送端本身较慢(如经uart发给模组)时设置per_packet, 每个数据块各自延迟
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "tls_bench_relay.h"
+
+#define TLS_BENCH_RELAY_QUEUE_LEN   (64)
+
+typedef struct {
+    uint64_t due_us;
+    ssize_t len;
+    uint8_t data[4096];
+} tls_bench_relay_chunk_t;
+
+typedef struct {
+    tls_bench_relay_chunk_t chunk[TLS_BENCH_RELAY_QUEUE_LEN];
+    uint32_t head;
+    uint32_t tail;
+} tls_bench_relay_queue_t;
+
+static uint64_t _tls_bench_relay_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* 每个方向一个延迟队列, 数据块在收到rtt_ms/2之后转发, 队列满时暂停读取该方向. 一端关闭后把已收到的数据转发完再返回 */
+static void _tls_bench_relay_per_packet(tls_bench_relay_t *relay, int client_fd, int server_fd)
+{
+    static tls_bench_relay_queue_t queue[2];
+    tls_bench_relay_chunk_t *chunk = NULL;
+    struct pollfd fds[2];
+    uint64_t now_us = 0;
+    int idx = 0, direction = -1, timeout_ms = 0, closed = 0, one = 1;
+
+    memset(queue, 0, sizeof(queue));
+    fds[0].fd = client_fd;
+    fds[1].fd = server_fd;
+    while (closed == 0 || queue[0].head != queue[0].tail || queue[1].head != queue[1].tail) {
+        now_us = _tls_bench_relay_now_us();
+        timeout_ms = -1;
+        for (idx = 0; idx < 2; idx++) {
+            while (queue[idx].head != queue[idx].tail) {
+                chunk = &queue[idx].chunk[queue[idx].head % TLS_BENCH_RELAY_QUEUE_LEN];
+                if (chunk->due_us > now_us) {
+                    if (timeout_ms < 0 || (chunk->due_us - now_us + 999) / 1000 < timeout_ms) {
+                        timeout_ms = (chunk->due_us - now_us + 999) / 1000;
+                    }
+                    break;
+                }
+                send(fds[1 - idx].fd, chunk->data, chunk->len, MSG_NOSIGNAL);
+                queue[idx].head++;
+            }
+            fds[idx].events = (closed == 0 && queue[idx].tail - queue[idx].head < TLS_BENCH_RELAY_QUEUE_LEN) ? POLLIN : 0;
+        }
+        if (closed != 0) {
+            if (timeout_ms > 0) {
+                usleep(timeout_ms * 1000);
+            }
+            continue;
+        }
+        if (poll(fds, 2, timeout_ms) < 0) {
+            break;
+        }
+
+        for (idx = 0; idx < 2; idx++) {
+            if ((fds[idx].revents & (POLLIN | POLLHUP | POLLERR)) == 0) {
+                continue;
+            }
+            chunk = &queue[idx].chunk[queue[idx].tail % TLS_BENCH_RELAY_QUEUE_LEN];
+            chunk->len = recv(fds[idx].fd, chunk->data, sizeof(chunk->data), 0);
+            if (chunk->len <= 0) {
+                closed = 1;
+                break;
+            }
+            setsockopt(fds[idx].fd, IPPROTO_TCP, TCP_QUICKACK, &one, sizeof(one));
+            chunk->due_us = _tls_bench_relay_now_us() + relay->rtt_ms * 500;
+            queue[idx].tail++;
+            if (direction != idx) {
+                direction = idx;
+                relay->flights++;
+            }
+            if (idx == 0) {
+                relay->bytes_up += chunk->len;
+            } else {
+                relay->bytes_down += chunk->len;
+            }
+        }
+    }
+}
+
+static void *_tls_bench_relay_thread(void *arg)
+{
+    tls_bench_relay_t *relay = (tls_bench_relay_t *)arg;
+    struct sockaddr_in addr;
+    struct pollfd fds[2];
+    uint8_t buffer[4096];
+    int client_fd = -1, server_fd = -1, direction = -1, idx = 0, one = 1;
+    ssize_t len = 0;
+
+    while ((client_fd = accept(relay->listen_fd, NULL, NULL)) >= 0) {
+        server_fd = socket(AF_INET, SOCK_STREAM, 0);
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(relay->server_port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(server_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+            perror("connect test server");
+            close(client_fd);
+            close(server_fd);
+            continue;
+        }
+
+        setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        setsockopt(server_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (relay->per_packet) {
+            _tls_bench_relay_per_packet(relay, client_fd, server_fd);
+            goto closed;
+        }
+        fds[0].fd = client_fd;
+        fds[1].fd = server_fd;
+        fds[0].events = fds[1].events = POLLIN;
+        direction = -1;
+        while (poll(fds, 2, -1) > 0) {
+            for (idx = 0; idx < 2; idx++) {
+                if ((fds[idx].revents & (POLLIN | POLLHUP | POLLERR)) == 0) {
+                    continue;
+                }
+                len = recv(fds[idx].fd, buffer, sizeof(buffer), 0);
+                if (len <= 0) {
+                    goto closed;
+                }
+                /* 立即确认, 否则两端的Nagle算法和延迟确认会让每个往返多等几十毫秒 */
+                setsockopt(fds[idx].fd, IPPROTO_TCP, TCP_QUICKACK, &one, sizeof(one));
+                if (direction != idx) {
+                    usleep(relay->rtt_ms * 500);
+                    direction = idx;
+                    relay->flights++;
+                }
+                if (idx == 0) {
+                    relay->bytes_up += len;
+                } else {
+                    relay->bytes_down += len;
+                }
+                send(fds[1 - idx].fd, buffer, len, MSG_NOSIGNAL);
+            }
+        }
+closed:
+        close(client_fd);
+        close(server_fd);
+    }
+
+    return NULL;
+}
+
+int32_t tls_bench_relay_start(tls_bench_relay_t *relay)
+{
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    pthread_t thread;
+
+    relay->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(relay->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(relay->listen_fd, 1) < 0 ||
+        getsockname(relay->listen_fd, (struct sockaddr *)&addr, &addr_len) < 0) {
+        perror("relay");
+        return -1;
+    }
+    relay->relay_port = ntohs(addr.sin_port);
+
+    return (pthread_create(&thread, NULL, _tls_bench_relay_thread, relay) == 0) ? 0 : -1;
+}
+
+void tls_bench_relay_reset(tls_bench_relay_t *relay)
+{
+    relay->bytes_up = relay->bytes_down = 0;
+    relay->flights = 0;
+}
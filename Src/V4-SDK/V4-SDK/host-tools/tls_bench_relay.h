@@ -0,0 +1,35 @@
+/**
+ * @file tls_bench_relay.h
+ * @brief TLS主机基准测试共用的本地TCP中继, 统计经过的字节数并可模拟往返时延
+ */
+
+#ifndef _TLS_BENCH_RELAY_H_
+#define _TLS_BENCH_RELAY_H_
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+typedef struct {
+    int listen_fd;
+    uint16_t relay_port;    /* 启动后为中继监听的本地端口 */
+    uint16_t server_port;   /* 测试服务器在127.0.0.1上的端口 */
+    uint32_t rtt_ms;        /* 每次换向时延迟rtt_ms/2 */
+    uint8_t per_packet;     /* 为1时改为每个数据块各自延迟rtt_ms/2, 同一方向上先后发出的数据块之间的间隔得以保留 */
+    uint64_t bytes_up;
+    uint64_t bytes_down;
+    uint32_t flights;
+} tls_bench_relay_t;
+
+/* 在后台线程中接受连接, 一次只转发一条, 连接关闭后再接受下一条 */
+int32_t tls_bench_relay_start(tls_bench_relay_t *relay);
+
+void tls_bench_relay_reset(tls_bench_relay_t *relay);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* #ifndef _TLS_BENCH_RELAY_H_ */
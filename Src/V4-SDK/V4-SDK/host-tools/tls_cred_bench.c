@@ -0,0 +1,181 @@
+/**
+ * @file tls_cred_bench.c
+ * @brief 在主机上比较反复重连时每次解析CA证书与使用凭据缓存的客户端CPU耗时和堆用量, 由tls_cred_bench.sh启动本地测试服务器后运行
+ *
+ * 编译:
+ *     gcc -O2 -Icore -Icore/sysdep -Icore/utils -Iexternal/mbedtls/include -o tls_cred_bench \
+ *         host-tools/tls_cred_bench.c portfiles/aiot_port/aiot_port.c external/mbedtls/library/\*.c -lpthread
+ *
+ * 用法:
+ *     ./tls_cred_bench <server_port> <server_cert.pem> <server_cert.der> [count]
+ *
+ * 完整握手和会话恢复两种情况下, 分别测量:
+ *     pem/each  每次连接前清空凭据缓存, 即缓存之前的行为, 每次重连都解析PEM
+ *     der/each  同上, 证书以DER格式提供, 省去base64解码
+ *     pem/once  使用凭据缓存, 只有第一次连接解析
+ * cached为凭据缓存常驻的内存, 不计入握手峰值. 主机上握手的耗时波动比解析本身还大, 所以最后单独测量一次解析的耗时,
+ * 即凭据缓存在每次重连时省去的部分
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "aiot_state_api.h"
+#include "aiot_sysdep_api.h"
+#include "mbedtls/x509_crt.h"
+
+#define TLS_CRED_BENCH_DEFAULT_COUNT    (20)
+#define TLS_CRED_BENCH_PARSE_COUNT      (2000)
+
+extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
+extern void core_sysdep_tls_get_mem_usage(uint32_t *handshake_peak, uint32_t *established);
+extern void core_sysdep_tls_session_clear(void);
+extern void core_sysdep_tls_cred_clear(void);
+extern void core_sysdep_tls_cred_get_usage(uint32_t *parsed, uint32_t *mem_used);
+
+static int32_t _tls_cred_bench_connect(uint16_t port, aiot_sysdep_network_cred_t *cred, double *cpu,
+                                       uint32_t *handshake_peak)
+{
+    aiot_sysdep_portfile_t *sysdep = &g_aiot_sysdep_portfile;
+    core_sysdep_socket_type_t socket_type = CORE_SYSDEP_SOCKET_TCP_CLIENT;
+    uint32_t timeout_ms = 5000, established = 0;
+    void *network = NULL;
+    clock_t start = 0;
+    int32_t res = 0;
+
+    start = clock();
+    network = sysdep->core_sysdep_network_init();
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_SOCKET_TYPE, &socket_type);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_HOST, "127.0.0.1");
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_PORT, &port);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_CONNECT_TIMEOUT_MS, &timeout_ms);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_CRED, cred);
+    res = sysdep->core_sysdep_network_establish(network);
+    if (res >= 0) {
+        core_sysdep_tls_get_mem_usage(handshake_peak, &established);
+    }
+    sysdep->core_sysdep_network_deinit(&network);
+    *cpu += (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    return res;
+}
+
+static int32_t _tls_cred_bench_run(const char *handshake, const char *format, uint8_t cached, uint16_t port,
+                                   aiot_sysdep_network_cred_t *cred, uint32_t count)
+{
+    uint32_t idx = 0, peak = 0, max_peak = 0, parsed_start = 0, parsed = 0, mem_used = 0;
+    double cpu = 0;
+
+    core_sysdep_tls_session_clear();
+    core_sysdep_tls_cred_clear();
+    core_sysdep_tls_cred_get_usage(&parsed_start, NULL);
+
+    for (idx = 0; idx < count; idx++) {
+        if (strcmp(handshake, "full") == 0) {
+            core_sysdep_tls_session_clear();
+        }
+        if (cached == 0) {
+            core_sysdep_tls_cred_clear();
+        }
+        if (_tls_cred_bench_connect(port, cred, &cpu, &peak) < 0) {
+            printf("handshake failed\n");
+            return -1;
+        }
+        max_peak = (peak > max_peak) ? peak : max_peak;
+    }
+    core_sysdep_tls_cred_get_usage(&parsed, &mem_used);
+
+    printf("    | %-7s | %s/%-4s | %8.3f ms | %6u bytes | %6u | %6u bytes |\n", handshake, format,
+           cached ? "once" : "each", 1000.0 * cpu / count, max_peak, parsed - parsed_start, mem_used);
+
+    return 0;
+}
+
+static int32_t _tls_cred_bench_parse(const char *format, const char *buffer, size_t len)
+{
+    mbedtls_x509_crt crt;
+    uint32_t idx = 0;
+    clock_t start = 0;
+    int32_t res = 0;
+
+    start = clock();
+    for (idx = 0; res == 0 && idx < TLS_CRED_BENCH_PARSE_COUNT; idx++) {
+        mbedtls_x509_crt_init(&crt);
+        res = mbedtls_x509_crt_parse(&crt, (const unsigned char *)buffer, len);
+        mbedtls_x509_crt_free(&crt);
+    }
+    if (res != 0) {
+        printf("parse failed\n");
+        return -1;
+    }
+
+    printf("    | parse   | %s      | %8.3f ms |\n", format,
+           1000.0 * (clock() - start) / CLOCKS_PER_SEC / TLS_CRED_BENCH_PARSE_COUNT);
+
+    return 0;
+}
+
+static int32_t _tls_cred_bench_load(const char *path, char *buffer, uint32_t size, uint32_t *len)
+{
+    FILE *fp = NULL;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        perror(path);
+        return -1;
+    }
+    *len = (uint32_t)fread(buffer, 1, size - 1, fp);
+    buffer[*len] = '\0';
+    fclose(fp);
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    aiot_sysdep_network_cred_t pem_cred, der_cred;
+    static char pem[8192], der[8192];
+    uint32_t count = TLS_CRED_BENCH_DEFAULT_COUNT, pem_len = 0, der_len = 0, idx = 0;
+    const char *handshake[] = {"full", "resumed"};
+    uint16_t port = 0;
+
+    if (argc < 4) {
+        printf("usage: %s <server_port> <server_cert.pem> <server_cert.der> [count]\n", argv[0]);
+        return 1;
+    }
+    port = (uint16_t)atoi(argv[1]);
+    if (argc > 4) {
+        count = (uint32_t)atoi(argv[4]);
+    }
+
+    if (_tls_cred_bench_load(argv[2], pem, sizeof(pem), &pem_len) < 0 ||
+        _tls_cred_bench_load(argv[3], der, sizeof(der), &der_len) < 0) {
+        return 1;
+    }
+
+    memset(&pem_cred, 0, sizeof(pem_cred));
+    pem_cred.option = AIOT_SYSDEP_NETWORK_CRED_SVRCERT_RSA;
+    pem_cred.max_tls_fragment = 16384;
+    pem_cred.x509_server_cert = pem;
+    pem_cred.x509_server_cert_len = pem_len;
+    memcpy(&der_cred, &pem_cred, sizeof(der_cred));
+    der_cred.x509_server_cert = der;
+    der_cred.x509_server_cert_len = der_len;
+
+    for (idx = 0; idx < sizeof(handshake) / sizeof(handshake[0]); idx++) {
+        if (_tls_cred_bench_run(handshake[idx], "pem", 0, port, &pem_cred, count) < 0 ||
+            _tls_cred_bench_run(handshake[idx], "der", 0, port, &der_cred, count) < 0 ||
+            _tls_cred_bench_run(handshake[idx], "pem", 1, port, &pem_cred, count) < 0) {
+            return 1;
+        }
+    }
+
+    if (_tls_cred_bench_parse("pem", pem, pem_len + 1) < 0 || _tls_cred_bench_parse("der", der, der_len) < 0) {
+        return 1;
+    }
+
+    return 0;
+}
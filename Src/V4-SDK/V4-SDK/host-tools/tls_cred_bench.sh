@@ -0,0 +1,38 @@
+#!/bin/bash
+#
+# 用openssl s_server在本地起一个TLS1.2测试服务器, 比较反复重连时每次解析CA证书(PEM/DER)和使用凭据缓存的差别, 用法:
+#
+#     bash host-tools/tls_cred_bench.sh <output_dir> [count]
+#
+# 服务器证书为临时生成的RSA 2048自签名证书, 同时作为客户端的CA证书
+
+if [ "${1}" = "" ];then
+    exit 1
+fi
+
+OBJDIR=${1}/tls_cred_bench
+COUNT=${2:-20}
+PORT=${TLS_CRED_BENCH_PORT:-18447}
+INC="-Icore -Icore/sysdep -Icore/utils -Iexternal/mbedtls/include"
+
+mkdir -p ${OBJDIR}
+
+openssl req -x509 -newkey rsa:2048 -nodes -keyout ${OBJDIR}/key.pem -out ${OBJDIR}/cert.pem -days 1 \
+    -subj "/CN=localhost" > /dev/null 2>&1 || exit 1
+openssl x509 -in ${OBJDIR}/cert.pem -outform der -out ${OBJDIR}/cert.der || exit 1
+gcc -O2 ${INC} -o ${OBJDIR}/tls_cred_bench host-tools/tls_cred_bench.c portfiles/aiot_port/aiot_port.c \
+    external/mbedtls/library/*.c -lpthread || exit 1
+
+sleep 3600 | openssl s_server -accept 127.0.0.1:${PORT} -tls1_2 -cipher 'AES128-SHA256:AES256-SHA256:AES128-SHA:AES256-SHA' \
+    -cert ${OBJDIR}/cert.pem -key ${OBJDIR}/key.pem -quiet > /dev/null 2>&1 &
+SERVER=$!
+sleep 1
+
+echo ""
+echo "    |  hs     |  cert    |  client cpu  | handshake peak | parses |     cached     |"
+${OBJDIR}/tls_cred_bench ${PORT} ${OBJDIR}/cert.pem ${OBJDIR}/cert.der ${COUNT} | grep '^    |\|failed'
+RES=${PIPESTATUS[0]}
+echo ""
+
+kill ${SERVER} $(jobs -p) > /dev/null 2>&1
+exit ${RES}
@@ -0,0 +1,126 @@
+/**
+ * @file tls_ecc_bench.c
+ * @brief 在主机上比较RSA与ECDHE-ECDSA两种安全策略完整握手的CPU耗时、堆峰值和传输字节数, 由tls_ecc_bench.sh启动两个测试服务器后运行
+ *
+ * 编译:
+ *     gcc -O2 -DMBEDTLS_SSL_ECC_PROFILE -Icore -Icore/sysdep -Icore/utils -Ihost-tools -Iexternal/mbedtls/include \
+ *         -o tls_ecc_bench host-tools/tls_ecc_bench.c host-tools/tls_bench_relay.c portfiles/aiot_port/aiot_port.c \
+ *         external/mbedtls/library/\*.c -lpthread
+ *
+ * 用法:
+ *     ./tls_ecc_bench <rsa|ecc> <server_port> <server_cert.pem> [count]
+ *
+ * 每次连接前清空会话缓存, 保证都是完整握手. cpu只统计本进程(客户端), 服务端在另一个进程中;
+ * wall为建联的实际耗时, 包含服务端的私钥运算; 握手字节数由本地中继统计
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "aiot_state_api.h"
+#include "aiot_sysdep_api.h"
+#include "tls_bench_relay.h"
+
+#define TLS_ECC_BENCH_DEFAULT_COUNT     (20)
+
+extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
+extern void core_sysdep_tls_get_mem_usage(uint32_t *handshake_peak, uint32_t *established);
+extern void core_sysdep_tls_session_clear(void);
+
+static double _tls_ecc_bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int32_t _tls_ecc_bench_handshake(tls_bench_relay_t *relay, aiot_sysdep_network_cred_t *cred, double *cpu,
+                                        double *wall, uint32_t *handshake_peak)
+{
+    aiot_sysdep_portfile_t *sysdep = &g_aiot_sysdep_portfile;
+    core_sysdep_socket_type_t socket_type = CORE_SYSDEP_SOCKET_TCP_CLIENT;
+    uint32_t timeout_ms = 5000, established = 0;
+    void *network = NULL;
+    clock_t start = 0;
+    double wall_start = 0;
+    int32_t res = 0;
+
+    core_sysdep_tls_session_clear();
+
+    network = sysdep->core_sysdep_network_init();
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_SOCKET_TYPE, &socket_type);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_HOST, "127.0.0.1");
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_PORT, &relay->relay_port);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_CONNECT_TIMEOUT_MS, &timeout_ms);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_CRED, cred);
+
+    wall_start = _tls_ecc_bench_now();
+    start = clock();
+    res = sysdep->core_sysdep_network_establish(network);
+    *cpu += (double)(clock() - start) / CLOCKS_PER_SEC;
+    *wall += _tls_ecc_bench_now() - wall_start;
+    if (res >= 0) {
+        core_sysdep_tls_get_mem_usage(handshake_peak, &established);
+    }
+    sysdep->core_sysdep_network_deinit(&network);
+
+    return res;
+}
+
+int main(int argc, char *argv[])
+{
+    aiot_sysdep_network_cred_t cred;
+    tls_bench_relay_t relay;
+    uint32_t count = TLS_ECC_BENCH_DEFAULT_COUNT, idx = 0, peak = 0, max_peak = 0;
+    static char cert[8192];
+    double cpu = 0, wall = 0;
+    size_t cert_len = 0;
+    FILE *fp = NULL;
+
+    if (argc < 4) {
+        printf("usage: %s <rsa|ecc> <server_port> <server_cert.pem> [count]\n", argv[0]);
+        return 1;
+    }
+    if (argc > 4) {
+        count = (uint32_t)atoi(argv[4]);
+    }
+
+    fp = fopen(argv[3], "r");
+    if (fp == NULL) {
+        perror(argv[3]);
+        return 1;
+    }
+    cert_len = fread(cert, 1, sizeof(cert) - 1, fp);
+    fclose(fp);
+
+    memset(&cred, 0, sizeof(cred));
+    cred.option = (strcmp(argv[1], "ecc") == 0) ? AIOT_SYSDEP_NETWORK_CRED_SVRCERT_ECC :
+                  AIOT_SYSDEP_NETWORK_CRED_SVRCERT_RSA;
+    cred.max_tls_fragment = 16384;
+    cred.x509_server_cert = cert;
+    cred.x509_server_cert_len = cert_len;
+
+    memset(&relay, 0, sizeof(relay));
+    relay.server_port = (uint16_t)atoi(argv[2]);
+    if (tls_bench_relay_start(&relay) < 0) {
+        return 1;
+    }
+
+    for (idx = 0; idx < count; idx++) {
+        if (_tls_ecc_bench_handshake(&relay, &cred, &cpu, &wall, &peak) < 0) {
+            printf("handshake failed\n");
+            return 1;
+        }
+        max_peak = (peak > max_peak) ? peak : max_peak;
+    }
+
+    printf("    | %-3s | %9.2f ms | %9.2f ms | %8u bytes | %7llu bytes | %7llu bytes |\n", argv[1],
+           1000.0 * cpu / count, 1000.0 * wall / count, max_peak,
+           (unsigned long long)(relay.bytes_up / count), (unsigned long long)(relay.bytes_down / count));
+
+    return 0;
+}
@@ -0,0 +1,46 @@
+#!/bin/bash
+#
+# 以MBEDTLS_SSL_ECC_PROFILE编译, 分别对RSA 2048和ECDSA P-256证书的测试服务器做完整握手, 比较客户端CPU耗时、
+# 握手堆峰值和两个方向的字节数, 用法:
+#
+#     bash host-tools/tls_ecc_bench.sh <output_dir> [count]
+#
+# RSA服务器只开放RSA密钥交换套件(与默认配置下设备实际协商的一致), ECC服务器只开放ECDHE-ECDSA-AES128-GCM-SHA256
+
+if [ "${1}" = "" ];then
+    exit 1
+fi
+
+OBJDIR=${1}/tls_ecc_bench
+COUNT=${2:-20}
+RSA_PORT=${TLS_ECC_BENCH_PORT:-18445}
+ECC_PORT=$((RSA_PORT + 1))
+INC="-Icore -Icore/sysdep -Icore/utils -Ihost-tools -Iexternal/mbedtls/include"
+
+mkdir -p ${OBJDIR}
+
+openssl req -x509 -newkey rsa:2048 -nodes -keyout ${OBJDIR}/rsa_key.pem -out ${OBJDIR}/rsa_cert.pem -days 1 \
+    -subj "/CN=localhost" > /dev/null 2>&1 || exit 1
+openssl req -x509 -newkey ec -pkeyopt ec_paramgen_curve:P-256 -nodes -keyout ${OBJDIR}/ecc_key.pem \
+    -out ${OBJDIR}/ecc_cert.pem -days 1 -subj "/CN=localhost" > /dev/null 2>&1 || exit 1
+gcc -O2 -DMBEDTLS_SSL_ECC_PROFILE ${INC} -o ${OBJDIR}/tls_ecc_bench host-tools/tls_ecc_bench.c \
+    host-tools/tls_bench_relay.c portfiles/aiot_port/aiot_port.c \
+    external/mbedtls/library/*.c -lpthread || exit 1
+
+sleep 3600 | openssl s_server -accept 127.0.0.1:${RSA_PORT} -tls1_2 -cipher 'AES128-SHA256:AES256-SHA256:AES128-SHA:AES256-SHA' \
+    -cert ${OBJDIR}/rsa_cert.pem -key ${OBJDIR}/rsa_key.pem -quiet > /dev/null 2>&1 &
+RSA_SERVER=$!
+sleep 3600 | openssl s_server -accept 127.0.0.1:${ECC_PORT} -tls1_2 -cipher 'ECDHE-ECDSA-AES128-GCM-SHA256' \
+    -cert ${OBJDIR}/ecc_cert.pem -key ${OBJDIR}/ecc_key.pem -quiet > /dev/null 2>&1 &
+ECC_SERVER=$!
+sleep 1
+
+RES=0
+echo ""
+echo "    |     |  client cpu  |     wall     | handshake peak |  client->svr  |  svr->client  |"
+${OBJDIR}/tls_ecc_bench rsa ${RSA_PORT} ${OBJDIR}/rsa_cert.pem ${COUNT} | grep '^    |\|failed' || RES=1
+${OBJDIR}/tls_ecc_bench ecc ${ECC_PORT} ${OBJDIR}/ecc_cert.pem ${COUNT} | grep '^    |\|failed' || RES=1
+echo ""
+
+kill ${RSA_SERVER} ${ECC_SERVER} $(jobs -p) > /dev/null 2>&1
+exit ${RES}
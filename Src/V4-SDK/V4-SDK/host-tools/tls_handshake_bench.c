@@ -0,0 +1,166 @@
+/**
+ * @file tls_handshake_bench.c
+ * @brief 在主机上比较linux对接层中阻塞和非阻塞建立TLS连接的耗时, 并按flight输出握手的时间线, 由tls_handshake_bench.sh启动本地测试服务器后运行
+ *
+ * 编译:
+ *     gcc -O2 -Icore -Icore/sysdep -Icore/utils -Ihost-tools -Iexternal/mbedtls/include -o tls_handshake_bench \
+ *         host-tools/tls_handshake_bench.c host-tools/tls_bench_relay.c portfiles/aiot_port/aiot_port.c \
+ *         external/mbedtls/library/\*.c -lpthread
+ *
+ * 用法:
+ *     ./tls_handshake_bench <rsa|psk> <server_port> <server_cert.pem|psk> [rtt_ms]
+ *
+ * 连接经过本地中继转发到测试服务器, 中继在每次换向时延迟rtt_ms/2. 每次连接前清空会话缓存, 总是完整握手
+ *     blocking  core_sysdep_network_establish 阻塞到握手结束
+ *     nonblock  设置 CORE_SYSDEP_NETWORK_NONBLOCK, 由每毫秒一次的主循环调用establish, 输出握手期间主循环执行的次数
+ *               和单次调用establish的最长耗时, 即握手对主循环中其它工作造成的最长延迟
+ * 两种方式的flight数和每个flight的字节数必须一致, 否则返回1
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "aiot_state_api.h"
+#include "aiot_sysdep_api.h"
+#include "tls_bench_relay.h"
+
+#define TLS_HANDSHAKE_BENCH_TICK_US     (1000)
+
+extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
+extern void core_sysdep_tls_session_clear(void);
+
+static double _tls_handshake_bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int32_t _tls_handshake_bench_run(const char *mode, tls_bench_relay_t *relay, aiot_sysdep_network_cred_t *cred,
+                                        core_sysdep_psk_t *psk, core_sysdep_handshake_stats_t *stats)
+{
+    aiot_sysdep_portfile_t *sysdep = &g_aiot_sysdep_portfile;
+    core_sysdep_socket_type_t socket_type = CORE_SYSDEP_SOCKET_TCP_CLIENT;
+    uint32_t timeout_ms = 5000, ticks = 0;
+    uint8_t nonblock = (strcmp(mode, "nonblock") == 0) ? 1 : 0;
+    void *network = NULL;
+    double start = 0, wall = 0;
+    int32_t res = 0;
+
+    core_sysdep_tls_session_clear();
+
+    network = sysdep->core_sysdep_network_init();
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_SOCKET_TYPE, &socket_type);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_HOST, "127.0.0.1");
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_PORT, &relay->relay_port);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_CONNECT_TIMEOUT_MS, &timeout_ms);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_CRED, cred);
+    if (psk != NULL) {
+        sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_PSK, psk);
+    }
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_NONBLOCK, &nonblock);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_HANDSHAKE_STATS, stats);
+
+    start = _tls_handshake_bench_now();
+    while ((res = sysdep->core_sysdep_network_establish(network)) == STATE_PORT_NETWORK_ESTABLISH_IN_PROGRESS) {
+        /* 主循环中的其它工作 */
+        usleep(TLS_HANDSHAKE_BENCH_TICK_US);
+        ticks++;
+    }
+    wall = _tls_handshake_bench_now() - start;
+    sysdep->core_sysdep_network_deinit(&network);
+
+    /* 中继转发close_notify时也会延迟rtt_ms/2, 等它看到连接关闭, 否则下一次连接的ClientHello要排在后面 */
+    usleep((relay->rtt_ms + 20) * 1000);
+
+    if (res < STATE_SUCCESS) {
+        printf("%s handshake failed, res: -0x%04X\n", mode, -res);
+        return res;
+    }
+
+    printf("    | %-8s | %8.1f ms | %7.1f ms | %8.1f ms | %5u | %6u | %7.2f ms | %10u |\n", mode, 1000 * wall,
+           stats->connect_us / 1000.0, stats->handshake_us / 1000.0, stats->steps, stats->yields,
+           stats->max_step_us / 1000.0, ticks);
+
+    return STATE_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+    aiot_sysdep_network_cred_t cred;
+    core_sysdep_psk_t psk;
+    core_sysdep_handshake_stats_t blocking, nonblock;
+    tls_bench_relay_t relay;
+    static char cert[8192];
+    size_t cert_len = 0;
+    uint32_t idx = 0;
+    FILE *fp = NULL;
+
+    if (argc < 4) {
+        printf("usage: %s <rsa|psk> <server_port> <server_cert.pem|psk> [rtt_ms]\n", argv[0]);
+        return 1;
+    }
+
+    memset(&cred, 0, sizeof(cred));
+    cred.max_tls_fragment = 16384;
+    if (strcmp(argv[1], "psk") == 0) {
+        cred.option = AIOT_SYSDEP_NETWORK_CRED_SVRCERT_PSK;
+        psk.psk_id = "tls_handshake_bench";
+        psk.psk = argv[3];
+    } else {
+        fp = fopen(argv[3], "r");
+        if (fp == NULL) {
+            perror(argv[3]);
+            return 1;
+        }
+        cert_len = fread(cert, 1, sizeof(cert) - 1, fp);
+        fclose(fp);
+        cred.option = AIOT_SYSDEP_NETWORK_CRED_SVRCERT_RSA;
+        cred.x509_server_cert = cert;
+        cred.x509_server_cert_len = cert_len;
+    }
+
+    memset(&relay, 0, sizeof(relay));
+    relay.server_port = (uint16_t)atoi(argv[2]);
+    relay.rtt_ms = (argc > 4) ? (uint32_t)atoi(argv[4]) : 0;
+    if (tls_bench_relay_start(&relay) < 0) {
+        return 1;
+    }
+
+    printf("    | %-8s |    wall     | connect   | handshake   | steps | yields |  max step  | loop ticks |\n",
+           argv[1]);
+    if (_tls_handshake_bench_run("blocking", &relay, &cred, (cred.option == AIOT_SYSDEP_NETWORK_CRED_SVRCERT_PSK) ?
+                                 &psk : NULL, &blocking) < 0 ||
+        _tls_handshake_bench_run("nonblock", &relay, &cred, (cred.option == AIOT_SYSDEP_NETWORK_CRED_SVRCERT_PSK) ?
+                                 &psk : NULL, &nonblock) < 0) {
+        return 1;
+    }
+
+    printf("\n    | flight | direction | %7s bytes | begin ms | end ms   | cpu ms  |\n", argv[1]);
+    for (idx = 0; idx < nonblock.flight_num; idx++) {
+        printf("    | %6u | %-9s | %13u | %8.1f | %8.1f | %7.2f |\n", idx + 1,
+               nonblock.flight[idx].outbound ? "client" : "server", nonblock.flight[idx].bytes,
+               nonblock.flight[idx].begin_us / 1000.0, nonblock.flight[idx].end_us / 1000.0,
+               nonblock.flight[idx].cpu_us / 1000.0);
+    }
+
+    if (blocking.flight_num != nonblock.flight_num) {
+        printf("flight mismatch: %u/%u\n", blocking.flight_num, nonblock.flight_num);
+        return 1;
+    }
+    for (idx = 0; idx < nonblock.flight_num; idx++) {
+        if (blocking.flight[idx].outbound != nonblock.flight[idx].outbound ||
+            blocking.flight[idx].bytes != nonblock.flight[idx].bytes) {
+            printf("flight %u mismatch: %u/%u bytes\n", idx + 1, blocking.flight[idx].bytes,
+                   nonblock.flight[idx].bytes);
+            return 1;
+        }
+    }
+
+    return 0;
+}
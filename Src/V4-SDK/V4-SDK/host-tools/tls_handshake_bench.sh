@@ -0,0 +1,49 @@
+#!/bin/bash
+#
+# 用openssl s_server在本地起TLS1.2测试服务器, 比较阻塞和非阻塞建立连接的耗时, 并输出每个握手flight的字节数、时刻和计算耗时, 用法:
+#
+#     bash host-tools/tls_handshake_bench.sh <output_dir> [rtt_ms]
+#
+# 树中的mbedtls只带客户端, 所以测试服务器使用openssl. rsa为RSA 2048自签名证书的服务器, psk为PSK-AES128-CBC-SHA的服务器;
+# 对接层把PSK字符串本身作为密钥, 所以传给openssl的是它的十六进制
+
+if [ "${1}" = "" ];then
+    exit 1
+fi
+
+OBJDIR=${1}/tls_handshake_bench
+RTT_MS=${2:-100}
+RSA_PORT=${TLS_HANDSHAKE_BENCH_PORT:-18447}
+PSK_PORT=$((RSA_PORT + 1))
+PSK=00112233445566778899aabbccddeeff
+INC="-Icore -Icore/sysdep -Icore/utils -Ihost-tools -Iexternal/mbedtls/include"
+
+mkdir -p ${OBJDIR}
+
+openssl req -x509 -newkey rsa:2048 -nodes -keyout ${OBJDIR}/key.pem -out ${OBJDIR}/cert.pem -days 1 \
+    -subj "/CN=localhost" > /dev/null 2>&1 || exit 1
+gcc -O2 ${INC} -o ${OBJDIR}/tls_handshake_bench host-tools/tls_handshake_bench.c host-tools/tls_bench_relay.c \
+    portfiles/aiot_port/aiot_port.c \
+    external/mbedtls/library/*.c -lpthread || exit 1
+
+sleep 3600 | openssl s_server -accept 127.0.0.1:${RSA_PORT} -tls1_2 -cipher 'AES128-SHA256:AES256-SHA256:AES128-SHA:AES256-SHA' \
+    -cert ${OBJDIR}/cert.pem -key ${OBJDIR}/key.pem -quiet > /dev/null 2>&1 &
+RSA_SERVER=$!
+sleep 3600 | openssl s_server -accept 127.0.0.1:${PSK_PORT} -tls1_2 -nocert -cipher 'PSK-AES128-CBC-SHA' \
+    -psk $(printf ${PSK} | xxd -p -c 100) -psk_identity tls_handshake_bench -quiet > /dev/null 2>&1 &
+PSK_SERVER=$!
+sleep 1
+
+RES=0
+echo ""
+echo "    rtt: ${RTT_MS} ms"
+echo ""
+${OBJDIR}/tls_handshake_bench rsa ${RSA_PORT} ${OBJDIR}/cert.pem ${RTT_MS} | grep '^    |\|^$\|failed\|mismatch'
+[ ${PIPESTATUS[0]} -eq 0 ] || RES=1
+echo ""
+${OBJDIR}/tls_handshake_bench psk ${PSK_PORT} ${PSK} ${RTT_MS} | grep '^    |\|^$\|failed\|mismatch'
+[ ${PIPESTATUS[0]} -eq 0 ] || RES=1
+echo ""
+
+kill ${RSA_SERVER} ${PSK_SERVER} $(jobs -p) > /dev/null 2>&1
+exit ${RES}
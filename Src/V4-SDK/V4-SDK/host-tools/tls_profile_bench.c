@@ -0,0 +1,139 @@
+/**
+ * @file tls_profile_bench.c
+ * @brief 在主机上测量当前编译选择的TLS记录缓冲区档位的握手堆峰值和传输速率, 由tls_profile_bench.sh对每个档位分别编译运行
+ *
+ * 编译:
+ *     gcc -O2 -DMBEDTLS_SSL_BUFFER_PROFILE=<n> -Icore -Icore/sysdep -Icore/utils -Ihost-tools \
+ *         -Iexternal/mbedtls/include -o tls_profile_bench host-tools/tls_profile_bench.c \
+ *         host-tools/tls_bench_relay.c portfiles/aiot_port/aiot_port.c external/mbedtls/library/\*.c -lpthread
+ *
+ * 用法:
+ *     ./tls_profile_bench <server_port> <server_cert.pem>
+ *
+ * 测试服务器需要把收到的每一行回显给客户端(openssl s_server -rev). 每次写入TLS_PROFILE_BENCH_CHUNK_LEN字节后
+ * 读回同样长度的回显, 共TLS_PROFILE_BENCH_TOTAL_LEN字节; 中继统计线路上的字节数, 由此得到记录头/MAC/填充的开销
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "aiot_state_api.h"
+#include "aiot_sysdep_api.h"
+#include "mbedtls/ssl.h"
+#include "tls_bench_relay.h"
+
+#define TLS_PROFILE_BENCH_LINE_LEN      (1024)
+#define TLS_PROFILE_BENCH_CHUNK_LEN     (4 * TLS_PROFILE_BENCH_LINE_LEN)
+#define TLS_PROFILE_BENCH_TOTAL_LEN     (1024 * 1024)
+
+extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
+extern void core_sysdep_tls_get_mem_usage(uint32_t *handshake_peak, uint32_t *established);
+
+static double _tls_profile_bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int32_t _tls_profile_bench_transfer(void *network)
+{
+    aiot_sysdep_portfile_t *sysdep = &g_aiot_sysdep_portfile;
+    uint8_t chunk[TLS_PROFILE_BENCH_CHUNK_LEN], echo[TLS_PROFILE_BENCH_CHUNK_LEN];
+    uint32_t idx = 0, sent = 0;
+    int32_t res = 0;
+
+    for (idx = 0; idx < sizeof(chunk); idx++) {
+        chunk[idx] = ((idx + 1) % TLS_PROFILE_BENCH_LINE_LEN == 0) ? '\n' : 'a';
+    }
+
+    for (sent = 0; sent < TLS_PROFILE_BENCH_TOTAL_LEN; sent += sizeof(chunk)) {
+        res = sysdep->core_sysdep_network_send(network, chunk, sizeof(chunk), 5000, NULL);
+        if (res != sizeof(chunk)) {
+            printf("send failed, res: %d\n", res);
+            return -1;
+        }
+        res = sysdep->core_sysdep_network_recv(network, echo, sizeof(echo), 5000, NULL);
+        if (res != sizeof(echo)) {
+            printf("recv failed, res: %d\n", res);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    aiot_sysdep_portfile_t *sysdep = &g_aiot_sysdep_portfile;
+    core_sysdep_socket_type_t socket_type = CORE_SYSDEP_SOCKET_TCP_CLIENT;
+    aiot_sysdep_network_cred_t cred;
+    tls_bench_relay_t relay;
+    uint32_t timeout_ms = 5000, handshake_peak = 0, established = 0;
+    uint64_t handshake_up = 0, handshake_down = 0;
+    static char cert[8192];
+    void *network = NULL;
+    double elapsed = 0;
+    size_t cert_len = 0;
+    FILE *fp = NULL;
+
+    if (argc < 3) {
+        printf("usage: %s <server_port> <server_cert.pem>\n", argv[0]);
+        return 1;
+    }
+
+    fp = fopen(argv[2], "r");
+    if (fp == NULL) {
+        perror(argv[2]);
+        return 1;
+    }
+    cert_len = fread(cert, 1, sizeof(cert) - 1, fp);
+    fclose(fp);
+
+    memset(&cred, 0, sizeof(cred));
+    cred.option = AIOT_SYSDEP_NETWORK_CRED_SVRCERT_RSA;
+    cred.max_tls_fragment = 16384;
+    cred.x509_server_cert = cert;
+    cred.x509_server_cert_len = cert_len;
+
+    memset(&relay, 0, sizeof(relay));
+    relay.server_port = (uint16_t)atoi(argv[1]);
+    if (tls_bench_relay_start(&relay) < 0) {
+        return 1;
+    }
+
+    network = sysdep->core_sysdep_network_init();
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_SOCKET_TYPE, &socket_type);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_HOST, "127.0.0.1");
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_PORT, &relay.relay_port);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_CONNECT_TIMEOUT_MS, &timeout_ms);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_CRED, &cred);
+    if (sysdep->core_sysdep_network_establish(network) < 0) {
+        printf("handshake failed\n");
+        sysdep->core_sysdep_network_deinit(&network);
+        return 1;
+    }
+    core_sysdep_tls_get_mem_usage(&handshake_peak, &established);
+    handshake_up = relay.bytes_up;
+    handshake_down = relay.bytes_down;
+
+    elapsed = _tls_profile_bench_now();
+    if (_tls_profile_bench_transfer(network) < 0) {
+        sysdep->core_sysdep_network_deinit(&network);
+        return 1;
+    }
+    elapsed = _tls_profile_bench_now() - elapsed;
+    sysdep->core_sysdep_network_deinit(&network);
+
+    printf("    | %5d / %-5d | %6u bytes | %6u bytes | %7.1f MB/s | %5.1f%% up | %5.1f%% down |\n",
+           MBEDTLS_SSL_IN_CONTENT_LEN, MBEDTLS_SSL_OUT_CONTENT_LEN, handshake_peak, established,
+           2.0 * TLS_PROFILE_BENCH_TOTAL_LEN / elapsed / 1e6,
+           100.0 * (relay.bytes_up - handshake_up - TLS_PROFILE_BENCH_TOTAL_LEN) / TLS_PROFILE_BENCH_TOTAL_LEN,
+           100.0 * (relay.bytes_down - handshake_down - TLS_PROFILE_BENCH_TOTAL_LEN) / TLS_PROFILE_BENCH_TOTAL_LEN);
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+#!/bin/bash
+#
+# 分别以每一种TLS记录缓冲区档位(MBEDTLS_SSL_BUFFER_PROFILE)编译, 输出握手堆峰值、建立后的常驻堆以及传输速率, 用法:
+#
+#     bash host-tools/tls_profile_bench.sh <output_dir>
+#
+# 测试服务器为openssl s_server -rev, 它遵守客户端协商的max_fragment_length, 回显时按协商的长度分片
+
+if [ "${1}" = "" ];then
+    exit 1
+fi
+
+OBJDIR=${1}/tls_profile_bench
+PORT=${TLS_PROFILE_BENCH_PORT:-18444}
+INC="-Icore -Icore/sysdep -Icore/utils -Ihost-tools -Iexternal/mbedtls/include"
+
+mkdir -p ${OBJDIR}
+
+openssl req -x509 -newkey rsa:2048 -nodes -keyout ${OBJDIR}/key.pem -out ${OBJDIR}/cert.pem -days 1 \
+    -subj "/CN=localhost" > /dev/null 2>&1 || exit 1
+
+sleep 3600 | openssl s_server -accept 127.0.0.1:${PORT} -tls1_2 -rev \
+    -cipher 'AES128-SHA256:AES256-SHA256:AES128-SHA:AES256-SHA' \
+    -cert ${OBJDIR}/cert.pem -key ${OBJDIR}/key.pem -quiet > /dev/null 2>&1 &
+SERVER=$!
+sleep 1
+
+RES=0
+echo ""
+echo "    |   in / out    | handshake peak | established |  transfer   |  record overhead  |"
+for profile in 0 1 2; do
+    gcc -O2 -DMBEDTLS_SSL_BUFFER_PROFILE=${profile} ${INC} -o ${OBJDIR}/tls_profile_bench_${profile} \
+        host-tools/tls_profile_bench.c host-tools/tls_bench_relay.c portfiles/aiot_port/aiot_port.c \
+        external/mbedtls/library/*.c -lpthread || RES=1
+    ${OBJDIR}/tls_profile_bench_${profile} ${PORT} ${OBJDIR}/cert.pem | grep '^    |\|failed' || RES=1
+done
+echo ""
+
+kill ${SERVER} $(jobs -p) > /dev/null 2>&1
+exit ${RES}
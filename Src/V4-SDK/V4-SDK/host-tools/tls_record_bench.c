@@ -0,0 +1,263 @@
+/**
+ * @file tls_record_bench.c
+ * @brief 在主机上校验并测量当前编译选择的AES实现下, TLS记录层每条记录的加密和解密耗时, 由tls_record_bench.sh对每一种组合分别编译运行
+ *
+ * 编译:
+ *     gcc -O2 -DMBEDTLS_SSL_SRV_C [-DMBEDTLS_AES_ROM_TABLES] [-DMBEDTLS_AES_FEWER_TABLES | -DMBEDTLS_AES_SBOX_ONLY] \
+ *         -Iexternal/mbedtls/include -o tls_record_bench host-tools/tls_record_bench.c external/mbedtls/library/\*.c
+ *
+ * 用法:
+ *     ./tls_record_bench <label> <sha1|sha256> <mte|etm> [count]
+ *
+ * 不经过握手: 两个mbedtls上下文用同一个主密钥直接派生密钥, 一个以客户端身份加密, 另一个以服务端身份解密,
+ * 记录经内存中的缓冲区传递, 所以只测量记录层本身. 派生服务端的密钥需要MBEDTLS_SSL_SRV_C. sha1为端口层PSK使用的TLS-PSK-WITH-AES-128-CBC-SHA,
+ * sha256为TLS-RSA-WITH-AES-128-CBC-SHA256; mte为MAC-then-encrypt, etm为encrypt-then-MAC.
+ * 每条记录解密后与明文比较, 不一致返回1. 输出AES表的初始化耗时, 以及各记录长度下单条记录加密/解密的最短耗时
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "mbedtls/aes.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/ssl_internal.h"
+
+#if !defined(MBEDTLS_SSL_SRV_C)
+#error "tls_record_bench must be built with -DMBEDTLS_SSL_SRV_C"
+#endif
+
+#define TLS_RECORD_BENCH_DEFAULT_COUNT  (50)
+#define TLS_RECORD_BENCH_SAMPLE_BYTES   (65536)
+#define TLS_RECORD_BENCH_MIN_RECORDS    (16)
+#define TLS_RECORD_BENCH_PIPE_LEN       (MBEDTLS_SSL_OUT_BUFFER_LEN)
+
+typedef struct {
+    unsigned char buffer[TLS_RECORD_BENCH_PIPE_LEN];
+    size_t head;
+    size_t tail;
+} tls_record_bench_pipe_t;
+
+static const uint32_t g_tls_record_bench_sizes[] = {64, 256, 1024, 4096, 16384};
+
+/* SDK中没有ssl_srv.c, 服务端上下文只用于解密记录, 从不握手 */
+int mbedtls_ssl_handshake_server_step(mbedtls_ssl_context *ssl)
+{
+    (void)ssl;
+    return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+}
+
+static int _tls_record_bench_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    tls_record_bench_pipe_t *pipe = (tls_record_bench_pipe_t *)ctx;
+
+    if (pipe->head == pipe->tail) {
+        pipe->head = pipe->tail = 0;
+    }
+    if (len > sizeof(pipe->buffer) - pipe->tail) {
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+    memcpy(&pipe->buffer[pipe->tail], buf, len);
+    pipe->tail += len;
+
+    return (int)len;
+}
+
+static int _tls_record_bench_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    tls_record_bench_pipe_t *pipe = (tls_record_bench_pipe_t *)ctx;
+
+    if (pipe->head == pipe->tail) {
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+    if (len > pipe->tail - pipe->head) {
+        len = pipe->tail - pipe->head;
+    }
+    memcpy(buf, &pipe->buffer[pipe->head], len);
+    pipe->head += len;
+
+    return (int)len;
+}
+
+/* 只用于显式IV, 不需要密码学强度 */
+static int _tls_record_bench_rng(void *p_rng, unsigned char *output, size_t len)
+{
+    uint32_t *state = (uint32_t *)p_rng;
+
+    while (len--) {
+        *state ^= *state << 13;
+        *state ^= *state >> 17;
+        *state ^= *state << 5;
+        *output++ = (unsigned char)*state;
+    }
+
+    return 0;
+}
+
+static double _tls_record_bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* 跳过握手, 按握手结束时的状态直接装入派生好的密钥 */
+static int32_t _tls_record_bench_setup(mbedtls_ssl_context *ssl, mbedtls_ssl_config *conf, int endpoint,
+                                       int ciphersuite, int etm, tls_record_bench_pipe_t *pipe, uint32_t *rng_state)
+{
+    mbedtls_ssl_transform *transform = NULL;
+
+    mbedtls_ssl_init(ssl);
+    mbedtls_ssl_config_init(conf);
+    if (mbedtls_ssl_config_defaults(conf, endpoint, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT) != 0) {
+        return -1;
+    }
+    mbedtls_ssl_conf_rng(conf, _tls_record_bench_rng, rng_state);
+    if (mbedtls_ssl_setup(ssl, conf) != 0) {
+        return -1;
+    }
+    mbedtls_ssl_set_bio(ssl, pipe, _tls_record_bench_send, _tls_record_bench_recv, NULL);
+
+    ssl->major_ver = MBEDTLS_SSL_MAJOR_VERSION_3;
+    ssl->minor_ver = MBEDTLS_SSL_MINOR_VERSION_3;
+    ssl->session_negotiate->ciphersuite = ciphersuite;
+    ssl->session_negotiate->encrypt_then_mac = etm;
+    memset(ssl->session_negotiate->master, 0x4D, sizeof(ssl->session_negotiate->master));
+    memset(ssl->handshake->randbytes, 0x52, sizeof(ssl->handshake->randbytes));
+    transform = ssl->transform_negotiate;
+    transform->ciphersuite_info = mbedtls_ssl_ciphersuite_from_id(ciphersuite);
+    ssl->handshake->resume = 1;
+    if (transform->ciphersuite_info == NULL || mbedtls_ssl_derive_keys(ssl) != 0) {
+        return -1;
+    }
+
+    ssl->transform_in = ssl->transform_out = transform;
+    ssl->session_in = ssl->session_out = ssl->session_negotiate;
+    ssl->in_msg = ssl->in_iv + transform->ivlen - transform->fixed_ivlen;
+    ssl->out_msg = ssl->out_iv + transform->ivlen - transform->fixed_ivlen;
+    ssl->state = MBEDTLS_SSL_HANDSHAKE_OVER;
+
+    return 0;
+}
+
+static int32_t _tls_record_bench_read(mbedtls_ssl_context *ssl, unsigned char *buffer, uint32_t len)
+{
+    uint32_t pos = 0;
+    int res = 0;
+
+    while (pos < len) {
+        res = mbedtls_ssl_read(ssl, &buffer[pos], len - pos);
+        if (res <= 0) {
+            return -1;
+        }
+        pos += res;
+    }
+
+    return 0;
+}
+
+static int32_t _tls_record_bench_size(mbedtls_ssl_context *client, mbedtls_ssl_context *server, uint32_t size,
+                                      uint32_t count, double *encrypt_us, double *decrypt_us)
+{
+    static unsigned char plain[16384], result[16384];
+    uint32_t idx = 0, total = 0;
+    double start = 0, encrypt = 0, decrypt = 0;
+
+    for (idx = 0; idx < size; idx++) {
+        plain[idx] = (unsigned char)(idx * 7 + size);
+    }
+    total = TLS_RECORD_BENCH_SAMPLE_BYTES / size;
+    total = count * ((total < TLS_RECORD_BENCH_MIN_RECORDS) ? TLS_RECORD_BENCH_MIN_RECORDS : total);
+
+    /* 主机上的其它负载和中断只会让耗时变长, 逐条计时取最小值比平均值稳定 */
+    for (idx = 0; idx < total; idx++) {
+        start = _tls_record_bench_now();
+        if (mbedtls_ssl_write(client, plain, size) != (int)size) {
+            printf("write failed\n");
+            return -1;
+        }
+        encrypt = _tls_record_bench_now() - start;
+
+        memset(result, 0, size);
+        start = _tls_record_bench_now();
+        if (_tls_record_bench_read(server, result, size) < 0) {
+            printf("read failed\n");
+            return -1;
+        }
+        decrypt = _tls_record_bench_now() - start;
+
+        if (memcmp(plain, result, size) != 0) {
+            printf("record mismatch\n");
+            return -1;
+        }
+
+        if (idx == 0 || 1e6 * encrypt < *encrypt_us) {
+            *encrypt_us = 1e6 * encrypt;
+        }
+        if (idx == 0 || 1e6 * decrypt < *decrypt_us) {
+            *decrypt_us = 1e6 * decrypt;
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static tls_record_bench_pipe_t pipe;
+    mbedtls_ssl_context client, server;
+    mbedtls_ssl_config client_conf, server_conf;
+    mbedtls_aes_context aes;
+    unsigned char key[16] = {0};
+    uint32_t count = TLS_RECORD_BENCH_DEFAULT_COUNT, idx = 0, rng_state = 0x2545F491;
+    double start = 0, init_us = 0, encrypt_us = 0, decrypt_us = 0;
+    int ciphersuite = 0, etm = 0;
+    int32_t res = 0;
+
+    if (argc < 4) {
+        printf("usage: %s <label> <sha1|sha256> <mte|etm> [count]\n", argv[0]);
+        return 1;
+    }
+    ciphersuite = (strcmp(argv[2], "sha256") == 0) ? MBEDTLS_TLS_RSA_WITH_AES_128_CBC_SHA256 :
+                  MBEDTLS_TLS_PSK_WITH_AES_128_CBC_SHA;
+    etm = (strcmp(argv[3], "etm") == 0) ? MBEDTLS_SSL_ETM_ENABLED : MBEDTLS_SSL_ETM_DISABLED;
+    if (argc > 4) {
+        count = (uint32_t)atoi(argv[4]);
+    }
+    if (count == 0) {
+        count = 1;
+    }
+
+    /* 第一次设置密钥时才生成RAM中的AES表, 必须在其它任何AES运算之前测量 */
+    mbedtls_aes_init(&aes);
+    start = _tls_record_bench_now();
+    mbedtls_aes_setkey_enc(&aes, key, 128);
+    init_us = 1e6 * (_tls_record_bench_now() - start);
+    mbedtls_aes_free(&aes);
+
+    if (_tls_record_bench_setup(&client, &client_conf, MBEDTLS_SSL_IS_CLIENT, ciphersuite, etm, &pipe,
+                                &rng_state) < 0 ||
+        _tls_record_bench_setup(&server, &server_conf, MBEDTLS_SSL_IS_SERVER, ciphersuite, etm, &pipe,
+                                &rng_state) < 0) {
+        printf("setup failed\n");
+        return 1;
+    }
+
+    printf("    | %-10s | %-6s | %-3s | %6.1f us |", argv[1], argv[2], argv[3], init_us);
+    for (idx = 0; res == 0 && idx < sizeof(g_tls_record_bench_sizes) / sizeof(g_tls_record_bench_sizes[0]); idx++) {
+        res = _tls_record_bench_size(&client, &server, g_tls_record_bench_sizes[idx], count, &encrypt_us,
+                                     &decrypt_us);
+        printf(" %6.2f/%-6.2f |", encrypt_us, decrypt_us);
+    }
+    printf("\n");
+
+    mbedtls_ssl_free(&client);
+    mbedtls_ssl_free(&server);
+    mbedtls_ssl_config_free(&client_conf);
+    mbedtls_ssl_config_free(&server_conf);
+
+    return (res == 0) ? 0 : 1;
+}
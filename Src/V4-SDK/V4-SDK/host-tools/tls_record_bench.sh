@@ -0,0 +1,62 @@
+#!/bin/bash
+#
+# 以几种AES表的选择和Encrypt-then-MAC的分块长度编译tls_record_bench, 输出aes.o占用的flash/RAM、
+# AES表的初始化耗时以及各记录长度下单条TLS记录的加密/解密耗时, 用法:
+#
+#     bash host-tools/tls_record_bench.sh <output_dir> [count]
+#
+# aes.o的大小使用AIOT_CC以-Os编译得到, 交叉编译时即为目标平台上的大小; flash为text+data, RAM为data+bss.
+# 耗时总是在主机上测量, 单位为微秒, 每格为 加密/解密
+
+if [ "${1}" = "" ];then
+    exit 1
+fi
+
+OBJDIR=${1}/tls_record_bench
+COUNT=${2:-50}
+HOST_CC=gcc
+TARGET_CC=${AIOT_CC:-gcc}
+TARGET_SIZE=${TARGET_CC%gcc}size
+INC="-Iexternal/mbedtls/include"
+
+mkdir -p ${OBJDIR}
+
+aes_size() {
+    ${TARGET_SIZE} ${1} | sed '1d' | awk '{ printf "%6u / %6u bytes", $1 + $2, $2 + $3 }'
+}
+
+bench() {
+    local name=${1} flags=${2} mac=${3} mode=${4}
+    local obj=${OBJDIR}/aes_${name}.o
+    local size="" line=""
+
+    ${TARGET_CC} -Os -c ${INC} ${flags} -o ${obj} external/mbedtls/library/aes.c || return 1
+    size=$(aes_size ${obj})
+
+    ${HOST_CC} -O2 -DMBEDTLS_SSL_SRV_C ${INC} ${flags} -o ${OBJDIR}/tls_record_bench_${name} \
+        host-tools/tls_record_bench.c external/mbedtls/library/*.c || return 1
+    line=$(${OBJDIR}/tls_record_bench_${name} ${name} ${mac} ${mode} ${COUNT}) || { echo "${line}"; return 1; }
+    echo "${line} ${size} |"
+}
+
+HEADER="|    init   |     64 B      |     256 B     |    1024 B     |    4096 B     |    16384 B    |  aes.o flash / RAM    |"
+
+RES=0
+echo ""
+echo "    |    aes     |  mac   | mac ${HEADER}"
+bench ram_4 "" sha1 etm || RES=1
+bench rom_4 "-DMBEDTLS_AES_ROM_TABLES" sha1 etm || RES=1
+bench ram_1 "-DMBEDTLS_AES_FEWER_TABLES" sha1 etm || RES=1
+bench rom_1 "-DMBEDTLS_AES_FEWER_TABLES -DMBEDTLS_AES_ROM_TABLES" sha1 etm || RES=1
+bench ram_sbox "-DMBEDTLS_AES_SBOX_ONLY" sha1 etm || RES=1
+bench rom_sbox "-DMBEDTLS_AES_SBOX_ONLY -DMBEDTLS_AES_ROM_TABLES" sha1 etm || RES=1
+echo ""
+echo "    |   record   |  mac   | mac ${HEADER}"
+for MAC in sha1 sha256; do
+    bench ram_4 "" ${MAC} mte || RES=1
+    bench two_pass "-DMBEDTLS_SSL_ETM_CHUNK_LEN=16384" ${MAC} etm || RES=1
+    bench fused "" ${MAC} etm || RES=1
+done
+echo ""
+
+exit ${RES}
@@ -0,0 +1,217 @@
+/**
+ * @file tls_resume_bench.c
+ * @brief 在主机上比较linux对接层中完整TLS握手和会话恢复的耗时与传输字节数, 由tls_resume_bench.sh启动本地测试服务器后运行
+ *
+ * 编译:
+ *     gcc -O2 -Icore -Icore/sysdep -Icore/utils -Ihost-tools -Iexternal/mbedtls/include -o tls_resume_bench \
+ *         host-tools/tls_resume_bench.c host-tools/tls_bench_relay.c portfiles/aiot_port/aiot_port.c \
+ *         external/mbedtls/library/\*.c -lpthread
+ *
+ * 用法:
+ *     ./tls_resume_bench <server_port> <server_cert.pem> [rtt_ms] [count]
+ *
+ * 连接经过一个本地中继转发到测试服务器, 中继统计每次握手两个方向的字节数, 并在每次换向时延迟rtt_ms/2,
+ * 用来模拟蜂窝网络的往返时延. 依次测量:
+ *     full      每次连接前清空会话缓存, 总是完整握手
+ *     resumed   使用RAM中的会话缓存
+ *     persisted 每次连接前清空RAM中的缓存(模拟重启), 从持久化槽位中恢复
+ * full必须都是完整握手, resumed和persisted必须都恢复了会话, 否则返回1. 最后换一份CA证书连接同一服务器,
+ * 必须不恢复之前的会话(恢复的会话不再校验证书)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "aiot_state_api.h"
+#include "aiot_sysdep_api.h"
+#include "tls_bench_relay.h"
+
+#define TLS_RESUME_BENCH_STORE_MAXLEN   (512)
+
+typedef struct {
+    int32_t (*save)(const uint8_t *data, uint32_t len);
+    int32_t (*load)(uint8_t *data, uint32_t len);
+} tls_resume_bench_store_t;
+
+extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
+extern void core_sysdep_tls_session_set_store(tls_resume_bench_store_t *store);
+extern void core_sysdep_tls_session_clear(void);
+
+static tls_bench_relay_t g_tls_resume_bench_relay;
+static uint8_t g_tls_resume_bench_slot[TLS_RESUME_BENCH_STORE_MAXLEN];
+static uint32_t g_tls_resume_bench_slot_len;
+
+static int32_t _tls_resume_bench_save(const uint8_t *data, uint32_t len)
+{
+    if (len > sizeof(g_tls_resume_bench_slot)) {
+        return -1;
+    }
+    memcpy(g_tls_resume_bench_slot, data, len);
+    g_tls_resume_bench_slot_len = len;
+    return 0;
+}
+
+static int32_t _tls_resume_bench_load(uint8_t *data, uint32_t len)
+{
+    if (g_tls_resume_bench_slot_len == 0 || g_tls_resume_bench_slot_len > len) {
+        return 0;
+    }
+    memcpy(data, g_tls_resume_bench_slot, g_tls_resume_bench_slot_len);
+    return (int32_t)g_tls_resume_bench_slot_len;
+}
+
+static tls_resume_bench_store_t g_tls_resume_bench_store = {
+    _tls_resume_bench_save,
+    _tls_resume_bench_load,
+};
+
+static double _tls_resume_bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* 成功时返回是否恢复了会话 */
+static int32_t _tls_resume_bench_connect(aiot_sysdep_network_cred_t *cred)
+{
+    aiot_sysdep_portfile_t *sysdep = &g_aiot_sysdep_portfile;
+    core_sysdep_socket_type_t socket_type = CORE_SYSDEP_SOCKET_TCP_CLIENT;
+    core_sysdep_handshake_stats_t stats;
+    uint32_t timeout_ms = 5000;
+    void *network = NULL;
+    int32_t res = STATE_SUCCESS;
+
+    network = sysdep->core_sysdep_network_init();
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_SOCKET_TYPE, &socket_type);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_HOST, "127.0.0.1");
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_PORT, &g_tls_resume_bench_relay.relay_port);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_CONNECT_TIMEOUT_MS, &timeout_ms);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_CRED, cred);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_HANDSHAKE_STATS, &stats);
+    res = sysdep->core_sysdep_network_establish(network);
+    sysdep->core_sysdep_network_deinit(&network);
+
+    return (res < STATE_SUCCESS) ? res : stats.resumed;
+}
+
+static int32_t _tls_resume_bench_run(const char *name, aiot_sysdep_network_cred_t *cred, uint32_t count)
+{
+    double elapsed = 0, total = 0;
+    uint32_t idx = 0;
+    int32_t res = 0;
+
+    /* 先建立一次连接, 保证缓存和持久化槽位中都有会话 */
+    core_sysdep_tls_session_clear();
+    if (_tls_resume_bench_connect(cred) < 0) {
+        return -1;
+    }
+    usleep(20 * 1000);
+
+    tls_bench_relay_reset(&g_tls_resume_bench_relay);
+    for (idx = 0; idx < count; idx++) {
+        if (strcmp(name, "resumed") != 0) {
+            core_sysdep_tls_session_clear();
+        }
+        core_sysdep_tls_session_set_store((strcmp(name, "persisted") == 0) ? &g_tls_resume_bench_store : NULL);
+        elapsed = _tls_resume_bench_now();
+        res = _tls_resume_bench_connect(cred);
+        if (res < 0) {
+            return -1;
+        }
+        total += _tls_resume_bench_now() - elapsed;
+        if (res != ((strcmp(name, "full") == 0) ? 0 : 1)) {
+            printf("%s: connection %u %s\n", name, idx + 1, res ? "resumed a session" : "did a full handshake");
+            return -1;
+        }
+
+        /* 等中继看到连接关闭 */
+        usleep(20 * 1000);
+    }
+    core_sysdep_tls_session_set_store(&g_tls_resume_bench_store);
+
+    printf("    | %-9s | %8.1f ms | %6llu bytes up | %6llu bytes down | %4.1f flights |\n", name,
+           total * 1000 / count, (long long unsigned int)g_tls_resume_bench_relay.bytes_up / count,
+           (long long unsigned int)g_tls_resume_bench_relay.bytes_down / count,
+           (double)g_tls_resume_bench_relay.flights / count);
+    return 0;
+}
+
+/* CA证书的内容不同时不能恢复用原来的CA建立的会话 */
+static int32_t _tls_resume_bench_other_ca(aiot_sysdep_network_cred_t *cred, const char *cert, size_t cert_len)
+{
+    static char other[8192 + 1];
+    aiot_sysdep_network_cred_t other_cred;
+
+    /* 多一个换行, 解析出同一张证书, 但作为凭据是另一份 */
+    memcpy(other, cert, cert_len);
+    other[cert_len] = '\n';
+    memcpy(&other_cred, cred, sizeof(aiot_sysdep_network_cred_t));
+    other_cred.x509_server_cert = other;
+    other_cred.x509_server_cert_len = cert_len + 1;
+
+    core_sysdep_tls_session_clear();
+    if (_tls_resume_bench_connect(cred) < 0) {
+        return -1;
+    }
+    usleep(20 * 1000);
+    if (_tls_resume_bench_connect(&other_cred) != 0) {
+        printf("other ca: resumed a session negotiated with another ca\n");
+        return -1;
+    }
+    usleep(20 * 1000);
+    printf("    | other ca  | full handshake |\n");
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    aiot_sysdep_network_cred_t cred;
+    static char cert[8192];
+    uint32_t count = 0;
+    size_t cert_len = 0;
+    FILE *fp = NULL;
+
+    if (argc < 3) {
+        printf("usage: %s <server_port> <server_cert.pem> [rtt_ms] [count]\n", argv[0]);
+        return 1;
+    }
+    g_tls_resume_bench_relay.server_port = (uint16_t)atoi(argv[1]);
+    g_tls_resume_bench_relay.rtt_ms = (argc > 3) ? (uint32_t)atoi(argv[3]) : 0;
+    count = (argc > 4) ? (uint32_t)atoi(argv[4]) : 20;
+
+    fp = fopen(argv[2], "r");
+    if (fp == NULL) {
+        perror(argv[2]);
+        return 1;
+    }
+    cert_len = fread(cert, 1, sizeof(cert) - 1, fp);
+    fclose(fp);
+
+    memset(&cred, 0, sizeof(cred));
+    cred.option = AIOT_SYSDEP_NETWORK_CRED_SVRCERT_RSA;
+    cred.max_tls_fragment = 16384;
+    cred.x509_server_cert = cert;
+    cred.x509_server_cert_len = cert_len;
+
+    if (tls_bench_relay_start(&g_tls_resume_bench_relay) < 0) {
+        return 1;
+    }
+    core_sysdep_tls_session_set_store(&g_tls_resume_bench_store);
+
+    if (_tls_resume_bench_run("full", &cred, count) < 0 ||
+        _tls_resume_bench_run("resumed", &cred, count) < 0 ||
+        _tls_resume_bench_run("persisted", &cred, count) < 0 ||
+        _tls_resume_bench_other_ca(&cred, cert, cert_len) < 0) {
+        printf("handshake failed\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,38 @@
+#!/bin/bash
+#
+# 用openssl s_server在本地起一个TLS1.2测试服务器, 比较完整握手和会话恢复的耗时与字节数, 用法:
+#
+#     bash host-tools/tls_resume_bench.sh <output_dir> [rtt_ms]
+#
+# 树中的mbedtls只带客户端, 所以测试服务器使用openssl; 服务器证书为临时生成的RSA 2048自签名证书
+
+if [ "${1}" = "" ];then
+    exit 1
+fi
+
+OBJDIR=${1}/tls_resume_bench
+RTT_MS=${2:-0}
+PORT=${TLS_RESUME_BENCH_PORT:-18443}
+INC="-Icore -Icore/sysdep -Icore/utils -Ihost-tools -Iexternal/mbedtls/include"
+
+mkdir -p ${OBJDIR}
+
+openssl req -x509 -newkey rsa:2048 -nodes -keyout ${OBJDIR}/key.pem -out ${OBJDIR}/cert.pem -days 1 \
+    -subj "/CN=localhost" > /dev/null 2>&1 || exit 1
+gcc -O2 ${INC} -o ${OBJDIR}/tls_resume_bench host-tools/tls_resume_bench.c host-tools/tls_bench_relay.c \
+    portfiles/aiot_port/aiot_port.c \
+    external/mbedtls/library/*.c -lpthread || exit 1
+
+sleep 3600 | openssl s_server -accept 127.0.0.1:${PORT} -tls1_2 -cipher 'AES128-SHA256:AES256-SHA256:AES128-SHA:AES256-SHA' \
+    -cert ${OBJDIR}/cert.pem -key ${OBJDIR}/key.pem -quiet > /dev/null 2>&1 &
+SERVER=$!
+sleep 1
+
+echo ""
+echo "    rtt: ${RTT_MS} ms"
+${OBJDIR}/tls_resume_bench ${PORT} ${OBJDIR}/cert.pem ${RTT_MS} | grep '^    |\|failed'
+RES=${PIPESTATUS[0]}
+echo ""
+
+kill ${SERVER} $(jobs -p) > /dev/null 2>&1
+exit ${RES}
@@ -19,6 +19,8 @@ extern "C" {
 #define STATE_AT_BASE                                              (-0x1000)
 #define STATE_AT_RINGBUF_OVERRUN                                   (STATE_AT_BASE - 0x0001)
 #define STATE_AT_LOG_RINGBUF_OVERRUN                               (STATE_AT_BASE - 0x0002)
+#define STATE_AT_UNKNOWN_SOCKET_ID                                 (STATE_AT_BASE - 0x0003)
+#define STATE_AT_SEND_QUEUE_FULL                                   (STATE_AT_BASE - 0x0004)
 
 /**
  * @brief SDK调用 @ref aiot_at_send_connect_handler_t 函数时的第三个参数，用于建立网络连接
@@ -61,6 +63,9 @@ typedef enum {
      *
      * @details
      *
+     * 建议直接使用模组的数字link id, 例如"0", "1". 数字形式的标识符(小于8)在绑定时登记到索引表中,
+     * @ref aiot_at_input 收到数据时按下标直接找到at句柄, 不做字符串比较和内存分配
+     *
      * 数据类型: (char *)
      */
     AIOT_ATOPT_SOCKET_ID,
@@ -71,9 +76,49 @@ typedef enum {
      *
      * 用户为at句柄配置的ring buffer长度，该缓冲区用于保存从 @ref aiot_at_input 输入的 @ref AIOT_ATRECVOPT_BUF 类型网络数据
      *
+     * 缓冲区中最多保存ring buffer长度减1个字节，参见 @ref aiot_at_peek
+     *
      * 数据类型: (uint32_t *) 默认值: (1024) bytes
      */
     AIOT_ATOPT_RING_BUF_LEN,
+    /**
+     * @brief ring buffer允许扩大到的最大长度
+     *
+     * @details
+     *
+     * 空闲空间放不下输入的数据或模组中待读取的数据时, ring buffer按倍数扩大, 但不超过此长度. 数据读空后恢复为
+     * @ref AIOT_ATOPT_RING_BUF_LEN 配置的长度. 配置为0或不大于 @ref AIOT_ATOPT_RING_BUF_LEN 时不扩大
+     *
+     * 数据类型: (uint32_t *) 默认值: (0) bytes
+     */
+    AIOT_ATOPT_RING_BUF_MAX_LEN,
+    /**
+     * @brief 每次调用 @ref aiot_at_send_buf_handler_t 最多发送的字节数
+     *
+     * @details
+     *
+     * 较大的数据会分多次发送, 每次发送之间其它socket的数据可以占用uart, 例如OTA下载期间上报的消息不必等待整段数据发完.
+     * 每次发送都需要一个 @ref AIOT_ATRECVOPT_SEND_RESP 应答. 配置为0表示不拆分
+     *
+     * 数据类型: (uint32_t *) 默认值: (1024) bytes
+     */
+    AIOT_ATOPT_SEND_CHUNK_LEN,
+    /**
+     * @brief at句柄上有数据或应答到达时的通知回调, 更多信息请参考 @ref aiot_at_event_handler_t
+     *
+     * @details
+     *
+     * 数据类型: (aiot_at_event_handler_t)
+     */
+    AIOT_ATOPT_EVENT_HANDLER,
+    /**
+     * @brief 用户的上下文指针, 作为 @ref aiot_at_event_handler_t 的userdata参数传回
+     *
+     * @details
+     *
+     * 数据类型: (void *)
+     */
+    AIOT_ATOPT_USERDATA,
     AIOT_ATOPT_MAX
 } aiot_at_option_t;
 
@@ -142,6 +187,10 @@ typedef enum {
      *
      * @details
      *
+     * 应答按socket分别记录. 模组的应答不带socket标识时, socket_id传入NULL, SDK按发送的先后顺序将应答匹配到对应的socket
+     *
+     * 同一个socket有多次发送时, 所有发送都得到应答后 @ref aiot_at_recv 才会读到该应答. 其中任何一次应答不为1时, 读到的是第一次失败的应答
+     *
      * 数据类型: (uint8_t *)
      */
     AIOT_ATRECVOPT_SEND_RESP,
@@ -164,9 +213,48 @@ typedef enum {
      * 数据类型
      */
     AIOT_ATRECVOPT_DISCONNECT_RESP,
+    /**
+     * @brief 模组通知socket上有数据到达, 数据缓存在模组中等待读取
+     *
+     * @details
+     *
+     * 用于模组的按需读取模式(收到数据时只上报URC, 再由MCU发送指令读取指定长度), 需要配置 @ref aiot_at_send_read_handler_t.
+     * SDK根据ring buffer的空闲空间调用 @ref aiot_at_send_read_handler_t, 不会因缓冲区已满而丢弃数据
+     *
+     * 传入模组中缓存的该socket的字节数. URC中不带长度时, 可传入一个足够大的值, 由 @ref AIOT_ATRECVOPT_READ_RESP 修正.
+     * SDK在下一次 @ref aiot_at_recv 或 @ref aiot_at_commit 时发出读取请求, 可以在事件回调中唤醒消费者
+     *
+     * 数据类型: (uint32_t *)
+     */
+    AIOT_ATRECVOPT_DATA_AVAILABLE,
+    /**
+     * @brief 一次读取指令的应答已结束, 读到的数据已通过 @ref AIOT_ATRECVOPT_BUF 输入
+     *
+     * @details
+     *
+     * 传入读取之后模组中仍缓存的字节数, 不为0时SDK在缓冲区有空闲时继续读取
+     *
+     * 数据类型: (uint32_t *)
+     */
+    AIOT_ATRECVOPT_READ_RESP,
     AIOT_ATRECVOPT_MAX
 } aiot_at_recv_option_t;
 
+/**
+ * @brief at句柄上有新的网络数据或应答到达时调用此回调函数
+ *
+ * @details
+ *
+ * 在 @ref aiot_at_input 将数据写入at句柄之后, 于调用 @ref aiot_at_input 的任务中被调用
+ *
+ * portfile可以在此回调中释放信号量或者发送任务通知, 唤醒阻塞等待 @ref aiot_at_recv 结果的任务, 以代替定时轮询
+ *
+ * @param[out] handle 收到数据的at句柄
+ * @param[out] option 到达的数据类型, 更多信息请参考 @ref aiot_at_recv_option_t
+ * @param[out] userdata 用户通过 @ref AIOT_ATOPT_USERDATA 配置的上下文
+ */
+typedef void (*aiot_at_event_handler_t)(void *handle, aiot_at_recv_option_t option, void *userdata);
+
 /**
  * @brief SDK需要建立网络连接时调用此回调函数
  *
@@ -223,6 +311,28 @@ typedef int32_t (*aiot_at_send_buf_handler_t)(char *socket_id, aiot_at_buf_t *bu
  */
 typedef int32_t (*aiot_at_send_disconnect_handler_t)(char *socket_id);
 
+/**
+ * @brief SDK需要从模组读取缓存的网络数据时调用此回调函数
+ *
+ * @details
+ *
+ * 用户应按照模组的AT指令规范发送读取指令, 例如读取最多len字节. 读到的数据通过 @ref AIOT_ATRECVOPT_BUF 输入,
+ * 应答结束后通过 @ref AIOT_ATRECVOPT_READ_RESP 输入模组中剩余的字节数
+ *
+ * len不超过ring buffer当前的空闲空间. 同一个socket同时最多只有一个读取请求. 此函数与其它发送回调互斥调用,
+ * 只在调用 @ref aiot_at_recv 或 @ref aiot_at_commit 的任务中被调用, 不会在 @ref aiot_at_input 中被调用,
+ * 不能在函数内等待应答
+ *
+ * @param[out] socket_id 在 @ref aiot_at_send_connect_handler_t 被调用时用户分配的socket字符串标识符
+ * @param[out] len 本次最多读取的字节数
+ *
+ * @return int32_t
+ *
+ * @retval <0 发送失败
+ * @retval >=0 发送成功
+ */
+typedef int32_t (*aiot_at_send_read_handler_t)(char *socket_id, uint32_t len);
+
 /**
  * @brief SDK需要发送指令或数据至模组时，调用的回调函数
  *
@@ -244,8 +354,42 @@ typedef struct {
      * @brief SDK需要断开网络连接时调用此函数
      */
     aiot_at_send_disconnect_handler_t disconnect_handler;
+    /**
+     * @brief SDK需要从模组读取缓存的网络数据时调用此函数, 可为NULL
+     *
+     * @details
+     *
+     * 为NULL时, 模组主动上报的网络数据直接通过 @ref AIOT_ATRECVOPT_BUF 输入, 缓冲区满时多出的数据被丢弃
+     */
+    aiot_at_send_read_handler_t read_handler;
 } aiot_at_send_handler_t;
 
+/**
+ * @brief at句柄接收方向的统计数据, 通过 @ref aiot_at_get_stats 获取
+ */
+typedef struct {
+    /**
+     * @brief ring buffer已满, 输入的数据被丢弃的次数
+     */
+    uint32_t overrun_count;
+    /**
+     * @brief 被丢弃的字节数
+     */
+    uint32_t overrun_bytes;
+    /**
+     * @brief 调用 @ref aiot_at_send_read_handler_t 的次数
+     */
+    uint32_t read_requests;
+    /**
+     * @brief ring buffer当前的长度
+     */
+    uint32_t ringbuf_len;
+    /**
+     * @brief ring buffer中曾经同时保存的最多字节数
+     */
+    uint32_t ringbuf_high_water;
+} aiot_at_stats_t;
+
 /**
  * @brief 设置SDK需要的发送回调函数
  *
@@ -312,6 +456,55 @@ int32_t aiot_at_send(void *handle, aiot_at_send_option_t option, void *data);
  */
 int32_t aiot_at_recv(void *handle, aiot_at_recv_option_t option, void *data);
 
+/**
+ * @brief 不拷贝地查看缓存中的网络数据，与 @ref aiot_at_commit 配合使用
+ *
+ * @details
+ *
+ * 网络数据保存在环形缓存中，绕回缓存起始处时会分为两段。span[0]为较早收到的一段，span[1]为绕回后的一段，
+ *
+ * 长度可能为0。调用者可以直接在缓存上解析或计算摘要，处理完之后调用 @ref aiot_at_commit 释放已处理的字节
+ *
+ * 在 @ref aiot_at_commit 之前，span指向的数据不会被 @ref aiot_at_input 覆盖，但不能与 @ref aiot_at_recv 的
+ *
+ * @ref AIOT_ATRECVOPT_BUF 选项在不同任务中同时使用，也不能在期间重新配置 @ref AIOT_ATOPT_RING_BUF_LEN
+ *
+ * @param handle at句柄
+ * @param span 输出，最多两段连续的数据
+ *
+ * @return int32_t
+ *
+ * @retval <STATE_SUCCESS 查看失败
+ * @retval >=0 缓存中可读的总字节数，即span[0].len + span[1].len
+ */
+int32_t aiot_at_peek(void *handle, aiot_at_buf_t span[2]);
+
+/**
+ * @brief 从缓存中释放 @ref aiot_at_peek 查看过的前len个字节
+ *
+ * @param handle at句柄
+ * @param len 释放的字节数，不能超过缓存中可读的字节数
+ *
+ * @return int32_t
+ *
+ * @retval STATE_SUCCESS 释放成功
+ * @retval STATE_USER_INPUT_OUT_RANGE len超过缓存中可读的字节数
+ */
+int32_t aiot_at_commit(void *handle, uint32_t len);
+
+/**
+ * @brief 获取at句柄接收方向的统计数据
+ *
+ * @param handle at句柄
+ * @param stats 输出，更多信息请参考 @ref aiot_at_stats_t
+ *
+ * @return int32_t
+ *
+ * @retval <STATE_SUCCESS 获取失败
+ * @retval STATE_SUCCESS 获取成功
+ */
+int32_t aiot_at_get_stats(void *handle, aiot_at_stats_t *stats);
+
 /**
  * @brief 销毁at句柄，此函数应在portfile中调用
  *
@@ -355,6 +548,10 @@ int32_t aiot_at_setopt(void *handle, aiot_at_option_t option, void *data);
  *
  * 3. 断开网络连接的应答，通过 @ref AIOT_ATRECVOPT_DISCONNECT_RESP 选项输入至SDK
  *
+ * 使用模组的按需读取模式时，数据到达的URC和读取应答的结束分别通过 @ref AIOT_ATRECVOPT_DATA_AVAILABLE 和
+ *
+ * @ref AIOT_ATRECVOPT_READ_RESP 选项输入至SDK
+ *
  * @param socket_id 在 @ref aiot_at_send_connect_handler_t 被调用时用户分配的socket字符串标识符
  * @param option 接收的数据类型选项，更多信息请参考 @ref aiot_at_recv_option_t
  * @param data 接收到的数据，更多信息请参考 @ref aiot_at_recv_option_t
@@ -363,6 +560,7 @@ int32_t aiot_at_setopt(void *handle, aiot_at_option_t option, void *data);
  *
  * @retval <STATE_SUCCESS 操作成功
  * @retval >=STATE_SUCCESS 操作失败
+ * @retval STATE_AT_UNKNOWN_SOCKET_ID 没有与socket_id对应的at句柄
  */
 int32_t aiot_at_input(char *socket_id, aiot_at_recv_option_t option, void *data);
 
@@ -0,0 +1,292 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "cu_test.h"
+#include "aiot_state_api.h"
+#include "aiot_sysdep_api.h"
+
+/* 位于portfiles/aiot_port文件夹下的系统适配函数集合 */
+extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
+
+#define CASE_ESTABLISH_TIMEOUT_MS   (300)
+
+/*
+ *  本地的假TLS服务端: 接受一条连接, 读完ClientHello所在的记录后按mode处理
+ *
+ *  - 保持连接但不应答, 直到测试从socketpair的另一端写入一个字节
+ *  - 立即关闭连接
+ *
+ *  读到的ClientHello字节数也经socketpair告知测试, 测试据此等待服务端收完ClientHello, 不依赖睡眠的时长
+ */
+#define CASE_SERVER_MODE_SILENT     (0)
+#define CASE_SERVER_MODE_CLOSE      (1)
+
+typedef struct {
+    int listen_fd;
+    int ctrl[2];            /* [0]归测试, [1]归服务端线程 */
+    uint16_t port;
+    uint8_t mode;
+    pthread_t thread;
+} case_server_t;
+
+DATA(PORTFILES_ESTABLISH)
+{
+    aiot_sysdep_portfile_t *sysdep;
+    case_server_t server;
+    core_sysdep_handshake_stats_t stats;
+    void *network;
+};
+
+static int32_t case_server_read(int fd, uint8_t *buffer, uint32_t len)
+{
+    uint32_t pos = 0;
+    ssize_t res = 0;
+
+    while (pos < len) {
+        res = recv(fd, buffer + pos, len - pos, 0);
+        if (res <= 0) {
+            return -1;
+        }
+        pos += res;
+    }
+
+    return 0;
+}
+
+static void *case_server_thread(void *arg)
+{
+    case_server_t *server = (case_server_t *)arg;
+    uint8_t header[5], body[2048], cmd = 0;
+    uint32_t len = 0;
+    int fd = -1;
+
+    fd = accept(server->listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (case_server_read(fd, header, sizeof(header)) == 0 && header[0] == 0x16) {
+        len = ((uint32_t)header[3] << 8) | header[4];
+        if (len > sizeof(body) || case_server_read(fd, body, len) < 0) {
+            len = 0;
+        } else {
+            len += sizeof(header);
+        }
+    }
+    write(server->ctrl[1], &len, sizeof(len));
+
+    if (server->mode == CASE_SERVER_MODE_SILENT) {
+        read(server->ctrl[1], &cmd, sizeof(cmd));
+    }
+    close(fd);
+
+    return NULL;
+}
+
+static int32_t case_server_start(case_server_t *server, uint8_t mode)
+{
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+
+    server->mode = mode;
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (server->listen_fd < 0 || bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(server->listen_fd, 1) < 0 || getsockname(server->listen_fd, (struct sockaddr *)&addr, &addr_len) < 0 ||
+        socketpair(AF_UNIX, SOCK_STREAM, 0, server->ctrl) < 0) {
+        return -1;
+    }
+    server->port = ntohs(addr.sin_port);
+
+    return pthread_create(&server->thread, NULL, case_server_thread, server);
+}
+
+static void case_server_stop(case_server_t *server)
+{
+    uint8_t cmd = 0;
+
+    if (server->listen_fd <= 0) {
+        return;
+    }
+    /* 服务端线程可能还阻塞在accept上 */
+    shutdown(server->listen_fd, SHUT_RDWR);
+    write(server->ctrl[0], &cmd, sizeof(cmd));
+    pthread_join(server->thread, NULL);
+    close(server->listen_fd);
+    close(server->ctrl[0]);
+    close(server->ctrl[1]);
+    server->listen_fd = 0;
+}
+
+/* 服务端收完ClientHello时返回它的字节数, 还没有收完时返回0 */
+static uint32_t case_server_clienthello(case_server_t *server)
+{
+    uint32_t len = 0;
+
+    if (recv(server->ctrl[0], &len, sizeof(len), MSG_DONTWAIT) != sizeof(len)) {
+        return 0;
+    }
+
+    return len;
+}
+
+static uint64_t case_establish_now_ms(void)
+{
+    struct timeval time;
+
+    gettimeofday(&time, NULL);
+    return (uint64_t)time.tv_sec * 1000 + time.tv_usec / 1000;
+}
+
+static void *case_establish_network(aiot_sysdep_portfile_t *sysdep, uint16_t port, uint8_t nonblock,
+                                    core_sysdep_handshake_stats_t *stats)
+{
+    core_sysdep_socket_type_t socket_type = CORE_SYSDEP_SOCKET_TCP_CLIENT;
+    aiot_sysdep_network_cred_t cred;
+    core_sysdep_psk_t psk;
+    uint32_t timeout_ms = CASE_ESTABLISH_TIMEOUT_MS;
+    void *network = NULL;
+
+    memset(&cred, 0, sizeof(cred));
+    cred.option = AIOT_SYSDEP_NETWORK_CRED_SVRCERT_PSK;
+    cred.max_tls_fragment = 16384;
+    psk.psk_id = "case_establish";
+    psk.psk = "00112233445566778899aabbccddeeff";
+
+    network = sysdep->core_sysdep_network_init();
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_SOCKET_TYPE, &socket_type);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_HOST, "127.0.0.1");
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_PORT, &port);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_CONNECT_TIMEOUT_MS, &timeout_ms);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_CRED, &cred);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_PSK, &psk);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_NONBLOCK, &nonblock);
+    sysdep->core_sysdep_network_setopt(network, CORE_SYSDEP_NETWORK_HANDSHAKE_STATS, stats);
+
+    return network;
+}
+
+SETUP(PORTFILES_ESTABLISH)
+{
+    aiot_sysdep_set_portfile(&g_aiot_sysdep_portfile);
+    data->sysdep = &g_aiot_sysdep_portfile;
+    memset(&data->server, 0, sizeof(case_server_t));
+    memset(&data->stats, 0, sizeof(core_sysdep_handshake_stats_t));
+    data->network = NULL;
+}
+
+TEARDOWN(PORTFILES_ESTABLISH)
+{
+    if (data->network != NULL) {
+        data->sysdep->core_sysdep_network_deinit(&data->network);
+    }
+    case_server_stop(&data->server);
+}
+
+/* 非阻塞模式下发出ClientHello后立即返回, 服务端不应答时每次调用都不等待, 直到没有进展超过超时时间 */
+CASEs(PORTFILES_ESTABLISH, case_01_nonblock_yield_and_timeout)
+{
+    uint32_t clienthello = 0, calls = 0;
+    uint64_t start = 0, elapsed = 0;
+    int32_t res = 0;
+
+    ASSERT_EQ(case_server_start(&data->server, CASE_SERVER_MODE_SILENT), 0);
+    data->network = case_establish_network(data->sysdep, data->server.port, 1, &data->stats);
+
+    start = case_establish_now_ms();
+    while ((res = data->sysdep->core_sysdep_network_establish(data->network)) ==
+           STATE_PORT_NETWORK_ESTABLISH_IN_PROGRESS) {
+        calls++;
+        if (clienthello == 0) {
+            clienthello = case_server_clienthello(&data->server);
+        }
+        usleep(1000);
+    }
+    elapsed = case_establish_now_ms() - start;
+    printf("calls: %u, max step: %u us, clienthello: %u bytes\n", calls, data->stats.max_step_us, clienthello);
+
+    ASSERT_EQ(res, STATE_PORT_NETWORK_CONNECT_TIMEOUT);
+    ASSERT_GE(elapsed, CASE_ESTABLISH_TIMEOUT_MS);
+    ASSERT_GT(calls, 10);
+    ASSERT_EQ(data->stats.yields, calls);
+
+    /* 只有ClientHello一个flight, 字节数与服务端收到的一致 */
+    ASSERT_GT(clienthello, 0);
+    ASSERT_EQ(data->stats.flight_num, 1);
+    ASSERT_EQ(data->stats.flight[0].outbound, 1);
+    ASSERT_EQ(data->stats.flight[0].bytes, clienthello);
+    ASSERT_GT(data->stats.steps, 0);
+
+    /* 失败后再次调用返回同一个错误码 */
+    ASSERT_EQ(data->sysdep->core_sysdep_network_establish(data->network), STATE_PORT_NETWORK_CONNECT_TIMEOUT);
+}
+
+/* 阻塞模式下在对接层内部等待, 超时判定与非阻塞模式一致 */
+CASEs(PORTFILES_ESTABLISH, case_02_blocking_timeout)
+{
+    uint64_t start = 0, elapsed = 0;
+
+    ASSERT_EQ(case_server_start(&data->server, CASE_SERVER_MODE_SILENT), 0);
+    data->network = case_establish_network(data->sysdep, data->server.port, 0, &data->stats);
+
+    start = case_establish_now_ms();
+    ASSERT_EQ(data->sysdep->core_sysdep_network_establish(data->network), STATE_PORT_NETWORK_CONNECT_TIMEOUT);
+    elapsed = case_establish_now_ms() - start;
+
+    ASSERT_GE(elapsed, CASE_ESTABLISH_TIMEOUT_MS);
+    ASSERT_LT(elapsed, CASE_ESTABLISH_TIMEOUT_MS * 3);
+    ASSERT_GE(data->stats.yields, 1);
+    ASSERT_EQ(data->stats.flight_num, 1);
+    ASSERT_GT(case_server_clienthello(&data->server), 0);
+}
+
+/* 服务端在握手中途关闭连接 */
+CASEs(PORTFILES_ESTABLISH, case_03_peer_close)
+{
+    int32_t res = 0;
+
+    ASSERT_EQ(case_server_start(&data->server, CASE_SERVER_MODE_CLOSE), 0);
+    data->network = case_establish_network(data->sysdep, data->server.port, 1, &data->stats);
+
+    while ((res = data->sysdep->core_sysdep_network_establish(data->network)) ==
+           STATE_PORT_NETWORK_ESTABLISH_IN_PROGRESS) {
+        usleep(1000);
+    }
+    ASSERT_EQ(res, STATE_PORT_TLS_INVALID_HANDSHAKE);
+    ASSERT_EQ(data->stats.flight[0].outbound, 1);
+}
+
+/* 端口上没有监听时, 非阻塞的连接失败也经由返回值报告 */
+CASEs(PORTFILES_ESTABLISH, case_04_connect_refused)
+{
+    int32_t res = 0;
+    uint16_t port = 0;
+
+    ASSERT_EQ(case_server_start(&data->server, CASE_SERVER_MODE_CLOSE), 0);
+    port = data->server.port;
+    case_server_stop(&data->server);
+    data->network = case_establish_network(data->sysdep, port, 1, &data->stats);
+
+    while ((res = data->sysdep->core_sysdep_network_establish(data->network)) ==
+           STATE_PORT_NETWORK_ESTABLISH_IN_PROGRESS) {
+        usleep(1000);
+    }
+    ASSERT_EQ(res, STATE_PORT_TLS_SOCKET_CONNECT_FAILED);
+    ASSERT_EQ(data->stats.flight_num, 0);
+}
+
+SUITE(PORTFILES_ESTABLISH) = {
+    ADD_CASE(PORTFILES_ESTABLISH, case_01_nonblock_yield_and_timeout),
+    ADD_CASE(PORTFILES_ESTABLISH, case_02_blocking_timeout),
+    ADD_CASE(PORTFILES_ESTABLISH, case_03_peer_close),
+    ADD_CASE(PORTFILES_ESTABLISH, case_04_connect_refused),
+    ADD_CASE_NULL
+};
@@ -0,0 +1,231 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "cu_test.h"
+#include "aiot_state_api.h"
+#include "aiot_sysdep_api.h"
+#include "mbedtls/ctr_drbg.h"
+
+/* 位于portfiles/aiot_port文件夹下的系统适配函数集合 */
+extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
+extern void core_sysdep_rand_get_stats(uint32_t *reseeds, uint32_t *reseed_deferred);
+
+#define CASE_RAND_FIPS_BYTES        (2500)
+#define CASE_RAND_CHI_BYTES         (1024 * 1024)
+#define CASE_RAND_THREAD_NUM        (4)
+#define CASE_RAND_THREAD_BLOCKS     (1000)
+
+DATA(PORTFILES_RAND)
+{
+    aiot_sysdep_portfile_t *sysdep;
+};
+
+SETUP(PORTFILES_RAND)
+{
+    aiot_sysdep_set_portfile(&g_aiot_sysdep_portfile);
+    data->sysdep = &g_aiot_sysdep_portfile;
+}
+
+TEARDOWN(PORTFILES_RAND)
+{
+}
+
+static const uint8_t g_case_01_entropy[64] = {
+    0x5a, 0x19, 0x4d, 0x5e, 0x2b, 0x31, 0x58, 0x14, 0x54, 0xde, 0xf6, 0x75, 0xfb, 0x79, 0x58, 0xfe,
+    0xc7, 0xdb, 0x87, 0x3e, 0x56, 0x89, 0xfc, 0x9d, 0x03, 0x21, 0x7c, 0x68, 0xd8, 0x03, 0x38, 0x20,
+    0xf9, 0xe6, 0x5e, 0x04, 0xd8, 0x56, 0xf3, 0xa9, 0xc4, 0x4a, 0x4c, 0xbd, 0xc1, 0xd0, 0x08, 0x46,
+    0xf5, 0x98, 0x3d, 0x77, 0x1c, 0x1b, 0x13, 0x7e, 0x4e, 0x0f, 0x9d, 0x8e, 0xf4, 0x09, 0xf9, 0x2e
+};
+static const uint8_t g_case_01_nonce[16] = {
+    0x1b, 0x54, 0xb8, 0xff, 0x06, 0x42, 0xbf, 0xf5, 0x21, 0xf1, 0x5c, 0x1c, 0x0b, 0x66, 0x5f, 0x3f
+};
+static const uint8_t g_case_01_result[16] = {
+    0xa0, 0x54, 0x30, 0x3d, 0x8a, 0x7e, 0xa9, 0x88, 0x9d, 0x90, 0x3e, 0x07, 0x7c, 0x6f, 0x21, 0x8f
+};
+
+/* 与对接层的熵池一样, 每次播种取走下一份熵 */
+static int case_01_entropy(void *data, unsigned char *output, size_t len)
+{
+    uint32_t *offset = (uint32_t *)data;
+
+    if (*offset + len > sizeof(g_case_01_entropy)) {
+        return MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED;
+    }
+    memcpy(output, &g_case_01_entropy[*offset], len);
+    *offset += len;
+
+    return 0;
+}
+
+/* NIST CTR_DRBG(PR = FALSE)的已知答案, 按对接层的调用顺序: 播种, 生成, 从熵池重新播种, 生成 */
+CASEs(PORTFILES_RAND, case_01_ctr_drbg_known_answer)
+{
+    mbedtls_ctr_drbg_context ctx;
+    uint32_t offset = 0;
+    uint8_t out[16];
+
+    mbedtls_ctr_drbg_init(&ctx);
+    ASSERT_EQ(mbedtls_ctr_drbg_seed_entropy_len(&ctx, case_01_entropy, &offset, g_case_01_nonce,
+              sizeof(g_case_01_nonce), 32), 0);
+    ASSERT_EQ(mbedtls_ctr_drbg_random(&ctx, out, sizeof(out)), 0);
+    ASSERT_EQ(mbedtls_ctr_drbg_reseed(&ctx, NULL, 0), 0);
+    ASSERT_EQ(mbedtls_ctr_drbg_random(&ctx, out, sizeof(out)), 0);
+    ASSERT_EQ(memcmp(out, g_case_01_result, sizeof(out)), 0);
+
+    /* 熵池为空时重新播种失败, 对接层此时推迟重新播种 */
+    ASSERT_EQ(mbedtls_ctr_drbg_reseed(&ctx, NULL, 0), MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED);
+    mbedtls_ctr_drbg_free(&ctx);
+}
+
+/* FIPS 140-2的四项统计检验, 每项取20000比特 */
+CASEs(PORTFILES_RAND, case_02_fips_140_2)
+{
+    uint8_t sample[CASE_RAND_FIPS_BYTES];
+    uint32_t idx = 0, bit = 0, ones = 0, poker[16] = {0}, runs[2][7] = {{0}}, run = 0, longest = 0;
+    uint8_t prev = 2, cur = 0;
+    double poker_x = 0;
+
+    data->sysdep->core_sysdep_rand(sample, sizeof(sample));
+
+    for (idx = 0; idx < sizeof(sample); idx++) {
+        poker[sample[idx] >> 4]++;
+        poker[sample[idx] & 0x0F]++;
+        for (bit = 0; bit < 8; bit++) {
+            cur = (sample[idx] >> bit) & 0x01;
+            ones += cur;
+            if (cur == prev) {
+                run++;
+                continue;
+            }
+            if (prev != 2) {
+                runs[prev][(run > 6) ? 6 : run]++;
+                longest = (run > longest) ? run : longest;
+            }
+            prev = cur;
+            run = 1;
+        }
+    }
+    runs[prev][(run > 6) ? 6 : run]++;
+    longest = (run > longest) ? run : longest;
+
+    /* monobit */
+    ASSERT_GT(ones, 9725);
+    ASSERT_LT(ones, 10275);
+
+    /* poker */
+    for (idx = 0; idx < 16; idx++) {
+        poker_x += (double)poker[idx] * poker[idx];
+    }
+    poker_x = 16.0 / 5000 * poker_x - 5000;
+    ASSERT_GT(poker_x * 100, 216);
+    ASSERT_LT(poker_x * 100, 4617);
+
+    /* runs */
+    for (idx = 0; idx < 2; idx++) {
+        ASSERT_IN(2315, runs[idx][1], 2685);
+        ASSERT_IN(1114, runs[idx][2], 1386);
+        ASSERT_IN(527, runs[idx][3], 723);
+        ASSERT_IN(240, runs[idx][4], 384);
+        ASSERT_IN(103, runs[idx][5], 209);
+        ASSERT_IN(103, runs[idx][6], 209);
+    }
+
+    /* long run */
+    ASSERT_LT(longest, 26);
+}
+
+/* 以各种请求长度取1MB, 字节分布的卡方值(255自由度)在p=0.0001的临界值以内 */
+CASEs(PORTFILES_RAND, case_03_byte_distribution)
+{
+    static uint8_t sample[CASE_RAND_CHI_BYTES];
+    const uint32_t lens[] = {1, 3, 16, 32, 48, 1000, 4096};
+    uint32_t count[256] = {0}, idx = 0, pos = 0, len = 0;
+    double expected = CASE_RAND_CHI_BYTES / 256.0, chi = 0;
+
+    for (pos = 0; pos < CASE_RAND_CHI_BYTES; pos += len, idx++) {
+        len = lens[idx % (sizeof(lens) / sizeof(lens[0]))];
+        len = (len > CASE_RAND_CHI_BYTES - pos) ? CASE_RAND_CHI_BYTES - pos : len;
+        data->sysdep->core_sysdep_rand(&sample[pos], len);
+    }
+
+    for (idx = 0; idx < CASE_RAND_CHI_BYTES; idx++) {
+        count[sample[idx]]++;
+    }
+    for (idx = 0; idx < 256; idx++) {
+        chi += (count[idx] - expected) * (count[idx] - expected) / expected;
+    }
+    printf("chi-square: %.1f\n", chi);
+    ASSERT_LT(chi, 347.0);
+}
+
+/* 后台线程采集的熵持续被用于重新播种 */
+CASEs(PORTFILES_RAND, case_04_background_reseed)
+{
+    uint32_t idx = 0, reseeds_start = 0, reseeds = 0, deferred = 0;
+    uint8_t out[32];
+
+    data->sysdep->core_sysdep_rand(out, sizeof(out));
+    core_sysdep_rand_get_stats(&reseeds_start, NULL);
+
+    for (idx = 0; idx < 16 * 1024; idx++) {
+        data->sysdep->core_sysdep_rand(out, sizeof(out));
+        if ((idx & 0xFF) == 0) {
+            data->sysdep->core_sysdep_sleep(1);
+        }
+    }
+    core_sysdep_rand_get_stats(&reseeds, &deferred);
+    printf("reseeds: %u, deferred: %u\n", reseeds - reseeds_start, deferred);
+
+    ASSERT_GE(reseeds - reseeds_start, 8);
+}
+
+static int case_05_block_cmp(const void *a, const void *b)
+{
+    return memcmp(a, b, 16);
+}
+
+static void *case_05_rand_thread(void *arg)
+{
+    uint8_t *blocks = (uint8_t *)arg;
+    uint32_t idx = 0;
+
+    for (idx = 0; idx < CASE_RAND_THREAD_BLOCKS; idx++) {
+        g_aiot_sysdep_portfile.core_sysdep_rand(&blocks[idx * 16], 16);
+    }
+
+    return NULL;
+}
+
+/* 多个线程同时取随机数, 输出没有重复 */
+CASEs(PORTFILES_RAND, case_05_concurrent_unique)
+{
+    static uint8_t blocks[CASE_RAND_THREAD_NUM * CASE_RAND_THREAD_BLOCKS * 16];
+    pthread_t thread[CASE_RAND_THREAD_NUM];
+    uint32_t idx = 0, dup = 0;
+
+    for (idx = 0; idx < CASE_RAND_THREAD_NUM; idx++) {
+        ASSERT_EQ(pthread_create(&thread[idx], NULL, case_05_rand_thread,
+                                 &blocks[idx * CASE_RAND_THREAD_BLOCKS * 16]), 0);
+    }
+    for (idx = 0; idx < CASE_RAND_THREAD_NUM; idx++) {
+        pthread_join(thread[idx], NULL);
+    }
+
+    qsort(blocks, CASE_RAND_THREAD_NUM * CASE_RAND_THREAD_BLOCKS, 16, case_05_block_cmp);
+    for (idx = 1; idx < CASE_RAND_THREAD_NUM * CASE_RAND_THREAD_BLOCKS; idx++) {
+        if (memcmp(&blocks[(idx - 1) * 16], &blocks[idx * 16], 16) == 0) {
+            dup++;
+        }
+    }
+    ASSERT_EQ(dup, 0);
+}
+
+SUITE(PORTFILES_RAND) = {
+    ADD_CASE(PORTFILES_RAND, case_01_ctr_drbg_known_answer),
+    ADD_CASE(PORTFILES_RAND, case_02_fips_140_2),
+    ADD_CASE(PORTFILES_RAND, case_03_byte_distribution),
+    ADD_CASE(PORTFILES_RAND, case_04_background_reseed),
+    ADD_CASE(PORTFILES_RAND, case_05_concurrent_unique),
+    ADD_CASE_NULL
+};
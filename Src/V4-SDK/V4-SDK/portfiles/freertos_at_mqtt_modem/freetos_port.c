@@ -15,10 +15,13 @@
 #endif
 #include <errno.h>
 #include "core_list.h"
+#include "core_mempool.h"
 #include "aiot_state_api.h"
 #include "aiot_sysdep_api.h"
 #include "FreeRTOS.h"
+#include "task.h"
 #include "semphr.h"
+#include "core_tls_arena.h"
 /*
  *  CORE_SYSDEP_MBEDTLS_ENABLED 不是一个用户需要关心的编译开关
  *
@@ -36,18 +39,39 @@
     #include "mbedtls/net_sockets.h"
     #include "mbedtls/ssl.h"
     #include "mbedtls/ctr_drbg.h"
+    #include "mbedtls/sha256.h"
     #include "mbedtls/debug.h"
     #include "mbedtls/platform.h"
 #endif
 
 #ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+typedef struct {
+    uint8_t type;
+    const char *source;         /* 证书的地址和长度 */
+    uint32_t source_len;
+    const char *key_source;     /* 私钥的地址和长度, 仅设备证书 */
+    uint32_t key_source_len;
+} core_sysdep_tls_cred_key_t;
+
+/* 解析后的TLS凭据, 由凭据缓存管理, 见 _core_sysdep_tls_cred_acquire */
+typedef struct {
+    core_sysdep_tls_cred_key_t key;
+    uint32_t refcnt;
+    uint32_t last_used;
+    uint32_t mem_used;
+    mbedtls_x509_crt crt;
+    mbedtls_pk_context pk;
+} core_sysdep_tls_cred_t;
+
 typedef struct {
     mbedtls_net_context net_ctx;
     mbedtls_ssl_context ssl_ctx;
     mbedtls_ssl_config  ssl_config;
-    mbedtls_x509_crt    x509_server_cert;
-    mbedtls_x509_crt    x509_client_cert;
-    mbedtls_pk_context  x509_client_pk;
+    core_sysdep_tls_cred_t *ca_cred;
+    core_sysdep_tls_cred_t *client_cred;
+    uint8_t session_offered;
+    uint8_t session_master[48];
+    uint8_t session_cred_id[32];    /* 会话缓存按 host:port 和凭据查找, 见 _core_sysdep_tls_session_cred_id */
 } core_sysdep_mbedtls_t;
 #endif
 
@@ -65,77 +89,99 @@ typedef struct {
 } core_network_handle_t;
 
 #ifdef CORE_SYSDEP_MBEDTLS_ENABLED
-#define MBEDTLS_MEM_INFO_MAGIC  (0x12345678)
+/*
+ *  mbedtls使用的静态内存区长度, TLS的内存都从这里分配, 不占用configTOTAL_HEAP_SIZE
+ *
+ *  没有默认值, 必须按目标板的RAM在编译时指定, 取值参考 host-tools/tls_arena_bench.sh 测得的各阶段峰值
+ */
+#ifndef CORE_SYSDEP_TLS_ARENA_LEN
+#error "CORE_SYSDEP_TLS_ARENA_LEN is not set, size it for the target RAM with host-tools/tls_arena_bench.sh"
+#elif CORE_SYSDEP_TLS_ARENA_LEN < MBEDTLS_SSL_IN_CONTENT_LEN + MBEDTLS_SSL_OUT_CONTENT_LEN
+#error "CORE_SYSDEP_TLS_ARENA_LEN cannot hold the TLS record buffers"
+#endif
 
-static unsigned int g_mbedtls_total_mem_used = 0;
-static unsigned int g_mbedtls_max_mem_used = 0;
+static uint64_t g_core_sysdep_tls_arena_buf[CORE_SYSDEP_TLS_ARENA_LEN / sizeof(uint64_t)];
+static core_tls_arena_t g_core_sysdep_tls_arena;
+static uint8_t g_core_sysdep_tls_arena_inited = 0;
 
-typedef struct {
-    int magic;
-    int size;
-} mbedtls_mem_info_t;
+static void _core_sysdep_tls_arena_init(void)
+{
+    if (g_core_sysdep_tls_arena_inited == 0) {
+        core_tls_arena_init(&g_core_sysdep_tls_arena, g_core_sysdep_tls_arena_buf, sizeof(g_core_sysdep_tls_arena_buf));
+        g_core_sysdep_tls_arena_inited = 1;
+    }
+}
 
 static void *_core_mbedtls_calloc(size_t n, size_t size)
 {
-    unsigned char *buf = NULL;
-    mbedtls_mem_info_t *mem_info = NULL;
+    void *ptr = NULL;
 
-    if (n == 0 || size == 0) {
+    if ((uint32_t)n != n || (uint32_t)size != size) {
         return NULL;
     }
 
-    buf = (unsigned char *)malloc(n * size + sizeof(mbedtls_mem_info_t));
-    if (NULL == buf) {
-        return NULL;
-    } else {
-        memset(buf, 0, n * size + sizeof(mbedtls_mem_info_t));
-    }
-
-    mem_info = (mbedtls_mem_info_t *)buf;
-    mem_info->magic = MBEDTLS_MEM_INFO_MAGIC;
-    mem_info->size = n * size;
-    buf += sizeof(mbedtls_mem_info_t);
-
-    g_mbedtls_total_mem_used += mem_info->size;
-    if (g_mbedtls_total_mem_used > g_mbedtls_max_mem_used) {
-        g_mbedtls_max_mem_used = g_mbedtls_total_mem_used;
-    }
-
-    /* printf("INFO -- mbedtls malloc: %p %d  total used: %d  max used: %d\r\n",
-                       buf, (int)size, g_mbedtls_total_mem_used, g_mbedtls_max_mem_used); */
+    vTaskSuspendAll();
+    _core_sysdep_tls_arena_init();
+    ptr = core_tls_arena_calloc(&g_core_sysdep_tls_arena, (uint32_t)n, (uint32_t)size);
+    (void)xTaskResumeAll();
 
-    return buf;
+    return ptr;
 }
 
 static void _core_mbedtls_free(void *ptr)
 {
-    mbedtls_mem_info_t *mem_info = NULL;
-    if (NULL == ptr) {
+    if (ptr == NULL) {
         return;
     }
 
-    mem_info = (mbedtls_mem_info_t *)((unsigned char *)ptr - sizeof(mbedtls_mem_info_t));
-    if (mem_info->magic != MBEDTLS_MEM_INFO_MAGIC) {
-        printf("Warning - invalid mem info magic: 0x%x\r\n", mem_info->magic);
-        return;
-    }
+    vTaskSuspendAll();
+    core_tls_arena_free(&g_core_sysdep_tls_arena, ptr);
+    (void)xTaskResumeAll();
+}
 
-    g_mbedtls_total_mem_used -= mem_info->size;
-    /* printf("INFO -- mbedtls free: %p %d  total used: %d  max used: %d\r\n",
-                       ptr, mem_info->size, g_mbedtls_total_mem_used, g_mbedtls_max_mem_used); */
+static void _core_sysdep_tls_arena_set_phase(core_tls_arena_phase_t phase)
+{
+    vTaskSuspendAll();
+    _core_sysdep_tls_arena_init();
+    core_tls_arena_set_phase(&g_core_sysdep_tls_arena, phase);
+    (void)xTaskResumeAll();
+}
 
-    free(mem_info);
+/* TLS内存区的用量, 含最近一次建立连接时各阶段的峰值, 用于调整CORE_SYSDEP_TLS_ARENA_LEN */
+void core_sysdep_tls_arena_get_stats(core_tls_arena_stats_t *stats)
+{
+    vTaskSuspendAll();
+    _core_sysdep_tls_arena_init();
+    core_tls_arena_get_stats(&g_core_sysdep_tls_arena, stats);
+    (void)xTaskResumeAll();
 }
 #endif
 
+/* SDK的小块内存先从按模块划分的内存池中分配, 避免长时间运行后configTOTAL_HEAP_SIZE的堆碎片化, 内存池用完时再使用系统堆 */
 void *core_sysdep_malloc(uint32_t size, char *name)
 {
-    return pvPortMalloc(size);
+    void *ptr = NULL;
+
+    vTaskSuspendAll();
+    ptr = core_mempool_malloc(size, name);
+    (void)xTaskResumeAll();
+    if (ptr == NULL) {
+        ptr = pvPortMalloc(size);
+    }
+
+    return ptr;
 }
 
 void core_sysdep_free(void *ptr)
 {
-    vPortFree(ptr);
+    uint8_t pooled = 0;
+
+    vTaskSuspendAll();
+    pooled = core_mempool_free(ptr);
+    (void)xTaskResumeAll();
+    if (pooled == 0) {
+        vPortFree(ptr);
+    }
 }
 
 uint64_t core_sysdep_time(void)
@@ -255,13 +301,700 @@ static void _port_uint2str(uint16_t input, char *output)
     } while (i > 0);
 }
 
-void core_sysdep_rand(uint8_t *output, uint32_t output_len);
-static int _mbedtls_random(void *handle, unsigned char *output, size_t output_len)
+void *core_sysdep_mutex_init(void);
+void core_sysdep_mutex_lock(void *mutex);
+void core_sysdep_mutex_unlock(void *mutex);
+
+/* 由板级代码实现, 从硬件随机数发生器、ADC噪声等熵源取output_len字节, 成功返回0. 在持有DRBG互斥锁的任务中调用 */
+extern int32_t core_sysdep_entropy_poll(uint8_t *output, uint32_t output_len);
+
+static mbedtls_ctr_drbg_context g_core_sysdep_drbg;
+static uint8_t g_core_sysdep_drbg_seeded = 0;
+static void *g_core_sysdep_drbg_mutex = NULL;
+
+static int _core_sysdep_drbg_entropy(void *ctx, unsigned char *output, size_t len)
 {
-    core_sysdep_rand(output, output_len);
+    if (core_sysdep_entropy_poll(output, len) != 0) {
+        return MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED;
+    }
+
     return 0;
 }
 
+/*
+ *  TLS和core_sysdep_rand共用一个CTR-DRBG, 与freertos_tcp_modem_port.c相同: 首次使用时播种,
+ *  之后按MBEDTLS_CTR_DRBG_RESEED_INTERVAL从熵源重新播种, 用互斥锁保护, 不挂起调度器
+ */
+static int _core_sysdep_drbg_random(unsigned char *output, size_t output_len)
+{
+    int res = 0;
+    size_t len = 0;
+
+    /* 只有创建互斥锁时挂起调度器 */
+    if (g_core_sysdep_drbg_mutex == NULL) {
+        vTaskSuspendAll();
+        if (g_core_sysdep_drbg_mutex == NULL) {
+            g_core_sysdep_drbg_mutex = core_sysdep_mutex_init();
+        }
+        (void)xTaskResumeAll();
+        if (g_core_sysdep_drbg_mutex == NULL) {
+            return MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED;
+        }
+    }
+
+    core_sysdep_mutex_lock(g_core_sysdep_drbg_mutex);
+    if (g_core_sysdep_drbg_seeded == 0) {
+        mbedtls_platform_set_calloc_free(_core_mbedtls_calloc, _core_mbedtls_free);
+        mbedtls_ctr_drbg_init(&g_core_sysdep_drbg);
+        res = mbedtls_ctr_drbg_seed(&g_core_sysdep_drbg, _core_sysdep_drbg_entropy, NULL,
+                                    (const unsigned char *)"aiot_at_mqtt_tls", strlen("aiot_at_mqtt_tls"));
+        g_core_sysdep_drbg_seeded = (res == 0) ? 1 : 0;
+    }
+    while (res == 0 && output_len > 0) {
+        len = (output_len > MBEDTLS_CTR_DRBG_MAX_REQUEST) ? MBEDTLS_CTR_DRBG_MAX_REQUEST : output_len;
+        res = mbedtls_ctr_drbg_random(&g_core_sysdep_drbg, output, len);
+        output += len;
+        output_len -= len;
+    }
+    core_sysdep_mutex_unlock(g_core_sysdep_drbg_mutex);
+
+    return res;
+}
+
+/* DRBG失败时把错误交给mbedtls, 握手随之失败, 不能带着未填充的随机数继续 */
+static int _mbedtls_random(void *handle, unsigned char *output, size_t output_len)
+{
+    return _core_sysdep_drbg_random(output, output_len);
+}
+
+/*
+ *  TLS凭据缓存, 与aiot_port.c的凭据缓存相同
+ *
+ *  服务端CA证书, 设备证书和私钥只在首次使用时解析一次, 之后重连时直接引用解析结果, 省去每次握手前的base64解码和ASN.1解析.
+ *  证书和私钥按约定位于静态存储区, 按地址和长度查找. PSK没有解析的开销, 仍由各个网络句柄保存
+ *
+ *  - CA证书只在校验时读取, 可以同时被多个连接引用; 设备私钥签名时会更新RSA的盲化参数, 同一时刻只交给一个连接,
+ *    已被占用时另外解析一份
+ *  - 没有连接引用的条目仍然保留, 缓存满时淘汰最久未用的条目, 没有可淘汰的条目时新解析的凭据不进入缓存, 随连接释放;
+ *    core_sysdep_tls_cred_clear 释放所有没有引用的条目
+ *  - 条目与连接一样从TLS内存区分配, 断开连接后仍然占用, CORE_SYSDEP_TLS_ARENA_LEN需要为其留出空间.
+ *    占用的长度由 core_sysdep_tls_cred_get_usage 获取
+ *
+ */
+#define CORE_SYSDEP_TLS_CRED_CACHE_NUM      (2)
+
+#define CORE_SYSDEP_TLS_CRED_CA             (1)
+#define CORE_SYSDEP_TLS_CRED_CLIENT         (2)
+
+static core_sysdep_tls_cred_t *g_core_sysdep_tls_cred[CORE_SYSDEP_TLS_CRED_CACHE_NUM];
+static void *g_core_sysdep_tls_cred_mutex = NULL;
+static uint32_t g_core_sysdep_tls_cred_tick = 0;
+static uint32_t g_core_sysdep_tls_cred_parsed = 0;
+static uint32_t g_core_sysdep_tls_cred_mem_used = 0;
+
+/* 首次使用时创建互斥锁, 只有创建时挂起调度器 */
+static int32_t _core_sysdep_tls_cred_lock(void)
+{
+    if (g_core_sysdep_tls_cred_mutex == NULL) {
+        vTaskSuspendAll();
+        if (g_core_sysdep_tls_cred_mutex == NULL) {
+            g_core_sysdep_tls_cred_mutex = core_sysdep_mutex_init();
+        }
+        (void)xTaskResumeAll();
+        if (g_core_sysdep_tls_cred_mutex == NULL) {
+            return STATE_PORT_MALLOC_FAILED;
+        }
+    }
+    core_sysdep_mutex_lock(g_core_sysdep_tls_cred_mutex);
+
+    return STATE_SUCCESS;
+}
+
+/* 已经解析的凭据数量(含已被淘汰的), 以及缓存条目当前占用的TLS内存区长度 */
+void core_sysdep_tls_cred_get_usage(uint32_t *parsed, uint32_t *mem_used)
+{
+    if (_core_sysdep_tls_cred_lock() < STATE_SUCCESS) {
+        return;
+    }
+    if (parsed != NULL) {
+        *parsed = g_core_sysdep_tls_cred_parsed;
+    }
+    if (mem_used != NULL) {
+        *mem_used = g_core_sysdep_tls_cred_mem_used;
+    }
+    core_sysdep_mutex_unlock(g_core_sysdep_tls_cred_mutex);
+}
+
+static void _core_sysdep_tls_cred_destroy(core_sysdep_tls_cred_t *cred)
+{
+    mbedtls_x509_crt_free(&cred->crt);
+    mbedtls_pk_free(&cred->pk);
+    g_core_sysdep_tls_cred_mem_used -= cred->mem_used;
+    vPortFree(cred);
+}
+
+static int32_t _core_sysdep_tls_cred_parse(core_sysdep_tls_cred_t *cred)
+{
+    core_tls_arena_stats_t stats;
+    uint32_t used = 0;
+    int32_t res = 0;
+
+    core_sysdep_tls_arena_get_stats(&stats);
+    used = stats.used;
+    mbedtls_x509_crt_init(&cred->crt);
+    mbedtls_pk_init(&cred->pk);
+
+    res = mbedtls_x509_crt_parse(&cred->crt, (const unsigned char *)cred->key.source, (size_t)cred->key.source_len + 1);
+    if (res < 0) {
+        if (cred->key.type == CORE_SYSDEP_TLS_CRED_CA) {
+            printf("mbedtls_x509_crt_parse server cert error, res: -0x%04X\n", -res);
+            res = STATE_PORT_TLS_INVALID_SERVER_CERT;
+        } else {
+            printf("mbedtls_x509_crt_parse client cert error, res: -0x%04X\n", -res);
+            res = STATE_PORT_TLS_INVALID_CLIENT_CERT;
+        }
+    } else if (cred->key.type == CORE_SYSDEP_TLS_CRED_CLIENT) {
+        res = mbedtls_pk_parse_key(&cred->pk, (const unsigned char *)cred->key.key_source,
+                                   (size_t)cred->key.key_source_len + 1, NULL, 0);
+        if (res < 0) {
+            printf("mbedtls_pk_parse_key client pk error, res: -0x%04X\n", -res);
+            res = STATE_PORT_TLS_INVALID_CLIENT_KEY;
+        }
+    }
+
+    core_sysdep_tls_arena_get_stats(&stats);
+    cred->mem_used = (stats.used > used) ? stats.used - used : 0;
+    g_core_sysdep_tls_cred_mem_used += cred->mem_used;
+
+    return (res < 0) ? res : STATE_SUCCESS;
+}
+
+static core_sysdep_tls_cred_t *_core_sysdep_tls_cred_find(core_sysdep_tls_cred_key_t *key)
+{
+    core_sysdep_tls_cred_t *cred = NULL;
+    uint32_t idx = 0;
+
+    for (idx = 0; idx < CORE_SYSDEP_TLS_CRED_CACHE_NUM; idx++) {
+        cred = g_core_sysdep_tls_cred[idx];
+        if (cred != NULL && cred->key.type == key->type &&
+            cred->key.source == key->source && cred->key.source_len == key->source_len &&
+            cred->key.key_source == key->key_source && cred->key.key_source_len == key->key_source_len &&
+            (key->type == CORE_SYSDEP_TLS_CRED_CA || cred->refcnt == 0)) {
+            return cred;
+        }
+    }
+
+    return NULL;
+}
+
+/* 放入空槽位或替换最久未用且没有引用的条目, 都没有时不缓存 */
+static void _core_sysdep_tls_cred_insert(core_sysdep_tls_cred_t *cred)
+{
+    core_sysdep_tls_cred_t **victim = NULL;
+    uint32_t idx = 0;
+
+    for (idx = 0; idx < CORE_SYSDEP_TLS_CRED_CACHE_NUM; idx++) {
+        if (g_core_sysdep_tls_cred[idx] == NULL) {
+            g_core_sysdep_tls_cred[idx] = cred;
+            return;
+        }
+        if (g_core_sysdep_tls_cred[idx]->refcnt == 0 &&
+            (victim == NULL || g_core_sysdep_tls_cred[idx]->last_used < (*victim)->last_used)) {
+            victim = &g_core_sysdep_tls_cred[idx];
+        }
+    }
+
+    if (victim != NULL) {
+        _core_sysdep_tls_cred_destroy(*victim);
+        *victim = cred;
+    }
+}
+
+/* 先在缓存中查找, 没有时解析key描述的凭据. 成功时增加引用计数, 由 _core_sysdep_tls_cred_release 释放 */
+static int32_t _core_sysdep_tls_cred_acquire(core_sysdep_tls_cred_key_t *key, core_sysdep_tls_cred_t **cred)
+{
+    core_sysdep_tls_cred_t *found = NULL;
+    int32_t res = STATE_SUCCESS;
+
+    res = _core_sysdep_tls_cred_lock();
+    if (res < STATE_SUCCESS) {
+        return res;
+    }
+    found = _core_sysdep_tls_cred_find(key);
+    if (found == NULL) {
+        found = pvPortMalloc(sizeof(core_sysdep_tls_cred_t));
+        if (found == NULL) {
+            core_sysdep_mutex_unlock(g_core_sysdep_tls_cred_mutex);
+            printf("malloc failed\n");
+            return STATE_PORT_MALLOC_FAILED;
+        }
+        memset(found, 0, sizeof(core_sysdep_tls_cred_t));
+        memcpy(&found->key, key, sizeof(core_sysdep_tls_cred_key_t));
+        res = _core_sysdep_tls_cred_parse(found);
+        g_core_sysdep_tls_cred_parsed++;
+        if (res < STATE_SUCCESS) {
+            _core_sysdep_tls_cred_destroy(found);
+            core_sysdep_mutex_unlock(g_core_sysdep_tls_cred_mutex);
+            return res;
+        }
+        _core_sysdep_tls_cred_insert(found);
+    }
+    found->refcnt++;
+    found->last_used = ++g_core_sysdep_tls_cred_tick;
+    *cred = found;
+    core_sysdep_mutex_unlock(g_core_sysdep_tls_cred_mutex);
+
+    return STATE_SUCCESS;
+}
+
+static void _core_sysdep_tls_cred_release(core_sysdep_tls_cred_t **cred)
+{
+    uint32_t idx = 0;
+
+    if (*cred == NULL) {
+        return;
+    }
+
+    core_sysdep_mutex_lock(g_core_sysdep_tls_cred_mutex);
+    (*cred)->refcnt--;
+    if ((*cred)->refcnt == 0) {
+        for (idx = 0; idx < CORE_SYSDEP_TLS_CRED_CACHE_NUM; idx++) {
+            if (g_core_sysdep_tls_cred[idx] == *cred) {
+                break;
+            }
+        }
+        if (idx == CORE_SYSDEP_TLS_CRED_CACHE_NUM) {
+            _core_sysdep_tls_cred_destroy(*cred);
+        }
+    }
+    core_sysdep_mutex_unlock(g_core_sysdep_tls_cred_mutex);
+    *cred = NULL;
+}
+
+/* 释放缓存中所有没有被连接引用的凭据, 例如更换证书之后 */
+void core_sysdep_tls_cred_clear(void)
+{
+    uint32_t idx = 0;
+
+    if (_core_sysdep_tls_cred_lock() < STATE_SUCCESS) {
+        return;
+    }
+    for (idx = 0; idx < CORE_SYSDEP_TLS_CRED_CACHE_NUM; idx++) {
+        if (g_core_sysdep_tls_cred[idx] != NULL && g_core_sysdep_tls_cred[idx]->refcnt == 0) {
+            _core_sysdep_tls_cred_destroy(g_core_sysdep_tls_cred[idx]);
+            g_core_sysdep_tls_cred[idx] = NULL;
+        }
+    }
+    core_sysdep_mutex_unlock(g_core_sysdep_tls_cred_mutex);
+}
+
+/*
+ *  TLS会话缓存, 与aiot_port.c的会话缓存相同
+ *
+ *  每次握手成功后按 host:port 保存协商出的会话(session id 或 session ticket), 下次连接同一服务器时提供给服务端.
+ *  服务端接受时只需一个往返的简化握手, 省去证书链的传输和校验以及RSA运算; 不接受时自动退回完整握手
+ *
+ *  恢复的会话不再校验服务端证书, 因此会话还要与凭据匹配: 安全选项、CA证书、设备证书和PSK不同的连接不共用会话
+ *
+ *  调用 core_sysdep_tls_session_set_store 设置持久化回调后, 最近一次建立的会话还会写入一个持久化槽位(如flash),
+ *  重启后RAM中的缓存为空时从槽位中恢复. 槽位中包含会话的主密钥, 应保存在外部无法读取的区域
+ *
+ *  - 主机名和ticket从FreeRTOS堆分配, 不占用TLS内存区
+ *  - 读写持久化槽位的缓冲区是静态的, 只在持有互斥锁时使用, 不占用任务栈
+ *
+ */
+#define CORE_SYSDEP_TLS_SESSION_CACHE_NUM       (2)
+#define CORE_SYSDEP_TLS_SESSION_STORE_MAXLEN    (512)
+#define CORE_SYSDEP_TLS_SESSION_STORE_MAGIC     (0x544C5332)
+
+typedef struct {
+    int32_t (*save)(const uint8_t *data, uint32_t len);     /* len为0时表示清除槽位 */
+    int32_t (*load)(uint8_t *data, uint32_t len);           /* 返回读到的字节数, 没有数据时返回0 */
+} core_sysdep_tls_session_store_t;
+
+typedef struct {
+    char *host;
+    uint16_t port;
+    uint8_t cred_id[32];
+    uint64_t last_used;
+    mbedtls_ssl_session session;
+} core_sysdep_tls_session_t;
+
+static core_sysdep_tls_session_t g_core_sysdep_tls_session[CORE_SYSDEP_TLS_SESSION_CACHE_NUM];
+static core_sysdep_tls_session_store_t *g_core_sysdep_tls_session_store = NULL;
+static uint8_t g_core_sysdep_tls_session_buffer[CORE_SYSDEP_TLS_SESSION_STORE_MAXLEN];
+static void *g_core_sysdep_tls_session_mutex = NULL;
+
+/* 首次使用时创建互斥锁, 只有创建时挂起调度器 */
+static int32_t _core_sysdep_tls_session_lock(void)
+{
+    if (g_core_sysdep_tls_session_mutex == NULL) {
+        vTaskSuspendAll();
+        if (g_core_sysdep_tls_session_mutex == NULL) {
+            g_core_sysdep_tls_session_mutex = core_sysdep_mutex_init();
+        }
+        (void)xTaskResumeAll();
+        if (g_core_sysdep_tls_session_mutex == NULL) {
+            return STATE_PORT_MALLOC_FAILED;
+        }
+    }
+    core_sysdep_mutex_lock(g_core_sysdep_tls_session_mutex);
+
+    return STATE_SUCCESS;
+}
+
+/* 缓存中的会话不保留服务端证书 */
+static void _core_sysdep_tls_session_reset(core_sysdep_tls_session_t *slot)
+{
+    if (slot->host != NULL) {
+        vPortFree(slot->host);
+    }
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    if (slot->session.ticket != NULL) {
+        vPortFree(slot->session.ticket);
+    }
+#endif
+    memset(slot, 0, sizeof(core_sysdep_tls_session_t));
+}
+
+/* host不要求以'\0'结尾, 长度由host_len给出 */
+static int32_t _core_sysdep_tls_session_fill(core_sysdep_tls_session_t *slot, const char *host, uint32_t host_len,
+        uint16_t port, const uint8_t cred_id[32], const mbedtls_ssl_session *session)
+{
+    _core_sysdep_tls_session_reset(slot);
+
+    slot->host = pvPortMalloc(host_len + 1);
+    if (slot->host == NULL) {
+        return STATE_PORT_MALLOC_FAILED;
+    }
+    memcpy(slot->host, host, host_len);
+    slot->host[host_len] = '\0';
+    slot->port = port;
+    memcpy(slot->cred_id, cred_id, 32);
+    memcpy(&slot->session, session, sizeof(mbedtls_ssl_session));
+    slot->session.peer_cert = NULL;
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    slot->session.ticket = NULL;
+    if (session->ticket != NULL && session->ticket_len > 0) {
+        slot->session.ticket = pvPortMalloc(session->ticket_len);
+        if (slot->session.ticket == NULL) {
+            _core_sysdep_tls_session_reset(slot);
+            return STATE_PORT_MALLOC_FAILED;
+        }
+        memcpy(slot->session.ticket, session->ticket, session->ticket_len);
+    }
+#endif
+
+    return STATE_SUCCESS;
+}
+
+/* 凭据的摘要: 安全选项、CA证书、设备证书(不含私钥)和PSK, 私钥由设备证书唯一确定 */
+static void _core_sysdep_tls_session_cred_id(core_network_handle_t *network_handle, uint8_t cred_id[32])
+{
+    mbedtls_sha256_context ctx;
+    aiot_sysdep_network_cred_t *cred = network_handle->cred;
+    uint8_t option = (uint8_t)cred->option;
+
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, &option, 1);
+    if (cred->option == AIOT_SYSDEP_NETWORK_CRED_SVRCERT_RSA) {
+        mbedtls_sha256_update(&ctx, (const unsigned char *)cred->x509_server_cert, cred->x509_server_cert_len);
+        if (network_handle->mbedtls.client_cred != NULL) {
+            mbedtls_sha256_update(&ctx, (const unsigned char *)cred->x509_client_cert, cred->x509_client_cert_len);
+        }
+    } else if (cred->option == AIOT_SYSDEP_NETWORK_CRED_SVRCERT_PSK && network_handle->psk.psk_id != NULL &&
+               network_handle->psk.psk != NULL) {
+        /* 含结尾的'\0', 区分psk_id和psk的边界 */
+        mbedtls_sha256_update(&ctx, (const unsigned char *)network_handle->psk.psk_id,
+                              strlen(network_handle->psk.psk_id) + 1);
+        mbedtls_sha256_update(&ctx, (const unsigned char *)network_handle->psk.psk, strlen(network_handle->psk.psk) + 1);
+    }
+    mbedtls_sha256_finish(&ctx, cred_id);
+    mbedtls_sha256_free(&ctx);
+}
+
+static uint8_t _core_sysdep_tls_session_match(core_sysdep_tls_session_t *slot, const char *host, uint16_t port,
+        const uint8_t cred_id[32])
+{
+    return (slot->host != NULL && slot->port == port && strcmp(slot->host, host) == 0 &&
+            memcmp(slot->cred_id, cred_id, 32) == 0) ? 1 : 0;
+}
+
+static core_sysdep_tls_session_t *_core_sysdep_tls_session_find(const char *host, uint16_t port,
+        const uint8_t cred_id[32])
+{
+    uint32_t idx = 0;
+
+    for (idx = 0; idx < CORE_SYSDEP_TLS_SESSION_CACHE_NUM; idx++) {
+        if (_core_sysdep_tls_session_match(&g_core_sysdep_tls_session[idx], host, port, cred_id)) {
+            return &g_core_sysdep_tls_session[idx];
+        }
+    }
+
+    return NULL;
+}
+
+static core_sysdep_tls_session_t *_core_sysdep_tls_session_victim(void)
+{
+    core_sysdep_tls_session_t *victim = &g_core_sysdep_tls_session[0];
+    uint32_t idx = 0;
+
+    for (idx = 0; idx < CORE_SYSDEP_TLS_SESSION_CACHE_NUM; idx++) {
+        if (g_core_sysdep_tls_session[idx].host == NULL) {
+            return &g_core_sysdep_tls_session[idx];
+        }
+        if (g_core_sysdep_tls_session[idx].last_used < victim->last_used) {
+            victim = &g_core_sysdep_tls_session[idx];
+        }
+    }
+
+    return victim;
+}
+
+static void _core_sysdep_tls_session_put_u32(uint8_t *buffer, uint32_t value)
+{
+    buffer[0] = (uint8_t)(value >> 24);
+    buffer[1] = (uint8_t)(value >> 16);
+    buffer[2] = (uint8_t)(value >> 8);
+    buffer[3] = (uint8_t)(value);
+}
+
+static uint32_t _core_sysdep_tls_session_get_u32(const uint8_t *buffer)
+{
+    return ((uint32_t)buffer[0] << 24) | ((uint32_t)buffer[1] << 16) | ((uint32_t)buffer[2] << 8) | buffer[3];
+}
+
+/*
+ *  持久化格式与aiot_port.c相同(多字节整数均为大端):
+ *  magic(4) port(2) host_len(1) host cred_id(32) ciphersuite(4) compression(1) id_len(1) id(32) master(48)
+ *  verify_result(4) mfl_code(1) ticket_lifetime(4) ticket_len(2) ticket
+ */
+static uint32_t _core_sysdep_tls_session_serialize(core_sysdep_tls_session_t *slot, uint8_t *buffer, uint32_t len)
+{
+    uint32_t host_len = strlen(slot->host), ticket_len = 0, pos = 0;
+
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    ticket_len = slot->session.ticket_len;
+#endif
+    if (host_len > 255 || 4 + 2 + 1 + host_len + 32 + 4 + 1 + 1 + 32 + 48 + 4 + 1 + 4 + 2 + ticket_len > len) {
+        return 0;
+    }
+
+    _core_sysdep_tls_session_put_u32(&buffer[pos], CORE_SYSDEP_TLS_SESSION_STORE_MAGIC);
+    pos += 4;
+    buffer[pos++] = (uint8_t)(slot->port >> 8);
+    buffer[pos++] = (uint8_t)(slot->port);
+    buffer[pos++] = (uint8_t)host_len;
+    memcpy(&buffer[pos], slot->host, host_len);
+    pos += host_len;
+    memcpy(&buffer[pos], slot->cred_id, 32);
+    pos += 32;
+    _core_sysdep_tls_session_put_u32(&buffer[pos], (uint32_t)slot->session.ciphersuite);
+    pos += 4;
+    buffer[pos++] = (uint8_t)slot->session.compression;
+    buffer[pos++] = (uint8_t)slot->session.id_len;
+    memcpy(&buffer[pos], slot->session.id, 32);
+    pos += 32;
+    memcpy(&buffer[pos], slot->session.master, 48);
+    pos += 48;
+    _core_sysdep_tls_session_put_u32(&buffer[pos], slot->session.verify_result);
+    pos += 4;
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    buffer[pos++] = slot->session.mfl_code;
+#else
+    buffer[pos++] = 0;
+#endif
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    _core_sysdep_tls_session_put_u32(&buffer[pos], slot->session.ticket_lifetime);
+#else
+    _core_sysdep_tls_session_put_u32(&buffer[pos], 0);
+#endif
+    pos += 4;
+    buffer[pos++] = (uint8_t)(ticket_len >> 8);
+    buffer[pos++] = (uint8_t)(ticket_len);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    if (ticket_len > 0) {
+        memcpy(&buffer[pos], slot->session.ticket, ticket_len);
+        pos += ticket_len;
+    }
+#endif
+
+    return pos;
+}
+
+static int32_t _core_sysdep_tls_session_deserialize(core_sysdep_tls_session_t *slot, const uint8_t *buffer,
+        uint32_t len)
+{
+    mbedtls_ssl_session session;
+    const char *host = NULL;
+    const uint8_t *cred_id = NULL;
+    uint32_t host_len = 0, ticket_len = 0, pos = 0;
+    uint16_t port = 0;
+
+    if (len < 7 || _core_sysdep_tls_session_get_u32(buffer) != CORE_SYSDEP_TLS_SESSION_STORE_MAGIC) {
+        return STATE_PORT_INPUT_OUT_RANGE;
+    }
+    port = ((uint16_t)buffer[4] << 8) | buffer[5];
+    host_len = buffer[6];
+    pos = 7;
+    if (pos + host_len + 32 + 4 + 1 + 1 + 32 + 48 + 4 + 1 + 4 + 2 > len) {
+        return STATE_PORT_INPUT_OUT_RANGE;
+    }
+    host = (const char *)&buffer[pos];
+    pos += host_len;
+    cred_id = &buffer[pos];
+    pos += 32;
+
+    memset(&session, 0, sizeof(mbedtls_ssl_session));
+    session.ciphersuite = (int)_core_sysdep_tls_session_get_u32(&buffer[pos]);
+    pos += 4;
+    session.compression = buffer[pos++];
+    session.id_len = buffer[pos++];
+    memcpy(session.id, &buffer[pos], 32);
+    pos += 32;
+    memcpy(session.master, &buffer[pos], 48);
+    pos += 48;
+    session.verify_result = _core_sysdep_tls_session_get_u32(&buffer[pos]);
+    pos += 4;
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    session.mfl_code = buffer[pos];
+#endif
+    pos += 1;
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    session.ticket_lifetime = _core_sysdep_tls_session_get_u32(&buffer[pos]);
+#endif
+    pos += 4;
+    ticket_len = ((uint32_t)buffer[pos] << 8) | buffer[pos + 1];
+    pos += 2;
+    if (session.id_len > 32 || pos + ticket_len > len) {
+        return STATE_PORT_INPUT_OUT_RANGE;
+    }
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    session.ticket = (unsigned char *)&buffer[pos];
+    session.ticket_len = ticket_len;
+#endif
+
+    return _core_sysdep_tls_session_fill(slot, host, host_len, port, cred_id, &session);
+}
+
+void core_sysdep_tls_session_set_store(core_sysdep_tls_session_store_t *store)
+{
+    if (_core_sysdep_tls_session_lock() < STATE_SUCCESS) {
+        return;
+    }
+    g_core_sysdep_tls_session_store = store;
+    core_sysdep_mutex_unlock(g_core_sysdep_tls_session_mutex);
+}
+
+/* 清空RAM中的会话缓存, 持久化槽位不受影响 */
+void core_sysdep_tls_session_clear(void)
+{
+    uint32_t idx = 0;
+
+    if (_core_sysdep_tls_session_lock() < STATE_SUCCESS) {
+        return;
+    }
+    for (idx = 0; idx < CORE_SYSDEP_TLS_SESSION_CACHE_NUM; idx++) {
+        _core_sysdep_tls_session_reset(&g_core_sysdep_tls_session[idx]);
+    }
+    core_sysdep_mutex_unlock(g_core_sysdep_tls_session_mutex);
+}
+
+/* 找到缓存的会话时提供给服务端, 并把主密钥拷贝到master中, 握手后据此判断服务端是否接受了恢复 */
+static uint8_t _core_sysdep_tls_session_offer(core_network_handle_t *network_handle, uint8_t master[48])
+{
+    core_sysdep_tls_session_t *slot = NULL;
+    int32_t len = 0;
+    uint8_t offered = 0;
+
+    _core_sysdep_tls_session_cred_id(network_handle, network_handle->mbedtls.session_cred_id);
+
+    if (_core_sysdep_tls_session_lock() < STATE_SUCCESS) {
+        return 0;
+    }
+    slot = _core_sysdep_tls_session_find(network_handle->host, network_handle->port,
+                                         network_handle->mbedtls.session_cred_id);
+    if (slot == NULL && g_core_sysdep_tls_session_store != NULL) {
+        len = g_core_sysdep_tls_session_store->load(g_core_sysdep_tls_session_buffer,
+                sizeof(g_core_sysdep_tls_session_buffer));
+        if (len > 0) {
+            slot = _core_sysdep_tls_session_victim();
+            if (_core_sysdep_tls_session_deserialize(slot, g_core_sysdep_tls_session_buffer, (uint32_t)len) < 0 ||
+                _core_sysdep_tls_session_match(slot, network_handle->host, network_handle->port,
+                                               network_handle->mbedtls.session_cred_id) == 0) {
+                _core_sysdep_tls_session_reset(slot);
+                slot = NULL;
+            }
+        }
+    }
+    if (slot != NULL && mbedtls_ssl_set_session(&network_handle->mbedtls.ssl_ctx, &slot->session) == 0) {
+        slot->last_used = core_sysdep_time();
+        memcpy(master, slot->session.master, 48);
+        offered = 1;
+    }
+    core_sysdep_mutex_unlock(g_core_sysdep_tls_session_mutex);
+
+    return offered;
+}
+
+static void _core_sysdep_tls_session_save(core_network_handle_t *network_handle)
+{
+    core_sysdep_tls_session_t *slot = NULL;
+    uint32_t len = 0;
+
+    if (_core_sysdep_tls_session_lock() < STATE_SUCCESS) {
+        return;
+    }
+    slot = _core_sysdep_tls_session_find(network_handle->host, network_handle->port,
+                                         network_handle->mbedtls.session_cred_id);
+    if (slot == NULL) {
+        slot = _core_sysdep_tls_session_victim();
+    }
+    if (_core_sysdep_tls_session_fill(slot, network_handle->host, strlen(network_handle->host), network_handle->port,
+                                      network_handle->mbedtls.session_cred_id,
+                                      network_handle->mbedtls.ssl_ctx.session) == STATE_SUCCESS) {
+        slot->last_used = core_sysdep_time();
+        if (g_core_sysdep_tls_session_store != NULL) {
+            len = _core_sysdep_tls_session_serialize(slot, g_core_sysdep_tls_session_buffer,
+                    sizeof(g_core_sysdep_tls_session_buffer));
+            if (len > 0) {
+                g_core_sysdep_tls_session_store->save(g_core_sysdep_tls_session_buffer, len);
+            }
+        }
+    }
+    core_sysdep_mutex_unlock(g_core_sysdep_tls_session_mutex);
+}
+
+/* 用缓存的会话握手失败时丢弃它, 避免每次重连都先失败一次. 持久化槽位只在保存的是同一个会话时清除 */
+static void _core_sysdep_tls_session_drop(core_network_handle_t *network_handle)
+{
+    core_sysdep_tls_session_t *slot = NULL, stored;
+    int32_t len = 0;
+
+    if (_core_sysdep_tls_session_lock() < STATE_SUCCESS) {
+        return;
+    }
+    slot = _core_sysdep_tls_session_find(network_handle->host, network_handle->port,
+                                         network_handle->mbedtls.session_cred_id);
+    if (slot != NULL) {
+        _core_sysdep_tls_session_reset(slot);
+    }
+    if (g_core_sysdep_tls_session_store != NULL) {
+        memset(&stored, 0, sizeof(core_sysdep_tls_session_t));
+        len = g_core_sysdep_tls_session_store->load(g_core_sysdep_tls_session_buffer,
+                sizeof(g_core_sysdep_tls_session_buffer));
+        if (len > 0 &&
+            _core_sysdep_tls_session_deserialize(&stored, g_core_sysdep_tls_session_buffer, (uint32_t)len) == STATE_SUCCESS &&
+            _core_sysdep_tls_session_match(&stored, network_handle->host, network_handle->port,
+                                           network_handle->mbedtls.session_cred_id)) {
+            g_core_sysdep_tls_session_store->save(NULL, 0);
+        }
+        _core_sysdep_tls_session_reset(&stored);
+    }
+    core_sysdep_mutex_unlock(g_core_sysdep_tls_session_mutex);
+}
+
 static void _mbedtls_debug(void *ctx, int level, const char *file, int line, const char *str)
 {
     ((void) level);
@@ -270,7 +1003,7 @@ static void _mbedtls_debug(void *ctx, int level, const char *file, int line, con
     }
 }
 
-static int32_t _core_sysdep_network_mbedtls_establish(core_network_handle_t *network_handle)
+static int32_t _core_sysdep_network_mbedtls_handshake(core_network_handle_t *network_handle)
 {
     int32_t res = 0;
     char port_str[6] = {0};
@@ -282,7 +1015,6 @@ static int32_t _core_sysdep_network_mbedtls_establish(core_network_handle_t *net
     mbedtls_ssl_init(&network_handle->mbedtls.ssl_ctx);
     mbedtls_ssl_config_init(&network_handle->mbedtls.ssl_config);
     mbedtls_platform_set_calloc_free(_core_mbedtls_calloc, _core_mbedtls_free);
-    g_mbedtls_total_mem_used = g_mbedtls_max_mem_used = 0;
 
     if (network_handle->cred->max_tls_fragment == 0) {
         printf("invalid max_tls_fragment parameter\n");
@@ -338,44 +1070,46 @@ static int32_t _core_sysdep_network_mbedtls_establish(core_network_handle_t *net
     mbedtls_ssl_conf_dbg(&network_handle->mbedtls.ssl_config, _mbedtls_debug, stdout);
 
     if (network_handle->cred->option == AIOT_SYSDEP_NETWORK_CRED_SVRCERT_RSA) {
+        core_sysdep_tls_cred_key_t key;
+
         if (network_handle->cred->x509_server_cert == NULL && network_handle->cred->x509_server_cert_len == 0) {
             printf("invalid x509 server cert\n");
             return STATE_PORT_TLS_INVALID_SERVER_CERT;
         }
-        mbedtls_x509_crt_init(&network_handle->mbedtls.x509_server_cert);
 
-        res = mbedtls_x509_crt_parse(&network_handle->mbedtls.x509_server_cert,
-                                     (const unsigned char *)network_handle->cred->x509_server_cert, (size_t)network_handle->cred->x509_server_cert_len + 1);
-        if (res < 0) {
-            printf("mbedtls_x509_crt_parse server cert error, res: -0x%04X\n", -res);
-            return STATE_PORT_TLS_INVALID_SERVER_CERT;
+        if (network_handle->mbedtls.ca_cred == NULL) {
+            memset(&key, 0, sizeof(core_sysdep_tls_cred_key_t));
+            key.type = CORE_SYSDEP_TLS_CRED_CA;
+            key.source = network_handle->cred->x509_server_cert;
+            key.source_len = network_handle->cred->x509_server_cert_len;
+            res = _core_sysdep_tls_cred_acquire(&key, &network_handle->mbedtls.ca_cred);
+            if (res < STATE_SUCCESS) {
+                return res;
+            }
         }
 
         if (network_handle->cred->x509_client_cert != NULL && network_handle->cred->x509_client_cert_len > 0 &&
             network_handle->cred->x509_client_privkey != NULL && network_handle->cred->x509_client_privkey_len > 0) {
-            mbedtls_x509_crt_init(&network_handle->mbedtls.x509_client_cert);
-            mbedtls_pk_init(&network_handle->mbedtls.x509_client_pk);
-            res = mbedtls_x509_crt_parse(&network_handle->mbedtls.x509_client_cert,
-                                         (const unsigned char *)network_handle->cred->x509_client_cert, (size_t)network_handle->cred->x509_client_cert_len + 1);
-            if (res < 0) {
-                printf("mbedtls_x509_crt_parse client cert error, res: -0x%04X\n", -res);
-                return STATE_PORT_TLS_INVALID_CLIENT_CERT;
-            }
-            res = mbedtls_pk_parse_key(&network_handle->mbedtls.x509_client_pk,
-                                       (const unsigned char *)network_handle->cred->x509_client_privkey,
-                                       (size_t)network_handle->cred->x509_client_privkey_len + 1, NULL, 0);
-            if (res < 0) {
-                printf("mbedtls_pk_parse_key client pk error, res: -0x%04X\n", -res);
-                return STATE_PORT_TLS_INVALID_CLIENT_KEY;
+            if (network_handle->mbedtls.client_cred == NULL) {
+                memset(&key, 0, sizeof(core_sysdep_tls_cred_key_t));
+                key.type = CORE_SYSDEP_TLS_CRED_CLIENT;
+                key.source = network_handle->cred->x509_client_cert;
+                key.source_len = network_handle->cred->x509_client_cert_len;
+                key.key_source = network_handle->cred->x509_client_privkey;
+                key.key_source_len = network_handle->cred->x509_client_privkey_len;
+                res = _core_sysdep_tls_cred_acquire(&key, &network_handle->mbedtls.client_cred);
+                if (res < STATE_SUCCESS) {
+                    return res;
+                }
             }
-            res = mbedtls_ssl_conf_own_cert(&network_handle->mbedtls.ssl_config, &network_handle->mbedtls.x509_client_cert,
-                                            &network_handle->mbedtls.x509_client_pk);
+            res = mbedtls_ssl_conf_own_cert(&network_handle->mbedtls.ssl_config, &network_handle->mbedtls.client_cred->crt,
+                                            &network_handle->mbedtls.client_cred->pk);
             if (res < 0) {
                 printf("mbedtls_ssl_conf_own_cert error, res: -0x%04X\n", -res);
                 return STATE_PORT_TLS_INVALID_CLIENT_CERT;
             }
         }
-        mbedtls_ssl_conf_ca_chain(&network_handle->mbedtls.ssl_config, &network_handle->mbedtls.x509_server_cert, NULL);
+        mbedtls_ssl_conf_ca_chain(&network_handle->mbedtls.ssl_config, &network_handle->mbedtls.ca_cred->crt, NULL);
     } else if (network_handle->cred->option == AIOT_SYSDEP_NETWORK_CRED_SVRCERT_PSK) {
         static const int ciphersuites[1] = {MBEDTLS_TLS_PSK_WITH_AES_128_CBC_SHA};
         res = mbedtls_ssl_conf_psk(&network_handle->mbedtls.ssl_config,
@@ -392,6 +1126,7 @@ static int32_t _core_sysdep_network_mbedtls_establish(core_network_handle_t *net
         return STATE_PORT_TLS_INVALID_CRED_OPTION;
     }
 
+    _core_sysdep_tls_arena_set_phase(CORE_TLS_ARENA_PHASE_KEY_EXCHANGE);
     res = mbedtls_ssl_setup(&network_handle->mbedtls.ssl_ctx, &network_handle->mbedtls.ssl_config);
     if (res < 0) {
         printf("mbedtls_ssl_setup error, res: -0x%04X\n", -res);
@@ -401,10 +1136,15 @@ static int32_t _core_sysdep_network_mbedtls_establish(core_network_handle_t *net
     mbedtls_ssl_set_bio(&network_handle->mbedtls.ssl_ctx, &network_handle->mbedtls.net_ctx, mbedtls_net_send,
                         mbedtls_net_recv, mbedtls_net_recv_timeout);
     mbedtls_ssl_conf_read_timeout(&network_handle->mbedtls.ssl_config, network_handle->connect_timeout_ms);
+    network_handle->mbedtls.session_offered = _core_sysdep_tls_session_offer(network_handle,
+            network_handle->mbedtls.session_master);
 
     while ((res = mbedtls_ssl_handshake(&network_handle->mbedtls.ssl_ctx)) != 0) {
         if ((res != MBEDTLS_ERR_SSL_WANT_READ) && (res != MBEDTLS_ERR_SSL_WANT_WRITE)) {
             printf("mbedtls_ssl_handshake error, res: -0x%04X\n", -res);
+            if (network_handle->mbedtls.session_offered) {
+                _core_sysdep_tls_session_drop(network_handle);
+            }
             if (res == MBEDTLS_ERR_SSL_INVALID_RECORD) {
                 res = STATE_PORT_TLS_INVALID_RECORD;
             } else {
@@ -420,9 +1160,42 @@ static int32_t _core_sysdep_network_mbedtls_establish(core_network_handle_t *net
         return res;
     }
 
-    printf("success to establish mbedtls connection, fd = %d(cost %d bytes in total, max used %d bytes)\n",
-           (int)network_handle->mbedtls.net_ctx.fd,
-           g_mbedtls_total_mem_used, g_mbedtls_max_mem_used);
+    if (network_handle->mbedtls.session_offered &&
+        memcmp(network_handle->mbedtls.session_master, network_handle->mbedtls.ssl_ctx.session->master, 48) == 0) {
+        printf("tls session resumed\n");
+    }
+    _core_sysdep_tls_session_save(network_handle);
+
+    return 0;
+}
+
+/* mbedtls在内存区申请失败时报告为各种错误码, 按内存区的失败次数识别出来 */
+static int32_t _core_sysdep_network_mbedtls_establish(core_network_handle_t *network_handle)
+{
+    core_tls_arena_stats_t stats;
+    uint32_t alloc_failed = 0;
+    int32_t res = 0;
+
+    core_sysdep_tls_arena_get_stats(&stats);
+    alloc_failed = stats.alloc_failed;
+    _core_sysdep_tls_arena_set_phase(CORE_TLS_ARENA_PHASE_CERT_PARSE);
+    res = _core_sysdep_network_mbedtls_handshake(network_handle);
+
+    core_sysdep_tls_arena_get_stats(&stats);
+    if (res < STATE_SUCCESS) {
+        if (stats.alloc_failed != alloc_failed) {
+            printf("tls arena exhausted, %u bytes requested, peak %u of %u bytes, increase CORE_SYSDEP_TLS_ARENA_LEN\n",
+                   (unsigned int)stats.failed_len, (unsigned int)stats.peak, (unsigned int)stats.size);
+            res = STATE_PORT_TLS_ARENA_EXHAUSTED;
+        }
+        return res;
+    }
+    _core_sysdep_tls_arena_set_phase(CORE_TLS_ARENA_PHASE_STEADY);
+
+    printf("success to establish mbedtls connection, fd = %d(tls arena peak %u/%u/%u of %u bytes)\n",
+           (int)network_handle->mbedtls.net_ctx.fd, (unsigned int)stats.phase[CORE_TLS_ARENA_PHASE_CERT_PARSE].peak,
+           (unsigned int)stats.phase[CORE_TLS_ARENA_PHASE_KEY_EXCHANGE].peak, (unsigned int)stats.used,
+           (unsigned int)stats.size);
 
     return 0;
 }
@@ -586,26 +1359,63 @@ static void _core_sysdep_network_mbedtls_disconnect(core_network_handle_t *netwo
 {
     mbedtls_ssl_close_notify(&network_handle->mbedtls.ssl_ctx);
     mbedtls_net_free(&network_handle->mbedtls.net_ctx);
-    if (network_handle->cred->option == AIOT_SYSDEP_NETWORK_CRED_SVRCERT_RSA) {
-        mbedtls_x509_crt_free(&network_handle->mbedtls.x509_server_cert);
-        mbedtls_x509_crt_free(&network_handle->mbedtls.x509_client_cert);
-        mbedtls_pk_free(&network_handle->mbedtls.x509_client_pk);
-    }
     mbedtls_ssl_free(&network_handle->mbedtls.ssl_ctx);
     mbedtls_ssl_config_free(&network_handle->mbedtls.ssl_config);
-    g_mbedtls_total_mem_used = g_mbedtls_max_mem_used = 0;
+    _core_sysdep_tls_cred_release(&network_handle->mbedtls.ca_cred);
+    _core_sysdep_tls_cred_release(&network_handle->mbedtls.client_cred);
 }
 #endif
 
+/* TCP连接由AT指令管理, 这里只释放TLS连接和句柄, 释放后缓存的凭据才能被其它连接复用或淘汰 */
 int32_t core_sysdep_network_deinit(void **handle)
 {
-   
+    core_network_handle_t *network_handle = NULL;
+
+    if (handle == NULL || *handle == NULL) {
+        return STATE_PORT_INPUT_NULL_POINTER;
+    }
+    network_handle = *(core_network_handle_t **)handle;
+
+#ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+    if (network_handle->socket_type == CORE_SYSDEP_SOCKET_TCP_CLIENT && network_handle->host != NULL &&
+        network_handle->cred != NULL && network_handle->cred->option != AIOT_SYSDEP_NETWORK_CRED_NONE) {
+        _core_sysdep_network_mbedtls_disconnect(network_handle);
+    }
+    if (network_handle->psk.psk_id != NULL) {
+        free(network_handle->psk.psk_id);
+    }
+    if (network_handle->psk.psk != NULL) {
+        free(network_handle->psk.psk);
+    }
+#endif
+    if (network_handle->host != NULL) {
+        free(network_handle->host);
+    }
+    if (network_handle->cred != NULL) {
+        free(network_handle->cred);
+    }
+    free(network_handle);
+    *handle = NULL;
+
     return 0;
 }
 
 void core_sysdep_rand(uint8_t *output, uint32_t output_len)
 {
-    return;
+    uint32_t idx = 0;
+
+#ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+    /* DRBG不可用时直接从熵源取, 熵源也不可用时退回到rand(), 不能返回固定的输出 */
+    if (_core_sysdep_drbg_random(output, output_len) == 0 || core_sysdep_entropy_poll(output, output_len) == 0) {
+        return;
+    }
+    printf("core_sysdep_rand failed\n");
+#endif
+
+    srand((unsigned int)xTaskGetTickCount() + rand());
+    for (idx = 0; idx < output_len; idx++) {
+        output[idx] = (uint8_t)(rand() >> 7);
+    }
 }
 void *core_sysdep_mutex_init(void)
 {
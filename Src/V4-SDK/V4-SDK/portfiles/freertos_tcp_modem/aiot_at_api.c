@@ -10,107 +10,208 @@
 
 #define CORE_AT_DEFAULT_RINGBUF_LEN (2048)
 
+/* 模组的数字link id上限, 此范围内的socket id在绑定时登记到link_table, aiot_at_input直接按下标查找 */
+#ifndef CORE_AT_LINK_ID_MAX
+#define CORE_AT_LINK_ID_MAX         (8)
+#endif
+#define CORE_AT_LINK_ID_INVALID     (0xFF)
+
+/* 一次发送给模组的最大数据长度, 较大的数据分多次发送, 以便与其它socket的数据交替占用uart */
+#define CORE_AT_DEFAULT_SEND_CHUNK_LEN  (1024)
+/* 所有socket合计最多等待多少个发送应答 */
+#ifndef CORE_AT_PENDING_SEND_MAX
+#define CORE_AT_PENDING_SEND_MAX        (16)
+#endif
+
 typedef struct {
     aiot_sysdep_portfile_t *sysdep;
     char *socket_id;
+    uint8_t link_id;
     uint8_t *ringbuf;
     uint32_t head;
     uint32_t tail;
     uint32_t ringbuf_len;
+    uint32_t ringbuf_base_len;
+    uint32_t ringbuf_max_len;
+    uint32_t peek_len;
+    uint32_t modem_pending;
+    uint32_t read_requested;
+    aiot_at_stats_t stats;
     void *ringbuf_mutex;
     void *data_mutex;
     uint8_t connect_response;
+    uint8_t send_response;
+    uint8_t send_failed;
+    uint8_t send_failure;
     uint8_t disconnect_response;
+    uint32_t send_seq;
+    uint32_t ack_seq;
+    uint32_t send_chunk_len;
+    aiot_at_event_handler_t event_handler;
+    void *userdata;
     struct core_list_head linked_node;
 } core_at_handle_t;
 
 typedef struct {
     struct core_list_head at_handle_list;
-    uint8_t send_response;
     void *mutex;
+    void *send_mutex;
     aiot_at_send_connect_handler_t connect_handler;
     aiot_at_send_buf_handler_t send_handler;
     aiot_at_send_disconnect_handler_t disconnect_handler;
+    aiot_at_send_read_handler_t read_handler;
+    core_at_handle_t *link_table[CORE_AT_LINK_ID_MAX];
+    core_at_handle_t *pending_send[CORE_AT_PENDING_SEND_MAX];
+    uint32_t pending_send_num;
 } core_at_global_t;
 
 core_at_global_t g_at_global = {
     .at_handle_list = {
         .prev = &g_at_global.at_handle_list, .next = &g_at_global.at_handle_list
     },
-    0,
     NULL,
     NULL,
     NULL,
     NULL
 };
 
+/*
+ * 环形缓冲区: head为最后写入的位置, tail为最后读出的位置, (tail, head]之间为未读数据,
+ * head == tail表示为空, 最多保存ringbuf_len - 1字节. 以下函数的调用者需持有ringbuf_mutex
+ */
+static uint32_t _core_at_ringbuf_used(core_at_handle_t *at_handle)
+{
+    if (at_handle->ringbuf == NULL) {
+        return 0;
+    }
+    return (at_handle->head + at_handle->ringbuf_len - at_handle->tail) % at_handle->ringbuf_len;
+}
+
+static uint32_t _core_at_peek_ringbuf(core_at_handle_t *at_handle, aiot_at_buf_t span[2])
+{
+    uint32_t used = _core_at_ringbuf_used(at_handle), start = 0;
+
+    memset(span, 0, 2 * sizeof(aiot_at_buf_t));
+    if (used == 0) {
+        return 0;
+    }
+
+    start = (at_handle->tail + 1) % at_handle->ringbuf_len;
+    span[0].buf = &at_handle->ringbuf[start];
+    span[0].len = (used <= at_handle->ringbuf_len - start) ? used : (at_handle->ringbuf_len - start);
+    span[1].buf = at_handle->ringbuf;
+    span[1].len = used - span[0].len;
+
+    return used;
+}
+
+static void _core_at_commit_ringbuf(core_at_handle_t *at_handle, uint32_t len)
+{
+    at_handle->tail = (at_handle->tail + len) % at_handle->ringbuf_len;
+}
+
+/* 更换为new_len长度的缓冲区, 未读数据搬到新缓冲区的起始处 */
+static int32_t _core_at_resize_ringbuf(core_at_handle_t *at_handle, uint32_t new_len)
+{
+    uint8_t *ringbuf = NULL;
+    uint32_t used = 0;
+    aiot_at_buf_t span[2];
+
+    used = _core_at_peek_ringbuf(at_handle, span);
+    if (new_len <= used) {
+        return STATE_USER_INPUT_OUT_RANGE;
+    }
+
+    ringbuf = at_handle->sysdep->core_sysdep_malloc(new_len, CORE_AT_MODULE_NAME);
+    if (ringbuf == NULL) {
+        return STATE_SYS_DEPEND_MALLOC_FAILED;
+    }
+    memcpy(&ringbuf[1], span[0].buf, span[0].len);
+    memcpy(&ringbuf[1 + span[0].len], span[1].buf, span[1].len);
+
+    at_handle->sysdep->core_sysdep_free(at_handle->ringbuf);
+    at_handle->ringbuf = ringbuf;
+    at_handle->ringbuf_len = new_len;
+    at_handle->tail = 0;
+    at_handle->head = used;
+
+    return STATE_SUCCESS;
+}
+
+/* 空闲空间不足want字节时, 在AIOT_ATOPT_RING_BUF_MAX_LEN的范围内按倍数扩大缓冲区. 查看中的数据不能搬动 */
+static void _core_at_reserve_ringbuf(core_at_handle_t *at_handle, uint32_t want)
+{
+    uint32_t used = _core_at_ringbuf_used(at_handle), new_len = at_handle->ringbuf_len;
+
+    if (at_handle->ringbuf == NULL || at_handle->peek_len > 0 || at_handle->ringbuf_len - 1 - used >= want ||
+        at_handle->ringbuf_len >= at_handle->ringbuf_max_len) {
+        return;
+    }
+
+    while (new_len < at_handle->ringbuf_max_len && new_len - 1 - used < want) {
+        new_len = (new_len > at_handle->ringbuf_max_len / 2) ? at_handle->ringbuf_max_len : new_len * 2;
+    }
+    _core_at_resize_ringbuf(at_handle, new_len);
+}
+
+/* 数据读空且模组中没有待读取的数据时, 恢复为配置的缓冲区长度 */
+static void _core_at_shrink_ringbuf(core_at_handle_t *at_handle)
+{
+    if (at_handle->ringbuf_len > at_handle->ringbuf_base_len && at_handle->peek_len == 0 &&
+        at_handle->modem_pending == 0 && at_handle->read_requested == 0 && _core_at_ringbuf_used(at_handle) == 0) {
+        _core_at_resize_ringbuf(at_handle, at_handle->ringbuf_base_len);
+    }
+}
+
 static int32_t _core_at_read_ringbuf(core_at_handle_t *at_handle, aiot_at_buf_t *buf)
 {
-    uint32_t read_bytes = 0;
-
-    if (at_handle->head == at_handle->tail) {
-        read_bytes = 0;
-    } else if (at_handle->head > at_handle->tail) {
-        read_bytes = (buf->len <= (at_handle->head - at_handle->tail)) ? (buf->len) : (at_handle->head - at_handle->tail);
-
-        memcpy(buf->buf, &at_handle->ringbuf[at_handle->tail + 1], read_bytes);
-        at_handle->tail += read_bytes;
-    } else if (at_handle->head < at_handle->tail) {
-        uint32_t ringbuf_bytes_1st = at_handle->ringbuf_len - at_handle->tail - 1;
-        uint32_t ringbuf_bytes_2nd = at_handle->head + 1;
-
-        read_bytes = (buf->len <= (ringbuf_bytes_1st + ringbuf_bytes_2nd)) ? (buf->len) : ((
-                                 ringbuf_bytes_1st + ringbuf_bytes_2nd));
-        if (read_bytes < ringbuf_bytes_1st) {
-            memcpy(buf->buf, &at_handle->ringbuf[at_handle->tail + 1], read_bytes);
-            at_handle->tail += read_bytes;
-        } else {
-            uint32_t read_bytes_2nd = read_bytes - ringbuf_bytes_1st;
+    uint32_t read_bytes = 0, read_bytes_1st = 0;
+    aiot_at_buf_t span[2];
 
-            memcpy(buf->buf, &at_handle->ringbuf[at_handle->tail + 1], ringbuf_bytes_1st);
-            memcpy(&buf->buf[ringbuf_bytes_1st], at_handle->ringbuf, read_bytes_2nd);
-            at_handle->tail = read_bytes_2nd - 1;
-        }
+    read_bytes = _core_at_peek_ringbuf(at_handle, span);
+    read_bytes = (buf->len < read_bytes) ? buf->len : read_bytes;
+    if (read_bytes == 0) {
+        return 0;
     }
 
+    read_bytes_1st = (read_bytes < span[0].len) ? read_bytes : span[0].len;
+    memcpy(buf->buf, span[0].buf, read_bytes_1st);
+    memcpy(&buf->buf[read_bytes_1st], span[1].buf, read_bytes - read_bytes_1st);
+    _core_at_commit_ringbuf(at_handle, read_bytes);
+
     return read_bytes;
 }
 
 static int32_t _core_at_write_ringbuf(core_at_handle_t *at_handle, aiot_at_buf_t *buf)
 {
-    uint32_t write_bytes = 0;
+    uint32_t write_bytes = 0, write_bytes_1st = 0, start = 0;
 
     if (buf->len == 0) {
         return STATE_USER_INPUT_OUT_RANGE;
     }
 
-    if (at_handle->head < at_handle->tail) {
-        write_bytes = (buf->len <= (at_handle->tail - at_handle->head - 1)) ? (buf->len) : (at_handle->tail - at_handle->head -
-                      1);
+    _core_at_reserve_ringbuf(at_handle, buf->len);
+    if (at_handle->ringbuf != NULL) {
+        write_bytes = at_handle->ringbuf_len - 1 - _core_at_ringbuf_used(at_handle);
+        write_bytes = (buf->len < write_bytes) ? buf->len : write_bytes;
+    }
 
-        if (write_bytes > 0) {
-            memcpy(&at_handle->ringbuf[at_handle->head + 1], buf->buf, write_bytes);
-            at_handle->head += write_bytes - 1;
-        }
-    } else if (at_handle->head >= at_handle->tail) {
-        uint32_t ringbuf_bytes_1st = at_handle->ringbuf_len - at_handle->head - 1;
-        uint32_t ringbuf_bytes_2nd = at_handle->tail - 1;
-
-        write_bytes = (buf->len <= (ringbuf_bytes_1st + ringbuf_bytes_2nd)) ? (buf->len) : ((
-                                  ringbuf_bytes_1st + ringbuf_bytes_2nd));
-        if (write_bytes < ringbuf_bytes_1st) {
-            memcpy(&at_handle->ringbuf[at_handle->head + 1], buf->buf, write_bytes);
-            at_handle->head += write_bytes;
-        } else {
-            uint32_t write_bytes_2nd = write_bytes - ringbuf_bytes_1st;
+    if (write_bytes > 0) {
+        start = (at_handle->head + 1) % at_handle->ringbuf_len;
+        write_bytes_1st = at_handle->ringbuf_len - start;
+        write_bytes_1st = (write_bytes < write_bytes_1st) ? write_bytes : write_bytes_1st;
 
-            memcpy(&at_handle->ringbuf[at_handle->head + 1], buf->buf, ringbuf_bytes_1st);
-            memcpy(at_handle->ringbuf, &buf->buf[ringbuf_bytes_1st], write_bytes_2nd);
-            at_handle->head = (write_bytes_2nd == 0) ? (at_handle->ringbuf_len - 1) : (write_bytes_2nd - 1);
+        memcpy(&at_handle->ringbuf[start], buf->buf, write_bytes_1st);
+        memcpy(at_handle->ringbuf, &buf->buf[write_bytes_1st], write_bytes - write_bytes_1st);
+        at_handle->head = (at_handle->head + write_bytes) % at_handle->ringbuf_len;
+        if (_core_at_ringbuf_used(at_handle) > at_handle->stats.ringbuf_high_water) {
+            at_handle->stats.ringbuf_high_water = _core_at_ringbuf_used(at_handle);
         }
     }
 
     if (write_bytes < buf->len) {
+        at_handle->stats.overrun_count++;
+        at_handle->stats.overrun_bytes += buf->len - write_bytes;
         core_log1(at_handle->sysdep, STATE_AT_LOG_RINGBUF_OVERRUN, "at ringbuf overrun! ringbuf len: %d bytes\r\n",
                   (void *)&at_handle->ringbuf_len);
         if (write_bytes == 0) {
@@ -121,32 +222,182 @@ static int32_t _core_at_write_ringbuf(core_at_handle_t *at_handle, aiot_at_buf_t
     return write_bytes;
 }
 
+/*
+ * 按需读取: 模组缓存着pending的数据, 每次只请求缓冲区能容纳的字节数, 同一时刻最多有一个读取请求.
+ * 读取指令与发送共用uart, 因此在send_mutex中调用read_handler. 发送方持有send_mutex时在等待接收任务解析出的应答,
+ * 所以只能由消费者在aiot_at_recv和aiot_at_commit中调用, aiot_at_input只记录模组中待读取的字节数
+ */
+static void _core_at_request_read(core_at_handle_t *at_handle)
+{
+    int32_t res = STATE_SUCCESS;
+    uint32_t len = 0;
+
+    if (g_at_global.read_handler == NULL) {
+        return;
+    }
+
+    at_handle->sysdep->core_sysdep_mutex_lock(at_handle->ringbuf_mutex);
+    if (at_handle->read_requested == 0 && at_handle->modem_pending > 0 && at_handle->ringbuf != NULL) {
+        _core_at_reserve_ringbuf(at_handle, at_handle->modem_pending);
+        len = at_handle->ringbuf_len - 1 - _core_at_ringbuf_used(at_handle);
+        len = (at_handle->modem_pending < len) ? at_handle->modem_pending : len;
+        at_handle->read_requested = len;
+    }
+    at_handle->sysdep->core_sysdep_mutex_unlock(at_handle->ringbuf_mutex);
+
+    if (len == 0) {
+        return;
+    }
+
+    at_handle->sysdep->core_sysdep_mutex_lock(g_at_global.send_mutex);
+    res = g_at_global.read_handler(at_handle->socket_id, len);
+    at_handle->sysdep->core_sysdep_mutex_unlock(g_at_global.send_mutex);
+
+    at_handle->sysdep->core_sysdep_mutex_lock(at_handle->ringbuf_mutex);
+    if (res < STATE_SUCCESS) {
+        at_handle->read_requested = 0;
+    } else {
+        at_handle->stats.read_requests++;
+    }
+    at_handle->sysdep->core_sysdep_mutex_unlock(at_handle->ringbuf_mutex);
+}
+
+/* 将"0", "1"这类数字形式的socket id解析为link id, 其它形式返回错误 */
+static int32_t _core_at_parse_link_id(const char *socket_id, uint32_t *link_id)
+{
+    uint32_t idx = 0, value = 0;
+
+    for (idx = 0; socket_id[idx] >= '0' && socket_id[idx] <= '9'; idx++) {
+        value = value * 10 + (socket_id[idx] - '0');
+        if (value >= CORE_AT_LINK_ID_MAX) {
+            return STATE_USER_INPUT_OUT_RANGE;
+        }
+    }
+    if (idx == 0 || socket_id[idx] != '\0') {
+        return STATE_USER_INPUT_OUT_RANGE;
+    }
+
+    *link_id = value;
+    return STATE_SUCCESS;
+}
+
+/* 为at句柄绑定socket id, 调用者需持有data_mutex */
+static int32_t _core_at_bind_socket_id(core_at_handle_t *at_handle, char *socket_id)
+{
+    int32_t res = STATE_SUCCESS;
+    uint32_t link_id = 0;
+
+    res = core_strdup(at_handle->sysdep, &at_handle->socket_id, socket_id, CORE_AT_MODULE_NAME);
+    if (res < STATE_SUCCESS) {
+        return res;
+    }
+
+    at_handle->sysdep->core_sysdep_mutex_lock(g_at_global.mutex);
+    if (at_handle->link_id != CORE_AT_LINK_ID_INVALID &&
+        g_at_global.link_table[at_handle->link_id] == at_handle) {
+        g_at_global.link_table[at_handle->link_id] = NULL;
+    }
+    at_handle->link_id = CORE_AT_LINK_ID_INVALID;
+    if (_core_at_parse_link_id(socket_id, &link_id) == STATE_SUCCESS) {
+        g_at_global.link_table[link_id] = at_handle;
+        at_handle->link_id = (uint8_t)link_id;
+    }
+    at_handle->sysdep->core_sysdep_mutex_unlock(g_at_global.mutex);
+
+    return STATE_SUCCESS;
+}
+
+/*
+ * 发送应答的顺序匹配, 以下函数的调用者需持有g_at_global.mutex
+ *
+ * 所有socket共用一个uart, 模组按发送顺序返回应答. pending_send按发送顺序记录等待应答的at句柄,
+ * 不带socket id的应答属于队首的句柄, 带socket id的应答属于该句柄最早的一次发送
+ */
+static void _core_at_pending_remove(uint32_t idx)
+{
+    g_at_global.pending_send_num--;
+    memmove(&g_at_global.pending_send[idx], &g_at_global.pending_send[idx + 1],
+            (g_at_global.pending_send_num - idx) * sizeof(core_at_handle_t *));
+}
+
+static void _core_at_pending_remove_handle(core_at_handle_t *at_handle, uint8_t all)
+{
+    uint32_t idx = 0;
+
+    while (idx < g_at_global.pending_send_num) {
+        if (g_at_global.pending_send[idx] == at_handle) {
+            _core_at_pending_remove(idx);
+            if (all == 0) {
+                break;
+            }
+        } else {
+            idx++;
+        }
+    }
+}
+
+static void _core_at_send_response(core_at_handle_t *at_handle, uint8_t result)
+{
+    if (at_handle->ack_seq != at_handle->send_seq) {
+        at_handle->ack_seq++;
+    }
+    /* 记下第一次失败的应答, 之后分段的成功应答不能把它覆盖掉 */
+    if (result != 1 && at_handle->send_failed == 0) {
+        at_handle->send_failed = 1;
+        at_handle->send_failure = result;
+    }
+    /* 该socket所有已发出的数据都得到应答后, aiot_at_recv才能读到结果 */
+    if (at_handle->ack_seq == at_handle->send_seq) {
+        at_handle->send_response = (at_handle->send_failed) ? at_handle->send_failure : result;
+        at_handle->send_failed = 0;
+    }
+}
+
 static int32_t _core_at_find_handle_by_socket_id(char *socket_id, core_at_handle_t **at_handle)
 {
     int32_t res = STATE_SUCCESS;
-    aiot_sysdep_portfile_t *sysdep = aiot_sysdep_get_portfile();
-    core_at_handle_t *node = NULL;
+    uint32_t link_id = 0;
+    core_at_handle_t *node = NULL, *unbound = NULL;
 
-    if (sysdep == NULL) {
-        return STATE_USER_INPUT_NULL_POINTER;
+    if (socket_id == NULL) {
+        if (core_list_empty(&g_at_global.at_handle_list)) {
+            return STATE_AT_UNKNOWN_SOCKET_ID;
+        }
+        *at_handle = core_list_first_entry(&g_at_global.at_handle_list, core_at_handle_t, linked_node);
+        return STATE_SUCCESS;
+    }
+
+    /* 数据通路: 数字link id直接查表, 不做字符串比较和内存分配 */
+    if (_core_at_parse_link_id(socket_id, &link_id) == STATE_SUCCESS && g_at_global.link_table[link_id] != NULL) {
+        *at_handle = g_at_global.link_table[link_id];
+        return STATE_SUCCESS;
     }
 
     core_list_for_each_entry(node, &g_at_global.at_handle_list, linked_node) {
-        if (node->socket_id == NULL ||
-            socket_id == NULL ||
-            ((strlen(node->socket_id) == strlen(socket_id)) &&
-             (memcmp(node->socket_id, socket_id, strlen(socket_id)) == 0))) {
-            if (socket_id != NULL) {
-                res = core_strdup(sysdep, &node->socket_id, socket_id, CORE_AT_MODULE_NAME);
-            }
-            if (res >= STATE_SUCCESS) {
-                *at_handle = node;
+        if (node->socket_id == NULL) {
+            if (unbound == NULL) {
+                unbound = node;
             }
-            break;
+        } else if (strcmp(node->socket_id, socket_id) == 0) {
+            *at_handle = node;
+            return STATE_SUCCESS;
         }
     }
 
-    return res;
+    if (unbound == NULL) {
+        return STATE_AT_UNKNOWN_SOCKET_ID;
+    }
+
+    /* 用户尚未通过AIOT_ATOPT_SOCKET_ID绑定, 将首个未绑定的句柄与此socket id绑定, 只在首次收到时发生 */
+    unbound->sysdep->core_sysdep_mutex_lock(unbound->data_mutex);
+    res = _core_at_bind_socket_id(unbound, socket_id);
+    unbound->sysdep->core_sysdep_mutex_unlock(unbound->data_mutex);
+    if (res < STATE_SUCCESS) {
+        return res;
+    }
+    *at_handle = unbound;
+
+    return STATE_SUCCESS;
 }
 
 int32_t aiot_at_set_send_handler(aiot_at_send_handler_t *handler)
@@ -159,6 +410,7 @@ int32_t aiot_at_set_send_handler(aiot_at_send_handler_t *handler)
     g_at_global.connect_handler = handler->connect_handler;
     g_at_global.send_handler = handler->send_handler;
     g_at_global.disconnect_handler = handler->disconnect_handler;
+    g_at_global.read_handler = handler->read_handler;
 
     return STATE_SUCCESS;
 }
@@ -180,7 +432,10 @@ void *aiot_at_init(void)
     memset(at_handle, 0, sizeof(core_at_handle_t));
 
     at_handle->sysdep = sysdep;
+    at_handle->link_id = CORE_AT_LINK_ID_INVALID;
     at_handle->ringbuf_len = CORE_AT_DEFAULT_RINGBUF_LEN;
+    at_handle->ringbuf_base_len = CORE_AT_DEFAULT_RINGBUF_LEN;
+    at_handle->send_chunk_len = CORE_AT_DEFAULT_SEND_CHUNK_LEN;
 
     at_handle->ringbuf = sysdep->core_sysdep_malloc(at_handle->ringbuf_len, CORE_AT_MODULE_NAME);
     if (at_handle->ringbuf == NULL) {
@@ -195,6 +450,7 @@ void *aiot_at_init(void)
 
     if (core_list_empty(&g_at_global.at_handle_list)) {
         g_at_global.mutex = sysdep->core_sysdep_mutex_init();
+        g_at_global.send_mutex = sysdep->core_sysdep_mutex_init();
     }
 
     core_list_add_tail(&at_handle->linked_node, &g_at_global.at_handle_list);
@@ -206,6 +462,7 @@ int32_t aiot_at_send(void *handle, aiot_at_send_option_t option, void *data)
 {
     int32_t res = STATE_SUCCESS;
     core_at_handle_t *at_handle = (core_at_handle_t *)handle;
+    aiot_at_buf_t chunk;
 
     if (at_handle == NULL) {
         return STATE_USER_INPUT_NULL_POINTER;
@@ -215,16 +472,50 @@ int32_t aiot_at_send(void *handle, aiot_at_send_option_t option, void *data)
         return STATE_USER_INPUT_OUT_RANGE;
     }
 
+    /* 各socket的指令和数据互斥地占用uart, 每次最多发送send_chunk_len字节, 多个socket的数据由此交替发出 */
+    at_handle->sysdep->core_sysdep_mutex_lock(g_at_global.send_mutex);
     switch (option) {
-        case AIOT_ATSENDOPT_CONNECT_REQ: {
-            if (g_at_global.connect_handler != NULL && data != NULL) {
+        case AIOT_ATSENDOPT_CONNECT_REQ:
+        case AIOT_ATSENDOPT_BUF: {
+            if ((option == AIOT_ATSENDOPT_CONNECT_REQ && g_at_global.connect_handler == NULL) ||
+                (option == AIOT_ATSENDOPT_BUF && g_at_global.send_handler == NULL) || data == NULL) {
+                break;
+            }
+
+            /* 先登记再发送, 应答可能在发送函数返回之前就已经到达 */
+            at_handle->sysdep->core_sysdep_mutex_lock(g_at_global.mutex);
+            if (g_at_global.pending_send_num == CORE_AT_PENDING_SEND_MAX) {
+                at_handle->sysdep->core_sysdep_mutex_unlock(g_at_global.mutex);
+                res = (option == AIOT_ATSENDOPT_BUF) ? 0 : STATE_AT_SEND_QUEUE_FULL;
+                break;
+            }
+            g_at_global.pending_send[g_at_global.pending_send_num++] = at_handle;
+            at_handle->send_seq++;
+            at_handle->sysdep->core_sysdep_mutex_unlock(g_at_global.mutex);
+
+            if (option == AIOT_ATSENDOPT_CONNECT_REQ) {
                 res = g_at_global.connect_handler(at_handle, (aiot_at_connect_t *)data);
+            } else {
+                chunk = *(aiot_at_buf_t *)data;
+                if (at_handle->send_chunk_len > 0 && chunk.len > at_handle->send_chunk_len) {
+                    chunk.len = at_handle->send_chunk_len;
+                }
+                res = g_at_global.send_handler(at_handle->socket_id, &chunk);
             }
-        }
-        break;
-        case AIOT_ATSENDOPT_BUF: {
-            if (g_at_global.send_handler != NULL && data != NULL) {
-                res = g_at_global.send_handler(at_handle->socket_id, (aiot_at_buf_t *)data);
+
+            /* 没有发出任何数据, 不会有应答, 撤销刚才的登记 */
+            if (res < STATE_SUCCESS || (option == AIOT_ATSENDOPT_BUF && res == 0)) {
+                uint32_t idx = 0;
+
+                at_handle->sysdep->core_sysdep_mutex_lock(g_at_global.mutex);
+                for (idx = g_at_global.pending_send_num; idx > 0; idx--) {
+                    if (g_at_global.pending_send[idx - 1] == at_handle) {
+                        _core_at_pending_remove(idx - 1);
+                        at_handle->send_seq--;
+                        break;
+                    }
+                }
+                at_handle->sysdep->core_sysdep_mutex_unlock(g_at_global.mutex);
             }
         }
         break;
@@ -238,6 +529,7 @@ int32_t aiot_at_send(void *handle, aiot_at_send_option_t option, void *data)
             res = STATE_USER_INPUT_UNKNOWN_OPTION;
         }
     }
+    at_handle->sysdep->core_sysdep_mutex_unlock(g_at_global.send_mutex);
 
     return res;
 }
@@ -263,14 +555,17 @@ int32_t aiot_at_recv(void *handle, aiot_at_recv_option_t option, void *data)
         }
         break;
         case AIOT_ATRECVOPT_SEND_RESP: {
-            *(uint8_t *)data = g_at_global.send_response;
-            g_at_global.send_response = 0;
+            at_handle->sysdep->core_sysdep_mutex_lock(g_at_global.mutex);
+            *(uint8_t *)data = at_handle->send_response;
+            at_handle->send_response = 0;
+            at_handle->sysdep->core_sysdep_mutex_unlock(g_at_global.mutex);
         }
         break;
         case AIOT_ATRECVOPT_BUF: {
             at_handle->sysdep->core_sysdep_mutex_unlock(at_handle->data_mutex);
             at_handle->sysdep->core_sysdep_mutex_lock(at_handle->ringbuf_mutex);
             res = _core_at_read_ringbuf(at_handle, (aiot_at_buf_t *)data);
+            _core_at_shrink_ringbuf(at_handle);
             at_handle->sysdep->core_sysdep_mutex_unlock(at_handle->ringbuf_mutex);
             at_handle->sysdep->core_sysdep_mutex_lock(at_handle->data_mutex);
         }
@@ -286,9 +581,73 @@ int32_t aiot_at_recv(void *handle, aiot_at_recv_option_t option, void *data)
     }
     at_handle->sysdep->core_sysdep_mutex_unlock(at_handle->data_mutex);
 
+    /* 腾出了空间或模组中有新数据, 继续从模组读取 */
+    if (option == AIOT_ATRECVOPT_BUF && res >= 0) {
+        _core_at_request_read(at_handle);
+    }
+
+    return res;
+}
+
+int32_t aiot_at_peek(void *handle, aiot_at_buf_t span[2])
+{
+    int32_t res = STATE_SUCCESS;
+    core_at_handle_t *at_handle = (core_at_handle_t *)handle;
+
+    if (at_handle == NULL || span == NULL) {
+        return STATE_USER_INPUT_NULL_POINTER;
+    }
+
+    at_handle->sysdep->core_sysdep_mutex_lock(at_handle->ringbuf_mutex);
+    res = _core_at_peek_ringbuf(at_handle, span);
+    at_handle->peek_len = res;
+    at_handle->sysdep->core_sysdep_mutex_unlock(at_handle->ringbuf_mutex);
+
     return res;
 }
 
+int32_t aiot_at_commit(void *handle, uint32_t len)
+{
+    int32_t res = STATE_SUCCESS;
+    core_at_handle_t *at_handle = (core_at_handle_t *)handle;
+
+    if (at_handle == NULL) {
+        return STATE_USER_INPUT_NULL_POINTER;
+    }
+
+    at_handle->sysdep->core_sysdep_mutex_lock(at_handle->ringbuf_mutex);
+    if (len > _core_at_ringbuf_used(at_handle)) {
+        res = STATE_USER_INPUT_OUT_RANGE;
+    } else {
+        _core_at_commit_ringbuf(at_handle, len);
+        at_handle->peek_len = 0;
+        _core_at_shrink_ringbuf(at_handle);
+    }
+    at_handle->sysdep->core_sysdep_mutex_unlock(at_handle->ringbuf_mutex);
+
+    if (res == STATE_SUCCESS) {
+        _core_at_request_read(at_handle);
+    }
+
+    return res;
+}
+
+int32_t aiot_at_get_stats(void *handle, aiot_at_stats_t *stats)
+{
+    core_at_handle_t *at_handle = (core_at_handle_t *)handle;
+
+    if (at_handle == NULL || stats == NULL) {
+        return STATE_USER_INPUT_NULL_POINTER;
+    }
+
+    at_handle->sysdep->core_sysdep_mutex_lock(at_handle->ringbuf_mutex);
+    *stats = at_handle->stats;
+    stats->ringbuf_len = at_handle->ringbuf_len;
+    at_handle->sysdep->core_sysdep_mutex_unlock(at_handle->ringbuf_mutex);
+
+    return STATE_SUCCESS;
+}
+
 int32_t aiot_at_deinit(void **handle)
 {
     core_at_handle_t *at_handle = NULL;
@@ -299,10 +658,19 @@ int32_t aiot_at_deinit(void **handle)
 
     at_handle = *(core_at_handle_t **)handle;
 
+    at_handle->sysdep->core_sysdep_mutex_lock(g_at_global.mutex);
+    if (at_handle->link_id != CORE_AT_LINK_ID_INVALID &&
+        g_at_global.link_table[at_handle->link_id] == at_handle) {
+        g_at_global.link_table[at_handle->link_id] = NULL;
+    }
+    _core_at_pending_remove_handle(at_handle, 1);
+    at_handle->sysdep->core_sysdep_mutex_unlock(g_at_global.mutex);
+
     core_list_del(&at_handle->linked_node);
 
     if (core_list_empty(&g_at_global.at_handle_list)) {
         at_handle->sysdep->core_sysdep_mutex_deinit(&g_at_global.mutex);
+        at_handle->sysdep->core_sysdep_mutex_deinit(&g_at_global.send_mutex);
     }
 
     at_handle->sysdep->core_sysdep_mutex_deinit(&at_handle->ringbuf_mutex);
@@ -341,7 +709,7 @@ int32_t aiot_at_setopt(void *handle, aiot_at_option_t option, void *data)
     at_handle->sysdep->core_sysdep_mutex_lock(at_handle->data_mutex);
     switch (option) {
         case AIOT_ATOPT_SOCKET_ID: {
-            res = core_strdup(at_handle->sysdep, &at_handle->socket_id, data, CORE_AT_MODULE_NAME);
+            res = _core_at_bind_socket_id(at_handle, (char *)data);
         }
         break;
         case AIOT_ATOPT_RING_BUF_LEN: {
@@ -350,6 +718,7 @@ int32_t aiot_at_setopt(void *handle, aiot_at_option_t option, void *data)
                 at_handle->ringbuf = NULL;
             }
             at_handle->ringbuf_len = *(uint32_t *)data;
+            at_handle->ringbuf_base_len = at_handle->ringbuf_len;
             at_handle->ringbuf = at_handle->sysdep->core_sysdep_malloc(at_handle->ringbuf_len, CORE_AT_MODULE_NAME);
             if (at_handle->ringbuf == NULL) {
                 at_handle->ringbuf_len = 0;
@@ -362,6 +731,24 @@ int32_t aiot_at_setopt(void *handle, aiot_at_option_t option, void *data)
             }
         }
         break;
+        case AIOT_ATOPT_RING_BUF_MAX_LEN: {
+            at_handle->sysdep->core_sysdep_mutex_lock(at_handle->ringbuf_mutex);
+            at_handle->ringbuf_max_len = *(uint32_t *)data;
+            at_handle->sysdep->core_sysdep_mutex_unlock(at_handle->ringbuf_mutex);
+        }
+        break;
+        case AIOT_ATOPT_SEND_CHUNK_LEN: {
+            at_handle->send_chunk_len = *(uint32_t *)data;
+        }
+        break;
+        case AIOT_ATOPT_EVENT_HANDLER: {
+            at_handle->event_handler = (aiot_at_event_handler_t)data;
+        }
+        break;
+        case AIOT_ATOPT_USERDATA: {
+            at_handle->userdata = data;
+        }
+        break;
         default: {
             res = STATE_USER_INPUT_UNKNOWN_OPTION;
         }
@@ -375,6 +762,9 @@ int32_t aiot_at_input(char *socket_id, aiot_at_recv_option_t option, void *data)
 {
     int32_t res = STATE_SUCCESS;
     core_at_handle_t *at_handle = NULL;
+    aiot_at_event_handler_t event_handler = NULL;
+    void *userdata = NULL;
+    uint8_t send_resp_matched = 0;
 
     if (data == NULL) {
         return STATE_USER_INPUT_NULL_POINTER;
@@ -384,9 +774,25 @@ int32_t aiot_at_input(char *socket_id, aiot_at_recv_option_t option, void *data)
         return STATE_USER_INPUT_OUT_RANGE;
     }
 
-    res = _core_at_find_handle_by_socket_id(socket_id, &at_handle);
-    if (res < STATE_SUCCESS) {
-        return res;
+    /* 不带socket id的发送应答属于最早发出且尚未应答的那一次发送 */
+    if (option == AIOT_ATRECVOPT_SEND_RESP && socket_id == NULL && g_at_global.mutex != NULL) {
+        aiot_sysdep_portfile_t *sysdep = aiot_sysdep_get_portfile();
+
+        sysdep->core_sysdep_mutex_lock(g_at_global.mutex);
+        if (g_at_global.pending_send_num > 0) {
+            at_handle = g_at_global.pending_send[0];
+            _core_at_pending_remove(0);
+            _core_at_send_response(at_handle, *(uint8_t *)data);
+            send_resp_matched = 1;
+        }
+        sysdep->core_sysdep_mutex_unlock(g_at_global.mutex);
+    }
+
+    if (at_handle == NULL) {
+        res = _core_at_find_handle_by_socket_id(socket_id, &at_handle);
+        if (res < STATE_SUCCESS) {
+            return res;
+        }
     }
 
     at_handle->sysdep->core_sysdep_mutex_lock(at_handle->data_mutex);
@@ -396,7 +802,14 @@ int32_t aiot_at_input(char *socket_id, aiot_at_recv_option_t option, void *data)
         }
         break;
         case AIOT_ATRECVOPT_SEND_RESP: {
-            g_at_global.send_response = *(uint8_t *)data;
+            if (send_resp_matched == 0) {
+                at_handle->sysdep->core_sysdep_mutex_lock(g_at_global.mutex);
+                if (at_handle->ack_seq != at_handle->send_seq) {
+                    _core_at_pending_remove_handle(at_handle, 0);
+                }
+                _core_at_send_response(at_handle, *(uint8_t *)data);
+                at_handle->sysdep->core_sysdep_mutex_unlock(g_at_global.mutex);
+            }
         }
         break;
         case AIOT_ATRECVOPT_BUF: {
@@ -411,11 +824,28 @@ int32_t aiot_at_input(char *socket_id, aiot_at_recv_option_t option, void *data)
             at_handle->disconnect_response = *(uint8_t *)data;
         }
         break;
+        case AIOT_ATRECVOPT_DATA_AVAILABLE:
+        case AIOT_ATRECVOPT_READ_RESP: {
+            at_handle->sysdep->core_sysdep_mutex_lock(at_handle->ringbuf_mutex);
+            at_handle->modem_pending = *(uint32_t *)data;
+            if (option == AIOT_ATRECVOPT_READ_RESP) {
+                at_handle->read_requested = 0;
+            }
+            at_handle->sysdep->core_sysdep_mutex_unlock(at_handle->ringbuf_mutex);
+        }
+        break;
         default: {
             res = STATE_USER_INPUT_UNKNOWN_OPTION;
         }
     }
+    event_handler = at_handle->event_handler;
+    userdata = at_handle->userdata;
     at_handle->sysdep->core_sysdep_mutex_unlock(at_handle->data_mutex);
 
+    /* 在锁外通知, 等待方被唤醒后可以立即调用aiot_at_recv. 环形缓冲区没有写入任何数据时不通知 */
+    if (event_handler != NULL && (res > STATE_SUCCESS || (res == STATE_SUCCESS && option != AIOT_ATRECVOPT_BUF))) {
+        event_handler(at_handle, option, userdata);
+    }
+
     return res;
 }
\ No newline at end of file
@@ -7,30 +7,118 @@
 #include "timers.h"
 #include "semphr.h"
 #include "core_list.h"
+#include "core_mempool.h"
+#include "core_tls_arena.h"
 #include "aiot_state_api.h"
 #include "aiot_sysdep_api.h"
 #include "aiot_at_api.h"
 //#include "freertos_linkkit.h"
 
-#define AT_RINGBUF_ACCESS_INTERVAL_MS   (50)
+/*
+ *  CORE_SYSDEP_MBEDTLS_ENABLED 打开后, TLS在MCU上运行, 经模组的TCP socket收发TLS记录
+ *
+ *  需要在工程中加入external/mbedtls, 并由板级代码实现 core_sysdep_entropy_poll 作为随机数的熵源
+ *  模组自带TLS时不需要打开, 默认关闭以保持原来的ROM和RAM占用
+ *
+ */
+/* #define CORE_SYSDEP_MBEDTLS_ENABLED */
+
+#ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+    #include "mbedtls/ssl.h"
+    #include "mbedtls/ctr_drbg.h"
+    #include "mbedtls/debug.h"
+    #include "mbedtls/platform.h"
+#endif
+
+/* 模组暂时无法接收发送数据时的重试间隔, 接收方向由aiot_at_input的事件通知唤醒, 不再轮询 */
+#define AT_SEND_RETRY_INTERVAL_MS       (50)
+/* 模组使用按需读取模式时, 接收缓冲区在OTA下载等突发流量下允许扩大到的长度, 读空后恢复默认长度 */
+#ifndef AT_RING_BUF_MAX_LEN
+#define AT_RING_BUF_MAX_LEN             (8 * 1024)
+#endif
+
+#ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+/* 模组一条发送指令最多携带的字节数, 以模组手册为准 */
+#ifndef AT_SEND_MAX_LEN
+#define AT_SEND_MAX_LEN                 (1460)
+#endif
+/*
+ *  TLS记录发给模组之前的暂存长度, 不超过AT_SEND_MAX_LEN
+ *
+ *  - 应用数据按记录切分, 每条记录连同开销不超过AT_SEND_MAX_LEN, 一条记录只占用一条发送指令
+ *  - 同一个flight的多条握手记录先暂存, 在等待对端应答时合并为一条发送指令发出
+ *
+ *  为0时不做以上处理, 记录直接交给AT层按默认分块发送, 仅用于对比
+ */
+#ifndef AT_TLS_BATCH_LEN
+#define AT_TLS_BATCH_LEN                (AT_SEND_MAX_LEN)
+#endif
+/*
+ *  mbedtls使用的静态内存区长度, TLS的内存都从这里分配, 不占用configTOTAL_HEAP_SIZE
+ *
+ *  需要放下输入输出记录缓冲区(由mbedtls的MBEDTLS_SSL_BUFFER_PROFILE决定)、证书解析结果、握手期间的大数运算和上面的暂存区,
+ *  各阶段的实际用量可以由 host-tools/tls_arena_bench.sh 得到. 放不下时建立连接返回STATE_PORT_TLS_ARENA_EXHAUSTED
+ *
+ *  没有默认值, 必须按目标板的RAM在编译时指定. 以MBEDTLS_SSL_BUFFER_PROFILE=2(4096/1024)测得的峰值约为:
+ *  PSK 9.8KB, 校验RSA 2048服务器证书 16.2KB, 另外使用客户端证书 25.5KB. 20KB RAM的STM32F103xB只放得下PSK方式
+ */
+#ifndef AT_TLS_ARENA_LEN
+#error "AT_TLS_ARENA_LEN is not set, size it for the target RAM with host-tools/tls_arena_bench.sh"
+#elif AT_TLS_ARENA_LEN < MBEDTLS_SSL_IN_CONTENT_LEN + MBEDTLS_SSL_OUT_CONTENT_LEN
+#error "AT_TLS_ARENA_LEN cannot hold the TLS record buffers"
+#endif
+
+typedef struct {
+    mbedtls_ssl_context ssl_ctx;
+    mbedtls_ssl_config  ssl_config;
+    mbedtls_x509_crt    x509_server_cert;
+    mbedtls_x509_crt    x509_client_cert;
+    mbedtls_pk_context  x509_client_pk;
+    uint8_t *batch;             /* 暂存的TLS记录 */
+    uint32_t batch_len;
+    uint32_t io_timeout_ms;     /* 发送暂存记录的超时时间 */
+} core_sysdep_mbedtls_t;
+#endif
 
 typedef struct {
     void *at_handle;
+    SemaphoreHandle_t event_sem;
     uint32_t connect_timeout_ms;
     core_sysdep_socket_type_t socket_type;
     aiot_sysdep_network_cred_t *cred;
     char *host;
     uint16_t port;
+#ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+    core_sysdep_psk_t psk;
+    core_sysdep_mbedtls_t mbedtls;
+#endif
 } core_network_handle_t;
 
+/* SDK的小块内存先从按模块划分的内存池中分配, 避免长时间运行后configTOTAL_HEAP_SIZE的堆碎片化, 内存池用完时再使用系统堆 */
 void *core_sysdep_malloc(uint32_t size, char *name)
 {
-    return pvPortMalloc(size);
+    void *ptr = NULL;
+
+    vTaskSuspendAll();
+    ptr = core_mempool_malloc(size, name);
+    (void)xTaskResumeAll();
+    if (ptr == NULL) {
+        ptr = pvPortMalloc(size);
+    }
+
+    return ptr;
 }
 
 void core_sysdep_free(void *ptr)
 {
-    vPortFree(ptr);
+    uint8_t pooled = 0;
+
+    vTaskSuspendAll();
+    pooled = core_mempool_free(ptr);
+    (void)xTaskResumeAll();
+    if (pooled == 0) {
+        vPortFree(ptr);
+    }
 }
 
 uint64_t core_sysdep_time(void)
@@ -43,19 +131,44 @@ void core_sysdep_sleep(uint64_t time_ms)
     vTaskDelay(time_ms / portTICK_PERIOD_MS);
 }
 
+/* 由aiot_at_input在uart接收任务中调用, 唤醒阻塞在该连接上的任务 */
+static void _core_sysdep_network_at_event_handler(void *handle, aiot_at_recv_option_t option, void *userdata)
+{
+    core_network_handle_t *network_handle = (core_network_handle_t *)userdata;
+
+    xSemaphoreGive(network_handle->event_sem);
+}
+
+/* 等待下一次事件通知, 最长timeout_ms. 信号量只表示"可能有新数据", 调用者醒来后需重新检查 */
+static void _core_sysdep_network_wait_event(core_network_handle_t *network_handle, uint64_t timeout_ms)
+{
+    xSemaphoreTake(network_handle->event_sem, (timeout_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+}
+
 void *core_sysdep_network_init(void)
 {
+    uint32_t ringbuf_max_len = AT_RING_BUF_MAX_LEN;
     core_network_handle_t *network_handle = pvPortMalloc(sizeof(core_network_handle_t));
     if (network_handle == NULL) {
         return NULL;
     }
     memset(network_handle, 0, sizeof(core_network_handle_t));
 
+    network_handle->event_sem = xSemaphoreCreateBinary();
+    if (network_handle->event_sem == NULL) {
+        vPortFree(network_handle);
+        return NULL;
+    }
+
     network_handle->at_handle = aiot_at_init();
     if (network_handle->at_handle == NULL) {
+        vSemaphoreDelete(network_handle->event_sem);
         vPortFree(network_handle);
         return NULL;
     }
+    aiot_at_setopt(network_handle->at_handle, AIOT_ATOPT_USERDATA, network_handle);
+    aiot_at_setopt(network_handle->at_handle, AIOT_ATOPT_EVENT_HANDLER, (void *)_core_sysdep_network_at_event_handler);
+    aiot_at_setopt(network_handle->at_handle, AIOT_ATOPT_RING_BUF_MAX_LEN, (void *)&ringbuf_max_len);
 
     return network_handle;
 }
@@ -95,6 +208,36 @@ int32_t core_sysdep_network_setopt(void *handle, core_sysdep_network_option_t op
             network_handle->connect_timeout_ms = *(uint32_t *)data;
         }
         break;
+#ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+        case CORE_SYSDEP_NETWORK_CRED: {
+            network_handle->cred = pvPortMalloc(sizeof(aiot_sysdep_network_cred_t));
+            if (network_handle->cred == NULL) {
+                printf("malloc failed\n");
+                return STATE_PORT_MALLOC_FAILED;
+            }
+            memcpy(network_handle->cred, data, sizeof(aiot_sysdep_network_cred_t));
+        }
+        break;
+        case CORE_SYSDEP_NETWORK_PSK: {
+            core_sysdep_psk_t *psk = (core_sysdep_psk_t *)data;
+
+            network_handle->psk.psk_id = pvPortMalloc(strlen(psk->psk_id) + 1);
+            if (network_handle->psk.psk_id == NULL) {
+                printf("malloc failed\n");
+                return STATE_PORT_MALLOC_FAILED;
+            }
+            memcpy(network_handle->psk.psk_id, psk->psk_id, strlen(psk->psk_id) + 1);
+            network_handle->psk.psk = pvPortMalloc(strlen(psk->psk) + 1);
+            if (network_handle->psk.psk == NULL) {
+                vPortFree(network_handle->psk.psk_id);
+                network_handle->psk.psk_id = NULL;
+                printf("malloc failed\n");
+                return STATE_PORT_MALLOC_FAILED;
+            }
+            memcpy(network_handle->psk.psk, psk->psk, strlen(psk->psk) + 1);
+        }
+        break;
+#endif
         default: {
             printf("unknown option\n");
         }
@@ -107,24 +250,25 @@ static int32_t _core_sysdep_network_wait_response(core_network_handle_t *network
         uint8_t *result)
 {
     int32_t res = STATE_SUCCESS;
-    uint64_t timestart_ms = 0;
+    uint64_t timestart_ms = 0, timenow_ms = 0;
 
     timestart_ms = core_sysdep_time();
     while (1) {
-        if (timestart_ms > core_sysdep_time()) {
-            timestart_ms = core_sysdep_time();
-        }
-        if (core_sysdep_time() - timestart_ms > network_handle->connect_timeout_ms) {
-            res = STATE_PORT_NETWORK_CONNECT_TIMEOUT;
-            break;
-        }
-
         res = aiot_at_recv(network_handle->at_handle, option, result);
         if (res == STATE_SUCCESS && *result == 1) {
             res = STATE_SUCCESS;
             break;
         }
-        vTaskDelay(AT_RINGBUF_ACCESS_INTERVAL_MS / portTICK_PERIOD_MS);
+
+        timenow_ms = core_sysdep_time();
+        if (timestart_ms > timenow_ms) {
+            timestart_ms = timenow_ms;
+        }
+        if (timenow_ms - timestart_ms >= network_handle->connect_timeout_ms) {
+            res = STATE_PORT_NETWORK_CONNECT_TIMEOUT;
+            break;
+        }
+        _core_sysdep_network_wait_event(network_handle, network_handle->connect_timeout_ms - (timenow_ms - timestart_ms));
     }
 
     return res;
@@ -166,6 +310,437 @@ static int32_t _core_sysdep_network_tcp_establish(core_network_handle_t *network
     return STATE_SUCCESS;
 }
 
+#ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+int32_t _core_sysdep_network_tcp_send(core_network_handle_t *network_handle, uint8_t *buffer, uint32_t len,
+                                      uint32_t timeout_ms);
+void *core_sysdep_mutex_init(void);
+void core_sysdep_mutex_lock(void *mutex);
+void core_sysdep_mutex_unlock(void *mutex);
+
+/* 由板级代码实现, 从硬件随机数发生器、ADC噪声等熵源取output_len字节, 成功返回0. 在持有DRBG互斥锁的任务中调用 */
+extern int32_t core_sysdep_entropy_poll(uint8_t *output, uint32_t output_len);
+
+static mbedtls_ctr_drbg_context g_core_sysdep_drbg;
+static uint8_t g_core_sysdep_drbg_seeded = 0;
+static void *g_core_sysdep_drbg_mutex = NULL;
+
+static uint64_t g_core_sysdep_tls_arena_buf[AT_TLS_ARENA_LEN / sizeof(uint64_t)];
+static core_tls_arena_t g_core_sysdep_tls_arena;
+static uint8_t g_core_sysdep_tls_arena_inited = 0;
+
+/* 调用时调度器需处于挂起状态 */
+static void _core_sysdep_tls_arena_init(void)
+{
+    if (g_core_sysdep_tls_arena_inited == 0) {
+        core_tls_arena_init(&g_core_sysdep_tls_arena, g_core_sysdep_tls_arena_buf, sizeof(g_core_sysdep_tls_arena_buf));
+        g_core_sysdep_tls_arena_inited = 1;
+    }
+}
+
+static void *_core_mbedtls_calloc(size_t n, size_t size)
+{
+    void *ptr = NULL;
+
+    if ((uint32_t)n != n || (uint32_t)size != size) {
+        return NULL;
+    }
+
+    vTaskSuspendAll();
+    _core_sysdep_tls_arena_init();
+    ptr = core_tls_arena_calloc(&g_core_sysdep_tls_arena, (uint32_t)n, (uint32_t)size);
+    (void)xTaskResumeAll();
+
+    return ptr;
+}
+
+static void _core_mbedtls_free(void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+    vTaskSuspendAll();
+    core_tls_arena_free(&g_core_sysdep_tls_arena, ptr);
+    (void)xTaskResumeAll();
+}
+
+static void _core_sysdep_tls_arena_set_phase(core_tls_arena_phase_t phase)
+{
+    vTaskSuspendAll();
+    _core_sysdep_tls_arena_init();
+    core_tls_arena_set_phase(&g_core_sysdep_tls_arena, phase);
+    (void)xTaskResumeAll();
+}
+
+/* TLS内存区的用量, 含最近一次建立连接时各阶段的峰值, 用于调整AT_TLS_ARENA_LEN */
+void core_sysdep_tls_arena_get_stats(core_tls_arena_stats_t *stats)
+{
+    vTaskSuspendAll();
+    _core_sysdep_tls_arena_init();
+    core_tls_arena_get_stats(&g_core_sysdep_tls_arena, stats);
+    (void)xTaskResumeAll();
+}
+
+static int _core_sysdep_drbg_entropy(void *ctx, unsigned char *output, size_t len)
+{
+    if (core_sysdep_entropy_poll(output, len) != 0) {
+        return MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED;
+    }
+
+    return 0;
+}
+
+/*
+ *  TLS和core_sysdep_rand共用一个CTR-DRBG, 首次使用时播种, 之后按MBEDTLS_CTR_DRBG_RESEED_INTERVAL从熵源重新播种.
+ *  播种和生成随机数的耗时较长, 用互斥锁保护, 不挂起调度器, 以免阻塞串口接收等其它任务
+ */
+static int _core_sysdep_drbg_random(void *ctx, unsigned char *output, size_t output_len)
+{
+    int res = 0;
+    size_t len = 0;
+
+    /* 只有创建互斥锁时挂起调度器 */
+    if (g_core_sysdep_drbg_mutex == NULL) {
+        vTaskSuspendAll();
+        if (g_core_sysdep_drbg_mutex == NULL) {
+            g_core_sysdep_drbg_mutex = core_sysdep_mutex_init();
+        }
+        (void)xTaskResumeAll();
+        if (g_core_sysdep_drbg_mutex == NULL) {
+            return MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED;
+        }
+    }
+
+    core_sysdep_mutex_lock(g_core_sysdep_drbg_mutex);
+    if (g_core_sysdep_drbg_seeded == 0) {
+        mbedtls_platform_set_calloc_free(_core_mbedtls_calloc, _core_mbedtls_free);
+        mbedtls_ctr_drbg_init(&g_core_sysdep_drbg);
+        res = mbedtls_ctr_drbg_seed(&g_core_sysdep_drbg, _core_sysdep_drbg_entropy, NULL,
+                                    (const unsigned char *)"aiot_at_tls", strlen("aiot_at_tls"));
+        g_core_sysdep_drbg_seeded = (res == 0) ? 1 : 0;
+    }
+    while (res == 0 && output_len > 0) {
+        len = (output_len > MBEDTLS_CTR_DRBG_MAX_REQUEST) ? MBEDTLS_CTR_DRBG_MAX_REQUEST : output_len;
+        res = mbedtls_ctr_drbg_random(&g_core_sysdep_drbg, output, len);
+        output += len;
+        output_len -= len;
+    }
+    core_sysdep_mutex_unlock(g_core_sysdep_drbg_mutex);
+
+    return res;
+}
+
+static void _mbedtls_debug(void *ctx, int level, const char *file, int line, const char *str)
+{
+    ((void) level);
+    if (NULL != ctx) {
+        printf("%s\n", str);
+    }
+}
+
+/* 把暂存的TLS记录用一条发送指令发出 */
+static int _core_sysdep_at_tls_flush(core_network_handle_t *network_handle)
+{
+    int32_t res = 0;
+
+    if (network_handle->mbedtls.batch_len == 0) {
+        return 0;
+    }
+
+    res = _core_sysdep_network_tcp_send(network_handle, network_handle->mbedtls.batch,
+                                        network_handle->mbedtls.batch_len, network_handle->mbedtls.io_timeout_ms);
+    if (res < (int32_t)network_handle->mbedtls.batch_len) {
+        return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+    }
+    network_handle->mbedtls.batch_len = 0;
+
+    return 0;
+}
+
+/* mbedtls每次交给BIO的是一条完整的记录, 放得下时暂存, 放不下的记录先发出暂存的数据再单独发送 */
+static int _core_sysdep_at_tls_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    core_network_handle_t *network_handle = (core_network_handle_t *)ctx;
+    int32_t res = 0;
+
+    if (network_handle->mbedtls.batch_len + len > AT_TLS_BATCH_LEN) {
+        res = _core_sysdep_at_tls_flush(network_handle);
+        if (res != 0) {
+            return res;
+        }
+    }
+
+    if (len > AT_TLS_BATCH_LEN) {
+        res = _core_sysdep_network_tcp_send(network_handle, (uint8_t *)buf, len, network_handle->mbedtls.io_timeout_ms);
+        if (res < STATE_SUCCESS) {
+            return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+        }
+        return (res == 0) ? MBEDTLS_ERR_SSL_WANT_WRITE : res;
+    }
+
+    memcpy(network_handle->mbedtls.batch + network_handle->mbedtls.batch_len, buf, len);
+    network_handle->mbedtls.batch_len += len;
+
+    return len;
+}
+
+/* 等待对端的数据之前, 本端这一轮的记录必须已经发出 */
+static int _core_sysdep_at_tls_recv(void *ctx, unsigned char *buf, size_t len, uint32_t timeout_ms)
+{
+    core_network_handle_t *network_handle = (core_network_handle_t *)ctx;
+    int32_t res = 0;
+    uint64_t timestart_ms = 0, timenow_ms = 0;
+    aiot_at_buf_t at_buf;
+
+    res = _core_sysdep_at_tls_flush(network_handle);
+    if (res != 0) {
+        return res;
+    }
+
+    timestart_ms = core_sysdep_time();
+    while (1) {
+        at_buf.buf = buf;
+        at_buf.len = len;
+        res = aiot_at_recv(network_handle->at_handle, AIOT_ATRECVOPT_BUF, &at_buf);
+        if (res < STATE_SUCCESS) {
+            return MBEDTLS_ERR_SSL_CONN_EOF;
+        }
+        if (res > 0) {
+            return res;
+        }
+
+        /* 与mbedtls_net_recv_timeout一致, 超时时间为0时一直等待 */
+        if (timeout_ms == 0) {
+            _core_sysdep_network_wait_event(network_handle, portMAX_DELAY);
+            continue;
+        }
+        timenow_ms = core_sysdep_time();
+        if (timestart_ms > timenow_ms) {
+            timestart_ms = timenow_ms;
+        }
+        if (timenow_ms - timestart_ms >= timeout_ms) {
+            return MBEDTLS_ERR_SSL_TIMEOUT;
+        }
+        _core_sysdep_network_wait_event(network_handle, timeout_ms - (timenow_ms - timestart_ms));
+    }
+}
+
+static int32_t _core_sysdep_network_mbedtls_config(core_network_handle_t *network_handle)
+{
+    int32_t res = 0;
+    uint32_t max_fragment = network_handle->cred->max_tls_fragment;
+
+    if (max_fragment == 0) {
+        printf("invalid max_tls_fragment parameter\n");
+        return STATE_PORT_TLS_INVALID_MAX_FRAGMENT;
+    }
+
+    /* 服务端发来的记录不能超过输入缓冲区, 协商的max_fragment_length以MBEDTLS_SSL_IN_CONTENT_LEN为上限 */
+    if (max_fragment > MBEDTLS_SSL_IN_CONTENT_LEN) {
+        max_fragment = MBEDTLS_SSL_IN_CONTENT_LEN;
+    }
+
+    if (max_fragment <= 512) {
+        res = mbedtls_ssl_conf_max_frag_len(&network_handle->mbedtls.ssl_config, MBEDTLS_SSL_MAX_FRAG_LEN_512);
+    } else if (max_fragment <= 1024) {
+        res = mbedtls_ssl_conf_max_frag_len(&network_handle->mbedtls.ssl_config, MBEDTLS_SSL_MAX_FRAG_LEN_1024);
+    } else if (max_fragment <= 2048) {
+        res = mbedtls_ssl_conf_max_frag_len(&network_handle->mbedtls.ssl_config, MBEDTLS_SSL_MAX_FRAG_LEN_2048);
+    } else if (max_fragment <= 4096) {
+        res = mbedtls_ssl_conf_max_frag_len(&network_handle->mbedtls.ssl_config, MBEDTLS_SSL_MAX_FRAG_LEN_4096);
+    } else {
+        res = mbedtls_ssl_conf_max_frag_len(&network_handle->mbedtls.ssl_config, MBEDTLS_SSL_MAX_FRAG_LEN_NONE);
+    }
+    if (res < 0) {
+        printf("mbedtls_ssl_conf_max_frag_len error, res: -0x%04X\n", -res);
+        return res;
+    }
+
+    res = mbedtls_ssl_config_defaults(&network_handle->mbedtls.ssl_config, MBEDTLS_SSL_IS_CLIENT,
+                                      MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+    if (res < 0) {
+        printf("mbedtls_ssl_config_defaults error, res: -0x%04X\n", -res);
+        return res;
+    }
+
+    mbedtls_ssl_conf_max_version(&network_handle->mbedtls.ssl_config, MBEDTLS_SSL_MAJOR_VERSION_3,
+                                 MBEDTLS_SSL_MINOR_VERSION_3);
+    mbedtls_ssl_conf_min_version(&network_handle->mbedtls.ssl_config, MBEDTLS_SSL_MAJOR_VERSION_3,
+                                 MBEDTLS_SSL_MINOR_VERSION_3);
+    mbedtls_ssl_conf_rng(&network_handle->mbedtls.ssl_config, _core_sysdep_drbg_random, NULL);
+    mbedtls_ssl_conf_dbg(&network_handle->mbedtls.ssl_config, _mbedtls_debug, NULL);
+    mbedtls_ssl_conf_read_timeout(&network_handle->mbedtls.ssl_config, network_handle->connect_timeout_ms);
+
+    if (network_handle->cred->option == AIOT_SYSDEP_NETWORK_CRED_SVRCERT_RSA) {
+        if (network_handle->cred->x509_server_cert == NULL || network_handle->cred->x509_server_cert_len == 0) {
+            printf("invalid x509 server cert\n");
+            return STATE_PORT_TLS_INVALID_SERVER_CERT;
+        }
+        res = mbedtls_x509_crt_parse(&network_handle->mbedtls.x509_server_cert,
+                                     (const unsigned char *)network_handle->cred->x509_server_cert,
+                                     (size_t)network_handle->cred->x509_server_cert_len + 1);
+        if (res < 0) {
+            printf("mbedtls_x509_crt_parse server cert error, res: -0x%04X\n", -res);
+            return STATE_PORT_TLS_INVALID_SERVER_CERT;
+        }
+
+        if (network_handle->cred->x509_client_cert != NULL && network_handle->cred->x509_client_cert_len > 0 &&
+            network_handle->cred->x509_client_privkey != NULL && network_handle->cred->x509_client_privkey_len > 0) {
+            res = mbedtls_x509_crt_parse(&network_handle->mbedtls.x509_client_cert,
+                                         (const unsigned char *)network_handle->cred->x509_client_cert,
+                                         (size_t)network_handle->cred->x509_client_cert_len + 1);
+            if (res < 0) {
+                printf("mbedtls_x509_crt_parse client cert error, res: -0x%04X\n", -res);
+                return STATE_PORT_TLS_INVALID_CLIENT_CERT;
+            }
+            res = mbedtls_pk_parse_key(&network_handle->mbedtls.x509_client_pk,
+                                       (const unsigned char *)network_handle->cred->x509_client_privkey,
+                                       (size_t)network_handle->cred->x509_client_privkey_len + 1, NULL, 0);
+            if (res < 0) {
+                printf("mbedtls_pk_parse_key client pk error, res: -0x%04X\n", -res);
+                return STATE_PORT_TLS_INVALID_CLIENT_KEY;
+            }
+            res = mbedtls_ssl_conf_own_cert(&network_handle->mbedtls.ssl_config, &network_handle->mbedtls.x509_client_cert,
+                                            &network_handle->mbedtls.x509_client_pk);
+            if (res < 0) {
+                printf("mbedtls_ssl_conf_own_cert error, res: -0x%04X\n", -res);
+                return STATE_PORT_TLS_INVALID_CLIENT_CERT;
+            }
+        }
+        mbedtls_ssl_conf_ca_chain(&network_handle->mbedtls.ssl_config, &network_handle->mbedtls.x509_server_cert, NULL);
+    } else if (network_handle->cred->option == AIOT_SYSDEP_NETWORK_CRED_SVRCERT_PSK) {
+        static const int ciphersuites[2] = {MBEDTLS_TLS_PSK_WITH_AES_128_CBC_SHA, 0};
+
+        if (network_handle->psk.psk == NULL || network_handle->psk.psk_id == NULL) {
+            printf("missing psk\n");
+            return STATE_PORT_TLS_CONFIG_PSK_FAILED;
+        }
+        res = mbedtls_ssl_conf_psk(&network_handle->mbedtls.ssl_config,
+                                   (const unsigned char *)network_handle->psk.psk, (size_t)strlen(network_handle->psk.psk),
+                                   (const unsigned char *)network_handle->psk.psk_id, (size_t)strlen(network_handle->psk.psk_id));
+        if (res < 0) {
+            printf("mbedtls_ssl_conf_psk error, res = -0x%04X\n", -res);
+            return STATE_PORT_TLS_CONFIG_PSK_FAILED;
+        }
+        mbedtls_ssl_conf_ciphersuites(&network_handle->mbedtls.ssl_config, ciphersuites);
+    } else {
+        printf("unsupported security option\n");
+        return STATE_PORT_TLS_INVALID_CRED_OPTION;
+    }
+
+    /* 从申请记录缓冲区开始计入密钥交换阶段 */
+    _core_sysdep_tls_arena_set_phase(CORE_TLS_ARENA_PHASE_KEY_EXCHANGE);
+    res = mbedtls_ssl_setup(&network_handle->mbedtls.ssl_ctx, &network_handle->mbedtls.ssl_config);
+    if (res < 0) {
+        printf("mbedtls_ssl_setup error, res: -0x%04X\n", -res);
+        return res;
+    }
+    mbedtls_ssl_set_bio(&network_handle->mbedtls.ssl_ctx, network_handle, _core_sysdep_at_tls_send, NULL,
+                        _core_sysdep_at_tls_recv);
+
+    return STATE_SUCCESS;
+}
+
+static int32_t _core_sysdep_network_mbedtls_handshake(core_network_handle_t *network_handle)
+{
+    int32_t res = 0;
+#if AT_TLS_BATCH_LEN > 0
+    uint32_t send_chunk_len = AT_SEND_MAX_LEN;
+#endif
+
+    mbedtls_platform_set_calloc_free(_core_mbedtls_calloc, _core_mbedtls_free);
+    mbedtls_ssl_init(&network_handle->mbedtls.ssl_ctx);
+    mbedtls_ssl_config_init(&network_handle->mbedtls.ssl_config);
+    mbedtls_x509_crt_init(&network_handle->mbedtls.x509_server_cert);
+    mbedtls_x509_crt_init(&network_handle->mbedtls.x509_client_cert);
+    mbedtls_pk_init(&network_handle->mbedtls.x509_client_pk);
+    network_handle->mbedtls.io_timeout_ms = network_handle->connect_timeout_ms;
+
+#if AT_TLS_BATCH_LEN > 0
+    /* 暂存区中的一条记录或一个flight对应一条发送指令, AT层不再按默认长度切分 */
+    network_handle->mbedtls.batch = _core_mbedtls_calloc(1, AT_TLS_BATCH_LEN);
+    if (network_handle->mbedtls.batch == NULL) {
+        return STATE_PORT_MALLOC_FAILED;
+    }
+    aiot_at_setopt(network_handle->at_handle, AIOT_ATOPT_SEND_CHUNK_LEN, (void *)&send_chunk_len);
+#endif
+
+    printf("establish mbedtls connection with server(host='%s', port=[%u])\n", network_handle->host, network_handle->port);
+
+    res = _core_sysdep_network_mbedtls_config(network_handle);
+    if (res < STATE_SUCCESS) {
+        return res;
+    }
+
+    res = _core_sysdep_network_tcp_establish(network_handle);
+    if (res < STATE_SUCCESS) {
+        return res;
+    }
+
+    while ((res = mbedtls_ssl_handshake(&network_handle->mbedtls.ssl_ctx)) != 0) {
+        if ((res != MBEDTLS_ERR_SSL_WANT_READ) && (res != MBEDTLS_ERR_SSL_WANT_WRITE)) {
+            printf("mbedtls_ssl_handshake error, res: -0x%04X\n", -res);
+            if (res == MBEDTLS_ERR_SSL_INVALID_RECORD) {
+                res = STATE_PORT_TLS_INVALID_RECORD;
+            } else if (res == MBEDTLS_ERR_SSL_TIMEOUT) {
+                res = STATE_PORT_NETWORK_CONNECT_TIMEOUT;
+            } else {
+                res = STATE_PORT_TLS_INVALID_HANDSHAKE;
+            }
+            return res;
+        }
+    }
+
+    /* 会话复用时本端的Finished是握手的最后一条消息, 不会再等待对端 */
+    if (_core_sysdep_at_tls_flush(network_handle) != 0) {
+        return STATE_PORT_TLS_INVALID_HANDSHAKE;
+    }
+
+    res = mbedtls_ssl_get_verify_result(&network_handle->mbedtls.ssl_ctx);
+    if (res < 0) {
+        printf("mbedtls_ssl_get_verify_result error, res: -0x%04X\n", -res);
+        return res;
+    }
+
+    return STATE_SUCCESS;
+}
+
+/*
+ *  证书解析和记录缓冲区的申请都在连接模组之前, 内存区不够时在这里就失败, 不会连上服务器后才发现.
+ *  握手中途的申请失败由mbedtls报告为各种错误码, 统一按内存区的失败次数识别出来
+ */
+static int32_t _core_sysdep_network_mbedtls_establish(core_network_handle_t *network_handle)
+{
+    core_tls_arena_stats_t stats;
+    uint32_t alloc_failed = 0;
+    int32_t res = 0;
+
+    core_sysdep_tls_arena_get_stats(&stats);
+    alloc_failed = stats.alloc_failed;
+    _core_sysdep_tls_arena_set_phase(CORE_TLS_ARENA_PHASE_CERT_PARSE);
+
+    res = _core_sysdep_network_mbedtls_handshake(network_handle);
+
+    core_sysdep_tls_arena_get_stats(&stats);
+    if (res < STATE_SUCCESS) {
+        if (stats.alloc_failed != alloc_failed) {
+            printf("tls arena exhausted, %u bytes requested, peak %u of %u bytes, increase AT_TLS_ARENA_LEN\n",
+                   (unsigned int)stats.failed_len, (unsigned int)stats.peak, (unsigned int)stats.size);
+            res = STATE_PORT_TLS_ARENA_EXHAUSTED;
+        }
+        return res;
+    }
+    _core_sysdep_tls_arena_set_phase(CORE_TLS_ARENA_PHASE_STEADY);
+
+    printf("success to establish mbedtls connection(tls arena peak %u/%u/%u of %u bytes)\n",
+           (unsigned int)stats.phase[CORE_TLS_ARENA_PHASE_CERT_PARSE].peak,
+           (unsigned int)stats.phase[CORE_TLS_ARENA_PHASE_KEY_EXCHANGE].peak, (unsigned int)stats.used,
+           (unsigned int)stats.size);
+
+    return STATE_SUCCESS;
+}
+#endif
+
 int32_t core_sysdep_network_establish(void *handle)
 {
     core_network_handle_t *network_handle = (core_network_handle_t *)handle;
@@ -184,6 +759,11 @@ int32_t core_sysdep_network_establish(void *handle)
             if (network_handle->cred->option == AIOT_SYSDEP_NETWORK_CRED_NONE) {
                 return _core_sysdep_network_tcp_establish(network_handle);
             }
+#ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+            else {
+                return _core_sysdep_network_mbedtls_establish(network_handle);
+            }
+#endif
         }
 
     } else if (network_handle->socket_type == CORE_SYSDEP_SOCKET_TCP_SERVER) {
@@ -210,25 +790,66 @@ static int32_t _core_sysdep_network_tcp_recv(core_network_handle_t *network_hand
     memset(&buf, 0, sizeof(aiot_at_buf_t));
 
     timestart_ms = core_sysdep_time();
-    do {
-        timenow_ms = core_sysdep_time();
-        if (timeout_ms - (timenow_ms - timestart_ms) > timeout_ms) {
-            timestart_ms = timenow_ms;
-        }
-
+    while (1) {
         buf.buf = buffer + recv_bytes;
         buf.len = len - recv_bytes;
         res = aiot_at_recv(network_handle->at_handle, AIOT_ATRECVOPT_BUF, &buf);
         if (res < STATE_SUCCESS) {
             return STATE_PORT_NETWORK_RECV_CONNECTION_CLOSED;
+        }
+        recv_bytes += res;
+        if (recv_bytes >= len) {
+            break;
+        }
+
+        timenow_ms = core_sysdep_time();
+        if (timestart_ms > timenow_ms) {
+            timestart_ms = timenow_ms;
+        }
+        if (timenow_ms - timestart_ms >= timeout_ms) {
+            break;
+        }
+        _core_sysdep_network_wait_event(network_handle, timeout_ms - (timenow_ms - timestart_ms));
+    }
+
+    return recv_bytes;
+}
+
+#ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+static int32_t _core_sysdep_network_mbedtls_recv(core_network_handle_t *network_handle, uint8_t *buffer, uint32_t len,
+        uint32_t timeout_ms)
+{
+    int res = 0;
+    int32_t recv_bytes = 0;
+
+    mbedtls_ssl_conf_read_timeout(&network_handle->mbedtls.ssl_config, timeout_ms);
+    do {
+        res = mbedtls_ssl_read(&network_handle->mbedtls.ssl_ctx, buffer + recv_bytes, len - recv_bytes);
+        if (res < 0) {
+            if (res == MBEDTLS_ERR_SSL_TIMEOUT || res == MBEDTLS_ERR_SSL_WANT_READ || res == MBEDTLS_ERR_SSL_WANT_WRITE) {
+                break;
+            }
+            if (recv_bytes == 0) {
+                printf("mbedtls_ssl_recv error, res: -0x%04X\n", -res);
+                if (res == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY || res == MBEDTLS_ERR_SSL_CONN_EOF) {
+                    return STATE_PORT_TLS_RECV_CONNECTION_CLOSED;
+                } else if (res == MBEDTLS_ERR_SSL_INVALID_RECORD) {
+                    return STATE_PORT_TLS_INVALID_RECORD;
+                } else {
+                    return STATE_PORT_TLS_RECV_FAILED;
+                }
+            }
+            break;
+        } else if (res == 0) {
+            break;
         } else {
             recv_bytes += res;
         }
-        vTaskDelay(AT_RINGBUF_ACCESS_INTERVAL_MS / portTICK_PERIOD_MS);
-    } while ((timenow_ms - timestart_ms < timeout_ms) && (recv_bytes < len));
+    } while (recv_bytes < len);
 
     return recv_bytes;
 }
+#endif
 
 int32_t core_sysdep_network_recv(void *handle, uint8_t *buffer, uint32_t len, uint32_t timeout_ms,
                                  core_sysdep_addr_t *addr)
@@ -250,6 +871,11 @@ int32_t core_sysdep_network_recv(void *handle, uint8_t *buffer, uint32_t len, ui
             if (network_handle->cred->option == AIOT_SYSDEP_NETWORK_CRED_NONE) {
                 return _core_sysdep_network_tcp_recv(network_handle, buffer, len, timeout_ms);
             }
+#ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+            else {
+                return _core_sysdep_network_mbedtls_recv(network_handle, buffer, len, timeout_ms);
+            }
+#endif
         }
     } else if (network_handle->socket_type == CORE_SYSDEP_SOCKET_TCP_SERVER) {
         return STATE_PORT_TCP_SERVER_NOT_IMPLEMENT;
@@ -276,22 +902,30 @@ int32_t _core_sysdep_network_tcp_send(core_network_handle_t *network_handle, uin
     memset(&buf, 0, sizeof(aiot_at_buf_t));
 
     timestart_ms = core_sysdep_time();
-    do {
-        timenow_ms = core_sysdep_time();
-        if (timeout_ms - (timenow_ms - timestart_ms) > timeout_ms) {
-            timestart_ms = timenow_ms;
-        }
-
+    while (1) {
         buf.buf = buffer + send_bytes;
         buf.len = len - send_bytes;
         res = aiot_at_send(network_handle->at_handle, AIOT_ATSENDOPT_BUF, &buf);
         if (res < STATE_SUCCESS) {
             return STATE_PORT_NETWORK_SEND_CONNECTION_CLOSED;
-        } else {
-            send_bytes += res;
         }
-        vTaskDelay(AT_RINGBUF_ACCESS_INTERVAL_MS / portTICK_PERIOD_MS);
-    } while ((timenow_ms - timestart_ms < timeout_ms) && (send_bytes < len));
+        send_bytes += res;
+        if (send_bytes >= len) {
+            break;
+        }
+
+        timenow_ms = core_sysdep_time();
+        if (timestart_ms > timenow_ms) {
+            timestart_ms = timenow_ms;
+        }
+        if (timenow_ms - timestart_ms >= timeout_ms) {
+            break;
+        }
+        /* 只发出了一部分时立即继续发送, 一个字节都没有发出时才等待后重试 */
+        if (res == 0) {
+            vTaskDelay(AT_SEND_RETRY_INTERVAL_MS / portTICK_PERIOD_MS);
+        }
+    }
 
     res = _core_sysdep_network_wait_response(network_handle, AIOT_ATRECVOPT_SEND_RESP, &result);
     if (res < STATE_SUCCESS) {
@@ -304,6 +938,66 @@ int32_t _core_sysdep_network_tcp_send(core_network_handle_t *network_handle, uin
     return send_bytes;
 }
 
+#ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+static int32_t _core_sysdep_network_mbedtls_send(core_network_handle_t *network_handle, uint8_t *buffer, uint32_t len,
+        uint32_t timeout_ms)
+{
+    int32_t res = 0;
+    int32_t send_bytes = 0;
+    uint32_t record_len = len;
+    uint64_t timestart_ms = 0, timenow_ms = 0;
+
+#if AT_TLS_BATCH_LEN > 0
+    /*
+     * 每条记录加上记录头、MAC和填充后不超过一条发送指令.
+     * mbedtls_ssl_get_record_expansion没有计入CBC套件的显式IV, 再留出MBEDTLS_MAX_IV_LENGTH字节
+     */
+    res = mbedtls_ssl_get_record_expansion(&network_handle->mbedtls.ssl_ctx);
+    if (res > 0 && res + MBEDTLS_MAX_IV_LENGTH < AT_SEND_MAX_LEN) {
+        record_len = AT_SEND_MAX_LEN - res - MBEDTLS_MAX_IV_LENGTH;
+    }
+#endif
+    network_handle->mbedtls.io_timeout_ms = timeout_ms;
+
+    timestart_ms = core_sysdep_time();
+    do {
+        res = mbedtls_ssl_write(&network_handle->mbedtls.ssl_ctx, buffer + send_bytes,
+                                (len - send_bytes < record_len) ? len - send_bytes : record_len);
+        if (res < 0) {
+            if (res != MBEDTLS_ERR_SSL_WANT_READ && res != MBEDTLS_ERR_SSL_WANT_WRITE) {
+                if (send_bytes == 0) {
+                    printf("mbedtls_ssl_send error, res: -0x%04X\n", -res);
+                    if (res == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) {
+                        return STATE_PORT_TLS_SEND_CONNECTION_CLOSED;
+                    } else if (res == MBEDTLS_ERR_SSL_INVALID_RECORD) {
+                        return STATE_PORT_TLS_INVALID_RECORD;
+                    } else {
+                        return STATE_PORT_TLS_SEND_FAILED;
+                    }
+                }
+                break;
+            }
+        } else if (res == 0) {
+            break;
+        } else {
+            send_bytes += res;
+        }
+
+        timenow_ms = core_sysdep_time();
+        if (timestart_ms > timenow_ms) {
+            timestart_ms = timenow_ms;
+        }
+    } while (((timenow_ms - timestart_ms) < timeout_ms) && (send_bytes < len));
+
+    /* 最后一条记录可能还在暂存区中 */
+    if (_core_sysdep_at_tls_flush(network_handle) != 0 && send_bytes == 0) {
+        return STATE_PORT_TLS_SEND_FAILED;
+    }
+
+    return send_bytes;
+}
+#endif
+
 int32_t core_sysdep_network_send(void *handle, uint8_t *buffer, uint32_t len, uint32_t timeout_ms,
                                  core_sysdep_addr_t *addr)
 {
@@ -324,6 +1018,11 @@ int32_t core_sysdep_network_send(void *handle, uint8_t *buffer, uint32_t len, ui
             if (network_handle->cred->option == AIOT_SYSDEP_NETWORK_CRED_NONE) {
                 return _core_sysdep_network_tcp_send(network_handle, buffer, len, timeout_ms);
             }
+#ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+            else {
+                return _core_sysdep_network_mbedtls_send(network_handle, buffer, len, timeout_ms);
+            }
+#endif
         }
     } else if (network_handle->socket_type == CORE_SYSDEP_SOCKET_TCP_SERVER) {
         return STATE_PORT_TCP_SERVER_NOT_IMPLEMENT;
@@ -340,30 +1039,33 @@ int32_t core_sysdep_network_send(void *handle, uint8_t *buffer, uint32_t len, ui
 
 static void _core_sysdep_network_tcp_disconnect(core_network_handle_t *network_handle)
 {
-    int32_t res = STATE_SUCCESS;
-    uint64_t timestart_ms = 0;
     uint8_t result = 0;
 
     aiot_at_send(network_handle->at_handle, AIOT_ATSENDOPT_DISCONNECT_REQ, NULL);
+    _core_sysdep_network_wait_response(network_handle, AIOT_ATRECVOPT_DISCONNECT_RESP, &result);
 
-    while (1) {
-        if (timestart_ms > core_sysdep_time()) {
-            timestart_ms = core_sysdep_time();
-        }
-        if (core_sysdep_time() - timestart_ms > network_handle->connect_timeout_ms) {
-            break;
-        }
+    aiot_at_deinit(&network_handle->at_handle);
+}
 
-        res = aiot_at_recv(network_handle->at_handle, AIOT_ATRECVOPT_DISCONNECT_RESP, &result);
-        if (res == STATE_SUCCESS && result == 1) {
-            res = STATE_SUCCESS;
-            break;
-        }
-        vTaskDelay(AT_RINGBUF_ACCESS_INTERVAL_MS / portTICK_PERIOD_MS);
+#ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+static void _core_sysdep_network_mbedtls_disconnect(core_network_handle_t *network_handle)
+{
+    network_handle->mbedtls.io_timeout_ms = network_handle->connect_timeout_ms;
+    mbedtls_ssl_close_notify(&network_handle->mbedtls.ssl_ctx);
+    _core_sysdep_at_tls_flush(network_handle);
+    _core_sysdep_network_tcp_disconnect(network_handle);
+
+    mbedtls_x509_crt_free(&network_handle->mbedtls.x509_server_cert);
+    mbedtls_x509_crt_free(&network_handle->mbedtls.x509_client_cert);
+    mbedtls_pk_free(&network_handle->mbedtls.x509_client_pk);
+    mbedtls_ssl_free(&network_handle->mbedtls.ssl_ctx);
+    mbedtls_ssl_config_free(&network_handle->mbedtls.ssl_config);
+    if (network_handle->mbedtls.batch != NULL) {
+        _core_mbedtls_free(network_handle->mbedtls.batch);
+        network_handle->mbedtls.batch = NULL;
     }
-
-    aiot_at_deinit(&network_handle->at_handle);
 }
+#endif
 
 int32_t core_sysdep_network_deinit(void **handle)
 {
@@ -381,6 +1083,11 @@ int32_t core_sysdep_network_deinit(void **handle)
             if (network_handle->cred->option == AIOT_SYSDEP_NETWORK_CRED_NONE) {
                 _core_sysdep_network_tcp_disconnect(network_handle);
             }
+#ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+            else {
+                _core_sysdep_network_mbedtls_disconnect(network_handle);
+            }
+#endif
         }
     }
 
@@ -393,6 +1100,18 @@ int32_t core_sysdep_network_deinit(void **handle)
         vPortFree(network_handle->cred);
         network_handle->cred = NULL;
     }
+#ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+    if (network_handle->psk.psk_id != NULL) {
+        vPortFree(network_handle->psk.psk_id);
+    }
+    if (network_handle->psk.psk != NULL) {
+        vPortFree(network_handle->psk.psk);
+    }
+#endif
+    if (network_handle->at_handle != NULL) {
+        aiot_at_deinit(&network_handle->at_handle);
+    }
+    vSemaphoreDelete(network_handle->event_sem);
 
     vPortFree(network_handle);
     *handle = NULL;
@@ -402,6 +1121,20 @@ int32_t core_sysdep_network_deinit(void **handle)
 
 void core_sysdep_rand(uint8_t *output, uint32_t output_len)
 {
+#ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+    uint32_t idx = 0;
+
+    /* DRBG不可用时直接从熵源取, 熵源也不可用时退回到rand(), 不能返回固定的输出 */
+    if (_core_sysdep_drbg_random(NULL, output, output_len) == 0 || core_sysdep_entropy_poll(output, output_len) == 0) {
+        return;
+    }
+    printf("core_sysdep_rand failed\n");
+
+    srand((unsigned int)xTaskGetTickCount() + rand());
+    for (idx = 0; idx < output_len; idx++) {
+        output[idx] = (uint8_t)(rand() >> 7);
+    }
+#else
     // uint32_t idx = 0, bytes = 0, rand_num = 0;
     // struct timeval time;
 
@@ -421,6 +1154,7 @@ void core_sysdep_rand(uint8_t *output, uint32_t output_len)
     //      output[idx++] = (uint8_t)(rand_num >> bytes * 8);
     //  }
     // }
+#endif
 }
 
 void *core_sysdep_mutex_init(void)
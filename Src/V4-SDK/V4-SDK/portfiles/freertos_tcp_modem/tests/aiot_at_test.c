@@ -1,10 +1,12 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <sys/time.h>
 #include "cu_test.h"
 #include "aiot_state_api.h"
 #include "aiot_sysdep_api.h"
 #include "aiot_at_api.h"
+#include "core_sha256.h"
 
 /* 位于portfiles/aiot_port文件夹下的系统适配函数集合 */
 extern aiot_sysdep_portfile_t g_aiot_sysdep_portfile;
@@ -265,10 +267,781 @@ CASEs(PORTFILES_AT, case_04_aiot_at_input_recv)
     ASSERT_EQ(recv_value, input_value);
 }
 
+CASEs(PORTFILES_AT, case_05_aiot_at_input_demux)
+{
+    int32_t res = STATE_SUCCESS;
+    void *link_handle = NULL;
+    uint8_t buf[16] = {0};
+    aiot_at_buf_t input_buf = {
+        .buf = (uint8_t *)"hello",
+        .len = 5
+    };
+    aiot_at_buf_t recv_buf = {
+        .buf = buf,
+        .len = sizeof(buf)
+    };
+
+    link_handle = aiot_at_init();
+    ASSERT_NOT_NULL(link_handle);
+    aiot_at_setopt(data->at_handle, AIOT_ATOPT_SOCKET_ID, (void *)"1");
+    aiot_at_setopt(link_handle, AIOT_ATOPT_SOCKET_ID, (void *)"2");
+
+    res = aiot_at_input("2", AIOT_ATRECVOPT_BUF, (void *)&input_buf);
+    ASSERT_EQ(res, 5);
+    ASSERT_EQ(aiot_at_recv(data->at_handle, AIOT_ATRECVOPT_BUF, (void *)&recv_buf), 0);
+    ASSERT_EQ(aiot_at_recv(link_handle, AIOT_ATRECVOPT_BUF, (void *)&recv_buf), 5);
+
+    /* 重新绑定后旧的link id不再指向该句柄 */
+    aiot_at_setopt(link_handle, AIOT_ATOPT_SOCKET_ID, (void *)"3");
+    ASSERT_EQ(aiot_at_input("2", AIOT_ATRECVOPT_BUF, (void *)&input_buf), STATE_AT_UNKNOWN_SOCKET_ID);
+    ASSERT_EQ(aiot_at_input("3", AIOT_ATRECVOPT_BUF, (void *)&input_buf), 5);
+
+    /* 非数字的socket id仍然按字符串匹配 */
+    aiot_at_setopt(link_handle, AIOT_ATOPT_SOCKET_ID, (void *)"tcp-a");
+    ASSERT_EQ(aiot_at_input("tcp-a", AIOT_ATRECVOPT_BUF, (void *)&input_buf), 5);
+    ASSERT_EQ(aiot_at_input("3", AIOT_ATRECVOPT_BUF, (void *)&input_buf), STATE_AT_UNKNOWN_SOCKET_ID);
+
+    aiot_at_deinit(&link_handle);
+    ASSERT_EQ(aiot_at_input("tcp-a", AIOT_ATRECVOPT_BUF, (void *)&input_buf), STATE_AT_UNKNOWN_SOCKET_ID);
+}
+
+#define CASE_06_HANDLE_NUM      (4)
+#define CASE_06_INPUT_COUNT     (200000)
+#define CASE_06_CHUNK_LEN       (64)
+
+CASEs(PORTFILES_AT, case_06_aiot_at_input_benchmark)
+{
+    int32_t res = STATE_SUCCESS;
+    uint32_t idx = 0;
+    void *handles[CASE_06_HANDLE_NUM] = {NULL};
+    char socket_id[4] = {0};
+    uint8_t chunk[CASE_06_CHUNK_LEN] = {0};
+    uint8_t buf[CASE_06_CHUNK_LEN] = {0};
+    aiot_at_buf_t input_buf = {
+        .buf = chunk,
+        .len = sizeof(chunk)
+    };
+    aiot_at_buf_t recv_buf = {
+        .buf = buf,
+        .len = sizeof(buf)
+    };
+    struct timeval start, end;
+    uint64_t elapsed_us = 0;
+
+    handles[0] = data->at_handle;
+    for (idx = 0; idx < CASE_06_HANDLE_NUM; idx++) {
+        if (handles[idx] == NULL) {
+            handles[idx] = aiot_at_init();
+        }
+        snprintf(socket_id, sizeof(socket_id), "%u", idx);
+        aiot_at_setopt(handles[idx], AIOT_ATOPT_SOCKET_ID, (void *)socket_id);
+    }
+
+    /* 数据总是发往最后绑定的socket, 模拟下载时只有一路连接在收数据 */
+    snprintf(socket_id, sizeof(socket_id), "%u", CASE_06_HANDLE_NUM - 1);
+    gettimeofday(&start, NULL);
+    for (idx = 0; idx < CASE_06_INPUT_COUNT; idx++) {
+        res = aiot_at_input(socket_id, AIOT_ATRECVOPT_BUF, (void *)&input_buf);
+        if (res != CASE_06_CHUNK_LEN) {
+            break;
+        }
+        aiot_at_recv(handles[CASE_06_HANDLE_NUM - 1], AIOT_ATRECVOPT_BUF, (void *)&recv_buf);
+    }
+    gettimeofday(&end, NULL);
+    elapsed_us = (end.tv_sec - start.tv_sec) * 1000000ULL + end.tv_usec - start.tv_usec;
+
+    printf("aiot_at_input: %u chunks of %u bytes in %llu us, %.1f ns/chunk, %.1f MB/s\n", CASE_06_INPUT_COUNT,
+           CASE_06_CHUNK_LEN, (unsigned long long)elapsed_us, elapsed_us * 1000.0 / CASE_06_INPUT_COUNT,
+           (double)CASE_06_INPUT_COUNT * CASE_06_CHUNK_LEN / (elapsed_us ? elapsed_us : 1));
+
+    for (idx = 1; idx < CASE_06_HANDLE_NUM; idx++) {
+        aiot_at_deinit(&handles[idx]);
+    }
+    ASSERT_EQ(res, CASE_06_CHUNK_LEN);
+}
+
+#define CASE_07_ROUNDS              (20)
+#define CASE_07_POLL_INTERVAL_MS    (50)
+
+typedef struct {
+    void *at_handle;
+    uint8_t use_event;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint32_t events;
+    volatile uint64_t input_us;
+    volatile uint32_t received;
+    uint64_t latency_us;
+} case_07_ctx_t;
+
+static uint64_t case_07_now_us(void)
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    return now.tv_sec * 1000000ULL + now.tv_usec;
+}
+
+static void case_07_event_handler(void *handle, aiot_at_recv_option_t option, void *userdata)
+{
+    case_07_ctx_t *ctx = (case_07_ctx_t *)userdata;
+
+    pthread_mutex_lock(&ctx->mutex);
+    ctx->events++;
+    pthread_cond_signal(&ctx->cond);
+    pthread_mutex_unlock(&ctx->mutex);
+}
+
+/* 模拟portfile的recv: 事件模式下阻塞等待通知, 轮询模式下每50ms读一次 */
+static void *case_07_reader_thread(void *args)
+{
+    case_07_ctx_t *ctx = (case_07_ctx_t *)args;
+    uint8_t byte = 0;
+    aiot_at_buf_t recv_buf = {
+        .buf = &byte,
+        .len = 1
+    };
+    struct timespec deadline;
+    uint64_t deadline_us = 0;
+
+    while (ctx->received < CASE_07_ROUNDS) {
+        if (aiot_at_recv(ctx->at_handle, AIOT_ATRECVOPT_BUF, (void *)&recv_buf) > 0) {
+            ctx->latency_us += case_07_now_us() - ctx->input_us;
+            ctx->received++;
+            continue;
+        }
+        if (ctx->use_event) {
+            deadline_us = case_07_now_us() + CASE_07_POLL_INTERVAL_MS * 1000;
+            deadline.tv_sec = deadline_us / 1000000;
+            deadline.tv_nsec = (deadline_us % 1000000) * 1000;
+            pthread_mutex_lock(&ctx->mutex);
+            if (ctx->events == 0) {
+                pthread_cond_timedwait(&ctx->cond, &ctx->mutex, &deadline);
+            }
+            ctx->events = 0;
+            pthread_mutex_unlock(&ctx->mutex);
+        } else {
+            usleep(CASE_07_POLL_INTERVAL_MS * 1000);
+        }
+    }
+    return NULL;
+}
+
+static uint64_t case_07_measure(case_07_ctx_t *ctx, uint8_t use_event)
+{
+    uint32_t idx = 0;
+    pthread_t reader;
+    aiot_at_buf_t input_buf = {
+        .buf = (uint8_t *)"x",
+        .len = 1
+    };
+
+    ctx->use_event = use_event;
+    ctx->received = 0;
+    ctx->latency_us = 0;
+    pthread_create(&reader, NULL, case_07_reader_thread, ctx);
+    for (idx = 0; idx < CASE_07_ROUNDS; idx++) {
+        /* 数据在轮询周期内的不同时刻到达 */
+        usleep(((idx * 37) % CASE_07_POLL_INTERVAL_MS) * 1000);
+        ctx->input_us = case_07_now_us();
+        aiot_at_input("0", AIOT_ATRECVOPT_BUF, (void *)&input_buf);
+        while (ctx->received <= idx) {
+            usleep(100);
+        }
+    }
+    pthread_join(reader, NULL);
+
+    return ctx->latency_us / CASE_07_ROUNDS;
+}
+
+CASEs(PORTFILES_AT, case_07_aiot_at_event_latency)
+{
+    uint64_t poll_latency_us = 0, event_latency_us = 0;
+    case_07_ctx_t ctx;
+
+    memset(&ctx, 0, sizeof(case_07_ctx_t));
+    ctx.at_handle = data->at_handle;
+    pthread_mutex_init(&ctx.mutex, NULL);
+    pthread_cond_init(&ctx.cond, NULL);
+
+    aiot_at_setopt(data->at_handle, AIOT_ATOPT_SOCKET_ID, (void *)"0");
+    aiot_at_setopt(data->at_handle, AIOT_ATOPT_USERDATA, (void *)&ctx);
+    aiot_at_setopt(data->at_handle, AIOT_ATOPT_EVENT_HANDLER, (void *)case_07_event_handler);
+
+    poll_latency_us = case_07_measure(&ctx, 0);
+    event_latency_us = case_07_measure(&ctx, 1);
+    printf("input to recv latency: polling every %d ms %llu us, event notified %llu us\n", CASE_07_POLL_INTERVAL_MS,
+           (unsigned long long)poll_latency_us, (unsigned long long)event_latency_us);
+
+    pthread_cond_destroy(&ctx.cond);
+    pthread_mutex_destroy(&ctx.mutex);
+    ASSERT_LT(event_latency_us, poll_latency_us);
+}
+
+/*
+ * 模组模拟器: 发送函数按CASE_08_UART_US_PER_BYTE模拟uart发送耗时, 模组线程随后按顺序回复不带socket标识的"SEND OK"
+ */
+#define CASE_08_UART_US_PER_BYTE    (2)
+#define CASE_08_ACK_DELAY_US        (500)
+#define CASE_08_OTA_WRITE_LEN       (16 * 1024)
+#define CASE_08_OTA_WRITE_NUM       (8)
+#define CASE_08_TELEMETRY_LEN       (100)
+#define CASE_08_TELEMETRY_NUM       (20)
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint32_t pending_ack;
+    uint8_t running;
+    uint32_t uart_bytes[2];
+} case_08_modem_t;
+
+typedef struct {
+    void *at_handle;
+    uint32_t write_len;
+    uint32_t write_num;
+    uint32_t interval_us;
+    uint32_t acked;
+    uint64_t max_latency_us;
+    uint64_t elapsed_us;
+} case_08_socket_t;
+
+static case_08_modem_t case_08_modem;
+
+static int32_t case_08_send_buf_handler(char *socket_id, aiot_at_buf_t *buf)
+{
+    usleep(buf->len * CASE_08_UART_US_PER_BYTE);
+    pthread_mutex_lock(&case_08_modem.mutex);
+    case_08_modem.uart_bytes[socket_id[0] - '0'] += buf->len;
+    case_08_modem.pending_ack++;
+    pthread_cond_signal(&case_08_modem.cond);
+    pthread_mutex_unlock(&case_08_modem.mutex);
+    return buf->len;
+}
+
+static void *case_08_modem_thread(void *args)
+{
+    uint8_t ok = 1;
+
+    pthread_mutex_lock(&case_08_modem.mutex);
+    while (case_08_modem.running || case_08_modem.pending_ack > 0) {
+        if (case_08_modem.pending_ack == 0) {
+            pthread_cond_wait(&case_08_modem.cond, &case_08_modem.mutex);
+            continue;
+        }
+        case_08_modem.pending_ack--;
+        pthread_mutex_unlock(&case_08_modem.mutex);
+        usleep(CASE_08_ACK_DELAY_US);
+        aiot_at_input(NULL, AIOT_ATRECVOPT_SEND_RESP, (void *)&ok);
+        pthread_mutex_lock(&case_08_modem.mutex);
+    }
+    pthread_mutex_unlock(&case_08_modem.mutex);
+    return NULL;
+}
+
+/* 与freertos_tcp_modem_port中的发送流程一致: 发完全部数据后等待应答 */
+static void *case_08_socket_thread(void *args)
+{
+    case_08_socket_t *sock = (case_08_socket_t *)args;
+    static uint8_t payload[CASE_08_OTA_WRITE_LEN];
+    uint32_t idx = 0, sent = 0, waited_us = 0;
+    int32_t res = 0;
+    uint8_t result = 0;
+    uint64_t start_us = 0, latency_us = 0, first_us = case_07_now_us();
+    aiot_at_buf_t buf;
+
+    for (idx = 0; idx < sock->write_num; idx++) {
+        usleep(sock->interval_us);
+        start_us = case_07_now_us();
+        for (sent = 0; sent < sock->write_len; sent += res) {
+            buf.buf = payload + sent;
+            buf.len = sock->write_len - sent;
+            res = aiot_at_send(sock->at_handle, AIOT_ATSENDOPT_BUF, &buf);
+            if (res < 0) {
+                return NULL;
+            }
+        }
+        for (waited_us = 0, result = 0; result == 0 && waited_us < 2000000; waited_us += 100) {
+            aiot_at_recv(sock->at_handle, AIOT_ATRECVOPT_SEND_RESP, &result);
+            if (result == 0) {
+                usleep(100);
+            }
+        }
+        if (result == 0) {
+            return NULL;
+        }
+        sock->acked++;
+        latency_us = case_07_now_us() - start_us;
+        if (latency_us > sock->max_latency_us) {
+            sock->max_latency_us = latency_us;
+        }
+    }
+    sock->elapsed_us = case_07_now_us() - first_us;
+    return NULL;
+}
+
+static void case_08_run(void *ota_handle, void *telemetry_handle, uint32_t chunk_len, case_08_socket_t *ota,
+                        case_08_socket_t *telemetry)
+{
+    pthread_t modem, ota_thread, telemetry_thread;
+
+    memset(ota, 0, sizeof(case_08_socket_t));
+    memset(telemetry, 0, sizeof(case_08_socket_t));
+    ota->at_handle = ota_handle;
+    ota->write_len = CASE_08_OTA_WRITE_LEN;
+    ota->write_num = CASE_08_OTA_WRITE_NUM;
+    telemetry->at_handle = telemetry_handle;
+    telemetry->write_len = CASE_08_TELEMETRY_LEN;
+    telemetry->write_num = CASE_08_TELEMETRY_NUM;
+    telemetry->interval_us = 10 * 1000;
+    aiot_at_setopt(ota_handle, AIOT_ATOPT_SEND_CHUNK_LEN, (void *)&chunk_len);
+    aiot_at_setopt(telemetry_handle, AIOT_ATOPT_SEND_CHUNK_LEN, (void *)&chunk_len);
+
+    memset(case_08_modem.uart_bytes, 0, sizeof(case_08_modem.uart_bytes));
+    case_08_modem.running = 1;
+    pthread_create(&modem, NULL, case_08_modem_thread, NULL);
+
+    pthread_create(&ota_thread, NULL, case_08_socket_thread, ota);
+    pthread_create(&telemetry_thread, NULL, case_08_socket_thread, telemetry);
+    pthread_join(ota_thread, NULL);
+    pthread_join(telemetry_thread, NULL);
+
+    pthread_mutex_lock(&case_08_modem.mutex);
+    case_08_modem.running = 0;
+    pthread_cond_signal(&case_08_modem.cond);
+    pthread_mutex_unlock(&case_08_modem.mutex);
+    pthread_join(modem, NULL);
+
+    printf("chunk %5u: ota %u KB in %llu ms (%.1f KB/s), telemetry %u/%u acked, max latency %llu us\n", chunk_len,
+           case_08_modem.uart_bytes[0] / 1024, (unsigned long long)(ota->elapsed_us / 1000),
+           case_08_modem.uart_bytes[0] * 1000000.0 / 1024 / ota->elapsed_us, telemetry->acked, CASE_08_TELEMETRY_NUM,
+           (unsigned long long)telemetry->max_latency_us);
+}
+
+CASEs(PORTFILES_AT, case_08_aiot_at_two_socket_throughput)
+{
+    void *telemetry_handle = NULL;
+    case_08_socket_t ota, telemetry, ota_unchunked, telemetry_unchunked;
+    aiot_at_send_handler_t send_handler = {
+        .connect_handler = demo_case_02_at_send_connect_handler,
+        .send_handler = case_08_send_buf_handler,
+        .disconnect_handler = demo_case_02_at_send_disconnect_handler
+    };
+
+    memset(&case_08_modem, 0, sizeof(case_08_modem_t));
+    pthread_mutex_init(&case_08_modem.mutex, NULL);
+    pthread_cond_init(&case_08_modem.cond, NULL);
+    aiot_at_set_send_handler(&send_handler);
+
+    telemetry_handle = aiot_at_init();
+    aiot_at_setopt(data->at_handle, AIOT_ATOPT_SOCKET_ID, (void *)"0");
+    aiot_at_setopt(telemetry_handle, AIOT_ATOPT_SOCKET_ID, (void *)"1");
+
+    case_08_run(data->at_handle, telemetry_handle, 0, &ota_unchunked, &telemetry_unchunked);
+    case_08_run(data->at_handle, telemetry_handle, 1024, &ota, &telemetry);
+
+    aiot_at_deinit(&telemetry_handle);
+    send_handler.send_handler = demo_case_02_at_send_buf_handler;
+    aiot_at_set_send_handler(&send_handler);
+    pthread_cond_destroy(&case_08_modem.cond);
+    pthread_mutex_destroy(&case_08_modem.mutex);
+
+    /* 每一次发送的应答都回到了发出它的socket */
+    ASSERT_EQ(ota_unchunked.acked, CASE_08_OTA_WRITE_NUM);
+    ASSERT_EQ(telemetry_unchunked.acked, CASE_08_TELEMETRY_NUM);
+    ASSERT_EQ(ota.acked, CASE_08_OTA_WRITE_NUM);
+    ASSERT_EQ(telemetry.acked, CASE_08_TELEMETRY_NUM);
+    /* 分块发送后上报消息不必等待整段OTA数据 */
+    ASSERT_LT(telemetry.max_latency_us, telemetry_unchunked.max_latency_us);
+}
+
+static int32_t case_09_silent_logcb(int32_t code, char *message)
+{
+    return 0;
+}
+
+static uint32_t case_09_rand(uint32_t *seed)
+{
+    *seed = *seed * 1103515245u + 12345u;
+    return (*seed >> 16) & 0x7FFF;
+}
+
+/* 随机的写入/读取/查看/释放序列, 与一个简单的线性队列模型比较, 覆盖head和tail在各个位置绕回的情况 */
+CASEs(PORTFILES_AT, case_09_ringbuf_property)
+{
+    int32_t res = 0;
+    uint32_t ringbuf_lens[] = {2, 3, 7, 64, 1000};
+    uint32_t idx = 0, step = 0, seed = 20201019, len = 0, pos = 0, expect = 0;
+    uint8_t input[2048], output[2048], model[2048];
+    uint32_t model_len = 0, ringbuf_len = 0, next_byte = 0;
+    char *at_socket_id = "0";
+    aiot_at_buf_t buf, span[2];
+
+    aiot_state_set_logcb(case_09_silent_logcb);
+    aiot_at_setopt(data->at_handle, AIOT_ATOPT_SOCKET_ID, (void *)at_socket_id);
+
+    for (idx = 0; idx < sizeof(ringbuf_lens) / sizeof(uint32_t); idx++) {
+        ringbuf_len = ringbuf_lens[idx];
+        aiot_at_setopt(data->at_handle, AIOT_ATOPT_RING_BUF_LEN, (void *)&ringbuf_len);
+        model_len = 0;
+
+        for (step = 0; step < 20000; step++) {
+            len = case_09_rand(&seed) % (ringbuf_len * 2) + 1;
+            switch (case_09_rand(&seed) % 3) {
+                case 0: {
+                    for (pos = 0; pos < len; pos++) {
+                        input[pos] = (uint8_t)next_byte++;
+                    }
+                    buf.buf = input;
+                    buf.len = len;
+                    res = aiot_at_input(at_socket_id, AIOT_ATRECVOPT_BUF, (void *)&buf);
+                    expect = ringbuf_len - 1 - model_len;
+                    expect = (len < expect) ? len : expect;
+                    if (expect == 0) {
+                        ASSERT_EQ(res, STATE_AT_RINGBUF_OVERRUN);
+                    } else {
+                        ASSERT_EQ(res, (int32_t)expect);
+                    }
+                    memcpy(&model[model_len], input, expect);
+                    model_len += expect;
+                    next_byte -= len - expect;
+                }
+                break;
+                case 1: {
+                    buf.buf = output;
+                    buf.len = len;
+                    res = aiot_at_recv(data->at_handle, AIOT_ATRECVOPT_BUF, (void *)&buf);
+                    expect = (len < model_len) ? len : model_len;
+                    ASSERT_EQ(res, (int32_t)expect);
+                    ASSERT_EQ(memcmp(output, model, expect), 0);
+                    memmove(model, &model[expect], model_len - expect);
+                    model_len -= expect;
+                }
+                break;
+                default: {
+                    res = aiot_at_peek(data->at_handle, span);
+                    ASSERT_EQ(res, (int32_t)model_len);
+                    ASSERT_EQ(span[0].len + span[1].len, model_len);
+                    ASSERT_EQ(memcmp(span[0].buf, model, span[0].len), 0);
+                    ASSERT_EQ(memcmp(span[1].buf, &model[span[0].len], span[1].len), 0);
+                    if (span[1].len > 0) {
+                        ASSERT_EQ(span[0].len + (uint32_t)(span[0].buf - span[1].buf), ringbuf_len);
+                    }
+
+                    res = aiot_at_commit(data->at_handle, model_len + 1);
+                    ASSERT_EQ(res, STATE_USER_INPUT_OUT_RANGE);
+                    expect = (len < model_len) ? len : model_len;
+                    res = aiot_at_commit(data->at_handle, expect);
+                    ASSERT_EQ(res, STATE_SUCCESS);
+                    memmove(model, &model[expect], model_len - expect);
+                    model_len -= expect;
+                }
+                break;
+            }
+        }
+    }
+
+    aiot_state_set_logcb(aiot_at_test_logcb);
+}
+
+/* 直接在环形缓冲区上计算摘要, 结果与拷贝出来再计算一致 */
+CASEs(PORTFILES_AT, case_10_aiot_at_peek_digest)
+{
+    int32_t res = 0;
+    uint32_t ringbuf_len = 1024, text_len = (uint32_t)strlen(text), idx = 0;
+    uint8_t output[1024], expect_digest[CORE_SHA256_DIGEST_LENGTH], digest[CORE_SHA256_DIGEST_LENGTH];
+    char *at_socket_id = "0";
+    core_sha256_context_t ctx;
+    aiot_at_buf_t buf = {
+        .buf = (uint8_t *)text,
+        .len = text_len
+    };
+    aiot_at_buf_t span[2];
+
+    aiot_at_setopt(data->at_handle, AIOT_ATOPT_SOCKET_ID, (void *)at_socket_id);
+    aiot_at_setopt(data->at_handle, AIOT_ATOPT_RING_BUF_LEN, (void *)&ringbuf_len);
+
+    /* 先写入再读出一部分, 使后续数据跨越缓冲区末尾 */
+    res = aiot_at_input(at_socket_id, AIOT_ATRECVOPT_BUF, (void *)&buf);
+    ASSERT_EQ(res, (int32_t)text_len);
+    buf.buf = output;
+    res = aiot_at_recv(data->at_handle, AIOT_ATRECVOPT_BUF, (void *)&buf);
+    ASSERT_EQ(res, (int32_t)text_len);
+
+    core_sha256((uint8_t *)text, text_len, expect_digest);
+    for (idx = 0; idx < 2; idx++) {
+        buf.buf = (uint8_t *)text;
+        buf.len = text_len;
+        res = aiot_at_input(at_socket_id, AIOT_ATRECVOPT_BUF, (void *)&buf);
+        ASSERT_EQ(res, (int32_t)text_len);
+
+        res = aiot_at_peek(data->at_handle, span);
+        ASSERT_EQ(res, (int32_t)text_len);
+        if (idx == 0) {
+            ASSERT_GT(span[1].len, 0);
+        }
+
+        core_sha256_init(&ctx);
+        core_sha256_starts(&ctx);
+        core_sha256_update(&ctx, span[0].buf, span[0].len);
+        core_sha256_update(&ctx, span[1].buf, span[1].len);
+        core_sha256_finish(&ctx, digest);
+        core_sha256_free(&ctx);
+        ASSERT_EQ(memcmp(digest, expect_digest, sizeof(digest)), 0);
+
+        res = aiot_at_commit(data->at_handle, text_len);
+        ASSERT_EQ(res, STATE_SUCCESS);
+        res = aiot_at_peek(data->at_handle, span);
+        ASSERT_EQ(res, 0);
+    }
+}
+
+/*
+ * 模组模拟器: 每2ms突发到达4KB数据, 消费者每200us只读128字节, 到达速度远快于消费速度.
+ * 按需读取模式下数据缓存在模组中, SDK只请求缓冲区能容纳的字节数; 主动上报模式下缓冲区满后数据被丢弃
+ */
+#define CASE_11_TOTAL_LEN       (32 * 1024)
+#define CASE_11_BURST_LEN       (4096)
+#define CASE_11_BURST_US        (2000)
+#define CASE_11_CHUNK_LEN       (1460)
+
+typedef struct {
+    void *at_handle;
+    uint32_t recv_bytes;
+    uint32_t errors;
+    uint8_t running;
+} case_11_consumer_t;
+
+static pthread_mutex_t g_case_11_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t g_case_11_read_req;
+static pthread_t g_case_11_modem_thread;
+static uint32_t g_case_11_read_from_modem;
+
+static int32_t case_11_at_send_read_handler(char *socket_id, uint32_t len)
+{
+    pthread_mutex_lock(&g_case_11_mutex);
+    g_case_11_read_req = len;
+    /* 读取请求要占用send_mutex, 不能在调用aiot_at_input的接收任务中发出 */
+    if (pthread_equal(pthread_self(), g_case_11_modem_thread)) {
+        g_case_11_read_from_modem++;
+    }
+    pthread_mutex_unlock(&g_case_11_mutex);
+    return 0;
+}
+
+static uint8_t case_11_pattern(uint32_t offset)
+{
+    return (uint8_t)(offset % 251);
+}
+
+static void *case_11_consumer_thread(void *args)
+{
+    int32_t res = 0, idx = 0;
+    uint8_t buf[128];
+    aiot_at_buf_t recv_buf;
+    case_11_consumer_t *consumer = (case_11_consumer_t *)args;
+
+    while (consumer->running) {
+        recv_buf.buf = buf;
+        recv_buf.len = sizeof(buf);
+        res = aiot_at_recv(consumer->at_handle, AIOT_ATRECVOPT_BUF, (void *)&recv_buf);
+        for (idx = 0; idx < res; idx++) {
+            if (buf[idx] != case_11_pattern(consumer->recv_bytes + idx)) {
+                consumer->errors++;
+            }
+        }
+        if (res > 0) {
+            consumer->recv_bytes += res;
+        }
+        usleep(200);
+    }
+    return NULL;
+}
+
+static void case_11_input_buf(char *socket_id, uint32_t offset, uint32_t len)
+{
+    uint8_t chunk[CASE_11_CHUNK_LEN];
+    uint32_t idx = 0, chunk_len = 0;
+    aiot_at_buf_t buf;
+
+    while (len > 0) {
+        chunk_len = (len < CASE_11_CHUNK_LEN) ? len : CASE_11_CHUNK_LEN;
+        for (idx = 0; idx < chunk_len; idx++) {
+            chunk[idx] = case_11_pattern(offset + idx);
+        }
+        buf.buf = chunk;
+        buf.len = chunk_len;
+        aiot_at_input(socket_id, AIOT_ATRECVOPT_BUF, (void *)&buf);
+        offset += chunk_len;
+        len -= chunk_len;
+    }
+}
+
+static void case_11_run_modem(void *at_handle, uint8_t read_on_demand, case_11_consumer_t *consumer,
+                              aiot_at_stats_t *stats)
+{
+    char *at_socket_id = "0";
+    uint32_t ringbuf_len = 1024, ringbuf_max_len = 4096;
+    uint32_t arrived = 0, delivered = 0, buffered = 0, req = 0;
+    uint64_t start = case_07_now_us(), last_burst = 0;
+    pthread_t consumer_thread;
+
+    aiot_at_setopt(at_handle, AIOT_ATOPT_SOCKET_ID, (void *)at_socket_id);
+    aiot_at_setopt(at_handle, AIOT_ATOPT_RING_BUF_LEN, (void *)&ringbuf_len);
+    aiot_at_setopt(at_handle, AIOT_ATOPT_RING_BUF_MAX_LEN, (void *)&ringbuf_max_len);
+
+    memset(consumer, 0, sizeof(case_11_consumer_t));
+    consumer->at_handle = at_handle;
+    consumer->running = 1;
+    g_case_11_read_req = 0;
+    g_case_11_modem_thread = pthread_self();
+    g_case_11_read_from_modem = 0;
+    pthread_create(&consumer_thread, NULL, case_11_consumer_thread, (void *)consumer);
+
+    while (delivered < CASE_11_TOTAL_LEN && case_07_now_us() - start < 10 * 1000 * 1000) {
+        if (arrived < CASE_11_TOTAL_LEN && case_07_now_us() - last_burst >= CASE_11_BURST_US) {
+            last_burst = case_07_now_us();
+            arrived += CASE_11_BURST_LEN;
+            if (read_on_demand) {
+                buffered += CASE_11_BURST_LEN;
+                aiot_at_input(at_socket_id, AIOT_ATRECVOPT_DATA_AVAILABLE, (void *)&buffered);
+            } else {
+                case_11_input_buf(at_socket_id, delivered, CASE_11_BURST_LEN);
+                delivered += CASE_11_BURST_LEN;
+            }
+        }
+
+        pthread_mutex_lock(&g_case_11_mutex);
+        req = g_case_11_read_req;
+        g_case_11_read_req = 0;
+        pthread_mutex_unlock(&g_case_11_mutex);
+        if (req > 0) {
+            req = (req < buffered) ? req : buffered;
+            case_11_input_buf(at_socket_id, delivered, req);
+            delivered += req;
+            buffered -= req;
+            aiot_at_input(at_socket_id, AIOT_ATRECVOPT_READ_RESP, (void *)&buffered);
+        }
+        usleep(50);
+    }
+
+    /* 等待消费者读完缓冲区中的数据, 被丢弃的数据不会到达 */
+    aiot_at_get_stats(at_handle, stats);
+    while (consumer->recv_bytes + stats->overrun_bytes < delivered && case_07_now_us() - start < 10 * 1000 * 1000) {
+        usleep(1000);
+        aiot_at_get_stats(at_handle, stats);
+    }
+    usleep(10 * 1000);
+    consumer->running = 0;
+    pthread_join(consumer_thread, NULL);
+
+    aiot_at_get_stats(at_handle, stats);
+    printf("%s: received %u/%u bytes in %u ms, overrun %u times (%u bytes), %u read requests, "
+           "ringbuf high water %u, ringbuf len %u\n", read_on_demand ? "read on demand" : "push",
+           consumer->recv_bytes, CASE_11_TOTAL_LEN, (uint32_t)((case_07_now_us() - start) / 1000), stats->overrun_count,
+           stats->overrun_bytes, stats->read_requests, stats->ringbuf_high_water, stats->ringbuf_len);
+}
+
+CASEs(PORTFILES_AT, case_11_aiot_at_read_on_demand_backpressure)
+{
+    case_11_consumer_t consumer;
+    aiot_at_stats_t stats;
+    aiot_at_send_handler_t send_handler = {
+        .connect_handler = demo_case_02_at_send_connect_handler,
+        .send_handler = demo_case_02_at_send_buf_handler,
+        .disconnect_handler = demo_case_02_at_send_disconnect_handler,
+        .read_handler = NULL
+    };
+    void *push_handle = aiot_at_init();
+
+    aiot_state_set_logcb(case_09_silent_logcb);
+
+    /* 主动上报: 缓冲区扩大到上限后仍然放不下突发数据 */
+    case_11_run_modem(push_handle, 0, &consumer, &stats);
+    aiot_at_deinit(&push_handle);
+    ASSERT_GT(stats.overrun_count, 0);
+    ASSERT_GT(stats.overrun_bytes, 0);
+    ASSERT_EQ(consumer.recv_bytes + stats.overrun_bytes, CASE_11_TOTAL_LEN);
+
+    /* 按需读取: 不丢数据, 缓冲区在上限内扩大, 读空后恢复 */
+    send_handler.read_handler = case_11_at_send_read_handler;
+    aiot_at_set_send_handler(&send_handler);
+    case_11_run_modem(data->at_handle, 1, &consumer, &stats);
+    ASSERT_EQ(consumer.recv_bytes, CASE_11_TOTAL_LEN);
+    ASSERT_EQ(consumer.errors, 0);
+    ASSERT_EQ(stats.overrun_count, 0);
+    ASSERT_GT(stats.ringbuf_high_water, 1023);
+    ASSERT_EQ(stats.ringbuf_high_water <= 4095, 1);
+    ASSERT_EQ(stats.ringbuf_len, 1024);
+    ASSERT_EQ(g_case_11_read_from_modem, 0);
+
+    aiot_state_set_logcb(aiot_at_test_logcb);
+}
+
+/* 分段发送时中间某一段失败, 即使最后一段成功, 读到的应答也应是失败 */
+int32_t case_12_at_send_buf_handler(char *socket_id, aiot_at_buf_t *buf)
+{
+    return (int32_t)buf->len;
+}
+
+CASEs(PORTFILES_AT, case_12_aiot_at_send_resp_latch_failure)
+{
+    int32_t res = STATE_SUCCESS;
+    uint8_t payload[48] = {0};
+    aiot_at_buf_t buf = {
+        .buf = payload,
+        .len = sizeof(payload)
+    };
+    uint32_t chunk_len = 16, idx = 0;
+    uint8_t ok = 1, failed = 0, recv_value = 0;
+    aiot_at_send_handler_t send_handler = {
+        .connect_handler = demo_case_02_at_send_connect_handler,
+        .send_handler = case_12_at_send_buf_handler,
+        .disconnect_handler = demo_case_02_at_send_disconnect_handler
+    };
+
+    aiot_at_set_send_handler(&send_handler);
+    aiot_at_setopt(data->at_handle, AIOT_ATOPT_SOCKET_ID, (void *)"0");
+    aiot_at_setopt(data->at_handle, AIOT_ATOPT_SEND_CHUNK_LEN, (void *)&chunk_len);
+
+    for (idx = 0; idx < 3; idx++) {
+        res = aiot_at_send(data->at_handle, AIOT_ATSENDOPT_BUF, &buf);
+        ASSERT_EQ(res, (int32_t)chunk_len);
+    }
+    aiot_at_input(NULL, AIOT_ATRECVOPT_SEND_RESP, (void *)&failed);
+    aiot_at_input(NULL, AIOT_ATRECVOPT_SEND_RESP, (void *)&ok);
+    aiot_at_input(NULL, AIOT_ATRECVOPT_SEND_RESP, (void *)&ok);
+
+    recv_value = 1;
+    res = aiot_at_recv(data->at_handle, AIOT_ATRECVOPT_SEND_RESP, (void *)&recv_value);
+    ASSERT_EQ(res, STATE_SUCCESS);
+    ASSERT_EQ(recv_value, failed);
+
+    /* 失败只记录到这一轮的应答全部返回为止, 下一次发送重新计算 */
+    res = aiot_at_send(data->at_handle, AIOT_ATSENDOPT_BUF, &buf);
+    ASSERT_EQ(res, (int32_t)chunk_len);
+    aiot_at_input(NULL, AIOT_ATRECVOPT_SEND_RESP, (void *)&ok);
+    recv_value = 0;
+    res = aiot_at_recv(data->at_handle, AIOT_ATRECVOPT_SEND_RESP, (void *)&recv_value);
+    ASSERT_EQ(res, STATE_SUCCESS);
+    ASSERT_EQ(recv_value, ok);
+
+    send_handler.send_handler = demo_case_02_at_send_buf_handler;
+    aiot_at_set_send_handler(&send_handler);
+}
+
 SUITE(PORTFILES_AT) = {
     ADD_CASE(PORTFILES_AT, case_01_ringbuf),
     ADD_CASE(PORTFILES_AT, case_02_ringbuf_head_le_tail),
     ADD_CASE(PORTFILES_AT, case_03_aiot_at_send),
     ADD_CASE(PORTFILES_AT, case_04_aiot_at_input_recv),
+    ADD_CASE(PORTFILES_AT, case_05_aiot_at_input_demux),
+    ADD_CASE(PORTFILES_AT, case_06_aiot_at_input_benchmark),
+    ADD_CASE(PORTFILES_AT, case_07_aiot_at_event_latency),
+    ADD_CASE(PORTFILES_AT, case_08_aiot_at_two_socket_throughput),
+    ADD_CASE(PORTFILES_AT, case_09_ringbuf_property),
+    ADD_CASE(PORTFILES_AT, case_10_aiot_at_peek_digest),
+    ADD_CASE(PORTFILES_AT, case_11_aiot_at_read_on_demand_backpressure),
+    ADD_CASE(PORTFILES_AT, case_12_aiot_at_send_resp_latch_failure),
     ADD_CASE_NULL
 };
\ No newline at end of file
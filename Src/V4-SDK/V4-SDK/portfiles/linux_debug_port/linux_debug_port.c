@@ -5,13 +5,18 @@
 #include <string.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <time.h>
+#include <execinfo.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <netdb.h>
 #include <errno.h>
-#include "core_list.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/syscall.h>
+#include <poll.h>
 #include "aiot_state_api.h"
 #include "aiot_sysdep_api.h"
 
@@ -34,16 +39,52 @@
     #include "mbedtls/ctr_drbg.h"
     #include "mbedtls/debug.h"
     #include "mbedtls/platform.h"
+    #include "mbedtls/sha256.h"
 #endif
 
 #ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+typedef struct {
+    uint8_t type;
+    const char *source;         /* 证书的地址和长度 */
+    uint32_t source_len;
+    const char *key_source;     /* 私钥的地址和长度, 仅设备证书 */
+    uint32_t key_source_len;
+    core_sysdep_psk_t psk;      /* 仅PSK */
+} core_sysdep_tls_cred_key_t;
+
+/* 解析后的TLS凭据, 由凭据缓存管理, 见 _core_sysdep_tls_cred_acquire */
+typedef struct {
+    core_sysdep_tls_cred_key_t key;     /* PSK的字符串为缓存自己的拷贝 */
+    uint32_t refcnt;
+    uint32_t last_used;
+    uint32_t mem_used;
+    mbedtls_x509_crt crt;
+    mbedtls_pk_context pk;
+} core_sysdep_tls_cred_t;
+
+/* 建立TLS连接的进度, 非阻塞模式下每次调用establish从当前阶段继续 */
+#define CORE_SYSDEP_ESTABLISH_IDLE          (0)
+#define CORE_SYSDEP_ESTABLISH_CONNECTING    (1)
+#define CORE_SYSDEP_ESTABLISH_HANDSHAKING   (2)
+#define CORE_SYSDEP_ESTABLISH_DONE          (3)
+#define CORE_SYSDEP_ESTABLISH_FAILED        (4)
+
 typedef struct {
     mbedtls_net_context net_ctx;
     mbedtls_ssl_context ssl_ctx;
     mbedtls_ssl_config  ssl_config;
-    mbedtls_x509_crt    x509_server_cert;
-    mbedtls_x509_crt    x509_client_cert;
-    mbedtls_pk_context  x509_client_pk;
+    core_sysdep_tls_cred_t *ca_cred;
+    core_sysdep_tls_cred_t *client_cred;
+    uint8_t state;
+    uint8_t session_offered;
+    uint8_t session_master[48];
+    uint8_t session_cred_id[32];    /* 会话缓存按 host:port 和凭据查找, 见 _core_sysdep_tls_session_cred_id */
+    short events;                   /* 继续之前需要等待的socket事件 */
+    int32_t res;                    /* 失败后再次调用时返回的错误码 */
+    uint64_t start_us;
+    uint64_t handshake_start_us;
+    uint64_t progress_us;           /* 最近一次有进展的时刻, 据此判断超时 */
+    uint64_t step_start_us;
 } core_sysdep_mbedtls_t;
 #endif
 
@@ -55,34 +96,98 @@ typedef struct {
     uint16_t port;
     uint32_t connect_timeout_ms;
 #ifdef CORE_SYSDEP_MBEDTLS_ENABLED
-    core_sysdep_psk_t psk;
+    core_sysdep_tls_cred_t *psk_cred;
     core_sysdep_mbedtls_t mbedtls;
+    uint8_t nonblock;
+    core_sysdep_handshake_stats_t *handshake_stats;
 #endif
 } core_network_handle_t;
 
+/*
+ *  内存统计的开销需要足够小, 以便在长时间的浸泡测试和仿真器驱动的性能测试中一直打开
+ *
+ *  - 模块名在首次出现时驻留到模块表中, 之后先按指针比较, 指针不同时才比较字符串
+ *  - 存活的内存块记录在以指针为键的开放寻址哈希表中(线性探测, 删除时向前回填, 不留墓碑), 申请和释放都是O(1)
+ *  - 打开 CORE_MEMSTAT_OPTION_CALLER 后, 以调用者地址和模块为键统计每个调用点的峰值, 由 core_memstat_print_sites 输出
+ *  - 打开 CORE_MEMSTAT_OPTION_TIMELINE 后, 最近 CORE_MEMSTAT_TIMELINE_LEN 次申请和释放记录在环形缓冲区中,
+ *    由 core_memstat_dump_timeline 导出为CSV, 供离线分析
+ *
+ */
+#define CORE_MEMSTAT_OPTION_CALLER          (0x01)
+#define CORE_MEMSTAT_OPTION_TIMELINE        (0x02)
+
+#define CORE_MEMSTAT_MODULE_MAX             (32)
+#define CORE_MEMSTAT_SITE_MAX               (1024)      /* 必须是2的幂 */
+#define CORE_MEMSTAT_SITE_NONE              (0xFFFF)
+#define CORE_MEMSTAT_BLOCK_INIT_LEN         (256)       /* 必须是2的幂 */
+#define CORE_MEMSTAT_TIMELINE_LEN           (65536)
+
 typedef struct {
     void *ptr;
     uint32_t size;
-    struct core_list_head linked_node;
+    uint16_t module;
+    uint16_t site;
 } core_memstat_block_t;
 
 typedef struct {
+    const char *key;
     char *name;
     uint64_t in_use;
     uint64_t max_in_use;
     uint32_t max_allocated;
     uint64_t total_allocated;
-    struct core_list_head block_list;
-    struct core_list_head linked_node;
 } core_memstat_node_t;
 
+typedef struct {
+    void *caller;
+    uint16_t module;
+    uint32_t block_num;
+    uint64_t alloc_count;
+    uint64_t in_use;
+    uint64_t max_in_use;
+} core_memstat_site_t;
+
+typedef struct {
+    uint64_t time_us;
+    void *ptr;
+    uint32_t size;
+    uint16_t module;
+    uint16_t site;
+    uint64_t in_use;
+} core_memstat_event_t;
+
 typedef struct {
     pthread_mutex_t mutex;
-    struct core_list_head module_list;
+    uint32_t options;
+    core_memstat_node_t module[CORE_MEMSTAT_MODULE_MAX];
+    uint16_t module_num;
+    core_memstat_block_t *block;
+    uint32_t block_len;
+    uint32_t block_num;
+    core_memstat_site_t site[CORE_MEMSTAT_SITE_MAX];
+    uint16_t site_index[CORE_MEMSTAT_SITE_MAX];
+    uint32_t site_num;
+    uint64_t in_use;
+    core_memstat_event_t *timeline;
+    uint64_t timeline_count;
+    uint64_t timeline_start;
 } core_memstat_t;
 
 core_memstat_t *g_core_memstat = NULL;
 
+static uint64_t _core_memstat_time_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint32_t _core_memstat_hash(void *ptr, uint32_t mask)
+{
+    return (uint32_t)(((uint64_t)(uintptr_t)ptr * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
 void core_memstat_init(void)
 {
     if (g_core_memstat != NULL) {
@@ -95,29 +200,61 @@ void core_memstat_init(void)
         return;
     }
     memset(g_core_memstat, 0, sizeof(core_memstat_t));
+    memset(g_core_memstat->site_index, 0xFF, sizeof(g_core_memstat->site_index));
+
+    g_core_memstat->block = malloc(CORE_MEMSTAT_BLOCK_INIT_LEN * sizeof(core_memstat_block_t));
+    if (g_core_memstat->block == NULL) {
+        printf("malloc failed\n");
+        free(g_core_memstat);
+        g_core_memstat = NULL;
+        return;
+    }
+    memset(g_core_memstat->block, 0, CORE_MEMSTAT_BLOCK_INIT_LEN * sizeof(core_memstat_block_t));
+    g_core_memstat->block_len = CORE_MEMSTAT_BLOCK_INIT_LEN;
 
     if (0 != pthread_mutex_init(&g_core_memstat->mutex, NULL)) {
         perror("create mutex failed\n");
+        free(g_core_memstat->block);
         free(g_core_memstat);
         g_core_memstat = NULL;
         return;
     }
+}
+
+void core_memstat_set_option(uint32_t options)
+{
+    if (g_core_memstat == NULL) {
+        return;
+    }
 
-    CORE_INIT_LIST_HEAD(&g_core_memstat->module_list);
+    pthread_mutex_lock(&g_core_memstat->mutex);
+    if ((options & CORE_MEMSTAT_OPTION_TIMELINE) && g_core_memstat->timeline == NULL) {
+        g_core_memstat->timeline = malloc(CORE_MEMSTAT_TIMELINE_LEN * sizeof(core_memstat_event_t));
+        if (g_core_memstat->timeline == NULL) {
+            printf("malloc failed\n");
+            options &= ~CORE_MEMSTAT_OPTION_TIMELINE;
+        }
+        g_core_memstat->timeline_count = 0;
+        g_core_memstat->timeline_start = _core_memstat_time_us();
+    }
+    g_core_memstat->options = options;
+    pthread_mutex_unlock(&g_core_memstat->mutex);
 }
 
 void core_memstat_deinit(void)
 {
-    core_memstat_node_t *node = NULL, *next = NULL;
+    uint16_t idx = 0;
+
     if (g_core_memstat == NULL) {
         return;
     }
 
     pthread_mutex_lock(&g_core_memstat->mutex);
-    core_list_for_each_entry_safe(node, next, &g_core_memstat->module_list, linked_node) {
-        free(node->name);
-        free(node);
+    for (idx = 0; idx < g_core_memstat->module_num; idx++) {
+        free(g_core_memstat->module[idx].name);
     }
+    free(g_core_memstat->block);
+    free(g_core_memstat->timeline);
     pthread_mutex_unlock(&g_core_memstat->mutex);
 
     if (0 != pthread_mutex_destroy(&g_core_memstat->mutex)) {
@@ -132,6 +269,7 @@ void core_memstat_print(void)
 {
     uint64_t max_in_use = 0, total_allocated = 0, total_free = 0;
     core_memstat_node_t *node = NULL;
+    uint16_t idx = 0;
 
     if (g_core_memstat == NULL) {
         return;
@@ -141,12 +279,14 @@ void core_memstat_print(void)
     printf("\n");
     printf("|               |      max_in_use       |  max_allocated   |    total_allocated    |      total_free\n");
     printf("|---------------|-----------------------|------------------|-----------------------|----------------------\n");
-    core_list_for_each_entry(node, &g_core_memstat->module_list, linked_node) {
+    for (idx = 0; idx < g_core_memstat->module_num; idx++) {
+        node = &g_core_memstat->module[idx];
         max_in_use += node->max_in_use;
         total_allocated += node->total_allocated;
         total_free += (node->total_allocated - node->in_use);
     }
-    core_list_for_each_entry(node, &g_core_memstat->module_list, linked_node) {
+    for (idx = 0; idx < g_core_memstat->module_num; idx++) {
+        node = &g_core_memstat->module[idx];
         printf("| %-13s | %6lld / %-5lld bytes  |    %6d bytes  | %6lld / %-5lld bytes  | %6lld / %-5lld bytes   \n",
                node->name, (long long unsigned int)node->max_in_use, (long long unsigned int)max_in_use, node->max_allocated,
                (long long unsigned int)node->total_allocated,
@@ -158,17 +298,158 @@ void core_memstat_print(void)
     pthread_mutex_unlock(&g_core_memstat->mutex);
 }
 
+static int _core_memstat_site_compare(const void *a, const void *b)
+{
+    const core_memstat_site_t *site_a = *(const core_memstat_site_t **)a, *site_b = *(const core_memstat_site_t **)b;
+
+    if (site_a->max_in_use != site_b->max_in_use) {
+        return (site_a->max_in_use < site_b->max_in_use) ? 1 : -1;
+    }
+    return (site_a->alloc_count < site_b->alloc_count) ? 1 : ((site_a->alloc_count > site_b->alloc_count) ? -1 : 0);
+}
+
+/* 调用点地址用backtrace_symbols符号化, 输出形如 "./demo(+0x1a2b)", 可再交给addr2line得到源码行 */
+static char **_core_memstat_site_symbols(void)
+{
+    void *callers[CORE_MEMSTAT_SITE_MAX];
+    uint32_t idx = 0;
+
+    if (g_core_memstat->site_num == 0) {
+        return NULL;
+    }
+    for (idx = 0; idx < g_core_memstat->site_num; idx++) {
+        callers[idx] = g_core_memstat->site[idx].caller;
+    }
+    return backtrace_symbols(callers, g_core_memstat->site_num);
+}
+
+void core_memstat_print_sites(uint32_t top)
+{
+    core_memstat_site_t *sorted[CORE_MEMSTAT_SITE_MAX];
+    char **symbols = NULL;
+    uint32_t idx = 0;
+
+    if (g_core_memstat == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_core_memstat->mutex);
+    for (idx = 0; idx < g_core_memstat->site_num; idx++) {
+        sorted[idx] = &g_core_memstat->site[idx];
+    }
+    qsort(sorted, g_core_memstat->site_num, sizeof(core_memstat_site_t *), _core_memstat_site_compare);
+    symbols = _core_memstat_site_symbols();
+
+    printf("\n");
+    printf("| module        |   max_in_use   |     in_use     |  blocks  |    allocs    | call site\n");
+    printf("|---------------|----------------|----------------|----------|--------------|----------------------\n");
+    for (idx = 0; idx < g_core_memstat->site_num && (top == 0 || idx < top); idx++) {
+        printf("| %-13s | %8llu bytes | %8llu bytes | %8u | %12llu | %s\n",
+               g_core_memstat->module[sorted[idx]->module].name, (long long unsigned int)sorted[idx]->max_in_use,
+               (long long unsigned int)sorted[idx]->in_use, sorted[idx]->block_num,
+               (long long unsigned int)sorted[idx]->alloc_count,
+               (symbols != NULL) ? symbols[sorted[idx] - g_core_memstat->site] : "?");
+    }
+    printf("\n");
+
+    free(symbols);
+    pthread_mutex_unlock(&g_core_memstat->mutex);
+}
+
+void core_memstat_print_leaks(void)
+{
+    core_memstat_block_t *block = NULL;
+    char **symbols = NULL;
+    uint32_t idx = 0;
+
+    if (g_core_memstat == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_core_memstat->mutex);
+    symbols = _core_memstat_site_symbols();
+
+    printf("\n");
+    printf("%u block(s) still in use, %llu bytes\n", g_core_memstat->block_num,
+           (long long unsigned int)g_core_memstat->in_use);
+    for (idx = 0; idx < g_core_memstat->block_len; idx++) {
+        block = &g_core_memstat->block[idx];
+        if (block->ptr == NULL) {
+            continue;
+        }
+        printf("    %p %8u bytes  %-13s %s\n", block->ptr, block->size, g_core_memstat->module[block->module].name,
+               (block->site == CORE_MEMSTAT_SITE_NONE || symbols == NULL) ? "" : symbols[block->site]);
+    }
+    printf("\n");
+
+    free(symbols);
+    pthread_mutex_unlock(&g_core_memstat->mutex);
+}
+
+/* 每行一次申请(size > 0)或释放(size < 0), in_use为操作后全部模块的占用总量 */
+int32_t core_memstat_dump_timeline(const char *path)
+{
+    core_memstat_event_t *event = NULL;
+    char **symbols = NULL;
+    uint64_t seq = 0;
+    FILE *fp = NULL;
+
+    if (path == NULL) {
+        return STATE_PORT_INPUT_NULL_POINTER;
+    }
+    if (g_core_memstat == NULL || g_core_memstat->timeline == NULL) {
+        return STATE_PORT_INPUT_OUT_RANGE;
+    }
+
+    fp = fopen(path, "w");
+    if (fp == NULL) {
+        perror("open timeline failed\n");
+        return STATE_PORT_INPUT_OUT_RANGE;
+    }
+
+    pthread_mutex_lock(&g_core_memstat->mutex);
+    symbols = _core_memstat_site_symbols();
+    fprintf(fp, "seq,time_us,module,ptr,size,in_use,call_site\n");
+    seq = (g_core_memstat->timeline_count > CORE_MEMSTAT_TIMELINE_LEN) ?
+          (g_core_memstat->timeline_count - CORE_MEMSTAT_TIMELINE_LEN) : (0);
+    for (; seq < g_core_memstat->timeline_count; seq++) {
+        event = &g_core_memstat->timeline[seq % CORE_MEMSTAT_TIMELINE_LEN];
+        fprintf(fp, "%llu,%llu,%s,%p,%s%u,%llu,\"%s\"\n", (long long unsigned int)seq,
+                (long long unsigned int)event->time_us, g_core_memstat->module[event->module].name, event->ptr,
+                (event->size & 0x80000000) ? "-" : "", event->size & 0x7FFFFFFF, (long long unsigned int)event->in_use,
+                (event->site == CORE_MEMSTAT_SITE_NONE || symbols == NULL) ? "" : symbols[event->site]);
+    }
+    free(symbols);
+    pthread_mutex_unlock(&g_core_memstat->mutex);
+
+    fclose(fp);
+    return STATE_SUCCESS;
+}
+
 #ifdef CORE_SYSDEP_MBEDTLS_ENABLED
 #define MBEDTLS_MEM_INFO_MAGIC  (0x12345678)
 
 static unsigned int g_mbedtls_total_mem_used = 0;
 static unsigned int g_mbedtls_max_mem_used = 0;
+static unsigned int g_mbedtls_handshake_max_mem_used = 0;
+static unsigned int g_mbedtls_established_mem_used = 0;
 
 typedef struct {
     int magic;
     int size;
 } mbedtls_mem_info_t;
 
+/* 最近一次TLS握手期间mbedtls的堆峰值, 以及握手完成后连接常驻的堆用量(含输入输出记录缓冲区) */
+void core_sysdep_tls_get_mem_usage(uint32_t *handshake_peak, uint32_t *established)
+{
+    if (handshake_peak != NULL) {
+        *handshake_peak = g_mbedtls_handshake_max_mem_used;
+    }
+    if (established != NULL) {
+        *established = g_mbedtls_established_mem_used;
+    }
+}
+
 static void *_core_mbedtls_calloc(size_t n, size_t size)
 {
     unsigned char *buf = NULL;
@@ -222,68 +503,212 @@ static void _core_mbedtls_free(void *ptr)
 }
 #endif
 
-static void _core_memstat_block_insert(void *ptr, uint32_t size, core_memstat_node_t *node)
+/* 模块名通常是字符串常量, 同一个调用点每次传入的指针相同, 所以先比较指针 */
+static uint16_t _core_memstat_module_intern(char *name)
 {
-    core_memstat_block_t *block = NULL;
+    core_memstat_node_t *node = NULL;
+    uint16_t idx = 0;
+
+    for (idx = 0; idx < g_core_memstat->module_num; idx++) {
+        if (g_core_memstat->module[idx].key == name) {
+            return idx;
+        }
+    }
+    for (idx = 0; idx < g_core_memstat->module_num; idx++) {
+        if (strcmp(g_core_memstat->module[idx].name, name) == 0) {
+            g_core_memstat->module[idx].key = name;
+            return idx;
+        }
+    }
+
+    /* 模块表已满时, 其余模块都计入最后一项 */
+    if (g_core_memstat->module_num == CORE_MEMSTAT_MODULE_MAX - 1) {
+        name = "others";
+    } else if (g_core_memstat->module_num == CORE_MEMSTAT_MODULE_MAX) {
+        return CORE_MEMSTAT_MODULE_MAX - 1;
+    }
 
-    block = malloc(sizeof(core_memstat_block_t));
-    if (block != NULL) {
-        memset(block, 0, sizeof(core_memstat_block_t));
-        block->ptr = ptr;
-        block->size = size;
-        CORE_INIT_LIST_HEAD(&block->linked_node);
-        core_list_add_tail(&block->linked_node, &node->block_list);
+    node = &g_core_memstat->module[g_core_memstat->module_num];
+    node->name = malloc(strlen(name) + 1);
+    if (node->name == NULL) {
+        printf("malloc failed\n");
+        return CORE_MEMSTAT_MODULE_MAX;
+    }
+    memcpy(node->name, name, strlen(name) + 1);
+    node->key = name;
+
+    return g_core_memstat->module_num++;
+}
 
-        node->in_use += size;
-        if (node->in_use > node->max_in_use) {
-            node->max_in_use = node->in_use;
+static uint16_t _core_memstat_site_intern(void *caller, uint16_t module)
+{
+    uint32_t mask = CORE_MEMSTAT_SITE_MAX - 1, pos = _core_memstat_hash(caller, mask) ^ module;
+    core_memstat_site_t *site = NULL;
+    uint16_t idx = 0;
+
+    for (pos &= mask;; pos = (pos + 1) & mask) {
+        idx = g_core_memstat->site_index[pos];
+        if (idx == CORE_MEMSTAT_SITE_NONE) {
+            break;
         }
-        if (size > node->max_allocated) {
-            node->max_allocated = size;
+        if (g_core_memstat->site[idx].caller == caller && g_core_memstat->site[idx].module == module) {
+            return idx;
         }
-        node->total_allocated += size;
-    } else {
+    }
+
+    /* 保持装载因子不超过3/4, 超出的调用点不再单独统计 */
+    if (g_core_memstat->site_num >= CORE_MEMSTAT_SITE_MAX / 4 * 3) {
+        return CORE_MEMSTAT_SITE_NONE;
+    }
+
+    idx = (uint16_t)g_core_memstat->site_num++;
+    site = &g_core_memstat->site[idx];
+    memset(site, 0, sizeof(core_memstat_site_t));
+    site->caller = caller;
+    site->module = module;
+    g_core_memstat->site_index[pos] = idx;
+
+    return idx;
+}
+
+static int32_t _core_memstat_block_grow(void)
+{
+    core_memstat_block_t *block = NULL, *old_block = g_core_memstat->block;
+    uint32_t idx = 0, pos = 0, old_len = g_core_memstat->block_len, mask = old_len * 2 - 1;
+
+    block = malloc(old_len * 2 * sizeof(core_memstat_block_t));
+    if (block == NULL) {
+        return STATE_PORT_MALLOC_FAILED;
+    }
+    memset(block, 0, old_len * 2 * sizeof(core_memstat_block_t));
+
+    for (idx = 0; idx < old_len; idx++) {
+        if (old_block[idx].ptr == NULL) {
+            continue;
+        }
+        for (pos = _core_memstat_hash(old_block[idx].ptr, mask); block[pos].ptr != NULL; pos = (pos + 1) & mask);
+        block[pos] = old_block[idx];
+    }
+
+    g_core_memstat->block = block;
+    g_core_memstat->block_len = old_len * 2;
+    free(old_block);
+
+    return STATE_SUCCESS;
+}
+
+static void _core_memstat_timeline_append(void *ptr, uint32_t size, uint16_t module, uint16_t site)
+{
+    core_memstat_event_t *event = NULL;
+
+    event = &g_core_memstat->timeline[g_core_memstat->timeline_count % CORE_MEMSTAT_TIMELINE_LEN];
+    event->time_us = _core_memstat_time_us() - g_core_memstat->timeline_start;
+    event->ptr = ptr;
+    event->size = size;
+    event->module = module;
+    event->site = site;
+    event->in_use = g_core_memstat->in_use;
+    g_core_memstat->timeline_count++;
+}
+
+static void _core_memstat_block_insert(void *ptr, uint32_t size, char *name, void *caller)
+{
+    core_memstat_block_t *block = NULL;
+    core_memstat_node_t *node = NULL;
+    core_memstat_site_t *site = NULL;
+    uint16_t module = 0, site_idx = CORE_MEMSTAT_SITE_NONE;
+    uint32_t pos = 0, mask = 0;
+
+    module = _core_memstat_module_intern((name == NULL) ? ("unknown") : (name));
+    if (module == CORE_MEMSTAT_MODULE_MAX) {
+        return;
+    }
+    if ((g_core_memstat->block_num + 1) * 4 > g_core_memstat->block_len * 3 && _core_memstat_block_grow() < 0) {
         printf("malloc failed\n");
+        return;
+    }
+    if (g_core_memstat->options & CORE_MEMSTAT_OPTION_CALLER) {
+        site_idx = _core_memstat_site_intern(caller, module);
+    }
+
+    mask = g_core_memstat->block_len - 1;
+    for (pos = _core_memstat_hash(ptr, mask); g_core_memstat->block[pos].ptr != NULL; pos = (pos + 1) & mask);
+    block = &g_core_memstat->block[pos];
+    block->ptr = ptr;
+    block->size = size;
+    block->module = module;
+    block->site = site_idx;
+    g_core_memstat->block_num++;
+    g_core_memstat->in_use += size;
+
+    node = &g_core_memstat->module[module];
+    node->in_use += size;
+    if (node->in_use > node->max_in_use) {
+        node->max_in_use = node->in_use;
     }
+    if (size > node->max_allocated) {
+        node->max_allocated = size;
+    }
+    node->total_allocated += size;
+
+    if (site_idx != CORE_MEMSTAT_SITE_NONE) {
+        site = &g_core_memstat->site[site_idx];
+        site->in_use += size;
+        if (site->in_use > site->max_in_use) {
+            site->max_in_use = site->in_use;
+        }
+        site->block_num++;
+        site->alloc_count++;
+    }
+
+    if (g_core_memstat->options & CORE_MEMSTAT_OPTION_TIMELINE) {
+        _core_memstat_timeline_append(ptr, size, module, site_idx);
+    }
+}
+
+static void _core_memstat_block_remove(void *ptr)
+{
+    core_memstat_block_t *block = g_core_memstat->block;
+    uint32_t pos = 0, next = 0, home = 0, mask = g_core_memstat->block_len - 1;
+    core_memstat_site_t *site = NULL;
+
+    for (pos = _core_memstat_hash(ptr, mask); block[pos].ptr != ptr; pos = (pos + 1) & mask) {
+        if (block[pos].ptr == NULL) {
+            return;
+        }
+    }
+
+    g_core_memstat->block_num--;
+    g_core_memstat->in_use -= block[pos].size;
+    g_core_memstat->module[block[pos].module].in_use -= block[pos].size;
+    if (block[pos].site != CORE_MEMSTAT_SITE_NONE) {
+        site = &g_core_memstat->site[block[pos].site];
+        site->in_use -= block[pos].size;
+        site->block_num--;
+    }
+    if (g_core_memstat->options & CORE_MEMSTAT_OPTION_TIMELINE) {
+        _core_memstat_timeline_append(ptr, block[pos].size | 0x80000000, block[pos].module, block[pos].site);
+    }
+
+    /* 把探测链上后面的项回填到空位, 使查找不必跨过墓碑, 长时间运行后也不会退化 */
+    for (next = (pos + 1) & mask; block[next].ptr != NULL; next = (next + 1) & mask) {
+        home = _core_memstat_hash(block[next].ptr, mask);
+        if (((next - home) & mask) >= ((next - pos) & mask)) {
+            block[pos] = block[next];
+            pos = next;
+        }
+    }
+    memset(&block[pos], 0, sizeof(core_memstat_block_t));
 }
 
 void *core_sysdep_malloc(uint32_t size, char *name)
 {
-    uint8_t flag = 0;
     void *allocated = malloc(size);
-    char *module_name = NULL;
-    core_memstat_node_t *node = NULL;
 
     /* Memory Stat */
     if (allocated != NULL && g_core_memstat != NULL) {
-        module_name = (name == NULL) ? ("unknown") : (name);
         pthread_mutex_lock(&g_core_memstat->mutex);
-        core_list_for_each_entry(node, &g_core_memstat->module_list, linked_node) {
-            if (strlen(node->name) == strlen(module_name) && memcmp(node->name, module_name, strlen(module_name)) == 0) {
-                flag = 1;
-                _core_memstat_block_insert(allocated, size, node);
-            }
-        }
-        if (flag == 0) {
-            node = malloc(sizeof(core_memstat_node_t));
-            if (node != NULL) {
-                memset(node, 0, sizeof(core_memstat_node_t));
-                node->name = malloc(strlen(module_name) + 1);
-                if (node->name != NULL) {
-                    memset(node->name, 0, strlen(module_name) + 1);
-                    memcpy(node->name, module_name, strlen(module_name));
-                    CORE_INIT_LIST_HEAD(&node->linked_node);
-                    CORE_INIT_LIST_HEAD(&node->block_list);
-                    core_list_add_tail(&node->linked_node, &g_core_memstat->module_list);
-                    _core_memstat_block_insert(allocated, size, node);
-                } else {
-                    printf("malloc failed\n");
-                    free(node);
-                }
-            } else {
-                printf("malloc failed\n");
-            }
-        }
+        _core_memstat_block_insert(allocated, size, name, __builtin_return_address(0));
         pthread_mutex_unlock(&g_core_memstat->mutex);
     }
 
@@ -292,28 +717,9 @@ void *core_sysdep_malloc(uint32_t size, char *name)
 
 void core_sysdep_free(void *ptr)
 {
-    uint8_t flag = 0;
-    uint32_t size = 0;
-    core_memstat_node_t *node = NULL;
-    core_memstat_block_t *block = NULL, *block_next = NULL;
-
-    if (g_core_memstat != NULL) {
+    if (ptr != NULL && g_core_memstat != NULL) {
         pthread_mutex_lock(&g_core_memstat->mutex);
-        core_list_for_each_entry(node, &g_core_memstat->module_list, linked_node) {
-            core_list_for_each_entry_safe(block, block_next, &node->block_list, linked_node) {
-                if (block->ptr == ptr) {
-                    flag = 1;
-                    size = block->size;
-                    core_list_del(&block->linked_node);
-                    free(block);
-                    break;
-                }
-            }
-            if (flag == 1) {
-                node->in_use -= size;
-                break;
-            }
-        }
+        _core_memstat_block_remove(ptr);
         pthread_mutex_unlock(&g_core_memstat->mutex);
     }
     free(ptr);
@@ -334,50 +740,283 @@ void core_sysdep_sleep(uint64_t time_ms)
     usleep(time_ms * 1000);
 }
 
-void *core_sysdep_network_init(void)
+#ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+/*
+ *  TLS凭据缓存
+ *
+ *  服务端CA证书, 设备证书和私钥只在首次使用时解析一次, 之后所有网络句柄(MQTT, HTTP, OTA下载)重连时直接引用解析结果,
+ *  省去每次握手前的base64解码和ASN.1解析. 证书和私钥按约定位于静态存储区, 按地址和长度查找;
+ *  PSK由设备密钥派生, 每次由调用者临时生成, 按内容查找, 多个句柄共用一份拷贝
+ *
+ *  - 证书或私钥以0x30(DER编码的SEQUENCE)开头时按DER解析, 可以直接引用flash中的DER数据, 首次解析也省去base64解码
+ *  - CA证书只在校验时读取, 可以同时被多个连接引用; 设备私钥签名时会更新RSA的盲化参数, 同一时刻只交给一个连接,
+ *    已被占用时另外解析一份
+ *  - 没有连接引用的条目仍然保留, 缓存满时淘汰最久未用的条目, 没有可淘汰的条目时新解析的凭据不进入缓存, 随连接释放;
+ *    core_sysdep_tls_cred_clear 释放所有没有引用的条目
+ *  - 条目的内存单独统计, 不计入每次握手的内存统计, 由 core_sysdep_tls_cred_get_usage 获取
+ *
+ */
+#define CORE_SYSDEP_TLS_CRED_CACHE_NUM      (4)
+
+#define CORE_SYSDEP_TLS_CRED_CA             (1)
+#define CORE_SYSDEP_TLS_CRED_CLIENT         (2)
+#define CORE_SYSDEP_TLS_CRED_PSK            (3)
+
+static core_sysdep_tls_cred_t *g_core_sysdep_tls_cred[CORE_SYSDEP_TLS_CRED_CACHE_NUM];
+static pthread_mutex_t g_core_sysdep_tls_cred_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t g_core_sysdep_tls_cred_tick = 0;
+static uint32_t g_core_sysdep_tls_cred_parsed = 0;
+static uint32_t g_core_sysdep_tls_cred_mem_used = 0;
+
+/* 已经解析的凭据数量(含已被淘汰的), 以及缓存条目当前占用的内存 */
+void core_sysdep_tls_cred_get_usage(uint32_t *parsed, uint32_t *mem_used)
 {
-    core_network_handle_t *handle = NULL;
+    pthread_mutex_lock(&g_core_sysdep_tls_cred_mutex);
+    if (parsed != NULL) {
+        *parsed = g_core_sysdep_tls_cred_parsed;
+    }
+    if (mem_used != NULL) {
+        *mem_used = g_core_sysdep_tls_cred_mem_used;
+    }
+    pthread_mutex_unlock(&g_core_sysdep_tls_cred_mutex);
+}
 
-    handle = malloc(sizeof(core_network_handle_t));
-    if (handle == NULL) {
-        return NULL;
+static void _core_sysdep_tls_cred_destroy(core_sysdep_tls_cred_t *cred)
+{
+    unsigned int total_mem_used = g_mbedtls_total_mem_used;
+
+    mbedtls_x509_crt_free(&cred->crt);
+    mbedtls_pk_free(&cred->pk);
+    g_mbedtls_total_mem_used = total_mem_used;
+    g_core_sysdep_tls_cred_mem_used -= cred->mem_used;
+
+    if (cred->key.psk.psk != NULL) {
+        memset(cred->key.psk.psk, 0, strlen(cred->key.psk.psk));
+        free(cred->key.psk.psk);
     }
-    memset(handle, 0, sizeof(core_network_handle_t));
+    if (cred->key.psk.psk_id != NULL) {
+        free(cred->key.psk.psk_id);
+    }
+    free(cred);
+}
 
-    return handle;
+/* 源数据以0x30开头时是DER, 否则是以'\0'结尾的PEM字符串, mbedtls要求PEM的长度包含结尾的'\0' */
+static size_t _core_sysdep_tls_cred_parse_len(const char *source, uint32_t source_len)
+{
+    return ((uint8_t)source[0] == 0x30) ? (size_t)source_len : (size_t)source_len + 1;
 }
 
-int32_t core_sysdep_network_setopt(void *handle, core_sysdep_network_option_t option, void *data)
+static int32_t _core_sysdep_tls_cred_parse(core_sysdep_tls_cred_t *cred)
 {
-    core_network_handle_t *network_handle = (core_network_handle_t *)handle;
+    unsigned int total_mem_used = g_mbedtls_total_mem_used;
+    int32_t res = 0;
 
-    if (handle == NULL || data == NULL) {
-        return STATE_PORT_INPUT_NULL_POINTER;
-    }
+    mbedtls_x509_crt_init(&cred->crt);
+    mbedtls_pk_init(&cred->pk);
 
-    if (option >= CORE_SYSDEP_NETWORK_MAX) {
-        return STATE_PORT_INPUT_OUT_RANGE;
+    res = mbedtls_x509_crt_parse(&cred->crt, (const unsigned char *)cred->key.source,
+                                 _core_sysdep_tls_cred_parse_len(cred->key.source, cred->key.source_len));
+    if (res < 0) {
+        if (cred->key.type == CORE_SYSDEP_TLS_CRED_CA) {
+            printf("mbedtls_x509_crt_parse server cert error, res: -0x%04X\n", -res);
+            res = STATE_PORT_TLS_INVALID_SERVER_CERT;
+        } else {
+            printf("mbedtls_x509_crt_parse client cert error, res: -0x%04X\n", -res);
+            res = STATE_PORT_TLS_INVALID_CLIENT_CERT;
+        }
+    } else if (cred->key.type == CORE_SYSDEP_TLS_CRED_CLIENT) {
+        res = mbedtls_pk_parse_key(&cred->pk, (const unsigned char *)cred->key.key_source,
+                                   _core_sysdep_tls_cred_parse_len(cred->key.key_source, cred->key.key_source_len), NULL, 0);
+        if (res < 0) {
+            printf("mbedtls_pk_parse_key client pk error, res: -0x%04X\n", -res);
+            res = STATE_PORT_TLS_INVALID_CLIENT_KEY;
+        }
     }
 
-    switch (option) {
-        case CORE_SYSDEP_NETWORK_SOCKET_TYPE: {
-            network_handle->socket_type = *(core_sysdep_socket_type_t *)data;
+    cred->mem_used = g_mbedtls_total_mem_used - total_mem_used;
+    g_mbedtls_total_mem_used = total_mem_used;
+    g_core_sysdep_tls_cred_mem_used += cred->mem_used;
+
+    return (res < 0) ? res : STATE_SUCCESS;
+}
+
+static core_sysdep_tls_cred_t *_core_sysdep_tls_cred_find(core_sysdep_tls_cred_key_t *key)
+{
+    core_sysdep_tls_cred_t *cred = NULL;
+    uint32_t idx = 0;
+
+    for (idx = 0; idx < CORE_SYSDEP_TLS_CRED_CACHE_NUM; idx++) {
+        cred = g_core_sysdep_tls_cred[idx];
+        if (cred == NULL || cred->key.type != key->type) {
+            continue;
         }
-        break;
-        case CORE_SYSDEP_NETWORK_HOST: {
-            network_handle->host = malloc(strlen(data) + 1);
-            if (network_handle->host == NULL) {
-                printf("malloc failed\n");
-                return STATE_PORT_MALLOC_FAILED;
+        if (key->type == CORE_SYSDEP_TLS_CRED_PSK) {
+            if (strcmp(cred->key.psk.psk_id, key->psk.psk_id) == 0 && strcmp(cred->key.psk.psk, key->psk.psk) == 0) {
+                return cred;
             }
-            memset(network_handle->host, 0, strlen(data) + 1);
-            memcpy(network_handle->host, data, strlen(data));
-        }
-        break;
-        case CORE_SYSDEP_NETWORK_PORT: {
-            network_handle->port = *(uint16_t *)data;
+        } else if (cred->key.source == key->source && cred->key.source_len == key->source_len &&
+                   cred->key.key_source == key->key_source && cred->key.key_source_len == key->key_source_len &&
+                   (key->type == CORE_SYSDEP_TLS_CRED_CA || cred->refcnt == 0)) {
+            return cred;
         }
-        break;
+    }
+
+    return NULL;
+}
+
+/* 放入空槽位或替换最久未用且没有引用的条目, 都没有时不缓存 */
+static void _core_sysdep_tls_cred_insert(core_sysdep_tls_cred_t *cred)
+{
+    core_sysdep_tls_cred_t **victim = NULL;
+    uint32_t idx = 0;
+
+    for (idx = 0; idx < CORE_SYSDEP_TLS_CRED_CACHE_NUM; idx++) {
+        if (g_core_sysdep_tls_cred[idx] == NULL) {
+            g_core_sysdep_tls_cred[idx] = cred;
+            return;
+        }
+        if (g_core_sysdep_tls_cred[idx]->refcnt == 0 &&
+            (victim == NULL || g_core_sysdep_tls_cred[idx]->last_used < (*victim)->last_used)) {
+            victim = &g_core_sysdep_tls_cred[idx];
+        }
+    }
+
+    if (victim != NULL) {
+        _core_sysdep_tls_cred_destroy(*victim);
+        *victim = cred;
+    }
+}
+
+/* 先在缓存中查找, 没有时解析key描述的凭据. 成功时增加引用计数, 由 _core_sysdep_tls_cred_release 释放 */
+static int32_t _core_sysdep_tls_cred_acquire(core_sysdep_tls_cred_key_t *key, core_sysdep_tls_cred_t **cred)
+{
+    core_sysdep_tls_cred_t *found = NULL;
+    int32_t res = STATE_SUCCESS;
+
+    pthread_mutex_lock(&g_core_sysdep_tls_cred_mutex);
+    found = _core_sysdep_tls_cred_find(key);
+    if (found == NULL) {
+        found = malloc(sizeof(core_sysdep_tls_cred_t));
+        if (found == NULL) {
+            pthread_mutex_unlock(&g_core_sysdep_tls_cred_mutex);
+            printf("malloc failed\n");
+            return STATE_PORT_MALLOC_FAILED;
+        }
+        memset(found, 0, sizeof(core_sysdep_tls_cred_t));
+        memcpy(&found->key, key, sizeof(core_sysdep_tls_cred_key_t));
+        if (key->type == CORE_SYSDEP_TLS_CRED_PSK) {
+            found->key.psk.psk_id = malloc(strlen(key->psk.psk_id) + 1);
+            found->key.psk.psk = malloc(strlen(key->psk.psk) + 1);
+            if (found->key.psk.psk_id == NULL || found->key.psk.psk == NULL) {
+                printf("malloc failed\n");
+                res = STATE_PORT_MALLOC_FAILED;
+            } else {
+                memcpy(found->key.psk.psk_id, key->psk.psk_id, strlen(key->psk.psk_id) + 1);
+                memcpy(found->key.psk.psk, key->psk.psk, strlen(key->psk.psk) + 1);
+            }
+        } else {
+            res = _core_sysdep_tls_cred_parse(found);
+            g_core_sysdep_tls_cred_parsed++;
+        }
+        if (res < STATE_SUCCESS) {
+            _core_sysdep_tls_cred_destroy(found);
+            pthread_mutex_unlock(&g_core_sysdep_tls_cred_mutex);
+            return res;
+        }
+        _core_sysdep_tls_cred_insert(found);
+    }
+    found->refcnt++;
+    found->last_used = ++g_core_sysdep_tls_cred_tick;
+    *cred = found;
+    pthread_mutex_unlock(&g_core_sysdep_tls_cred_mutex);
+
+    return STATE_SUCCESS;
+}
+
+static void _core_sysdep_tls_cred_release(core_sysdep_tls_cred_t **cred)
+{
+    uint32_t idx = 0;
+
+    if (*cred == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_core_sysdep_tls_cred_mutex);
+    (*cred)->refcnt--;
+    if ((*cred)->refcnt == 0) {
+        for (idx = 0; idx < CORE_SYSDEP_TLS_CRED_CACHE_NUM; idx++) {
+            if (g_core_sysdep_tls_cred[idx] == *cred) {
+                break;
+            }
+        }
+        if (idx == CORE_SYSDEP_TLS_CRED_CACHE_NUM) {
+            _core_sysdep_tls_cred_destroy(*cred);
+        }
+    }
+    pthread_mutex_unlock(&g_core_sysdep_tls_cred_mutex);
+    *cred = NULL;
+}
+
+/* 释放缓存中所有没有被连接引用的凭据, 例如更换证书之后 */
+void core_sysdep_tls_cred_clear(void)
+{
+    uint32_t idx = 0;
+
+    pthread_mutex_lock(&g_core_sysdep_tls_cred_mutex);
+    for (idx = 0; idx < CORE_SYSDEP_TLS_CRED_CACHE_NUM; idx++) {
+        if (g_core_sysdep_tls_cred[idx] != NULL && g_core_sysdep_tls_cred[idx]->refcnt == 0) {
+            _core_sysdep_tls_cred_destroy(g_core_sysdep_tls_cred[idx]);
+            g_core_sysdep_tls_cred[idx] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&g_core_sysdep_tls_cred_mutex);
+}
+#endif
+
+void *core_sysdep_network_init(void)
+{
+    core_network_handle_t *handle = NULL;
+
+    handle = malloc(sizeof(core_network_handle_t));
+    if (handle == NULL) {
+        return NULL;
+    }
+    memset(handle, 0, sizeof(core_network_handle_t));
+
+    return handle;
+}
+
+int32_t core_sysdep_network_setopt(void *handle, core_sysdep_network_option_t option, void *data)
+{
+    core_network_handle_t *network_handle = (core_network_handle_t *)handle;
+
+    if (handle == NULL || data == NULL) {
+        return STATE_PORT_INPUT_NULL_POINTER;
+    }
+
+    if (option >= CORE_SYSDEP_NETWORK_MAX) {
+        return STATE_PORT_INPUT_OUT_RANGE;
+    }
+
+    switch (option) {
+        case CORE_SYSDEP_NETWORK_SOCKET_TYPE: {
+            network_handle->socket_type = *(core_sysdep_socket_type_t *)data;
+        }
+        break;
+        case CORE_SYSDEP_NETWORK_HOST: {
+            network_handle->host = malloc(strlen(data) + 1);
+            if (network_handle->host == NULL) {
+                printf("malloc failed\n");
+                return STATE_PORT_MALLOC_FAILED;
+            }
+            memset(network_handle->host, 0, strlen(data) + 1);
+            memcpy(network_handle->host, data, strlen(data));
+        }
+        break;
+        case CORE_SYSDEP_NETWORK_PORT: {
+            network_handle->port = *(uint16_t *)data;
+        }
+        break;
         case CORE_SYSDEP_NETWORK_CONNECT_TIMEOUT_MS: {
             network_handle->connect_timeout_ms = *(uint32_t *)data;
         }
@@ -394,125 +1033,749 @@ int32_t core_sysdep_network_setopt(void *handle, core_sysdep_network_option_t op
         }
         break;
         case CORE_SYSDEP_NETWORK_PSK: {
-            core_sysdep_psk_t *psk = (core_sysdep_psk_t *)data;
-            network_handle->psk.psk_id = malloc(strlen(psk->psk_id) + 1);
-            if (network_handle->psk.psk_id == NULL) {
-                printf("malloc failed\n");
-                return STATE_PORT_MALLOC_FAILED;
-            }
-            memset(network_handle->psk.psk_id, 0, strlen(psk->psk_id) + 1);
-            memcpy(network_handle->psk.psk_id, psk->psk_id, strlen(psk->psk_id));
-            network_handle->psk.psk = malloc(strlen(psk->psk) + 1);
-            if (network_handle->psk.psk == NULL) {
-                free(network_handle->psk.psk_id);
-                printf("malloc failed\n");
+            core_sysdep_tls_cred_key_t key;
+
+            memset(&key, 0, sizeof(core_sysdep_tls_cred_key_t));
+            key.type = CORE_SYSDEP_TLS_CRED_PSK;
+            memcpy(&key.psk, data, sizeof(core_sysdep_psk_t));
+            _core_sysdep_tls_cred_release(&network_handle->psk_cred);
+            if (_core_sysdep_tls_cred_acquire(&key, &network_handle->psk_cred) < STATE_SUCCESS) {
                 return STATE_PORT_MALLOC_FAILED;
             }
-            memset(network_handle->psk.psk, 0, strlen(psk->psk) + 1);
-            memcpy(network_handle->psk.psk, psk->psk, strlen(psk->psk));
         }
         break;
+        case CORE_SYSDEP_NETWORK_NONBLOCK: {
+            network_handle->nonblock = *(uint8_t *)data;
+        }
+        break;
+        case CORE_SYSDEP_NETWORK_HANDSHAKE_STATS: {
+            network_handle->handshake_stats = (core_sysdep_handshake_stats_t *)data;
+        }
+        break;
+#endif
+        default: {
+            printf("unknown option\n");
+        }
+    }
+
+    return STATE_SUCCESS;
+}
+
+static int32_t _core_sysdep_network_tcp_establish(core_network_handle_t *network_handle)
+{
+    int32_t res = STATE_SUCCESS, fd = 0;
+    char service[6] = {0};
+    struct addrinfo hints;
+    struct addrinfo *addrInfoList = NULL, *pos = NULL;
+
+    memset(&hints, 0, sizeof(struct addrinfo));
+    hints.ai_family = AF_INET; /* only IPv4 */
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    hints.ai_flags = 0;
+    sprintf(service, "%u", network_handle->port);
+
+    printf("establish tcp connection with server(host='%s', port=[%u])\n", network_handle->host, network_handle->port);
+
+    res = getaddrinfo(network_handle->host, service, &hints, &addrInfoList);
+    if (res != 0) {
+        printf("getaddrinfo error, errno: %d, host: %s, port: %s\n", errno, network_handle->host, service);
+        return STATE_PORT_NETWORK_DNS_FAILED;
+    }
+
+    for (pos = addrInfoList; pos != NULL; pos = pos->ai_next) {
+        if (pos->ai_family != AF_INET) {
+            printf("socket type error\n");
+            res = -1;
+            continue;
+        }
+
+        fd = socket(pos->ai_family, pos->ai_socktype, pos->ai_protocol);
+        if (fd < 0) {
+            printf("create socket error\n");
+            res = -1;
+            continue;
+        }
+
+        if (connect(fd, pos->ai_addr, pos->ai_addrlen) == 0) {
+            network_handle->fd = fd;
+            res = STATE_SUCCESS;
+            break;
+        }
+
+        close(fd);
+        printf("connect error, errno: %d\n", errno);
+    }
+
+    if (res < 0) {
+        printf("fail to establish tcp\n");
+        res = STATE_PORT_NETWORK_CONNECT_FAILED;
+    } else {
+        printf("success to establish tcp, fd=%d\n", network_handle->fd);
+        res = STATE_SUCCESS;
+    }
+    freeaddrinfo(addrInfoList);
+
+    return res;
+}
+
+#ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+static void _port_uint2str(uint16_t input, char *output)
+{
+    uint8_t i = 0, j = 0;
+    char temp[6] = {0};
+
+    do {
+        temp[i++] = input % 10 + '0';
+    } while ((input /= 10) > 0);
+
+    do {
+        output[--i] = temp[j++];
+    } while (i > 0);
+}
+
+/*
+ *  随机数: 熵池 + CTR-DRBG
+ *
+ *  TLS握手(显式IV, ClientHello随机数, 填充)和 core_sysdep_rand 共用一个CTR-DRBG实例, 每次请求只运行AES-CTR,
+ *  不再向熵源逐次取数
+ *
+ *  - 第一次请求时同步采集一份熵并播种, 在设备上对应启动时的播种, 只有这一次需要等待熵源
+ *  - 之后由后台线程采集熵, 放入熵池后等待被取走. 每 CORE_SYSDEP_DRBG_RESEED_INTERVAL 次请求用熵池中的熵重新播种一次,
+ *    熵池还没有就绪时推迟到之后的请求, 所以生成随机数的一方从不等待熵的采集
+ *  - Linux下熵源为getrandom, 内核不支持时读/dev/urandom; 移植到设备时只需替换 _core_sysdep_entropy_poll,
+ *    例如采集ADC最低位的噪声和时钟抖动
+ *  - 重新播种和推迟的次数由 core_sysdep_rand_get_stats 获取
+ *
+ */
+#define CORE_SYSDEP_DRBG_RESEED_INTERVAL    (1024)
+#define CORE_SYSDEP_DRBG_PERSONALIZATION    "aiot-sdk-ctr-drbg"
+
+typedef struct {
+    mbedtls_ctr_drbg_context ctx;
+    uint8_t seeded;
+    uint8_t pool_ready;
+    uint8_t pool[MBEDTLS_CTR_DRBG_ENTROPY_LEN];
+    uint32_t requests;          /* 上次播种之后的请求次数 */
+    uint32_t reseeds;
+    uint32_t reseed_deferred;   /* 到期时熵池没有就绪的请求次数 */
+} core_sysdep_drbg_t;
+
+static core_sysdep_drbg_t g_core_sysdep_drbg;
+static pthread_mutex_t g_core_sysdep_drbg_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_core_sysdep_drbg_cond = PTHREAD_COND_INITIALIZER;
+
+/* 重新播种的次数, 以及因熵池没有就绪而推迟重新播种的请求次数 */
+void core_sysdep_rand_get_stats(uint32_t *reseeds, uint32_t *reseed_deferred)
+{
+    pthread_mutex_lock(&g_core_sysdep_drbg_mutex);
+    if (reseeds != NULL) {
+        *reseeds = g_core_sysdep_drbg.reseeds;
+    }
+    if (reseed_deferred != NULL) {
+        *reseed_deferred = g_core_sysdep_drbg.reseed_deferred;
+    }
+    pthread_mutex_unlock(&g_core_sysdep_drbg_mutex);
+}
+
+static int32_t _core_sysdep_entropy_poll(uint8_t *output, uint32_t output_len)
+{
+    uint32_t pos = 0;
+    ssize_t res = 0;
+    int fd = -1;
+
+#ifdef SYS_getrandom
+    while (pos < output_len) {
+        res = syscall(SYS_getrandom, output + pos, output_len - pos, 0);
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        pos += (uint32_t)res;
+    }
+    if (pos == output_len) {
+        return 0;
+    }
+#endif
+
+    fd = open("/dev/urandom", O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    while (pos < output_len) {
+        res = read(fd, output + pos, output_len - pos);
+        if (res <= 0) {
+            if (res < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        pos += (uint32_t)res;
+    }
+    close(fd);
+
+    return (pos == output_len) ? 0 : -1;
+}
+
+/* CTR-DRBG的熵源回调, 调用时已持有 g_core_sysdep_drbg_mutex, 只从熵池中取, 不等待 */
+static int _core_sysdep_drbg_entropy(void *data, unsigned char *output, size_t len)
+{
+    core_sysdep_drbg_t *drbg = (core_sysdep_drbg_t *)data;
+
+    if (drbg->pool_ready == 0 || len > sizeof(drbg->pool)) {
+        return MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED;
+    }
+    memcpy(output, drbg->pool, len);
+    memset(drbg->pool, 0, sizeof(drbg->pool));
+    drbg->pool_ready = 0;
+    pthread_cond_signal(&g_core_sysdep_drbg_cond);
+
+    return 0;
+}
+
+static void *_core_sysdep_drbg_collector(void *arg)
+{
+    core_sysdep_drbg_t *drbg = (core_sysdep_drbg_t *)arg;
+    uint8_t entropy[MBEDTLS_CTR_DRBG_ENTROPY_LEN];
+
+    while (1) {
+        pthread_mutex_lock(&g_core_sysdep_drbg_mutex);
+        while (drbg->pool_ready != 0) {
+            pthread_cond_wait(&g_core_sysdep_drbg_cond, &g_core_sysdep_drbg_mutex);
+        }
+        pthread_mutex_unlock(&g_core_sysdep_drbg_mutex);
+
+        /* 采集时不持有锁, 熵源再慢也不影响生成随机数 */
+        if (_core_sysdep_entropy_poll(entropy, sizeof(entropy)) < 0) {
+            core_sysdep_sleep(1000);
+            continue;
+        }
+
+        pthread_mutex_lock(&g_core_sysdep_drbg_mutex);
+        memcpy(drbg->pool, entropy, sizeof(drbg->pool));
+        drbg->pool_ready = 1;
+        pthread_mutex_unlock(&g_core_sysdep_drbg_mutex);
+        memset(entropy, 0, sizeof(entropy));
+    }
+
+    return NULL;
+}
+
+/* 调用时已持有 g_core_sysdep_drbg_mutex */
+static int _core_sysdep_drbg_seed(core_sysdep_drbg_t *drbg)
+{
+    pthread_t collector;
+    int res = 0;
+
+    if (_core_sysdep_entropy_poll(drbg->pool, sizeof(drbg->pool)) < 0) {
+        printf("entropy poll failed\n");
+        return MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED;
+    }
+    drbg->pool_ready = 1;
+
+    mbedtls_ctr_drbg_init(&drbg->ctx);
+    res = mbedtls_ctr_drbg_seed(&drbg->ctx, _core_sysdep_drbg_entropy, drbg,
+                                (const unsigned char *)CORE_SYSDEP_DRBG_PERSONALIZATION,
+                                strlen(CORE_SYSDEP_DRBG_PERSONALIZATION));
+    if (res != 0) {
+        printf("mbedtls_ctr_drbg_seed error, res = -0x%04X\n", -res);
+        mbedtls_ctr_drbg_free(&drbg->ctx);
+        return res;
+    }
+    /* 重新播种由本层在熵池就绪时进行, 不让mbedtls在熵池为空时返回错误 */
+    mbedtls_ctr_drbg_set_reseed_interval(&drbg->ctx, INT_MAX);
+    drbg->seeded = 1;
+    drbg->requests = 0;
+
+    /* 没有后台线程时仍然可用, 只是不再重新播种 */
+    if (pthread_create(&collector, NULL, _core_sysdep_drbg_collector, drbg) != 0) {
+        printf("create entropy collector failed\n");
+    } else {
+        pthread_detach(collector);
+    }
+
+    return 0;
+}
+
+static int _core_sysdep_drbg_random(unsigned char *output, size_t output_len)
+{
+    core_sysdep_drbg_t *drbg = &g_core_sysdep_drbg;
+    size_t len = 0;
+    int res = 0;
+
+    pthread_mutex_lock(&g_core_sysdep_drbg_mutex);
+    if (drbg->seeded == 0) {
+        res = _core_sysdep_drbg_seed(drbg);
+    }
+
+    if (res == 0 && drbg->requests >= CORE_SYSDEP_DRBG_RESEED_INTERVAL) {
+        if (drbg->pool_ready != 0) {
+            res = mbedtls_ctr_drbg_reseed(&drbg->ctx, NULL, 0);
+            drbg->requests = 0;
+            drbg->reseeds++;
+        } else {
+            drbg->reseed_deferred++;
+        }
+    }
+
+    while (res == 0 && output_len > 0) {
+        len = (output_len > MBEDTLS_CTR_DRBG_MAX_REQUEST) ? MBEDTLS_CTR_DRBG_MAX_REQUEST : output_len;
+        res = mbedtls_ctr_drbg_random(&drbg->ctx, output, len);
+        output += len;
+        output_len -= len;
+    }
+    drbg->requests++;
+    pthread_mutex_unlock(&g_core_sysdep_drbg_mutex);
+
+    return res;
+}
+
+static int _mbedtls_random(void *handle, unsigned char *output, size_t output_len)
+{
+    return _core_sysdep_drbg_random(output, output_len);
+}
+
+static void _mbedtls_debug(void *ctx, int level, const char *file, int line, const char *str)
+{
+    ((void) level);
+    if (NULL != ctx) {
+        printf("%s\n", str);
+    }
+}
+
+/*
+ *  TLS会话缓存
+ *
+ *  每次握手成功后按 host:port 保存协商出的会话(session id 或 session ticket), 下次连接同一服务器时提供给服务端.
+ *  服务端接受时只需一个往返的简化握手, 省去证书链的传输和校验以及RSA运算; 不接受时自动退回完整握手
+ *
+ *  恢复的会话不再校验服务端证书, 因此会话还要与凭据匹配: 安全选项、CA证书、设备证书和PSK不同的连接不共用会话
+ *
+ *  调用 core_sysdep_tls_session_set_store 设置持久化回调后, 最近一次建立的会话还会写入一个持久化槽位(如flash),
+ *  重启后RAM中的缓存为空时从槽位中恢复. 槽位中包含会话的主密钥, 应保存在外部无法读取的区域
+ *
+ */
+#define CORE_SYSDEP_TLS_SESSION_CACHE_NUM       (4)
+#define CORE_SYSDEP_TLS_SESSION_STORE_MAXLEN    (512)
+#define CORE_SYSDEP_TLS_SESSION_STORE_MAGIC     (0x544C5332)
+
+typedef struct {
+    int32_t (*save)(const uint8_t *data, uint32_t len);     /* len为0时表示清除槽位 */
+    int32_t (*load)(uint8_t *data, uint32_t len);           /* 返回读到的字节数, 没有数据时返回0 */
+} core_sysdep_tls_session_store_t;
+
+typedef struct {
+    char *host;
+    uint16_t port;
+    uint8_t cred_id[32];
+    uint64_t last_used;
+    mbedtls_ssl_session session;
+} core_sysdep_tls_session_t;
+
+static core_sysdep_tls_session_t g_core_sysdep_tls_session[CORE_SYSDEP_TLS_SESSION_CACHE_NUM];
+static core_sysdep_tls_session_store_t *g_core_sysdep_tls_session_store = NULL;
+static pthread_mutex_t g_core_sysdep_tls_session_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* 缓存中的会话不保留服务端证书, ticket使用自己的内存, 不计入mbedtls的内存统计 */
+static void _core_sysdep_tls_session_reset(core_sysdep_tls_session_t *slot)
+{
+    free(slot->host);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    free(slot->session.ticket);
+#endif
+    memset(slot, 0, sizeof(core_sysdep_tls_session_t));
+}
+
+static int32_t _core_sysdep_tls_session_fill(core_sysdep_tls_session_t *slot, const char *host, uint16_t port,
+        const uint8_t cred_id[32], const mbedtls_ssl_session *session)
+{
+    _core_sysdep_tls_session_reset(slot);
+
+    slot->host = malloc(strlen(host) + 1);
+    if (slot->host == NULL) {
+        return STATE_PORT_MALLOC_FAILED;
+    }
+    memcpy(slot->host, host, strlen(host) + 1);
+    slot->port = port;
+    memcpy(slot->cred_id, cred_id, 32);
+    memcpy(&slot->session, session, sizeof(mbedtls_ssl_session));
+    slot->session.peer_cert = NULL;
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    slot->session.ticket = NULL;
+    if (session->ticket != NULL && session->ticket_len > 0) {
+        slot->session.ticket = malloc(session->ticket_len);
+        if (slot->session.ticket == NULL) {
+            _core_sysdep_tls_session_reset(slot);
+            return STATE_PORT_MALLOC_FAILED;
+        }
+        memcpy(slot->session.ticket, session->ticket, session->ticket_len);
+    }
+#endif
+
+    return STATE_SUCCESS;
+}
+
+/* 凭据的摘要: 安全选项、CA证书、设备证书(不含私钥)和PSK, 私钥由设备证书唯一确定 */
+static void _core_sysdep_tls_session_cred_id(core_network_handle_t *network_handle, uint8_t cred_id[32])
+{
+    mbedtls_sha256_context ctx;
+    aiot_sysdep_network_cred_t *cred = network_handle->cred;
+    uint8_t option = (uint8_t)cred->option;
+
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, &option, 1);
+    if (cred->option == AIOT_SYSDEP_NETWORK_CRED_SVRCERT_RSA || cred->option == AIOT_SYSDEP_NETWORK_CRED_SVRCERT_ECC) {
+        mbedtls_sha256_update(&ctx, (const unsigned char *)cred->x509_server_cert, cred->x509_server_cert_len);
+        if (network_handle->mbedtls.client_cred != NULL) {
+            mbedtls_sha256_update(&ctx, (const unsigned char *)cred->x509_client_cert, cred->x509_client_cert_len);
+        }
+    } else if (cred->option == AIOT_SYSDEP_NETWORK_CRED_SVRCERT_PSK && network_handle->psk_cred != NULL) {
+        /* 含结尾的'\0', 区分psk_id和psk的边界 */
+        mbedtls_sha256_update(&ctx, (const unsigned char *)network_handle->psk_cred->key.psk.psk_id,
+                              strlen(network_handle->psk_cred->key.psk.psk_id) + 1);
+        mbedtls_sha256_update(&ctx, (const unsigned char *)network_handle->psk_cred->key.psk.psk,
+                              strlen(network_handle->psk_cred->key.psk.psk) + 1);
+    }
+    mbedtls_sha256_finish(&ctx, cred_id);
+    mbedtls_sha256_free(&ctx);
+}
+
+static uint8_t _core_sysdep_tls_session_match(core_sysdep_tls_session_t *slot, const char *host, uint16_t port,
+        const uint8_t cred_id[32])
+{
+    return (slot->host != NULL && slot->port == port && strcmp(slot->host, host) == 0 &&
+            memcmp(slot->cred_id, cred_id, 32) == 0) ? 1 : 0;
+}
+
+static core_sysdep_tls_session_t *_core_sysdep_tls_session_find(const char *host, uint16_t port,
+        const uint8_t cred_id[32])
+{
+    uint32_t idx = 0;
+
+    for (idx = 0; idx < CORE_SYSDEP_TLS_SESSION_CACHE_NUM; idx++) {
+        if (_core_sysdep_tls_session_match(&g_core_sysdep_tls_session[idx], host, port, cred_id)) {
+            return &g_core_sysdep_tls_session[idx];
+        }
+    }
+
+    return NULL;
+}
+
+static core_sysdep_tls_session_t *_core_sysdep_tls_session_victim(void)
+{
+    core_sysdep_tls_session_t *victim = &g_core_sysdep_tls_session[0];
+    uint32_t idx = 0;
+
+    for (idx = 0; idx < CORE_SYSDEP_TLS_SESSION_CACHE_NUM; idx++) {
+        if (g_core_sysdep_tls_session[idx].host == NULL) {
+            return &g_core_sysdep_tls_session[idx];
+        }
+        if (g_core_sysdep_tls_session[idx].last_used < victim->last_used) {
+            victim = &g_core_sysdep_tls_session[idx];
+        }
+    }
+
+    return victim;
+}
+
+static void _core_sysdep_tls_session_put_u32(uint8_t *buffer, uint32_t value)
+{
+    buffer[0] = (uint8_t)(value >> 24);
+    buffer[1] = (uint8_t)(value >> 16);
+    buffer[2] = (uint8_t)(value >> 8);
+    buffer[3] = (uint8_t)(value);
+}
+
+static uint32_t _core_sysdep_tls_session_get_u32(const uint8_t *buffer)
+{
+    return ((uint32_t)buffer[0] << 24) | ((uint32_t)buffer[1] << 16) | ((uint32_t)buffer[2] << 8) | buffer[3];
+}
+
+/*
+ *  持久化格式(多字节整数均为大端):
+ *  magic(4) port(2) host_len(1) host cred_id(32) ciphersuite(4) compression(1) id_len(1) id(32) master(48)
+ *  verify_result(4) mfl_code(1) ticket_lifetime(4) ticket_len(2) ticket
+ */
+static uint32_t _core_sysdep_tls_session_serialize(core_sysdep_tls_session_t *slot, uint8_t *buffer, uint32_t len)
+{
+    uint32_t host_len = strlen(slot->host), ticket_len = 0, pos = 0;
+
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    ticket_len = slot->session.ticket_len;
 #endif
-        default: {
-            printf("unknown option\n");
-        }
+    if (host_len > 255 || 4 + 2 + 1 + host_len + 32 + 4 + 1 + 1 + 32 + 48 + 4 + 1 + 4 + 2 + ticket_len > len) {
+        return 0;
     }
 
-    return STATE_SUCCESS;
+    _core_sysdep_tls_session_put_u32(&buffer[pos], CORE_SYSDEP_TLS_SESSION_STORE_MAGIC);
+    pos += 4;
+    buffer[pos++] = (uint8_t)(slot->port >> 8);
+    buffer[pos++] = (uint8_t)(slot->port);
+    buffer[pos++] = (uint8_t)host_len;
+    memcpy(&buffer[pos], slot->host, host_len);
+    pos += host_len;
+    memcpy(&buffer[pos], slot->cred_id, 32);
+    pos += 32;
+    _core_sysdep_tls_session_put_u32(&buffer[pos], (uint32_t)slot->session.ciphersuite);
+    pos += 4;
+    buffer[pos++] = (uint8_t)slot->session.compression;
+    buffer[pos++] = (uint8_t)slot->session.id_len;
+    memcpy(&buffer[pos], slot->session.id, 32);
+    pos += 32;
+    memcpy(&buffer[pos], slot->session.master, 48);
+    pos += 48;
+    _core_sysdep_tls_session_put_u32(&buffer[pos], slot->session.verify_result);
+    pos += 4;
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    buffer[pos++] = slot->session.mfl_code;
+#else
+    buffer[pos++] = 0;
+#endif
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    _core_sysdep_tls_session_put_u32(&buffer[pos], slot->session.ticket_lifetime);
+#else
+    _core_sysdep_tls_session_put_u32(&buffer[pos], 0);
+#endif
+    pos += 4;
+    buffer[pos++] = (uint8_t)(ticket_len >> 8);
+    buffer[pos++] = (uint8_t)(ticket_len);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    if (ticket_len > 0) {
+        memcpy(&buffer[pos], slot->session.ticket, ticket_len);
+        pos += ticket_len;
+    }
+#endif
+
+    return pos;
 }
 
-static int32_t _core_sysdep_network_tcp_establish(core_network_handle_t *network_handle)
+static int32_t _core_sysdep_tls_session_deserialize(core_sysdep_tls_session_t *slot, const uint8_t *buffer,
+        uint32_t len)
 {
-    int32_t res = STATE_SUCCESS, fd = 0;
-    char service[6] = {0};
-    struct addrinfo hints;
-    struct addrinfo *addrInfoList = NULL, *pos = NULL;
+    mbedtls_ssl_session session;
+    char host[256] = {0};
+    uint8_t cred_id[32];
+    uint32_t host_len = 0, ticket_len = 0, pos = 0;
+    uint16_t port = 0;
 
-    memset(&hints, 0, sizeof(struct addrinfo));
-    hints.ai_family = AF_INET; /* only IPv4 */
-    hints.ai_socktype = SOCK_STREAM;
-    hints.ai_protocol = IPPROTO_TCP;
-    hints.ai_flags = 0;
-    sprintf(service, "%u", network_handle->port);
+    if (len < 7 || _core_sysdep_tls_session_get_u32(buffer) != CORE_SYSDEP_TLS_SESSION_STORE_MAGIC) {
+        return STATE_PORT_INPUT_OUT_RANGE;
+    }
+    port = ((uint16_t)buffer[4] << 8) | buffer[5];
+    host_len = buffer[6];
+    pos = 7;
+    if (pos + host_len + 32 + 4 + 1 + 1 + 32 + 48 + 4 + 1 + 4 + 2 > len) {
+        return STATE_PORT_INPUT_OUT_RANGE;
+    }
+    memcpy(host, &buffer[pos], host_len);
+    pos += host_len;
+    memcpy(cred_id, &buffer[pos], 32);
+    pos += 32;
+
+    memset(&session, 0, sizeof(mbedtls_ssl_session));
+    session.ciphersuite = (int)_core_sysdep_tls_session_get_u32(&buffer[pos]);
+    pos += 4;
+    session.compression = buffer[pos++];
+    session.id_len = buffer[pos++];
+    memcpy(session.id, &buffer[pos], 32);
+    pos += 32;
+    memcpy(session.master, &buffer[pos], 48);
+    pos += 48;
+    session.verify_result = _core_sysdep_tls_session_get_u32(&buffer[pos]);
+    pos += 4;
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    session.mfl_code = buffer[pos];
+#endif
+    pos += 1;
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    session.ticket_lifetime = _core_sysdep_tls_session_get_u32(&buffer[pos]);
+#endif
+    pos += 4;
+    ticket_len = ((uint32_t)buffer[pos] << 8) | buffer[pos + 1];
+    pos += 2;
+    if (session.id_len > 32 || pos + ticket_len > len) {
+        return STATE_PORT_INPUT_OUT_RANGE;
+    }
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    session.ticket = (unsigned char *)&buffer[pos];
+    session.ticket_len = ticket_len;
+#endif
 
-    printf("establish tcp connection with server(host='%s', port=[%u])\n", network_handle->host, network_handle->port);
+    return _core_sysdep_tls_session_fill(slot, host, port, cred_id, &session);
+}
 
-    res = getaddrinfo(network_handle->host, service, &hints, &addrInfoList);
-    if (res != 0) {
-        printf("getaddrinfo error, errno: %d, host: %s, port: %s\n", errno, network_handle->host, service);
-        return STATE_PORT_NETWORK_DNS_FAILED;
+void core_sysdep_tls_session_set_store(core_sysdep_tls_session_store_t *store)
+{
+    pthread_mutex_lock(&g_core_sysdep_tls_session_mutex);
+    g_core_sysdep_tls_session_store = store;
+    pthread_mutex_unlock(&g_core_sysdep_tls_session_mutex);
+}
+
+/* 清空RAM中的会话缓存, 持久化槽位不受影响 */
+void core_sysdep_tls_session_clear(void)
+{
+    uint32_t idx = 0;
+
+    pthread_mutex_lock(&g_core_sysdep_tls_session_mutex);
+    for (idx = 0; idx < CORE_SYSDEP_TLS_SESSION_CACHE_NUM; idx++) {
+        _core_sysdep_tls_session_reset(&g_core_sysdep_tls_session[idx]);
     }
+    pthread_mutex_unlock(&g_core_sysdep_tls_session_mutex);
+}
 
-    for (pos = addrInfoList; pos != NULL; pos = pos->ai_next) {
-        if (pos->ai_family != AF_INET) {
-            printf("socket type error\n");
-            res = -1;
-            continue;
+/* 找到缓存的会话时提供给服务端, 并把主密钥拷贝到master中, 握手后据此判断服务端是否接受了恢复 */
+static uint8_t _core_sysdep_tls_session_offer(core_network_handle_t *network_handle, uint8_t master[48])
+{
+    core_sysdep_tls_session_t *slot = NULL;
+    uint8_t buffer[CORE_SYSDEP_TLS_SESSION_STORE_MAXLEN];
+    int32_t len = 0;
+    uint8_t offered = 0;
+
+    _core_sysdep_tls_session_cred_id(network_handle, network_handle->mbedtls.session_cred_id);
+
+    pthread_mutex_lock(&g_core_sysdep_tls_session_mutex);
+    slot = _core_sysdep_tls_session_find(network_handle->host, network_handle->port,
+                                         network_handle->mbedtls.session_cred_id);
+    if (slot == NULL && g_core_sysdep_tls_session_store != NULL) {
+        len = g_core_sysdep_tls_session_store->load(buffer, sizeof(buffer));
+        if (len > 0) {
+            slot = _core_sysdep_tls_session_victim();
+            if (_core_sysdep_tls_session_deserialize(slot, buffer, (uint32_t)len) < 0 ||
+                _core_sysdep_tls_session_match(slot, network_handle->host, network_handle->port,
+                                               network_handle->mbedtls.session_cred_id) == 0) {
+                _core_sysdep_tls_session_reset(slot);
+                slot = NULL;
+            }
         }
+    }
+    if (slot != NULL && mbedtls_ssl_set_session(&network_handle->mbedtls.ssl_ctx, &slot->session) == 0) {
+        slot->last_used = core_sysdep_time();
+        memcpy(master, slot->session.master, 48);
+        offered = 1;
+    }
+    pthread_mutex_unlock(&g_core_sysdep_tls_session_mutex);
 
-        fd = socket(pos->ai_family, pos->ai_socktype, pos->ai_protocol);
-        if (fd < 0) {
-            printf("create socket error\n");
-            res = -1;
-            continue;
-        }
+    return offered;
+}
 
-        if (connect(fd, pos->ai_addr, pos->ai_addrlen) == 0) {
-            network_handle->fd = fd;
-            res = STATE_SUCCESS;
-            break;
+static void _core_sysdep_tls_session_save(core_network_handle_t *network_handle)
+{
+    core_sysdep_tls_session_t *slot = NULL;
+    uint8_t buffer[CORE_SYSDEP_TLS_SESSION_STORE_MAXLEN];
+    uint32_t len = 0;
+
+    pthread_mutex_lock(&g_core_sysdep_tls_session_mutex);
+    slot = _core_sysdep_tls_session_find(network_handle->host, network_handle->port,
+                                         network_handle->mbedtls.session_cred_id);
+    if (slot == NULL) {
+        slot = _core_sysdep_tls_session_victim();
+    }
+    if (_core_sysdep_tls_session_fill(slot, network_handle->host, network_handle->port,
+                                      network_handle->mbedtls.session_cred_id,
+                                      network_handle->mbedtls.ssl_ctx.session) == STATE_SUCCESS) {
+        slot->last_used = core_sysdep_time();
+        if (g_core_sysdep_tls_session_store != NULL) {
+            len = _core_sysdep_tls_session_serialize(slot, buffer, sizeof(buffer));
+            if (len > 0) {
+                g_core_sysdep_tls_session_store->save(buffer, len);
+            }
         }
-
-        close(fd);
-        printf("connect error, errno: %d\n", errno);
     }
+    pthread_mutex_unlock(&g_core_sysdep_tls_session_mutex);
+}
 
-    if (res < 0) {
-        printf("fail to establish tcp\n");
-        res = STATE_PORT_NETWORK_CONNECT_FAILED;
-    } else {
-        printf("success to establish tcp, fd=%d\n", network_handle->fd);
-        res = STATE_SUCCESS;
+/* 用缓存的会话握手失败时丢弃它, 避免每次重连都先失败一次. 持久化槽位只在保存的是同一个会话时清除 */
+static void _core_sysdep_tls_session_drop(core_network_handle_t *network_handle)
+{
+    core_sysdep_tls_session_t *slot = NULL, stored;
+    uint8_t buffer[CORE_SYSDEP_TLS_SESSION_STORE_MAXLEN];
+    int32_t len = 0;
+
+    pthread_mutex_lock(&g_core_sysdep_tls_session_mutex);
+    slot = _core_sysdep_tls_session_find(network_handle->host, network_handle->port,
+                                         network_handle->mbedtls.session_cred_id);
+    if (slot != NULL) {
+        _core_sysdep_tls_session_reset(slot);
     }
-    freeaddrinfo(addrInfoList);
-
-    return res;
+    if (g_core_sysdep_tls_session_store != NULL) {
+        memset(&stored, 0, sizeof(core_sysdep_tls_session_t));
+        len = g_core_sysdep_tls_session_store->load(buffer, sizeof(buffer));
+        if (len > 0 && _core_sysdep_tls_session_deserialize(&stored, buffer, (uint32_t)len) == STATE_SUCCESS &&
+            _core_sysdep_tls_session_match(&stored, network_handle->host, network_handle->port,
+                                           network_handle->mbedtls.session_cred_id)) {
+            g_core_sysdep_tls_session_store->save(NULL, 0);
+        }
+        _core_sysdep_tls_session_reset(&stored);
+    }
+    pthread_mutex_unlock(&g_core_sysdep_tls_session_mutex);
 }
 
-#ifdef CORE_SYSDEP_MBEDTLS_ENABLED
-static void _port_uint2str(uint16_t input, char *output)
+/*
+ *  建立TLS连接: 域名解析 -> TCP连接 -> 握手, 拆成可以从中断处继续的步骤
+ *
+ *  - 握手期间socket为非阻塞的, 握手状态机每次前进到需要等待网络(WANT_READ/WANT_WRITE)为止
+ *  - 设置了 CORE_SYSDEP_NETWORK_NONBLOCK 时此时返回 STATE_PORT_NETWORK_ESTABLISH_IN_PROGRESS, 由调用者的处理循环再次调用;
+ *    否则在 _core_sysdep_network_mbedtls_establish 中poll等待socket就绪后继续, 对调用者来说与之前一样是阻塞的
+ *  - 超过connect_timeout_ms没有收发任何数据判定为超时, 返回 STATE_PORT_NETWORK_CONNECT_TIMEOUT
+ *  - 握手结束后socket恢复为阻塞的, 之后的收发路径不变
+ *  - 域名解析(getaddrinfo)仍然是阻塞的, 需要时可以由调用者提前解析后以IP地址作为host
+ *  - 握手期间的收发经过 _core_sysdep_handshake_send/_core_sysdep_handshake_recv, 设置了 CORE_SYSDEP_NETWORK_HANDSHAKE_STATS 时
+ *    以收发方向的变化划分flight, 记录每个flight的字节数、首末字节的时刻和处理它的计算耗时
+ *
+ */
+static void _core_sysdep_handshake_account(core_network_handle_t *network_handle, uint8_t outbound, int bytes)
 {
-    uint8_t i = 0, j = 0;
-    char temp[6] = {0};
+    core_sysdep_handshake_stats_t *stats = network_handle->handshake_stats;
+    core_sysdep_handshake_flight_t *flight = NULL;
+    uint64_t now = 0;
 
-    do {
-        temp[i++] = input % 10 + '0';
-    } while ((input /= 10) > 0);
+    if (bytes <= 0) {
+        return;
+    }
+    now = _core_memstat_time_us();
+    network_handle->mbedtls.progress_us = now;
+    if (stats == NULL) {
+        return;
+    }
 
-    do {
-        output[--i] = temp[j++];
-    } while (i > 0);
+    if (stats->flight_num == 0 || (stats->flight[stats->flight_num - 1].outbound != outbound &&
+                                   stats->flight_num < CORE_SYSDEP_HANDSHAKE_FLIGHT_MAX)) {
+        flight = &stats->flight[stats->flight_num++];
+        flight->outbound = outbound;
+        flight->begin_us = (uint32_t)(now - network_handle->mbedtls.start_us);
+    }
+    flight = &stats->flight[stats->flight_num - 1];
+    flight->bytes += (uint32_t)bytes;
+    flight->end_us = (uint32_t)(now - network_handle->mbedtls.start_us);
 }
 
-void core_sysdep_rand(uint8_t *output, uint32_t output_len);
-static int _mbedtls_random(void *handle, unsigned char *output, size_t output_len)
+static int _core_sysdep_handshake_send(void *ctx, const unsigned char *buf, size_t len)
 {
-    core_sysdep_rand(output, output_len);
-    return 0;
+    core_network_handle_t *network_handle = (core_network_handle_t *)ctx;
+    int res = mbedtls_net_send(&network_handle->mbedtls.net_ctx, buf, len);
+
+    _core_sysdep_handshake_account(network_handle, 1, res);
+
+    return res;
 }
 
-static void _mbedtls_debug(void *ctx, int level, const char *file, int line, const char *str)
+static int _core_sysdep_handshake_recv(void *ctx, unsigned char *buf, size_t len)
 {
-    ((void) level);
-    if (NULL != ctx) {
-        printf("%s\n", str);
-    }
+    core_network_handle_t *network_handle = (core_network_handle_t *)ctx;
+    int res = mbedtls_net_recv(&network_handle->mbedtls.net_ctx, buf, len);
+
+    _core_sysdep_handshake_account(network_handle, 0, res);
+
+    return res;
 }
 
-static int32_t _core_sysdep_network_mbedtls_establish(core_network_handle_t *network_handle)
+static int32_t _core_sysdep_network_mbedtls_setup(core_network_handle_t *network_handle)
 {
     int32_t res = 0;
-    char port_str[6] = {0};
+    uint32_t max_fragment = network_handle->cred->max_tls_fragment;
 
 #if defined(MBEDTLS_DEBUG_C)
     mbedtls_debug_set_threshold(0);
@@ -530,15 +1793,19 @@ static int32_t _core_sysdep_network_mbedtls_establish(core_network_handle_t *net
 
     printf("establish mbedtls connection with server(host='%s', port=[%u])\n", network_handle->host, network_handle->port);
 
-    _port_uint2str(network_handle->port, port_str);
+    /* 服务端发来的记录不能超过输入缓冲区, 协商的max_fragment_length以MBEDTLS_SSL_IN_CONTENT_LEN为上限 */
+    if (max_fragment > MBEDTLS_SSL_IN_CONTENT_LEN) {
+        printf("max_tls_fragment %u exceeds tls input buffer, use %u\n", max_fragment, MBEDTLS_SSL_IN_CONTENT_LEN);
+        max_fragment = MBEDTLS_SSL_IN_CONTENT_LEN;
+    }
 
-    if (network_handle->cred->max_tls_fragment <= 512) {
+    if (max_fragment <= 512) {
         res = mbedtls_ssl_conf_max_frag_len(&network_handle->mbedtls.ssl_config, MBEDTLS_SSL_MAX_FRAG_LEN_512);
-    } else if (network_handle->cred->max_tls_fragment <= 1024) {
+    } else if (max_fragment <= 1024) {
         res = mbedtls_ssl_conf_max_frag_len(&network_handle->mbedtls.ssl_config, MBEDTLS_SSL_MAX_FRAG_LEN_1024);
-    } else if (network_handle->cred->max_tls_fragment <= 2048) {
+    } else if (max_fragment <= 2048) {
         res = mbedtls_ssl_conf_max_frag_len(&network_handle->mbedtls.ssl_config, MBEDTLS_SSL_MAX_FRAG_LEN_2048);
-    } else if (network_handle->cred->max_tls_fragment <= 4096) {
+    } else if (max_fragment <= 4096) {
         res = mbedtls_ssl_conf_max_frag_len(&network_handle->mbedtls.ssl_config, MBEDTLS_SSL_MAX_FRAG_LEN_4096);
     } else {
         res = mbedtls_ssl_conf_max_frag_len(&network_handle->mbedtls.ssl_config, MBEDTLS_SSL_MAX_FRAG_LEN_NONE);
@@ -549,19 +1816,6 @@ static int32_t _core_sysdep_network_mbedtls_establish(core_network_handle_t *net
         return res;
     }
 
-    res = mbedtls_net_connect(&network_handle->mbedtls.net_ctx, network_handle->host, port_str, MBEDTLS_NET_PROTO_TCP);
-    if (res < 0) {
-        printf("mbedtls_net_connect error, res: -0x%04X\n", -res);
-        if (res == MBEDTLS_ERR_NET_UNKNOWN_HOST) {
-            res = STATE_PORT_TLS_DNS_FAILED;
-        } else if (res == MBEDTLS_ERR_NET_SOCKET_FAILED) {
-            res = STATE_PORT_TLS_SOCKET_CREATE_FAILED;
-        } else if (res == MBEDTLS_ERR_NET_CONNECT_FAILED) {
-            res = STATE_PORT_TLS_SOCKET_CONNECT_FAILED;
-        }
-        return res;
-    }
-
     res = mbedtls_ssl_config_defaults(&network_handle->mbedtls.ssl_config, MBEDTLS_SSL_IS_CLIENT,
                                       MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
     if (res < 0) {
@@ -576,50 +1830,73 @@ static int32_t _core_sysdep_network_mbedtls_establish(core_network_handle_t *net
     mbedtls_ssl_conf_rng(&network_handle->mbedtls.ssl_config, _mbedtls_random, NULL);
     mbedtls_ssl_conf_dbg(&network_handle->mbedtls.ssl_config, _mbedtls_debug, stdout);
 
-    if (network_handle->cred->option == AIOT_SYSDEP_NETWORK_CRED_SVRCERT_RSA) {
-        if (network_handle->cred->x509_server_cert == NULL && network_handle->cred->x509_server_cert_len == 0) {
+    if (network_handle->cred->option == AIOT_SYSDEP_NETWORK_CRED_SVRCERT_RSA ||
+        network_handle->cred->option == AIOT_SYSDEP_NETWORK_CRED_SVRCERT_ECC) {
+        core_sysdep_tls_cred_key_t key;
+
+        if (network_handle->cred->x509_server_cert == NULL || network_handle->cred->x509_server_cert_len == 0) {
             printf("invalid x509 server cert\n");
             return STATE_PORT_TLS_INVALID_SERVER_CERT;
         }
-        mbedtls_x509_crt_init(&network_handle->mbedtls.x509_server_cert);
 
-        res = mbedtls_x509_crt_parse(&network_handle->mbedtls.x509_server_cert,
-                                     (const unsigned char *)network_handle->cred->x509_server_cert, (size_t)network_handle->cred->x509_server_cert_len + 1);
-        if (res < 0) {
-            printf("mbedtls_x509_crt_parse server cert error, res: -0x%04X\n", -res);
-            return STATE_PORT_TLS_INVALID_SERVER_CERT;
+        if (network_handle->mbedtls.ca_cred == NULL) {
+            memset(&key, 0, sizeof(core_sysdep_tls_cred_key_t));
+            key.type = CORE_SYSDEP_TLS_CRED_CA;
+            key.source = network_handle->cred->x509_server_cert;
+            key.source_len = network_handle->cred->x509_server_cert_len;
+            res = _core_sysdep_tls_cred_acquire(&key, &network_handle->mbedtls.ca_cred);
+            if (res < STATE_SUCCESS) {
+                return res;
+            }
         }
 
         if (network_handle->cred->x509_client_cert != NULL && network_handle->cred->x509_client_cert_len > 0 &&
             network_handle->cred->x509_client_privkey != NULL && network_handle->cred->x509_client_privkey_len > 0) {
-            mbedtls_x509_crt_init(&network_handle->mbedtls.x509_client_cert);
-            mbedtls_pk_init(&network_handle->mbedtls.x509_client_pk);
-            res = mbedtls_x509_crt_parse(&network_handle->mbedtls.x509_client_cert,
-                                         (const unsigned char *)network_handle->cred->x509_client_cert, (size_t)network_handle->cred->x509_client_cert_len + 1);
-            if (res < 0) {
-                printf("mbedtls_x509_crt_parse client cert error, res: -0x%04X\n", -res);
-                return STATE_PORT_TLS_INVALID_CLIENT_CERT;
-            }
-            res = mbedtls_pk_parse_key(&network_handle->mbedtls.x509_client_pk,
-                                       (const unsigned char *)network_handle->cred->x509_client_privkey,
-                                       (size_t)network_handle->cred->x509_client_privkey_len + 1, NULL, 0);
-            if (res < 0) {
-                printf("mbedtls_pk_parse_key client pk error, res: -0x%04X\n", -res);
-                return STATE_PORT_TLS_INVALID_CLIENT_KEY;
+            if (network_handle->mbedtls.client_cred == NULL) {
+                memset(&key, 0, sizeof(core_sysdep_tls_cred_key_t));
+                key.type = CORE_SYSDEP_TLS_CRED_CLIENT;
+                key.source = network_handle->cred->x509_client_cert;
+                key.source_len = network_handle->cred->x509_client_cert_len;
+                key.key_source = network_handle->cred->x509_client_privkey;
+                key.key_source_len = network_handle->cred->x509_client_privkey_len;
+                res = _core_sysdep_tls_cred_acquire(&key, &network_handle->mbedtls.client_cred);
+                if (res < STATE_SUCCESS) {
+                    return res;
+                }
             }
-            res = mbedtls_ssl_conf_own_cert(&network_handle->mbedtls.ssl_config, &network_handle->mbedtls.x509_client_cert,
-                                            &network_handle->mbedtls.x509_client_pk);
+            res = mbedtls_ssl_conf_own_cert(&network_handle->mbedtls.ssl_config, &network_handle->mbedtls.client_cred->crt,
+                                            &network_handle->mbedtls.client_cred->pk);
             if (res < 0) {
                 printf("mbedtls_ssl_conf_own_cert error, res: -0x%04X\n", -res);
                 return STATE_PORT_TLS_INVALID_CLIENT_CERT;
             }
         }
-        mbedtls_ssl_conf_ca_chain(&network_handle->mbedtls.ssl_config, &network_handle->mbedtls.x509_server_cert, NULL);
+        mbedtls_ssl_conf_ca_chain(&network_handle->mbedtls.ssl_config, &network_handle->mbedtls.ca_cred->crt, NULL);
+        if (network_handle->cred->option == AIOT_SYSDEP_NETWORK_CRED_SVRCERT_ECC) {
+#if defined(MBEDTLS_KEY_EXCHANGE_ECDHE_ECDSA_ENABLED)
+            /* 只提供一个套件和一条曲线, ClientHello更短, 服务端也无从选择RSA */
+            static const int ciphersuites[2] = {MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256, 0};
+            static const mbedtls_ecp_group_id curves[2] = {MBEDTLS_ECP_DP_SECP256R1, MBEDTLS_ECP_DP_NONE};
+
+            mbedtls_ssl_conf_ciphersuites(&network_handle->mbedtls.ssl_config, ciphersuites);
+            mbedtls_ssl_conf_curves(&network_handle->mbedtls.ssl_config, curves);
+#else
+            printf("ecc security option requires MBEDTLS_SSL_ECC_PROFILE\n");
+            return STATE_PORT_TLS_INVALID_CRED_OPTION;
+#endif
+        }
     } else if (network_handle->cred->option == AIOT_SYSDEP_NETWORK_CRED_SVRCERT_PSK) {
         static const int ciphersuites[1] = {MBEDTLS_TLS_PSK_WITH_AES_128_CBC_SHA};
+        core_sysdep_psk_t *psk = NULL;
+
+        if (network_handle->psk_cred == NULL) {
+            printf("missing psk\n");
+            return STATE_PORT_TLS_CONFIG_PSK_FAILED;
+        }
+        psk = &network_handle->psk_cred->key.psk;
         res = mbedtls_ssl_conf_psk(&network_handle->mbedtls.ssl_config,
-                                   (const unsigned char *)network_handle->psk.psk, (size_t)strlen(network_handle->psk.psk),
-                                   (const unsigned char *)network_handle->psk.psk_id, (size_t)strlen(network_handle->psk.psk_id));
+                                   (const unsigned char *)psk->psk, (size_t)strlen(psk->psk),
+                                   (const unsigned char *)psk->psk_id, (size_t)strlen(psk->psk_id));
         if (res < 0) {
             printf("mbedtls_ssl_conf_psk error, res = -0x%04X\n", -res);
             return STATE_PORT_TLS_CONFIG_PSK_FAILED;
@@ -637,33 +1914,249 @@ static int32_t _core_sysdep_network_mbedtls_establish(core_network_handle_t *net
         return res;
     }
 
-    mbedtls_ssl_set_bio(&network_handle->mbedtls.ssl_ctx, &network_handle->mbedtls.net_ctx, mbedtls_net_send,
-                        mbedtls_net_recv, mbedtls_net_recv_timeout);
-    mbedtls_ssl_conf_read_timeout(&network_handle->mbedtls.ssl_config, network_handle->connect_timeout_ms);
+    mbedtls_ssl_set_bio(&network_handle->mbedtls.ssl_ctx, network_handle, _core_sysdep_handshake_send,
+                        _core_sysdep_handshake_recv, NULL);
+    network_handle->mbedtls.session_offered = _core_sysdep_tls_session_offer(network_handle,
+            network_handle->mbedtls.session_master);
+
+    return STATE_SUCCESS;
+}
+
+/* 发起非阻塞的TCP连接, 连接已建立或正在进行时返回 */
+static int32_t _core_sysdep_network_mbedtls_connect(core_network_handle_t *network_handle)
+{
+    int32_t res = STATE_PORT_TLS_SOCKET_CREATE_FAILED;
+    int fd = -1;
+    char port_str[6] = {0};
+    struct addrinfo hints;
+    struct addrinfo *addr_list = NULL, *pos = NULL;
+
+    memset(&hints, 0, sizeof(struct addrinfo));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    _port_uint2str(network_handle->port, port_str);
+
+    if (getaddrinfo(network_handle->host, port_str, &hints, &addr_list) != 0) {
+        printf("getaddrinfo error, host: %s, port: %s\n", network_handle->host, port_str);
+        return STATE_PORT_TLS_DNS_FAILED;
+    }
+
+    for (pos = addr_list; pos != NULL; pos = pos->ai_next) {
+        fd = socket(pos->ai_family, pos->ai_socktype, pos->ai_protocol);
+        if (fd < 0) {
+            res = STATE_PORT_TLS_SOCKET_CREATE_FAILED;
+            continue;
+        }
+        network_handle->mbedtls.net_ctx.fd = fd;
+        mbedtls_net_set_nonblock(&network_handle->mbedtls.net_ctx);
+
+        if (connect(fd, pos->ai_addr, pos->ai_addrlen) == 0 || errno == EINPROGRESS) {
+            res = STATE_SUCCESS;
+            break;
+        }
+        printf("connect error, errno: %d\n", errno);
+        close(fd);
+        network_handle->mbedtls.net_ctx.fd = -1;
+        res = STATE_PORT_TLS_SOCKET_CONNECT_FAILED;
+    }
+    freeaddrinfo(addr_list);
+
+    return res;
+}
+
+static int32_t _core_sysdep_network_mbedtls_connected(core_network_handle_t *network_handle)
+{
+    struct pollfd fds;
+    int err = 0;
+    socklen_t len = sizeof(err);
+
+    fds.fd = network_handle->mbedtls.net_ctx.fd;
+    fds.events = POLLOUT;
+    fds.revents = 0;
+    if (poll(&fds, 1, 0) <= 0) {
+        return STATE_PORT_NETWORK_ESTABLISH_IN_PROGRESS;
+    }
+
+    if (getsockopt(fds.fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+        printf("connect error, errno: %d\n", err);
+        return STATE_PORT_TLS_SOCKET_CONNECT_FAILED;
+    }
+
+    return STATE_SUCCESS;
+}
+
+/* 握手状态机前进到结束或需要等待网络为止, 每一步的耗时计入当时最后一个flight */
+static int32_t _core_sysdep_network_mbedtls_handshake(core_network_handle_t *network_handle)
+{
+    core_sysdep_handshake_stats_t *stats = network_handle->handshake_stats;
+    uint64_t start = 0;
+    int res = 0;
 
-    while ((res = mbedtls_ssl_handshake(&network_handle->mbedtls.ssl_ctx)) != 0) {
-        if ((res != MBEDTLS_ERR_SSL_WANT_READ) && (res != MBEDTLS_ERR_SSL_WANT_WRITE)) {
+    while (network_handle->mbedtls.ssl_ctx.state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+        start = _core_memstat_time_us();
+        res = mbedtls_ssl_handshake_step(&network_handle->mbedtls.ssl_ctx);
+        if (stats != NULL && stats->flight_num > 0) {
+            stats->flight[stats->flight_num - 1].cpu_us += (uint32_t)(_core_memstat_time_us() - start);
+        }
+
+        if (res == MBEDTLS_ERR_SSL_WANT_READ) {
+            network_handle->mbedtls.events = POLLIN;
+            return STATE_PORT_NETWORK_ESTABLISH_IN_PROGRESS;
+        } else if (res == MBEDTLS_ERR_SSL_WANT_WRITE) {
+            network_handle->mbedtls.events = POLLOUT;
+            return STATE_PORT_NETWORK_ESTABLISH_IN_PROGRESS;
+        } else if (res != 0) {
             printf("mbedtls_ssl_handshake error, res: -0x%04X\n", -res);
+            if (network_handle->mbedtls.session_offered) {
+                _core_sysdep_tls_session_drop(network_handle);
+            }
             if (res == MBEDTLS_ERR_SSL_INVALID_RECORD) {
-                res = STATE_PORT_TLS_INVALID_RECORD;
-            } else {
-                res = STATE_PORT_TLS_INVALID_HANDSHAKE;
+                return STATE_PORT_TLS_INVALID_RECORD;
             }
-            return res;
+            return STATE_PORT_TLS_INVALID_HANDSHAKE;
+        }
+
+        if (stats != NULL) {
+            stats->steps++;
         }
     }
 
+    return STATE_SUCCESS;
+}
+
+static int32_t _core_sysdep_network_mbedtls_finish(core_network_handle_t *network_handle)
+{
+    int32_t res = 0;
+
     res = mbedtls_ssl_get_verify_result(&network_handle->mbedtls.ssl_ctx);
     if (res < 0) {
         printf("mbedtls_ssl_get_verify_result error, res: -0x%04X\n", -res);
         return res;
     }
 
+    /* 之后的收发仍按阻塞socket和读超时处理 */
+    mbedtls_net_set_block(&network_handle->mbedtls.net_ctx);
+    mbedtls_ssl_set_bio(&network_handle->mbedtls.ssl_ctx, &network_handle->mbedtls.net_ctx, mbedtls_net_send,
+                        mbedtls_net_recv, mbedtls_net_recv_timeout);
+
+    if (network_handle->handshake_stats != NULL && network_handle->mbedtls.session_offered &&
+        memcmp(network_handle->mbedtls.session_master, network_handle->mbedtls.ssl_ctx.session->master, 48) == 0) {
+        network_handle->handshake_stats->resumed = 1;
+    }
+    _core_sysdep_tls_session_save(network_handle);
+
+    g_mbedtls_handshake_max_mem_used = g_mbedtls_max_mem_used;
+    g_mbedtls_established_mem_used = g_mbedtls_total_mem_used;
     printf("success to establish mbedtls connection, fd = %d(cost %d bytes in total, max used %d bytes)\n",
            (int)network_handle->mbedtls.net_ctx.fd,
            g_mbedtls_total_mem_used, g_mbedtls_max_mem_used);
 
-    return 0;
+    return STATE_SUCCESS;
+}
+
+/* 从上次中断的阶段继续, 不会等待网络 */
+static int32_t _core_sysdep_network_mbedtls_establish_step(core_network_handle_t *network_handle)
+{
+    core_sysdep_mbedtls_t *mbedtls = &network_handle->mbedtls;
+    core_sysdep_handshake_stats_t *stats = network_handle->handshake_stats;
+    uint64_t start = _core_memstat_time_us(), now = 0;
+    int32_t res = STATE_SUCCESS;
+
+    if (mbedtls->state == CORE_SYSDEP_ESTABLISH_DONE) {
+        return STATE_SUCCESS;
+    } else if (mbedtls->state == CORE_SYSDEP_ESTABLISH_FAILED) {
+        return mbedtls->res;
+    }
+
+    if (mbedtls->state == CORE_SYSDEP_ESTABLISH_IDLE) {
+        if (stats != NULL) {
+            memset(stats, 0, sizeof(core_sysdep_handshake_stats_t));
+        }
+        mbedtls->start_us = mbedtls->progress_us = start;
+        res = _core_sysdep_network_mbedtls_setup(network_handle);
+        if (res >= STATE_SUCCESS) {
+            res = _core_sysdep_network_mbedtls_connect(network_handle);
+        }
+        if (res >= STATE_SUCCESS) {
+            mbedtls->state = CORE_SYSDEP_ESTABLISH_CONNECTING;
+            mbedtls->events = POLLOUT;
+        }
+    }
+
+    if (mbedtls->state == CORE_SYSDEP_ESTABLISH_CONNECTING) {
+        res = _core_sysdep_network_mbedtls_connected(network_handle);
+        if (res >= STATE_SUCCESS) {
+            now = _core_memstat_time_us();
+            mbedtls->state = CORE_SYSDEP_ESTABLISH_HANDSHAKING;
+            mbedtls->handshake_start_us = mbedtls->progress_us = now;
+            if (stats != NULL) {
+                stats->connect_us = (uint32_t)(now - mbedtls->start_us);
+            }
+        }
+    }
+
+    if (mbedtls->state == CORE_SYSDEP_ESTABLISH_HANDSHAKING) {
+        res = _core_sysdep_network_mbedtls_handshake(network_handle);
+        if (res >= STATE_SUCCESS) {
+            if (stats != NULL) {
+                stats->handshake_us = (uint32_t)(_core_memstat_time_us() - mbedtls->handshake_start_us);
+            }
+            res = _core_sysdep_network_mbedtls_finish(network_handle);
+            if (res >= STATE_SUCCESS) {
+                mbedtls->state = CORE_SYSDEP_ESTABLISH_DONE;
+            }
+        }
+    }
+
+    now = _core_memstat_time_us();
+    if (res == STATE_PORT_NETWORK_ESTABLISH_IN_PROGRESS && network_handle->connect_timeout_ms > 0 &&
+        now - mbedtls->progress_us > (uint64_t)network_handle->connect_timeout_ms * 1000) {
+        printf("establish mbedtls connection timeout, no progress in %u ms\n", network_handle->connect_timeout_ms);
+        if (mbedtls->state == CORE_SYSDEP_ESTABLISH_HANDSHAKING && mbedtls->session_offered) {
+            _core_sysdep_tls_session_drop(network_handle);
+        }
+        res = STATE_PORT_NETWORK_CONNECT_TIMEOUT;
+    }
+
+    if (stats != NULL) {
+        if (res == STATE_PORT_NETWORK_ESTABLISH_IN_PROGRESS) {
+            stats->yields++;
+        }
+        if (now - start > stats->max_step_us) {
+            stats->max_step_us = (uint32_t)(now - start);
+        }
+    }
+    if (res < STATE_SUCCESS && res != STATE_PORT_NETWORK_ESTABLISH_IN_PROGRESS) {
+        mbedtls->state = CORE_SYSDEP_ESTABLISH_FAILED;
+        mbedtls->res = res;
+    }
+
+    return res;
+}
+
+static int32_t _core_sysdep_network_mbedtls_establish(core_network_handle_t *network_handle)
+{
+    struct pollfd fds;
+    uint64_t idle_ms = 0;
+    int32_t res = STATE_SUCCESS;
+    int timeout_ms = -1;
+
+    while ((res = _core_sysdep_network_mbedtls_establish_step(network_handle)) == STATE_PORT_NETWORK_ESTABLISH_IN_PROGRESS &&
+           network_handle->nonblock == 0) {
+        timeout_ms = -1;
+        if (network_handle->connect_timeout_ms > 0) {
+            idle_ms = (_core_memstat_time_us() - network_handle->mbedtls.progress_us) / 1000;
+            timeout_ms = (idle_ms < network_handle->connect_timeout_ms) ?
+                         (int)(network_handle->connect_timeout_ms - idle_ms) + 1 : 1;
+        }
+        fds.fd = network_handle->mbedtls.net_ctx.fd;
+        fds.events = network_handle->mbedtls.events;
+        fds.revents = 0;
+        poll(&fds, 1, timeout_ms);
+    }
+
+    return res;
 }
 #endif
 
@@ -1021,13 +2514,10 @@ static void _core_sysdep_network_mbedtls_disconnect(core_network_handle_t *netwo
 {
     mbedtls_ssl_close_notify(&network_handle->mbedtls.ssl_ctx);
     mbedtls_net_free(&network_handle->mbedtls.net_ctx);
-    if (network_handle->cred->option == AIOT_SYSDEP_NETWORK_CRED_SVRCERT_RSA) {
-        mbedtls_x509_crt_free(&network_handle->mbedtls.x509_server_cert);
-        mbedtls_x509_crt_free(&network_handle->mbedtls.x509_client_cert);
-        mbedtls_pk_free(&network_handle->mbedtls.x509_client_pk);
-    }
     mbedtls_ssl_free(&network_handle->mbedtls.ssl_ctx);
     mbedtls_ssl_config_free(&network_handle->mbedtls.ssl_config);
+    _core_sysdep_tls_cred_release(&network_handle->mbedtls.ca_cred);
+    _core_sysdep_tls_cred_release(&network_handle->mbedtls.client_cred);
     g_mbedtls_total_mem_used = g_mbedtls_max_mem_used = 0;
 }
 #endif
@@ -1066,14 +2556,7 @@ int32_t core_sysdep_network_deinit(void **handle)
         network_handle->cred = NULL;
     }
 #ifdef CORE_SYSDEP_MBEDTLS_ENABLED
-    if (network_handle->psk.psk_id != NULL) {
-        free(network_handle->psk.psk_id);
-        network_handle->psk.psk_id = NULL;
-    }
-    if (network_handle->psk.psk != NULL) {
-        free(network_handle->psk.psk);
-        network_handle->psk.psk = NULL;
-    }
+    _core_sysdep_tls_cred_release(&network_handle->psk_cred);
 #endif
 
     free(network_handle);
@@ -1082,7 +2565,7 @@ int32_t core_sysdep_network_deinit(void **handle)
     return 0;
 }
 
-void core_sysdep_rand(uint8_t *output, uint32_t output_len)
+static void _core_sysdep_rand_libc(uint8_t *output, uint32_t output_len)
 {
     uint32_t idx = 0, bytes = 0, rand_num = 0;
     struct timeval time;
@@ -1105,6 +2588,18 @@ void core_sysdep_rand(uint8_t *output, uint32_t output_len)
     }
 }
 
+void core_sysdep_rand(uint8_t *output, uint32_t output_len)
+{
+#ifdef CORE_SYSDEP_MBEDTLS_ENABLED
+    /* DRBG不可用时直接从熵源取, 熵源也不可用时退回到rand(), 不能返回固定的输出 */
+    if (_core_sysdep_drbg_random(output, output_len) == 0 || _core_sysdep_entropy_poll(output, output_len) == 0) {
+        return;
+    }
+    printf("core_sysdep_rand failed\n");
+#endif
+    _core_sysdep_rand_libc(output, output_len);
+}
+
 void *core_sysdep_mutex_init(void)
 {
     int res = 0;